@@ -167,6 +167,7 @@ exit 0
 %{_bindir}/besdaemon
 # %{_bindir}/besd # moved to /etc/rc.d/init.d; see below.
 %{_bindir}/besstandalone
+%{_bindir}/besreplay
 %{_bindir}/besctl
 %{_bindir}/hyraxctl
 %{_bindir}/bescmdln
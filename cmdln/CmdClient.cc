@@ -269,7 +269,7 @@ bool CmdClient::executeCommand(const string &cmd, int repeat)
             BESDEBUG("cmdln", "cmdclient sending " << cmd << endl);
 
             BESStopWatch sw;
-			if( BESISDEBUG( TIMING_LOG ) )
+			if( BESISTIMING )
 				sw.start("CmdClient::executeCommand","command_line_client");
 
             map<string, string> extensions;
@@ -305,6 +305,12 @@ bool CmdClient::executeCommand(const string &cmd, int repeat)
                 if (extensions["exit"] == "true") {
                     do_exit = true;
                 }
+                if (done && extensions["batch"] == "more") {
+                    // A batched request; another response follows this one
+                    extensions.erase("batch");
+                    extensions.erase("status");
+                    done = false;
+                }
             }
             if (show_stream) {
                 *(_strm) << show_stream->str() << endl;
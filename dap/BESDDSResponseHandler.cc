@@ -35,6 +35,7 @@
 #include "BESDDSResponseHandler.h"
 #include "BESDDSResponse.h"
 #include "BESRequestHandlerList.h"
+#include "BESDapBatchCache.h"
 #include "BESDapNames.h"
 #include "BESDataNames.h"
 
@@ -75,6 +76,10 @@ void BESDDSResponseHandler::execute(BESDataHandlerInterface &dhi)
 	// Set the DAP protocol version requested by the client
 
 	dhi.first_container();
+
+	// In a batch, another command may have built this container's DDS
+	bool built = BESDapBatchCache::get_dds(dhi, bdds, dds);
+
 	BESDEBUG("version", "Initial CE: " << dhi.container->get_constraint() << endl);
 
 	// Keywords were a hack to the protocol and have been dropped. We can get rid of
@@ -91,7 +96,13 @@ void BESDDSResponseHandler::execute(BESDataHandlerInterface &dhi)
 
 	_response = bdds;
 
-	BESRequestHandlerList::TheList()->execute_each(dhi);
+	if (built) {
+		bdds->set_constraint(dhi);
+	}
+	else {
+		BESRequestHandlerList::TheList()->execute_each(dhi);
+		BESDapBatchCache::add_dds(dhi, bdds, bdds->get_dds());
+	}
 }
 
 /** @brief transmit the response object built by the execute command
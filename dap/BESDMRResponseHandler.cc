@@ -27,6 +27,7 @@
 #include "BESDMRResponseHandler.h"
 #include "BESDMRResponse.h"
 #include "BESRequestHandlerList.h"
+#include "BESDapBatchCache.h"
 #include "BESDapNames.h"
 #include "BESDapTransmit.h"
 #include "BESContextManager.h"
@@ -57,6 +58,11 @@ void BESDMRResponseHandler::execute(BESDataHandlerInterface &dhi)
 {
     dhi.action_name = DMR_RESPONSE_STR;
     DMR *dmr = new DMR();
+    BESDMRResponse *bdmr = new BESDMRResponse(dmr);
+    _response = bdmr;
+
+    // In a batch, another command may have built this container's DMR
+    bool built = BESDapBatchCache::get_dmr(dhi, dmr);
 
     // Here we might set the dap and dmr version if they should be different from
     // 4.0 and 1.0. jhrg 11/6/13
@@ -67,8 +73,14 @@ void BESDMRResponseHandler::execute(BESDataHandlerInterface &dhi)
         dmr->set_request_xml_base(xml_base);
     }
 
-    _response = new BESDMRResponse(dmr);
-    BESRequestHandlerList::TheList()->execute_each(dhi);
+    if (built) {
+        bdmr->set_dap4_constraint(dhi);
+        bdmr->set_dap4_function(dhi);
+    }
+    else {
+        BESRequestHandlerList::TheList()->execute_each(dhi);
+        BESDapBatchCache::add_dmr(dhi, bdmr->get_dmr());
+    }
 }
 
 /** @brief transmit the response object built by the execute command
@@ -29,6 +29,7 @@
 #include "BESDap4ResponseHandler.h"
 #include "BESDMRResponse.h"
 #include "BESRequestHandlerList.h"
+#include "BESDapBatchCache.h"
 #include "BESDapNames.h"
 #include "BESDapTransmit.h"
 #include "BESContextManager.h"
@@ -52,6 +53,11 @@ void BESDap4ResponseHandler::execute(BESDataHandlerInterface &dhi)
 {
 	dhi.action_name = DAP4DATA_RESPONSE_STR;
 	DMR *dmr = new DMR();
+	BESDMRResponse *bdmr = new BESDMRResponse(dmr);
+	_response = bdmr;
+
+	// In a batch, another command may have built this container's DMR
+	bool built = BESDapBatchCache::get_dmr(dhi, dmr);
 
 	// Here we might set the dap and dmr version if they should be different from
 	// 4.0 and 1.0. jhrg 11/6/13
@@ -75,9 +81,14 @@ void BESDap4ResponseHandler::execute(BESDataHandlerInterface &dhi)
 		dmr->set_request_xml_base(xml_base);
 	}
 
-	_response = new BESDMRResponse(dmr);
-
-	BESRequestHandlerList::TheList()->execute_each(dhi);
+	if (built) {
+		bdmr->set_dap4_constraint(dhi);
+		bdmr->set_dap4_function(dhi);
+	}
+	else {
+		BESRequestHandlerList::TheList()->execute_each(dhi);
+		BESDapBatchCache::add_dmr(dhi, bdmr->get_dmr());
+	}
 }
 
 /** @brief transmit the response object built by the execute command
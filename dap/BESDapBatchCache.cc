@@ -0,0 +1,140 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <DDS.h>
+#include <DMR.h>
+
+#include "BESDapBatchCache.h"
+#include "BESDDSResponse.h"
+#include "BESDMRResponse.h"
+#include "BESDataHandlerInterface.h"
+#include "BESContainer.h"
+#include "BESDataNames.h"
+#include "BESDebug.h"
+
+using namespace std;
+using namespace libdap;
+
+static const string dmr_object = "dap.dmr";
+
+/// The DDS has the container's structure only if containers are explicit
+static string dds_object(BESDapResponse *response)
+{
+    return response->get_explicit_containers() ? "dap.dds.explicit" : "dap.dds";
+}
+
+/// Return the command's container if the command is part of a batch
+static BESContainer *batched_container(BESDataHandlerInterface &dhi)
+{
+    if (dhi.data[BATCH_REQUEST] != "true" || dhi.containers.size() != 1) return 0;
+
+    dhi.first_container();
+    return dhi.container;
+}
+
+/**
+ * @brief Copy the DDS kept for the command's container
+ *
+ * The copy replaces all of dds, so call this before setting the request's
+ * DAP version, response size limit and xml:base on it.
+ *
+ * @param dhi The command's data handler interface
+ * @param response The response that holds dds
+ * @param dds Copy the kept DDS here
+ * @return True if a DDS was copied, false if the caller must build it
+ */
+bool BESDapBatchCache::get_dds(BESDataHandlerInterface &dhi, BESDapResponse *response, DDS *dds)
+{
+    BESContainer *container = batched_container(dhi);
+    if (!container) return false;
+
+    BESDDSResponse *kept = dynamic_cast<BESDDSResponse *>(container->get_request_object(dds_object(response)));
+    if (!kept) return false;
+
+    BESDEBUG("dap", "BESDapBatchCache::get_dds() - using the DDS built for " << container->get_symbolic_name() << endl);
+
+    *dds = *kept->get_dds();
+
+    return true;
+}
+
+/**
+ * @brief Keep a copy of the DDS built for the command's container
+ *
+ * Does nothing unless the command is part of a batch.
+ *
+ * @param dhi The command's data handler interface
+ * @param response The response that holds dds
+ * @param dds The DDS, before it is transmitted
+ */
+void BESDapBatchCache::add_dds(BESDataHandlerInterface &dhi, BESDapResponse *response, DDS *dds)
+{
+    BESContainer *container = batched_container(dhi);
+    if (!container) return;
+
+    container->set_request_object(dds_object(response), new BESDDSResponse(new DDS(*dds)));
+}
+
+/**
+ * @brief Copy the DMR kept for the command's container
+ *
+ * The copy replaces all of dmr, so call this before setting the request's
+ * response size limit and xml:base on it.
+ *
+ * @param dhi The command's data handler interface
+ * @param dmr Copy the kept DMR here
+ * @return True if a DMR was copied, false if the caller must build it
+ */
+bool BESDapBatchCache::get_dmr(BESDataHandlerInterface &dhi, DMR *dmr)
+{
+    BESContainer *container = batched_container(dhi);
+    if (!container) return false;
+
+    BESDMRResponse *kept = dynamic_cast<BESDMRResponse *>(container->get_request_object(dmr_object));
+    if (!kept) return false;
+
+    BESDEBUG("dap", "BESDapBatchCache::get_dmr() - using the DMR built for " << container->get_symbolic_name() << endl);
+
+    *dmr = *kept->get_dmr();
+
+    return true;
+}
+
+/**
+ * @brief Keep a copy of the DMR built for the command's container
+ *
+ * Does nothing unless the command is part of a batch.
+ *
+ * @param dhi The command's data handler interface
+ * @param dmr The DMR, before it is transmitted
+ */
+void BESDapBatchCache::add_dmr(BESDataHandlerInterface &dhi, DMR *dmr)
+{
+    BESContainer *container = batched_container(dhi);
+    if (!container) return;
+
+    container->set_request_object(dmr_object, new BESDMRResponse(new DMR(*dmr)));
+}
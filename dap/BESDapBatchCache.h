@@ -0,0 +1,57 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef DAP_BESDAPBATCHCACHE_H_
+#define DAP_BESDAPBATCHCACHE_H_
+
+namespace libdap {
+class DDS;
+class DMR;
+}
+
+class BESDataHandlerInterface;
+class BESDapResponse;
+
+/**
+ * @brief Share the DDS or DMR built for a container among a batch's commands
+ *
+ * When a request is batched, the response handlers keep a copy of the DDS
+ * (or DMR) a request handler built for the command's container, using
+ * BESContainer::set_request_object(). The next DDS, DDX, data or data DDX
+ * response (or DMR or DAP4 data response) for that container is copied from
+ * it instead of being built by opening the dataset again. The copy is made
+ * before the response is transmitted, so it holds no data. Only commands
+ * with a single container use this; the copies are deleted when the request
+ * ends.
+ */
+class BESDapBatchCache {
+public:
+    static bool get_dds(BESDataHandlerInterface &dhi, BESDapResponse *response, libdap::DDS *dds);
+    static void add_dds(BESDataHandlerInterface &dhi, BESDapResponse *response, libdap::DDS *dds);
+
+    static bool get_dmr(BESDataHandlerInterface &dhi, libdap::DMR *dmr);
+    static void add_dmr(BESDataHandlerInterface &dhi, libdap::DMR *dmr);
+};
+
+#endif /* DAP_BESDAPBATCHCACHE_H_ */
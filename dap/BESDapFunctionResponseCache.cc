@@ -36,10 +36,6 @@
 #include <fstream>
 #include <sstream>
 
-#ifdef HAVE_TR1_FUNCTIONAL
-#include <tr1/functional>
-#endif
-
 #include <DDS.h>
 #include <ConstraintEvaluator.h>
 #include <DDXParserSAX2.h>
@@ -62,6 +58,7 @@
 #include "CacheUnMarshaller.h"
 
 #include "BESDapFunctionResponseCache.h"
+#include "BESDapResponseCache.h"
 #include "BESDapResponseBuilder.h"
 #include "BESInternalError.h"
 
@@ -72,12 +69,6 @@
 
 #define DEBUG_KEY "response_cache"
 
-#ifdef HAVE_TR1_FUNCTIONAL
-#define HASH_OBJ std::tr1::hash
-#else
-#define HASH_OBJ std::hash
-#endif
-
 using namespace std;
 using namespace libdap;
 
@@ -267,6 +258,35 @@ string BESDapFunctionResponseCache::get_resource_id(DDS *dds, const string &cons
     return dds->filename() + "#" + constraint;
 }
 
+/**
+ * The resource id of the DAP2 data response that sends the whole result
+ * of the function(s) in \c constraint. This is not the same as the id of
+ * the cached DDS because the two are different entries in the cache.
+ */
+string BESDapFunctionResponseCache::get_data_resource_id(DDS *dds, const string &constraint)
+{
+    return "dods#" + get_resource_id(dds, constraint);
+}
+
+/**
+ * @brief Send the cached DAP2 data response for a function result
+ *
+ * When a request has no projection beyond the function call(s), its whole
+ * response can be stored along with the function result's DDS. A hit is
+ * written to \c out directly from the cache file, without reading the DDS
+ * and its data and then encoding them again.
+ *
+ * @param resource_id From get_data_resource_id()
+ * @param out Write the response body (the DDS and the XDR data) here
+ * @param cache_file_name Value-result parameter; on a miss, the name to
+ * use with BESDapResponseCacheWriter to make the entry
+ * @return True if the response was found and written, false otherwise
+ */
+bool BESDapFunctionResponseCache::send_cached_data(const string &resource_id, ostream &out, string &cache_file_name)
+{
+    return BESDapResponseCache::send_cached_entry(this, resource_id, out, cache_file_name);
+}
+
 bool BESDapFunctionResponseCache::can_be_cached(DDS *dds, const string &constraint)
 {
     BESDEBUG(DEBUG_KEY, __FUNCTION__ << " constraint + dds->filename() length: "
@@ -284,15 +304,7 @@ bool BESDapFunctionResponseCache::can_be_cached(DDS *dds, const string &constrai
  */
 string BESDapFunctionResponseCache::get_hash_basename(const string &resource_id)
 {
-    // Get a hash function for strings
-    HASH_OBJ<string> str_hash;
-    size_t hashValue = str_hash(resource_id);
-    stringstream hashed_id;
-    hashed_id << hashValue;
-    string cache_file_name = get_cache_directory();
-    cache_file_name.append("/").append(get_cache_file_prefix()).append(hashed_id.str());
-
-    return cache_file_name;
+    return BESDapResponseCache::get_entry_basename(this, resource_id);
 }
 
 /**
@@ -321,23 +333,13 @@ BESDapFunctionResponseCache::get_or_cache_dataset(DDS *dds, const string &constr
 {
     // Build the response_id. Since the response content is a function of both the dataset AND the constraint,
     // glue them together to get a unique id for the response.
-    string resourceId = dds->filename() + "#" + constraint;
+    string resourceId = get_resource_id(dds, constraint);
 
     BESDEBUG(DEBUG_KEY, __FUNCTION__ << " resourceId: '" << resourceId << "'" << endl);
 
-    // Get a hash function for strings
-    HASH_OBJ<string> str_hash;
-
-    // Use the hash function to hash the resourceId.
-    size_t hashValue = str_hash(resourceId);
-    stringstream hashed_id;
-    hashed_id << hashValue;
-
-    BESDEBUG(DEBUG_KEY,  __FUNCTION__ << " hashed_id: '" << hashed_id.str() << "'" << endl);
-
-    // Use the parent class's get_cache_file_name() method and its associated machinery to get the file system path for the cache file.
-    // We store it in a variable called basename because the value is later extended as part of the collision avoidance code.
-    string cache_file_name = BESFileLockingCache::get_cache_file_name(hashed_id.str(), false);
+    // Hash the resourceId to get the file system path for the cache file. This is
+    // the base name; it is extended as part of the collision avoidance code.
+    string cache_file_name = get_hash_basename(resourceId);
 
     BESDEBUG(DEBUG_KEY,  __FUNCTION__ << " cache_file_name: '" << cache_file_name << "'" << endl);
 
@@ -418,11 +420,10 @@ BESDapFunctionResponseCache::load_from_cache(const string &resource_id, string &
             // it's the correct one. If so, cached_dds will be true and we exit.
 
             // Read the first line from the cache file and see if it matches the resource id
+            // (The whole line is compared; a truncated id could match a different resource.)
             ifstream cache_file_istream(cfname.str().c_str());
-            char line[max_cacheable_ce_len];
-            cache_file_istream.getline(line, max_cacheable_ce_len);
             string cached_resource_id;
-            cached_resource_id.assign(line);
+            getline(cache_file_istream, cached_resource_id);
 
             BESDEBUG(DEBUG_KEY, __FUNCTION__ << " cached_resource_id: " << cached_resource_id << endl);
 
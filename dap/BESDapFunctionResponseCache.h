@@ -51,10 +51,10 @@ class BaseTypeFactory;
  * by the combination of a dataset and a constraint expression. The CE can be
  * quite large and contain a number of 'special' characters like '()' and so on.
  * Instead of building cache IDs using a simple concatenation of the dataset
- * and CE, we use the C++ std::hash class to generate a hash code. However, it's
- * possible that two different dataset/CE combinations will have the same hash
- * values. We use a simple collision resolution system where a suffix is appended
- * to the hash value. After a number of collisions, we give up and simply do not
+ * and CE, we use the SHA-256 digest of the two. It's still possible (but very
+ * unlikely) that two different dataset/CE combinations will have the same
+ * digest, and the id is checked on a hit anyway. We use a simple collision
+ * resolution system where a suffix is appended to the hash value. After a number of collisions, we give up and simply do not
  * cache the response (providing no worse performance than if the cache did not
  * exist - but currently we throw an exception - see load_from_cache and the
  * constant 'max_collisions').
@@ -66,6 +66,11 @@ class BaseTypeFactory;
  * each cache entry contains the resource id as its first line so that the correct
  * entry can be identified.
  *
+ * @note Data responses: A request that sends the whole function result (no
+ * projection follows the function calls) can also be answered from a second
+ * entry that holds the DAP2 data response body - the DDS and the XDR-encoded
+ * data - in the format used by BESDapResponseCache. See send_cached_data().
+ *
  * @author ndp, jhrg
  */
 
@@ -143,6 +148,9 @@ public:
 
     virtual bool can_be_cached(libdap::DDS *dds, const std::string &constraint);
 
+    virtual std::string get_data_resource_id(libdap::DDS *dds, const std::string &constraint);
+    virtual bool send_cached_data(const std::string &resource_id, std::ostream &out, std::string &cache_file_name);
+
     static string get_cache_dir_from_config();
     static string get_cache_prefix_from_config();
     static unsigned long get_cache_size_from_config();
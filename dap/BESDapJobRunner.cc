@@ -0,0 +1,554 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <streambuf>
+#include <vector>
+#include <algorithm>
+
+#include "BESDapJobRunner.h"
+#include "BESFileLockingCache.h"
+#include "BESInternalError.h"
+#include "BESError.h"
+
+#include "BESUtil.h"
+#include "TheBESKeys.h"
+#include "BESDebug.h"
+
+#define DEBUG_KEY "jobs"
+
+using namespace std;
+
+// Rewrite the status record each time this many more bytes are written.
+const unsigned long long progress_interval = 16 * 1024 * 1024;
+
+// Look no further than this for descriptors to close in a job process.
+const int max_inherited_fd = 65536;
+
+const string BESDapJobRunner::WORKERS_KEY = "DAP.StoredResultsJobs.Workers";
+const string BESDapJobRunner::BULK_WORKERS_KEY = "DAP.StoredResultsJobs.BulkWorkers";
+const string BESDapJobRunner::BULK_SIZE_KEY = "DAP.StoredResultsJobs.BulkSize";
+const string BESDapJobRunner::BULK_NICE_KEY = "DAP.StoredResultsJobs.BulkNice";
+const string BESDapJobRunner::MAX_QUEUED_KEY = "DAP.StoredResultsJobs.MaxQueued";
+
+BESDapJobRunner *BESDapJobRunner::d_instance = 0;
+bool BESDapJobRunner::d_enabled = true;
+
+static unsigned long get_ulong_key(const string &key, unsigned long default_value)
+{
+    bool found;
+    string value;
+    TheBESKeys::TheKeys()->get_value(key, value, found);
+    if (!found || value.empty()) return default_value;
+
+    BESDEBUG(DEBUG_KEY, "BESDapJobRunner - Located BES key " << key << "=" << value << endl);
+    unsigned long n = default_value;
+    istringstream iss(value);
+    iss >> n;
+    return n;
+}
+
+/**
+ * A streambuf that passes output to another and records how much has
+ * been written in the job's status record.
+ */
+class progress_buf: public streambuf {
+    streambuf *d_out;
+    unsigned long long d_count;
+    unsigned long long d_next_report;
+    BESDapJobRunner::Status &d_status;
+    const string &d_job_id;
+    const BESDapJobRunner *d_runner;
+
+    void count(unsigned long long n)
+    {
+        d_count += n;
+        if (d_count >= d_next_report) {
+            d_status.bytes = d_count;
+            d_runner->write_status(d_job_id, d_status);
+            d_next_report = d_count + progress_interval;
+        }
+    }
+
+protected:
+    virtual int_type overflow(int_type c)
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+        int_type r = d_out->sputc(traits_type::to_char_type(c));
+        if (!traits_type::eq_int_type(r, traits_type::eof())) count(1);
+        return r;
+    }
+
+    virtual streamsize xsputn(const char *s, streamsize n)
+    {
+        streamsize written = d_out->sputn(s, n);
+        count(written);
+        return written;
+    }
+
+    virtual int sync()
+    {
+        return d_out->pubsync();
+    }
+
+public:
+    progress_buf(streambuf *out, BESDapJobRunner::Status &status, const string &job_id, const BESDapJobRunner *runner) :
+        d_out(out), d_count(0), d_next_report(progress_interval), d_status(status), d_job_id(job_id), d_runner(runner)
+    {
+    }
+
+    unsigned long long get_count() const { return d_count; }
+};
+
+/**
+ * @param jobs_dir Directory for the job lock, status and partial result
+ * files; made if it does not exist
+ * @param workers Run at most this many interactive lane jobs at once
+ * @param bulk_workers Run at most this many bulk lane jobs at once. If
+ * zero, all jobs use the interactive lane.
+ * @param bulk_size Jobs estimated to be larger than this many bytes use
+ * the bulk lane
+ * @param bulk_nice Add this to the nice value of bulk lane jobs
+ * @param max_queued At most this many jobs, over both lanes, wait for a
+ * slot; submit() declines jobs beyond that
+ */
+BESDapJobRunner::BESDapJobRunner(const string &jobs_dir, unsigned int workers, unsigned int bulk_workers,
+    unsigned long long bulk_size, int bulk_nice, unsigned int max_queued) :
+    d_jobs_dir(jobs_dir), d_workers(workers), d_bulk_workers(bulk_workers), d_bulk_size(bulk_size),
+    d_bulk_nice(bulk_nice), d_max_queued(max_queued)
+{
+    if (mkdir(d_jobs_dir.c_str(), 0775) != 0 && errno != EEXIST)
+        throw BESInternalError("Could not make the stored result jobs directory: " + d_jobs_dir, __FILE__, __LINE__);
+}
+
+/**
+ * Get the job runner for stored results. If DAP.StoredResultsJobs.Workers
+ * is not set or is zero, return null; results are then built while the
+ * client waits.
+ *
+ * @param jobs_dir Directory for the job files; used only by the first call
+ */
+BESDapJobRunner *
+BESDapJobRunner::get_instance(const string &jobs_dir)
+{
+    if (d_enabled && d_instance == 0) {
+        unsigned long workers = get_ulong_key(WORKERS_KEY, 0);
+        if (workers == 0) {
+            d_enabled = false;
+            BESDEBUG(DEBUG_KEY, "BESDapJobRunner::get_instance() - Background jobs are DISABLED" << endl);
+            return 0;
+        }
+
+        d_instance = new BESDapJobRunner(jobs_dir, workers, get_ulong_key(BULK_WORKERS_KEY, 1),
+            get_ulong_key(BULK_SIZE_KEY, 100) * 1024 * 1024, get_ulong_key(BULK_NICE_KEY, 10),
+            get_ulong_key(MAX_QUEUED_KEY, 16));
+#ifdef HAVE_ATEXIT
+        atexit(delete_instance);
+#endif
+        BESDEBUG(DEBUG_KEY, "BESDapJobRunner::get_instance() - Background jobs are ENABLED, jobs dir: " << jobs_dir << endl);
+    }
+
+    return d_instance;
+}
+
+string BESDapJobRunner::job_file(const string &job_id, const string &ext) const
+{
+    return BESUtil::assemblePath(d_jobs_dir, job_id + ext);
+}
+
+/**
+ * Write a job's status record. The record is written to a temporary file
+ * and then renamed so that a reader never sees part of a record.
+ */
+void BESDapJobRunner::write_status(const string &job_id, const Status &status) const
+{
+    ostringstream tmp_name;
+    tmp_name << job_file(job_id, ".status") << "." << getpid();
+
+    ofstream record(tmp_name.str().c_str(), ios::out | ios::trunc);
+    record << "id: " << job_id << endl;
+    record << "state: " << status.state << endl;
+    record << "lane: " << status.lane << endl;
+    record << "pid: " << status.pid << endl;
+    record << "submitted: " << status.submitted << endl;
+    record << "started: " << status.started << endl;
+    record << "finished: " << status.finished << endl;
+    record << "estimated_bytes: " << status.estimated_bytes << endl;
+    record << "bytes: " << status.bytes << endl;
+    string message = status.message;
+    for (string::size_type i = 0; i < message.length(); ++i)
+        if (message[i] == '\n') message[i] = ' ';
+    record << "message: " << message << endl;
+    record.close();
+
+    if (record.fail() || rename(tmp_name.str().c_str(), job_file(job_id, ".status").c_str()) != 0) {
+        BESDEBUG(DEBUG_KEY, "BESDapJobRunner::write_status() - Could not write the status of " << job_id << endl);
+        unlink(tmp_name.str().c_str());
+    }
+}
+
+/**
+ * @brief Read a job's status
+ *
+ * If the record says the job is queued or running but no process holds
+ * the job's lock, the process died; report the job as failed.
+ *
+ * @return False if there is no record for job_id
+ */
+bool BESDapJobRunner::get_status(const string &job_id, Status &status) const
+{
+    ifstream record(job_file(job_id, ".status").c_str());
+    if (!record) return false;
+
+    string line;
+    while (getline(record, line)) {
+        string::size_type colon = line.find(": ");
+        if (colon == string::npos) continue;
+        string key = line.substr(0, colon);
+        istringstream value(line.substr(colon + 2));
+
+        if (key == "state") value >> status.state;
+        else if (key == "lane") value >> status.lane;
+        else if (key == "pid") value >> status.pid;
+        else if (key == "submitted") value >> status.submitted;
+        else if (key == "started") value >> status.started;
+        else if (key == "finished") value >> status.finished;
+        else if (key == "estimated_bytes") value >> status.estimated_bytes;
+        else if (key == "bytes") value >> status.bytes;
+        else if (key == "message") status.message = value.str();
+    }
+
+    if (status.state == "queued" || status.state == "running") {
+        int fd = open(job_file(job_id, ".lock").c_str(), O_RDWR);
+        if (fd >= 0) {
+            if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+                status.state = "failed";
+                status.message = "The job's process exited before the job was finished.";
+                flock(fd, LOCK_UN);
+            }
+            close(fd);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief The ids of the jobs that have status records
+ *
+ * Records are kept after jobs finish, so this includes jobs that are done
+ * or failed.
+ */
+void BESDapJobRunner::get_job_ids(vector<string> &job_ids) const
+{
+    DIR *dir = opendir(d_jobs_dir.c_str());
+    if (!dir) return;
+
+    const string ext = ".status";
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != 0) {
+        string name = entry->d_name;
+        if (name.length() > ext.length() && name.compare(name.length() - ext.length(), ext.length(), ext) == 0)
+            job_ids.push_back(name.substr(0, name.length() - ext.length()));
+    }
+
+    closedir(dir);
+}
+
+/**
+ * Try to get one of the slots with the given name. Each slot is a file
+ * that is locked by the job that uses it, so a slot is freed even if its
+ * job's process dies.
+ *
+ * @return The open, locked, slot file or -1 if all the slots are in use
+ */
+int BESDapJobRunner::try_slot(const string &lane, unsigned int slots) const
+{
+    for (unsigned int i = 0; i < slots; ++i) {
+        ostringstream slot_name;
+        slot_name << lane << ".slot." << i;
+        int fd = open(BESUtil::assemblePath(d_jobs_dir, slot_name.str()).c_str(), O_CREAT | O_RDWR, 0664);
+        if (fd < 0)
+            throw BESInternalError("Could not open a job slot file in " + d_jobs_dir, __FILE__, __LINE__);
+        if (flock(fd, LOCK_EX | LOCK_NB) == 0) return fd;
+        close(fd);
+    }
+
+    return -1;
+}
+
+/**
+ * Wait for one of the lane's slots.
+ *
+ * @return The open, locked, slot file
+ */
+int BESDapJobRunner::get_slot(const string &lane, unsigned int slots) const
+{
+    for (;;) {
+        int fd = try_slot(lane, slots);
+        if (fd >= 0) return fd;
+
+        sleep(1);
+    }
+}
+
+/**
+ * Close the descriptors a job process inherited from the beslistener,
+ * except those in 'keep'. The client's and the listener's sockets and any
+ * pipes must not be held open by a process that outlives the request.
+ * Regular files are left open; they include the cache's info file and
+ * the log files, which the job still uses.
+ */
+static void close_inherited_fds(const vector<int> &keep)
+{
+    int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd >= 0) {
+        dup2(null_fd, 0);
+        dup2(null_fd, 1);
+        dup2(null_fd, 2);
+        if (null_fd > 2) close(null_fd);
+    }
+
+    long open_max = sysconf(_SC_OPEN_MAX);
+    int max_fd = (open_max < 0 || open_max > max_inherited_fd) ? max_inherited_fd : open_max;
+    for (int fd = 3; fd < max_fd; ++fd) {
+        if (find(keep.begin(), keep.end(), fd) != keep.end()) continue;
+
+        struct stat buf;
+        if (fstat(fd, &buf) == 0 && !S_ISREG(buf.st_mode) && !S_ISDIR(buf.st_mode)) close(fd);
+    }
+}
+
+/**
+ * Run a job in the job process: wait for a slot in the job's lane, write
+ * the result to the .part file and then move it into the cache.
+ */
+void BESDapJobRunner::run_job(const string &job_id, Job &job, Status &status, BESFileLockingCache *cache,
+    const string &cache_file_name) const
+{
+    string part_name = job_file(job_id, ".part");
+    int slot_fd = -1;
+
+    try {
+        if (status.lane == "bulk" && d_bulk_nice > 0) {
+            // nice() can return -1 as a valid value; the outcome doesn't matter here
+            errno = 0;
+            (void) nice(d_bulk_nice);
+        }
+
+        slot_fd = get_slot(status.lane, status.lane == "bulk" ? d_bulk_workers : d_workers);
+
+        status.state = "running";
+        status.started = time(0);
+        write_status(job_id, status);
+
+        {
+            ofstream part(part_name.c_str(), ios::out | ios::trunc | ios::binary);
+            if (!part.is_open())
+                throw BESInternalError("Could not open '" + part_name + "' to write a stored result.", __FILE__,
+                    __LINE__);
+
+            progress_buf progress(part.rdbuf(), status, job_id, this);
+            ostream out(&progress);
+            job.run(out);
+            out.flush();
+            part.close();
+
+            if (!out || part.fail())
+                throw BESInternalError("Could not write the stored result '" + part_name + "'.", __FILE__, __LINE__);
+
+            status.bytes = progress.get_count();
+        }
+
+        // Move the result into the cache. If the entry already exists, another
+        // process built it; keep that one.
+        int fd;
+        if (cache->create_and_lock(cache_file_name, fd)) {
+            if (rename(part_name.c_str(), cache_file_name.c_str()) != 0) {
+                cache->purge_file(cache_file_name);
+                cache->unlock_and_close(cache_file_name);
+                throw BESInternalError("Could not move the stored result to '" + cache_file_name + "'.", __FILE__,
+                    __LINE__);
+            }
+
+            cache->exclusive_to_shared_lock(fd);
+
+            unsigned long long size = cache->update_cache_info(cache_file_name);
+            if (cache->cache_too_big(size)) cache->update_and_purge(cache_file_name);
+
+            cache->unlock_and_close(cache_file_name);
+        }
+        else {
+            unlink(part_name.c_str());
+        }
+
+        status.state = "done";
+    }
+    catch (BESError &e) {
+        status.state = "failed";
+        status.message = e.get_message();
+    }
+    catch (std::exception &e) {
+        status.state = "failed";
+        status.message = e.what();
+    }
+    catch (...) {
+        status.state = "failed";
+        status.message = "Unknown error.";
+    }
+
+    if (status.state == "failed") unlink(part_name.c_str());
+
+    status.finished = time(0);
+    write_status(job_id, status);
+
+    if (slot_fd >= 0) close(slot_fd);
+}
+
+/**
+ * @brief Run a job in a background process
+ *
+ * The job runs in a new process that is not a child of this one. This
+ * process returns once the job is queued; the new one waits for a slot in
+ * the job's lane and then runs it.
+ *
+ * @param job_id The name of the job; use the stored result's file name
+ * @param job The work to do. The job process has its own copy of this
+ * process' memory, so it may refer to objects (e.g., a DMR) that this
+ * process deletes once the request is done.
+ * @param estimated_bytes Estimated size of the result; picks the lane
+ * @param cache Add the result to this cache...
+ * @param cache_file_name ...using this name.
+ * @return True if the job was queued or if the same job is already queued
+ * or running; false if the job could not be started or too many jobs are
+ * waiting, in which case the caller should do the work itself.
+ */
+bool BESDapJobRunner::submit(const string &job_id, Job &job, unsigned long long estimated_bytes,
+    BESFileLockingCache *cache, const string &cache_file_name)
+{
+    int lock_fd = open(job_file(job_id, ".lock").c_str(), O_CREAT | O_RDWR, 0664);
+    if (lock_fd < 0) {
+        BESDEBUG(DEBUG_KEY, "BESDapJobRunner::submit() - Could not open the lock file for " << job_id << endl);
+        return false;
+    }
+
+    if (flock(lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        int flock_errno = errno;
+        close(lock_fd);
+        if (flock_errno != EWOULDBLOCK) return false;
+
+        BESDEBUG(DEBUG_KEY, "BESDapJobRunner::submit() - Already queued or running: " << job_id << endl);
+        return true;
+    }
+
+    // Each job holds one of these from now until it is done, so this limits
+    // the jobs that are running or waiting for a slot in their lane.
+    int place_fd;
+    try {
+        place_fd = try_slot("job", d_workers + d_bulk_workers + d_max_queued);
+    }
+    catch (BESError &) {
+        place_fd = -1;
+    }
+
+    if (place_fd < 0) {
+        flock(lock_fd, LOCK_UN);
+        close(lock_fd);
+        BESDEBUG(DEBUG_KEY, "BESDapJobRunner::submit() - Too many jobs; not queuing " << job_id << endl);
+        return false;
+    }
+
+    Status status;
+    status.state = "queued";
+    status.lane = (d_bulk_workers > 0 && estimated_bytes > d_bulk_size) ? "bulk" : "interactive";
+    status.submitted = time(0);
+    status.estimated_bytes = estimated_bytes;
+    write_status(job_id, status);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        flock(lock_fd, LOCK_UN);
+        close(lock_fd);
+        close(place_fd);
+        BESDEBUG(DEBUG_KEY, "BESDapJobRunner::submit() - Could not fork for " << job_id << endl);
+        return false;
+    }
+
+    if (pid == 0) {
+        // Fork again so that the job process is not our child; this process
+        // exits right away and is reaped below.
+        pid_t job_pid = fork();
+        if (job_pid != 0) _exit(job_pid < 0 ? 1 : 0);
+
+        // This is the job process. It must not run the listener's signal
+        // handlers, atexit() functions or static destructors.
+        signal(SIGPIPE, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGHUP, SIG_DFL);
+        signal(SIGALRM, SIG_DFL);
+        signal(SIGCHLD, SIG_DFL);
+
+        vector<int> keep;
+        keep.push_back(lock_fd);
+        keep.push_back(place_fd);
+        close_inherited_fds(keep);
+
+        status.pid = getpid();
+        write_status(job_id, status);
+
+        run_job(job_id, job, status, cache, cache_file_name);
+
+        _exit(status.state == "done" ? 0 : 1);
+    }
+
+    // The job process holds the locks now.
+    close(lock_fd);
+    close(place_fd);
+
+    int wait_status = 0;
+    pid_t waited;
+    do {
+        waited = waitpid(pid, &wait_status, 0);
+    } while (waited < 0 && errno == EINTR);
+
+    if (waited == pid && !(WIFEXITED(wait_status) && WEXITSTATUS(wait_status) == 0)) {
+        BESDEBUG(DEBUG_KEY, "BESDapJobRunner::submit() - Could not start the job process for " << job_id << endl);
+        return false;
+    }
+
+    BESDEBUG(DEBUG_KEY, "BESDapJobRunner::submit() - Queued " << job_id << " in the " << status.lane << " lane" << endl);
+    return true;
+}
@@ -0,0 +1,143 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef DAP_BESDAPJOBRUNNER_H_
+#define DAP_BESDAPJOBRUNNER_H_
+
+#include <sys/types.h>
+#include <ctime>
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+class BESFileLockingCache;
+
+/**
+ * @brief Build stored results in background processes
+ *
+ * A request for an asynchronous (stored) result used to serialize the
+ * whole response before the beslistener could send the AsyncAccepted
+ * document, so a bulk extraction kept that listener (and its client)
+ * busy until it was done. This class runs the job in a separate process
+ * instead; the listener returns as soon as the job is queued.
+ *
+ * Each job is identified by the name of the stored result it builds. The
+ * jobs directory holds, for each job:
+ * - <id>.lock: Held (flock) by the process running the job. A second
+ *   request for the same result while the lock is held is not run again.
+ * - <id>.status: The job's status record (see Status), rewritten as the
+ *   job makes progress. Clients (or the front end) poll this.
+ * - <id>.part: The result while it is being written. It is moved into the
+ *   stored results cache when it is complete, so a partial result is never
+ *   served.
+ *
+ * There are two lanes. Jobs whose estimated size is larger than the bulk
+ * size go in the 'bulk' lane; others go in the 'interactive' lane. Each
+ * lane runs a limited number of jobs at once (the others wait, in the
+ * 'queued' state, for a slot) and bulk jobs run at a lower priority, so
+ * large pulls neither block small ones nor compete with the listeners for
+ * the CPU. At most MaxQueued jobs wait for a slot; when that many are
+ * waiting, submit() declines new jobs and the caller builds the result
+ * while the client waits, as it would without background jobs.
+ *
+ * The status records can be read with the 'show storedResultJobs' command.
+ *
+ * @note Job processes are detached from the beslistener that starts them
+ * (they are not its children), so they finish even after the client's
+ * connection has been closed.
+ */
+class BESDapJobRunner {
+public:
+    /// The work done by a job: write the result to a stream
+    class Job {
+    public:
+        virtual ~Job() { }
+        virtual void run(std::ostream &out) = 0;
+    };
+
+    /// A job's status record
+    struct Status {
+        std::string state;          ///< queued, running, done or failed
+        std::string lane;           ///< interactive or bulk
+        pid_t pid;
+        time_t submitted;
+        time_t started;
+        time_t finished;
+        unsigned long long estimated_bytes;
+        unsigned long long bytes;   ///< Written so far
+        std::string message;        ///< Why a job failed
+
+        Status() : pid(0), submitted(0), started(0), finished(0), estimated_bytes(0), bytes(0) { }
+    };
+
+private:
+    static BESDapJobRunner *d_instance;
+    static bool d_enabled;
+
+    static void delete_instance()
+    {
+        delete d_instance;
+        d_instance = 0;
+    }
+
+    std::string d_jobs_dir;
+    unsigned int d_workers;
+    unsigned int d_bulk_workers;
+    unsigned long long d_bulk_size;
+    int d_bulk_nice;
+    unsigned int d_max_queued;
+
+    std::string job_file(const std::string &job_id, const std::string &ext) const;
+
+    void write_status(const std::string &job_id, const Status &status) const;
+    int try_slot(const std::string &lane, unsigned int slots) const;
+    int get_slot(const std::string &lane, unsigned int slots) const;
+    void run_job(const std::string &job_id, Job &job, Status &status, BESFileLockingCache *cache,
+        const std::string &cache_file_name) const;
+
+    BESDapJobRunner(const BESDapJobRunner &);
+    BESDapJobRunner &operator=(const BESDapJobRunner &);
+
+    friend class progress_buf;
+
+public:
+    static const std::string WORKERS_KEY;
+    static const std::string BULK_WORKERS_KEY;
+    static const std::string BULK_SIZE_KEY;
+    static const std::string BULK_NICE_KEY;
+    static const std::string MAX_QUEUED_KEY;
+
+    BESDapJobRunner(const std::string &jobs_dir, unsigned int workers, unsigned int bulk_workers,
+        unsigned long long bulk_size, int bulk_nice, unsigned int max_queued);
+    virtual ~BESDapJobRunner() { }
+
+    static BESDapJobRunner *get_instance(const std::string &jobs_dir);
+
+    const std::string &get_jobs_dir() const { return d_jobs_dir; }
+
+    virtual bool submit(const std::string &job_id, Job &job, unsigned long long estimated_bytes,
+        BESFileLockingCache *cache, const std::string &cache_file_name);
+
+    virtual bool get_status(const std::string &job_id, Status &status) const;
+    virtual void get_job_ids(std::vector<std::string> &job_ids) const;
+};
+
+#endif /* DAP_BESDAPJOBRUNNER_H_ */
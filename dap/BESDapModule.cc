@@ -51,6 +51,7 @@ using std::endl;
 #include "BESDap4ResponseHandler.h"
 
 #include "BESCatalogResponseHandler.h"
+#include "BESStoredResultJobsResponseHandler.h"
 
 #include "BESServiceRegistry.h"
 
@@ -104,6 +105,10 @@ void BESDapModule::initialize(const string &modname)
 	BESDEBUG("dap", "    adding " << CATALOG_RESPONSE << " response handler" << endl);
 	BESResponseHandlerList::TheList()->add_handler(CATALOG_RESPONSE, BESCatalogResponseHandler::CatalogResponseBuilder);
 
+	BESDEBUG("dap", "    adding " << SHOW_STORED_RESULT_JOBS << " response handler" << endl);
+	BESResponseHandlerList::TheList()->add_handler(SHOW_STORED_RESULT_JOBS,
+		BESStoredResultJobsResponseHandler::StoredResultJobsResponseBuilder);
+
 	BESDEBUG("dap", "Adding " << OPENDAP_SERVICE << " services:" << endl);
 	BESServiceRegistry *registry = BESServiceRegistry::TheRegistry();
 	registry->add_service(OPENDAP_SERVICE);
@@ -158,6 +163,7 @@ void BESDapModule::terminate(const string &modname)
 
 	BESResponseHandlerList::TheList()->remove_handler(DMR_RESPONSE);
 	BESResponseHandlerList::TheList()->remove_handler(DAP4DATA_RESPONSE);
+	BESResponseHandlerList::TheList()->remove_handler(SHOW_STORED_RESULT_JOBS);
 
 	BESResponseHandlerList::TheList()->remove_handler(CATALOG_RESPONSE);
 
@@ -46,6 +46,7 @@
  * show
  *     catalog
  *     info
+ *     storedResultJobs
  * @endverbatim
  */
 
@@ -88,6 +89,9 @@
 #define DAP4DATA_DESCRIPT "OPeNDAP DAP4 Data Structure"
 #define DAP4DATA_RESPONSE_STR "getDAP"
 #endif
+
+#define SHOW_STORED_RESULT_JOBS "show.storedresultjobs"
+#define SHOW_STORED_RESULT_JOBS_STR "showStoredResultJobs"
 /*
  * DataDDX data names
  */
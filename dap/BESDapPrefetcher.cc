@@ -0,0 +1,205 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "config.h"
+
+#include <signal.h>
+
+#include <cstring>
+#include <algorithm>
+
+#include <BaseType.h>
+
+#include "BESDapPrefetcher.h"
+#include "BESInternalError.h"
+#include "BESDebug.h"
+
+using namespace std;
+using namespace libdap;
+
+/**
+ * @brief Start the worker threads
+ *
+ * Variables that have already been read (e.g., the results of server
+ * functions), sequences (whose read() is called once per row) and
+ * variables larger than max_bytes are not prefetched.
+ *
+ * @param vars The variables, in the order they will be serialized
+ * @param depth Read at most this many variables ahead of the one being
+ * serialized; also the number of worker threads
+ * @param max_bytes Limit the data read but not yet serialized to this many
+ * bytes
+ */
+BESDapPrefetcher::BESDapPrefetcher(const vector<BaseType*> &vars, unsigned int depth, unsigned long max_bytes) :
+    d_depth(depth), d_max_bytes(max_bytes), d_next(0), d_current(0), d_bytes_in_use(0), d_shutdown(false)
+{
+    unsigned int candidates = 0;
+    for (vector<BaseType*>::const_iterator i = vars.begin(), e = vars.end(); i != e; ++i) {
+        unsigned long bytes = (*i)->width(true);
+        bool prefetch = !(*i)->read_p() && (*i)->type() != dods_sequence_c && bytes <= d_max_bytes;
+        d_jobs.push_back(job(*i, bytes, prefetch ? queued : skipped));
+        if (prefetch) ++candidates;
+    }
+
+    BESDEBUG("dap", "BESDapPrefetcher - " << candidates << " of " << d_jobs.size() << " variables may be prefetched" << endl);
+
+    if (pthread_mutex_init(&d_mutex, 0) != 0)
+        throw BESInternalError("Could not initialize the prefetch mutex.", __FILE__, __LINE__);
+    if (pthread_cond_init(&d_cond, 0) != 0) {
+        pthread_mutex_destroy(&d_mutex);
+        throw BESInternalError("Could not initialize the prefetch condition.", __FILE__, __LINE__);
+    }
+
+    // Block all signals while the workers are made so that they inherit a
+    // mask that leaves SIGALRM, SIGPIPE, etc., to the main thread.
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    unsigned int threads = min(d_depth, candidates);
+    for (unsigned int t = 0; t < threads; ++t) {
+        pthread_t thread;
+        int status = pthread_create(&thread, 0, worker, this);
+        if (status != 0) {
+            // Run with the threads we have; serialize() reads anything
+            // they do not.
+            BESDEBUG("dap", "BESDapPrefetcher - Could not start a worker thread: " << strerror(status) << endl);
+            break;
+        }
+        d_threads.push_back(thread);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old, 0);
+}
+
+/**
+ * Stop the workers. Reads that are in progress are allowed to finish
+ * (the variables still belong to the DDS or DMR); no new ones are started.
+ */
+BESDapPrefetcher::~BESDapPrefetcher()
+{
+    pthread_mutex_lock(&d_mutex);
+    d_shutdown = true;
+    pthread_cond_broadcast(&d_cond);
+    pthread_mutex_unlock(&d_mutex);
+
+    for (vector<pthread_t>::iterator i = d_threads.begin(), e = d_threads.end(); i != e; ++i)
+        pthread_join(*i, 0);
+
+    pthread_cond_destroy(&d_cond);
+    pthread_mutex_destroy(&d_mutex);
+}
+
+/// Called with the mutex locked. Move past skipped jobs; can the next one start?
+bool BESDapPrefetcher::can_start()
+{
+    while (d_next < d_jobs.size() && d_jobs[d_next].state == skipped)
+        ++d_next;
+
+    return d_next < d_jobs.size() && d_next <= d_current + d_depth
+        && d_bytes_in_use + d_jobs[d_next].bytes <= d_max_bytes;
+}
+
+void BESDapPrefetcher::run()
+{
+    pthread_mutex_lock(&d_mutex);
+    while (true) {
+        while (!d_shutdown && !can_start())
+            pthread_cond_wait(&d_cond, &d_mutex);
+
+        if (d_shutdown) break;
+
+        job &j = d_jobs[d_next++];
+        j.state = reading;
+        d_bytes_in_use += j.bytes;
+
+        pthread_mutex_unlock(&d_mutex);
+
+        bool ok = true;
+        try {
+            j.var->read();
+        }
+        catch (...) {
+            ok = false;
+        }
+
+        pthread_mutex_lock(&d_mutex);
+        j.state = ok ? ready : failed;
+        pthread_cond_broadcast(&d_cond);
+    }
+    pthread_mutex_unlock(&d_mutex);
+}
+
+void *BESDapPrefetcher::worker(void *arg)
+{
+    // The debug stream is not thread safe, so the read() methods run here
+    // must not write debug or timing output to it.
+    BESDebug::SetThreadSilent(true);
+
+    static_cast<BESDapPrefetcher*>(arg)->run();
+    return 0;
+}
+
+/**
+ * @brief Wait until variable i can be serialized
+ *
+ * If no worker has started reading the variable, it is taken off the
+ * queue and serialize() will read it.
+ */
+void BESDapPrefetcher::wait(unsigned int i)
+{
+    pthread_mutex_lock(&d_mutex);
+
+    d_current = i;
+    job &j = d_jobs.at(i);
+    if (j.state == queued) {
+        j.state = skipped;
+        if (d_next == i) ++d_next;
+    }
+
+    while (j.state == reading)
+        pthread_cond_wait(&d_cond, &d_mutex);
+
+    // Make serialize() read the variable again and report the error
+    if (j.state == failed)
+        j.var->set_read_p(false);
+
+    BESDEBUG("dap", "BESDapPrefetcher::wait() - " << j.var->name() << (j.state == skipped ? " not" : "") << " prefetched" << endl);
+
+    pthread_mutex_unlock(&d_mutex);
+}
+
+/**
+ * @brief Variable i has been serialized and its data released
+ *
+ * This frees its share of the memory budget and lets the workers move on.
+ */
+void BESDapPrefetcher::done(unsigned int i)
+{
+    pthread_mutex_lock(&d_mutex);
+
+    job &j = d_jobs.at(i);
+    if (j.state == ready || j.state == failed) d_bytes_in_use -= j.bytes;
+    j.state = skipped;
+    d_current = i + 1;
+    pthread_cond_broadcast(&d_cond);
+
+    pthread_mutex_unlock(&d_mutex);
+}
@@ -0,0 +1,103 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef DAP_BESDAPPREFETCHER_H_
+#define DAP_BESDAPPREFETCHER_H_
+
+#include <pthread.h>
+
+#include <vector>
+
+namespace libdap {
+    class BaseType;
+}
+
+/**
+ * @brief Read variables on worker threads ahead of their serialization
+ *
+ * The response builder serializes the projected variables in order and
+ * each variable's serialize() method calls read() first, so reading and
+ * writing never overlap. This class reads up to 'depth' variables ahead of
+ * the one being serialized using a small pool of threads, so that the
+ * next variables are (often) in memory by the time the builder gets to
+ * them. The total size of the variables that have been read but not yet
+ * serialized is limited by 'max_bytes'; a variable that is larger than
+ * that is read by serialize() as usual.
+ *
+ * The builder must call wait(i) before serializing variable i and done(i)
+ * once that variable's data have been written and released, calling them
+ * for every variable in the vector, in order.
+ *
+ * @note Only use this with handlers whose read() methods can be run on
+ * different variables at the same time. See
+ * BESRequestHandler::set_thread_safe_read().
+ *
+ * @note If a read() on a worker thread throws an exception, the variable
+ * is left unread so that serialize() will read it again and the error will
+ * be reported on the main thread in the usual way.
+ */
+class BESDapPrefetcher {
+private:
+    enum job_state {
+        queued,     ///< Waiting for a worker thread
+        reading,    ///< Being read by a worker thread
+        ready,      ///< Read; waiting for serialization
+        failed,     ///< read() threw an exception
+        skipped     ///< Not prefetched; serialize() will read it
+    };
+
+    struct job {
+        libdap::BaseType *var;
+        unsigned long bytes;
+        job_state state;
+
+        job(libdap::BaseType *v, unsigned long b, job_state s) : var(v), bytes(b), state(s) { }
+    };
+
+    std::vector<job> d_jobs;
+    unsigned int d_depth;
+    unsigned long d_max_bytes;
+
+    unsigned int d_next;            ///< Next job a worker may start
+    unsigned int d_current;         ///< Job being serialized
+    unsigned long d_bytes_in_use;   ///< Data read but not yet serialized
+    bool d_shutdown;
+
+    pthread_mutex_t d_mutex;
+    pthread_cond_t d_cond;
+    std::vector<pthread_t> d_threads;
+
+    bool can_start();
+    void run();
+
+    static void *worker(void *arg);
+
+    BESDapPrefetcher(const BESDapPrefetcher &);
+    BESDapPrefetcher &operator=(const BESDapPrefetcher &);
+
+public:
+    BESDapPrefetcher(const std::vector<libdap::BaseType*> &vars, unsigned int depth, unsigned long max_bytes);
+    virtual ~BESDapPrefetcher();
+
+    void wait(unsigned int i);
+    void done(unsigned int i);
+};
+
+#endif /* DAP_BESDAPPREFETCHER_H_ */
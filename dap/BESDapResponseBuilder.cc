@@ -95,6 +95,8 @@
 #include "BESContextManager.h"
 #include "BESDapFunctionResponseCache.h"
 #include "BESStoredDapResultCache.h"
+#include "BESDapPrefetcher.h"
+#include "BESDapResponseCache.h"
 
 #include "BESResponseObject.h"
 #include "BESDDSResponse.h"
@@ -113,6 +115,8 @@ using namespace libdap;
 
 const string CRLF = "\r\n";             // Change here, expr-test.cc
 const string BES_KEY_TIMEOUT_CANCEL = "BES.CancelTimeoutOnSend";
+const string DAP_KEY_PREFETCH_VARIABLES = "DAP.Prefetch.Variables";
+const string DAP_KEY_PREFETCH_MAX_SIZE = "DAP.Prefetch.MaxSize";
 
 /**
  * Look up the BES Keys (parameters in the bes.conf file) that this class
@@ -129,6 +133,33 @@ void BESDapResponseBuilder::initialize()
         if (cancel_timeout_on_send == "yes" || cancel_timeout_on_send == "true")
             d_cancel_timeout_on_send = true;
     }
+
+    // Both default to zero, which turns off the prefetch feature.
+    string value;
+    TheBESKeys::TheKeys()->get_value(DAP_KEY_PREFETCH_VARIABLES, value, found);
+    if (found && !value.empty()) {
+        istringstream iss(value);
+        iss >> d_prefetch_depth;
+    }
+
+    value = "";
+    TheBESKeys::TheKeys()->get_value(DAP_KEY_PREFETCH_MAX_SIZE, value, found);
+    if (found && !value.empty()) {
+        unsigned long mb = 0;
+        istringstream iss(value);
+        iss >> mb;
+        d_prefetch_max_size = mb * 1024 * 1024;
+    }
+}
+
+/**
+ * Should variables be read on worker threads while others are being
+ * serialized? Only if the handler has said its read() methods are thread
+ * safe and both DAP.Prefetch.Variables and DAP.Prefetch.MaxSize are set.
+ */
+bool BESDapResponseBuilder::use_prefetch() const
+{
+    return d_thread_safe_read && d_prefetch_depth > 0 && d_prefetch_max_size > 0;
 }
 
 BESDapResponseBuilder::~BESDapResponseBuilder()
@@ -770,7 +801,7 @@ bool BESDapResponseBuilder::store_dap2_result(ostream &out, DDS &dds, Constraint
 void BESDapResponseBuilder::serialize_dap2_data_dds(ostream &out, DDS **dds, ConstraintEvaluator &eval, bool ce_eval)
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("BESDapResponseBuilder::serialize_dap2_data_dds", "");
+    if (BESISTIMING) sw.start("BESDapResponseBuilder::serialize_dap2_data_dds", "");
 
     BESDEBUG("dap", "BESDapResponseBuilder::serialize_dap2_data_dds() - BEGIN" << endl);
 
@@ -784,19 +815,66 @@ void BESDapResponseBuilder::serialize_dap2_data_dds(ostream &out, DDS **dds, Con
     // is set. Otherwise it does nothing.
     conditional_timeout_cancel();
 
-    // Send all variables in the current projection (send_p())
-    for (DDS::Vars_iter i = (*dds)->var_begin(); i != (*dds)->var_end(); i++) {
-        if ((*i)->send_p()) {
-            (*i)->serialize(eval, **dds, m, ce_eval);
+    if (use_prefetch()) {
+        vector<BaseType*> projected;
+        for (DDS::Vars_iter i = (*dds)->var_begin(); i != (*dds)->var_end(); i++) {
+            if ((*i)->send_p()) projected.push_back(*i);
+        }
+
+        // Read ahead while the current variable is written. The prefetcher's
+        // destructor waits for any reads in progress if serialize() throws.
+        BESDapPrefetcher prefetch(projected, d_prefetch_depth, d_prefetch_max_size);
+        for (unsigned int i = 0; i < projected.size(); ++i) {
+            prefetch.wait(i);
+            projected[i]->serialize(eval, **dds, m, ce_eval);
 #ifdef CLEAR_LOCAL_DATA
-            (*i)->clear_local_data();
+            projected[i]->clear_local_data();
 #endif
+            prefetch.done(i);
+        }
+    }
+    else {
+        // Send all variables in the current projection (send_p())
+        for (DDS::Vars_iter i = (*dds)->var_begin(); i != (*dds)->var_end(); i++) {
+            if ((*i)->send_p()) {
+                (*i)->serialize(eval, **dds, m, ce_eval);
+#ifdef CLEAR_LOCAL_DATA
+                (*i)->clear_local_data();
+#endif
+            }
         }
     }
 
     BESDEBUG("dap", "BESDapResponseBuilder::serialize_dap2_data_dds() - END" << endl);
 }
 
+/**
+ * @brief Send the BLOB part of the DAP2 data response using the response cache
+ *
+ * If the response cache is configured and holds the response for this
+ * dataset and constraint, copy it to the stream. Otherwise serialize the
+ * data, adding the response to the cache as it is sent. Only use this for
+ * constraints without server functions; those results are cached by
+ * BESDapFunctionResponseCache. Nothing is cached if the handler reads
+ * files other than the dataset (see set_use_response_cache()).
+ */
+void BESDapResponseBuilder::serialize_dap2_data_dds_cached(ostream &out, DDS **dds, ConstraintEvaluator &eval)
+{
+    BESDapResponseCache *response_cache = d_use_response_cache ? BESDapResponseCache::get_instance() : 0;
+    string resource_id =
+        response_cache ? response_cache->get_dap2_resource_id(d_dataset, get_ce(), d_explicit_container) : "";
+
+    string cache_file_name;
+    if (!resource_id.empty() && response_cache->send_cached_response(resource_id, out, cache_file_name)) {
+        BESDEBUG("dap", "BESDapResponseBuilder::serialize_dap2_data_dds_cached() - Sent cached response" << endl);
+        return;
+    }
+
+    BESDapResponseCacheWriter writer(response_cache, resource_id, cache_file_name, out);
+    serialize_dap2_data_dds(writer.stream(), dds, eval);
+    writer.commit();
+}
+
 #ifdef DAP2_STORED_RESULTS
 /**
  * Serialize a DAP3.2 DataDDX to the stream "out".
@@ -1079,10 +1157,30 @@ void BESDapResponseBuilder::send_dap2_data(ostream &data_stream, DDS **dds, Cons
             "BESDapResponseBuilder::send_dap2_data() - Found function(s) in CE: " << get_btp_func_ce() << endl);
 
         BESDapFunctionResponseCache *response_cache = BESDapFunctionResponseCache::get_instance();
+        bool cacheable = response_cache && response_cache->can_be_cached(*dds, get_btp_func_ce());
+
+        // If the whole function result is sent (nothing follows the function calls), the
+        // cache may hold the encoded response. Sending that skips reading the cached
+        // DDS and its data and serializing them again. Stored results and requests with
+        // a response limit take the long way around.
+        string data_resource_id, data_cache_file_name;
+        if (cacheable && get_ce().empty() && get_store_result().empty() && (*dds)->get_response_limit() == 0) {
+            if (with_mime_headers) {
+                set_mime_binary(data_stream, dods_data, x_plain, last_modified_time(d_dataset), (*dds)->get_dap_version());
+                with_mime_headers = false;
+            }
+
+            data_resource_id = response_cache->get_data_resource_id(*dds, get_btp_func_ce());
+            if (response_cache->send_cached_data(data_resource_id, data_stream, data_cache_file_name)) {
+                BESDEBUG("dap", "BESDapResponseBuilder::send_dap2_data() - Sent cached function result" << endl);
+                data_stream << flush;
+                return;
+            }
+        }
 
         ConstraintEvaluator func_eval;
         DDS *fdds = 0; // nulll_ptr
-        if (response_cache && response_cache->can_be_cached(*dds, get_btp_func_ce())) {
+        if (cacheable) {
             fdds = response_cache->get_or_cache_dataset(*dds, get_btp_func_ce());
         }
         else {
@@ -1115,10 +1213,14 @@ void BESDapResponseBuilder::send_dap2_data(ostream &data_stream, DDS **dds, Cons
 #if STORE_DAP2_RESULT_FEATURE
         // This means: if we are not supposed to store the result, then serialize it.
         if (!store_dap2_result(data_stream, **dds, eval)) {
-            serialize_dap2_data_dds(data_stream, dds, eval, true /* was 'false'. jhrg 3/10/15 */);
+            BESDapResponseCacheWriter writer(response_cache, data_resource_id, data_cache_file_name, data_stream);
+            serialize_dap2_data_dds(writer.stream(), dds, eval, true /* was 'false'. jhrg 3/10/15 */);
+            writer.commit();
         }
 #else
-        serialize_dap2_data_dds(data_stream, dds, eval, true /* was 'false'. jhrg 3/10/15 */);
+        BESDapResponseCacheWriter writer(response_cache, data_resource_id, data_cache_file_name, data_stream);
+        serialize_dap2_data_dds(writer.stream(), dds, eval, true /* was 'false'. jhrg 3/10/15 */);
+        writer.commit();
 #endif
 
     }
@@ -1142,10 +1244,10 @@ void BESDapResponseBuilder::send_dap2_data(ostream &data_stream, DDS **dds, Cons
 #if STORE_DAP2_RESULT_FEATURE
         // This means: if we are not supposed to store the result, then serialize it.
         if (!store_dap2_result(data_stream, **dds, eval)) {
-            serialize_dap2_data_dds(data_stream, dds, eval);
+            serialize_dap2_data_dds_cached(data_stream, dds, eval);
         }
 #else
-        serialize_dap2_data_dds(data_stream, dds, eval);
+        serialize_dap2_data_dds_cached(data_stream, dds, eval);
 #endif
     }
 
@@ -1268,7 +1370,8 @@ void BESDapResponseBuilder::send_dmr(ostream &out, DMR &dmr, bool with_mime_head
     out << xml.get_doc() << flush;
 }
 
-void BESDapResponseBuilder::send_dap4_data_using_ce(ostream &out, DMR &dmr, bool with_mime_headers)
+void BESDapResponseBuilder::send_dap4_data_using_ce(ostream &out, DMR &dmr, bool with_mime_headers,
+    bool use_response_cache)
 {
     if (!d_dap4ce.empty()) {
         D4ConstraintEvaluator parser(&dmr);
@@ -1290,7 +1393,10 @@ void BESDapResponseBuilder::send_dap4_data_using_ce(ostream &out, DMR &dmr, bool
     }
 
     if (!store_dap4_result(out, dmr)) {
-        serialize_dap4_data(out, dmr, with_mime_headers);
+        if (use_response_cache)
+            serialize_dap4_data_cached(out, dmr, with_mime_headers);
+        else
+            serialize_dap4_data(out, dmr, with_mime_headers);
     }
 }
 
@@ -1320,7 +1426,49 @@ void BESDapResponseBuilder::send_dap4_data(ostream &out, DMR &dmr, bool with_mim
         send_dap4_data_using_ce(out, function_result, with_mime_headers);
     }
     else {
-        send_dap4_data_using_ce(out, dmr, with_mime_headers);
+        send_dap4_data_using_ce(out, dmr, with_mime_headers, true /* use the response cache */);
+    }
+}
+
+/**
+ * Build the list of variables that serialize_dap4_group() will send, in
+ * the order it sends them.
+ */
+static void projected_dap4_variables(D4Group *grp, vector<BaseType*> &projected)
+{
+    for (D4Group::groupsIter g = grp->grp_begin(), ge = grp->grp_end(); g != ge; ++g)
+        projected_dap4_variables(*g, projected);
+
+    for (Constructor::Vars_iter i = grp->var_begin(), e = grp->var_end(); i != e; ++i) {
+        if ((*i)->send_p()) projected.push_back(*i);
+    }
+}
+
+/**
+ * The same as D4Group::serialize(), but wait for the prefetcher before
+ * each top-level variable and free each variable's data as soon as it has
+ * been sent.
+ *
+ * @param index The index of the next variable in the prefetcher's list
+ */
+static void serialize_dap4_group(D4Group *grp, D4StreamMarshaller &m, DMR &dmr, bool filter,
+    BESDapPrefetcher &prefetch, unsigned int &index)
+{
+    for (D4Group::groupsIter g = grp->grp_begin(), ge = grp->grp_end(); g != ge; ++g)
+        serialize_dap4_group(*g, m, dmr, filter, prefetch, index);
+
+    for (Constructor::Vars_iter i = grp->var_begin(), e = grp->var_end(); i != e; ++i) {
+        if ((*i)->send_p()) {
+            prefetch.wait(index);
+
+            m.reset_checksum();
+            (*i)->serialize(m, dmr, filter);
+            m.put_checksum();
+#ifdef CLEAR_LOCAL_DATA
+            (*i)->clear_local_data();
+#endif
+            prefetch.done(index++);
+        }
     }
 }
 
@@ -1349,7 +1497,17 @@ void BESDapResponseBuilder::serialize_dap4_data(std::ostream &out, libdap::DMR &
 
     // Write the data, chunked with checksums
     D4StreamMarshaller m(cos);
-    dmr.root()->serialize(m, dmr, !d_dap4ce.empty());
+    if (use_prefetch()) {
+        vector<BaseType*> projected;
+        projected_dap4_variables(dmr.root(), projected);
+
+        BESDapPrefetcher prefetch(projected, d_prefetch_depth, d_prefetch_max_size);
+        unsigned int index = 0;
+        serialize_dap4_group(dmr.root(), m, dmr, !d_dap4ce.empty(), prefetch, index);
+    }
+    else {
+        dmr.root()->serialize(m, dmr, !d_dap4ce.empty());
+    }
 #ifdef CLEAR_LOCAL_DATA
     dmr.root()->clear_local_data();
 #endif
@@ -1358,6 +1516,30 @@ void BESDapResponseBuilder::serialize_dap4_data(std::ostream &out, libdap::DMR &
     BESDEBUG("dap", "BESDapResponseBuilder::serialize_dap4_data() - END" << endl);
 }
 
+/**
+ * @brief Serialize the DAP4 data response using the response cache
+ *
+ * The DAP4 analog of serialize_dap2_data_dds_cached(). The MIME headers are
+ * not cached.
+ */
+void BESDapResponseBuilder::serialize_dap4_data_cached(std::ostream &out, libdap::DMR &dmr, bool with_mime_headers)
+{
+    BESDapResponseCache *response_cache = d_use_response_cache ? BESDapResponseCache::get_instance() : 0;
+    string resource_id = response_cache ? response_cache->get_dap4_resource_id(d_dataset, d_dap4ce, dmr) : "";
+
+    if (with_mime_headers) set_mime_binary(out, dap4_data, x_plain, last_modified_time(d_dataset), dmr.dap_version());
+
+    string cache_file_name;
+    if (!resource_id.empty() && response_cache->send_cached_response(resource_id, out, cache_file_name)) {
+        BESDEBUG("dap", "BESDapResponseBuilder::serialize_dap4_data_cached() - Sent cached response" << endl);
+        return;
+    }
+
+    BESDapResponseCacheWriter writer(response_cache, resource_id, cache_file_name, out);
+    serialize_dap4_data(writer.stream(), dmr, false);
+    writer.commit();
+}
+
 /**
  * Should this DAP4 result be stored and the client sent an Asynchronous response?
  * This code looks at the 'store_result' property to determine if the response should
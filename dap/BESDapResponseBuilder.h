@@ -63,6 +63,13 @@ protected:
 
 	bool d_cancel_timeout_on_send;  /// Should a timeout be cancelled once transmission starts?
 
+	bool d_thread_safe_read;        /// Can the handler's read() methods run concurrently?
+	unsigned int d_prefetch_depth;  /// Read this many variables ahead of serialization; 0 disables
+	unsigned long d_prefetch_max_size; /// Limit on the data read ahead, in bytes
+
+	bool d_use_response_cache;      /// Do the data responses depend only on d_dataset?
+	std::string d_explicit_container; /// The container that holds the DDS's variables, if containers are explicit
+
 	/**
 	 * Time, if any, that the client will wait for an async response.
 	 * An empty string (length=0) means the client didn't supply an async parameter
@@ -83,7 +90,13 @@ protected:
 	bool store_dap2_result(ostream &out, libdap::DDS &dds, libdap::ConstraintEvaluator &eval);
 #endif
 
-	void send_dap4_data_using_ce(std::ostream &out, libdap::DMR &dmr, bool with_mime_headersr);
+	void send_dap4_data_using_ce(std::ostream &out, libdap::DMR &dmr, bool with_mime_headersr,
+	    bool use_response_cache = false);
+
+	void serialize_dap2_data_dds_cached(std::ostream &out, libdap::DDS **dds, libdap::ConstraintEvaluator &eval);
+	void serialize_dap4_data_cached(std::ostream &out, libdap::DMR &dmr, bool with_mime_headers = true);
+
+	bool use_prefetch() const;
 
 public:
 
@@ -92,7 +105,8 @@ public:
 	 version information. */
 	BESDapResponseBuilder(): d_dataset(""), d_dap2ce(""), d_dap4ce(""), d_dap4function(""),
 	    d_btp_func_ce(""), d_timeout(0), d_default_protocol(DAP_PROTOCOL_VERSION),
-	    d_cancel_timeout_on_send(false), d_async_accepted(""), d_store_result("")
+	    d_cancel_timeout_on_send(false), d_thread_safe_read(false), d_prefetch_depth(0), d_prefetch_max_size(0),
+	    d_use_response_cache(true), d_explicit_container(""), d_async_accepted(""), d_store_result("")
 	{
 		initialize();
 	}
@@ -123,6 +137,41 @@ public:
 		d_btp_func_ce = _ce;
 	}
 
+	/** Set by the transmitter using the value the data handler declares.
+	 * @see BESRequestHandler::set_thread_safe_read() */
+	virtual bool get_thread_safe_read() const
+	{
+		return d_thread_safe_read;
+	}
+	virtual void set_thread_safe_read(bool ts)
+	{
+		d_thread_safe_read = ts;
+	}
+
+	/** Set by the transmitter; false if the handler reads data from files
+	 * other than d_dataset, so the response cache cannot tell when an entry
+	 * is out of date.
+	 * @see BESRequestHandler::set_reads_other_files() */
+	virtual bool get_use_response_cache() const
+	{
+		return d_use_response_cache;
+	}
+	virtual void set_use_response_cache(bool use)
+	{
+		d_use_response_cache = use;
+	}
+
+	/** Set by the transmitter when the variables of a DAP2 response are in a
+	 * Structure named for the container (dap_explicit_containers). */
+	virtual std::string get_explicit_container() const
+	{
+		return d_explicit_container;
+	}
+	virtual void set_explicit_container(const std::string &container)
+	{
+		d_explicit_container = container;
+	}
+
 	virtual std::string get_dataset_name() const;
 	virtual void set_dataset_name(const std::string _dataset);
 
@@ -0,0 +1,469 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+
+#include "config.h"
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <cstring>
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <DMR.h>
+
+#include "BESDapResponseCache.h"
+#include "Sha256.h"
+#include "BESInternalError.h"
+
+#include "BESUtil.h"
+#include "TheBESKeys.h"
+#include "BESDebug.h"
+
+#define DEBUG_KEY "response_cache"
+
+using namespace std;
+
+// If the dataset name plus constraint is longer than this, don't cache the response.
+const unsigned int max_cacheable_ce_len = 4096;
+const unsigned int max_collisions = 50;
+
+const unsigned int copy_block_size = 65536;
+
+const unsigned int default_cache_size = 20000; // 20 GB, in MB
+const string default_cache_prefix = "dr";
+const string default_cache_dir = ""; // No key, no caching
+
+const string BESDapResponseCache::PATH_KEY = "DAP.ResponseCache.path";
+const string BESDapResponseCache::PREFIX_KEY = "DAP.ResponseCache.prefix";
+const string BESDapResponseCache::SIZE_KEY = "DAP.ResponseCache.size";
+
+BESDapResponseCache *BESDapResponseCache::d_instance = 0;
+bool BESDapResponseCache::d_enabled = true;
+
+unsigned long BESDapResponseCache::get_cache_size_from_config()
+{
+    bool found;
+    string size;
+    unsigned long size_in_megabytes = default_cache_size;
+    TheBESKeys::TheKeys()->get_value(SIZE_KEY, size, found);
+    if (found) {
+        BESDEBUG(DEBUG_KEY, "BESDapResponseCache::get_cache_size_from_config(): Located BES key " << SIZE_KEY << "=" << size << endl);
+        istringstream iss(size);
+        iss >> size_in_megabytes;
+    }
+
+    return size_in_megabytes;
+}
+
+string BESDapResponseCache::get_cache_prefix_from_config()
+{
+    bool found;
+    string prefix = default_cache_prefix;
+    TheBESKeys::TheKeys()->get_value(PREFIX_KEY, prefix, found);
+    if (found) {
+        BESDEBUG(DEBUG_KEY, "BESDapResponseCache::get_cache_prefix_from_config(): Located BES key " << PREFIX_KEY << "=" << prefix << endl);
+        prefix = BESUtil::lowercase(prefix);
+    }
+
+    return prefix;
+}
+
+// If the cache directory is the empty string, the cache is turned off.
+string BESDapResponseCache::get_cache_dir_from_config()
+{
+    bool found;
+    string cache_dir = default_cache_dir;
+    TheBESKeys::TheKeys()->get_value(PATH_KEY, cache_dir, found);
+    if (found) {
+        BESDEBUG(DEBUG_KEY, "BESDapResponseCache::get_cache_dir_from_config(): Located BES key " << PATH_KEY << "=" << cache_dir << endl);
+    }
+
+    return cache_dir;
+}
+
+/**
+ * @name Get the singleton instance
+ * The first call to either 'get_instance()' method makes the instance; later
+ * calls return it. If the cache directory is empty or does not exist, return
+ * null; the cache is disabled.
+ */
+///@{
+BESDapResponseCache *
+BESDapResponseCache::get_instance(const string &cache_dir, const string &prefix, unsigned long long size)
+{
+    if (d_enabled && d_instance == 0) {
+        if (!cache_dir.empty() && dir_exists(cache_dir)) {
+            d_instance = new BESDapResponseCache(cache_dir, prefix, size);
+            d_enabled = d_instance->cache_enabled();
+            if (!d_enabled) {
+                delete d_instance;
+                d_instance = 0;
+                BESDEBUG("cache", "BESDapResponseCache::" << __func__ << "() - Cache is DISABLED" << endl);
+            }
+            else {
+#ifdef HAVE_ATEXIT
+                atexit(delete_instance);
+#endif
+                BESDEBUG("cache", "BESDapResponseCache::" << __func__ << "() - Cache is ENABLED" << endl);
+            }
+        }
+    }
+
+    BESDEBUG(DEBUG_KEY, "BESDapResponseCache::get_instance(dir,prefix,size) - d_instance: " << (void *) d_instance << endl);
+
+    return d_instance;
+}
+
+BESDapResponseCache *
+BESDapResponseCache::get_instance()
+{
+    if (d_enabled && d_instance == 0) {
+        string cache_dir = get_cache_dir_from_config();
+        if (!cache_dir.empty() && dir_exists(cache_dir))
+            return get_instance(cache_dir, get_cache_prefix_from_config(), get_cache_size_from_config());
+    }
+
+    return d_instance;
+}
+///@}
+
+/**
+ * Remove white space from a constraint, except within double quotes, so
+ * that requests which differ only in spacing share a cache entry.
+ */
+string BESDapResponseCache::normalize_ce(const string &ce)
+{
+    string normalized;
+    bool quoted = false;
+    for (string::size_type i = 0; i < ce.length(); ++i) {
+        char c = ce[i];
+        if (c == '"' && (i == 0 || ce[i - 1] != '\\')) quoted = !quoted;
+        if (!quoted && (c == ' ' || c == '\t' || c == '\n' || c == '\r')) continue;
+        normalized += c;
+    }
+
+    return normalized;
+}
+
+/**
+ * @brief Build the id for a response
+ *
+ * @param dataset Pathname to the dataset
+ * @param ce The constraint
+ * @param response_type 'dods' or 'dap', for example
+ * @return The resource id, or the empty string if the response should not
+ * be cached (the dataset is not a regular file, or the constraint is too
+ * long or contains a newline).
+ */
+string BESDapResponseCache::get_resource_id(const string &dataset, const string &ce, const string &response_type)
+{
+    struct stat buf;
+    if (stat(dataset.c_str(), &buf) != 0 || !S_ISREG(buf.st_mode)) return "";
+
+    string normalized = normalize_ce(ce);
+    if (dataset.length() + normalized.length() > max_cacheable_ce_len || normalized.find('\n') != string::npos)
+        return "";
+
+    ostringstream oss;
+    oss << response_type << "#" << dataset << "#" << buf.st_mtime << "#" << buf.st_size << "#" << normalized;
+    return oss.str();
+}
+
+/**
+ * @brief Build the id for a DAP2 data response
+ *
+ * When containers are explicit (the dap_explicit_containers or dap_format
+ * context), the variables are in a Structure named for the container and
+ * the constraint names them through it, so the name is part of the id.
+ *
+ * @param dataset Pathname to the dataset
+ * @param ce The constraint
+ * @param container The container's name if containers are explicit,
+ * otherwise empty
+ * @return The resource id, or the empty string if the response should not
+ * be cached
+ */
+string BESDapResponseCache::get_dap2_resource_id(const string &dataset, const string &ce, const string &container)
+{
+    if (container.find('\n') != string::npos) return "";
+
+    return get_resource_id(dataset, ce, "dods#" + container);
+}
+
+/**
+ * @brief Build the id for a DAP4 data response
+ *
+ * The DMR at the start of a DAP4 data response is written with the
+ * request's xml:base and DAP version, so those are part of the id; the
+ * same data requested through a different URL is a different response.
+ *
+ * @param dataset Pathname to the dataset
+ * @param ce The DAP4 constraint
+ * @param dmr The DMR that will be sent
+ * @return The resource id, or the empty string if the response should not
+ * be cached
+ */
+string BESDapResponseCache::get_dap4_resource_id(const string &dataset, const string &ce, libdap::DMR &dmr)
+{
+    string xml_base = dmr.request_xml_base();
+    if (xml_base.find('\n') != string::npos) return "";
+
+    return get_resource_id(dataset, ce, "dap#" + dmr.dap_version() + "#" + xml_base);
+}
+
+string BESDapResponseCache::get_hash_basename(const string &resource_id)
+{
+    return get_entry_basename(this, resource_id);
+}
+
+/**
+ * The base name of the entry for a resource id in any of the response
+ * caches: the SHA-256 digest of the id, prefixed by the cache directory
+ * and prefix. Collisions are resolved by appending '_N' to this name.
+ */
+string BESDapResponseCache::get_entry_basename(BESFileLockingCache *cache, const string &resource_id)
+{
+    return cache->get_cache_file_name(Sha256::hex_digest(resource_id), false);
+}
+
+/**
+ * Write the body of a locked entry - everything after the first line - to
+ * a stream. The entry is mapped into memory and written with one call, so
+ * the data are not copied through an intermediate buffer; if it cannot be
+ * mapped, it is read in blocks.
+ *
+ * @return False if the first line of the entry is not resource_id
+ */
+static bool write_entry_body(int fd, const string &entry_name, const string &resource_id, ostream &out)
+{
+    struct stat buf;
+    if (fstat(fd, &buf) != 0 || buf.st_size == 0) return false;
+
+    size_t size = buf.st_size;
+    void *map = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map != MAP_FAILED) {
+        const char *data = static_cast<const char*>(map);
+        const char *eol = static_cast<const char*>(memchr(data, '\n', size));
+        bool match = eol && string(data, eol - data) == resource_id;
+        if (match) {
+            try {
+                out.write(eol + 1, data + size - (eol + 1));
+            }
+            catch (...) {
+                munmap(map, size);
+                throw;
+            }
+        }
+        munmap(map, size);
+        return match;
+    }
+
+    ifstream entry(entry_name.c_str(), ios::in | ios::binary);
+    string cached_resource_id;
+    getline(entry, cached_resource_id);
+    if (!entry || cached_resource_id != resource_id) return false;
+
+    vector<char> block(copy_block_size);
+    while (entry.read(&block[0], block.size()) || entry.gcount() > 0)
+        out.write(&block[0], entry.gcount());
+
+    return true;
+}
+
+/**
+ * @brief If the response is cached, write it to a stream
+ *
+ * @param resource_id From get_resource_id()
+ * @param out Write the response body here
+ * @param cache_file_name Value-result parameter; on a miss, the name to
+ * use for the new entry
+ * @return True if the response was found and written, false otherwise
+ */
+bool BESDapResponseCache::send_cached_response(const string &resource_id, ostream &out, string &cache_file_name)
+{
+    return send_cached_entry(this, resource_id, out, cache_file_name);
+}
+
+/**
+ * @brief Find the entry for a resource id in a cache and write its body
+ *
+ * This is send_cached_response() for any BESFileLockingCache, so that
+ * other caches (e.g., BESDapFunctionResponseCache) can store responses in
+ * the same format and use BESDapResponseCacheWriter to build them.
+ *
+ * @param cache The cache to search
+ * @param resource_id The entry's first line must match this
+ * @param out Write the response body here
+ * @param cache_file_name Value-result parameter; on a miss, the name to
+ * use for the new entry. Empty if there were too many collisions.
+ * @return True if the response was found and written, false otherwise
+ */
+bool BESDapResponseCache::send_cached_entry(BESFileLockingCache *cache, const string &resource_id, ostream &out,
+    string &cache_file_name)
+{
+    string basename = get_entry_basename(cache, resource_id);
+
+    for (unsigned long suffix = 0; suffix <= max_collisions; ++suffix) {
+        ostringstream cfname;
+        cfname << basename << "_" << suffix;
+
+        int fd;
+        if (!cache->get_read_lock(cfname.str(), fd)) {
+            // No such entry; use this name for the new one
+            cache_file_name = cfname.str();
+            BESDEBUG(DEBUG_KEY, "BESDapResponseCache::send_cached_entry() - MISS for: " << resource_id << endl);
+            return false;
+        }
+
+        try {
+            if (write_entry_body(fd, cfname.str(), resource_id, out)) {
+                BESDEBUG(DEBUG_KEY, "BESDapResponseCache::send_cached_entry() - HIT: " << cfname.str() << endl);
+                cache->unlock_and_close(cfname.str());
+                return true;
+            }
+        }
+        catch (...) {
+            cache->unlock_and_close(cfname.str());
+            throw;
+        }
+
+        cache->unlock_and_close(cfname.str());
+    }
+
+    // Too many collisions; don't cache this response.
+    BESDEBUG(DEBUG_KEY, "BESDapResponseCache::send_cached_entry() - Too many collisions for: " << resource_id << endl);
+    cache_file_name = "";
+    return false;
+}
+
+BESDapResponseCacheWriter::tee_buf::int_type BESDapResponseCacheWriter::tee_buf::overflow(int_type c)
+{
+    if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+
+    if (d_copy_ok && traits_type::eq_int_type(d_copy->sputc(traits_type::to_char_type(c)), traits_type::eof()))
+        d_copy_ok = false;
+
+    return d_out->sputc(traits_type::to_char_type(c));
+}
+
+streamsize BESDapResponseCacheWriter::tee_buf::xsputn(const char *s, streamsize n)
+{
+    if (d_copy_ok && d_copy->sputn(s, n) != n) d_copy_ok = false;
+
+    return d_out->sputn(s, n);
+}
+
+int BESDapResponseCacheWriter::tee_buf::sync()
+{
+    if (d_copy_ok && d_copy->pubsync() == -1) d_copy_ok = false;
+
+    return d_out->pubsync();
+}
+
+/**
+ * @param cache The cache; if null, nothing is cached
+ * @param resource_id From BESDapResponseCache::get_resource_id(); if
+ * empty, nothing is cached
+ * @param cache_file_name From BESDapResponseCache::send_cached_response()
+ * or send_cached_entry()
+ * @param client The client's stream
+ */
+BESDapResponseCacheWriter::BESDapResponseCacheWriter(BESFileLockingCache *cache, const string &resource_id,
+    const string &cache_file_name, ostream &client) :
+    d_cache(cache), d_cache_file_name(cache_file_name), d_fd(-1), d_caching(false), d_client(client), d_tee_buf(0),
+    d_tee(0)
+{
+    if (!d_cache || resource_id.empty() || d_cache_file_name.empty()) return;
+
+    // If another process is building this entry, just send the response.
+    if (!d_cache->create_and_lock(d_cache_file_name, d_fd)) return;
+
+    d_entry.open(d_cache_file_name.c_str(), ios::out | ios::app | ios::binary);
+    if (!d_entry.is_open()) {
+        d_cache->purge_file(d_cache_file_name);
+        d_cache->unlock_and_close(d_cache_file_name);
+        return;
+    }
+
+    d_entry << resource_id << endl;
+
+    d_tee_buf = new tee_buf(d_client.rdbuf(), d_entry.rdbuf());
+    d_tee = new ostream(d_tee_buf);
+    d_caching = true;
+
+    BESDEBUG(DEBUG_KEY, "BESDapResponseCacheWriter - caching " << resource_id << " in " << d_cache_file_name << endl);
+}
+
+BESDapResponseCacheWriter::~BESDapResponseCacheWriter()
+{
+    if (d_caching) abandon();
+
+    delete d_tee;
+    delete d_tee_buf;
+}
+
+/// Remove a partial entry
+void BESDapResponseCacheWriter::abandon()
+{
+    d_caching = false;
+    d_entry.close();
+    d_cache->purge_file(d_cache_file_name);
+    d_cache->unlock_and_close(d_cache_file_name);
+}
+
+/**
+ * @brief The response is complete; add the entry to the cache
+ *
+ * Errors writing the entry or sending the response to the client mean
+ * the entry is not kept.
+ */
+void BESDapResponseCacheWriter::commit()
+{
+    if (!d_caching) return;
+
+    d_tee->flush();
+    d_entry.close();
+
+    if (!d_tee_buf->copy_ok() || d_entry.fail() || !*d_tee) {
+        BESDEBUG(DEBUG_KEY, "BESDapResponseCacheWriter::commit() - Could not write " << d_cache_file_name << endl);
+        abandon();
+        return;
+    }
+
+    d_caching = false;
+
+    // As in BESDapFunctionResponseCache::write_dataset_to_cache(): keep others from
+    // purging the new file, then update the cache size and purge if needed.
+    d_cache->exclusive_to_shared_lock(d_fd);
+
+    unsigned long long size = d_cache->update_cache_info(d_cache_file_name);
+    if (d_cache->cache_too_big(size)) d_cache->update_and_purge(d_cache_file_name);
+
+    d_cache->unlock_and_close(d_cache_file_name);
+}
@@ -0,0 +1,180 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _bes_dap_response_cache_h
+#define _bes_dap_response_cache_h
+
+#include <string>
+#include <fstream>
+#include <streambuf>
+
+#include "BESFileLockingCache.h"
+
+namespace libdap {
+class DMR;
+}
+
+/**
+ * @brief Cache whole DAP2 and DAP4 data responses.
+ *
+ * Clients often repeat the same subset request (the same dataset and
+ * constraint) many times. This cache stores the body of the data response
+ * - everything after the MIME headers - so that a repeated request can be
+ * answered by copying a file instead of reading and encoding the data again.
+ *
+ * Entries are identified by a resource id built from the response type, the
+ * dataset's pathname, its modification time and size, and the constraint
+ * with the white space removed. DAP2 ids also hold the container name when
+ * containers are explicit, and DAP4 ids the DMR attributes that come from
+ * the request (xml:base and the DAP version), since the DMR is part of the
+ * cached response. Because the dataset's modification time is part of the
+ * id, a changed dataset never matches an old entry; those are removed when
+ * the cache is purged. So only use the cache for handlers whose responses
+ * come from the dataset file alone (see
+ * BESRequestHandler::get_reads_other_files()).
+ *
+ * @note Cache entry format: The resource id is the first line of the
+ * entry, followed by the response body exactly as it was sent.
+ *
+ * @note Cache entry names: The SHA-256 digest of the resource id is the
+ * file name and a suffix is appended to resolve collisions; the first line
+ * of each entry is checked to find the correct one.
+ *
+ * @see BESDapResponseCacheWriter
+ */
+class BESDapResponseCache: public BESFileLockingCache {
+private:
+    static bool d_enabled;
+    static BESDapResponseCache *d_instance;
+
+    /**
+     * Called by atexit()
+     */
+    static void delete_instance() {
+        delete d_instance;
+        d_instance = 0;
+    }
+
+    BESDapResponseCache();
+    BESDapResponseCache(const BESDapResponseCache &src);
+
+    std::string get_hash_basename(const std::string &resource_id);
+
+    friend class ResponseCacheTest;
+
+protected:
+    BESDapResponseCache(const std::string &cache_dir, const std::string &prefix, unsigned long long size) :
+        BESFileLockingCache(cache_dir, prefix, size)
+    {
+    }
+
+public:
+    static const std::string PATH_KEY;
+    static const std::string PREFIX_KEY;
+    static const std::string SIZE_KEY;
+
+    static BESDapResponseCache *get_instance(const std::string &cache_dir, const std::string &prefix,
+        unsigned long long size);
+    static BESDapResponseCache *get_instance();
+
+    virtual ~BESDapResponseCache()
+    {
+    }
+
+    static std::string normalize_ce(const std::string &ce);
+
+    virtual std::string get_resource_id(const std::string &dataset, const std::string &ce,
+        const std::string &response_type);
+    virtual std::string get_dap2_resource_id(const std::string &dataset, const std::string &ce,
+        const std::string &container);
+    virtual std::string get_dap4_resource_id(const std::string &dataset, const std::string &ce, libdap::DMR &dmr);
+
+    virtual bool send_cached_response(const std::string &resource_id, std::ostream &out,
+        std::string &cache_file_name);
+
+    static std::string get_entry_basename(BESFileLockingCache *cache, const std::string &resource_id);
+    static bool send_cached_entry(BESFileLockingCache *cache, const std::string &resource_id, std::ostream &out,
+        std::string &cache_file_name);
+
+    static std::string get_cache_dir_from_config();
+    static std::string get_cache_prefix_from_config();
+    static unsigned long get_cache_size_from_config();
+};
+
+/**
+ * @brief Write a response to a client and to a new cache entry at once
+ *
+ * Make an instance with the resource id and the entry name from a cache
+ * miss, write the response to stream() and call commit(). If the entry
+ * cannot be made (e.g., another process is building it) or the cache is
+ * null, stream() is just the client's stream. If commit() is not called
+ * (because serialization threw an exception), the partial entry is removed
+ * by the destructor.
+ */
+class BESDapResponseCacheWriter {
+private:
+    // Send output to two stream buffers. Errors writing the cache entry
+    // stop the copy to the entry; they are not reported to the writer.
+    class tee_buf: public std::streambuf {
+        std::streambuf *d_out;
+        std::streambuf *d_copy;
+        bool d_copy_ok;
+
+    protected:
+        virtual int_type overflow(int_type c);
+        virtual std::streamsize xsputn(const char *s, std::streamsize n);
+        virtual int sync();
+
+    public:
+        tee_buf(std::streambuf *out, std::streambuf *copy) : d_out(out), d_copy(copy), d_copy_ok(true) { }
+        bool copy_ok() const { return d_copy_ok; }
+    };
+
+    BESFileLockingCache *d_cache;
+    std::string d_cache_file_name;
+    int d_fd;
+    bool d_caching;
+
+    std::ostream &d_client;
+    std::ofstream d_entry;
+    tee_buf *d_tee_buf;
+    std::ostream *d_tee;
+
+    void abandon();
+
+    BESDapResponseCacheWriter(const BESDapResponseCacheWriter &);
+    BESDapResponseCacheWriter &operator=(const BESDapResponseCacheWriter &);
+
+public:
+    BESDapResponseCacheWriter(BESFileLockingCache *cache, const std::string &resource_id,
+        const std::string &cache_file_name, std::ostream &client);
+    virtual ~BESDapResponseCacheWriter();
+
+    /// @return The stream to use for the response
+    std::ostream &stream() { return d_caching ? *d_tee : d_client; }
+
+    void commit();
+};
+
+#endif // _bes_dap_response_cache_h
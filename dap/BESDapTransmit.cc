@@ -55,6 +55,8 @@
 #include "BESDebug.h"
 
 #include "BESDapResponseBuilder.h"
+#include "BESRequestHandlerList.h"
+#include "BESRequestHandler.h"
 
 using namespace libdap;
 using namespace std;
@@ -114,6 +116,24 @@ public:
         return print_mime;
     }
 
+    // Has the handler for the current container said its read() methods
+    // can be run concurrently? Call after dhi.first_container().
+    bool handler_read_is_thread_safe(BESDataHandlerInterface &dhi) const
+    {
+        if (!dhi.container) return false;
+        BESRequestHandler *rh = BESRequestHandlerList::TheList()->find_handler(dhi.container->get_container_type());
+        return rh && rh->get_thread_safe_read();
+    }
+
+    // Can the data responses for the current container be cached using the
+    // container's file alone? Call after dhi.first_container().
+    bool handler_response_is_cacheable(BESDataHandlerInterface &dhi) const
+    {
+        if (!dhi.container) return false;
+        BESRequestHandler *rh = BESRequestHandlerList::TheList()->find_handler(dhi.container->get_container_type());
+        return rh && !rh->get_reads_other_files();
+    }
+
 private:
 
     // Name of the request being sent, for debug
@@ -201,6 +221,10 @@ private:
         BESDapResponseBuilder rb;
         rb.set_dataset_name(dds->filename());
         rb.set_ce(dhi.data[POST_CONSTRAINT]);
+        rb.set_thread_safe_read(handler_read_is_thread_safe(dhi));
+        rb.set_use_response_cache(handler_response_is_cacheable(dhi));
+        if (dhi.container && bdds->get_explicit_containers())
+            rb.set_explicit_container(dhi.container->get_symbolic_name());
 
         rb.set_async_accepted(dhi.data[ASYNC]);
         rb.set_store_result(dhi.data[STORE_RESULT]);
@@ -292,6 +316,8 @@ private:
 
         BESDapResponseBuilder rb;
         rb.set_dataset_name(dmr->filename());
+        rb.set_thread_safe_read(handler_read_is_thread_safe(dhi));
+        rb.set_use_response_cache(handler_response_is_cacheable(dhi));
 
         rb.set_dap4ce(dhi.data[DAP4_CONSTRAINT]);
         rb.set_dap4function(dhi.data[DAP4_FUNCTION]);
@@ -35,6 +35,7 @@
 #include "BESDataDDXResponseHandler.h"
 #include "BESDataDDSResponse.h"
 #include "BESRequestHandlerList.h"
+#include "BESDapBatchCache.h"
 #include "BESDapNames.h"
 #include "BESDataNames.h"
 
@@ -93,6 +94,10 @@ BESDataDDXResponseHandler::execute( BESDataHandlerInterface &dhi )
     // Set the DAP protocol version requested by the client. 2/25/11 jhrg
 
     dhi.first_container();
+
+    // In a batch, another command may have built this container's DDS
+    bool built = BESDapBatchCache::get_dds( dhi, bdds, dds ) ;
+
     BESDEBUG("version", "Initial CE: " << dhi.container->get_constraint() << endl);
     dhi.container->set_constraint(dds->get_keywords().parse_keywords(dhi.container->get_constraint()));
     BESDEBUG("version", "CE after keyword processing: " << dhi.container->get_constraint() << endl);
@@ -107,7 +112,15 @@ BESDataDDXResponseHandler::execute( BESDataHandlerInterface &dhi )
 
     dds->set_request_xml_base( bdds->get_request_xml_base() );
 
-    BESRequestHandlerList::TheList()->execute_each( dhi ) ;
+    if( built )
+    {
+	bdds->set_constraint( dhi ) ;
+    }
+    else
+    {
+	BESRequestHandlerList::TheList()->execute_each( dhi ) ;
+	BESDapBatchCache::add_dds( dhi, bdds, bdds->get_dds() ) ;
+    }
 
     // we've got what we want, now set the action back to data ddx
     dhi.action = DATADDX_RESPONSE ;
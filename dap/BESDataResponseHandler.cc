@@ -40,6 +40,7 @@
 #include "BESDataResponseHandler.h"
 #include "BESDataDDSResponse.h"
 #include "BESRequestHandlerList.h"
+#include "BESDapBatchCache.h"
 #include "BESDapNames.h"
 #include "BESDataNames.h"
 #include "BESContextManager.h"
@@ -84,6 +85,9 @@ void BESDataResponseHandler::execute(BESDataHandlerInterface &dhi)
 
     dhi.first_container();
 
+    // In a batch, another command may have built this container's DDS
+    bool built = BESDapBatchCache::get_dds(dhi, bdds, dds);
+
     BESDEBUG("version", "Initial CE: " << dhi.container->get_constraint() << endl);
 
     // FIXME Keywords should not be used and this should be removed. jhrg 2/20/15
@@ -116,7 +120,14 @@ void BESDataResponseHandler::execute(BESDataHandlerInterface &dhi)
     }
 
     _response = bdds;
-    BESRequestHandlerList::TheList()->execute_each(dhi);
+
+    if (built) {
+        bdds->set_constraint(dhi);
+    }
+    else {
+        BESRequestHandlerList::TheList()->execute_each(dhi);
+        BESDapBatchCache::add_dds(dhi, bdds, bdds->get_dds());
+    }
 }
 
 /** @brief transmit the response object built by the execute command
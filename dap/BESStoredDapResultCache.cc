@@ -69,6 +69,7 @@
 
 #include "BESStoredDapResultCache.h"
 #include "BESDapResponseBuilder.h"
+#include "BESDapJobRunner.h"
 #include "BESInternalError.h"
 
 #include "BESUtil.h"
@@ -733,6 +734,32 @@ string BESStoredDapResultCache::get_stored_result_local_id(const string &dataset
 }
 
 /**
+ * A background job that writes a DAP4 data response.
+ */
+class Dap4ResultJob: public BESDapJobRunner::Job {
+    DMR &d_dmr;
+    BESDapResponseBuilder *d_rb;
+
+public:
+    Dap4ResultJob(DMR &dmr, BESDapResponseBuilder *rb) : d_dmr(dmr), d_rb(rb) { }
+    virtual ~Dap4ResultJob() { }
+
+    virtual void run(ostream &out)
+    {
+        try {
+            d_rb->serialize_dap4_data(out, d_dmr, false);
+        }
+        catch (Error &e) {
+            throw BESInternalError(e.get_error_message(), __FILE__, __LINE__);
+        }
+    }
+};
+
+/**
+ * Store a DAP4 data response. If background jobs are configured (see
+ * BESDapJobRunner), the response is written by a job process and this
+ * returns as soon as that job is queued; otherwise it is written before
+ * this returns.
  *
  * @return The local ID (relative to the BES data root directory) of the stored dataset.
  */
@@ -760,10 +787,21 @@ string BESStoredDapResultCache::store_dap4_result(DMR &dmr, const string &constr
             purge_file(cache_file_name);
         }
 
+        BESDapJobRunner *jobs = BESDapJobRunner::get_instance(BESUtil::assemblePath(get_cache_directory(), "jobs"));
+        Dap4ResultJob job(dmr, rb);
+        string job_id = cache_file_name.substr(cache_file_name.find_last_of('/') + 1);
+
         if (get_read_lock(cache_file_name, fd)) {
             BESDEBUG("cache",
                 "BESStoredDapResultCache::store_dap4_result() - Stored Result already exists. Not rewriting file: " << cache_file_name << endl);
         }
+        else if (jobs && jobs->submit(job_id, job, dmr.request_size(true) * 1024ULL /* KB */, this,
+            cache_file_name)) {
+            // Nothing is locked here; the job process adds the result to the cache.
+            BESDEBUG("cache",
+                "BESStoredDapResultCache::store_dap4_result() - Queued a job to write: " << cache_file_name << endl);
+            return local_id;
+        }
         else if (create_and_lock(cache_file_name, fd)) {
             // If here, the cache_file_name could not be locked for read access;
             // try to build it. First make an empty file and get an exclusive lock on it.
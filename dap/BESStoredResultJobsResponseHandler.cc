@@ -0,0 +1,143 @@
+// BESStoredResultJobsResponseHandler.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sstream>
+#include <vector>
+#include <map>
+
+#include "BESStoredResultJobsResponseHandler.h"
+#include "BESStoredDapResultCache.h"
+#include "BESDapJobRunner.h"
+#include "BESDapNames.h"
+#include "BESInfo.h"
+#include "BESInfoList.h"
+#include "BESInternalError.h"
+#include "BESUtil.h"
+
+using namespace std;
+
+BESStoredResultJobsResponseHandler::BESStoredResultJobsResponseHandler(const string &name) :
+    BESResponseHandler(name)
+{
+}
+
+BESStoredResultJobsResponseHandler::~BESStoredResultJobsResponseHandler()
+{
+}
+
+/** @brief executes the command 'show storedResultJobs;'
+ *
+ * Each job is a 'job' element whose value is the job's id (the name of the
+ * stored result it builds) and whose attributes are the fields of its
+ * status record. If stored results or background jobs are not configured,
+ * there are no 'job' elements.
+ *
+ * @param dhi structure that holds request and response information
+ * @see BESDataHandlerInterface
+ * @see BESInfo
+ * @see BESDapJobRunner::Status
+ */
+void BESStoredResultJobsResponseHandler::execute(BESDataHandlerInterface &dhi)
+{
+    BESInfo *info = BESInfoList::TheList()->build_info();
+    _response = info;
+
+    dhi.action_name = SHOW_STORED_RESULT_JOBS_STR;
+    info->begin_response(SHOW_STORED_RESULT_JOBS_STR, dhi);
+
+    BESStoredDapResultCache *cache = BESStoredDapResultCache::get_instance();
+    BESDapJobRunner *jobs =
+        cache ? BESDapJobRunner::get_instance(BESUtil::assemblePath(cache->get_cache_directory(), "jobs")) : 0;
+    if (jobs) {
+        vector<string> job_ids;
+        jobs->get_job_ids(job_ids);
+        for (vector<string>::const_iterator i = job_ids.begin(), e = job_ids.end(); i != e; ++i) {
+            BESDapJobRunner::Status status;
+            if (!jobs->get_status(*i, status)) continue;   // removed since it was listed
+
+            ostringstream pid, submitted, started, finished, estimated_bytes, bytes;
+            pid << status.pid;
+            submitted << status.submitted;
+            started << status.started;
+            finished << status.finished;
+            estimated_bytes << status.estimated_bytes;
+            bytes << status.bytes;
+
+            map<string, string> attrs;
+            attrs["state"] = status.state;
+            attrs["lane"] = status.lane;
+            attrs["pid"] = pid.str();
+            attrs["submitted"] = submitted.str();
+            attrs["started"] = started.str();
+            attrs["finished"] = finished.str();
+            attrs["estimated_bytes"] = estimated_bytes.str();
+            attrs["bytes"] = bytes.str();
+            if (!status.message.empty()) attrs["message"] = status.message;
+
+            info->add_tag("job", *i, &attrs);
+        }
+    }
+
+    info->end_response();
+}
+
+/** @brief transmit the response object built by the execute command
+ * using the specified transmitter object
+ *
+ * @param transmitter object that knows how to transmit specific basic types
+ * @param dhi structure that holds the request and response information
+ * @see BESInfo
+ * @see BESTransmitter
+ * @see BESDataHandlerInterface
+ */
+void BESStoredResultJobsResponseHandler::transmit(BESTransmitter *transmitter, BESDataHandlerInterface &dhi)
+{
+    if (_response) {
+        BESInfo *info = dynamic_cast<BESInfo *>(_response);
+        if (!info) throw BESInternalError("cast error", __FILE__, __LINE__);
+        info->transmit(transmitter, dhi);
+    }
+}
+
+/** @brief dumps information about this object
+ *
+ * Displays the pointer value of this instance
+ *
+ * @param strm C++ i/o stream to dump the information to
+ */
+void BESStoredResultJobsResponseHandler::dump(ostream &strm) const
+{
+    strm << BESIndent::LMarg << "BESStoredResultJobsResponseHandler::dump - (" << (void *) this << ")" << endl;
+    BESIndent::Indent();
+    BESResponseHandler::dump(strm);
+    BESIndent::UnIndent();
+}
+
+BESResponseHandler *
+BESStoredResultJobsResponseHandler::StoredResultJobsResponseBuilder(const string &name)
+{
+    return new BESStoredResultJobsResponseHandler(name);
+}
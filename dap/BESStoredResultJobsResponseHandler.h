@@ -0,0 +1,52 @@
+// BESStoredResultJobsResponseHandler.h
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef I_BESStoredResultJobsResponseHandler_h
+#define I_BESStoredResultJobsResponseHandler_h 1
+
+#include "BESResponseHandler.h"
+
+/** @brief response handler that lists the stored result jobs
+ *
+ * A request 'show storedResultJobs;' will be handled by this response
+ * handler. It returns the status record of each job run by
+ * BESDapJobRunner in an informational response object.
+ *
+ * @see BESDapJobRunner
+ * @see BESInfo
+ */
+class BESStoredResultJobsResponseHandler: public BESResponseHandler {
+public:
+    BESStoredResultJobsResponseHandler(const string &name);
+    virtual ~BESStoredResultJobsResponseHandler();
+
+    virtual void execute(BESDataHandlerInterface &dhi);
+    virtual void transmit(BESTransmitter *transmitter, BESDataHandlerInterface &dhi);
+
+    virtual void dump(ostream &strm) const;
+
+    static BESResponseHandler *StoredResultJobsResponseBuilder(const string &name);
+};
+
+#endif // I_BESStoredResultJobsResponseHandler_h
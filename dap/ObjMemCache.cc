@@ -35,6 +35,7 @@
 #include <InternalErr.h>
 
 #include "ObjMemCache.h"
+#include "BESMetrics.h"
 
 // using namespace bes {
 
@@ -135,6 +136,8 @@ DapObj *ObjMemCache::get(const string &key)
         index.insert(index_pair_t(key, d_age));
     }
 
+    BESMetrics::count(cached_obj ? "bes_objmemcache_hits_total" : "bes_objmemcache_misses_total");
+
     return cached_obj;
 }
 
@@ -158,6 +161,8 @@ void ObjMemCache::purge(float fraction)
         assert(pos != index.end());
         index.erase(pos);
     }
+
+    BESMetrics::count("bes_objmemcache_evictions_total", num_remove);
 }
 
 // } namespace bes
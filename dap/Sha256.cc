@@ -0,0 +1,168 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cstring>
+#include <string>
+
+#include "Sha256.h"
+#include "BESInternalError.h"
+
+using namespace std;
+
+static const uint32_t k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t rotr(uint32_t x, unsigned int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+Sha256::Sha256() : d_length(0), d_block_used(0), d_finished(false)
+{
+    d_state[0] = 0x6a09e667;
+    d_state[1] = 0xbb67ae85;
+    d_state[2] = 0x3c6ef372;
+    d_state[3] = 0xa54ff53a;
+    d_state[4] = 0x510e527f;
+    d_state[5] = 0x9b05688c;
+    d_state[6] = 0x1f83d9ab;
+    d_state[7] = 0x5be0cd19;
+}
+
+// Process one 64-byte block
+void Sha256::transform(const unsigned char *block)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i)
+        w[i] = (uint32_t(block[i * 4]) << 24) | (uint32_t(block[i * 4 + 1]) << 16)
+            | (uint32_t(block[i * 4 + 2]) << 8) | uint32_t(block[i * 4 + 3]);
+
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = d_state[0], b = d_state[1], c = d_state[2], d = d_state[3];
+    uint32_t e = d_state[4], f = d_state[5], g = d_state[6], h = d_state[7];
+
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    d_state[0] += a;
+    d_state[1] += b;
+    d_state[2] += c;
+    d_state[3] += d;
+    d_state[4] += e;
+    d_state[5] += f;
+    d_state[6] += g;
+    d_state[7] += h;
+}
+
+/**
+ * Add data to the digest.
+ * @exception BESInternalError if called after hex_digest()
+ */
+void Sha256::update(const void *data, size_t length)
+{
+    if (d_finished) throw BESInternalError("Sha256: update() called after hex_digest().", __FILE__, __LINE__);
+
+    const unsigned char *p = static_cast<const unsigned char*>(data);
+    d_length += length;
+
+    while (length > 0) {
+        size_t n = min(length, size_t(64 - d_block_used));
+        memcpy(d_block + d_block_used, p, n);
+        d_block_used += n;
+        p += n;
+        length -= n;
+
+        if (d_block_used == 64) {
+            transform(d_block);
+            d_block_used = 0;
+        }
+    }
+}
+
+/**
+ * Finish the digest.
+ * @return The 64 character, lower case, hexadecimal digest.
+ */
+string Sha256::hex_digest()
+{
+    if (!d_finished) {
+        uint64_t bit_length = d_length * 8;
+
+        // Pad with 0x80, then zeros up to 56 bytes mod 64, then the length.
+        d_block[d_block_used++] = 0x80;
+        if (d_block_used > 56) {
+            memset(d_block + d_block_used, 0, 64 - d_block_used);
+            transform(d_block);
+            d_block_used = 0;
+        }
+        memset(d_block + d_block_used, 0, 56 - d_block_used);
+        for (int i = 0; i < 8; ++i)
+            d_block[56 + i] = static_cast<unsigned char>(bit_length >> (56 - i * 8));
+        transform(d_block);
+
+        d_finished = true;
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    string digest;
+    for (int i = 0; i < 8; ++i) {
+        for (int shift = 28; shift >= 0; shift -= 4)
+            digest += hex[(d_state[i] >> shift) & 0xf];
+    }
+
+    return digest;
+}
+
+/// @return The SHA-256 digest of \c data as 64 hexadecimal characters
+string Sha256::hex_digest(const string &data)
+{
+    Sha256 sha;
+    sha.update(data);
+    return sha.hex_digest();
+}
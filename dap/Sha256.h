@@ -0,0 +1,68 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _sha256_h
+#define _sha256_h
+
+#include <stdint.h>
+
+#include <string>
+
+/**
+ * @brief The SHA-256 message digest (FIPS 180-4)
+ *
+ * The response caches use this to name their entries. The std::hash
+ * values used before are only 64 bits wide and are not designed to
+ * avoid collisions, so different constraints on the same dataset could
+ * (and, given enough entries, did) share a cache file name.
+ *
+ * Either add data with update() and then call hex_digest() once, or use
+ * the static hex_digest(const std::string &).
+ */
+class Sha256 {
+private:
+    uint32_t d_state[8];
+    uint64_t d_length;          // bytes added so far
+    unsigned char d_block[64];
+    unsigned int d_block_used;
+    bool d_finished;
+
+    void transform(const unsigned char *block);
+
+    Sha256(const Sha256 &);
+    Sha256 &operator=(const Sha256 &);
+
+public:
+    Sha256();
+    virtual ~Sha256() { }
+
+    void update(const void *data, size_t length);
+    void update(const std::string &data) { update(data.data(), data.length()); }
+
+    std::string hex_digest();
+
+    static std::string hex_digest(const std::string &data);
+};
+
+#endif // _sha256_h
@@ -0,0 +1,280 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <GetOpt.h>
+
+#include <DDS.h>
+#include <DMR.h>
+#include <D4Group.h>
+#include <Int32.h>
+
+#include <debug.h>
+
+#include "BESContainer.h"
+#include "BESDataHandlerInterface.h"
+#include "BESRequestHandler.h"
+#include "BESRequestHandlerList.h"
+#include "BESDataNames.h"
+#include "BESDapNames.h"
+#include "BESDDSResponse.h"
+#include "BESDataDDSResponse.h"
+#include "BESDMRResponse.h"
+#include "BESDDSResponseHandler.h"
+#include "BESDataResponseHandler.h"
+#include "BESDMRResponseHandler.h"
+#include "BESDap4ResponseHandler.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static const string handler_name = "batch_cache_test";
+
+/// A container that needs no file
+class TestContainer: public BESContainer {
+public:
+    TestContainer(const string &sym_name) :
+        BESContainer(sym_name, "/dev/null", handler_name)
+    {
+    }
+
+    virtual BESContainer *ptr_duplicate()
+    {
+        return new TestContainer(*this);
+    }
+
+    virtual string access()
+    {
+        return get_real_name();
+    }
+
+    virtual bool release()
+    {
+        return true;
+    }
+};
+
+/// A request handler that counts how often it opens the 'dataset'
+class CountingRequestHandler: public BESRequestHandler {
+public:
+    static int opens;
+
+    CountingRequestHandler() :
+        BESRequestHandler(handler_name)
+    {
+        add_handler(DDS_RESPONSE, build_dds);
+        add_handler(DATA_RESPONSE, build_data);
+        add_handler(DMR_RESPONSE, build_dmr);
+        add_handler(DAP4DATA_RESPONSE, build_dmr);
+    }
+
+    static void add_vars(DDS *dds)
+    {
+        ++opens;
+        Int32 var("counted");
+        dds->add_var(&var);
+    }
+
+    static bool build_dds(BESDataHandlerInterface &dhi)
+    {
+        BESDDSResponse *bdds = dynamic_cast<BESDDSResponse *>(dhi.response_handler->get_response_object());
+        add_vars(bdds->get_dds());
+        bdds->set_constraint(dhi);
+        return true;
+    }
+
+    static bool build_data(BESDataHandlerInterface &dhi)
+    {
+        BESDataDDSResponse *bdds = dynamic_cast<BESDataDDSResponse *>(dhi.response_handler->get_response_object());
+        add_vars(bdds->get_dds());
+        bdds->set_constraint(dhi);
+        return true;
+    }
+
+    static bool build_dmr(BESDataHandlerInterface &dhi)
+    {
+        ++opens;
+        BESDMRResponse *bdmr = dynamic_cast<BESDMRResponse *>(dhi.response_handler->get_response_object());
+        Int32 var("counted");
+        bdmr->get_dmr()->root()->add_var(&var);
+        bdmr->set_dap4_constraint(dhi);
+        bdmr->set_dap4_function(dhi);
+        return true;
+    }
+};
+
+int CountingRequestHandler::opens = 0;
+
+class BatchCacheTest: public TestFixture {
+private:
+    TestContainer *d_container;
+
+    /// Run a response handler for d_container, the way one command would
+    void execute(BESResponseHandler &rh, bool batched)
+    {
+        BESDataHandlerInterface dhi;
+        dhi.containers.push_back(d_container);
+        dhi.action = rh.get_name();
+        dhi.response_handler = &rh;
+        if (batched) dhi.data[BATCH_REQUEST] = "true";
+
+        rh.execute(dhi);
+    }
+
+public:
+    BatchCacheTest() :
+        d_container(0)
+    {
+    }
+
+    ~BatchCacheTest()
+    {
+    }
+
+    void setUp()
+    {
+        CountingRequestHandler::opens = 0;
+        d_container = new TestContainer("c");
+        BESRequestHandlerList::TheList()->add_handler(handler_name, new CountingRequestHandler);
+    }
+
+    void tearDown()
+    {
+        delete BESRequestHandlerList::TheList()->remove_handler(handler_name);
+        delete d_container;
+        d_container = 0;
+    }
+
+    // DDS and data responses in one batch open the dataset once
+    void batched_dds_test()
+    {
+        BESDDSResponseHandler dds_rh(DDS_RESPONSE);
+        execute(dds_rh, true);
+
+        BESDataResponseHandler data_rh(DATA_RESPONSE);
+        execute(data_rh, true);
+
+        DBG(cerr << "opens: " << CountingRequestHandler::opens << endl);
+        CPPUNIT_ASSERT(CountingRequestHandler::opens == 1);
+
+        BESDataDDSResponse *bdds = dynamic_cast<BESDataDDSResponse *>(data_rh.get_response_object());
+        CPPUNIT_ASSERT(bdds->get_dds()->num_var() == 1);
+        CPPUNIT_ASSERT(bdds->get_dds()->var("counted"));
+
+        // The next request builds it again
+        d_container->clear_request_objects();
+        BESDataResponseHandler next_rh(DATA_RESPONSE);
+        execute(next_rh, true);
+        CPPUNIT_ASSERT(CountingRequestHandler::opens == 2);
+    }
+
+    // Without a batch, each response opens the dataset
+    void unbatched_dds_test()
+    {
+        BESDDSResponseHandler dds_rh(DDS_RESPONSE);
+        execute(dds_rh, false);
+
+        BESDataResponseHandler data_rh(DATA_RESPONSE);
+        execute(data_rh, false);
+
+        CPPUNIT_ASSERT(CountingRequestHandler::opens == 2);
+    }
+
+    // DMR and DAP4 data responses in one batch open the dataset once
+    void batched_dmr_test()
+    {
+        BESDMRResponseHandler dmr_rh(DMR_RESPONSE);
+        execute(dmr_rh, true);
+
+        BESDap4ResponseHandler dap4_rh(DAP4DATA_RESPONSE);
+        execute(dap4_rh, true);
+
+        CPPUNIT_ASSERT(CountingRequestHandler::opens == 1);
+
+        BESDMRResponse *bdmr = dynamic_cast<BESDMRResponse *>(dap4_rh.get_response_object());
+        CPPUNIT_ASSERT(bdmr->get_dmr()->root()->var("counted"));
+    }
+
+    CPPUNIT_TEST_SUITE( BatchCacheTest );
+
+    CPPUNIT_TEST(batched_dds_test);
+    CPPUNIT_TEST(unbatched_dds_test);
+    CPPUNIT_TEST(batched_dmr_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BatchCacheTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: BatchCacheTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = BatchCacheTest::suite()->getTests();
+            unsigned int prefix_len = BatchCacheTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = BatchCacheTest::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
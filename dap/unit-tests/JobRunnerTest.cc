@@ -0,0 +1,355 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cerrno>
+
+#include <algorithm>
+
+#include <fstream>
+#include <sstream>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <GetOpt.h>
+#include <debug.h>
+
+#include "BESDapJobRunner.h"
+#include "BESFileLockingCache.h"
+#include "BESInternalError.h"
+#include "TheBESKeys.h"
+#include "BESDebug.h"
+
+#include "test_utils.h"
+#include "test_config.h"
+
+using namespace CppUnit;
+using namespace std;
+
+static bool debug = false;
+static bool bes_debug = false;
+static bool clean = true;
+static const string c_cache_name = "/job_cache";
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+// Write 'body', optionally waiting first or failing
+class TestJob: public BESDapJobRunner::Job {
+    string d_body;
+    unsigned int d_delay;
+    bool d_fail;
+
+public:
+    TestJob(const string &body, unsigned int delay = 0, bool fail = false) :
+        d_body(body), d_delay(delay), d_fail(fail)
+    {
+    }
+
+    virtual void run(ostream &out)
+    {
+        if (d_delay) sleep(d_delay);
+        out << d_body;
+        if (d_fail) throw BESInternalError("TestJob failed", __FILE__, __LINE__);
+    }
+};
+
+class JobRunnerTest: public TestFixture {
+private:
+    string d_cache;
+    BESFileLockingCache *cache;
+    BESDapJobRunner *runner;
+
+    // Wait for a job to be done or fail; return its final status
+    BESDapJobRunner::Status wait_for(const string &job_id)
+    {
+        BESDapJobRunner::Status status;
+        for (int i = 0; i < 100; ++i) {
+            status = BESDapJobRunner::Status();
+            if (runner->get_status(job_id, status) && (status.state == "done" || status.state == "failed"))
+                break;
+            usleep(100000);
+        }
+
+        DBG(cerr << job_id << ": " << status.state << ", " << status.message << endl);
+        return status;
+    }
+
+    string read_file(const string &name)
+    {
+        ifstream in(name.c_str(), ios::in | ios::binary);
+        ostringstream oss;
+        oss << in.rdbuf();
+        return oss.str();
+    }
+
+public:
+    JobRunnerTest() :
+        d_cache(string(TEST_SRC_DIR) + c_cache_name), cache(0), runner(0)
+    {
+    }
+
+    ~JobRunnerTest()
+    {
+    }
+
+    void setUp()
+    {
+        if (bes_debug) BESDebug::SetUp("cerr,jobs");
+
+        if (clean) {
+            clean_cache_dir(d_cache + "/jobs");
+            clean_cache_dir(d_cache);
+        }
+
+        TheBESKeys::ConfigFile = (string) TEST_SRC_DIR + "/input-files/test.keys"; // empty file.
+
+        cache = new BESFileLockingCache(d_cache, "jr", 1000);
+        // One interactive and one bulk slot; jobs over 1000 bytes are bulk jobs;
+        // one more job may wait for a slot
+        runner = new BESDapJobRunner(d_cache + "/jobs", 1, 1, 1000, 0, 1);
+    }
+
+    void tearDown()
+    {
+        delete runner;
+        delete cache;
+
+        if (clean) {
+            clean_cache_dir(d_cache + "/jobs");
+            clean_cache_dir(d_cache);
+        }
+    }
+
+    CPPUNIT_TEST_SUITE( JobRunnerTest );
+
+    CPPUNIT_TEST(no_keys_test);
+    CPPUNIT_TEST(run_a_job);
+    CPPUNIT_TEST(lane_test);
+    CPPUNIT_TEST(duplicate_job_test);
+    CPPUNIT_TEST(failed_job_test);
+    CPPUNIT_TEST(no_status_test);
+    CPPUNIT_TEST(queue_limit_test);
+    CPPUNIT_TEST(job_ids_test);
+    CPPUNIT_TEST(inherited_fds_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    // With no DAP.StoredResultsJobs.Workers key, there are no background jobs
+    void no_keys_test()
+    {
+        CPPUNIT_ASSERT(!BESDapJobRunner::get_instance(d_cache + "/jobs"));
+    }
+
+    void run_a_job()
+    {
+        string target = cache->get_cache_file_name("jr_result_1", false);
+        TestJob job("The stored result");
+
+        CPPUNIT_ASSERT(runner->submit("jr_result_1", job, 10, cache, target));
+
+        BESDapJobRunner::Status status = wait_for("jr_result_1");
+        CPPUNIT_ASSERT(status.state == "done");
+        CPPUNIT_ASSERT(status.lane == "interactive");
+        CPPUNIT_ASSERT(status.bytes == 17);
+        CPPUNIT_ASSERT(status.pid != getpid());
+        CPPUNIT_ASSERT(status.finished >= status.started && status.started >= status.submitted);
+
+        CPPUNIT_ASSERT(read_file(target) == "The stored result");
+
+        struct stat buf;
+        CPPUNIT_ASSERT(stat((d_cache + "/jobs/jr_result_1.part").c_str(), &buf) != 0);
+    }
+
+    void lane_test()
+    {
+        TestJob job("bulk");
+
+        CPPUNIT_ASSERT(runner->submit("jr_result_2", job, 1000000, cache, cache->get_cache_file_name("jr_result_2", false)));
+
+        BESDapJobRunner::Status status = wait_for("jr_result_2");
+        CPPUNIT_ASSERT(status.state == "done");
+        CPPUNIT_ASSERT(status.lane == "bulk");
+        CPPUNIT_ASSERT(status.estimated_bytes == 1000000);
+    }
+
+    // A second request for a job that is running does not start another one
+    void duplicate_job_test()
+    {
+        string target = cache->get_cache_file_name("jr_result_3", false);
+        TestJob slow_job("first", 1);
+        TestJob job("second");
+
+        CPPUNIT_ASSERT(runner->submit("jr_result_3", slow_job, 10, cache, target));
+        CPPUNIT_ASSERT(runner->submit("jr_result_3", job, 10, cache, target));
+
+        BESDapJobRunner::Status status = wait_for("jr_result_3");
+        CPPUNIT_ASSERT(status.state == "done");
+        CPPUNIT_ASSERT(read_file(target) == "first");
+    }
+
+    void failed_job_test()
+    {
+        string target = cache->get_cache_file_name("jr_result_4", false);
+        TestJob job("partial", 0, true);
+
+        CPPUNIT_ASSERT(runner->submit("jr_result_4", job, 10, cache, target));
+
+        BESDapJobRunner::Status status = wait_for("jr_result_4");
+        CPPUNIT_ASSERT(status.state == "failed");
+        CPPUNIT_ASSERT(status.message.find("TestJob failed") != string::npos);
+
+        // Neither the result nor the partial result is left behind
+        struct stat buf;
+        CPPUNIT_ASSERT(stat(target.c_str(), &buf) != 0);
+        CPPUNIT_ASSERT(stat((d_cache + "/jobs/jr_result_4.part").c_str(), &buf) != 0);
+    }
+
+    void no_status_test()
+    {
+        BESDapJobRunner::Status status;
+        CPPUNIT_ASSERT(!runner->get_status("no_such_job", status));
+    }
+
+    // Two slots and one more waiting; the fourth job is left to the caller
+    void queue_limit_test()
+    {
+        TestJob slow_job("slow", 1);
+        TestJob job("fast");
+
+        CPPUNIT_ASSERT(runner->submit("jr_result_5", slow_job, 10, cache, cache->get_cache_file_name("jr_result_5", false)));
+        CPPUNIT_ASSERT(runner->submit("jr_result_6", slow_job, 10, cache, cache->get_cache_file_name("jr_result_6", false)));
+        CPPUNIT_ASSERT(runner->submit("jr_result_7", slow_job, 1000000, cache, cache->get_cache_file_name("jr_result_7", false)));
+        CPPUNIT_ASSERT(!runner->submit("jr_result_8", job, 10, cache, cache->get_cache_file_name("jr_result_8", false)));
+
+        BESDapJobRunner::Status status;
+        CPPUNIT_ASSERT(!runner->get_status("jr_result_8", status));
+
+        CPPUNIT_ASSERT(wait_for("jr_result_5").state == "done");
+        CPPUNIT_ASSERT(wait_for("jr_result_6").state == "done");
+        CPPUNIT_ASSERT(wait_for("jr_result_7").state == "done");
+
+        // There's room again once those are done
+        CPPUNIT_ASSERT(runner->submit("jr_result_8", job, 10, cache, cache->get_cache_file_name("jr_result_8", false)));
+        CPPUNIT_ASSERT(wait_for("jr_result_8").state == "done");
+    }
+
+    void job_ids_test()
+    {
+        TestJob job("listed");
+        CPPUNIT_ASSERT(runner->submit("jr_result_9", job, 10, cache, cache->get_cache_file_name("jr_result_9", false)));
+        CPPUNIT_ASSERT(wait_for("jr_result_9").state == "done");
+
+        vector<string> job_ids;
+        runner->get_job_ids(job_ids);
+        DBG(cerr << "jobs: " << job_ids.size() << endl);
+        CPPUNIT_ASSERT(find(job_ids.begin(), job_ids.end(), "jr_result_9") != job_ids.end());
+        CPPUNIT_ASSERT(find(job_ids.begin(), job_ids.end(), "no_such_job") == job_ids.end());
+    }
+
+    // The job process must not hold the listener's sockets or pipes open
+    void inherited_fds_test()
+    {
+        int fds[2];
+        CPPUNIT_ASSERT(pipe(fds) == 0);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+        TestJob slow_job("slow", 1);
+        CPPUNIT_ASSERT(runner->submit("jr_result_10", slow_job, 10, cache, cache->get_cache_file_name("jr_result_10", false)));
+
+        // The job process records its pid once it has closed the descriptors
+        BESDapJobRunner::Status status;
+        for (int i = 0; i < 100 && status.pid == 0; ++i) {
+            usleep(10000);
+            runner->get_status("jr_result_10", status);
+        }
+        CPPUNIT_ASSERT(status.pid != 0 && (status.state == "queued" || status.state == "running"));
+
+        // With no writer left, read() sees the end of file instead of EAGAIN
+        close(fds[1]);
+        char c;
+        CPPUNIT_ASSERT(read(fds[0], &c, 1) == 0);
+        close(fds[0]);
+
+        CPPUNIT_ASSERT(wait_for("jr_result_10").state == "done");
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(JobRunnerTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dbkh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'b':
+            bes_debug = true;  // bes_debug is a static global
+            cerr << "##### BES DEBUG is ON" << endl;
+            break;
+        case 'k':   // -k turns off cleaning the job_cache dir
+            clean = false;
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: JobRunnerTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = JobRunnerTest::suite()->getTests();
+            unsigned int prefix_len = JobRunnerTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = JobRunnerTest::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,327 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <pthread.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <GetOpt.h>
+
+#include <Int32.h>
+#include <Sequence.h>
+
+#include <debug.h>
+
+#include "BESDapPrefetcher.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static pthread_mutex_t count_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t count_cond = PTHREAD_COND_INITIALIZER;
+static int reads = 0;           // calls to SlowInt32::read()
+static int concurrent = 0;      // reads in progress now
+static int max_concurrent = 0;  // ... and the most seen at once
+static bool gate_open = true;   // reads block until this is true
+
+/// An Int32 whose read() waits at the gate and, optionally, fails.
+class SlowInt32: public Int32 {
+    bool d_fail;
+
+public:
+    SlowInt32(const string &n, bool fail = false) : Int32(n), d_fail(fail) { }
+
+    virtual BaseType *ptr_duplicate() { return new SlowInt32(*this); }
+
+    virtual bool read()
+    {
+        pthread_mutex_lock(&count_mutex);
+        ++reads;
+        max_concurrent = max(max_concurrent, ++concurrent);
+        pthread_cond_broadcast(&count_cond);
+
+        while (!gate_open)
+            pthread_cond_wait(&count_cond, &count_mutex);
+
+        --concurrent;
+        pthread_mutex_unlock(&count_mutex);
+
+        if (d_fail) throw Error("SlowInt32 read failed");
+
+        set_value(42);
+        set_read_p(true);
+        return true;
+    }
+};
+
+class PrefetcherTest: public TestFixture {
+private:
+    vector<BaseType*> d_vars;
+
+    // Play the part of the response builder
+    void serialize_all(BESDapPrefetcher &prefetch, bool read_inline)
+    {
+        for (unsigned int i = 0; i < d_vars.size(); ++i) {
+            prefetch.wait(i);
+            DBG(cerr << d_vars[i]->name() << " read_p: " << d_vars[i]->read_p() << endl);
+            if (read_inline && !d_vars[i]->read_p()) {
+                try {
+                    d_vars[i]->read();
+                }
+                catch (Error &e) {
+                    DBG(cerr << "Caught: " << e.get_error_message() << endl);
+                }
+            }
+            prefetch.done(i);
+        }
+    }
+
+    // Hold reads at the gate until open_gate() is called
+    void close_gate()
+    {
+        pthread_mutex_lock(&count_mutex);
+        gate_open = false;
+        pthread_mutex_unlock(&count_mutex);
+    }
+
+    void open_gate()
+    {
+        pthread_mutex_lock(&count_mutex);
+        gate_open = true;
+        pthread_cond_broadcast(&count_cond);
+        pthread_mutex_unlock(&count_mutex);
+    }
+
+    // Wait until the worker threads have started n reads; otherwise wait()
+    // may claim a job first and leave it to the caller to read.
+    void wait_for_reads(int n)
+    {
+        pthread_mutex_lock(&count_mutex);
+        while (reads < n)
+            pthread_cond_wait(&count_cond, &count_mutex);
+        pthread_mutex_unlock(&count_mutex);
+    }
+
+public:
+    PrefetcherTest()
+    {
+    }
+
+    ~PrefetcherTest()
+    {
+    }
+
+    void setUp()
+    {
+        reads = concurrent = max_concurrent = 0;
+        close_gate();
+    }
+
+    void tearDown()
+    {
+        open_gate();
+        for (vector<BaseType*>::iterator i = d_vars.begin(), e = d_vars.end(); i != e; ++i)
+            delete *i;
+        d_vars.clear();
+    }
+
+    CPPUNIT_TEST_SUITE( PrefetcherTest );
+
+    CPPUNIT_TEST(prefetch_all_test);
+    CPPUNIT_TEST(depth_limit_test);
+    CPPUNIT_TEST(size_limit_test);
+    CPPUNIT_TEST(skip_test);
+    CPPUNIT_TEST(failed_read_test);
+    CPPUNIT_TEST(early_exit_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void prefetch_all_test()
+    {
+        for (int i = 0; i < 8; ++i)
+            d_vars.push_back(new SlowInt32("v" + long_to_string(i)));
+
+        BESDapPrefetcher prefetch(d_vars, 8, 1024);
+        wait_for_reads(8);
+        CPPUNIT_ASSERT(concurrent == 8);
+        open_gate();
+
+        for (unsigned int i = 0; i < d_vars.size(); ++i) {
+            prefetch.wait(i);
+            CPPUNIT_ASSERT(d_vars[i]->read_p());
+            prefetch.done(i);
+        }
+
+        CPPUNIT_ASSERT(reads == 8);
+    }
+
+    void depth_limit_test()
+    {
+        for (int i = 0; i < 12; ++i)
+            d_vars.push_back(new SlowInt32("v" + long_to_string(i)));
+
+        // Two worker threads; nothing read inline
+        BESDapPrefetcher prefetch(d_vars, 2, 1024);
+        wait_for_reads(2);
+        CPPUNIT_ASSERT(concurrent == 2);
+        open_gate();
+
+        serialize_all(prefetch, false);
+
+        DBG(cerr << "max concurrent: " << max_concurrent << ", reads: " << reads << endl);
+        CPPUNIT_ASSERT(max_concurrent == 2);
+        CPPUNIT_ASSERT(reads >= 2 && reads <= 12);
+    }
+
+    void size_limit_test()
+    {
+        for (int i = 0; i < 12; ++i)
+            d_vars.push_back(new SlowInt32("v" + long_to_string(i)));
+
+        // Room for one Int32 at a time
+        BESDapPrefetcher prefetch(d_vars, 4, sizeof(dods_int32));
+        wait_for_reads(1);
+        open_gate();
+
+        serialize_all(prefetch, false);
+
+        DBG(cerr << "max concurrent: " << max_concurrent << ", reads: " << reads << endl);
+        CPPUNIT_ASSERT(max_concurrent == 1);
+        CPPUNIT_ASSERT(reads >= 1 && reads <= 12);
+    }
+
+    void skip_test()
+    {
+        d_vars.push_back(new SlowInt32("v0"));
+        d_vars.push_back(new Sequence("s"));
+        d_vars.push_back(new SlowInt32("v1"));
+        d_vars.back()->set_read_p(true);    // e.g., a function result
+        d_vars.push_back(new SlowInt32("v2"));
+
+        BESDapPrefetcher prefetch(d_vars, 4, 1024);
+        wait_for_reads(2);
+        open_gate();
+
+        serialize_all(prefetch, false);
+
+        CPPUNIT_ASSERT(reads == 2);
+        CPPUNIT_ASSERT(!d_vars[1]->read_p());
+    }
+
+    void failed_read_test()
+    {
+        d_vars.push_back(new SlowInt32("v0"));
+        d_vars.push_back(new SlowInt32("v1", true));
+        d_vars.push_back(new SlowInt32("v2"));
+
+        BESDapPrefetcher prefetch(d_vars, 4, 1024);
+        wait_for_reads(3);
+        open_gate();
+
+        prefetch.wait(0);
+        prefetch.done(0);
+
+        // The error is left for the caller to find by reading again
+        prefetch.wait(1);
+        CPPUNIT_ASSERT(!d_vars[1]->read_p());
+        CPPUNIT_ASSERT_THROW(d_vars[1]->read(), Error);
+        prefetch.done(1);
+
+        prefetch.wait(2);
+        CPPUNIT_ASSERT(d_vars[2]->read_p());
+        prefetch.done(2);
+    }
+
+    void early_exit_test()
+    {
+        for (int i = 0; i < 8; ++i)
+            d_vars.push_back(new SlowInt32("v" + long_to_string(i)));
+
+        {
+            // As when serialize() throws: the destructor must wait for reads
+            // in progress and start no new ones.
+            BESDapPrefetcher prefetch(d_vars, 2, 1024);
+            wait_for_reads(2);
+            open_gate();
+
+            prefetch.wait(0);
+        }
+
+        // A worker may have started the third variable before the shutdown
+        DBG(cerr << "reads: " << reads << endl);
+        CPPUNIT_ASSERT(concurrent == 0);
+        CPPUNIT_ASSERT(reads >= 2 && reads <= 3);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PrefetcherTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: PrefetcherTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = PrefetcherTest::suite()->getTests();
+            unsigned int prefix_len = PrefetcherTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = PrefetcherTest::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
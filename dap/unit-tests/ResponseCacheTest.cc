@@ -0,0 +1,289 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <sstream>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <DMR.h>
+#include <GetOpt.h>
+#include <debug.h>
+
+#include "BESDapResponseCache.h"
+#include "BESError.h"
+#include "TheBESKeys.h"
+#include "BESDebug.h"
+
+#include "test_utils.h"
+#include "test_config.h"
+
+using namespace CppUnit;
+using namespace std;
+
+static bool debug = false;
+static bool bes_debug = false;
+static bool clean = true;
+static const string c_cache_name = "/response_cache";
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+class ResponseCacheTest: public TestFixture {
+private:
+    string d_cache;
+    string d_dataset;
+    BESDapResponseCache *cache;
+
+    string cached_response(const string &resource_id)
+    {
+        ostringstream oss;
+        string cache_file_name;
+        if (!cache->send_cached_response(resource_id, oss, cache_file_name)) return "MISS";
+        return oss.str();
+    }
+
+    void add_response(const string &resource_id, const string &body, bool commit = true)
+    {
+        ostringstream client;
+        string cache_file_name;
+        CPPUNIT_ASSERT(!cache->send_cached_response(resource_id, client, cache_file_name));
+
+        BESDapResponseCacheWriter writer(cache, resource_id, cache_file_name, client);
+        writer.stream() << body;
+        if (commit) writer.commit();
+
+        CPPUNIT_ASSERT(client.str() == body);
+    }
+
+public:
+    ResponseCacheTest() :
+        d_cache(string(TEST_SRC_DIR) + c_cache_name), d_dataset(string(TEST_SRC_DIR) + "/input-files/bears.data"),
+        cache(0)
+    {
+    }
+
+    ~ResponseCacheTest()
+    {
+    }
+
+    void setUp()
+    {
+        if (bes_debug) BESDebug::SetUp("cerr,response_cache");
+
+        if (clean) clean_cache_dir(d_cache);
+
+        TheBESKeys::ConfigFile = (string) TEST_SRC_DIR + "/input-files/test.keys"; // empty file.
+
+        cache = BESDapResponseCache::get_instance(d_cache, "dr", 1000);
+    }
+
+    void tearDown()
+    {
+        if (clean) clean_cache_dir(d_cache);
+    }
+
+    CPPUNIT_TEST_SUITE( ResponseCacheTest );
+
+    CPPUNIT_TEST(normalize_ce_test);
+    CPPUNIT_TEST(resource_id_test);
+    CPPUNIT_TEST(dap2_resource_id_test);
+    CPPUNIT_TEST(dap4_resource_id_test);
+    CPPUNIT_TEST(miss_test);
+    CPPUNIT_TEST(cache_and_read_a_response);
+    CPPUNIT_TEST(abandon_a_response);
+    CPPUNIT_TEST(no_cache_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void normalize_ce_test()
+    {
+        CPPUNIT_ASSERT(BESDapResponseCache::normalize_ce("a[0:1:2], b") == "a[0:1:2],b");
+        CPPUNIT_ASSERT(BESDapResponseCache::normalize_ce(" a&b = \"x y\" ") == "a&b=\"x y\"");
+        CPPUNIT_ASSERT(BESDapResponseCache::normalize_ce("") == "");
+    }
+
+    void resource_id_test()
+    {
+        CPPUNIT_ASSERT(cache);
+
+        string id = cache->get_resource_id(d_dataset, "bears[0:1:2]", "dods");
+        DBG(cerr << "id: " << id << endl);
+        CPPUNIT_ASSERT(id.find("dods#" + d_dataset + "#") == 0);
+        CPPUNIT_ASSERT(id.find("#bears[0:1:2]") != string::npos);
+
+        // Spacing does not matter; the response type does
+        CPPUNIT_ASSERT(cache->get_resource_id(d_dataset, "bears[0:1:2] ", "dods") == id);
+        CPPUNIT_ASSERT(cache->get_resource_id(d_dataset, "bears[0:1:2]", "dap") != id);
+
+        // Not a regular file
+        CPPUNIT_ASSERT(cache->get_resource_id("/no/such/file", "x", "dods").empty());
+        CPPUNIT_ASSERT(cache->get_resource_id(TEST_SRC_DIR, "x", "dods").empty());
+    }
+
+    // With explicit containers, the container name is part of a DAP2 id
+    void dap2_resource_id_test()
+    {
+        CPPUNIT_ASSERT(cache);
+
+        string id = cache->get_dap2_resource_id(d_dataset, "bears", "");
+        DBG(cerr << "id: " << id << endl);
+        CPPUNIT_ASSERT(id.find("dods#") == 0);
+        CPPUNIT_ASSERT(cache->get_dap2_resource_id(d_dataset, "bears", "") == id);
+        CPPUNIT_ASSERT(cache->get_dap2_resource_id(d_dataset, "bears", "c") != id);
+        CPPUNIT_ASSERT(
+            cache->get_dap2_resource_id(d_dataset, "bears", "c") != cache->get_dap2_resource_id(d_dataset, "bears", "d"));
+
+        CPPUNIT_ASSERT(cache->get_dap2_resource_id(d_dataset, "bears", "c\nd").empty());
+    }
+
+    // The DMR in a DAP4 response holds the request's xml:base
+    void dap4_resource_id_test()
+    {
+        CPPUNIT_ASSERT(cache);
+
+        libdap::DMR dmr;
+        dmr.set_request_xml_base("http://localhost/opendap/a.nc");
+        string id = cache->get_dap4_resource_id(d_dataset, "bears", dmr);
+        DBG(cerr << "id: " << id << endl);
+        CPPUNIT_ASSERT(id.find("dap#") == 0);
+        CPPUNIT_ASSERT(id != cache->get_resource_id(d_dataset, "bears", "dap"));
+        CPPUNIT_ASSERT(cache->get_dap4_resource_id(d_dataset, "bears", dmr) == id);
+
+        dmr.set_request_xml_base("http://example.com/opendap/a.nc");
+        CPPUNIT_ASSERT(cache->get_dap4_resource_id(d_dataset, "bears", dmr) != id);
+
+        dmr.set_request_xml_base("http://localhost/\nopendap/a.nc");
+        CPPUNIT_ASSERT(cache->get_dap4_resource_id(d_dataset, "bears", dmr).empty());
+    }
+
+    void miss_test()
+    {
+        CPPUNIT_ASSERT(cache);
+
+        string cache_file_name;
+        ostringstream oss;
+        CPPUNIT_ASSERT(!cache->send_cached_response(cache->get_resource_id(d_dataset, "a", "dods"), oss, cache_file_name));
+        CPPUNIT_ASSERT(cache_file_name.find(d_cache + "/dr") == 0);
+        CPPUNIT_ASSERT(oss.str().empty());
+    }
+
+    void cache_and_read_a_response()
+    {
+        CPPUNIT_ASSERT(cache);
+
+        string id_a = cache->get_resource_id(d_dataset, "a", "dods");
+        string id_b = cache->get_resource_id(d_dataset, "b", "dods");
+
+        // Include a newline and a null in the body
+        const char raw[] = "Dataset {\n} a;\nData:\n\0\1\2\3";
+        string body_a(raw, sizeof(raw) - 1);
+        add_response(id_a, body_a);
+        add_response(id_b, "Data for b");
+
+        CPPUNIT_ASSERT(cached_response(id_a) == body_a);
+        CPPUNIT_ASSERT(cached_response(id_b) == "Data for b");
+        CPPUNIT_ASSERT(cached_response(cache->get_resource_id(d_dataset, "c", "dods")) == "MISS");
+    }
+
+    void abandon_a_response()
+    {
+        CPPUNIT_ASSERT(cache);
+
+        string id = cache->get_resource_id(d_dataset, "a", "dods");
+        add_response(id, "Partial response", false);
+
+        CPPUNIT_ASSERT(cached_response(id) == "MISS");
+    }
+
+    void no_cache_test()
+    {
+        // With no cache, the writer just passes the response through
+        ostringstream client;
+        BESDapResponseCacheWriter writer(0, "id", "name", client);
+        writer.stream() << "response";
+        writer.commit();
+
+        CPPUNIT_ASSERT(client.str() == "response");
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ResponseCacheTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dbkh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'b':
+            bes_debug = true;  // bes_debug is a static global
+            cerr << "##### BES DEBUG is ON" << endl;
+            break;
+        case 'k':   // -k turns off cleaning the response_cache dir
+            clean = false;
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: ResponseCacheTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = ResponseCacheTest::suite()->getTests();
+            unsigned int prefix_len = ResponseCacheTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = ResponseCacheTest::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <GetOpt.h>
+
+#include <string>
+
+#include <debug.h>
+
+#include "Sha256.h"
+#include "BESInternalError.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace CppUnit;
+using namespace std;
+
+// Test vectors are from FIPS 180-4 and the NIST 'SHA-256 examples'
+class Sha256Test: public TestFixture {
+public:
+    Sha256Test()
+    {
+    }
+
+    ~Sha256Test()
+    {
+    }
+
+    void empty_string_test()
+    {
+        CPPUNIT_ASSERT_EQUAL(string("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"),
+            Sha256::hex_digest(""));
+    }
+
+    void abc_test()
+    {
+        CPPUNIT_ASSERT_EQUAL(string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"),
+            Sha256::hex_digest("abc"));
+    }
+
+    // 56 bytes: the padding needs a second block
+    void two_block_test()
+    {
+        CPPUNIT_ASSERT_EQUAL(string("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"),
+            Sha256::hex_digest("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+    }
+
+    void million_a_test()
+    {
+        Sha256 sha;
+        string a(1000, 'a');
+        for (int i = 0; i < 1000; ++i)
+            sha.update(a);
+
+        CPPUNIT_ASSERT_EQUAL(string("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"),
+            sha.hex_digest());
+    }
+
+    // Adding data in pieces of any size gives the same digest
+    void incremental_update_test()
+    {
+        string data;
+        for (int i = 0; i < 300; ++i)
+            data += static_cast<char>(i % 256);
+
+        string expected = Sha256::hex_digest(data);
+        DBG(cerr << "digest: " << expected << endl);
+
+        for (string::size_type piece = 1; piece < 130; piece += 7) {
+            Sha256 sha;
+            for (string::size_type i = 0; i < data.length(); i += piece)
+                sha.update(data.substr(i, piece));
+            CPPUNIT_ASSERT_EQUAL(expected, sha.hex_digest());
+        }
+    }
+
+    void update_after_digest_test()
+    {
+        Sha256 sha;
+        sha.update("abc");
+        string digest = sha.hex_digest();
+        CPPUNIT_ASSERT_EQUAL(digest, sha.hex_digest());
+        CPPUNIT_ASSERT_THROW(sha.update("d"), BESInternalError);
+    }
+
+    CPPUNIT_TEST_SUITE( Sha256Test );
+
+    CPPUNIT_TEST(empty_string_test);
+    CPPUNIT_TEST(abc_test);
+    CPPUNIT_TEST(two_block_test);
+    CPPUNIT_TEST(million_a_test);
+    CPPUNIT_TEST(incremental_update_test);
+    CPPUNIT_TEST(update_after_digest_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Sha256Test);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: Sha256Test has the following tests:" << endl;
+            const std::vector<Test*> &tests = Sha256Test::suite()->getTests();
+            unsigned int prefix_len = Sha256Test::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = Sha256Test::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
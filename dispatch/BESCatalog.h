@@ -41,6 +41,32 @@ using std::string;
 
 class BESCatalogEntry;
 
+/** @brief paging and sort options used when listing the children of a
+ * catalog node.
+ *
+ * The default (offset 0, no limit, sorted by name in ascending order)
+ * lists every child of the node, which is the historical behavior.
+ */
+struct BESCatalogPage {
+    /// Number of children to skip
+    unsigned long offset;
+    /// Maximum number of children to return, zero means no limit
+    unsigned long limit;
+    /// One of "name", "size" or "lastModified"
+    string sort;
+    bool descending;
+
+    BESCatalogPage() :
+            offset(0), limit(0), sort("name"), descending(false)
+    {
+    }
+
+    bool is_paged() const
+    {
+        return offset != 0 || limit != 0;
+    }
+};
+
 /** @brief abstract base class catalog object. Derived classes know how to
  * show nodes and leaves in a catalog.
  */
@@ -81,6 +107,17 @@ public:
 
     virtual BESCatalogEntry * show_catalog(const string &container, const string &coi, BESCatalogEntry *entry) = 0;
 
+    /** @brief show a page of the children of a node
+     *
+     * Catalogs that cannot page their listings ignore the page and return
+     * every child of the node.
+     */
+    virtual BESCatalogEntry * show_catalog(const string &container, const string &coi, BESCatalogEntry *entry,
+        const BESCatalogPage &/*page*/)
+    {
+        return show_catalog(container, coi, entry);
+    }
+
     virtual void dump(ostream &strm) const = 0;
 };
 
@@ -41,6 +41,7 @@
 #include <sstream>
 
 using std::stringstream;
+using std::ostringstream;
 using std::endl;
 
 #include "BESUtil.h"
@@ -68,6 +69,27 @@ BESCatalogDirectory::~BESCatalogDirectory()
 
 BESCatalogEntry *
 BESCatalogDirectory::show_catalog(const string &node, const string &coi, BESCatalogEntry *entry)
+{
+    return show_catalog(node, coi, entry, BESCatalogPage());
+}
+
+/** @brief build the catalog entry for a node, listing one page of its children
+ *
+ * If the node is a directory its children are read through the catalog's
+ * listing cache and only those within the page are added to the entry.
+ * When the request is paged, the total number of children, the offset
+ * and the limit are recorded in the entry's info so they can be returned
+ * to the client.
+ *
+ * @param node The node, relative to the catalog's root directory
+ * @param coi Is this a show catalog or a show info request
+ * @param entry If not null, add the new entry to this one
+ * @param page The children of the node to list
+ * @return The new entry, or entry if that was not null
+ */
+BESCatalogEntry *
+BESCatalogDirectory::show_catalog(const string &node, const string &coi, BESCatalogEntry *entry,
+    const BESCatalogPage &page)
 {
     string use_node = node;
     // use_node should only end in '/' is that's the only character in which
@@ -137,7 +159,20 @@ BESCatalogDirectory::show_catalog(const string &node, const string &coi, BESCata
             BESUtil::conditional_timeout_cancel();
 
             bool dirs_only = false;
-            _utils->get_entries(dip, fullnode, use_node, coi, myentry, dirs_only);
+            unsigned int count = _utils->get_entries(dip, fullnode, use_node, coi, myentry, dirs_only, page);
+            if (page.is_paged()) {
+                ostringstream strm;
+                strm << count;
+                myentry->add_info("count", strm.str());
+                strm.str("");
+                strm << page.offset;
+                myentry->add_info("offset", strm.str());
+                if (page.limit) {
+                    strm.str("");
+                    strm << page.limit;
+                    myentry->add_info("limit", strm.str());
+                }
+            }
         } catch (... /*BESError &e */) {
             closedir(dip);
             throw /* e */;
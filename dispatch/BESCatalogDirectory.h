@@ -58,6 +58,11 @@ public:
 					      const string &coi,
 					      BESCatalogEntry *entry ) ;
 
+    virtual BESCatalogEntry *	show_catalog( const string &container,
+					      const string &coi,
+					      BESCatalogEntry *entry,
+					      const BESCatalogPage &page ) ;
+
     virtual void		dump( ostream &strm ) const ;
 };
 
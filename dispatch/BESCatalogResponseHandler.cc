@@ -46,6 +46,26 @@
 #include "BESDebug.h"
 #include "BESStopWatch.h"
 
+#include <sstream>
+
+using std::istringstream;
+
+// Read an optional, non-negative paging value from the DHI.
+static unsigned long get_page_value(BESDataHandlerInterface &dhi, const string &name, const string &attr)
+{
+    string value = dhi.data[name];
+    if (value.empty()) return 0;
+
+    istringstream iss(value);
+    long result = 0;
+    iss >> result;
+    if (iss.fail() || !iss.eof() || result < 0) {
+        string err = "The " + attr + " of a catalog request must be a non-negative integer, found '" + value + "'";
+        throw BESSyntaxUserError(err, __FILE__, __LINE__);
+    }
+    return result;
+}
+
 BESCatalogResponseHandler::BESCatalogResponseHandler( const string &name )
     : BESResponseHandler( name )
 {
@@ -60,6 +80,10 @@ BESCatalogResponseHandler::~BESCatalogResponseHandler( )
  *
  * The response object BESInfo is created to store the information.
  *
+ * The children of the node can be paged and sorted using the optional
+ * CATALOG_OFFSET, CATALOG_LIMIT, CATALOG_SORT (name, size or
+ * lastModified) and CATALOG_ORDER (ascending or descending) values.
+ *
  * @param dhi structure that holds request and response information
  * @see BESDataHandlerInterface
  * @see BESInfo
@@ -68,7 +92,7 @@ BESCatalogResponseHandler::~BESCatalogResponseHandler( )
 void BESCatalogResponseHandler::execute(BESDataHandlerInterface &dhi) {
 
 	BESStopWatch sw;
-	if (BESISDEBUG( TIMING_LOG ))
+	if (BESISTIMING)
 		sw.start("BESCatalogResponseHandler::execute", dhi.data[REQUEST_ID]);
 
     BESInfo *info = BESInfoList::TheList()->build_info();
@@ -122,13 +146,31 @@ void BESCatalogResponseHandler::execute(BESDataHandlerInterface &dhi) {
 
     string coi = dhi.data[CATALOG_OR_INFO];
 
+    BESCatalogPage page;
+    page.offset = get_page_value(dhi, CATALOG_OFFSET, "offset");
+    page.limit = get_page_value(dhi, CATALOG_LIMIT, "limit");
+    if (!dhi.data[CATALOG_SORT].empty())
+        page.sort = dhi.data[CATALOG_SORT];
+    if (page.sort != "name" && page.sort != "size" && page.sort != "lastModified") {
+        string err = "The sort of a catalog request must be name, size or lastModified, found '" + page.sort + "'";
+        throw BESSyntaxUserError(err, __FILE__, __LINE__);
+    }
+    string order = dhi.data[CATALOG_ORDER];
+    if (order == "descending") {
+        page.descending = true;
+    }
+    else if (!order.empty() && order != "ascending") {
+        string err = "The order of a catalog request must be ascending or descending, found '" + order + "'";
+        throw BESSyntaxUserError(err, __FILE__, __LINE__);
+    }
+
     BESCatalogEntry *entry = 0;
     if (catobj) {
-        entry = catobj->show_catalog(container, coi, entry);
+        entry = catobj->show_catalog(container, coi, entry, page);
     } else {
         // we always want to get the container information from the
         // default catalog, whether the node is / or not
-        entry = defcat->show_catalog(container, coi, entry);
+        entry = defcat->show_catalog(container, coi, entry, page);
 
         // we only care to get the list of catalogs if the container is
         // slash (/)
@@ -159,10 +201,12 @@ void BESCatalogResponseHandler::execute(BESDataHandlerInterface &dhi) {
 
     // if we are doing a catalog response, then go one deeper
     if (coi == CATALOG_RESPONSE) {
-        BESCatalogEntry::catalog_citer ei = entry->get_beginning_entry();
-        BESCatalogEntry::catalog_citer ee = entry->get_ending_entry();
-        for (; ei != ee; ei++) {
-            BESCatalogUtils::display_entry((*ei).second, info);
+        vector<BESCatalogEntry *> children;
+        BESCatalogUtils::sort_entries(entry, page, children);
+        vector<BESCatalogEntry *>::iterator ci = children.begin();
+        vector<BESCatalogEntry *>::iterator ce = children.end();
+        for (; ci != ce; ci++) {
+            BESCatalogUtils::display_entry(*ci, info);
             info->end_tag("dataset");
         }
     }
@@ -37,15 +37,24 @@
 #include <dirent.h>
 
 #include <cerrno>
+#include <ctime>
 #include <iostream>
 #include <sstream>
 #include <list>
+#include <algorithm>
 #include <cstring>
+#include <cstdlib>
 
 using std::cout;
 using std::endl;
 using std::ostringstream;
+using std::istringstream;
+using std::ws;
 using std::list;
+using std::make_pair;
+using std::sort;
+using std::stable_sort;
+using std::reverse;
 
 #include "BESCatalogUtils.h"
 #include "BESCatalogList.h"
@@ -61,10 +70,53 @@ using std::list;
 #include "BESContainerStorage.h"
 #include "BESCatalogEntry.h"
 
+#include "BESDebug.h"
+
+// Default number of directory entries (summed over all of the cached
+// directories) held in the listing cache of each catalog.
+#define LISTING_CACHE_SIZE 100000
+
 map<string, BESCatalogUtils *> BESCatalogUtils::_instances;
 
+// Comparison functors used to order directory listings and catalog
+// entries.
+struct listing_name_less {
+	bool operator()(const BESCatalogUtils::listing_entry &a, const BESCatalogUtils::listing_entry &b) const {
+		return a.name < b.name;
+	}
+};
+
+struct listing_size_less {
+	const BESCatalogUtils::listing &d_entries;
+	listing_size_less(const BESCatalogUtils::listing &entries) : d_entries(entries) {}
+	bool operator()(unsigned long a, unsigned long b) const {
+		return d_entries[a].size < d_entries[b].size;
+	}
+};
+
+struct listing_time_less {
+	const BESCatalogUtils::listing &d_entries;
+	listing_time_less(const BESCatalogUtils::listing &entries) : d_entries(entries) {}
+	bool operator()(unsigned long a, unsigned long b) const {
+		return d_entries[a].mod_time < d_entries[b].mod_time;
+	}
+};
+
+struct catalog_entry_size_less {
+	bool operator()(BESCatalogEntry *a, BESCatalogEntry *b) const {
+		return strtoull(a->get_size().c_str(), 0, 10) < strtoull(b->get_size().c_str(), 0, 10);
+	}
+};
+
+struct catalog_entry_time_less {
+	bool operator()(BESCatalogEntry *a, BESCatalogEntry *b) const {
+		return a->get_mod_date() + a->get_mod_time() < b->get_mod_date() + b->get_mod_time();
+	}
+};
+
 BESCatalogUtils::BESCatalogUtils(const string &n) :
-	_name(n), _follow_syms(false) {
+	_name(n), _follow_syms(false), _listing_cache_size(LISTING_CACHE_SIZE),
+	_listing_cache_entries(0), _listing_cache_clock(0) {
 	string key = "BES.Catalog." + n + ".RootDirectory";
 	bool found = false;
 	TheBESKeys::TheKeys()->get_value(key, _root_dir, found);
@@ -144,6 +196,24 @@ BESCatalogUtils::BESCatalogUtils(const string &n) :
 	if (s_str == "yes" || s_str == "on" || s_str == "true") {
 		_follow_syms = true;
 	}
+
+	// The listing cache size is the total number of directory entries
+	// this process will remember; zero turns the cache off.
+	key = (string) "BES.Catalog." + n + ".ListingCacheSize";
+	s_str = "";
+	TheBESKeys::TheKeys()->get_value(key, s_str, found);
+	if (found && !s_str.empty()) {
+		// Read into a signed value; extracting '-1' into an unsigned long
+		// succeeds and wraps to a huge size.
+		istringstream iss(s_str);
+		long size = -1;
+		iss >> size;
+		if (iss.fail() || !(iss >> ws).eof() || size < 0) {
+			string s = key + " must be a non-negative integer, found " + s_str;
+			throw BESSyntaxUserError(s, __FILE__, __LINE__);
+		}
+		_listing_cache_size = size;
+	}
 }
 
 bool BESCatalogUtils::include(const string &inQuestion) const {
@@ -222,79 +292,36 @@ BESCatalogUtils::match_citer BESCatalogUtils::match_list_end() const {
 }
 
 unsigned int BESCatalogUtils::get_entries(DIR *dip, const string &fullnode,
-		const string &use_node, const string &/*coi*/, BESCatalogEntry *entry,
+		const string &use_node, const string &coi, BESCatalogEntry *entry,
 		bool dirs_only) {
-	unsigned int cnt = 0;
+	return get_entries(dip, fullnode, use_node, coi, entry, dirs_only,
+			BESCatalogPage());
+}
+
+/** @brief Add the children of a directory node to a catalog entry
+ *
+ * The directory is read, filtered and classified once and the result is
+ * kept in this catalog's listing cache. The cached listing is used as
+ * long as the modification time of the directory has not changed. Only
+ * the entries that fall within the requested page are added to the
+ * catalog entry.
+ *
+ * @param dip The open directory; not read if the listing is cached
+ * @param fullnode The full pathname of the directory
+ * @param use_node The node name relative to the catalog root, used in
+ * error messages
+ * @param entry Add children to this catalog entry
+ * @param dirs_only If true, only list the child directories
+ * @param page The offset, limit and sort order of the children to add
+ * @return The total number of children of the node, ignoring the page
+ */
+unsigned int BESCatalogUtils::get_entries(DIR *dip, const string &fullnode,
+		const string &use_node, const string &/*coi*/, BESCatalogEntry *entry,
+		bool dirs_only, const BESCatalogPage &page) {
 	struct stat cbuf;
 	int statret = stat(fullnode.c_str(), &cbuf);
 	int my_errno = errno;
-	if (statret == 0) {
-		struct dirent *dit;
-		struct stat buf;
-		struct stat lbuf;
-
-		while ((dit = readdir(dip)) != NULL) {
-			string dirEntry = dit->d_name;
-			if (dirEntry != "." && dirEntry != "..") {
-				string fullPath = fullnode + "/" + dirEntry;
-
-				// if follow_sym_links is true then continue with
-				// the checking. If false, first see if the entry is
-				// a symbolic link. If it is, do not include in the
-				// listing for this node. If not, then continue
-				// checking the entry.
-				bool continue_checking = true;
-				if (follow_sym_links() == false) {
-#if 0
-					int lstatret = lstat( fullPath.c_str(), &lbuf );
-#endif
-					(void) lstat(fullPath.c_str(), &lbuf);
-					if (S_ISLNK( lbuf.st_mode )) {
-						continue_checking = false;
-					}
-				}
-
-				if (continue_checking) {
-					// look at the mode and determine if this is a
-					// directory or a regular file. If it is not
-					// accessible, the stat fails, is not a directory
-					// or regular file, then simply do not include it.
-					statret = stat(fullPath.c_str(), &buf);
-					if (statret == 0 && S_ISDIR( buf.st_mode )) {
-						if (exclude(dirEntry) == false) {
-							BESCatalogEntry *curr_entry = new BESCatalogEntry(
-									dirEntry, entry->get_catalog());
-
-							bes_get_stat_info(curr_entry, buf);
-
-							entry->add_entry(curr_entry);
-
-							// we don't go further then this, so we need
-							// to add a blank node here so that we know
-							// it's a node (collection)
-							BESCatalogEntry *blank_entry = new BESCatalogEntry(
-									".blank", entry->get_catalog());
-							curr_entry->add_entry(blank_entry);
-						}
-					} else if (statret == 0 && S_ISREG( buf.st_mode )) {
-						if (!dirs_only && include(dirEntry)) {
-							BESCatalogEntry *curr_entry = new BESCatalogEntry(
-									dirEntry, entry->get_catalog());
-							bes_get_stat_info(curr_entry, buf);
-
-							list<string> services;
-							isData(fullPath, _name, services);
-							curr_entry->set_service_list(services);
-
-							bes_get_stat_info(curr_entry, buf);
-
-							entry->add_entry(curr_entry);
-						}
-					}
-				}
-			}
-		}
-	} else {
+	if (statret != 0) {
 		// ENOENT means that the path or part of the path does not exist
 		if (my_errno == ENOENT) {
 			string error = "Node " + use_node + " does not exist";
@@ -314,9 +341,217 @@ unsigned int BESCatalogUtils::get_entries(DIR *dip, const string &fullnode,
 			throw BESNotFoundError(error, __FILE__, __LINE__);
 		}
 	}
+
+	// A listing built during the same second the directory was last
+	// modified might have missed a change made later in that second, so
+	// it is only trusted if it was built after the directory's mtime.
+	map<string, cached_listing>::iterator ci = _listing_cache.find(fullnode);
+	if (ci != _listing_cache.end()
+			&& (ci->second.dir_mtime != cbuf.st_mtime || ci->second.built <= cbuf.st_mtime)) {
+		BESDEBUG("bes", "BESCatalogUtils::get_entries: stale listing for " << fullnode << endl);
+		_listing_cache_entries -= ci->second.entries.size();
+		_listing_cache.erase(ci);
+		ci = _listing_cache.end();
+	}
+
+	if (ci == _listing_cache.end()) {
+		cached_listing fresh;
+		fresh.dir_mtime = cbuf.st_mtime;
+		fresh.built = time(0);
+		fresh.last_used = 0;
+		ci = _listing_cache.insert(make_pair(fullnode, fresh)).first;
+		build_listing(dip, fullnode, ci->second.entries);
+		_listing_cache_entries += ci->second.entries.size();
+	}
+	else {
+		BESDEBUG("bes", "BESCatalogUtils::get_entries: using cached listing for " << fullnode << endl);
+	}
+
+	cached_listing &cached = ci->second;
+	cached.last_used = ++_listing_cache_clock;
+
+	const vector<unsigned long> &order = get_order(cached, page.sort);
+	unsigned long num_entries = cached.entries.size();
+
+	unsigned int cnt = 0;
+	for (unsigned long i = 0; i < num_entries; ++i) {
+		unsigned long idx = page.descending ? num_entries - 1 - i : i;
+		unsigned long pos = order.empty() ? idx : order[idx];
+
+		const listing_entry &le = cached.entries[pos];
+		if (dirs_only && !le.is_dir)
+			continue;
+
+		// count every match so the caller knows the size of the node,
+		// but only build catalog entries for the ones in the page
+		++cnt;
+		if (cnt <= page.offset)
+			continue;
+		if (page.limit != 0 && cnt > page.offset + page.limit)
+			continue;
+
+		BESCatalogEntry *curr_entry = new BESCatalogEntry(le.name, entry->get_catalog());
+		bes_get_stat_info(curr_entry, le.size, le.mod_time);
+		if (le.is_dir) {
+			// we don't go further then this, so we need to add a blank
+			// node here so that we know it's a node (collection)
+			BESCatalogEntry *blank_entry = new BESCatalogEntry(".blank", entry->get_catalog());
+			curr_entry->add_entry(blank_entry);
+		}
+		else {
+			list<string> services = le.services;
+			curr_entry->set_service_list(services);
+		}
+		entry->add_entry(curr_entry);
+	}
+
+	// Don't let the cache hold on to a listing bigger than the cache
+	if (_listing_cache_entries > _listing_cache_size)
+		purge_listing_cache(_listing_cache_size == 0 ? "" : fullnode);
+
 	return cnt;
 }
 
+/** @brief read, filter and classify the entries of a directory
+ *
+ * Symbolic links are skipped unless the catalog follows them, excluded
+ * directories and files that are not included are dropped and the
+ * services for each data file are looked up. The result is sorted by
+ * name.
+ */
+void BESCatalogUtils::build_listing(DIR *dip, const string &fullnode, listing &entries) {
+	struct dirent *dit;
+	struct stat buf;
+	struct stat lbuf;
+
+	while ((dit = readdir(dip)) != NULL) {
+		string dirEntry = dit->d_name;
+		if (dirEntry != "." && dirEntry != "..") {
+			string fullPath = fullnode + "/" + dirEntry;
+
+			// if follow_sym_links is true then continue with
+			// the checking. If false, first see if the entry is
+			// a symbolic link. If it is, do not include in the
+			// listing for this node. If not, then continue
+			// checking the entry.
+			if (follow_sym_links() == false) {
+				(void) lstat(fullPath.c_str(), &lbuf);
+				if (S_ISLNK( lbuf.st_mode )) {
+					continue;
+				}
+			}
+
+			// look at the mode and determine if this is a
+			// directory or a regular file. If it is not
+			// accessible, the stat fails, is not a directory
+			// or regular file, then simply do not include it.
+			int statret = stat(fullPath.c_str(), &buf);
+			if (statret == 0 && S_ISDIR( buf.st_mode )) {
+				if (exclude(dirEntry) == false) {
+					listing_entry le;
+					le.name = dirEntry;
+					le.is_dir = true;
+					le.size = buf.st_size;
+					le.mod_time = buf.st_mtime;
+					entries.push_back(le);
+				}
+			} else if (statret == 0 && S_ISREG( buf.st_mode )) {
+				if (include(dirEntry)) {
+					listing_entry le;
+					le.name = dirEntry;
+					le.is_dir = false;
+					le.size = buf.st_size;
+					le.mod_time = buf.st_mtime;
+					isData(fullPath, _name, le.services);
+					entries.push_back(le);
+				}
+			}
+		}
+	}
+
+	sort(entries.begin(), entries.end(), listing_name_less());
+}
+
+/** @brief Get the order of a cached listing for a given sort key
+ *
+ * @return A vector of indices into the listing; an empty vector means
+ * the listing is already in the requested order (by name).
+ */
+const vector<unsigned long> &
+BESCatalogUtils::get_order(cached_listing &cached, const string &sort_key) {
+	if (sort_key != "size" && sort_key != "lastModified") {
+		if (sort_key != "name" && !sort_key.empty()) {
+			string err = "Unknown catalog sort order '" + sort_key
+					+ "', expected one of name, size or lastModified";
+			throw BESSyntaxUserError(err, __FILE__, __LINE__);
+		}
+		return cached.orders[""];
+	}
+
+	map<string, vector<unsigned long> >::iterator oi = cached.orders.find(sort_key);
+	if (oi != cached.orders.end())
+		return oi->second;
+
+	vector<unsigned long> &order = cached.orders[sort_key];
+	order.reserve(cached.entries.size());
+	for (unsigned long i = 0; i < cached.entries.size(); ++i)
+		order.push_back(i);
+
+	// The listing is sorted by name, so a stable sort leaves entries
+	// with equal keys in name order.
+	if (sort_key == "size")
+		stable_sort(order.begin(), order.end(), listing_size_less(cached.entries));
+	else
+		stable_sort(order.begin(), order.end(), listing_time_less(cached.entries));
+
+	return order;
+}
+
+/** @brief Remove least recently used listings until the cache fits
+ *
+ * @param keep Do not remove the listing for this directory (unless it
+ * alone is larger than the cache).
+ */
+void BESCatalogUtils::purge_listing_cache(const string &keep) {
+	while (_listing_cache_entries > _listing_cache_size && !_listing_cache.empty()) {
+		map<string, cached_listing>::iterator victim = _listing_cache.end();
+		map<string, cached_listing>::iterator i = _listing_cache.begin();
+		for (; i != _listing_cache.end(); ++i) {
+			if (i->first == keep && _listing_cache.size() > 1)
+				continue;
+			if (victim == _listing_cache.end() || i->second.last_used < victim->second.last_used)
+				victim = i;
+		}
+
+		BESDEBUG("bes", "BESCatalogUtils::purge_listing_cache: removing " << victim->first << endl);
+		_listing_cache_entries -= victim->second.entries.size();
+		_listing_cache.erase(victim);
+	}
+}
+
+/** @brief Sort the children of a catalog entry for display
+ *
+ * BESCatalogEntry keeps its children sorted by name; this returns them
+ * in the order given by the page's sort key and direction, using the name
+ * to break ties.
+ */
+void BESCatalogUtils::sort_entries(BESCatalogEntry *entry, const BESCatalogPage &page,
+		vector<BESCatalogEntry *> &sorted) {
+	BESCatalogEntry::catalog_citer ei = entry->get_beginning_entry();
+	BESCatalogEntry::catalog_citer ee = entry->get_ending_entry();
+	for (; ei != ee; ei++) {
+		sorted.push_back((*ei).second);
+	}
+
+	if (page.sort == "size")
+		stable_sort(sorted.begin(), sorted.end(), catalog_entry_size_less());
+	else if (page.sort == "lastModified")
+		stable_sort(sorted.begin(), sorted.end(), catalog_entry_time_less());
+
+	if (page.descending)
+		reverse(sorted.begin(), sorted.end());
+}
+
 void BESCatalogUtils::display_entry(BESCatalogEntry *entry, BESInfo *info) {
 	string defcatname = BESCatalogList::TheCatalogList()->default_catalog();
 
@@ -334,7 +569,18 @@ void BESCatalogUtils::display_entry(BESCatalogEntry *entry, BESInfo *info) {
 	props["catalog"] = entry->get_catalog();
 	props["size"] = entry->get_size();
 	props["lastModified"] = entry->get_mod_date() + "T" + entry->get_mod_time();
-	if (entry->is_collection()) {
+
+	// A paged node carries the total number of children and the page
+	// that was returned in its metadata; the entry itself only holds the
+	// children on the page.
+	map<string, string> paging = entry->get_info();
+	if (paging.find("count") != paging.end()) {
+		props["node"] = "true";
+		props["count"] = paging["count"];
+		props["offset"] = paging["offset"];
+		if (paging.find("limit") != paging.end())
+			props["limit"] = paging["limit"];
+	} else if (entry->is_collection()) {
 		props["node"] = "true";
 		ostringstream strm;
 		strm << entry->get_count();
@@ -365,12 +611,15 @@ void BESCatalogUtils::bes_add_stat_info(BESCatalogEntry *entry,
 
 void BESCatalogUtils::bes_get_stat_info(BESCatalogEntry *entry,
 		struct stat &buf) {
-	off_t sz = buf.st_size;
+	bes_get_stat_info(entry, buf.st_size, buf.st_mtime);
+}
+
+void BESCatalogUtils::bes_get_stat_info(BESCatalogEntry *entry, off_t sz,
+		time_t mod) {
 	entry->set_size(sz);
 
 	// %T = %H:%M:%S
 	// %F = %Y-%m-%d
-	time_t mod = buf.st_mtime;
 	struct tm *stm = gmtime(&mod);
 	char mdate[64];
 	strftime(mdate, 64, "%Y-%m-%d", stm);
@@ -454,6 +703,10 @@ void BESCatalogUtils::dump(ostream &strm) const {
 		strm << BESIndent::LMarg << "    follow symbolic links: off" << endl;
 	}
 
+	strm << BESIndent::LMarg << "listing cache size: " << _listing_cache_size
+			<< " (" << _listing_cache.size() << " directories, "
+			<< _listing_cache_entries << " entries)" << endl;
+
 	BESIndent::UnIndent();
 }
 
@@ -49,6 +49,7 @@ using std::string;
 
 #include "BESObj.h"
 #include "BESUtil.h"
+#include "BESCatalog.h"
 
 class BESInfo;
 class BESCatalogEntry;
@@ -68,13 +69,46 @@ public:
 		string type;
 		string reg;
 	};
+
+	/// A directory entry that has passed the include/exclude tests, along
+	/// with the stat information and services needed to display it.
+	struct listing_entry {
+		string name;
+		bool is_dir;
+		off_t size;
+		time_t mod_time;
+		list<string> services;
+	};
+	typedef vector<listing_entry> listing;
+
 private:
 	vector<type_reg> _match_list;
 
-	BESCatalogUtils() {
+	// A directory listing held in the listing cache. The entries are
+	// sorted by name; the other sort orders are built the first time
+	// they are asked for and kept with the listing.
+	struct cached_listing {
+		time_t dir_mtime;
+		time_t built;
+		unsigned long last_used;
+		listing entries;
+		map<string, vector<unsigned long> > orders;
+	};
+	map<string, cached_listing> _listing_cache;
+	unsigned long _listing_cache_size;
+	unsigned long _listing_cache_entries;
+	unsigned long _listing_cache_clock;
+
+	BESCatalogUtils() :
+		_follow_syms(false), _listing_cache_size(0), _listing_cache_entries(0), _listing_cache_clock(0) {
 	}
 
 	static void bes_get_stat_info(BESCatalogEntry *entry, struct stat &buf);
+	static void bes_get_stat_info(BESCatalogEntry *entry, off_t size, time_t mod);
+
+	void build_listing(DIR *dip, const string &fullnode, listing &entries);
+	void purge_listing_cache(const string &keep);
+	const vector<unsigned long> &get_order(cached_listing &cached, const string &sort);
 public:
 	BESCatalogUtils(const string &name);
 	virtual ~BESCatalogUtils() {}
@@ -96,6 +130,17 @@ public:
 			const string &use_node, const string &coi, BESCatalogEntry *entry,
 			bool dirs_only);
 
+	virtual unsigned int get_entries(DIR *dip, const string &fullnode,
+			const string &use_node, const string &coi, BESCatalogEntry *entry,
+			bool dirs_only, const BESCatalogPage &page);
+
+	unsigned long get_listing_cache_size() const {
+		return _listing_cache_size;
+	}
+
+	static void sort_entries(BESCatalogEntry *entry, const BESCatalogPage &page,
+			vector<BESCatalogEntry *> &sorted);
+
 	static void display_entry(BESCatalogEntry *entry, BESInfo *info);
 
 	static void bes_add_stat_info(BESCatalogEntry *entry,
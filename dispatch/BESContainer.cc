@@ -58,6 +58,32 @@ void BESContainer::_duplicate(BESContainer &copy_to)
     copy_to._attributes = _attributes;
 }
 
+void BESContainer::set_request_object(const string &name, BESObj *obj)
+{
+    map<string, BESObj *>::iterator i = _request_objects.find(name);
+    if (i != _request_objects.end()) {
+        if (i->second == obj) return;
+        delete i->second;
+    }
+
+    _request_objects[name] = obj;
+}
+
+BESObj *BESContainer::get_request_object(const string &name) const
+{
+    map<string, BESObj *>::const_iterator i = _request_objects.find(name);
+    return (i != _request_objects.end()) ? i->second : 0;
+}
+
+void BESContainer::clear_request_objects()
+{
+    map<string, BESObj *>::iterator i = _request_objects.begin();
+    for (; i != _request_objects.end(); i++)
+        delete i->second;
+
+    _request_objects.clear();
+}
+
 /** @brief dumps information about this object
  *
  * Displays the pointer value of this instance along with information about
@@ -76,6 +102,7 @@ void BESContainer::dump(ostream &strm) const
     strm << BESIndent::LMarg << "dap4_constraint: " << _dap4_constraint << endl;
     strm << BESIndent::LMarg << "dap4_function: " << _dap4_function << endl;
     strm << BESIndent::LMarg << "attributes: " << _attributes << endl;
+    strm << BESIndent::LMarg << "request objects: " << _request_objects.size() << endl;
     BESIndent::UnIndent();
 }
 
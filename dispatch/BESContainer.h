@@ -34,9 +34,11 @@
 #define BESContainer_h_ 1
 
 #include <list>
+#include <map>
 #include <string>
 
 using std::list;
+using std::map;
 using std::string;
 
 #include "BESObj.h"
@@ -66,6 +68,11 @@ private:
     string _dap4_constraint;
     string _dap4_function;
     string _attributes;
+
+    // Objects kept with the container for the rest of one request; owned here
+    map<string, BESObj *> _request_objects;
+
+    BESContainer &operator=(const BESContainer &);
 protected:
     BESContainer()
     {
@@ -91,6 +98,7 @@ public:
 
     virtual ~BESContainer()
     {
+        clear_request_objects();
     }
 
     /** @brief pure abstract method to duplicate this instances of BESContainer
@@ -233,6 +241,29 @@ public:
     virtual string access() = 0;
     virtual bool release() = 0;
 
+    /** @brief keep an object with this container until the request ends
+     *
+     * The commands of a batched request share their containers, so an
+     * object that one of them builds from the container (e.g., a DDS) can
+     * be used by the others. The container takes ownership of the object,
+     * replacing any held under the same name. Request objects are not
+     * copied with the container.
+     *
+     * @param name name of the object
+     * @param obj object to keep
+     */
+    void set_request_object(const string &name, BESObj *obj);
+
+    /** @brief find an object kept with set_request_object()
+     *
+     * @param name name of the object
+     * @return the object, still owned by the container, or null
+     */
+    BESObj *get_request_object(const string &name) const;
+
+    /// Delete the objects kept with this container; done when the request ends
+    void clear_request_objects();
+
     virtual void dump(ostream &strm) const;
 };
 
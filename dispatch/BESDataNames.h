@@ -48,6 +48,9 @@
 
 #define REQUEST_ID "reqID"
 
+/// A request attribute; if "true" the request may hold several commands with responses
+#define BATCH_REQUEST "batch"
+
 /// The IP and port numbers from which the BES read this information.
 #define REQUEST_FROM "from"
 
@@ -34,6 +34,7 @@
 
 #include <time.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include <fstream>
 #include <iostream>
@@ -132,6 +133,29 @@ void BESDebug::SetUp(const string &values)
  *
  * @return the pid as a string
  */
+static pthread_key_t silent_key;
+static pthread_once_t silent_key_once = PTHREAD_ONCE_INIT;
+
+static void make_silent_key()
+{
+    (void) pthread_key_create(&silent_key, 0);
+}
+
+void BESDebug::SetThreadSilent(bool silent)
+{
+    (void) pthread_once(&silent_key_once, make_silent_key);
+    // Any non-null value will do; the key only records a flag
+    (void) pthread_setspecific(silent_key, silent ? &silent_key : 0);
+}
+
+bool BESDebug::IsThreadSilent()
+{
+    // Only called by IsSet() for contexts that are on, so this is cheap
+    // enough when debugging is off
+    (void) pthread_once(&silent_key_once, make_silent_key);
+    return pthread_getspecific(silent_key) != 0;
+}
+
 string BESDebug::GetPidStr()
 {
     ostringstream strm;
@@ -164,15 +164,29 @@ public:
     {
         debug_citer i = _debug_map.find(flagName);
         if (i != _debug_map.end())
-            return (*i).second;
+            return (*i).second && !IsThreadSilent();
         else
             i = _debug_map.find("all");
         if (i != _debug_map.end())
-            return (*i).second;
+            return (*i).second && !IsThreadSilent();
         else
             return false;
     }
 
+    /** @brief turn debug (and timing) output off for the calling thread
+     *
+     * The debug stream is not thread safe. Threads that run handler code
+     * alongside the main thread (e.g., the DAP prefetch workers) call this
+     * so that IsSet() is false for them and they write nothing to the
+     * stream. It has no effect on other threads.
+     *
+     * @param silent true to silence the calling thread, false to undo that
+     */
+    static void SetThreadSilent(bool silent);
+
+    /** @brief is debug output turned off for the calling thread? */
+    static bool IsThreadSilent();
+
     /** @brief return the debug stream
      *
      * Can be a file output stream or cerr
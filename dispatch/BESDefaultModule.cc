@@ -48,6 +48,8 @@ using std::endl ;
 #endif
 
 #include "BESStatusResponseHandler.h"
+#include "BESTraceResponseHandler.h"
+#include "BESMetricsResponseHandler.h"
 #include "BESServicesResponseHandler.h"
 #include "BESStreamResponseHandler.h"
 
@@ -104,6 +106,12 @@ BESDefaultModule::initialize(int, char**)
     BESDEBUG( "bes", "    adding " << STATUS_RESPONSE << " response handler" << endl ) ;
     BESResponseHandlerList::TheList()->add_handler( STATUS_RESPONSE, BESStatusResponseHandler::StatusResponseBuilder ) ;
 
+    BESDEBUG( "bes", "    adding " << SHOW_TRACE << " response handler" << endl ) ;
+    BESResponseHandlerList::TheList()->add_handler( SHOW_TRACE, BESTraceResponseHandler::TraceResponseBuilder ) ;
+
+    BESDEBUG( "bes", "    adding " << SHOW_METRICS << " response handler" << endl ) ;
+    BESResponseHandlerList::TheList()->add_handler( SHOW_METRICS, BESMetricsResponseHandler::MetricsResponseBuilder ) ;
+
     BESDEBUG( "bes", "    adding " << SERVICE_RESPONSE << " response handler" << endl ) ;
     BESResponseHandlerList::TheList()->add_handler( SERVICE_RESPONSE, BESServicesResponseHandler::ResponseBuilder ) ;
 
@@ -184,6 +192,8 @@ BESDefaultModule::terminate(void)
 
     BESResponseHandlerList::TheList()->remove_handler( VERS_RESPONSE ) ;
     BESResponseHandlerList::TheList()->remove_handler( STATUS_RESPONSE ) ;
+    BESResponseHandlerList::TheList()->remove_handler( SHOW_TRACE ) ;
+    BESResponseHandlerList::TheList()->remove_handler( SHOW_METRICS ) ;
     BESResponseHandlerList::TheList()->remove_handler( SERVICE_RESPONSE ) ;
     BESResponseHandlerList::TheList()->remove_handler( STREAM_RESPONSE ) ;
     BESResponseHandlerList::TheList()->remove_handler( SETCONTAINER ) ;
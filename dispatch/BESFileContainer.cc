@@ -91,6 +91,10 @@ string BESFileContainer::access()
 {
     BESDEBUG("cache2", "Entering " << __PRETTY_FUNCTION__ <<", real_name: " << get_real_name() << endl);
 
+    // Several commands in one (batched) request may use the same container;
+    // the first access() holds the lock on the cached file until release().
+    if (_cached) return _target;
+
     // Get a pointer to the singleton cache instance for this process.
     BESUncompressCache *cache = BESUncompressCache::get_instance();
 
@@ -121,8 +125,10 @@ string BESFileContainer::access()
 bool BESFileContainer::release()
 {
     BESDEBUG("cache2", "Entering " << __PRETTY_FUNCTION__ <<", _cached: " << _cached << ", _target: " << _target << endl);
-    if (_cached)
+    if (_cached) {
     	BESUncompressCache::get_instance()->unlock_and_close(_target);
+    	_cached = false;
+    }
 
     return true;
 }
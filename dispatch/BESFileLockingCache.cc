@@ -49,6 +49,7 @@
 #include "BESUtil.h"
 #include "BESDebug.h"
 #include "BESLog.h"
+#include "BESMetrics.h"
 
 #include "BESFileLockingCache.h"
 
@@ -492,6 +493,7 @@ bool BESFileLockingCache::get_read_lock(const string &target, int &fd)
     if ((fd == -1) && (fd = open(target.c_str(), O_RDONLY)) < 0) {
         switch (errno) {
         case ENOENT:
+            BESMetrics::count("bes_cache_misses_total{cache=\"" + d_prefix + "\"}");
             return false;   // The file does not exist
 
         default:
@@ -511,6 +513,8 @@ bool BESFileLockingCache::get_read_lock(const string &target, int &fd)
 
     unlock_cache();
 
+    BESMetrics::count((status ? "bes_cache_hits_total{cache=\"" : "bes_cache_misses_total{cache=\"") + d_prefix + "\"}");
+
     return status;
 }
 
@@ -906,6 +910,8 @@ void BESFileLockingCache::update_and_purge(const string &new_file)
 
                     unlock(cfile_fd);
                     computed_size -= i->size;
+
+                    BESMetrics::count("bes_cache_evictions_total{cache=\"" + d_prefix + "\"}");
                 }
                 ++i;
 
@@ -64,6 +64,7 @@
 
 #include "BESDebug.h"
 #include "BESStopWatch.h"
+#include "BESMetrics.h"
 #include "BESTimeoutError.h"
 #include "BESInternalError.h"
 #include "BESInternalFatalError.h"
@@ -213,7 +214,7 @@ static void wait_for_timeout()
 #endif
 
 BESInterface::BESInterface(ostream *output_stream) :
-    d_strm(output_stream), d_timeout_from_keys(0), d_dhi_ptr(0), d_transmitter(0)
+    d_strm(output_stream), d_timeout_from_keys(0), d_dhi_ptr(0), d_transmitter(0), d_response_framer(0)
 {
     if (!d_strm) {
         throw BESInternalError("Output stream must be set in order to output responses", __FILE__, __LINE__);
@@ -291,7 +292,7 @@ int BESInterface::execute_request(const string &from)
     }
 
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) {
+    if (BESISTIMING) {
         // It would be great to have more info to put here, but that is buried in
         // BESXMLInterface::build_data_request_plan() where the XML document is
         // parsed. jhrg 11/9/17
@@ -323,6 +324,7 @@ int BESInterface::execute_request(const string &from)
     //
     // TODO status is not used. jhrg 11/9/17
     int status = 0; // save the return status from exception_manager() and return that.
+    BESMetrics::gauge("bes_requests_in_flight", 1);
     try {
         VERBOSE(/*d_dhi_ptr->data[SERVER_PID] << " from " <<*/ d_dhi_ptr->data[REQUEST_FROM] << " request received" << endl);
 
@@ -398,6 +400,8 @@ int BESInterface::execute_request(const string &from)
         status = exception_manager(ex);
     }
 
+    BESMetrics::gauge("bes_requests_in_flight", -1);
+
 #if 0
     delete bes_timing::elapsedTimeToReadStart;
     bes_timing::elapsedTimeToReadStart = 0;
@@ -479,6 +483,10 @@ void BESInterface::end_request()
  */
 int BESInterface::exception_manager(BESError &e)
 {
+    ostringstream errors;
+    errors << "bes_request_errors_total{type=\"" << e.get_error_type() << "\"}";
+    BESMetrics::count(errors.str());
+
     return BESExceptionManager::TheEHM()->handle_exception(e, *d_dhi_ptr);
 }
 
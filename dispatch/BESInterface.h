@@ -113,6 +113,26 @@ class BESDataHandlerInterface;
  @see BESReporter
  */
 class BESInterface: public BESObj {
+public:
+    /**
+     * @brief Separate the responses of a request that has several
+     *
+     * A batched request (see BESXMLInterface) writes several responses to
+     * the output stream. The server provides an instance of this so that
+     * each response except the last is ended the way a whole request is
+     * (the last is ended by the server as usual).
+     */
+    class ResponseFramer {
+    public:
+        virtual ~ResponseFramer() { }
+
+        /// The response that follows is an error (call before writing it)
+        virtual void error(int status) = 0;
+
+        /// The response is complete and more follow
+        virtual void end_response() = 0;
+    };
+
 private:
     ostream *d_strm;
     int d_timeout_from_keys; ///< Command timeout; can be overridden using setContext
@@ -120,6 +140,7 @@ private:
 protected:
     BESDataHandlerInterface *d_dhi_ptr; ///< Allocated by the child class
     BESTransmitter *d_transmitter;  ///< The Transmitter to use for the result
+    ResponseFramer *d_response_framer;  ///< Null unless the server frames batched responses
 
     virtual int exception_manager(BESError &e);
 
@@ -146,6 +167,8 @@ public:
 
     virtual int finish(int status);
 
+    void set_response_framer(ResponseFramer *framer) { d_response_framer = framer; }
+
     virtual void dump(ostream &strm) const;
 };
 
@@ -0,0 +1,85 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "config.h"
+
+#include <sys/mman.h>
+
+#include <new>
+#include <cstring>
+#include <cerrno>
+
+#include "BESListenerLoad.h"
+#include "BESInternalError.h"
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+using namespace std;
+
+BESListenerLoad::Load *BESListenerLoad::d_load = 0;
+
+/**
+ * @brief Make the shared values
+ *
+ * Call this in the master beslistener before any child listener is
+ * started. Calling it again only resets the limits.
+ *
+ * @param max_children The most child listeners; 0 for no limit
+ * @param queue_size The most connections that can wait
+ * @param queue_timeout How long, in seconds, a connection can wait
+ */
+void BESListenerLoad::initialize(long max_children, long queue_size, long queue_timeout)
+{
+    if (!d_load) {
+        void *region = mmap(0, sizeof(Load), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED)
+            throw BESInternalError(string("Could not map the listener load values: ") + strerror(errno), __FILE__,
+                __LINE__);
+
+        d_load = new (region) Load;
+    }
+
+    d_load->max_children = max_children;
+    d_load->queue_size = queue_size;
+    d_load->queue_timeout = queue_timeout;
+}
+
+/// Count a connection that was turned away
+void BESListenerLoad::rejected(bool timed_out)
+{
+    if (!d_load) return;
+
+    ++d_load->rejected;
+    if (timed_out) ++d_load->timed_out;
+}
+
+/**
+ * @brief Get a copy of the values
+ * @return False if the values were never made (e.g., in besstandalone)
+ */
+bool BESListenerLoad::get(Load &load)
+{
+    if (!d_load) return false;
+
+    load = *d_load;
+    return true;
+}
@@ -0,0 +1,68 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef DISPATCH_BESLISTENERLOAD_H_
+#define DISPATCH_BESLISTENERLOAD_H_
+
+/**
+ * @brief How busy the master beslistener is
+ *
+ * The master beslistener limits the number of child listeners it runs at
+ * one time and queues the connections that arrive when that many are
+ * running (see PPTServer::set_admission()). Those values are held in a
+ * small anonymous shared mapping that the master makes before it starts
+ * any children; the children inherit it, so a child answering 'show
+ * status' reports the master's current values.
+ *
+ * Only the master writes the values and it has one thread, so no locking
+ * is used; a reader may see values from two slightly different times.
+ */
+class BESListenerLoad {
+public:
+    /// A copy of the values
+    struct Load {
+        long children;          ///< Child listeners running now
+        long max_children;      ///< 0 if there is no limit
+        long queued;            ///< Connections waiting for a child
+        long queue_size;        ///< The most connections that can wait
+        long queue_timeout;     ///< Seconds a connection can wait
+        long rejected;          ///< Connections turned away since the start
+        long timed_out;         ///< Of those, the ones that waited too long
+
+        Load() : children(0), max_children(0), queued(0), queue_size(0), queue_timeout(0), rejected(0), timed_out(0) { }
+    };
+
+private:
+    static Load *d_load;
+
+    BESListenerLoad() { }
+
+public:
+    static void initialize(long max_children, long queue_size, long queue_timeout);
+    static bool initialized() { return d_load != 0; }
+
+    static void set_children(long n) { if (d_load) d_load->children = n; }
+    static void set_queued(long n) { if (d_load) d_load->queued = n; }
+    static void rejected(bool timed_out);
+
+    static bool get(Load &load);
+};
+
+#endif /* DISPATCH_BESLISTENERLOAD_H_ */
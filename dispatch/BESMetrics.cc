@@ -0,0 +1,507 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "BESMetrics.h"
+#include "BESUncompressCache.h"
+#include "BESInternalError.h"
+#include "TheBESKeys.h"
+#include "BESUtil.h"
+#include "BESDebug.h"
+#include "BESLog.h"
+
+using namespace std;
+
+BESMetrics *BESMetrics::d_instance = 0;
+bool BESMetrics::d_enabled = true;
+pthread_once_t BESMetrics::d_init_once = PTHREAD_ONCE_INIT;
+
+const string BESMetrics::ENABLED_KEY = "BES.Metrics.Enabled";
+const string BESMetrics::FILE_KEY = "BES.Metrics.File";
+const string BESMetrics::PROMETHEUS_FILE_KEY = "BES.Metrics.Prometheus.File";
+const string BESMetrics::PROMETHEUS_INTERVAL_KEY = "BES.Metrics.Prometheus.Interval";
+
+// Made in the uncompress cache directory if BES.Metrics.File is not set
+static const char *DEFAULT_METRICS_FILE = "bes_metrics";
+static const char METRICS_MAGIC[8] = { 'B', 'E', 'S', 'M', 'E', 'T', 'R', '1' };
+
+// Slot states
+static const int SLOT_EMPTY = 0;
+static const int SLOT_BUSY = 1;     // Another process is naming the slot
+static const int SLOT_READY = 2;
+
+struct metrics_header {
+    char magic[8];
+    unsigned int num_slots;
+    unsigned int num_buckets;
+};
+
+/// The shared representation of one metric. All fields are zero in a new file.
+struct BESMetrics::Slot {
+    volatile int state;
+    int type;
+    char name[NAME_SIZE];
+    volatile long long value;
+    volatile unsigned long long sum;
+    volatile unsigned long long buckets[NUM_BUCKETS];
+};
+
+static string errno_msg(const string &msg)
+{
+    return msg + ": " + strerror(errno);
+}
+
+/**
+ * @brief Map the metrics file
+ *
+ * The file is never reached through a symbolic link and must belong to
+ * this process' user. A file that holds something other than metrics is
+ * never changed.
+ *
+ * @param file The file that holds the metrics
+ * @param writable If true, open the file for update, making it (or
+ * reinitializing it if it is empty or a metrics file of another layout) if
+ * needed. If false, the file must exist and is only read.
+ * @exception BESInternalError if the file cannot be opened or mapped or
+ * it is not a metrics file.
+ */
+BESMetrics::BESMetrics(const string &file, bool writable) :
+    d_file(file), d_region(0), d_region_size(sizeof(metrics_header) + NUM_SLOTS * sizeof(Slot)), d_writable(writable)
+{
+    pthread_mutex_init(&d_slots_mutex, 0);
+
+    int fd;
+    if (writable) {
+        fd = open(file.c_str(), O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW, 0644);
+        if (fd < 0 && errno == EEXIST) fd = open(file.c_str(), O_RDWR | O_NOFOLLOW);
+    }
+    else {
+        fd = open(file.c_str(), O_RDONLY | O_NOFOLLOW);
+    }
+    if (fd < 0) throw BESInternalError(errno_msg("Could not open the metrics file " + file), __FILE__, __LINE__);
+
+    // Serialize setting up the file. The lock must be released explicitly;
+    // the mapping holds the open file (and so the lock) after fd is closed.
+    if (flock(fd, writable ? LOCK_EX : LOCK_SH) < 0) {
+        string msg = errno_msg("Could not lock the metrics file " + file);
+        close(fd);
+        throw BESInternalError(msg, __FILE__, __LINE__);
+    }
+
+    struct stat buf;
+    if (fstat(fd, &buf) != 0 || !S_ISREG(buf.st_mode) || (writable && buf.st_uid != geteuid())) {
+        close(fd);
+        throw BESInternalError("The metrics file " + file + " is not a regular file owned by this user.", __FILE__,
+            __LINE__);
+    }
+
+    metrics_header header;
+    memset(&header, 0, sizeof(header));
+    bool read_header = pread(fd, &header, sizeof(header), 0) == sizeof(header);
+    bool metrics_file = read_header && memcmp(header.magic, METRICS_MAGIC, sizeof(METRICS_MAGIC) - 1) == 0;
+    bool valid = metrics_file && (size_t) buf.st_size == d_region_size
+        && memcmp(header.magic, METRICS_MAGIC, sizeof(METRICS_MAGIC)) == 0 && header.num_slots == NUM_SLOTS
+        && header.num_buckets == NUM_BUCKETS;
+
+    if (!valid) {
+        // Only a new (empty) file or one made by another version of the
+        // BES is (re)initialized
+        if (!writable || !(buf.st_size == 0 || metrics_file)) {
+            close(fd);
+            throw BESInternalError("The file " + file + " does not hold BES metrics.", __FILE__, __LINE__);
+        }
+
+        // Truncating to zero and then extending the file zeros it
+        memcpy(header.magic, METRICS_MAGIC, sizeof(METRICS_MAGIC));
+        header.num_slots = NUM_SLOTS;
+        header.num_buckets = NUM_BUCKETS;
+        if (ftruncate(fd, 0) < 0 || ftruncate(fd, d_region_size) < 0
+            || pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+            string msg = errno_msg("Could not initialize the metrics file " + file);
+            close(fd);
+            throw BESInternalError(msg, __FILE__, __LINE__);
+        }
+    }
+
+    d_region = mmap(0, d_region_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    int map_errno = errno;
+    flock(fd, LOCK_UN);
+    close(fd);
+    if (d_region == MAP_FAILED) {
+        d_region = 0;
+        errno = map_errno;
+        throw BESInternalError(errno_msg("Could not map the metrics file " + file), __FILE__, __LINE__);
+    }
+}
+
+BESMetrics::~BESMetrics()
+{
+    if (d_region) munmap(d_region, d_region_size);
+
+    pthread_mutex_destroy(&d_slots_mutex);
+}
+
+void BESMetrics::delete_instance()
+{
+    delete d_instance;
+    d_instance = 0;
+}
+
+// Make the registry, if metrics are enabled. Run once, by TheMetrics().
+void BESMetrics::initialize()
+{
+    bool found = false;
+    string value;
+    TheBESKeys::TheKeys()->get_value(ENABLED_KEY, value, found);
+    if (!found || BESUtil::lowercase(value) != "true") {
+        d_enabled = false;
+        return;
+    }
+
+    string file = get_file();
+    if (file.empty()) {
+        d_enabled = false;
+        LOG("Metrics are disabled: neither " << FILE_KEY << " nor " << BESUncompressCache::DIR_KEY << " is set." << endl);
+        return;
+    }
+
+    try {
+        d_instance = new BESMetrics(file, true);
+#ifdef HAVE_ATEXIT
+        atexit(delete_instance);
+#endif
+        BESDEBUG("bes", "BESMetrics::" << __func__ << "() - Metrics are ENABLED, using " << file << endl);
+    }
+    catch (BESError &e) {
+        d_enabled = false;
+        LOG("Metrics are disabled: " << e.get_message() << endl);
+    }
+}
+
+/**
+ * @brief Get the metrics registry for this process
+ *
+ * The master beslistener calls this before it starts handling requests so
+ * that its children share its mapping of the metrics file. The registry is
+ * made only once, even if threads call this at the same time.
+ *
+ * @return The registry or null if metrics are not enabled (or the file
+ * could not be used)
+ */
+BESMetrics *
+BESMetrics::TheMetrics()
+{
+    if (d_enabled) pthread_once(&d_init_once, initialize);
+
+    return d_instance;
+}
+
+/**
+ * @brief The name of the shared metrics file
+ * @return The value of BES.Metrics.File or, if that is not set, the file
+ * 'bes_metrics' in the uncompress cache directory. The empty string if
+ * neither key is set.
+ */
+string
+BESMetrics::get_file()
+{
+    bool found = false;
+    string file;
+    TheBESKeys::TheKeys()->get_value(FILE_KEY, file, found);
+    if (found && !file.empty()) return file;
+
+    string dir;
+    TheBESKeys::TheKeys()->get_value(BESUncompressCache::DIR_KEY, dir, found);
+    if (!found || dir.empty()) return "";
+
+    return BESUtil::assemblePath(dir, DEFAULT_METRICS_FILE);
+}
+
+/**
+ * @brief The histogram bucket for a value
+ *
+ * Values less than four have their own buckets; above that each power of
+ * two is divided into four equal buckets.
+ */
+unsigned int BESMetrics::bucket(unsigned long long value)
+{
+    if (value < 4) return value;
+
+    unsigned int e = 63 - __builtin_clzll(value);   // value is in [2^e, 2^(e+1))
+    unsigned int sub = (value >> (e - 2)) & 3;
+    unsigned int b = 4 + (e - 2) * 4 + sub;
+
+    return min(b, NUM_BUCKETS - 1);
+}
+
+/// @return The smallest value larger than those in the bucket
+unsigned long long BESMetrics::bucket_upper_bound(unsigned int bucket)
+{
+    if (bucket < 4) return bucket + 1;
+
+    unsigned int e = (bucket - 4) / 4 + 2;
+    unsigned int sub = (bucket - 4) % 4;
+    return (5ULL + sub) << (e - 2);
+}
+
+/**
+ * @brief Estimate a quantile of a histogram
+ * @param q The quantile, e.g. 0.99
+ * @return The upper bound of the bucket that holds the quantile (so, for
+ * durations, microseconds); zero if the histogram is empty
+ */
+double BESMetrics::Metric::quantile(double q) const
+{
+    if (value <= 0 || buckets.empty()) return 0;
+
+    double target = q * value;
+    unsigned long long cumulative = 0;
+    for (unsigned int b = 0; b < buckets.size(); ++b) {
+        cumulative += buckets[b];
+        if (cumulative > 0 && cumulative >= target) return bucket_upper_bound(b);
+    }
+
+    return bucket_upper_bound(buckets.size() - 1);
+}
+
+BESMetrics::Slot *
+BESMetrics::slot(unsigned int i) const
+{
+    return reinterpret_cast<Slot*>(static_cast<char*>(d_region) + sizeof(metrics_header)) + i;
+}
+
+/**
+ * @brief Find a metric's slot, making it if needed
+ *
+ * Slots are claimed with an atomic compare and swap, so processes can make
+ * metrics at the same time.
+ *
+ * @return The slot or null if the name is too long, the metric exists with
+ * another type or the registry is full
+ */
+BESMetrics::Slot *
+BESMetrics::find(const string &name, metric_type type)
+{
+    pthread_mutex_lock(&d_slots_mutex);
+    Slot *s = find_slot(name, type);
+    pthread_mutex_unlock(&d_slots_mutex);
+
+    return s;
+}
+
+// Call with d_slots_mutex locked
+BESMetrics::Slot *
+BESMetrics::find_slot(const string &name, metric_type type)
+{
+    map<string, Slot*>::iterator cached = d_slots.find(name);
+    if (cached != d_slots.end()) return cached->second->type == type ? cached->second : 0;
+
+    if (name.length() >= NAME_SIZE) return 0;
+
+    for (unsigned int i = 0; i < NUM_SLOTS; ++i) {
+        Slot *s = slot(i);
+
+        if (s->state == SLOT_EMPTY && d_writable
+            && __sync_bool_compare_and_swap(&s->state, SLOT_EMPTY, SLOT_BUSY)) {
+            strncpy(s->name, name.c_str(), NAME_SIZE - 1);
+            s->type = type;
+            __sync_synchronize();
+            s->state = SLOT_READY;
+
+            d_slots[name] = s;
+            return s;
+        }
+
+        // Another process is naming this slot
+        while (s->state == SLOT_BUSY)
+            sched_yield();
+
+        if (s->state == SLOT_READY && name == s->name) {
+            if (s->type != type) return 0;
+
+            d_slots[name] = s;
+            return s;
+        }
+
+        if (s->state == SLOT_EMPTY) return 0;   // Only when the registry is read-only
+    }
+
+    return 0;
+}
+
+/// Add to a counter or gauge
+void BESMetrics::add(const string &name, metric_type type, long long n)
+{
+    Slot *s = find(name, type);
+    if (s) __sync_fetch_and_add(&s->value, n);
+}
+
+/// Record a value in a histogram
+void BESMetrics::record(const string &name, unsigned long long value)
+{
+    Slot *s = find(name, histogram_type);
+    if (!s) return;
+
+    __sync_fetch_and_add(&s->buckets[bucket(value)], 1ULL);
+    __sync_fetch_and_add(&s->sum, value);
+    __sync_fetch_and_add(&s->value, 1LL);
+}
+
+/**
+ * @brief Set all of the gauges to zero
+ *
+ * The master beslistener calls this when it starts, since the values left
+ * by an earlier master's children (which may have died while holding a
+ * gauge up) are no longer meaningful. Counters and histograms are kept.
+ */
+void BESMetrics::reset_gauges()
+{
+    for (unsigned int i = 0; i < NUM_SLOTS; ++i) {
+        Slot *s = slot(i);
+        if (s->state == SLOT_READY && s->type == gauge_type) __sync_lock_test_and_set(&s->value, 0LL);
+    }
+}
+
+static bool metric_name_less(const BESMetrics::Metric &a, const BESMetrics::Metric &b)
+{
+    return a.name < b.name;
+}
+
+/// @return A copy of all of the metrics, sorted by name
+vector<BESMetrics::Metric> BESMetrics::get_metrics() const
+{
+    vector<Metric> metrics;
+    for (unsigned int i = 0; i < NUM_SLOTS; ++i) {
+        const Slot *s = slot(i);
+        if (s->state != SLOT_READY) continue;
+
+        Metric m;
+        m.name = string(s->name, strnlen(s->name, NAME_SIZE));
+        m.type = static_cast<metric_type>(s->type);
+        m.value = s->value;
+        if (m.type == histogram_type) {
+            m.sum = s->sum;
+            m.buckets.assign(s->buckets, s->buckets + NUM_BUCKETS);
+        }
+
+        metrics.push_back(m);
+    }
+
+    sort(metrics.begin(), metrics.end(), metric_name_less);
+
+    return metrics;
+}
+
+// Split 'name{labels}' into 'name' and 'labels'
+static void split_name(const string &metric, string &name, string &labels)
+{
+    string::size_type brace = metric.find('{');
+    if (brace == string::npos || metric[metric.length() - 1] != '}') {
+        name = metric;
+        labels = "";
+    }
+    else {
+        name = metric.substr(0, brace);
+        labels = metric.substr(brace + 1, metric.length() - brace - 2);
+    }
+}
+
+static string with_labels(const string &name, const string &labels, const string &more = "")
+{
+    if (labels.empty() && more.empty()) return name;
+    if (labels.empty()) return name + "{" + more + "}";
+    if (more.empty()) return name + "{" + labels + "}";
+    return name + "{" + labels + "," + more + "}";
+}
+
+/**
+ * @brief Write the metrics in the Prometheus text exposition format
+ *
+ * Histograms are written in seconds; only the buckets up to the largest
+ * one used are written.
+ */
+void BESMetrics::write_prometheus(ostream &out) const
+{
+    vector<Metric> metrics = get_metrics();
+
+    string last_name;
+    for (vector<Metric>::const_iterator m = metrics.begin(), e = metrics.end(); m != e; ++m) {
+        string name, labels;
+        split_name(m->name, name, labels);
+
+        if (name != last_name) {
+            out << "# TYPE " << name << " "
+                << (m->type == counter_type ? "counter" : (m->type == gauge_type ? "gauge" : "histogram")) << "\n";
+            last_name = name;
+        }
+
+        if (m->type != histogram_type) {
+            out << m->name << " " << m->value << "\n";
+            continue;
+        }
+
+        unsigned int last = 0;
+        for (unsigned int b = 0; b < m->buckets.size(); ++b)
+            if (m->buckets[b]) last = b;
+
+        unsigned long long cumulative = 0;
+        for (unsigned int b = 0; b <= last && m->value > 0; ++b) {
+            cumulative += m->buckets[b];
+            ostringstream le;
+            le << "le=\"" << bucket_upper_bound(b) / 1.0e6 << "\"";
+            out << with_labels(name + "_bucket", labels, le.str()) << " " << cumulative << "\n";
+        }
+        out << with_labels(name + "_bucket", labels, "le=\"+Inf\"") << " " << m->value << "\n";
+        out << with_labels(name + "_sum", labels) << " " << m->sum / 1.0e6 << "\n";
+        out << with_labels(name + "_count", labels) << " " << m->value << "\n";
+    }
+
+    out.flush();
+}
+
+/// Write the Prometheus text to a file, replacing it atomically
+void BESMetrics::write_prometheus_file(const string &file) const
+{
+    string tmp = file + ".tmp";
+    {
+        ofstream out(tmp.c_str(), ios::out | ios::trunc);
+        if (!out) throw BESInternalError(errno_msg("Could not write the metrics to " + tmp), __FILE__, __LINE__);
+        write_prometheus(out);
+    }
+
+    if (rename(tmp.c_str(), file.c_str()) != 0)
+        throw BESInternalError(errno_msg("Could not rename " + tmp + " to " + file), __FILE__, __LINE__);
+}
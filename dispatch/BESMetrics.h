@@ -0,0 +1,157 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef DISPATCH_BESMETRICS_H_
+#define DISPATCH_BESMETRICS_H_
+
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+
+/**
+ * @brief Counters, gauges and histograms shared by all of the beslisteners
+ *
+ * The metrics live in a file that is mapped (shared) into memory. The
+ * master beslistener creates the file when it starts; its children
+ * inherit the mapping, so every child adds to the same values and no
+ * messages are needed to combine them. The besdaemon (or any other
+ * program) can map the same file to read the values.
+ *
+ * A metric is named by a string in the Prometheus style, including any
+ * labels, e.g., 'bes_requests_total{action="get.dods"}'. A metric is made
+ * the first time it is used; the registry holds a fixed number of them and
+ * metrics used after it is full are ignored.
+ *
+ * Histograms are log-linear: each power of two is split into four
+ * buckets, so a recorded value is known to within 25%. They are used for
+ * durations in microseconds and reported in seconds.
+ *
+ * The static methods (count(), gauge() and observe()) do nothing if metrics
+ * are not enabled, so they can be called freely, from any thread.
+ *
+ * A gauge is only as good as the code that lowers it: if a beslistener
+ * dies while it holds a gauge up (e.g., bes_requests_in_flight during a
+ * request that crashes), the gauge stays too high until the master
+ * beslistener restarts and calls reset_gauges(). The children are not the
+ * master's own children (they are forked twice), so the master cannot
+ * correct the gauge when one of them exits.
+ *
+ * The keys are:
+ * - BES.Metrics.Enabled: 'true' to keep metrics (default false)
+ * - BES.Metrics.File: The shared file (default 'bes_metrics' in the
+ *   BES.UncompressCache.dir directory)
+ * - BES.Metrics.Prometheus.File: If set, the besdaemon writes the metrics
+ *   in the Prometheus text format to this file
+ * - BES.Metrics.Prometheus.Interval: How often it does so, in seconds
+ *   (default 15)
+ */
+class BESMetrics {
+public:
+    enum metric_type { counter_type = 1, gauge_type = 2, histogram_type = 3 };
+
+    static const unsigned int NAME_SIZE = 128;
+    static const unsigned int NUM_SLOTS = 256;
+    static const unsigned int NUM_BUCKETS = 140;
+
+    /// A copy of one metric
+    struct Metric {
+        std::string name;
+        metric_type type;
+        long long value;                ///< The count, for a histogram
+        unsigned long long sum;         ///< Histograms only
+        std::vector<unsigned long long> buckets;    ///< Histograms only
+
+        Metric() : type(counter_type), value(0), sum(0) { }
+
+        double quantile(double q) const;
+    };
+
+    struct Slot;    // The shared representation of one metric
+
+private:
+    static BESMetrics *d_instance;
+    static bool d_enabled;
+    static pthread_once_t d_init_once;
+
+    static void initialize();
+    static void delete_instance();
+
+    std::string d_file;
+    void *d_region;
+    size_t d_region_size;
+    bool d_writable;
+
+    std::map<std::string, Slot*> d_slots;   // Per-process index of the shared slots
+    pthread_mutex_t d_slots_mutex;          // Threads (e.g., data prefetch threads) share d_slots
+
+    Slot *slot(unsigned int i) const;
+    Slot *find(const std::string &name, metric_type type);
+    Slot *find_slot(const std::string &name, metric_type type);
+
+    BESMetrics(const BESMetrics &);
+    BESMetrics &operator=(const BESMetrics &);
+
+public:
+    static const std::string ENABLED_KEY;
+    static const std::string FILE_KEY;
+    static const std::string PROMETHEUS_FILE_KEY;
+    static const std::string PROMETHEUS_INTERVAL_KEY;
+
+    BESMetrics(const std::string &file, bool writable);
+    virtual ~BESMetrics();
+
+    static BESMetrics *TheMetrics();
+    static std::string get_file();
+
+    static unsigned int bucket(unsigned long long value);
+    static unsigned long long bucket_upper_bound(unsigned int bucket);
+
+    /// Add to a counter
+    static void count(const std::string &name, long long n = 1)
+    {
+        if (d_enabled && TheMetrics()) d_instance->add(name, counter_type, n);
+    }
+
+    /// Add to (or, with a negative value, subtract from) a gauge
+    static void gauge(const std::string &name, long long n)
+    {
+        if (d_enabled && TheMetrics()) d_instance->add(name, gauge_type, n);
+    }
+
+    /// Record a duration (in microseconds) in a histogram
+    static void observe(const std::string &name, unsigned long long microseconds)
+    {
+        if (d_enabled && TheMetrics()) d_instance->record(name, microseconds);
+    }
+
+    void add(const std::string &name, metric_type type, long long n);
+    void record(const std::string &name, unsigned long long value);
+    void reset_gauges();
+
+    std::vector<Metric> get_metrics() const;
+
+    void write_prometheus(std::ostream &out) const;
+    void write_prometheus_file(const std::string &file) const;
+};
+
+#endif /* DISPATCH_BESMETRICS_H_ */
@@ -0,0 +1,151 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "BESMetricsResponseHandler.h"
+#include "BESInfoList.h"
+#include "BESInfo.h"
+#include "BESMetrics.h"
+#include "BESInternalError.h"
+#include "BESResponseNames.h"
+
+#include <sstream>
+
+using std::ostringstream ;
+using std::vector ;
+
+BESMetricsResponseHandler::BESMetricsResponseHandler( const string &name )
+    : BESResponseHandler( name )
+{
+}
+
+BESMetricsResponseHandler::~BESMetricsResponseHandler( )
+{
+}
+
+/** @brief executes the command 'show metrics;' by returning the metrics
+ * kept by the server
+ *
+ * Each metric is a 'metric' element with 'name' and 'type' attributes
+ * whose value is the metric's value. For a histogram, the value is the
+ * number of values recorded and the 'sum', 'p50', 'p90' and 'p99'
+ * attributes give their sum and percentiles in seconds. If metrics are
+ * not enabled, there are no 'metric' elements.
+ *
+ * @param dhi structure that holds request and response information
+ * @see BESDataHandlerInterface
+ * @see BESInfo
+ * @see BESMetrics
+ */
+void
+BESMetricsResponseHandler::execute( BESDataHandlerInterface &dhi )
+{
+    BESInfo *info = BESInfoList::TheList()->build_info() ;
+    _response = info ;
+
+    dhi.action_name = SHOW_METRICS_STR ;
+    info->begin_response( SHOW_METRICS_STR, dhi ) ;
+
+    BESMetrics *metrics = BESMetrics::TheMetrics() ;
+    if( metrics )
+    {
+	vector<BESMetrics::Metric> values = metrics->get_metrics() ;
+	vector<BESMetrics::Metric>::const_iterator i = values.begin() ;
+	vector<BESMetrics::Metric>::const_iterator e = values.end() ;
+	for( ; i != e; i++ )
+	{
+	    map<string,string> attrs ;
+	    attrs["name"] = i->name ;
+
+	    ostringstream value ;
+	    value << i->value ;
+
+	    if( i->type == BESMetrics::histogram_type )
+	    {
+		attrs["type"] = "histogram" ;
+
+		ostringstream sum, p50, p90, p99 ;
+		sum << i->sum / 1.0e6 ;
+		p50 << i->quantile( 0.50 ) / 1.0e6 ;
+		p90 << i->quantile( 0.90 ) / 1.0e6 ;
+		p99 << i->quantile( 0.99 ) / 1.0e6 ;
+		attrs["sum"] = sum.str() ;
+		attrs["p50"] = p50.str() ;
+		attrs["p90"] = p90.str() ;
+		attrs["p99"] = p99.str() ;
+	    }
+	    else
+	    {
+		attrs["type"] = i->type == BESMetrics::counter_type ? "counter" : "gauge" ;
+	    }
+
+	    info->add_tag( "metric", value.str(), &attrs ) ;
+	}
+    }
+
+    info->end_response() ;
+}
+
+/** @brief transmit the response object built by the execute command
+ * using the specified transmitter object
+ *
+ * If a response object was built then transmit it as text using the specified
+ * transmitter object.
+ *
+ * @param transmitter object that knows how to transmit specific basic types
+ * @param dhi structure that holds the request and response information
+ * @see BESResponseObject
+ * @see BESTransmitter
+ * @see BESDataHandlerInterface
+ */
+void
+BESMetricsResponseHandler::transmit( BESTransmitter *transmitter,
+                                  BESDataHandlerInterface &dhi )
+{
+    if( _response )
+    {
+	BESInfo *info = dynamic_cast<BESInfo *>(_response) ;
+	if( !info )
+	    throw BESInternalError( "cast error", __FILE__, __LINE__ ) ;
+	info->transmit( transmitter, dhi ) ;
+    }
+}
+
+/** @brief dumps information about this object
+ *
+ * Displays the pointer value of this instance
+ *
+ * @param strm C++ i/o stream to dump the information to
+ */
+void
+BESMetricsResponseHandler::dump( ostream &strm ) const
+{
+    strm << BESIndent::LMarg << "BESMetricsResponseHandler::dump - ("
+			     << (void *)this << ")" << endl ;
+    BESIndent::Indent() ;
+    BESResponseHandler::dump( strm ) ;
+    BESIndent::UnIndent() ;
+}
+
+BESResponseHandler *
+BESMetricsResponseHandler::MetricsResponseBuilder( const string &name )
+{
+    return new BESMetricsResponseHandler( name ) ;
+}
+
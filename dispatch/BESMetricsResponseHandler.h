@@ -0,0 +1,53 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef I_BESMetricsResponseHandler_h
+#define I_BESMetricsResponseHandler_h 1
+
+#include "BESResponseHandler.h"
+
+/** @brief response handler that returns the server's metrics
+ *
+ * A request 'show metrics;' will be handled by this response handler. It
+ * returns the counters, gauges and histograms kept by BESMetrics for all
+ * of the beslisteners in an informational response object.
+ *
+ * @see BESMetrics
+ * @see BESResponseObject
+ * @see BESContainer
+ * @see BESTransmitter
+ */
+class BESMetricsResponseHandler : public BESResponseHandler
+{
+public:
+				BESMetricsResponseHandler( const string &name ) ;
+    virtual			~BESMetricsResponseHandler( void ) ;
+
+    virtual void		execute( BESDataHandlerInterface &dhi ) ;
+    virtual void		transmit( BESTransmitter *transmitter,
+                                          BESDataHandlerInterface &dhi ) ;
+
+    virtual void		dump( ostream &strm ) const ;
+
+    static BESResponseHandler *MetricsResponseBuilder( const string &name ) ;
+};
+
+#endif // I_BESMetricsResponseHandler_h
+
@@ -45,5 +45,13 @@
  */
 #define CATALOG_OR_INFO "catalog_or_info"
 
+/*
+ * show catalog paging options; all are optional
+ */
+#define CATALOG_OFFSET "catalog_offset"
+#define CATALOG_LIMIT "catalog_limit"
+#define CATALOG_SORT "catalog_sort"
+#define CATALOG_ORDER "catalog_order"
+
 #endif // E_BESNames_H
 
@@ -126,6 +126,8 @@ void BESRequestHandler::dump(ostream &strm) const
     strm << BESIndent::LMarg << "BESRequestHandler::dump - (" << (void *) this << ")" << endl;
     BESIndent::Indent();
     strm << BESIndent::LMarg << "name: " << _name << endl;
+    strm << BESIndent::LMarg << "thread safe read: " << (_thread_safe_read ? "yes" : "no") << endl;
+    strm << BESIndent::LMarg << "reads other files: " << (_reads_other_files ? "yes" : "no") << endl;
     if (_handler_list.size()) {
         strm << BESIndent::LMarg << "registered handler functions:" << endl;
         BESIndent::Indent();
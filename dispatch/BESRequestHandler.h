@@ -75,9 +75,12 @@ class BESRequestHandler : public BESObj
 private:
     map< string, p_request_handler > _handler_list ;
     string			_name ;
+    bool			_thread_safe_read ;
+    bool			_reads_other_files ;
 public:
 				BESRequestHandler( const string &name )
-				    : _name( name ) {}
+				    : _name( name ), _thread_safe_read( false ),
+				      _reads_other_files( false ) {}
     virtual			~BESRequestHandler(void) {}
 
     typedef map< string, p_request_handler >::const_iterator Handler_citer ;
@@ -92,6 +95,30 @@ public:
 
     virtual string		get_handler_names() ;
 
+    /** @brief Can this handler's read() methods run at the same time?
+     *
+     * A handler sets this (usually in its constructor) when the read()
+     * methods of its variables may be called on different variables from
+     * different threads at once. The DAP response builder uses it to
+     * decide if variables can be read ahead of serialization. Debug and
+     * timing output is turned off in the threads that do that reading
+     * (see BESDebug::SetThreadSilent()), but anything else the read()
+     * methods share must be protected by the handler.
+     */
+    virtual void		set_thread_safe_read( bool ts ) { _thread_safe_read = ts ; }
+    virtual bool		get_thread_safe_read() const { return _thread_safe_read ; }
+
+    /** @brief Does this handler read data from files other than the container's?
+     *
+     * A handler sets this when a response depends on more than the file
+     * named by the container (e.g., an NcML aggregation or a DMR++ file
+     * that names the data files). Responses that are cached using the
+     * container's file to tell when they are out of date are not cached
+     * for such a handler.
+     */
+    virtual void		set_reads_other_files( bool rof ) { _reads_other_files = rof ; }
+    virtual bool		get_reads_other_files() const { return _reads_other_files ; }
+
     virtual void		dump( ostream &strm ) const ;
 };
 
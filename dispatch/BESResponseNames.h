@@ -91,6 +91,10 @@
 #define SHOW_CONTEXT_STR "showContext"
 #define SHOW_ERROR "show.error"
 #define SHOW_ERROR_STR "showError"
+#define SHOW_TRACE "show.trace"
+#define SHOW_TRACE_STR "showTrace"
+#define SHOW_METRICS "show.metrics"
+#define SHOW_METRICS_STR "showMetrics"
 
 #define DELETE_RESPONSE "delete"
 #define DELETE_CONTAINER "delete.container"
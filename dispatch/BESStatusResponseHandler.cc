@@ -30,12 +30,24 @@
 //      pwest       Patrick West <pwest@ucar.edu>
 //      jgarcia     Jose Garcia <jgarcia@ucar.edu>
 
+#include <sstream>
+
 #include "BESStatusResponseHandler.h"
 #include "BESInfoList.h"
 #include "BESInfo.h"
 #include "BESStatus.h"
+#include "BESListenerLoad.h"
 #include "BESResponseNames.h"
 
+using std::ostringstream;
+
+static string to_string(long n)
+{
+    ostringstream oss;
+    oss << n;
+    return oss.str();
+}
+
 BESStatusResponseHandler::BESStatusResponseHandler( const string &name )
     : BESResponseHandler( name )
 {
@@ -50,7 +62,8 @@ BESStatusResponseHandler::~BESStatusResponseHandler( )
  *
  * This response handler knows how to retrieve the status for the server
  * process handing this clients requests from BESStatus and stores it in a
- * BESInfo informational response object.
+ * BESInfo informational response object. When run by a beslistener, the
+ * response also holds the master listener's load (see BESListenerLoad).
  *
  * @param dhi structure that holds request and response information
  * @see BESDataHandlerInterface
@@ -66,6 +79,22 @@ BESStatusResponseHandler::execute( BESDataHandlerInterface &dhi )
     dhi.action_name = STATUS_RESPONSE_STR ;
     info->begin_response( STATUS_RESPONSE_STR, dhi ) ;
     info->add_tag( "status", s.get_status() ) ;
+
+    // How busy the beslistener is; not known to besstandalone
+    BESListenerLoad::Load load ;
+    if( BESListenerLoad::get( load ) )
+    {
+	info->begin_tag( "listener" ) ;
+	info->add_tag( "children", to_string( load.children ) ) ;
+	info->add_tag( "maxChildren", to_string( load.max_children ) ) ;
+	info->add_tag( "queued", to_string( load.queued ) ) ;
+	info->add_tag( "queueSize", to_string( load.queue_size ) ) ;
+	info->add_tag( "queueTimeout", to_string( load.queue_timeout ) ) ;
+	info->add_tag( "rejected", to_string( load.rejected ) ) ;
+	info->add_tag( "timedOut", to_string( load.timed_out ) ) ;
+	info->end_tag( "listener" ) ;
+    }
+
     info->end_response() ;
 }
 
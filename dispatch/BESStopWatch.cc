@@ -31,15 +31,14 @@
 //      pwest       Patrick West <pwest@ucar.edu>
 //      jgarcia     Jose Garcia <jgarcia@ucar.edu>
 
-#include <cerrno>
 #include <string>
 #include <iostream>
-#include <cstring>
 
 using std::string ;
 using std::endl ;
 
 #include "BESStopWatch.h"
+#include "BESTracer.h"
 #include "BESDebug.h"
 
 namespace bes_timing {
@@ -47,6 +46,22 @@ BESStopWatch *elapsedTimeToReadStart=0;
 BESStopWatch *elapsedTimeToTransmitStart=0;
 }
 
+/**
+ * @return True if the 'timing' debug context is set or tracing is enabled,
+ * that is, if a stop watch that is started will be used.
+ */
+bool
+BESStopWatch::is_enabled()
+{
+	return BESDebug::IsSet( TIMING_LOG ) || BESTracer::IsSet() ;
+}
+
+bool
+BESStopWatch::is_logging() const
+{
+	return BESDebug::GetStrm() && BESDebug::IsSet( _log_name ) ;
+}
+
 /**
  * Starts the timer. NB: This method will attempt to write logging
  * information to the BESDebug::GetStrm() stream.
@@ -72,41 +87,25 @@ BESStopWatch::start(string name, string reqID)
 {
 	_timer_name = name;
 	_req_id = reqID;
-	// get timing for current usage
-	if( getrusage( RUSAGE_SELF, &_start_usage ) != 0 )
+
+	_start_wall = BESTracer::wall_time() ;
+	_start_cpu = BESTracer::cpu_time() ;
+
+	BESTracer *tracer = BESTracer::TheTracer() ;
+	_traced = (tracer != 0) && !_started ;
+	if( _traced )
 	{
-		int myerrno = errno ;
-		char *c_err = strerror( myerrno ) ;
-		string err = "getrusage failed in start: " ;
-		err += (c_err != 0) ? c_err : "unknown error";
-#if 0
-		if( c_err )
-		{
-			err += c_err ;
-		}
-		else
-		{
-			err += "unknown error" ;
-		}
-#endif
-		if(BESDebug::GetStrm())
-		    *(BESDebug::GetStrm()) << "[" << BESDebug::GetPidStr() << "]["<< _log_name << "][" << _req_id << "][ERROR][" << _timer_name << "][" << err << "]" << endl;
-		_started = false ;
+		tracer->get_bytes( _start_read, _start_written ) ;
+		tracer->begin_span() ;
 	}
-	else
-	{
-		_started = true ;
-		struct timeval &start = _start_usage.ru_utime ;
-		double starttime =  start.tv_sec*1000.0 + start.tv_usec/1000.0;
 
-		if(BESDebug::GetStrm())
-    		*(BESDebug::GetStrm()) << "[" << BESDebug::GetPidStr() << "]["<< _log_name << "][" << _req_id << "][STARTED][" << starttime << "][ms]["<< _timer_name << "]" << endl;
-	}
+	_started = true ;
 
-	// either we started the stop watch, or failed to start it. Either way,
-	// no timings are available, so set stopped to false.
-	_stopped = false ;
+	if( is_logging() )
+		*(BESDebug::GetStrm()) << "[" << BESDebug::GetPidStr() << "]["<< _log_name << "][" << _req_id << "][STARTED][" << _start_wall/1000.0 << "][ms]["<< _timer_name << "]" << endl;
 
+	// no timings are available yet
+	_stopped = false ;
 
 	return _started ;
 }
@@ -116,91 +115,31 @@ BESStopWatch::start(string name, string reqID)
  * This destructor is "special" in that it's execution signals the
  * timer to stop if it has been started. Stopping the timer will
  * initiate an attempt to write logging information to the
- * BESDebug::GetStrm() stream. If the start method has not been called
- * then the method exits silently.
+ * BESDebug::GetStrm() stream and to record the span with BESTracer.
+ * If the start method has not been called then the method exits
+ * silently.
  */
 BESStopWatch::~BESStopWatch()
 {
 	// if we have started, then stop and update the log.
 	if( _started )
 	{
-		// get timing for current usage
-		if( getrusage( RUSAGE_SELF, &_stop_usage ) != 0 )
-		{
-			int myerrno = errno ;
-			char *c_err = strerror( myerrno ) ;
-			string err = "getrusage failed in stop: " ;
-			err += (c_err != 0) ? c_err : "unknown error";
-#if 0
-			if( c_err )
-			{
-				err += c_err ;
-			}
-			else
-			{
-				err += "unknown error" ;
-			}
-#endif
-		if(BESDebug::GetStrm())
-			*(BESDebug::GetStrm()) << "[" << BESDebug::GetPidStr() << "]["<< _log_name << "][" << _req_id << "][ERROR][" << _timer_name << "][" << err << "]" << endl;
-			_started = false ;
-			_stopped = false ;
-		}
-		else
-		{
-			// get the difference between the _start_usage and the
-			// _stop_usage and save the difference in _result.
-			bool success = timeval_subtract() ;
-			if( !success )
-			{
-				if(BESDebug::GetStrm())
-				    *(BESDebug::GetStrm()) << "[" << BESDebug::GetPidStr() << "]["<< _log_name << "][" << _req_id << "][ERROR][" << _timer_name << "][Failed to get timing.]" << endl;
-				_started = false ;
-				_stopped = false ;
-			}
-			else
-			{
-				_stopped = true ;
-
-				struct timeval &stop = _stop_usage.ru_utime ;
-				double stoptime =  stop.tv_sec*1000.0 + stop.tv_usec/1000.0;
-				double elapsed =  _result.tv_sec*1000.0 + _result.tv_usec/1000.0;
-
-				if(BESDebug::GetStrm())
-    				*(BESDebug::GetStrm()) << "[" << BESDebug::GetPidStr() << "]["<< _log_name << "][" << _req_id << "][STOPPED][" << stoptime << "][ms][" << _timer_name << "][ELAPSED][" << elapsed << "][ms]" << endl;
-
-			}
-		}
-	}
-}
+		unsigned long long stop_wall = BESTracer::wall_time() ;
+		unsigned long long stop_cpu = BESTracer::cpu_time() ;
 
-bool
-BESStopWatch::timeval_subtract()
-{
-	struct timeval &start = _start_usage.ru_utime ;
-	struct timeval &stop = _stop_usage.ru_utime ;
+		if( _traced )
+			BESTracer::TheTracer()->end_span( _timer_name, _req_id, _start_wall, _start_cpu, _start_read, _start_written ) ;
 
-	/* Perform the carry for the later subtraction by updating y. */
-	if( stop.tv_usec < start.tv_usec )
-	{
-		int nsec = (start.tv_usec - stop.tv_usec) / 1000000 + 1 ;
-		start.tv_usec -= 1000000 * nsec ;
-		start.tv_sec += nsec ;
-	}
-	if( stop.tv_usec - start.tv_usec > 1000000 )
-	{
-		int nsec = (start.tv_usec - stop.tv_usec) / 1000000 ;
-		start.tv_usec += 1000000 * nsec ;
-		start.tv_sec -= nsec ;
-	}
+		_stopped = true ;
 
-	/* Compute the time remaining to wait.
-    tv_usec  is certainly positive. */
-	_result.tv_sec = stop.tv_sec - start.tv_sec ;
-	_result.tv_usec = stop.tv_usec - start.tv_usec ;
+		if( is_logging() )
+		{
+			double elapsed = (stop_wall - _start_wall)/1000.0 ;
+			double cpu = (stop_cpu > _start_cpu ? stop_cpu - _start_cpu : 0)/1000.0 ;
 
-	/* Return 1 if result is negative. */
-	return !(stop.tv_sec < start.tv_sec) ;
+			*(BESDebug::GetStrm()) << "[" << BESDebug::GetPidStr() << "]["<< _log_name << "][" << _req_id << "][STOPPED][" << stop_wall/1000.0 << "][ms][" << _timer_name << "][ELAPSED][" << elapsed << "][ms][CPU][" << cpu << "][ms]" << endl;
+		}
+	}
 }
 
 /** @brief dumps information about this object
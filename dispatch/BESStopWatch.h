@@ -45,6 +45,14 @@
 #define TIMING_LOG "timing"
 #define MISSING_LOG_PARAM ""
 
+/** @brief True if a started BESStopWatch will be used
+ *
+ * A stop watch logs to the 'timing' debug context and records a span with
+ * BESTracer. Use this to decide whether to start one, e.g.,
+ * if (BESISTIMING) sw.start("name", reqID);
+ */
+#define BESISTIMING (BESStopWatch::is_enabled())
+
 class BESStopWatch;
 
 namespace bes_timing {
@@ -52,6 +60,14 @@ extern BESStopWatch *elapsedTimeToReadStart;
 extern BESStopWatch *elapsedTimeToTransmitStart;
 }
 
+/** @brief Time a block of code
+ *
+ * Start the stop watch; it stops when it is destroyed. The wall-clock time
+ * (from the monotonic clock) and the CPU time are logged to BESDebug's
+ * 'timing' context, if it is set, and recorded as a span by BESTracer, if
+ * tracing is enabled. Stop watches that are started while another is
+ * running on the same thread are nested within it.
+ */
 class BESStopWatch : public BESObj
 {
  private:
@@ -60,12 +76,14 @@ class BESStopWatch : public BESObj
     string _log_name;
     bool _started ;
     bool _stopped ;
+    bool _traced ;
 
-    struct rusage _start_usage ;
-    struct rusage _stop_usage ;
-    struct timeval _result ;
+    unsigned long long _start_wall ;
+    unsigned long long _start_cpu ;
+    unsigned long long _start_read ;
+    unsigned long long _start_written ;
 
-    bool timeval_subtract() ;
+    bool is_logging() const ;
 
  public:
 
@@ -76,7 +94,12 @@ class BESStopWatch : public BESObj
 	_req_id(MISSING_LOG_PARAM),
 	_log_name(TIMING_LOG),
 	_started(false),
-	_stopped(false)
+	_stopped(false),
+	_traced(false),
+	_start_wall(0),
+	_start_cpu(0),
+	_start_read(0),
+	_start_written(0)
 { 
 }
 
@@ -89,7 +112,12 @@ class BESStopWatch : public BESObj
 	_req_id(MISSING_LOG_PARAM),
 	_log_name(logName),
 	_started(false),
-	_stopped(false)
+	_stopped(false),
+	_traced(false),
+	_start_wall(0),
+	_start_cpu(0),
+	_start_read(0),
+	_start_written(0)
 { 
 }
 
@@ -97,11 +125,14 @@ class BESStopWatch : public BESObj
      * This destructor is "special" in that it's execution signals the
      * timer to stop if it has been started. Stopping the timer will
      * initiate an attempt to write logging information to the
-     * BESDebug::GetStrm() stream. If the start method has not been
-     * called then the method exits silently.
+     * BESDebug::GetStrm() stream and to record the span with BESTracer.
+     * If the start method has not been called then the method exits
+     * silently.
      */
     virtual ~BESStopWatch();
 
+    static bool is_enabled() ;
+
     /**
      * Starts the timer.
      * NB: This method will attempt to write logging
@@ -0,0 +1,118 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "BESTraceResponseHandler.h"
+#include "BESInfoList.h"
+#include "BESInfo.h"
+#include "BESTracer.h"
+#include "BESInternalError.h"
+#include "BESResponseNames.h"
+
+#include <sstream>
+
+using std::ostringstream ;
+
+BESTraceResponseHandler::BESTraceResponseHandler( const string &name )
+    : BESResponseHandler( name )
+{
+}
+
+BESTraceResponseHandler::~BESTraceResponseHandler( )
+{
+}
+
+/** @brief executes the command 'show trace;' by returning the spans
+ * recorded by this server process
+ *
+ * The spans are written as a Chrome trace event (JSON) document, which is
+ * the value of the 'trace' element. If tracing is not enabled, the
+ * document has no events.
+ *
+ * @param dhi structure that holds request and response information
+ * @see BESDataHandlerInterface
+ * @see BESInfo
+ * @see BESTracer
+ */
+void
+BESTraceResponseHandler::execute( BESDataHandlerInterface &dhi )
+{
+    BESInfo *info = BESInfoList::TheList()->build_info() ;
+    _response = info ;
+
+    ostringstream trace ;
+    BESTracer *tracer = BESTracer::TheTracer() ;
+    if( tracer )
+	tracer->write_chrome_trace( trace ) ;
+    else
+	trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[]}" ;
+
+    dhi.action_name = SHOW_TRACE_STR ;
+    info->begin_response( SHOW_TRACE_STR, dhi ) ;
+    info->add_tag( "trace", trace.str() ) ;
+    info->end_response() ;
+}
+
+/** @brief transmit the response object built by the execute command
+ * using the specified transmitter object
+ *
+ * If a response object was built then transmit it as text using the specified
+ * transmitter object.
+ *
+ * @param transmitter object that knows how to transmit specific basic types
+ * @param dhi structure that holds the request and response information
+ * @see BESResponseObject
+ * @see BESTransmitter
+ * @see BESDataHandlerInterface
+ */
+void
+BESTraceResponseHandler::transmit( BESTransmitter *transmitter,
+                                  BESDataHandlerInterface &dhi )
+{
+    if( _response )
+    {
+	BESInfo *info = dynamic_cast<BESInfo *>(_response) ;
+	if( !info )
+	    throw BESInternalError( "cast error", __FILE__, __LINE__ ) ;
+	info->transmit( transmitter, dhi ) ;
+    }
+}
+
+/** @brief dumps information about this object
+ *
+ * Displays the pointer value of this instance
+ *
+ * @param strm C++ i/o stream to dump the information to
+ */
+void
+BESTraceResponseHandler::dump( ostream &strm ) const
+{
+    strm << BESIndent::LMarg << "BESTraceResponseHandler::dump - ("
+			     << (void *)this << ")" << endl ;
+    BESIndent::Indent() ;
+    BESResponseHandler::dump( strm ) ;
+    BESIndent::UnIndent() ;
+}
+
+BESResponseHandler *
+BESTraceResponseHandler::TraceResponseBuilder( const string &name )
+{
+    return new BESTraceResponseHandler( name ) ;
+}
+
@@ -0,0 +1,54 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef I_BESTraceResponseHandler_h
+#define I_BESTraceResponseHandler_h 1
+
+#include "BESResponseHandler.h"
+
+/** @brief response handler that returns the trace recorded by the server
+ * process serving the requesting client
+ *
+ * A request 'show trace;' will be handled by this response handler. It
+ * returns the spans recorded by BESTracer, as a Chrome trace event
+ * document, in an informational response object.
+ *
+ * @see BESTracer
+ * @see BESResponseObject
+ * @see BESContainer
+ * @see BESTransmitter
+ */
+class BESTraceResponseHandler : public BESResponseHandler
+{
+public:
+				BESTraceResponseHandler( const string &name ) ;
+    virtual			~BESTraceResponseHandler( void ) ;
+
+    virtual void		execute( BESDataHandlerInterface &dhi ) ;
+    virtual void		transmit( BESTransmitter *transmitter,
+                                          BESDataHandlerInterface &dhi ) ;
+
+    virtual void		dump( ostream &strm ) const ;
+
+    static BESResponseHandler *TraceResponseBuilder( const string &name ) ;
+};
+
+#endif // I_BESTraceResponseHandler_h
+
@@ -0,0 +1,284 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "config.h"
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "BESTracer.h"
+#include "TheBESKeys.h"
+#include "BESUtil.h"
+#include "BESDebug.h"
+
+using namespace std;
+
+BESTracer *BESTracer::d_instance = 0;
+bool BESTracer::d_enabled = true;
+pthread_once_t BESTracer::d_init_once = PTHREAD_ONCE_INIT;
+
+const string BESTracer::ENABLED_KEY = "BES.Trace.Enabled";
+const string BESTracer::SIZE_KEY = "BES.Trace.Size";
+const string BESTracer::FILE_KEY = "BES.Trace.File";
+
+static const unsigned int DEFAULT_TRACE_SIZE = 4096;
+
+// Lock a mutex for the life of a block
+class trace_lock {
+    pthread_mutex_t &d_mutex;
+public:
+    trace_lock(pthread_mutex_t &m) : d_mutex(m) { pthread_mutex_lock(&d_mutex); }
+    ~trace_lock() { pthread_mutex_unlock(&d_mutex); }
+};
+
+// Escape a string for use as a JSON string value
+static string json_escape(const string &s)
+{
+    string out;
+    for (string::const_iterator i = s.begin(), e = s.end(); i != e; ++i) {
+        switch (*i) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        case '\r': out += "\\r"; break;
+        default:
+            if (static_cast<unsigned char>(*i) < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof buf, "\\u%04x", static_cast<unsigned char>(*i));
+                out += buf;
+            }
+            else {
+                out += *i;
+            }
+        }
+    }
+    return out;
+}
+
+/**
+ * @param size The number of spans to keep
+ * @param file If not empty, write the trace to this file (with '.<pid>'
+ * appended) when this object is deleted
+ */
+BESTracer::BESTracer(unsigned int size, const string &file) :
+    d_ring(size == 0 ? 1 : size), d_recorded(0), d_bytes_read(0), d_bytes_written(0), d_file(file)
+{
+    pthread_mutex_init(&d_mutex, 0);
+}
+
+BESTracer::~BESTracer()
+{
+    // Each process (e.g., each beslistener child) writes its own file
+    if (!d_file.empty()) write_file();
+
+    pthread_mutex_destroy(&d_mutex);
+}
+
+void BESTracer::delete_instance()
+{
+    delete d_instance;
+    d_instance = 0;
+}
+
+// Make the tracer, if tracing is enabled. Run once, by TheTracer().
+void BESTracer::initialize()
+{
+    bool found = false;
+    string value;
+    TheBESKeys::TheKeys()->get_value(ENABLED_KEY, value, found);
+    if (!found || BESUtil::lowercase(value) != "true") {
+        d_enabled = false;
+        return;
+    }
+
+    unsigned int size = DEFAULT_TRACE_SIZE;
+    TheBESKeys::TheKeys()->get_value(SIZE_KEY, value, found);
+    if (found && !value.empty()) size = strtoul(value.c_str(), 0, 10);
+
+    string file;
+    TheBESKeys::TheKeys()->get_value(FILE_KEY, file, found);
+
+    d_instance = new BESTracer(size, file);
+#ifdef HAVE_ATEXIT
+    atexit(delete_instance);
+#endif
+    BESDEBUG("bes", "BESTracer::" << __func__ << "() - Tracing is ENABLED, keeping " << size << " spans" << endl);
+}
+
+/**
+ * @brief Get the tracer for this process
+ *
+ * Safe to call from any thread (e.g., the prefetch threads that count the
+ * bytes they read); the tracer is made by the first call.
+ *
+ * @return The tracer or null if tracing is not enabled
+ */
+BESTracer *
+BESTracer::TheTracer()
+{
+    if (d_enabled) pthread_once(&d_init_once, initialize);
+
+    return d_instance;
+}
+
+/// @return The monotonic clock's time in microseconds
+unsigned long long BESTracer::wall_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/// @return The user plus system time used by this process, in microseconds
+unsigned long long BESTracer::cpu_time()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL + usage.ru_utime.tv_usec
+        + usage.ru_stime.tv_usec;
+}
+
+// Call with d_mutex locked
+unsigned int BESTracer::thread_number()
+{
+    pthread_t self = pthread_self();
+    for (unsigned int i = 0; i < d_threads.size(); ++i)
+        if (pthread_equal(d_threads[i], self)) return i;
+
+    d_threads.push_back(self);
+    d_depths.push_back(0);
+    return d_threads.size() - 1;
+}
+
+void BESTracer::add_bytes(unsigned long long read, unsigned long long written)
+{
+    trace_lock lock(d_mutex);
+    d_bytes_read += read;
+    d_bytes_written += written;
+}
+
+void BESTracer::get_bytes(unsigned long long &read, unsigned long long &written) const
+{
+    trace_lock lock(d_mutex);
+    read = d_bytes_read;
+    written = d_bytes_written;
+}
+
+/**
+ * @brief Note that a span has started on this thread
+ * @return The span's depth
+ */
+unsigned int BESTracer::begin_span()
+{
+    trace_lock lock(d_mutex);
+    return d_depths[thread_number()]++;
+}
+
+/**
+ * @brief Record a span that has ended on this thread
+ *
+ * The values passed are those from when the span started; the durations
+ * and byte counts are computed here.
+ */
+void BESTracer::end_span(const string &name, const string &req_id, unsigned long long start,
+    unsigned long long cpu_start, unsigned long long read_start, unsigned long long written_start)
+{
+    unsigned long long now = wall_time();
+    unsigned long long cpu = cpu_time();
+
+    trace_lock lock(d_mutex);
+
+    unsigned int thread = thread_number();
+    if (d_depths[thread] > 0) --d_depths[thread];
+
+    Span &span = d_ring[d_recorded++ % d_ring.size()];
+    span.name = name;
+    span.req_id = req_id;
+    span.depth = d_depths[thread];
+    span.thread = thread;
+    span.start = start;
+    span.wall = now - start;
+    span.cpu = cpu > cpu_start ? cpu - cpu_start : 0;
+    span.bytes_read = d_bytes_read - read_start;
+    span.bytes_written = d_bytes_written - written_start;
+}
+
+/// @return The spans held, oldest first
+vector<BESTracer::Span> BESTracer::get_spans() const
+{
+    trace_lock lock(d_mutex);
+
+    vector<Span> spans;
+    unsigned long long size = d_ring.size();
+    unsigned long long first = d_recorded > size ? d_recorded - size : 0;
+    for (unsigned long long i = first; i < d_recorded; ++i)
+        spans.push_back(d_ring[i % size]);
+
+    return spans;
+}
+
+void BESTracer::clear()
+{
+    trace_lock lock(d_mutex);
+    d_recorded = 0;
+}
+
+/**
+ * @brief Write the spans as a Chrome trace event document
+ *
+ * Each span is a complete ('X') event; the CPU time, byte counts, depth
+ * and request id are its arguments.
+ */
+void BESTracer::write_chrome_trace(ostream &out) const
+{
+    vector<Span> spans = get_spans();
+    pid_t pid = getpid();
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (vector<Span>::const_iterator i = spans.begin(), e = spans.end(); i != e; ++i) {
+        if (i != spans.begin()) out << ",";
+        out << "\n{\"name\":\"" << json_escape(i->name) << "\",\"cat\":\"bes\",\"ph\":\"X\",\"ts\":" << i->start
+            << ",\"dur\":" << i->wall << ",\"pid\":" << pid << ",\"tid\":" << i->thread << ",\"args\":{\"reqID\":\""
+            << json_escape(i->req_id) << "\",\"depth\":" << i->depth << ",\"cpu_us\":" << i->cpu << ",\"bytes_read\":"
+            << i->bytes_read << ",\"bytes_written\":" << i->bytes_written << "}}";
+    }
+    out << "\n]}" << endl;
+}
+
+/// Write the trace to the file named by BES.Trace.File, with '.<pid>' appended
+void BESTracer::write_file() const
+{
+    if (d_file.empty()) return;
+
+    ostringstream name;
+    name << d_file << "." << getpid();
+
+    ofstream out(name.str().c_str(), ios::out | ios::trunc);
+    if (out) write_chrome_trace(out);
+}
@@ -0,0 +1,140 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef DISPATCH_BESTRACER_H_
+#define DISPATCH_BESTRACER_H_
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+/**
+ * @brief Record timed spans of work done by this process
+ *
+ * Each BESStopWatch that is started while tracing is enabled records a
+ * span here when it stops: its name, request id, nesting depth, the
+ * thread that ran it, its start time and wall-clock duration (from the
+ * monotonic clock), the CPU time (user and system) used, and the bytes
+ * read and written during the span. Code that reads or writes data calls
+ * count_read() and count_written() so the byte counts are available.
+ *
+ * The spans are kept in a ring buffer of a fixed size, so a long running
+ * beslistener keeps the most recent ones. They can be written in the
+ * Chrome trace event format (see chrome://tracing or Perfetto) using the
+ * 'show trace' command or to a file when the process exits.
+ *
+ * The keys are:
+ * - BES.Trace.Enabled: 'true' to record spans (default false)
+ * - BES.Trace.Size: The number of spans kept (default 4096)
+ * - BES.Trace.File: If set, the trace is written to this file, with the
+ *   process id appended, when the process exits
+ *
+ * @note The byte and CPU counts are for the whole process; a span that
+ * overlaps work on another thread includes some of that work.
+ */
+class BESTracer {
+public:
+    /// One completed span
+    struct Span {
+        std::string name;
+        std::string req_id;
+        unsigned int depth;         ///< Number of enclosing spans on this thread
+        unsigned int thread;        ///< Small integer naming the thread
+        unsigned long long start;   ///< Microseconds, monotonic clock
+        unsigned long long wall;    ///< Microseconds
+        unsigned long long cpu;     ///< Microseconds of user and system time
+        unsigned long long bytes_read;
+        unsigned long long bytes_written;
+
+        Span() : depth(0), thread(0), start(0), wall(0), cpu(0), bytes_read(0), bytes_written(0) { }
+    };
+
+private:
+    static BESTracer *d_instance;
+    static bool d_enabled;
+    static pthread_once_t d_init_once;
+
+    static void initialize();
+    static void delete_instance();
+
+    std::vector<Span> d_ring;
+    unsigned long long d_recorded;  ///< Total spans recorded; the next goes in d_ring[d_recorded % size]
+
+    std::vector<pthread_t> d_threads;   ///< Index is the thread number used in spans
+    std::vector<unsigned int> d_depths; ///< The open spans on each thread
+
+    unsigned long long d_bytes_read;
+    unsigned long long d_bytes_written;
+
+    std::string d_file;
+
+    mutable pthread_mutex_t d_mutex;
+
+    unsigned int thread_number();
+
+    BESTracer(const BESTracer &);
+    BESTracer &operator=(const BESTracer &);
+
+public:
+    static const std::string ENABLED_KEY;
+    static const std::string SIZE_KEY;
+    static const std::string FILE_KEY;
+
+    BESTracer(unsigned int size, const std::string &file = "");
+    virtual ~BESTracer();
+
+    static BESTracer *TheTracer();
+
+    /// @return True if tracing is enabled
+    static bool IsSet() { return TheTracer() != 0; }
+
+    static unsigned long long wall_time();
+    static unsigned long long cpu_time();
+
+    /// Add to the bytes read by this process, if tracing is enabled
+    static void count_read(unsigned long long bytes)
+    {
+        if (d_enabled && TheTracer()) d_instance->add_bytes(bytes, 0);
+    }
+
+    /// Add to the bytes written by this process, if tracing is enabled
+    static void count_written(unsigned long long bytes)
+    {
+        if (d_enabled && TheTracer()) d_instance->add_bytes(0, bytes);
+    }
+
+    void add_bytes(unsigned long long read, unsigned long long written);
+    void get_bytes(unsigned long long &read, unsigned long long &written) const;
+
+    unsigned int begin_span();
+    void end_span(const std::string &name, const std::string &req_id, unsigned long long start,
+        unsigned long long cpu_start, unsigned long long read_start, unsigned long long written_start);
+
+    std::vector<Span> get_spans() const;
+    void clear();
+
+    void write_chrome_trace(std::ostream &out) const;
+    void write_file() const;
+};
+
+#endif /* DISPATCH_BESTRACER_H_ */
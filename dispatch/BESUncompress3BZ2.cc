@@ -41,14 +41,25 @@
 #include <cerrno>
 #include <sstream>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
 
 using std::ostringstream;
 
 #include "BESUncompress3BZ2.h"
+#include "BESUncompressParallel.h"
 #include "BESInternalError.h"
 #include "BESDebug.h"
 
-#define CHUNK 4096
+#define CHUNK 65536
+
+// The magic numbers that start a compressed block and the end of a stream,
+// the most markers tried as the end of one block (a magic number can turn
+// up by chance inside a block) and the size of the reads used to find them
+#define BZ2_BLOCK_MAGIC 0x314159265359ULL
+#define BZ2_EOS_MAGIC 0x177245385090ULL
+#define BZ2_MAX_MERGE 8
+#define BZ2_SCAN_CHUNK 1048576
 
 #if 0
 static void bz_internal_error(int errcode)
@@ -59,6 +70,105 @@ static void bz_internal_error(int errcode)
 }
 #endif
 
+#ifdef HAVE_BZLIB_H
+// Each block is a piece. The stream CRCs are not checked, but each block's
+// CRC is.
+class bz2_parallel : public BESUncompressParallel
+{
+private:
+    const vector<BESUncompress3BZ2::marker> &_markers ;
+    // the index in _markers of each piece's block
+    const vector<vector<BESUncompress3BZ2::marker>::size_type> &_blocks ;
+
+protected:
+    virtual bool
+    uncompress_piece( vector<unsigned long long>::size_type i,
+		      unsigned long long &end, string &data )
+    {
+	vector<BESUncompress3BZ2::marker>::size_type m = _blocks[i] ;
+	if( m + 1 >= _markers.size() ) return false ;
+
+	end = _markers[m + 1].offset ;
+	return BESUncompress3BZ2::uncompress_block( d_src_fd,
+						    _markers[m].offset,
+						    end, data ) ;
+    }
+
+    // The block did not end at the next marker, so that marker is false
+    virtual unsigned long long
+    write_piece( vector<unsigned long long>::size_type i )
+    {
+	string data ;
+	vector<BESUncompress3BZ2::marker>::size_type k =
+	    BESUncompress3BZ2::uncompress_block( d_src_fd, _markers,
+						 _blocks[i], data ) ;
+	if( k == 0 )
+	{
+	    ostringstream strm ;
+	    strm << "Could not uncompress the block at bit "
+		 << _markers[_blocks[i]].offset << " of " << d_src ;
+	    throw BESInternalError( strm.str(), __FILE__, __LINE__ ) ;
+	}
+
+	write( data.data(), data.size() ) ;
+	return _markers[k].offset ;
+    }
+
+public:
+    bz2_parallel( const string &src, int src_fd, int dest_fd,
+		  const vector<BESUncompress3BZ2::marker> &markers,
+		  const vector<vector<BESUncompress3BZ2::marker>::size_type> &blocks )
+	: BESUncompressParallel( src, src_fd, dest_fd, false ),
+	  _markers( markers ), _blocks( blocks )
+    {
+    }
+} ;
+
+// Uncompress the blocks in parallel; return false if the file has too few
+// blocks for that to help
+static bool
+uncompress_parallel( const string &src_name, int fd )
+{
+    int src_fd = open( src_name.c_str(), O_RDONLY ) ;
+    if( src_fd == -1 ) return false ;
+
+    try
+    {
+	vector<BESUncompress3BZ2::marker> markers ;
+	BESUncompress3BZ2::find_markers( src_fd, markers ) ;
+
+	vector<vector<BESUncompress3BZ2::marker>::size_type> blocks ;
+	vector<unsigned long long> starts ;
+	for( vector<BESUncompress3BZ2::marker>::size_type m = 0;
+	     m < markers.size(); m++ )
+	{
+	    if( markers[m].block )
+	    {
+		blocks.push_back( m ) ;
+		starts.push_back( markers[m].offset ) ;
+	    }
+	}
+
+	if( blocks.size() < 2 )
+	{
+	    close( src_fd ) ;
+	    return false ;
+	}
+
+	bz2_parallel parallel( src_name, src_fd, fd, markers, blocks ) ;
+	parallel.run( starts ) ;
+    }
+    catch( ... )
+    {
+	close( src_fd ) ;
+	throw ;
+    }
+
+    close( src_fd ) ;
+    return true ;
+}
+#endif
+
 /** @brief uncompress a file with the .bz2 file extension
  *
  * @param src_name file that will be uncompressed
@@ -72,6 +182,14 @@ BESUncompress3BZ2::uncompress( const string &src_name, int fd )
     string err = "Unable to uncompress bz2 files, feature not built. Check config.h in bes directory for HAVE_BZLIB_H flag set to 1";
     throw BESInternalError( err, __FILE__, __LINE__ );
 #else
+    // Files with more than one block are uncompressed a block at a time
+    // on several threads
+    if( BESUncompressParallel::get_max_threads() > 1
+	&& uncompress_parallel( src_name, fd ) )
+    {
+	return ;
+    }
+
     FILE *src = fopen( src_name.c_str(), "rb" );
     if( !src )
     {
@@ -163,3 +281,225 @@ BESUncompress3BZ2::uncompress( const string &src_name, int fd )
 #endif
 }
 
+
+#ifdef HAVE_BZLIB_H
+// Read len bytes at offset, returning the number read
+static size_t
+read_at( int fd, unsigned char *buf, size_t len, off_t offset )
+{
+    size_t total = 0 ;
+    while( total < len )
+    {
+	ssize_t n = pread( fd, buf + total, len - total, offset + total ) ;
+	if( n < 0 && errno == EINTR ) continue ;
+	if( n <= 0 ) break ;
+	total += n ;
+    }
+    return total ;
+}
+
+// Appends single bits to a string, most significant bit first
+class bit_writer
+{
+private:
+    string &_out ;
+    unsigned int _acc ;
+    int _used ;
+
+public:
+    bit_writer( string &out ) : _out( out ), _acc( 0 ), _used( 0 ) {}
+
+    void put( unsigned int bit )
+    {
+	_acc = ( _acc << 1 ) | ( bit & 1 ) ;
+	if( ++_used == 8 )
+	{
+	    _out += (char)_acc ;
+	    _acc = 0 ;
+	    _used = 0 ;
+	}
+    }
+
+    void put( unsigned long long value, int count )
+    {
+	while( count-- > 0 ) put( (unsigned int)( value >> count ) ) ;
+    }
+
+    void flush()
+    {
+	if( _used ) _out += (char)( _acc << ( 8 - _used ) ) ;
+	_acc = 0 ;
+	_used = 0 ;
+    }
+} ;
+
+static unsigned int
+get_bit( const vector<unsigned char> &buf, unsigned long long bit )
+{
+    return ( buf[bit / 8] >> ( 7 - bit % 8 ) ) & 1 ;
+}
+#endif
+
+/** @brief find the blocks of a .bz2 file
+ *
+ * Scans the file, one bit offset at a time, for the magic numbers that
+ * start each compressed block and each end-of-stream marker. Concatenated
+ * streams (e.g., the output of pbzip2) are fine. Since the magic numbers
+ * are not escaped in the compressed data, a few of the markers may be
+ * false; uncompress_block() tells them apart.
+ *
+ * @param src_fd open file descriptor of the .bz2 file
+ * @param markers value-result parameter; the markers, in file order
+ * @throws BESInternalError if the file cannot be read or bz2 is not
+ * compiled into the BES
+ */
+void
+BESUncompress3BZ2::find_markers( int src_fd, vector<marker> &markers )
+{
+#ifndef HAVE_BZLIB_H
+    string err = "Unable to uncompress bz2 files, feature not built. Check config.h in bes directory for HAVE_BZLIB_H flag set to 1";
+    throw BESInternalError( err, __FILE__, __LINE__ );
+#else
+    markers.clear() ;
+
+    vector<unsigned char> buf( BZ2_SCAN_CHUNK ) ;
+    unsigned long long reg = 0 ;
+    unsigned long long bits = 0 ;
+    off_t pos = 0 ;
+    while( true )
+    {
+	ssize_t n = pread( src_fd, &buf[0], buf.size(), pos ) ;
+	if( n < 0 && errno == EINTR ) continue ;
+	if( n < 0 )
+	{
+	    string err = "Unable to read the compressed file: " ;
+	    err.append( strerror( errno ) ) ;
+	    throw BESInternalError( err, __FILE__, __LINE__ );
+	}
+	if( n == 0 ) break ;
+	pos += n ;
+
+	for( ssize_t j = 0; j < n; j++ )
+	{
+	    reg = ( reg << 8 ) | buf[j] ;
+	    bits += 8 ;
+	    // Test the 48 bits that end at each bit of the new byte
+	    for( int shift = 7; shift >= 0; shift-- )
+	    {
+		if( bits - shift < 48 ) continue ;
+		unsigned long long v = ( reg >> shift ) & 0xffffffffffffULL ;
+		if( v == BZ2_BLOCK_MAGIC || v == BZ2_EOS_MAGIC )
+		{
+		    marker m ;
+		    m.offset = bits - shift - 48 ;
+		    m.block = ( v == BZ2_BLOCK_MAGIC ) ;
+		    markers.push_back( m ) ;
+		}
+	    }
+	}
+    }
+#endif
+}
+
+/** @brief uncompress one block of a .bz2 file
+ *
+ * The block's bits are copied into a stream of their own, after a stream
+ * header and before an end-of-stream marker whose CRC is the block's CRC,
+ * so the block is checked as it is uncompressed.
+ *
+ * @param src_fd open file descriptor of the .bz2 file
+ * @param start the offset, in bits, of the block's magic number
+ * @param end the offset, in bits, of the marker that follows the block
+ * @param data value-result parameter; the uncompressed block
+ * @return false if the bits between start and end are not a block
+ */
+bool
+BESUncompress3BZ2::uncompress_block( int src_fd, unsigned long long start,
+				     unsigned long long end, string &data )
+{
+#ifndef HAVE_BZLIB_H
+    string err = "Unable to uncompress bz2 files, feature not built. Check config.h in bes directory for HAVE_BZLIB_H flag set to 1";
+    throw BESInternalError( err, __FILE__, __LINE__ );
+#else
+    // the magic number and the CRC come first
+    if( end <= start + 80 ) return false ;
+
+    off_t first = start / 8 ;
+    size_t nbytes = ( end + 7 ) / 8 - first ;
+    // one extra byte so the shifted copy below can always read ahead
+    vector<unsigned char> in( nbytes + 1, 0 ) ;
+    if( read_at( src_fd, &in[0], nbytes, first ) != nbytes ) return false ;
+
+    unsigned int shift = start % 8 ;
+    unsigned long long nbits = end - start ;
+
+    string stream( "BZh9" ) ;
+    stream.reserve( nbytes + 16 ) ;
+    for( unsigned long long k = 0; k < nbits / 8; k++ )
+    {
+	stream += (char)( ( in[k] << shift ) | ( in[k + 1] >> ( 8 - shift ) ) ) ;
+    }
+
+    bit_writer bw( stream ) ;
+    for( unsigned long long b = nbits - nbits % 8; b < nbits; b++ )
+    {
+	bw.put( get_bit( in, shift + b ) ) ;
+    }
+    bw.put( BZ2_EOS_MAGIC, 48 ) ;
+    for( unsigned long long b = 48; b < 80; b++ )
+    {
+	bw.put( get_bit( in, shift + b ) ) ;
+    }
+    bw.flush() ;
+
+    bz_stream bs ;
+    memset( &bs, 0, sizeof( bs ) ) ;
+    if( BZ2_bzDecompressInit( &bs, 0, 0 ) != BZ_OK ) return false ;
+
+    bs.next_in = &stream[0] ;
+    bs.avail_in = stream.size() ;
+
+    data.clear() ;
+    vector<char> out( CHUNK * 16 ) ;
+    int ret = BZ_OK ;
+    do
+    {
+	bs.next_out = &out[0] ;
+	bs.avail_out = out.size() ;
+	ret = BZ2_bzDecompress( &bs ) ;
+	if( ret != BZ_OK && ret != BZ_STREAM_END ) break ;
+	data.append( &out[0], out.size() - bs.avail_out ) ;
+    } while( ret == BZ_OK && ( bs.avail_in > 0 || bs.avail_out == 0 ) ) ;
+
+    BZ2_bzDecompressEnd( &bs ) ;
+
+    return ret == BZ_STREAM_END ;
+#endif
+}
+
+/** @brief uncompress the block that starts at a marker
+ *
+ * The block ends at the next marker unless that marker is false, in which
+ * case the markers after it are tried.
+ *
+ * @param src_fd open file descriptor of the .bz2 file
+ * @param markers the markers found by find_markers()
+ * @param i the index of the block's marker
+ * @param data value-result parameter; the uncompressed block
+ * @return the index of the marker that ends the block, or zero if no
+ * block starts at markers[i]
+ */
+vector<BESUncompress3BZ2::marker>::size_type
+BESUncompress3BZ2::uncompress_block( int src_fd, const vector<marker> &markers,
+				     vector<marker>::size_type i,
+				     string &data )
+{
+    for( vector<marker>::size_type k = i + 1;
+	 k < markers.size() && k <= i + BZ2_MAX_MERGE; k++ )
+    {
+	if( uncompress_block( src_fd, markers[i].offset, markers[k].offset, data ) )
+	    return k ;
+    }
+
+    return 0 ;
+}
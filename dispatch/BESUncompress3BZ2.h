@@ -34,8 +34,10 @@
 #define BESUncompress3BZ2_h_ 1
 
 #include <string>
+#include <vector>
 
 using std::string ;
+using std::vector ;
 
 #include "BESObj.h"
 
@@ -48,6 +50,9 @@ using std::string ;
  * If any errors occur during this operation then a
  * BESContainerStorageException will be thrown
  *
+ * A file with more than one block is uncompressed a block at a time on
+ * several threads (see BESUncompressParallel).
+ *
  * @param src the source file that is to be uncompressed
  * @param target the target uncompressed file
  * @throws BESContainerStorageException if errors in uncompressing the file
@@ -56,7 +61,27 @@ using std::string ;
 class BESUncompress3BZ2 : public BESObj
 {
 public:
+    /** @brief The start of a block or of an end-of-stream marker
+     *
+     * Each compressed block, and the end of each stream, begins with a 48
+     * bit magic number that is not byte aligned. The offset is in bits
+     * from the start of the .bz2 file.
+     */
+    struct marker
+    {
+	unsigned long long offset ;
+	bool block ;
+    } ;
+
     static void	uncompress( const string &src, int fd ) ;
+
+    static void find_markers( int src_fd, vector<marker> &markers ) ;
+    static bool uncompress_block( int src_fd, unsigned long long start,
+				  unsigned long long end, string &data ) ;
+    static vector<marker>::size_type uncompress_block( int src_fd,
+					const vector<marker> &markers,
+					vector<marker>::size_type i,
+					string &data ) ;
 };
 
 #endif // BESUncompress3BZ2.h_h_
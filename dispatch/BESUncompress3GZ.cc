@@ -32,18 +32,273 @@
 
 #include <zlib.h>
 
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <cerrno>
 #include <sstream>
 
 using std::ostringstream;
+using std::min;
 
 #include "BESUncompress3GZ.h"
+#include "BESUncompressParallel.h"
 #include "BESInternalError.h"
-// #include "BESDebug.h"
+#include "BESDebug.h"
+
+#define CHUNK 65536
+
+// The size of the reads used to find the members and the most data of one
+// member a worker holds in memory; a bigger one goes to a temporary file
+#define GZ_SCAN_CHUNK 1048576
+#define GZ_MAX_PIECE 16777216
+
+// Read len bytes at offset, returning the number read
+static size_t read_at(int fd, unsigned char *buf, size_t len, off_t offset)
+{
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = pread(fd, buf + total, len - total, offset + total);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        total += n;
+    }
+    return total;
+}
+
+// Write all of buf to fd
+static void write_all(int fd, const unsigned char *buf, size_t len)
+{
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = write(fd, buf + total, len - total);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ostringstream oss;
+            oss << "Error writing uncompressed data: wrote " << total << " instead of " << len;
+            throw BESInternalError(oss.str(), __FILE__, __LINE__);
+        }
+        total += n;
+    }
+}
+
+// Make an unnamed temporary file in the uncompress cache directory; -1 if
+// there's no directory or the file could not be made
+static int make_temp_file()
+{
+    string dir = BESUncompressParallel::get_temp_dir();
+    if (dir.empty()) return -1;
+
+    string name = dir + "/bes_gz_memberXXXXXX";
+    vector<char> templ(name.begin(), name.end());
+    templ.push_back('\0');
+
+    int fd = mkstemp(&templ[0]);
+    if (fd == -1) {
+        BESDEBUG("uncompress", "BESUncompress3GZ - Could not make a temporary file in " << dir << ": " << strerror(errno) << endl);
+        return -1;
+    }
+    unlink(&templ[0]);
+
+    return fd;
+}
+
+/**
+ * Uncompress the gzip member that starts at 'start' into 'data' (when it's
+ * not null) or to 'fd'. If the member holds more than max_size bytes, what
+ * is in 'data' and the rest of the member go to 'fd' instead, making it a
+ * temporary file if it is -1.
+ *
+ * @return False if there is no whole member at start, or if it holds more
+ * than max_size bytes and there was no temporary file for it.
+ */
+static bool inflate_member(int src_fd, unsigned long long start, unsigned long long &end, string *data, int &fd,
+    size_t max_size)
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, 31) != Z_OK) return false;
+
+    vector<unsigned char> in(CHUNK);
+    vector<unsigned char> out(CHUNK);
+    unsigned long long pos = start;
+    int ret = Z_OK;
+    try {
+        while (ret != Z_STREAM_END) {
+            if (strm.avail_in == 0) {
+                size_t n = read_at(src_fd, &in[0], in.size(), pos);
+                if (n == 0) break;
+                pos += n;
+                strm.next_in = &in[0];
+                strm.avail_in = n;
+            }
+
+            strm.next_out = &out[0];
+            strm.avail_out = out.size();
+            ret = inflate(&strm, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) break;
+
+            size_t have = out.size() - strm.avail_out;
+            if (data && data->size() + have > max_size) {
+                // Too big to hold in memory
+                if (fd == -1) fd = make_temp_file();
+                if (fd == -1) break;
+
+                write_all(fd, reinterpret_cast<const unsigned char*>(data->data()), data->size());
+                string().swap(*data);
+                data = 0;
+            }
+
+            if (data)
+                data->append(reinterpret_cast<char*>(&out[0]), have);
+            else
+                write_all(fd, &out[0], have);
+        }
+    }
+    catch (...) {
+        inflateEnd(&strm);
+        throw;
+    }
+
+    end = pos - strm.avail_in;
+    inflateEnd(&strm);
+
+    return ret == Z_STREAM_END;
+}
+
+/**
+ * Is there a gzip member at 'start'? Inflates the header and the start of
+ * the compressed data; bytes inside compressed data that only look like a
+ * header almost always fail within a few kilobytes (e.g., with a distance
+ * too far back or an invalid block type).
+ */
+static bool member_at(int src_fd, unsigned long long start)
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, 31) != Z_OK) return false;
+
+    gz_header header;
+    memset(&header, 0, sizeof(header));
+    inflateGetHeader(&strm, &header);
 
-#define CHUNK 4096
+    vector<unsigned char> in(CHUNK);
+    vector<unsigned char> out(CHUNK);
+    strm.next_in = &in[0];
+    strm.avail_in = read_at(src_fd, &in[0], in.size(), start);
+
+    int ret = Z_OK;
+    while (ret == Z_OK && strm.avail_in > 0) {
+        strm.next_out = &out[0];
+        strm.avail_out = out.size();
+        ret = inflate(&strm, Z_NO_FLUSH);
+    }
+
+    inflateEnd(&strm);
+
+    return header.done == 1 && (ret == Z_OK || ret == Z_STREAM_END || ret == Z_BUF_ERROR);
+}
+
+// Each member is a piece. A member too big to hold in memory is uncompressed
+// by a worker into a temporary file, which write_piece() copies.
+class gz_parallel: public BESUncompressParallel {
+private:
+    const vector<unsigned long long> &d_starts;
+    vector<int> d_files;                    ///< Temporary files, by piece
+    vector<unsigned long long> d_ends;      ///< Where those pieces end
+
+protected:
+    virtual bool uncompress_piece(vector<unsigned long long>::size_type i, unsigned long long &end, string &data)
+    {
+        // Each worker uses its own slot; the vectors are not resized
+        int fd = -1;
+        bool ok = inflate_member(d_src_fd, d_starts[i], end, &data, fd, GZ_MAX_PIECE);
+        if (fd == -1) return ok;
+
+        if (ok) {
+            d_files[i] = fd;
+            d_ends[i] = end;
+        }
+        else {
+            close(fd);
+        }
+
+        return false;
+    }
+
+    virtual unsigned long long write_piece(vector<unsigned long long>::size_type i)
+    {
+        if (d_files[i] != -1) {
+            vector<char> buf(CHUNK);
+            for (off_t pos = 0;;) {
+                size_t n = read_at(d_files[i], reinterpret_cast<unsigned char*>(&buf[0]), buf.size(), pos);
+                if (n == 0) break;
+                write(&buf[0], n);
+                pos += n;
+            }
+
+            close(d_files[i]);
+            d_files[i] = -1;
+            return d_ends[i];
+        }
+
+        unsigned long long end;
+        if (!inflate_member(d_src_fd, d_starts[i], end, 0, d_dest_fd, 0)) {
+            ostringstream oss;
+            oss << "Could not uncompress the gzip member at byte " << d_starts[i] << " of " << d_src;
+            throw BESInternalError(oss.str(), __FILE__, __LINE__);
+        }
+        return end;
+    }
+
+public:
+    gz_parallel(const string &src, int src_fd, int dest_fd, const vector<unsigned long long> &starts) :
+        BESUncompressParallel(src, src_fd, dest_fd, true), d_starts(starts), d_files(starts.size(), -1),
+        d_ends(starts.size(), 0)
+    {
+    }
+
+    virtual ~gz_parallel()
+    {
+        for (vector<int>::iterator i = d_files.begin(), e = d_files.end(); i != e; ++i)
+            if (*i != -1) close(*i);
+    }
+};
+
+/** @brief find the members of a gzip file
+ *
+ * Looks for each gzip header (the magic number, the deflate method and
+ * flags with no reserved bits set). The magic number is not escaped in the
+ * compressed data, so each place found is kept only if its header and the
+ * start of its compressed data inflate without error.
+ *
+ * @param src_fd open file descriptor of the gzip file
+ * @param starts value-result parameter; the byte offsets of the headers
+ */
+void BESUncompress3GZ::find_members(int src_fd, vector<unsigned long long> &starts)
+{
+    starts.clear();
+
+    // Each read overlaps the next by the three bytes after the magic number
+    vector<unsigned char> buf(GZ_SCAN_CHUNK + 3);
+    for (off_t pos = 0;; pos += GZ_SCAN_CHUNK) {
+        size_t n = read_at(src_fd, &buf[0], buf.size(), pos);
+        if (n < 4) break;
+
+        size_t limit = min(n - 3, (size_t) GZ_SCAN_CHUNK);
+        for (size_t j = 0; j < limit; ++j) {
+            if (buf[j] == 0x1f && buf[j + 1] == 0x8b && buf[j + 2] == 8 && !(buf[j + 3] & 0xe0)
+                && member_at(src_fd, pos + j)) starts.push_back(pos + j);
+        }
+
+        if (n < buf.size()) break;
+    }
+}
 
 /** @brief uncompress a file with the .gz file extension
  *
@@ -54,6 +309,28 @@ using std::ostringstream;
  */
 void BESUncompress3GZ::uncompress(const string &src, int dest_fd)
 {
+    // If the file has more than one member, uncompress them in parallel
+    if (BESUncompressParallel::get_max_threads() > 1) {
+        int src_fd = open(src.c_str(), O_RDONLY);
+        if (src_fd != -1) {
+            vector<unsigned long long> starts;
+            try {
+                find_members(src_fd, starts);
+                if (starts.size() > 1 && starts[0] == 0) {
+                    gz_parallel parallel(src, src_fd, dest_fd, starts);
+                    parallel.run(starts);
+                    close(src_fd);
+                    return;
+                }
+            }
+            catch (...) {
+                close(src_fd);
+                throw;
+            }
+            close(src_fd);
+        }
+    }
+
     // buffer to hold the uncompressed data
     char in[CHUNK];
 
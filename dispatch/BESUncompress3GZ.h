@@ -34,8 +34,10 @@
 #define BESUncompress3GZ_h_ 1
 
 #include <string>
+#include <vector>
 
 using std::string;
+using std::vector;
 
 #include "BESObj.h"
 
@@ -49,6 +51,9 @@ using std::string;
  * If any errors occur during this operation then a
  * BESContainerStorageException will be thrown
  *
+ * A file made of several gzip members is uncompressed a member at a time
+ * on several threads (see BESUncompressParallel).
+ *
  * @param src the source file that is to be uncompressed
  * @param target the file descriptor of the target uncompressed file
  * @throws BESContainerStorageException if errors in uncompressing the file
@@ -56,6 +61,8 @@ using std::string;
 class BESUncompress3GZ: public BESObj {
 public:
     static void uncompress(const string &src, int dest_fd);
+
+    static void find_members(int src_fd, vector<unsigned long long> &starts);
 };
 
 #endif // BESUncompress3GZ_h_
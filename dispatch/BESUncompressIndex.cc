@@ -0,0 +1,487 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "config.h"
+
+#include <zlib.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+
+#include "BESUncompressIndex.h"
+#include "BESUncompress3BZ2.h"
+#include "BESFileLockingCache.h"
+#include "BESInternalError.h"
+#include "BESIndent.h"
+#include "BESDebug.h"
+
+using namespace std;
+
+// The size of the dictionary saved with each gzip access point and the
+// size of the reads from the compressed file
+#define WINSIZE 32768
+#define INDEX_CHUNK 16384
+
+#define INDEX_MAGIC "BESIDX1"
+
+// The start of an index file. The gzip dictionaries follow it, one for
+// each point, and then the points. The source's size and time are used to
+// tell when the index is stale.
+struct index_header {
+    char magic[8];
+    unsigned long long format;
+    unsigned long long src_size;
+    unsigned long long src_mtime;
+    unsigned long long size;
+    unsigned long long points;
+    unsigned long long table;
+};
+
+// Read or write len bytes at offset, returning the number of bytes moved
+static size_t read_at(int fd, void *buf, size_t len, off_t offset)
+{
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = pread(fd, static_cast<char*>(buf) + total, len - total, offset + total);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        total += n;
+    }
+    return total;
+}
+
+static void write_at(int fd, const void *buf, size_t len, off_t offset, const string &name)
+{
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = pwrite(fd, static_cast<const char*>(buf) + total, len - total, offset + total);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            string err = "Could not write the uncompress index " + name + ": ";
+            throw BESInternalError(err + strerror(errno), __FILE__, __LINE__);
+        }
+        total += n;
+    }
+}
+
+/**
+ * @brief Open the compressed file
+ *
+ * The index is empty until load() or build() is called.
+ *
+ * @param src The compressed file
+ * @param f Its format
+ * @param index_name The name of the index file in the cache
+ * @param cache The cache that holds the index file
+ * @throws BESInternalError if src cannot be opened
+ */
+BESUncompressIndex::BESUncompressIndex(const string &src, format f, const string &index_name,
+    BESFileLockingCache *cache) :
+    d_src(src), d_format(f), d_index_name(index_name), d_cache(cache), d_src_fd(-1), d_index_fd(-1), d_size(0),
+    d_piece_index(static_cast<vector<point>::size_type>(-1))
+{
+    d_src_fd = open(d_src.c_str(), O_RDONLY);
+    if (d_src_fd == -1) {
+        string err = "Could not open the compressed file " + d_src + ": ";
+        throw BESInternalError(err + strerror(errno), __FILE__, __LINE__);
+    }
+}
+
+/// Release the lock on the index file and close the compressed file
+BESUncompressIndex::~BESUncompressIndex()
+{
+    if (d_index_fd != -1) d_cache->unlock_and_close(d_index_name);
+    close(d_src_fd);
+}
+
+bool BESUncompressIndex::m_out_less(unsigned long long offset, const point &p)
+{
+    return offset < p.out;
+}
+
+/**
+ * @brief Read an index file
+ *
+ * @param fd An open, locked, file descriptor for the index. If the index
+ * is loaded, this instance releases the lock when it is deleted.
+ * @return False if the file is not an index of this source (e.g., the
+ * source has changed since the index was built).
+ */
+bool BESUncompressIndex::load(int fd)
+{
+    index_header h;
+    if (read_at(fd, &h, sizeof(h), 0) != sizeof(h)) return false;
+
+    struct stat st;
+    if (fstat(d_src_fd, &st) != 0) return false;
+
+    if (strncmp(h.magic, INDEX_MAGIC, sizeof(h.magic)) != 0 || h.format != static_cast<unsigned long long>(d_format)
+        || h.src_size != static_cast<unsigned long long>(st.st_size)
+        || h.src_mtime != static_cast<unsigned long long>(st.st_mtime)) {
+        BESDEBUG("uncompress", "BESUncompressIndex::load() - stale or foreign index: " << d_index_name << endl);
+        return false;
+    }
+
+    vector<point> points(h.points);
+    if (h.points > 0 && read_at(fd, &points[0], h.points * sizeof(point), h.table) != h.points * sizeof(point))
+        return false;
+
+    d_points.swap(points);
+    d_size = h.size;
+    d_index_fd = fd;
+
+    BESDEBUG("uncompress", "BESUncompressIndex::load() - " << d_points.size() << " points, " << d_size << " bytes" << endl);
+
+    return true;
+}
+
+/**
+ * @brief Make the index file and load it
+ *
+ * @param fd An open, exclusively locked, file descriptor for the (empty)
+ * index file. The caller may change the lock to a shared lock afterward;
+ * this instance releases it when it is deleted.
+ * @param span About how many bytes of uncompressed data lie between two
+ * gzip access points. Not used for bzip2.
+ * @throws BESInternalError if the source cannot be uncompressed or the
+ * index cannot be written
+ */
+void BESUncompressIndex::build(int fd, unsigned long long span)
+{
+    struct stat st;
+    if (fstat(d_src_fd, &st) != 0) {
+        string err = "Could not stat the compressed file " + d_src + ": ";
+        throw BESInternalError(err + strerror(errno), __FILE__, __LINE__);
+    }
+
+    vector<point> points;
+    index_header h;
+    memset(&h, 0, sizeof(h));
+    h.size = (d_format == gz) ? m_build_gz(fd, span, points) : m_build_bz2(points);
+
+    strncpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+    h.format = d_format;
+    h.src_size = st.st_size;
+    h.src_mtime = st.st_mtime;
+    h.points = points.size();
+    h.table = sizeof(h) + ((d_format == gz) ? points.size() * WINSIZE : 0);
+
+    if (!points.empty()) write_at(fd, &points[0], points.size() * sizeof(point), h.table, d_index_name);
+    // The header goes last so that a partly written index never loads
+    write_at(fd, &h, sizeof(h), 0, d_index_name);
+
+    if (!load(fd)) throw BESInternalError("Could not read the new uncompress index " + d_index_name, __FILE__, __LINE__);
+}
+
+// One pass of inflate() that stops at each block boundary, recording a
+// point when 'span' bytes have been uncompressed since the last one. This
+// is build_index() from zran.c, extended to gzip files with more than one
+// member.
+unsigned long long BESUncompressIndex::m_build_gz(int fd, unsigned long long span, vector<point> &points)
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    // 47: a gzip or zlib header, with the largest window
+    if (inflateInit2(&strm, 47) != Z_OK)
+        throw BESInternalError("Could not initialize zlib for " + d_src, __FILE__, __LINE__);
+
+    vector<unsigned char> input(INDEX_CHUNK);
+    vector<unsigned char> window(WINSIZE);
+    vector<unsigned char> dictionary(WINSIZE);
+
+    unsigned long long totin = 0, totout = 0, last = 0;
+    off_t pos = 0;
+    bool member_end = false;
+    bool trailing = false;
+
+    try {
+        while (!trailing) {
+            ssize_t n = pread(d_src_fd, &input[0], input.size(), pos);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                string err = "Could not read the compressed file " + d_src + ": ";
+                throw BESInternalError(err + strerror(errno), __FILE__, __LINE__);
+            }
+            if (n == 0) break;
+            pos += n;
+
+            strm.next_in = &input[0];
+            strm.avail_in = n;
+            while (strm.avail_in != 0) {
+                if (member_end) {
+                    // Like gzip, ignore anything after the last member
+                    if (strm.next_in[0] != 0x1f) {
+                        trailing = true;
+                        break;
+                    }
+                    inflateReset(&strm);
+                    member_end = false;
+                }
+
+                if (strm.avail_out == 0) {
+                    strm.avail_out = WINSIZE;
+                    strm.next_out = &window[0];
+                }
+
+                totin += strm.avail_in;
+                totout += strm.avail_out;
+                int ret = inflate(&strm, Z_BLOCK);
+                totin -= strm.avail_in;
+                totout -= strm.avail_out;
+
+                if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR) {
+                    ostringstream oss;
+                    oss << "Could not uncompress " << d_src << ": " << (strm.msg ? strm.msg : "zlib error") << " at byte "
+                        << totin;
+                    throw BESInternalError(oss.str(), __FILE__, __LINE__);
+                }
+
+                if (ret == Z_STREAM_END) {
+                    member_end = true;
+                    continue;
+                }
+
+                // At the end of a block that is not the last one (or at the end
+                // of a member's header)
+                if ((strm.data_type & 128) && !(strm.data_type & 64) && (totout == 0 || totout - last > span)) {
+                    point p;
+                    p.out = totout;
+                    p.in = totin;
+                    p.end = 0;
+                    p.bits = strm.data_type & 7;
+
+                    // 'window' is circular; the newest data end at next_out
+                    unsigned int left = strm.avail_out;
+                    if (left) memcpy(&dictionary[0], &window[WINSIZE - left], left);
+                    if (left < WINSIZE) memcpy(&dictionary[left], &window[0], WINSIZE - left);
+                    write_at(fd, &dictionary[0], WINSIZE, sizeof(index_header) + points.size() * WINSIZE, d_index_name);
+
+                    points.push_back(p);
+                    last = totout;
+                }
+            }
+        }
+
+        if (!member_end) throw BESInternalError("The compressed file " + d_src + " is truncated", __FILE__, __LINE__);
+    }
+    catch (...) {
+        inflateEnd(&strm);
+        throw;
+    }
+
+    inflateEnd(&strm);
+
+    BESDEBUG("uncompress", "BESUncompressIndex::m_build_gz() - " << points.size() << " points for " << d_src << endl);
+
+    return totout;
+}
+
+// Every block is a point; each one is uncompressed to find its length.
+unsigned long long BESUncompressIndex::m_build_bz2(vector<point> &points)
+{
+    vector<BESUncompress3BZ2::marker> markers;
+    BESUncompress3BZ2::find_markers(d_src_fd, markers);
+
+    unsigned long long total = 0;
+    string block;
+    vector<BESUncompress3BZ2::marker>::size_type i = 0;
+    while (i < markers.size()) {
+        if (!markers[i].block) {
+            ++i;
+            continue;
+        }
+
+        vector<BESUncompress3BZ2::marker>::size_type k = BESUncompress3BZ2::uncompress_block(d_src_fd, markers, i, block);
+        if (k == 0) {
+            ostringstream oss;
+            oss << "Could not uncompress the block at bit " << markers[i].offset << " of " << d_src;
+            throw BESInternalError(oss.str(), __FILE__, __LINE__);
+        }
+
+        point p;
+        p.out = total;
+        p.in = markers[i].offset;
+        p.end = markers[k].offset;
+        p.bits = 0;
+        points.push_back(p);
+
+        total += block.size();
+        i = k;
+    }
+
+    BESDEBUG("uncompress", "BESUncompressIndex::m_build_bz2() - " << points.size() << " blocks in " << d_src << endl);
+
+    return total;
+}
+
+// Uncompress the data between point i and the next one. Start a raw
+// inflate in the middle of the member, primed with the point's bits and
+// dictionary; when it reaches the end of a member skip the trailer and go
+// on with the next member's header.
+void BESUncompressIndex::m_uncompress_gz(vector<point>::size_type i, string &data)
+{
+    const point &p = d_points[i];
+    unsigned long long length = ((i + 1 < d_points.size()) ? d_points[i + 1].out : d_size) - p.out;
+    data.resize(length);
+    if (length == 0) return;
+
+    vector<unsigned char> dictionary(WINSIZE);
+    if (read_at(d_index_fd, &dictionary[0], WINSIZE, sizeof(index_header) + i * WINSIZE) != WINSIZE)
+        throw BESInternalError("Could not read the uncompress index " + d_index_name, __FILE__, __LINE__);
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, -15) != Z_OK)
+        throw BESInternalError("Could not initialize zlib for " + d_src, __FILE__, __LINE__);
+
+    off_t pos = p.in - (p.bits ? 1 : 0);
+    if (p.bits) {
+        unsigned char c;
+        if (read_at(d_src_fd, &c, 1, pos) != 1) {
+            inflateEnd(&strm);
+            throw BESInternalError("Could not read the compressed file " + d_src, __FILE__, __LINE__);
+        }
+        ++pos;
+        inflatePrime(&strm, p.bits, c >> (8 - p.bits));
+    }
+    inflateSetDictionary(&strm, &dictionary[0], WINSIZE);
+
+    vector<unsigned char> input(INDEX_CHUNK);
+    strm.next_out = reinterpret_cast<Bytef*>(&data[0]);
+    strm.avail_out = length;
+
+    bool raw = true;
+    bool between = false;
+    unsigned int trailer = 0;
+    while (strm.avail_out > 0) {
+        if (strm.avail_in == 0) {
+            size_t n = read_at(d_src_fd, &input[0], input.size(), pos);
+            if (n == 0) break;
+            pos += n;
+            strm.next_in = &input[0];
+            strm.avail_in = n;
+        }
+
+        if (between) {
+            unsigned int k = min(trailer, strm.avail_in);
+            strm.next_in += k;
+            strm.avail_in -= k;
+            trailer -= k;
+            if (trailer > 0 || strm.avail_in == 0) continue;
+            if (strm.next_in[0] != 0x1f) break;
+
+            // The next member, header and all
+            inflateReset2(&strm, 31);
+            raw = false;
+            between = false;
+        }
+
+        int ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR) {
+            string err = "Could not uncompress " + d_src + ": " + (strm.msg ? strm.msg : "zlib error");
+            inflateEnd(&strm);
+            throw BESInternalError(err, __FILE__, __LINE__);
+        }
+
+        if (ret == Z_STREAM_END) {
+            between = true;
+            // A raw inflate stops before the member's CRC and length
+            trailer = raw ? 8 : 0;
+        }
+    }
+
+    unsigned int missing = strm.avail_out;
+    inflateEnd(&strm);
+
+    if (missing > 0) throw BESInternalError("The compressed file " + d_src + " is shorter than its index", __FILE__, __LINE__);
+}
+
+void BESUncompressIndex::m_uncompress_piece(vector<point>::size_type i)
+{
+    // Drop the old piece first; if this fails there's no piece
+    d_piece.clear();
+    d_piece_index = static_cast<vector<point>::size_type>(-1);
+
+    if (d_format == gz) {
+        m_uncompress_gz(i, d_piece);
+    }
+    else if (!BESUncompress3BZ2::uncompress_block(d_src_fd, d_points[i].in, d_points[i].end, d_piece)) {
+        ostringstream oss;
+        oss << "Could not uncompress the block at bit " << d_points[i].in << " of " << d_src;
+        throw BESInternalError(oss.str(), __FILE__, __LINE__);
+    }
+
+    d_piece_index = i;
+}
+
+/**
+ * @brief Read uncompressed data
+ *
+ * @param offset Where to start, in the uncompressed data
+ * @param buf Where to put the data
+ * @param len How many bytes to read
+ * @return The number of bytes read; less than len only at the end of the
+ * data.
+ * @throws BESInternalError if the compressed file cannot be read or is
+ * corrupt
+ */
+size_t BESUncompressIndex::read(unsigned long long offset, char *buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len && offset < d_size && !d_points.empty()) {
+        // The last point at or before offset
+        vector<point>::size_type i = upper_bound(d_points.begin(), d_points.end(), offset, m_out_less) - d_points.begin()
+            - 1;
+        if (i != d_piece_index) m_uncompress_piece(i);
+
+        unsigned long long start = offset - d_points[i].out;
+        if (start >= d_piece.size()) break;
+
+        size_t n = min(static_cast<unsigned long long>(len - got), d_piece.size() - start);
+        memcpy(buf + got, d_piece.data() + start, n);
+        got += n;
+        offset += n;
+    }
+
+    return got;
+}
+
+/** @brief dumps information about this object
+ *
+ * @param strm C++ i/o stream to dump the information to
+ */
+void BESUncompressIndex::dump(ostream &strm) const
+{
+    strm << BESIndent::LMarg << "BESUncompressIndex::dump - (" << (void *) this << ")" << endl;
+    BESIndent::Indent();
+    strm << BESIndent::LMarg << "source: " << d_src << endl;
+    strm << BESIndent::LMarg << "format: " << ((d_format == gz) ? "gz" : "bz2") << endl;
+    strm << BESIndent::LMarg << "index: " << d_index_name << endl;
+    strm << BESIndent::LMarg << "uncompressed size: " << d_size << endl;
+    strm << BESIndent::LMarg << "access points: " << d_points.size() << endl;
+    BESIndent::UnIndent();
+}
@@ -0,0 +1,123 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef DISPATCH_BESUNCOMPRESSINDEX_H_
+#define DISPATCH_BESUNCOMPRESSINDEX_H_
+
+#include <string>
+#include <vector>
+
+#include "BESObj.h"
+
+class BESFileLockingCache;
+
+/**
+ * @brief Random access to the uncompressed contents of a .gz or .bz2 file
+ *
+ * The index holds access points into the compressed file, places from
+ * which decompression can start without reading what comes before them.
+ * For gzip the points are deflate block boundaries about 'span' bytes of
+ * uncompressed data apart, each with the 32KB of data before it that the
+ * inflater needs as a dictionary (as in zlib's zran.c example). For bzip2
+ * every compressed block is a point. Concatenated gzip members and bzip2
+ * streams are fine.
+ *
+ * Building the index takes one pass of decompression, but nothing is
+ * written except the index; it is kept in the uncompress cache next to
+ * where the uncompressed file would go, so later requests (and other
+ * beslisteners) just load it. The gzip dictionaries stay in the index file
+ * and are read when needed. While an instance exists it holds a read lock
+ * on its index file.
+ *
+ * read() uncompresses only the pieces (the data between two access points)
+ * that hold the requested bytes. The last piece used is kept, so small
+ * sequential reads do not uncompress it again.
+ *
+ * @see BESUncompressManager3::get_index()
+ */
+class BESUncompressIndex: public BESObj {
+public:
+    enum format {
+        gz = 1, bz2 = 2
+    };
+
+private:
+    // An access point. For gzip, 'in' is the offset of the first whole byte
+    // of the deflate block and 'bits' the number of its bits in the byte
+    // before that; for bzip2, 'in' and 'end' are the bit offsets of the
+    // block and the marker after it.
+    struct point {
+        unsigned long long out;
+        unsigned long long in;
+        unsigned long long end;
+        unsigned long long bits;
+    };
+
+    std::string d_src;
+    format d_format;
+    std::string d_index_name;
+    BESFileLockingCache *d_cache;
+
+    int d_src_fd;
+    int d_index_fd;
+
+    unsigned long long d_size;
+    std::vector<point> d_points;
+
+    // The uncompressed data from d_points[d_piece_index]
+    std::vector<point>::size_type d_piece_index;
+    std::string d_piece;
+
+    BESUncompressIndex(const BESUncompressIndex &);
+    BESUncompressIndex &operator=(const BESUncompressIndex &);
+
+    static bool m_out_less(unsigned long long offset, const point &p);
+
+    unsigned long long m_build_gz(int fd, unsigned long long span, std::vector<point> &points);
+    unsigned long long m_build_bz2(std::vector<point> &points);
+
+    void m_uncompress_gz(std::vector<point>::size_type i, std::string &data);
+    void m_uncompress_piece(std::vector<point>::size_type i);
+
+public:
+    BESUncompressIndex(const std::string &src, format f, const std::string &index_name, BESFileLockingCache *cache);
+    virtual ~BESUncompressIndex();
+
+    bool load(int fd);
+    void build(int fd, unsigned long long span);
+
+    /// @return The number of bytes of uncompressed data
+    unsigned long long size() const
+    {
+        return d_size;
+    }
+
+    /// @return The number of access points
+    unsigned long get_num_points() const
+    {
+        return d_points.size();
+    }
+
+    size_t read(unsigned long long offset, char *buf, size_t len);
+
+    virtual void dump(std::ostream &strm) const;
+};
+
+#endif /* DISPATCH_BESUNCOMPRESSINDEX_H_ */
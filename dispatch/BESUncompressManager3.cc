@@ -25,7 +25,12 @@
 // You can contact University Corporation for Atmospheric Research at
 // 3080 Center Green Drive, Boulder, CO 80301
 
+#include "config.h"
+
+#include <unistd.h>
+
 #include <sstream>
+#include <memory>
 
 using std::istringstream;
 
@@ -33,16 +38,24 @@ using std::istringstream;
 #include "BESUncompress3GZ.h"
 #include "BESUncompress3BZ2.h"
 #include "BESUncompress3Z.h"
+#include "BESUncompressIndex.h"
+#include "BESUncompressParallel.h"
+#include "BESUncompressCache.h"
 
 #include "BESFileLockingCache.h"
 
 #include "BESInternalError.h"
 #include "BESDebug.h"
+#include "BESUtil.h"
 
 #include "TheBESKeys.h"
 
 BESUncompressManager3 *BESUncompressManager3::_instance = 0;
 
+// About how much uncompressed data lies between two access points of a
+// gzip index
+#define SEEKABLE_DEFAULT_SPAN 1048576
+
 /** @brief constructs an uncompression manager adding gz, z, and bz2
  * uncompression methods by default.
  *
@@ -51,12 +64,56 @@ BESUncompressManager3 *BESUncompressManager3::_instance = 0;
  * Looks for a configuration parameter for the number of times to try to
  * lock the cache (BES.Uncompress.NumTries) and the time in microseconds
  * between tries (BES.Uncompress.Retry).
+ *
+ * Also looks for BES.Uncompress.Seekable (true or yes turns on get_index();
+ * the default is off) and BES.Uncompress.Seekable.Span (the number of
+ * bytes of uncompressed data between the access points of a gzip index).
+ *
+ * BES.Uncompress.Threads is the most threads used to uncompress a bzip2
+ * file or a gzip file with several members; 1 uncompresses all files as a
+ * stream. Big gzip members are uncompressed to temporary files in the
+ * uncompress cache directory (BES.UncompressCache.dir).
  */
-BESUncompressManager3::BESUncompressManager3()
+BESUncompressManager3::BESUncompressManager3() :
+    _seekable(false), _span(SEEKABLE_DEFAULT_SPAN)
 {
     add_method("gz", BESUncompress3GZ::uncompress);
     add_method("bz2", BESUncompress3BZ2::uncompress);
     add_method("Z", BESUncompress3Z::uncompress);
+
+    bool found = false;
+    string value;
+    TheBESKeys::TheKeys()->get_value("BES.Uncompress.Seekable", value, found);
+    if (found) {
+        value = BESUtil::lowercase(value);
+        _seekable = (value == "true" || value == "yes");
+    }
+
+    TheBESKeys::TheKeys()->get_value("BES.Uncompress.Seekable.Span", value, found);
+    if (found && !value.empty()) {
+        istringstream iss(value);
+        unsigned long long span;
+        if (!(iss >> span) || span == 0) {
+            string err = "The value of BES.Uncompress.Seekable.Span must be a positive integer, not '" + value + "'";
+            throw BESInternalError(err, __FILE__, __LINE__);
+        }
+        _span = span;
+    }
+
+    TheBESKeys::TheKeys()->get_value("BES.Uncompress.Threads", value, found);
+    if (found && !value.empty()) {
+        istringstream iss(value);
+        unsigned int threads;
+        if (!(iss >> threads) || threads == 0) {
+            string err = "The value of BES.Uncompress.Threads must be a positive integer, not '" + value + "'";
+            throw BESInternalError(err, __FILE__, __LINE__);
+        }
+        BESUncompressParallel::set_max_threads(threads);
+    }
+
+    // Big gzip members are uncompressed in parallel to temporary files here
+    TheBESKeys::TheKeys()->get_value(BESUncompressCache::DIR_KEY, value, found);
+    if (found) BESUncompressParallel::set_temp_dir(value);
 }
 
 /** @brief create_and_lock a uncompress method to the list
@@ -221,6 +278,86 @@ bool BESUncompressManager3::uncompress(const string &src, string &cache_file, BE
     return false;   // gcc warns without this
 }
 
+/** @brief Get an index that can read parts of a compressed file
+ *
+ * Unlike uncompress(), this does not write the uncompressed data to the
+ * cache. The first time a file is seen, it is uncompressed once to build an
+ * index of access points (see BESUncompressIndex) and the index is written
+ * to the cache; after that the index is just read.
+ *
+ * @param src The compressed file
+ * @param cache The uncompress cache
+ * @return A new index that the caller must delete, or null if seekable
+ * mode is off or src is not a .gz or .bz2 file. While the index exists, it
+ * holds a read lock on its file in the cache.
+ * @throws BESInternalError if there is a problem uncompressing src or
+ * writing the index
+ */
+BESUncompressIndex *BESUncompressManager3::get_index(const string &src, BESFileLockingCache *cache)
+{
+    BESDEBUG( "uncompress2", "BESUncompressManager3::get_index() - src: " << src << endl );
+
+    if (!_seekable || cache == NULL) return 0;
+
+    string::size_type dot = src.rfind(".");
+    if (dot == string::npos) return 0;
+
+    string ext = src.substr(dot + 1);
+    BESUncompressIndex::format format;
+    if (ext == "gz")
+        format = BESUncompressIndex::gz;
+#ifdef HAVE_BZLIB_H
+    else if (ext == "bz2")
+        format = BESUncompressIndex::bz2;
+#endif
+    else
+        return 0;
+
+    string index_name = cache->get_cache_file_name(src) + ".idx";
+    std::auto_ptr<BESUncompressIndex> index(new BESUncompressIndex(src, format, index_name, cache));
+
+    int fd;
+    if (cache->get_read_lock(index_name, fd)) {
+        if (index->load(fd)) {
+            BESDEBUG( "uncompress", "BESUncompressManager3::get_index() - cached hit: " << index_name << endl );
+            return index.release();
+        }
+
+        // The source changed after the index was made
+        cache->unlock_and_close(index_name);
+        cache->purge_file(index_name);
+    }
+
+    if (cache->create_and_lock(index_name, fd)) {
+        BESDEBUG( "uncompress", "BESUncompressManager3::get_index() - indexing " << src << endl );
+        try {
+            index->build(fd, _span);
+        }
+        catch (...) {
+            BESDEBUG( "uncompress", "BESUncompressManager3::get_index() - caught exception, removing the index." << endl );
+            unlink(index_name.c_str());
+            cache->unlock_and_close(index_name);
+            throw;
+        }
+
+        cache->exclusive_to_shared_lock(fd);
+
+        unsigned long long size = cache->update_cache_info(index_name);
+        if (cache->cache_too_big(size))
+            cache->update_and_purge(index_name);
+
+        return index.release();
+    }
+
+    // Another process made the index after this one looked for it
+    if (cache->get_read_lock(index_name, fd)) {
+        if (index->load(fd)) return index.release();
+        cache->unlock_and_close(index_name);
+    }
+
+    return 0;
+}
+
 /** @brief dumps information about this object
  *
  * Displays the pointer value of this instance along with the names of the
@@ -245,6 +382,9 @@ void BESUncompressManager3::dump(ostream &strm) const
     else {
         strm << BESIndent::LMarg << "registered uncompress methods: none" << endl;
     }
+    strm << BESIndent::LMarg << "seekable: " << (_seekable ? "yes" : "no") << endl;
+    strm << BESIndent::LMarg << "span: " << _span << endl;
+    strm << BESIndent::LMarg << "threads: " << BESUncompressParallel::get_max_threads() << endl;
     BESIndent::UnIndent();
 }
 
@@ -36,6 +36,7 @@ using std::string;
 #include "BESObj.h"
 
 class BESFileLockingCache;
+class BESUncompressIndex;
 
 typedef void (*p_bes_uncompress)(const string &src, int fd);
 
@@ -50,9 +51,14 @@ typedef void (*p_bes_uncompress)(const string &src, int fd);
  * of compressed file. The manager knows which type to decompress by the
  * file extension.
  *
+ * When BES.Uncompress.Seekable is true, get_index() returns an index that
+ * handlers which do their own reads can use to read parts of a .gz or .bz2
+ * file without uncompressing all of it into the cache.
+ *
  * @see BESUncompressGZ
  * @see BESUncompressBZ2
  * @see BESUncompressZ
+ * @see BESUncompressIndex
  * @see BESCache
  */
 class BESUncompressManager3: public BESObj {
@@ -61,6 +67,9 @@ private:
     map<string, p_bes_uncompress> _uncompress_list;
     typedef map<string, p_bes_uncompress>::const_iterator UCIter;
 
+    bool _seekable;
+    unsigned long long _span;
+
     BESUncompressManager3(void);
 
 public:
@@ -72,6 +81,13 @@ public:
     virtual p_bes_uncompress find_method(const string &name);
 
     virtual bool uncompress(const string &src, string &target, BESFileLockingCache *cache);
+    virtual BESUncompressIndex *get_index(const string &src, BESFileLockingCache *cache);
+
+    /// @return True if get_index() can return indexes
+    bool is_seekable() const
+    {
+        return _seekable;
+    }
 
     virtual void dump(ostream &strm) const ;
 
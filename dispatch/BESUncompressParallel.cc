@@ -0,0 +1,234 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "config.h"
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+
+#include "BESUncompressParallel.h"
+#include "BESError.h"
+#include "BESInternalError.h"
+#include "BESDebug.h"
+
+using namespace std;
+
+#define BES_UNCOMPRESS_DEFAULT_THREADS 4
+
+// How many pieces each thread gets in a batch. The pieces of a batch are
+// all held in memory until they are written.
+#define PIECES_PER_THREAD 2
+
+unsigned int BESUncompressParallel::d_max_threads = BES_UNCOMPRESS_DEFAULT_THREADS;
+string BESUncompressParallel::d_temp_dir;
+
+/**
+ * @brief Set the most threads used to uncompress one file
+ *
+ * One means the files are uncompressed the old way, as a stream.
+ *
+ * @param n The number of threads, including the calling thread. Zero is
+ * taken as one.
+ */
+void BESUncompressParallel::set_max_threads(unsigned int n)
+{
+    d_max_threads = max(n, 1U);
+}
+
+/**
+ * @brief Set the directory for pieces too big to hold in memory
+ *
+ * This should be on the same file system as the uncompressed files (e.g.,
+ * the uncompress cache directory). Set before any file is uncompressed.
+ *
+ * @param dir The directory; empty means big pieces are uncompressed by the
+ * calling thread as they are written.
+ */
+void BESUncompressParallel::set_temp_dir(const string &dir)
+{
+    d_temp_dir = dir;
+}
+
+/**
+ * @param src The name of the compressed file, for messages
+ * @param src_fd An open file descriptor for the compressed file
+ * @param dest_fd Where to write the uncompressed data
+ * @param contiguous If true, the pieces follow one another and anything
+ * after the last one is not compressed data (gzip). Otherwise there may be
+ * gaps between pieces (bzip2 stream trailers and headers).
+ */
+BESUncompressParallel::BESUncompressParallel(const string &src, int src_fd, int dest_fd, bool contiguous) :
+    d_first(0), d_next(0), d_last(0), d_src(src), d_src_fd(src_fd), d_dest_fd(dest_fd), d_contiguous(contiguous)
+{
+    if (pthread_mutex_init(&d_mutex, 0) != 0)
+        throw BESInternalError("Could not initialize the uncompress mutex.", __FILE__, __LINE__);
+}
+
+BESUncompressParallel::~BESUncompressParallel()
+{
+    pthread_mutex_destroy(&d_mutex);
+}
+
+/// Write to the destination file
+void BESUncompressParallel::write(const char *data, size_t len)
+{
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = ::write(d_dest_fd, data + total, len - total);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ostringstream oss;
+            oss << "Error writing uncompressed data for file " << d_src << ": wrote " << total << " instead of "
+                << len;
+            throw BESInternalError(oss.str(), __FILE__, __LINE__);
+        }
+        total += n;
+    }
+}
+
+/**
+ * Uncompress pieces of the batch until there are none left or one fails.
+ * Run by each worker thread and by the calling thread.
+ */
+void *BESUncompressParallel::m_worker(void *arg)
+{
+    BESUncompressParallel &work = *static_cast<BESUncompressParallel*>(arg);
+
+    while (true) {
+        pthread_mutex_lock(&work.d_mutex);
+        vector<piece>::size_type i = work.d_next++;
+        bool done = i >= work.d_last || !work.d_error.empty();
+        pthread_mutex_unlock(&work.d_mutex);
+
+        if (done) break;
+
+        // Each piece has its own slot; the vector is not resized while the
+        // workers run
+        piece &p = work.d_pieces[i - work.d_first];
+        string msg;
+        try {
+            p.ok = work.uncompress_piece(i, p.end, p.data);
+        }
+        catch (BESError &e) {
+            msg = e.get_message();
+        }
+        catch (std::exception &e) {
+            msg = e.what();
+        }
+        catch (...) {
+            msg = "Unknown error uncompressing " + work.d_src;
+        }
+
+        if (!msg.empty()) {
+            pthread_mutex_lock(&work.d_mutex);
+            if (work.d_error.empty()) work.d_error = msg;
+            pthread_mutex_unlock(&work.d_mutex);
+        }
+    }
+
+    return 0;
+}
+
+void BESUncompressParallel::m_uncompress_batch(vector<piece>::size_type first, vector<piece>::size_type last)
+{
+    d_pieces.clear();
+    d_pieces.resize(last - first);
+    d_first = first;
+    d_next = first;
+    d_last = last;
+    d_error.clear();
+
+    // Block all signals while the workers are made so that they inherit a
+    // mask that leaves SIGALRM, SIGPIPE, etc., to the main thread.
+    vector<pthread_t> threads;
+    unsigned int n_threads = min(d_max_threads, static_cast<unsigned int>(last - first));
+    if (n_threads > 1) {
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+
+        // This thread is one of the workers
+        for (unsigned int i = 1; i < n_threads; ++i) {
+            pthread_t thread;
+            int status = pthread_create(&thread, 0, m_worker, this);
+            if (status != 0) {
+                // Uncompress with the threads we have
+                BESDEBUG("uncompress", "BESUncompressParallel - Could not start a worker thread: " << strerror(status) << endl);
+                break;
+            }
+            threads.push_back(thread);
+        }
+
+        pthread_sigmask(SIG_SETMASK, &old, 0);
+    }
+
+    m_worker(this);
+
+    for (vector<pthread_t>::iterator i = threads.begin(), e = threads.end(); i != e; ++i)
+        pthread_join(*i, 0);
+
+    if (!d_error.empty()) throw BESInternalError(d_error, __FILE__, __LINE__);
+}
+
+/**
+ * @brief Uncompress the file
+ *
+ * @param starts The places where pieces may start, in file order. The
+ * first must be a real piece. The units are up to the subclass.
+ * @throws BESInternalError if a piece cannot be uncompressed or written
+ */
+void BESUncompressParallel::run(const vector<unsigned long long> &starts)
+{
+    vector<unsigned long long>::size_type batch = d_max_threads * PIECES_PER_THREAD;
+
+    BESDEBUG("uncompress", "BESUncompressParallel::run() - " << starts.size() << " pieces of " << d_src << " using "
+        << d_max_threads << " threads" << endl);
+
+    bool started = false;
+    unsigned long long pos = 0;     // the end of the last piece written
+    for (vector<unsigned long long>::size_type first = 0; first < starts.size(); first += batch) {
+        vector<unsigned long long>::size_type last = min(starts.size(), first + batch);
+        m_uncompress_batch(first, last);
+
+        for (vector<unsigned long long>::size_type i = first; i < last; ++i) {
+            // Not a piece; the magic number is part of the last one written
+            if (started && starts[i] < pos) continue;
+            // The rest of the file is not compressed data
+            if (started && d_contiguous && starts[i] > pos) return;
+
+            piece &p = d_pieces[i - first];
+            if (p.ok) {
+                write(p.data.data(), p.data.size());
+                pos = p.end;
+            }
+            else {
+                pos = write_piece(i);
+            }
+            started = true;
+
+            string().swap(p.data);
+        }
+    }
+}
@@ -0,0 +1,130 @@
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef DISPATCH_BESUNCOMPRESSPARALLEL_H_
+#define DISPATCH_BESUNCOMPRESSPARALLEL_H_
+
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Uncompress the independent pieces of a file on several threads
+ *
+ * A bzip2 file is a series of blocks and a gzip file can be a series of
+ * members (e.g., the output of cat on several .gz files or of bgzip; pigz
+ * writes a single member); each one can be uncompressed without the
+ * others. A subclass finds the places
+ * in the compressed file where pieces may start and uncompresses one piece
+ * into memory; run() does that for a batch of pieces at a time on a pool
+ * of threads and writes the results, in order, to the destination file.
+ *
+ * The places are allowed to include some that are not really the start of
+ * a piece (the magic numbers can turn up inside compressed data). Those
+ * fall inside a piece that has been written and are skipped. When a
+ * subclass does not uncompress a piece into memory (it's too big, or it
+ * does not end where expected), write_piece() is asked to write it. A
+ * subclass may have put a big piece in a temporary file in get_temp_dir()
+ * for write_piece() to copy.
+ */
+class BESUncompressParallel {
+private:
+    static unsigned int d_max_threads;
+    static std::string d_temp_dir;
+
+    // The result of uncompress_piece()
+    struct piece {
+        bool ok;
+        unsigned long long end;
+        std::string data;
+
+        piece() : ok(false), end(0) { }
+    };
+
+    pthread_mutex_t d_mutex;
+    std::vector<piece> d_pieces;        ///< The current batch
+    std::vector<piece>::size_type d_first, d_next, d_last;
+    std::string d_error;                ///< The first error in the batch, if any
+
+    BESUncompressParallel(const BESUncompressParallel &);
+    BESUncompressParallel &operator=(const BESUncompressParallel &);
+
+    static void *m_worker(void *arg);
+    void m_uncompress_batch(std::vector<piece>::size_type first, std::vector<piece>::size_type last);
+
+protected:
+    std::string d_src;
+    int d_src_fd;
+    int d_dest_fd;
+    bool d_contiguous;
+
+    /**
+     * @brief Uncompress the piece that may start at starts[i]
+     *
+     * Called on worker threads; it must not use state that isn't its own
+     * other than reading the source file with pread().
+     *
+     * @param i The index of the piece's start
+     * @param end Value-result parameter; where the piece ends
+     * @param data Value-result parameter; the uncompressed piece
+     * @return False if no piece starts at starts[i] or it could not be
+     * uncompressed into memory
+     */
+    virtual bool uncompress_piece(std::vector<unsigned long long>::size_type i, unsigned long long &end,
+        std::string &data) = 0;
+
+    /**
+     * @brief Write the piece that starts at starts[i] to the destination
+     *
+     * Called, on the calling thread, for a piece that uncompress_piece()
+     * would not do.
+     *
+     * @return Where the piece ends
+     * @throws BESInternalError if there is no piece at starts[i]
+     */
+    virtual unsigned long long write_piece(std::vector<unsigned long long>::size_type i) = 0;
+
+    void write(const char *data, size_t len);
+
+public:
+    BESUncompressParallel(const std::string &src, int src_fd, int dest_fd, bool contiguous);
+    virtual ~BESUncompressParallel();
+
+    void run(const std::vector<unsigned long long> &starts);
+
+    static void set_max_threads(unsigned int n);
+
+    /// @return The most threads used to uncompress one file
+    static unsigned int get_max_threads()
+    {
+        return d_max_threads;
+    }
+
+    static void set_temp_dir(const std::string &dir);
+
+    /// @return Where big pieces may be kept until they are written; empty if nowhere
+    static std::string get_temp_dir()
+    {
+        return d_temp_dir;
+    }
+};
+
+#endif /* DISPATCH_BESUNCOMPRESSPARALLEL_H_ */
@@ -312,9 +312,32 @@ public:
     CPPUNIT_TEST(default_test);
     CPPUNIT_TEST(no_default_test);
     CPPUNIT_TEST(root_dir_test1);
+    CPPUNIT_TEST(paging_test);
 
     CPPUNIT_TEST_SUITE_END();
 
+    // Run a show catalog request for the 'paged' catalog's root node and
+    // return the response with the lastModified and size values removed.
+    string show_paged(const string &offset, const string &limit, const string &sort, const string &order)
+    {
+        BESDataHandlerInterface dhi;
+        dhi.data[CONTAINER] = "paged";
+        dhi.data[CATALOG_OR_INFO] = CATALOG_RESPONSE;
+        dhi.data[CATALOG_OFFSET] = offset;
+        dhi.data[CATALOG_LIMIT] = limit;
+        dhi.data[CATALOG_SORT] = sort;
+        dhi.data[CATALOG_ORDER] = order;
+        BESCatalogResponseHandler handler("catalog");
+        handler.execute(dhi);
+        BESInfo *info = dynamic_cast<BESInfo *>(handler.get_response_object());
+        CPPUNIT_ASSERT(info);
+        ostringstream strm;
+        info->print(strm);
+        string strm_s = strm.str();
+        string str = remove(strm_s, "lastModified", 0);
+        return remove(str, "size", 0);
+    }
+
 
     void default_test()
     {
@@ -686,6 +709,80 @@ public:
         DBG(cerr << "*****************************************" << endl);
         DBG(cerr << "Returning from catT::run" << endl);
     }
+
+    void paging_test() {
+        if (!BESCatalogList::TheCatalogList()->find_catalog("paged")) {
+            string var = (string) "BES.Catalog.paged.RootDirectory=" + TEST_SRC_DIR + root_dir;
+            TheBESKeys::TheKeys()->set_key(var);
+            TheBESKeys::TheKeys()->set_key("BES.Catalog.paged.TypeMatch=info:info&;");
+            TheBESKeys::TheKeys()->set_key("BES.Catalog.paged.Include=.*file.*$;");
+            TheBESKeys::TheKeys()->set_key("BES.Catalog.paged.Exclude=README;");
+            try {
+                BESCatalogList::TheCatalogList()->add_catalog(new BESCatalogDirectory("paged"));
+            }
+            catch (BESError &e) {
+                DBG(cerr << e.get_message() << endl);
+                CPPUNIT_FAIL("Failed to add catalog");
+            }
+        }
+
+        try {
+            DBG(cerr << "first page of two" << endl);
+            string str = show_paged("0", "2", "", "");
+            DBG(cerr << "response: " << str << endl);
+            CPPUNIT_ASSERT(str.find("count=\"3\"") != string::npos);
+            CPPUNIT_ASSERT(str.find("offset=\"0\"") != string::npos);
+            CPPUNIT_ASSERT(str.find("limit=\"2\"") != string::npos);
+            CPPUNIT_ASSERT(str.find("name=\"paged/child_dir\"") != string::npos);
+            CPPUNIT_ASSERT(str.find("name=\"paged/file1\"") != string::npos);
+            CPPUNIT_ASSERT(str.find("name=\"paged/file2\"") == string::npos);
+
+            DBG(cerr << "second page, served from the listing cache" << endl);
+            str = show_paged("2", "2", "", "");
+            DBG(cerr << "response: " << str << endl);
+            CPPUNIT_ASSERT(str.find("count=\"3\"") != string::npos);
+            CPPUNIT_ASSERT(str.find("name=\"paged/child_dir\"") == string::npos);
+            CPPUNIT_ASSERT(str.find("name=\"paged/file1\"") == string::npos);
+            CPPUNIT_ASSERT(str.find("name=\"paged/file2\"") != string::npos);
+
+            DBG(cerr << "descending by name" << endl);
+            str = show_paged("0", "2", "name", "descending");
+            DBG(cerr << "response: " << str << endl);
+            string::size_type file2 = str.find("name=\"paged/file2\"");
+            string::size_type file1 = str.find("name=\"paged/file1\"");
+            CPPUNIT_ASSERT(file2 != string::npos && file1 != string::npos);
+            CPPUNIT_ASSERT(file2 < file1);
+            CPPUNIT_ASSERT(str.find("name=\"paged/child_dir\"") == string::npos);
+
+            DBG(cerr << "past the end" << endl);
+            str = show_paged("10", "", "", "");
+            DBG(cerr << "response: " << str << endl);
+            CPPUNIT_ASSERT(str.find("count=\"3\"") != string::npos);
+            CPPUNIT_ASSERT(str.find("node=\"true\"") != string::npos);
+            CPPUNIT_ASSERT(str.find("name=\"paged/file") == string::npos);
+        }
+        catch (BESError &e) {
+            DBG(cerr << e.get_message() << endl);
+            CPPUNIT_FAIL("Failed to show paged catalog");
+        }
+
+        DBG(cerr << "bad paging values" << endl);
+        try {
+            show_paged("-1", "", "", "");
+            CPPUNIT_FAIL("Should have failed, negative offset");
+        }
+        catch (BESError &e) {
+            DBG(cerr << e.get_message() << endl);
+        }
+
+        try {
+            show_paged("", "", "color", "");
+            CPPUNIT_FAIL("Should have failed, unknown sort");
+        }
+        catch (BESError &e) {
+            DBG(cerr << e.get_message() << endl);
+        }
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(catT);
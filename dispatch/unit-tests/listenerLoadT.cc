@@ -0,0 +1,169 @@
+// listenerLoadT.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace CppUnit;
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <iostream>
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+#include "BESListenerLoad.h"
+#include <GetOpt.h>
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+class listenerLoadT: public TestFixture {
+public:
+    listenerLoadT()
+    {
+    }
+    ~listenerLoadT()
+    {
+    }
+
+CPPUNIT_TEST_SUITE( listenerLoadT );
+
+    CPPUNIT_TEST( not_initialized_test );
+    CPPUNIT_TEST( values_test );
+    CPPUNIT_TEST( shared_test );
+
+    CPPUNIT_TEST_SUITE_END();
+
+    // Runs first; besstandalone never makes the values
+    void not_initialized_test()
+    {
+        BESListenerLoad::Load load;
+        CPPUNIT_ASSERT(!BESListenerLoad::initialized());
+        CPPUNIT_ASSERT(!BESListenerLoad::get(load));
+
+        // These do nothing
+        BESListenerLoad::set_children(3);
+        BESListenerLoad::rejected(true);
+    }
+
+    void values_test()
+    {
+        BESListenerLoad::initialize(8, 16, 10);
+        BESListenerLoad::set_children(5);
+        BESListenerLoad::set_queued(2);
+        BESListenerLoad::rejected(false);
+        BESListenerLoad::rejected(true);
+
+        BESListenerLoad::Load load;
+        CPPUNIT_ASSERT(BESListenerLoad::get(load));
+        CPPUNIT_ASSERT(load.max_children == 8);
+        CPPUNIT_ASSERT(load.queue_size == 16);
+        CPPUNIT_ASSERT(load.queue_timeout == 10);
+        CPPUNIT_ASSERT(load.children == 5);
+        CPPUNIT_ASSERT(load.queued == 2);
+        CPPUNIT_ASSERT(load.rejected == 2);
+        CPPUNIT_ASSERT(load.timed_out == 1);
+
+        // Initializing again changes only the limits
+        BESListenerLoad::initialize(4, 0, 0);
+        CPPUNIT_ASSERT(BESListenerLoad::get(load));
+        CPPUNIT_ASSERT(load.max_children == 4);
+        CPPUNIT_ASSERT(load.children == 5);
+    }
+
+    // A child listener sees the values the master sets after the fork
+    void shared_test()
+    {
+        BESListenerLoad::initialize(4, 8, 10);
+        BESListenerLoad::set_children(0);
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            BESListenerLoad::Load load;
+            for (int i = 0; i < 500; ++i) {
+                if (BESListenerLoad::get(load) && load.children == 3) _exit(0);
+                usleep(10000);
+            }
+            _exit(1);
+        }
+        CPPUNIT_ASSERT(pid > 0);
+
+        BESListenerLoad::set_children(3);
+
+        int status;
+        waitpid(pid, &status, 0);
+        DBG(cerr << "child status: " << WEXITSTATUS(status) << endl);
+        CPPUNIT_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( listenerLoadT );
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    char option_char;
+    while ((option_char = getopt()) != EOF)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: listenerLoadT has the following tests:" << endl;
+            const std::vector<Test*> &tests = listenerLoadT::suite()->getTests();
+            unsigned int prefix_len = listenerLoadT::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = listenerLoadT::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
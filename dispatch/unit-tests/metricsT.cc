@@ -0,0 +1,343 @@
+// metricsT.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace CppUnit;
+
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using std::cerr;
+using std::endl;
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+#include "BESMetrics.h"
+#include "BESError.h"
+#include <GetOpt.h>
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+class metricsT: public TestFixture {
+private:
+    string d_file;
+
+    static const BESMetrics::Metric *get(const vector<BESMetrics::Metric> &metrics, const string &name)
+    {
+        for (vector<BESMetrics::Metric>::const_iterator i = metrics.begin(), e = metrics.end(); i != e; ++i)
+            if (i->name == name) return &(*i);
+        return 0;
+    }
+
+public:
+    metricsT()
+    {
+    }
+    ~metricsT()
+    {
+    }
+
+    void setUp()
+    {
+        ostringstream name;
+        name << "/tmp/metricsT_" << getpid();
+        d_file = name.str();
+        unlink(d_file.c_str());
+    }
+
+    void tearDown()
+    {
+        unlink(d_file.c_str());
+        unlink((d_file + ".prom").c_str());
+        unlink((d_file + ".other").c_str());
+    }
+
+CPPUNIT_TEST_SUITE( metricsT );
+
+    CPPUNIT_TEST( counter_test );
+    CPPUNIT_TEST( shared_counter_test );
+    CPPUNIT_TEST( type_mismatch_test );
+    CPPUNIT_TEST( reader_test );
+    CPPUNIT_TEST( reset_gauges_test );
+    CPPUNIT_TEST( foreign_file_test );
+    CPPUNIT_TEST( bucket_test );
+    CPPUNIT_TEST( quantile_test );
+    CPPUNIT_TEST( prometheus_test );
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void counter_test()
+    {
+        BESMetrics metrics(d_file, true);
+        metrics.add("c", BESMetrics::counter_type, 1);
+        metrics.add("c", BESMetrics::counter_type, 2);
+        metrics.add("g", BESMetrics::gauge_type, 5);
+        metrics.add("g", BESMetrics::gauge_type, -3);
+
+        vector<BESMetrics::Metric> m = metrics.get_metrics();
+        CPPUNIT_ASSERT(m.size() == 2);
+        CPPUNIT_ASSERT(get(m, "c") && get(m, "c")->value == 3);
+        CPPUNIT_ASSERT(get(m, "g") && get(m, "g")->value == 2);
+        CPPUNIT_ASSERT(get(m, "g")->type == BESMetrics::gauge_type);
+    }
+
+    // Processes that share the mapping (as the beslistener children do) add
+    // to the same values, including metrics first used by a child
+    void shared_counter_test()
+    {
+        BESMetrics metrics(d_file, true);
+        metrics.add("requests", BESMetrics::counter_type, 1);
+
+        const int children = 4;
+        for (int i = 0; i < children; ++i) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                for (int j = 0; j < 1000; ++j) {
+                    metrics.add("requests", BESMetrics::counter_type, 1);
+                    metrics.add("child_requests", BESMetrics::counter_type, 1);
+                }
+                _exit(0);
+            }
+            CPPUNIT_ASSERT(pid > 0);
+        }
+
+        for (int i = 0; i < children; ++i) {
+            int status;
+            wait(&status);
+            CPPUNIT_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        }
+
+        vector<BESMetrics::Metric> m = metrics.get_metrics();
+        DBG(cerr << "requests: " << get(m, "requests")->value << endl);
+        CPPUNIT_ASSERT(get(m, "requests")->value == 1 + children * 1000);
+        CPPUNIT_ASSERT(get(m, "child_requests") && get(m, "child_requests")->value == children * 1000);
+    }
+
+    void type_mismatch_test()
+    {
+        BESMetrics metrics(d_file, true);
+        metrics.add("x", BESMetrics::counter_type, 1);
+        metrics.add("x", BESMetrics::gauge_type, 10);
+        metrics.record("x", 10);
+
+        vector<BESMetrics::Metric> m = metrics.get_metrics();
+        CPPUNIT_ASSERT(m.size() == 1);
+        CPPUNIT_ASSERT(m[0].type == BESMetrics::counter_type);
+        CPPUNIT_ASSERT(m[0].value == 1);
+    }
+
+    void reader_test()
+    {
+        try {
+            BESMetrics reader(d_file, false);
+            CPPUNIT_FAIL("Expected an exception; the file does not exist");
+        }
+        catch (BESError &e) {
+            DBG(cerr << e.get_message() << endl);
+        }
+
+        BESMetrics writer(d_file, true);
+        writer.add("c", BESMetrics::counter_type, 7);
+
+        BESMetrics reader(d_file, false);
+        vector<BESMetrics::Metric> m = reader.get_metrics();
+        CPPUNIT_ASSERT(m.size() == 1 && m[0].value == 7);
+
+        // Opening the file again to write it keeps the values
+        BESMetrics writer2(d_file, true);
+        CPPUNIT_ASSERT(writer2.get_metrics()[0].value == 7);
+    }
+
+    // A new master beslistener clears the gauges but keeps the counters
+    void reset_gauges_test()
+    {
+        {
+            BESMetrics metrics(d_file, true);
+            metrics.add("c", BESMetrics::counter_type, 4);
+            metrics.add("in_flight", BESMetrics::gauge_type, 3);
+        }
+
+        BESMetrics metrics(d_file, true);
+        metrics.reset_gauges();
+
+        vector<BESMetrics::Metric> m = metrics.get_metrics();
+        CPPUNIT_ASSERT(m.size() == 2);
+        CPPUNIT_ASSERT(get(m, "c")->value == 4);
+        CPPUNIT_ASSERT(get(m, "in_flight")->value == 0);
+    }
+
+    // A file that is not a metrics file, or a link to one, is never changed
+    void foreign_file_test()
+    {
+        string other = d_file + ".other";
+        FILE *f = fopen(other.c_str(), "w");
+        CPPUNIT_ASSERT(f);
+        fputs("not metrics\n", f);
+        fclose(f);
+
+        CPPUNIT_ASSERT_THROW(BESMetrics(other, true), BESError);
+
+        CPPUNIT_ASSERT(symlink(other.c_str(), d_file.c_str()) == 0);
+        CPPUNIT_ASSERT_THROW(BESMetrics(d_file, true), BESError);
+
+        struct stat buf;
+        CPPUNIT_ASSERT(stat(other.c_str(), &buf) == 0 && buf.st_size == 12);
+
+        // An empty file is made into a metrics file
+        unlink(d_file.c_str());
+        f = fopen(d_file.c_str(), "w");
+        CPPUNIT_ASSERT(f);
+        fclose(f);
+        BESMetrics metrics(d_file, true);
+        metrics.add("c", BESMetrics::counter_type, 1);
+        CPPUNIT_ASSERT(metrics.get_metrics().size() == 1);
+    }
+
+    void bucket_test()
+    {
+        CPPUNIT_ASSERT(BESMetrics::bucket(0) == 0);
+        CPPUNIT_ASSERT(BESMetrics::bucket(3) == 3);
+        CPPUNIT_ASSERT(BESMetrics::bucket(4) == 4);
+        CPPUNIT_ASSERT(BESMetrics::bucket(7) == 7);
+        CPPUNIT_ASSERT(BESMetrics::bucket(8) == 8);
+        CPPUNIT_ASSERT(BESMetrics::bucket(9) == 8);
+        CPPUNIT_ASSERT(BESMetrics::bucket(10) == 9);
+
+        // Every value is less than its bucket's upper bound and at least the
+        // bound of the bucket below it
+        for (unsigned long long v = 1; v < 100000000ULL; v = v * 3 / 2 + 1) {
+            unsigned int b = BESMetrics::bucket(v);
+            CPPUNIT_ASSERT(v < BESMetrics::bucket_upper_bound(b));
+            CPPUNIT_ASSERT(b == 0 || v >= BESMetrics::bucket_upper_bound(b - 1));
+        }
+
+        CPPUNIT_ASSERT(BESMetrics::bucket(~0ULL) == BESMetrics::NUM_BUCKETS - 1);
+    }
+
+    void quantile_test()
+    {
+        BESMetrics metrics(d_file, true);
+        // 90 fast requests (1ms) and 10 slow ones (1s)
+        for (int i = 0; i < 90; ++i)
+            metrics.record("d", 1000);
+        for (int i = 0; i < 10; ++i)
+            metrics.record("d", 1000000);
+
+        vector<BESMetrics::Metric> m = metrics.get_metrics();
+        CPPUNIT_ASSERT(m.size() == 1);
+        CPPUNIT_ASSERT(m[0].value == 100);
+        CPPUNIT_ASSERT(m[0].sum == 90 * 1000 + 10 * 1000000);
+
+        double p50 = m[0].quantile(0.5);
+        double p99 = m[0].quantile(0.99);
+        DBG(cerr << "p50: " << p50 << ", p99: " << p99 << endl);
+        CPPUNIT_ASSERT(p50 > 1000 && p50 <= 1250);
+        CPPUNIT_ASSERT(p99 > 1000000 && p99 <= 1250000);
+    }
+
+    void prometheus_test()
+    {
+        BESMetrics metrics(d_file, true);
+        metrics.add("bes_requests_total{action=\"get.dods\"}", BESMetrics::counter_type, 2);
+        metrics.add("bes_requests_total{action=\"get.das\"}", BESMetrics::counter_type, 1);
+        metrics.record("bes_request_duration_seconds{action=\"get.dods\"}", 3);
+
+        ostringstream oss;
+        metrics.write_prometheus(oss);
+        string text = oss.str();
+        DBG(cerr << text << endl);
+
+        // One TYPE line for each metric, whatever its labels
+        string::size_type pos = text.find("# TYPE bes_requests_total counter\n");
+        CPPUNIT_ASSERT(pos != string::npos);
+        CPPUNIT_ASSERT(text.find("# TYPE bes_requests_total", pos + 1) == string::npos);
+
+        CPPUNIT_ASSERT(text.find("bes_requests_total{action=\"get.dods\"} 2\n") != string::npos);
+        CPPUNIT_ASSERT(text.find("bes_requests_total{action=\"get.das\"} 1\n") != string::npos);
+        CPPUNIT_ASSERT(text.find("# TYPE bes_request_duration_seconds histogram\n") != string::npos);
+        CPPUNIT_ASSERT(text.find("bes_request_duration_seconds_bucket{action=\"get.dods\",le=\"4e-06\"} 1\n") != string::npos);
+        CPPUNIT_ASSERT(text.find("bes_request_duration_seconds_bucket{action=\"get.dods\",le=\"+Inf\"} 1\n") != string::npos);
+        CPPUNIT_ASSERT(text.find("bes_request_duration_seconds_count{action=\"get.dods\"} 1\n") != string::npos);
+
+        metrics.write_prometheus_file(d_file + ".prom");
+        CPPUNIT_ASSERT(access((d_file + ".prom").c_str(), R_OK) == 0);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( metricsT );
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    char option_char;
+    while ((option_char = getopt()) != EOF)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: metricsT has the following tests:" << endl;
+            const std::vector<Test*> &tests = metricsT::suite()->getTests();
+            unsigned int prefix_len = metricsT::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = metricsT::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+// tracerT.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace CppUnit;
+
+#include <unistd.h>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using std::cerr;
+using std::endl;
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+#include "BESTracer.h"
+#include <GetOpt.h>
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+class tracerT: public TestFixture {
+private:
+    // Record a span the way BESStopWatch does
+    static void span(BESTracer &tracer, const string &name, unsigned long long read = 0)
+    {
+        unsigned long long start = BESTracer::wall_time();
+        unsigned long long cpu = BESTracer::cpu_time();
+        unsigned long long r, w;
+        tracer.get_bytes(r, w);
+        tracer.begin_span();
+        tracer.add_bytes(read, 0);
+        tracer.end_span(name, "req", start, cpu, r, w);
+    }
+
+public:
+    tracerT()
+    {
+    }
+    ~tracerT()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+CPPUNIT_TEST_SUITE( tracerT );
+
+    CPPUNIT_TEST( nested_spans_test );
+    CPPUNIT_TEST( wall_time_test );
+    CPPUNIT_TEST( ring_test );
+    CPPUNIT_TEST( chrome_trace_test );
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void nested_spans_test()
+    {
+        BESTracer tracer(16);
+
+        unsigned long long start = BESTracer::wall_time();
+        unsigned long long cpu = BESTracer::cpu_time();
+        unsigned long long r, w;
+        tracer.get_bytes(r, w);
+        CPPUNIT_ASSERT(tracer.begin_span() == 0);
+
+        span(tracer, "inner", 100);
+        tracer.add_bytes(0, 50);
+
+        tracer.end_span("outer", "req", start, cpu, r, w);
+
+        vector<BESTracer::Span> spans = tracer.get_spans();
+        CPPUNIT_ASSERT(spans.size() == 2);
+
+        // Spans are recorded when they end, so the inner span is first
+        CPPUNIT_ASSERT(spans[0].name == "inner");
+        CPPUNIT_ASSERT(spans[0].depth == 1);
+        CPPUNIT_ASSERT(spans[0].bytes_read == 100);
+        CPPUNIT_ASSERT(spans[0].bytes_written == 0);
+
+        CPPUNIT_ASSERT(spans[1].name == "outer");
+        CPPUNIT_ASSERT(spans[1].depth == 0);
+        CPPUNIT_ASSERT(spans[1].bytes_read == 100);
+        CPPUNIT_ASSERT(spans[1].bytes_written == 50);
+        CPPUNIT_ASSERT(spans[1].start <= spans[0].start);
+        CPPUNIT_ASSERT(spans[1].wall >= spans[0].wall);
+    }
+
+    // A span that waits records wall time but (almost) no CPU time
+    void wall_time_test()
+    {
+        BESTracer tracer(4);
+
+        unsigned long long start = BESTracer::wall_time();
+        unsigned long long cpu = BESTracer::cpu_time();
+        tracer.begin_span();
+        usleep(50000);
+        tracer.end_span("sleep", "req", start, cpu, 0, 0);
+
+        vector<BESTracer::Span> spans = tracer.get_spans();
+        CPPUNIT_ASSERT(spans.size() == 1);
+        DBG(cerr << "wall: " << spans[0].wall << ", cpu: " << spans[0].cpu << endl);
+        CPPUNIT_ASSERT(spans[0].wall >= 50000);
+        CPPUNIT_ASSERT(spans[0].cpu < spans[0].wall);
+    }
+
+    // Only the most recent spans are kept
+    void ring_test()
+    {
+        BESTracer tracer(3);
+
+        for (int i = 0; i < 5; ++i) {
+            ostringstream name;
+            name << "span_" << i;
+            span(tracer, name.str());
+        }
+
+        vector<BESTracer::Span> spans = tracer.get_spans();
+        CPPUNIT_ASSERT(spans.size() == 3);
+        CPPUNIT_ASSERT(spans[0].name == "span_2");
+        CPPUNIT_ASSERT(spans[2].name == "span_4");
+
+        tracer.clear();
+        CPPUNIT_ASSERT(tracer.get_spans().empty());
+    }
+
+    void chrome_trace_test()
+    {
+        BESTracer tracer(4);
+        span(tracer, "read \"x\"", 10);
+
+        ostringstream oss;
+        tracer.write_chrome_trace(oss);
+        string trace = oss.str();
+        DBG(cerr << trace << endl);
+
+        CPPUNIT_ASSERT(trace.find("\"traceEvents\":[") != string::npos);
+        CPPUNIT_ASSERT(trace.find("\"name\":\"read \\\"x\\\"\"") != string::npos);
+        CPPUNIT_ASSERT(trace.find("\"ph\":\"X\"") != string::npos);
+        CPPUNIT_ASSERT(trace.find("\"bytes_read\":10") != string::npos);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( tracerT );
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    char option_char;
+    while ((option_char = getopt()) != EOF)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: tracerT has the following tests:" << endl;
+            const std::vector<Test*> &tests = tracerT::suite()->getTests();
+            unsigned int prefix_len = tracerT::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = tracerT::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
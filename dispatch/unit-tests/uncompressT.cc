@@ -36,11 +36,20 @@
 
 using namespace CppUnit;
 
+#include <zlib.h>
+
 #include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <memory>
+#include <iterator>
+#include <vector>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <GetOpt.h>
 
 using std::cerr;
@@ -48,7 +57,15 @@ using std::endl;
 using std::ifstream;
 
 #include "config.h"
+
+#ifdef HAVE_BZLIB_H
+#include <bzlib.h>
+#endif
+
 #include "BESUncompressManager3.h"
+#include "BESUncompress3GZ.h"
+#include "BESUncompressParallel.h"
+#include "BESUncompressIndex.h"
 #include "BESUncompressCache.h"
 #include "BESError.h"
 #include "TheBESKeys.h"
@@ -213,6 +230,237 @@ public:
 
     }
 
+    // About 3MB of text that compresses well but not too well
+    string make_data()
+    {
+        string data;
+        srand(7);
+        for (int i = 0; i < 3000000; ++i)
+            data += (char) ('a' + ((rand() % 7 == 0) ? rand() % 26 : i % 13));
+        return data;
+    }
+
+    // Write 'data' as a gzip file of one or more members
+    void make_gz(const string &file, const string &data, int members)
+    {
+        string::size_type size = data.size() / members;
+        for (int i = 0; i < members; ++i) {
+            gzFile out = gzopen(file.c_str(), (i == 0) ? "wb" : "ab");
+            CPPUNIT_ASSERT( out );
+            string::size_type start = i * size;
+            gzwrite(out, data.data() + start, (i == members - 1) ? data.size() - start : size);
+            gzclose(out);
+        }
+    }
+
+#ifdef HAVE_BZLIB_H
+    // Write 'data' as a bzip2 file of one or more streams with 100k blocks
+    void make_bz2(const string &file, const string &data, int streams)
+    {
+        FILE *f = fopen(file.c_str(), "wb");
+        CPPUNIT_ASSERT( f );
+        string::size_type size = data.size() / streams;
+        for (int i = 0; i < streams; ++i) {
+            int bzerror;
+            BZFILE *out = BZ2_bzWriteOpen(&bzerror, f, 1, 0, 0);
+            CPPUNIT_ASSERT( bzerror == BZ_OK );
+            string::size_type start = i * size;
+            BZ2_bzWrite(&bzerror, out, (void *) (data.data() + start), (i == streams - 1) ? data.size() - start : size);
+            BZ2_bzWriteClose(&bzerror, out, 0, 0, 0);
+        }
+        fclose(f);
+    }
+#endif
+
+    // Uncompress into the cache and compare with 'data'
+    void parallel_worker(const string &src_file, const string &data)
+    {
+        string cache_dir = (string) TEST_SRC_DIR + "/cache";
+        BESUncompressCache *cache = BESUncompressCache::get_instance(cache_dir, cache_dir, "zcache", 100);
+
+        string result;
+        CPPUNIT_ASSERT( BESUncompressManager3::TheManager()->uncompress(src_file, result, cache) );
+
+        ifstream strm(result.c_str(), std::ios::binary);
+        CPPUNIT_ASSERT( strm );
+        string contents((std::istreambuf_iterator<char>(strm)), std::istreambuf_iterator<char>());
+        DBG(cerr << __func__ << "() - " << result << ": " << contents.size() << " bytes" << endl);
+        CPPUNIT_ASSERT( contents == data );
+
+        cache->unlock_and_close(result);
+    }
+
+    void gz_parallel_test()
+    {
+        DBG(cerr << __func__ << "() - BEGIN" << endl);
+        string cache_dir = (string) TEST_SRC_DIR + "/cache";
+        clean_dir(cache_dir, "zcache");
+
+        string data = make_data();
+        string src_file = cache_dir + "/zcache_parallel.txt.gz";
+        make_gz(src_file, data, 7);
+
+        parallel_worker(src_file, data);
+
+        clean_dir(cache_dir, "zcache");
+        DBG(cerr << __func__ << "() - END" << endl);
+    }
+
+    // One member whose compressed data holds bytes that look like a header
+    void gz_false_member_test()
+    {
+        DBG(cerr << __func__ << "() - BEGIN" << endl);
+        string cache_dir = (string) TEST_SRC_DIR + "/cache";
+        clean_dir(cache_dir, "zcache");
+
+        // Level 0 (stored blocks) copies the data as is. The 0xff after the
+        // header is not a valid deflate block.
+        string header("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\x03\xff\xff", 12);
+        string data = make_data().substr(0, 100000) + header + make_data().substr(0, 100000);
+        string src_file = cache_dir + "/zcache_false.txt.gz";
+        gzFile out = gzopen(src_file.c_str(), "wb0");
+        CPPUNIT_ASSERT( out );
+        gzwrite(out, data.data(), data.size());
+        gzclose(out);
+
+        int fd = open(src_file.c_str(), O_RDONLY);
+        CPPUNIT_ASSERT( fd != -1 );
+        std::vector<unsigned long long> starts;
+        BESUncompress3GZ::find_members(fd, starts);
+        close(fd);
+        DBG(cerr << __func__ << "() - members: " << starts.size() << endl);
+        CPPUNIT_ASSERT( starts.size() == 1 && starts[0] == 0 );
+
+        parallel_worker(src_file, data);
+
+        clean_dir(cache_dir, "zcache");
+        DBG(cerr << __func__ << "() - END" << endl);
+    }
+
+    // Members too big to hold in memory, with and without temporary files
+    void gz_big_member_test()
+    {
+        DBG(cerr << __func__ << "() - BEGIN" << endl);
+        string cache_dir = (string) TEST_SRC_DIR + "/cache";
+        clean_dir(cache_dir, "zcache");
+
+        // Two members of 18MB each
+        string part = make_data();
+        string data;
+        for (int i = 0; i < 12; ++i)
+            data += part;
+        // Not named like a cache file; the cache is purged while this runs
+        string src_file = cache_dir + "/big.txt.gz";
+        make_gz(src_file, data, 2);
+
+        int fd = open(src_file.c_str(), O_RDONLY);
+        CPPUNIT_ASSERT( fd != -1 );
+        std::vector<unsigned long long> starts;
+        BESUncompress3GZ::find_members(fd, starts);
+        close(fd);
+        CPPUNIT_ASSERT( starts.size() == 2 );
+
+        BESUncompressParallel::set_temp_dir(cache_dir);
+        parallel_worker(src_file, data);
+
+        // A new name, so it is not found in the cache
+        string src_file2 = cache_dir + "/big2.txt.gz";
+        CPPUNIT_ASSERT( rename(src_file.c_str(), src_file2.c_str()) == 0 );
+        BESUncompressParallel::set_temp_dir("");
+        parallel_worker(src_file2, data);
+
+        unlink(src_file2.c_str());
+        clean_dir(cache_dir, "zcache");
+        DBG(cerr << __func__ << "() - END" << endl);
+    }
+
+    void bz2_parallel_test()
+    {
+#ifdef HAVE_BZLIB_H
+        DBG(cerr << __func__ << "() - BEGIN" << endl);
+        string cache_dir = (string) TEST_SRC_DIR + "/cache";
+        clean_dir(cache_dir, "zcache");
+
+        // Two streams, so there's a gap between two of the blocks
+        string data = make_data();
+        string src_file = cache_dir + "/zcache_parallel.txt.bz2";
+        make_bz2(src_file, data, 2);
+
+        parallel_worker(src_file, data);
+
+        clean_dir(cache_dir, "zcache");
+        DBG(cerr << __func__ << "() - END" << endl);
+#endif
+    }
+
+    // Read the uncompressed data in pieces of random sizes at random places,
+    // some of them past the end
+    void index_worker(const string &src_file, const string &data)
+    {
+        string cache_dir = (string) TEST_SRC_DIR + "/cache";
+        BESUncompressCache *cache = BESUncompressCache::get_instance(cache_dir, cache_dir, "zcache", 100);
+        CPPUNIT_ASSERT( BESUncompressManager3::TheManager()->is_seekable() );
+
+        // The first time the index is built, the second time it is read
+        for (int pass = 0; pass < 2; ++pass) {
+            std::auto_ptr<BESUncompressIndex> index(BESUncompressManager3::TheManager()->get_index(src_file, cache));
+            CPPUNIT_ASSERT( index.get() );
+            DBG(index->dump(cerr));
+
+            CPPUNIT_ASSERT( index->size() == data.size() );
+            CPPUNIT_ASSERT( index->get_num_points() > 1 );
+
+            for (int t = 0; t < 50; ++t) {
+                unsigned long long offset = rand() % (data.size() + 1000);
+                size_t len = rand() % 300000;
+                string buf(len, '\0');
+                size_t n = index->read(offset, &buf[0], len);
+
+                size_t expected = (offset >= data.size()) ? 0 : std::min((unsigned long long) len, data.size() - offset);
+                CPPUNIT_ASSERT( n == expected );
+                CPPUNIT_ASSERT( n == 0 || memcmp(buf.data(), data.data() + offset, n) == 0 );
+            }
+        }
+
+        // Nothing was uncompressed into the cache
+        CPPUNIT_ASSERT( access(cache->get_cache_file_name(src_file).c_str(), F_OK) != 0 );
+    }
+
+    void gz_index_test()
+    {
+        DBG(cerr << __func__ << "() - BEGIN" << endl);
+        string cache_dir = (string) TEST_SRC_DIR + "/cache";
+        clean_dir(cache_dir, "zcache");
+
+        // Two members, so reads cross from one to the next
+        string data = make_data();
+        string src_file = cache_dir + "/zcache_index.txt.gz";
+        make_gz(src_file, data, 2);
+
+        index_worker(src_file, data);
+
+        clean_dir(cache_dir, "zcache");
+        DBG(cerr << __func__ << "() - END" << endl);
+    }
+
+    void bz2_index_test()
+    {
+#ifdef HAVE_BZLIB_H
+        DBG(cerr << __func__ << "() - BEGIN" << endl);
+        string cache_dir = (string) TEST_SRC_DIR + "/cache";
+        clean_dir(cache_dir, "zcache");
+
+        string data = make_data();
+        string src_file = cache_dir + "/zcache_index.txt.bz2";
+        make_bz2(src_file, data, 1);
+
+        index_worker(src_file, data);
+
+        clean_dir(cache_dir, "zcache");
+        DBG(cerr << __func__ << "() - END" << endl);
+#endif
+    }
+
     void test_disabled_uncompress_cache()
     {
         DBG(cerr << __func__ << "() - BEGIN" << endl);
@@ -266,6 +514,12 @@ public:
     CPPUNIT_TEST( gz_test );
     CPPUNIT_TEST( libz2_test );
     CPPUNIT_TEST( Z_test );
+    CPPUNIT_TEST( gz_index_test );
+    CPPUNIT_TEST( bz2_index_test );
+    CPPUNIT_TEST( gz_parallel_test );
+    CPPUNIT_TEST( gz_false_member_test );
+    CPPUNIT_TEST( gz_big_member_test );
+    CPPUNIT_TEST( bz2_parallel_test );
 
     CPPUNIT_TEST_SUITE_END();
 
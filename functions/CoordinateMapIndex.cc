@@ -0,0 +1,414 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <sstream>
+
+#include <Array.h>
+#include <util.h>
+#include <Error.h>
+#include <debug.h>
+
+#include "CoordinateMapIndex.h"
+
+// The most maps whose indexes are held at one time. When the cache is full
+// it is emptied; the maps used by a request are added back as it runs.
+#define COORDINATE_MAP_CACHE_ENTRIES 64
+
+using namespace std;
+using namespace libdap;
+
+namespace functions {
+
+std::map<string, CoordinateMapIndex::entry> CoordinateMapIndex::d_cache;
+
+// For the comparisons here, we should use an epsilon to catch issues
+// with floating point values. jhrg 01/12/06
+static bool
+compare(double elem, relop op, double value)
+{
+    switch (op) {
+    case dods_greater_op:
+        return elem > value;
+    case dods_greater_equal_op:
+        return elem >= value;
+    case dods_less_op:
+        return elem < value;
+    case dods_less_equal_op:
+        return elem <= value;
+    case dods_equal_op:
+        return elem == value;
+    case dods_not_equal_op:
+        return elem != value;
+    case dods_nop_op:
+        throw Error(malformed_expr, "Attempt to use NOP in Grid selection.");
+    default:
+        throw Error(malformed_expr, "Unknown relational operator in Grid selection.");
+    }
+}
+
+/**
+ * @brief simple double equality test
+ * @see http://stackoverflow.com/questions/17333/most-effective-way-for-float-and-double-comparison
+ * @param a
+ * @param b
+ * @return True if they are within epsilon
+ */
+static bool same_as(const double a, const double b)
+{
+    // use float's epsilon since double's is too small for these tests
+    return fabs(a - b) <= numeric_limits<float>::epsilon();
+}
+
+static void
+read_values(Array *map, vector<double> &values)
+{
+    if (!map->read_p())
+        map->read();
+
+    values.resize(map->length());
+    if (!values.empty())
+        extract_double_array(map, values);   // throws Error
+}
+
+CoordinateMapIndex::CoordinateMapIndex()
+        : d_direction(none), d_uniform(false), d_resolution(0), d_min(0), d_max(0)
+{
+}
+
+/**
+ * @brief Build an index for the given values
+ * @param values The map's values, in the map's order
+ */
+CoordinateMapIndex::CoordinateMapIndex(const vector<double> &values)
+        : d_values(values), d_direction(none), d_uniform(false), d_resolution(0), d_min(0), d_max(0)
+{
+    build();
+}
+
+// Find the direction, spacing and extent of the values.
+void
+CoordinateMapIndex::build()
+{
+    d_direction = none;
+    d_uniform = false;
+    d_resolution = 0;
+    d_min = d_max = numeric_limits<double>::quiet_NaN();
+
+    vector<double>::size_type n = d_values.size();
+    if (n == 0)
+        return;
+
+    // A map with a NaN in it is not monotonic, whatever its other values are
+    bool up = true, down = true;
+    for (vector<double>::size_type i = 0; i < n; ++i) {
+        if (std::isnan(d_values[i])) {
+            up = down = false;
+            continue;
+        }
+
+        if (std::isnan(d_min) || d_values[i] < d_min)
+            d_min = d_values[i];
+        if (std::isnan(d_max) || d_values[i] > d_max)
+            d_max = d_values[i];
+
+        if (i + 1 < n) {
+            if (d_values[i + 1] < d_values[i])
+                up = false;
+            else if (d_values[i + 1] > d_values[i])
+                down = false;
+        }
+    }
+
+    if (up)
+        d_direction = increasing;
+    else if (down)
+        d_direction = decreasing;
+
+    if (n > 1)
+        d_resolution = (d_values[n - 1] - d_values[0]) / (n - 1);
+
+    d_uniform = d_direction != none && is_uniform(d_values, d_resolution);
+
+    DBG(cerr << "CoordinateMapIndex: " << n << " values, direction: " << d_direction << ", uniform: " << d_uniform
+        << ", resolution: " << d_resolution << endl);
+}
+
+/**
+ * @brief Are the values uniformly spaced?
+ * @param values The values
+ * @param res The uniform offset between elements
+ * @return True if the difference between each pair of neighboring values
+ * is res, within float's epsilon.
+ */
+bool
+CoordinateMapIndex::is_uniform(const vector<double> &values, double res)
+{
+    if (values.size() < 2)
+        return true;
+
+    vector<double>::size_type end_index = values.size() - 1;
+    for (vector<double>::size_type i = 0; i < end_index; ++i) {
+        if (!same_as((values[i + 1] - values[i]), res))
+            return false;
+    }
+
+    return true;
+}
+
+// For a monotonic map, the index of the first value that is not 'before'
+// the given value. Going the map's direction, a value is before another if
+// it is less than it (for an increasing map) or greater than it (for a
+// decreasing one); if 'weak' is true, equal values are before one another,
+// too. These are std::lower_bound (weak is false) and std::upper_bound.
+//
+// For a uniform map the index is computed from the first value and the
+// resolution and then nudged into place, otherwise it is found using a
+// binary search.
+int
+CoordinateMapIndex::partition(double value, bool weak) const
+{
+    int n = d_values.size();
+
+    if (d_uniform && d_resolution != 0) {
+        double guess = ceil((value - d_values[0]) / d_resolution);
+        int k = (guess < 0) ? 0 : (guess > n) ? n : static_cast<int>(guess);
+
+        while (k > 0 && !before(d_values[k - 1], value, weak))
+            --k;
+        while (k < n && before(d_values[k], value, weak))
+            ++k;
+
+        return k;
+    }
+
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (before(d_values[mid], value, weak))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+bool
+CoordinateMapIndex::before(double elem, double value, bool weak) const
+{
+    if (d_direction == increasing)
+        return weak ? elem <= value : elem < value;
+    else
+        return weak ? elem >= value : elem > value;
+}
+
+// If the values that satisfy 'elem op value' form one run of the map, set
+// lo and hi to its first and last index (lo > hi when there are none) and
+// return true. That is the case for all the operators but '!=' when the map
+// is monotonic. Otherwise return false.
+bool
+CoordinateMapIndex::find_range(relop op, double value, int &lo, int &hi) const
+{
+    if (d_direction == none || op == dods_not_equal_op || std::isnan(value))
+        return false;
+
+    int n = d_values.size();
+    // The first value not before 'value' and the first value after it
+    int lower = partition(value, false);
+    int upper = partition(value, true);
+
+    bool up = d_direction == increasing;
+    switch (op) {
+    case dods_greater_op:
+        lo = up ? upper : 0;
+        hi = up ? n - 1 : lower - 1;
+        break;
+    case dods_greater_equal_op:
+        lo = up ? lower : 0;
+        hi = up ? n - 1 : upper - 1;
+        break;
+    case dods_less_op:
+        lo = up ? 0 : upper;
+        hi = up ? lower - 1 : n - 1;
+        break;
+    case dods_less_equal_op:
+        lo = up ? 0 : lower;
+        hi = up ? upper - 1 : n - 1;
+        break;
+    case dods_equal_op:
+        lo = lower;
+        hi = upper - 1;
+        break;
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief The first index where 'value[i] op value' is true
+ *
+ * Search the indices from 'from' to 'to', inclusive.
+ *
+ * @param op The relational operator
+ * @param value The value that map values are compared to
+ * @param from The first index to search
+ * @param to The last index to search
+ * @return The index or, if no value matches, one past 'to' (or 'from' if
+ * 'from' is greater than 'to'). This is where a scan forward from 'from'
+ * would stop.
+ */
+int
+CoordinateMapIndex::first(relop op, double value, int from, int to) const
+{
+    if (op == dods_nop_op)
+        throw Error(malformed_expr, "Attempt to use NOP in Grid selection.");
+
+    int lo, hi;
+    if (find_range(op, value, lo, hi)) {
+        int i = max(lo, from);
+        return (i <= min(hi, to)) ? i : max(from, to + 1);
+    }
+
+    int i = from;
+    while (i <= to && !compare(d_values[i], op, value))
+        ++i;
+
+    return i;
+}
+
+/**
+ * @brief The last index where 'value[i] op value' is true
+ *
+ * Search the indices from 'to' down to 'from', inclusive.
+ *
+ * @param op The relational operator
+ * @param value The value that map values are compared to
+ * @param from The first index to search
+ * @param to The last index to search
+ * @return The index or, if no value matches, one before 'from' (or 'to' if
+ * 'from' is greater than 'to'). This is where a scan back from 'to' would
+ * stop.
+ */
+int
+CoordinateMapIndex::last(relop op, double value, int from, int to) const
+{
+    if (op == dods_nop_op)
+        throw Error(malformed_expr, "Attempt to use NOP in Grid selection.");
+
+    int lo, hi;
+    if (find_range(op, value, lo, hi)) {
+        int i = min(hi, to);
+        return (i >= max(lo, from)) ? i : min(to, from - 1);
+    }
+
+    int i = to;
+    while (i >= from && !compare(d_values[i], op, value))
+        --i;
+
+    return i;
+}
+
+/**
+ * @brief Get the index for a map
+ *
+ * If the map has not been read, is not constrained and its dataset is a
+ * file, the index is looked up in (or added to) the cache; the map is read
+ * only when the index is built. Otherwise, the map is read (if needed) and
+ * an index is built from the values it holds. A map that has already been
+ * read may hold values that did not come from its dataset (e.g., the maps
+ * of a Grid made by geogrid()), so its index is never cached.
+ *
+ * @param map A one-dimensional numeric Array
+ * @return The index for the map
+ */
+CoordinateMapIndex
+CoordinateMapIndex::get(Array *map)
+{
+    bool whole = map->dimensions() == 1 && map->length() == map->dimension_size(map->dim_begin(), false);
+
+    struct stat sb;
+    if (map->read_p() || !whole || map->dataset().empty() || stat(map->dataset().c_str(), &sb) != 0) {
+        CoordinateMapIndex index;
+        read_values(map, index.d_values);
+        index.build();
+        return index;
+    }
+
+    ostringstream oss;
+    oss << map->dataset() << '#' << map->FQN() << '#' << map->length();
+    string key = oss.str();
+
+    std::map<string, entry>::iterator i = d_cache.find(key);
+    if (i != d_cache.end()) {
+        if (i->second.mtime == sb.st_mtime && i->second.size == sb.st_size) {
+            DBG(cerr << "CoordinateMapIndex: found " << key << endl);
+            return *(i->second.index);
+        }
+
+        delete i->second.index;
+        d_cache.erase(i);
+    }
+
+    if (d_cache.size() >= COORDINATE_MAP_CACHE_ENTRIES)
+        clear_cache();
+
+    entry e;
+    e.mtime = sb.st_mtime;
+    e.size = sb.st_size;
+    e.index = new CoordinateMapIndex;
+    try {
+        read_values(map, e.index->d_values);
+    }
+    catch (...) {
+        delete e.index;
+        throw;
+    }
+    e.index->build();
+
+    d_cache[key] = e;
+
+    return *(e.index);
+}
+
+/** @brief Remove all of the cached indexes */
+void
+CoordinateMapIndex::clear_cache()
+{
+    for (std::map<string, entry>::iterator i = d_cache.begin(), e = d_cache.end(); i != e; ++i)
+        delete i->second.index;
+
+    d_cache.clear();
+}
+
+} // namespace functions
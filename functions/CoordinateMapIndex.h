@@ -0,0 +1,119 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _coordinate_map_index_h
+#define _coordinate_map_index_h 1
+
+#include <sys/types.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "GSEClause.h"
+
+namespace libdap {
+class Array;
+}
+
+namespace functions {
+
+/**
+ * @brief The values of a coordinate map and what is known about them
+ *
+ * grid() and geogrid() find the indices of a map that satisfy a
+ * relational clause. They used to copy the map's values and scan them on
+ * every call. This class holds the values (as doubles) along with the
+ * map's direction (increasing or decreasing), whether the values are
+ * uniformly spaced and their extent. For a monotonic map an index is found
+ * with a binary search and for a uniform one it is computed directly; a
+ * linear scan is only used for maps that are neither (and for '!=').
+ *
+ * The indexes for maps read from a file are cached, keyed by the dataset,
+ * the map's name and its size; an entry is used only if the file's
+ * modification time and size have not changed. When an entry is found the
+ * map is not read again. Maps that already hold values are indexed from
+ * those values and are not cached.
+ */
+class CoordinateMapIndex {
+public:
+    enum Direction {
+        none,
+        increasing,
+        decreasing
+    };
+
+private:
+    struct entry {
+        time_t mtime;
+        off_t size;
+        CoordinateMapIndex *index;
+    };
+
+    static std::map<std::string, entry> d_cache;
+
+    std::vector<double> d_values;
+    Direction d_direction;
+    bool d_uniform;
+    double d_resolution;
+    double d_min;
+    double d_max;
+
+    void build();
+
+    bool before(double elem, double value, bool weak) const;
+    int partition(double value, bool weak) const;
+    bool find_range(relop op, double value, int &lo, int &hi) const;
+
+public:
+    CoordinateMapIndex();
+    explicit CoordinateMapIndex(const std::vector<double> &values);
+    virtual ~CoordinateMapIndex() { }
+
+    static CoordinateMapIndex get(libdap::Array *map);
+    static void clear_cache();
+
+    static bool is_uniform(const std::vector<double> &values, double res);
+
+    /// The map's values
+    const std::vector<double> &get_values() const { return d_values; }
+    int size() const { return d_values.size(); }
+
+    Direction get_direction() const { return d_direction; }
+    bool is_monotonic() const { return d_direction != none; }
+    bool is_uniform() const { return d_uniform; }
+
+    /// The spacing of the values; (last - first) / (size - 1)
+    double get_resolution() const { return d_resolution; }
+    double get_min() const { return d_min; }
+    double get_max() const { return d_max; }
+
+    int first(relop op, double value, int from, int to) const;
+    int last(relop op, double value, int from, int to) const;
+};
+
+} // namespace functions
+
+#endif // _coordinate_map_index_h
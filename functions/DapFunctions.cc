@@ -25,6 +25,7 @@
 #include "config.h"
 
 #include <iostream>
+#include <sstream>
 
 #include <gdal.h>   // needed for scale_{grid,array}
 
@@ -33,6 +34,7 @@
 #include <BESRequestHandlerList.h>
 
 #include <BESDebug.h>
+#include <TheBESKeys.h>
 
 #include "GeoGridFunction.h"
 #include "GridFunction.h"
@@ -91,6 +93,16 @@ void DapFunctions::initialize(const string &modname)
     libdap::ServerFunctionsList::TheList()->add_function(new ScaleGrid());
     libdap::ServerFunctionsList::TheList()->add_function(new Scale3DArray());
 
+    // The number of threads scale_3D_array() uses to scale the bands of an array
+    bool found = false;
+    std::string value;
+    TheBESKeys::TheKeys()->get_value("BES.functions.Scale3D.MaxThreads", value, found);
+    if (found && !value.empty()) {
+        std::istringstream iss(value);
+        unsigned int threads;
+        if (iss >> threads) set_scale_3D_max_threads(threads);
+    }
+
     GDALAllRegister();
     OGRRegisterAll();
 
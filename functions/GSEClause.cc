@@ -45,6 +45,7 @@
 #include <debug.h>
 
 #include "GSEClause.h"
+#include "CoordinateMapIndex.h"
 #include "parser.h"
 #include "gse.tab.hh"
 
@@ -53,32 +54,6 @@ using namespace libdap;
 
 namespace functions {
 
-// For the comparisons here, we should use an epsilon to catch issues
-// with floating point values. jhrg 01/12/06
-template<class T>
-static bool
-compare(T elem, relop op, double value)
-{
-    switch (op) {
-    case dods_greater_op:
-        return elem > value;
-    case dods_greater_equal_op:
-        return elem >= value;
-    case dods_less_op:
-        return elem < value;
-    case dods_less_equal_op:
-        return elem <= value;
-    case dods_equal_op:
-        return elem == value;
-    case dods_not_equal_op:
-        return elem != value;
-    case dods_nop_op:
-        throw Error(malformed_expr, "Attempt to use NOP in Grid selection.");
-    default:
-        throw Error(malformed_expr, "Unknown relational operator in Grid selection.");
-    }
-}
-
 // These values are used in error messages, hence the strings.
 template<class T>
 void
@@ -94,57 +69,40 @@ GSEClause::set_map_min_max_value(T min, T max)
     d_map_max_value = oss2.str();
 }
 
-// Read the map array, scan, set start and stop.
+// Use the map's index to set start and stop. For monotonic maps the indices
+// are found without scanning the map.
 template<class T>
 void
 GSEClause::set_start_stop()
 {
-    T *vals = new T[d_map->length()];
-    d_map->value(vals);
+    const CoordinateMapIndex &index = CoordinateMapIndex::get(d_map);
+    const vector<double> &vals = index.get_values();
 
     // Set the map's max and min values for use in error messages (it's a lot
     // easier to do here, now, than later... 9/20/2001 jhrg)
-    set_map_min_max_value<T>(vals[d_start], vals[d_stop]);
+    set_map_min_max_value<T>(static_cast<T>(vals[d_start]), static_cast<T>(vals[d_stop]));
 
     // Starting at the current start point in the map (initially index position
-    // zero), scan forward until the comparison is true. Set the new value
-    // of d_start to that location. Note that each clause applies to exactly
-    // one map. The 'i <= end' test keeps us from setting start _past_ the
-    // end ;-)
-    int i = d_start;
+    // zero), find the first index where the comparison is true. Set the new
+    // value of d_start to that location. Note that each clause applies to
+    // exactly one map. Limiting the search to 'end' keeps us from setting
+    // start _past_ the end ;-)
     int end = d_stop;
-    while (i <= end && !compare<T>(vals[i], d_op1, d_value1))
-        i++;
-
-    d_start = i;
+    d_start = index.first(d_op1, d_value1, d_start, end);
 
-    // Now scan backward from the end. We scan all the way to the actual start
-    // although it would probably work to stop at 'i >= d_start'.
-    i = end;
-    while (i >= 0 && !compare<T>(vals[i], d_op1, d_value1))
-        i--;
-    d_stop = i;
+    // Now search backward from the end. We search all the way to the actual
+    // start although it would probably work to stop at d_start.
+    d_stop = index.last(d_op1, d_value1, 0, end);
 
     // Every clause must have one operator but the second is optional since
     // the more complex form of a clause is optional. That is, the above two
-    // loops took care of constraints like 'x < 7' but we need the following
+    // searches took care of constraints like 'x < 7' but we need the following
     // for ones like '3 < x < 7'.
     if (d_op2 != dods_nop_op) {
-        int i = d_start;
         int end = d_stop;
-        while (i <= end && !compare<T>(vals[i], d_op2, d_value2))
-            i++;
-
-        d_start = i;
-
-        i = end;
-        while (i >= 0 && !compare<T>(vals[i], d_op2, d_value2))
-            i--;
-
-        d_stop = i;
+        d_start = index.first(d_op2, d_value2, d_start, end);
+        d_stop = index.last(d_op2, d_value2, 0, end);
     }
-    
-    delete[] vals;
 }
 
 void
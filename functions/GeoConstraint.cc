@@ -46,6 +46,11 @@
 
 #include "GeoConstraint.h"
 
+// When a longitude constraint wraps around the edge of the data, its two
+// halves are read with one hyperslab if no more than this many bytes of
+// each row lie between them.
+#define MAX_LONGITUDE_GAP_BYTES 1024
+
 using namespace std;
 using namespace libdap;
 
@@ -150,6 +155,9 @@ void GeoConstraint::transform_longitude_to_pos_notation()
     for (int i = 0; i < d_lon_length; ++i)
 	if (d_lon[i] < 0)
 	    d_lon[i] += 360;
+
+    // The index no longer matches d_lon
+    d_lon_index = CoordinateMapIndex();
 }
 
 /** Given that the Grid has a longitude map that uses the 'pos' notation,
@@ -166,6 +174,8 @@ void GeoConstraint::transform_longitude_to_neg_pos_notation()
     for (int i = 0; i < d_lon_length; ++i)
 	if (d_lon[i] > 180)
 	    d_lon[i] -= 360;
+
+    d_lon_index = CoordinateMapIndex();
 }
 
 bool GeoConstraint::is_bounding_box_valid(const double left, const double top,
@@ -209,12 +219,42 @@ void GeoConstraint::find_longitude_indeces(double left, double right,
     double t_left = fmod(left, 360.0);
     double t_right = fmod(right, 360.0);
 
+    int i = 0;
+    int lon_origin_index = 0;
+
+    // If the longitude values increase and are all in [0, 360), longitude
+    // starts at index zero and the values are their own 'modulo 360' so the
+    // edges can be found using the map's index.
+    if (d_lon_index.size() == d_lon_length && d_lon_index.get_direction() == CoordinateMapIndex::increasing
+        && d_lon_index.get_min() >= 0.0 && d_lon_index.get_max() < 360.0 && !std::isnan(t_left)
+        && !std::isnan(t_right)) {
+        i = d_lon_index.first(dods_greater_equal_op, t_left, 0, d_lon_length - 1);
+        if (i == d_lon_length)
+            throw Error("geogrid: Could not find an index for the longitude value '" + double_to_string(left) + "'");
+
+        if (d_lon[i] == t_left)
+            longitude_index_left = i;
+        else
+            longitude_index_left = (i - 1) > 0 ? i - 1 : 0;
+
+        i = d_lon_index.last(dods_less_equal_op, t_right, 0, d_lon_length - 1);
+        if (i < 0)
+            throw Error("geogrid: Could not find an index for the longitude value '" + double_to_string(right) + "'");
+
+        if (d_lon[i] == t_right)
+            longitude_index_right = i;
+        else
+            longitude_index_right = (i + 1) < d_lon_length - 1 ? i + 1 : d_lon_length - 1;
+
+        DBG2(cerr << "longitude_index_left: " << longitude_index_left << ", longitude_index_right: "
+            << longitude_index_right << " (indexed)" << endl);
+        return;
+    }
+
     // Find the place where 'longitude starts.' That is, what value of the
     // index 'i' corresponds to the smallest value of d_lon. Why we do this:
     // Some data sources use offset longitude axes so that the 'seam' is
     // shifted to a place other than the date line.
-    int i = 0;
-    int lon_origin_index = 0;
     double smallest_lon = fmod(d_lon[0], 360.0);
     while (i < d_lon_length) {
 	double curent_lon_value = fmod(d_lon[i], 360.0);
@@ -285,14 +325,25 @@ void GeoConstraint::find_latitude_indeces(double top, double bottom,
 {
     int i, j;
 
-    if (sense == normal) {
-	i = 0;
-        while (i < d_lat_length - 1 && top < d_lat[i])
-            ++i;
+    // When the latitude values are monotonic, use the map's index to find
+    // the edges; these are the indices where the scans below stop.
+    bool indexed = d_lat_index.size() == d_lat_length && d_lat_index.is_monotonic() && !std::isnan(top)
+        && !std::isnan(bottom);
 
-        j = d_lat_length - 1;
-        while (j > 0 && bottom > d_lat[j])
-            --j;
+    if (sense == normal) {
+        if (indexed) {
+            i = d_lat_index.first(dods_less_equal_op, top, 0, d_lat_length - 2);
+            j = d_lat_index.last(dods_greater_equal_op, bottom, 1, d_lat_length - 1);
+        }
+        else {
+            i = 0;
+            while (i < d_lat_length - 1 && top < d_lat[i])
+                ++i;
+
+            j = d_lat_length - 1;
+            while (j > 0 && bottom > d_lat[j])
+                --j;
+        }
 
         if (d_lat[i] == top)
             latitude_index_top = i;
@@ -306,13 +357,19 @@ void GeoConstraint::find_latitude_indeces(double top, double bottom,
                 (j + 1) < d_lat_length - 1 ? j + 1 : d_lat_length - 1;
     }
     else {
-        i = d_lat_length - 1;
-        while (i > 0 && d_lat[i] > top)
-            --i;
-
-        j = 0;
-        while (j < d_lat_length - 1 && d_lat[j] < bottom)
-            ++j;
+        if (indexed) {
+            i = d_lat_index.last(dods_less_equal_op, top, 1, d_lat_length - 1);
+            j = d_lat_index.first(dods_greater_equal_op, bottom, 0, d_lat_length - 2);
+        }
+        else {
+            i = d_lat_length - 1;
+            while (i > 0 && d_lat[i] > top)
+                --i;
+
+            j = 0;
+            while (j < d_lat_length - 1 && d_lat[j] < bottom)
+                ++j;
+        }
 
         if (d_lat[i] == top)
             latitude_index_top = i;
@@ -458,6 +515,13 @@ count_dimensions_except_longitude(Array &a)
     reordered longitude map (see GeoConstraint::reorder_longitude_map())
     and the data values match.
 
+    The two halves of each row are copied from the Array's buffer straight
+    to their places in d_array_data. When only a few columns lie between the
+    halves (no more than the halves themselves and at most
+    MAX_LONGITUDE_GAP_BYTES per row), the whole longitude range is read at
+    once so the handler sees one hyperslab; otherwise the two halves are
+    read separately so the columns between them are not read.
+
     @note This should be called with the Array that contains the d_lon_dim
     Array::Dim_iter.
 
@@ -477,6 +541,51 @@ void GeoConstraint::reorder_data_longitude_axis(Array &a, Array::Dim_iter lon_di
     if (!is_longitude_rightmost())
         throw Error("This grid does not have Longitude as its rightmost dimension, the geogrid()\ndoes not support constraints that wrap around the edges of this type of grid.");
 
+    // Assume COARDS conventions are being followed: lon varies fastest.
+    // These *_row_size variables are actually elements * bytes/element since
+    // memcpy() uses bytes.
+    int elem_size = a.var()->width(true);
+    int left_row_size = (get_lon_length() - get_longitude_index_left()) * elem_size;
+    int right_row_size = (get_longitude_index_right() + 1) * elem_size;
+    int total_bytes_per_row = left_row_size + right_row_size;
+    int gap_row_size = (get_longitude_index_left() - get_longitude_index_right() - 1) * elem_size;
+
+    DBG2(cerr << "elem_size: " << elem_size << "; left & right size: "
+	    << left_row_size << ", " << right_row_size << endl);
+
+    // This will work for any number of dimension so long as longitude is the
+    // right-most array dimension. Make one big lump O'data and copy each
+    // part of the rows straight to its final place in it.
+    int rows_to_copy = count_dimensions_except_longitude(a);
+    d_array_data_size = total_bytes_per_row * rows_to_copy;
+    d_array_data = new char[d_array_data_size];
+
+    if (gap_row_size <= total_bytes_per_row && gap_row_size <= MAX_LONGITUDE_GAP_BYTES) {
+        // Only a few values lie between the right and left halves, so read
+        // them both (and the part between) at once. This is one hyperslab
+        // for the handler instead of two.
+        DBG(cerr << "Constraint for both halves: " << 0
+            << ", " << get_lon_length() - 1 << endl);
+
+        a.add_constraint(lon_dim, 0, 1, get_lon_length() - 1);
+        a.set_read_p(false);
+        a.read();
+        DBG2(a.print_val(stderr));
+
+        int row_size = get_lon_length() * elem_size;
+        char *data = a.get_buf();
+        for (int i = 0; i < rows_to_copy; ++i) {
+            memcpy(d_array_data + (total_bytes_per_row * i),
+                   data + (row_size * i) + right_row_size + gap_row_size,
+                   left_row_size);
+            memcpy(d_array_data + (total_bytes_per_row * i) + left_row_size,
+                   data + (row_size * i),
+                   right_row_size);
+        }
+
+        return;
+    }
+
     DBG(cerr << "Constraint for the left half: " << get_longitude_index_left()
         << ", " << get_lon_length() - 1 << endl);
 
@@ -487,9 +596,16 @@ void GeoConstraint::reorder_data_longitude_axis(Array &a, Array::Dim_iter lon_di
     a.read();
     DBG2(a.print_val(stderr));
 
-    // Save the left-hand data to local storage
-    int left_size = a.width(true);		// width() == length() * element size
-    char *left_data = (char*)a.value();	// value() allocates and copies
+    // Copy the left-hand data from the Array's own buffer; value() would
+    // allocate and copy them first.
+    char *left_data = a.get_buf();
+    for (int i = 0; i < rows_to_copy; ++i) {
+	DBG(cerr << "left memcpy: " << *(float *)(left_data + (left_row_size * i)) << endl);
+
+        memcpy(d_array_data + (total_bytes_per_row * i),
+               left_data + (left_row_size * i),
+               left_row_size);
+    }
 
     // Build a constraint for the 'right' part, which goes from the left edge
     // of the array to the right index and read those data.
@@ -505,44 +621,14 @@ void GeoConstraint::reorder_data_longitude_axis(Array &a, Array::Dim_iter lon_di
     a.read();
     DBG2(a.print_val(stderr));
 
-    char *right_data = (char*)a.value();
-    int right_size = a.width(true);
-
-    // Make one big lump O'data
-    d_array_data_size = left_size + right_size;
-    d_array_data = new char[d_array_data_size];
-
-    // Assume COARDS conventions are being followed: lon varies fastest.
-    // These *_elements variables are actually elements * bytes/element since
-    // memcpy() uses bytes.
-    int elem_size = a.var()->width(true);
-    int left_row_size = (get_lon_length() - get_longitude_index_left()) * elem_size;
-    int right_row_size = (get_longitude_index_right() + 1) * elem_size;
-    int total_bytes_per_row = left_row_size + right_row_size;
-
-    DBG2(cerr << "elem_size: " << elem_size << "; left & right size: "
-	    << left_row_size << ", " << right_row_size << endl);
-
-    // This will work for any number of dimension so long as longitude is the
-    // right-most array dimension.
-    int rows_to_copy = count_dimensions_except_longitude(a);
+    char *right_data = a.get_buf();
     for (int i = 0; i < rows_to_copy; ++i) {
-	DBG(cerr << "Copying " << i << "th row" << endl);
-	DBG(cerr << "left memcpy: " << *(float *)(left_data + (left_row_size * i)) << endl);
-
-        memcpy(d_array_data + (total_bytes_per_row * i),
-               left_data + (left_row_size * i),
-               left_row_size);
-
         DBG(cerr << "right memcpy: " << *(float *)(right_data + (right_row_size * i)) << endl);
 
         memcpy(d_array_data + (total_bytes_per_row * i) + left_row_size,
                right_data + (right_row_size * i),
                right_row_size);
     }
-
-    delete[]left_data;
-    delete[]right_data;
 }
 
 /** @brief Initialize GeoConstraint.
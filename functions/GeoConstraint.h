@@ -30,6 +30,8 @@
 #include <sstream>
 #include <set>
 
+#include "CoordinateMapIndex.h"
+
 namespace libdap {
 class BaseType;
 class Array;
@@ -124,6 +126,10 @@ private:
     int d_lat_length;           //< Elements (not bytes) in the latitude vector
     int d_lon_length;           //< ... longitude vector
 
+    // Indexes of the latitude and longitude values; empty if not known
+    CoordinateMapIndex d_lat_index;
+    CoordinateMapIndex d_lon_index;
+
     // These four are indexes of the constraint
     int d_latitude_index_top;
     int d_latitude_index_bottom;
@@ -238,6 +244,23 @@ public:
         d_lon = lon;
     }
 
+    const CoordinateMapIndex &get_lat_index() const
+    {
+        return d_lat_index;
+    }
+    const CoordinateMapIndex &get_lon_index() const
+    {
+        return d_lon_index;
+    }
+    void set_lat_index(const CoordinateMapIndex &index)
+    {
+        d_lat_index = index;
+    }
+    void set_lon_index(const CoordinateMapIndex &index)
+    {
+        d_lon_index = index;
+    }
+
     int get_lat_length() const
     {
         return d_lat_length;
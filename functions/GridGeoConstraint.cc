@@ -31,6 +31,7 @@
 #include <cmath>
 
 #include <iostream>
+#include <algorithm>
 #include <sstream>
 
 //#define DODS_DEBUG
@@ -50,6 +51,16 @@ using namespace libdap;
 
 namespace functions {
 
+// A copy of the index's values; GeoConstraint owns (and modifies) its lat and
+// lon vectors.
+static double *
+copy_values(const CoordinateMapIndex &index)
+{
+    double *values = new double[index.size()];
+    copy(index.get_values().begin(), index.get_values().end(), values);
+    return values;
+}
+
 /** @brief Initialize GeoConstraint with a Grid.
 
     @param grid Set the GeoConstraint to use this Grid variable. It is the
@@ -138,10 +149,10 @@ bool GridGeoConstraint::build_lat_lon_maps()
             d_latitude = dynamic_cast < Array * >(*m);
             if (!d_latitude)
                 throw InternalErr(__FILE__, __LINE__, "Expected an array.");
-            if (!d_latitude->read_p())
-                d_latitude->read();
 
-            set_lat(extract_double_array(d_latitude));   // throws Error
+            // The map is read only if its index is not already cached.
+            set_lat_index(CoordinateMapIndex::get(d_latitude));   // throws Error
+            set_lat(copy_values(get_lat_index()));
             set_lat_length(d_latitude->length());
 
             set_lat_dim(d);
@@ -154,10 +165,8 @@ bool GridGeoConstraint::build_lat_lon_maps()
             d_longitude = dynamic_cast < Array * >(*m);
             if (!d_longitude)
                 throw InternalErr(__FILE__, __LINE__, "Expected an array.");
-            if (!d_longitude->read_p())
-                d_longitude->read();
-
-            set_lon(extract_double_array(d_longitude));
+            set_lon_index(CoordinateMapIndex::get(d_longitude));   // throws Error
+            set_lon(copy_values(get_lon_index()));
             set_lon_length(d_longitude->length());
 
             set_lon_dim(d);
@@ -192,10 +201,8 @@ bool GridGeoConstraint::build_lat_lon_maps(Array *lat, Array *lon)
 
             d_latitude = lat;
 
-            if (!d_latitude->read_p())
-                d_latitude->read();
-
-            set_lat(extract_double_array(d_latitude));   // throws Error
+            set_lat_index(CoordinateMapIndex::get(d_latitude));   // throws Error
+            set_lat(copy_values(get_lat_index()));
             set_lat_length(d_latitude->length());
 
             set_lat_dim(d);
@@ -205,10 +212,8 @@ bool GridGeoConstraint::build_lat_lon_maps(Array *lat, Array *lon)
 
             d_longitude = lon;
 
-            if (!d_longitude->read_p())
-                d_longitude->read();
-
-            set_lon(extract_double_array(d_longitude));
+            set_lon_index(CoordinateMapIndex::get(d_longitude));   // throws Error
+            set_lon(copy_values(get_lon_index()));
             set_lon_length(d_longitude->length());
 
             set_lon_dim(d);
@@ -43,6 +43,7 @@
 #include "BESDebug.h"
 
 #include "LinearScaleFunction.h"
+#include "numeric_kernels.h"
 
 using namespace libdap;
 
@@ -144,12 +145,86 @@ static double get_missing_value(BaseType *var)
     return get_attribute_double_value(var, "missing_value");
 }
 
+/**
+ * Scale the values of 'source' into 'dest', which must have room for them,
+ * working in the source's type.
+ */
+template<typename T>
+static void scale_values(Array *source, dods_float64 *dest, double m, double b, double missing, bool use_missing)
+{
+    const T *src = reinterpret_cast<const T*>(source->get_buf());
+    T native_missing;
+    if (use_missing && native_missing_value(missing, native_missing))
+        linear_scale_kernel(src, dest, source->length(), m, b, native_missing);
+    else
+        linear_scale_kernel(src, dest, source->length(), m, b);
+}
+
+/**
+ * Load 'result', a copy of 'source', with source's values scaled. The
+ * result holds Float64 values and they are written directly into its
+ * buffer. Values equal to the missing value are not scaled.
+ */
+static void scale_array(Array *source, Array *result, double m, double b, double missing, bool use_missing)
+{
+    int length = source->length();
+
+    result->add_var_nocopy(new Float64(source->name()));
+    result->reserve_value_capacity(length);
+    dods_float64 *dest = reinterpret_cast<dods_float64*>(result->get_buf());
+
+    switch (source->var()->type()) {
+    case dods_byte_c:
+    case dods_uint8_c:
+        scale_values<dods_byte>(source, dest, m, b, missing, use_missing);
+        break;
+    case dods_int8_c:
+        scale_values<dods_int8>(source, dest, m, b, missing, use_missing);
+        break;
+    case dods_int16_c:
+        scale_values<dods_int16>(source, dest, m, b, missing, use_missing);
+        break;
+    case dods_uint16_c:
+        scale_values<dods_uint16>(source, dest, m, b, missing, use_missing);
+        break;
+    case dods_int32_c:
+        scale_values<dods_int32>(source, dest, m, b, missing, use_missing);
+        break;
+    case dods_uint32_c:
+        scale_values<dods_uint32>(source, dest, m, b, missing, use_missing);
+        break;
+    case dods_int64_c:
+        scale_values<dods_int64>(source, dest, m, b, missing, use_missing);
+        break;
+    case dods_uint64_c:
+        scale_values<dods_uint64>(source, dest, m, b, missing, use_missing);
+        break;
+    case dods_float32_c:
+        scale_values<dods_float32>(source, dest, m, b, missing, use_missing);
+        break;
+    case dods_float64_c:
+        scale_values<dods_float64>(source, dest, m, b, missing, use_missing);
+        break;
+    default: {
+        // extract_double_array() throws Error if the type is not numeric
+        double *data = extract_double_array(source);
+        if (use_missing)
+            linear_scale_kernel(data, dest, length, m, b, missing);
+        else
+            linear_scale_kernel(data, dest, length, m, b);
+        delete[] data;
+        break;
+    }
+    }
+
+    result->set_read_p(true);
+}
+
 BaseType *function_linear_scale_worker(BaseType *bt, double m, double b, double missing, bool use_missing)
 {
     // Read the data, scale and return the result. Must replace the new data
     // in a constructor (i.e., Array part of a Grid).
     BaseType *dest = 0;
-    double *data;
     if (bt->type() == dods_grid_c) {
         // Grab the whole Grid; note that the scaling is done only on the array part
         Grid &source = dynamic_cast<Grid&>(*bt);
@@ -163,26 +238,20 @@ BaseType *function_linear_scale_worker(BaseType *bt, double m, double b, double
         source.set_send_p(true);
         source.read();
 
-        // Get the Array part and read the values
-        Array *a = source.get_array();
-        //a->read();
-        data = extract_double_array(a);
-
-        // Now scale the data.
-        int length = a->length();
-        for (int i = 0; i < length; ++i)
-            data[i] = data[i] * m + b;
-
         // Copy source Grid to result Grid. Could improve on this by not using this
         // trick since it copies all of 'source' to 'dest', including the main Array.
         // The next bit of code will replace those values with the newly scaled ones.
         Grid *result = new Grid(source);
 
-        // Now load the transferred values; use Float64 as the new type of the result
-        // Grid Array.
-        result->get_array()->add_var_nocopy(new Float64(source.name()));
-        result->get_array()->set_value(data, length);
-        delete[] data;
+        // Now scale the Array part into the result Grid's Array, using Float64
+        // as its new type.
+        try {
+            scale_array(source.get_array(), result->get_array(), m, b, missing, use_missing);
+        }
+        catch (...) {
+            delete result;
+            throw;
+        }
 
         // FIXME result->set_send_p(true);
         BESDEBUG("function", "function_linear_scale_worker() - Grid send_p: " << source.send_p() << endl);
@@ -202,17 +271,14 @@ BaseType *function_linear_scale_worker(BaseType *bt, double m, double b, double
         else
             source.read();
 
-        data = extract_double_array(&source);
-        int length = source.length();
-        for (int i = 0; i < length; ++i)
-            data[i] = data[i] * m + b;
-
         Array *result = new Array(source);
-
-        result->add_var_nocopy(new Float64(source.name()));
-        result->set_value(data, length);
-
-        delete[] data; // val2buf copies.
+        try {
+            scale_array(&source, result, m, b, missing, use_missing);
+        }
+        catch (...) {
+            delete result;
+            throw;
+        }
 
         dest = result;
     }
@@ -51,6 +51,7 @@
 
 #include "MakeArrayFunction.h"
 #include "functions_util.h"
+#include "numeric_kernels.h"
 
 using namespace libdap;
 
@@ -79,19 +80,12 @@ void mask_array_helper(Array *array, double no_data_value, const vector<dods_byt
     // Read the data array's data
     array->read();
     array->set_read_p(true);
-    vector<T> data(array->length());
-    array->value(&data[0]);
 
-    assert(data.size() == mask.size());
+    assert(array->length() == (int) mask.size());
 
-    // mask the data array
-    vector<dods_byte>::const_iterator mi = mask.begin();
-    for (typename vector<T>::iterator i = data.begin(), e = data.end(); i != e; ++i) {
-        if (!*mi++) *i = no_data_value;
-    }
-
-    // reset the values
-    array->set_value(data, data.size());
+    // mask the data array's values where they are
+    if (!mask.empty())
+        mask_kernel(reinterpret_cast<T*>(array->get_buf()), &mask[0], mask.size(), static_cast<T>(no_data_value));
 }
 
 /**
@@ -46,6 +46,7 @@
 #include "BESDebug.h"
 
 #include "RangeFunction.h"
+#include "numeric_kernels.h"
 
 using namespace libdap;
 
@@ -168,67 +169,67 @@ static double get_missing_value(BaseType *var)
 min_max_t find_min_max(double* data, int length, bool use_missing, double missing)
 {
     min_max_t v;
-    double previous_value;
-    bool increasing, previously_increasing;
-
-    v.monotonic = true;
-    previous_value = data[0];
-    if (use_missing) {
-        for (int i = 0; i < length; ++i) {
-            if (!double_eq(data[i], missing)) {
-                if(v.monotonic && i>0){
-                    increasing = (data[i] - previous_value) > 0.0;
-                    if(i>1){
-                        if(previously_increasing!=increasing){
-                            v.monotonic = false;
-                        }
-                    }
-                    previously_increasing = increasing;
-                    previous_value = data[i];
-                }
-                v.max_val = max(v.max_val, data[i]);
-                v.min_val = min(v.min_val, data[i]);
-            }
-        }
-    }
-    else {
-        for (int i = 0; i < length; ++i) {
-            if(v.monotonic && i>0){
-                increasing = (data[i] - previous_value) > 0.0;
-                if(i>1){
-                    if(previously_increasing!=increasing){
-                        v.monotonic = false;
-                    }
-                }
-                previously_increasing = increasing;
-                previous_value = data[i];
-            }
-            v.max_val = max(v.max_val, data[i]);
-            v.min_val = min(v.min_val, data[i]);
-        }
-    }
+    min_max_kernel(data, length, use_missing, missing, v.min_val, v.max_val, v.monotonic);
+    return v;
+}
 
-#if 0
-    for (int i = 0; i < length; ++i) {
-        if (!use_missing || !double_eq(data[i], missing)) {
-            if(v.monotonic && i>0){
-                increasing = (data[i] - previous_value) > 0.0;
-                if(i>1){
-                    if(previously_increasing!=increasing){
-                        v.monotonic = false;
-                    }
-                }
-                previously_increasing = increasing;
-                previous_value = data[i];
-            }
-            v.max_val = max(v.max_val, data[i]);
-            v.min_val = min(v.min_val, data[i]);
-        }
-    }
-#endif
+template<typename T>
+static min_max_t array_min_max(Array *a, bool use_missing, double missing)
+{
+    min_max_t v;
+    T native_missing = T();
+    if (use_missing && !native_missing_value(missing, native_missing))
+        use_missing = false;    // no value can match
+
+    min_max_kernel(reinterpret_cast<const T*>(a->get_buf()), a->length(), use_missing, native_missing, v.min_val,
+        v.max_val, v.monotonic);
     return v;
 }
 
+/**
+ * @brief Scan an Array's values and find the max and min values.
+ *
+ * The values are scanned in the Array's own type; they are not copied.
+ *
+ * @param a The Array; its values must have been read
+ * @param use_missing True if the data values matching missing should be excluded
+ * @param missing Value to exclude (a double)
+ * @return An instance of min_max_t that holds the min and max values
+ */
+min_max_t find_min_max(Array *a, bool use_missing, double missing)
+{
+    switch (a->var()->type()) {
+    case dods_byte_c:
+    case dods_uint8_c:
+        return array_min_max<dods_byte>(a, use_missing, missing);
+    case dods_int8_c:
+        return array_min_max<dods_int8>(a, use_missing, missing);
+    case dods_int16_c:
+        return array_min_max<dods_int16>(a, use_missing, missing);
+    case dods_uint16_c:
+        return array_min_max<dods_uint16>(a, use_missing, missing);
+    case dods_int32_c:
+        return array_min_max<dods_int32>(a, use_missing, missing);
+    case dods_uint32_c:
+        return array_min_max<dods_uint32>(a, use_missing, missing);
+    case dods_int64_c:
+        return array_min_max<dods_int64>(a, use_missing, missing);
+    case dods_uint64_c:
+        return array_min_max<dods_uint64>(a, use_missing, missing);
+    case dods_float32_c:
+        return array_min_max<dods_float32>(a, use_missing, missing);
+    case dods_float64_c:
+        return array_min_max<dods_float64>(a, use_missing, missing);
+    default: {
+        // extract_double_array() throws Error if the type is not numeric
+        double *data = extract_double_array(a);
+        min_max_t v = find_min_max(data, a->length(), use_missing, missing);
+        delete[] data;
+        return v;
+    }
+    }
+}
+
 // TODO Modify this to include information about monotonicity of vectors.
 // That will be useful for geo operations when we use this to look at lat
 // and lon extent.
@@ -261,16 +262,8 @@ BaseType *range_worker(BaseType *bt, double missing, bool use_missing)
         source.set_send_p(true);
         source.read();
 
-        // Get the Array part and read the values
-        Array *a = source.get_array();
-        double *data = extract_double_array(a);
-
-        // Now determine the range.
-        int length = a->length();
-
-        v = find_min_max(data, length, use_missing, missing);
-
-        delete[] data;
+        // Now determine the range of the Array part.
+        v = find_min_max(source.get_array(), use_missing, missing);
     }
     else if (bt->is_vector_type()) {
         Array &source = dynamic_cast<Array&>(*bt);
@@ -283,14 +276,8 @@ BaseType *range_worker(BaseType *bt, double missing, bool use_missing)
         else
             source.read();
 
-        double *data = extract_double_array(&source);
-
         // Now determine the range.
-        int length = source.length();
-
-        v = find_min_max(data, length, use_missing, missing);
-
-        delete[] data;
+        v = find_min_max(&source, use_missing, missing);
     }
     else if (bt->is_simple_type() && !(bt->type() == dods_str_c || bt->type() == dods_url_c)) {
         double data = extract_double_value(bt);
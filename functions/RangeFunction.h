@@ -15,6 +15,7 @@
 
 namespace libdap {
 class BaseType;
+class Array;
 class DDS;
 }
 
@@ -38,6 +39,7 @@ struct min_max_t {
 // These are declared here so they can be tested by RangeFunctionTest.cc in unit-tests.
 // jhrg 6/7/17
 min_max_t find_min_max(double* data, int length, bool use_missing, double missing);
+min_max_t find_min_max(libdap::Array *a, bool use_missing, double missing);
 libdap::BaseType *range_worker(libdap::BaseType *bt, double missing, bool use_missing);
 
 /**
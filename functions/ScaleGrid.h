@@ -93,6 +93,8 @@ libdap::Grid *scale_dap_grid(const libdap::Grid *src, const SizeBox &size, const
     const std::string &interp);
 libdap::Grid *scale_dap_array(const libdap::Array *data, const libdap::Array *lon, const libdap::Array *lat,
     const SizeBox &size, const std::string &crs, const std::string &interp);
+void set_scale_3D_max_threads(unsigned int threads);
+
 libdap::Grid *scale_dap_array_3D(const libdap::Array *data, const libdap::Array *t, const libdap::Array *lon, const libdap::Array *lat, const SizeBox &size,
     const std::string &crs, const std::string &interp);
 
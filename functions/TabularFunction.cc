@@ -215,6 +215,9 @@ void TabularFunction::read_values(const vector<Array*> &arrays)
  * @note This code depends on each Array in 'arrays' having already read its
  * values. It will throw Error if that is not the case.
  *
+ * @note function_dap2_tabular() does not use this; it loads the Arrays into
+ * a TabularSequence as columns so that no object is made for each value.
+ *
  * @param the_arrays Extract data from these arrays
  * @param sv The destination object; a value-result parameter, passed
  * by reference. Note that DAP2's SequenceValues and DAP4's D4SeqValues
@@ -408,16 +411,10 @@ void TabularFunction::function_dap2_tabular(int argc, BaseType *argv[], DDS &, B
             throw Error("In function tabular(): Expected all of the 'independent' variables to have the same shape.");
     }
 
-    // Read the values and load them into a SequenceValues object
     read_values(indep_vars);
-    unsigned long num_indep_values = number_of_values(indep_shape);
-    SequenceValues indep_sv(num_indep_values);
-    build_sequence_values(indep_vars, indep_sv);
 
-    // Set the reference to the result. If there are any dependent variables,
-    // 'result' will be set to 'dep_vars' once that has been hasked and the
-    // indep_vars merged in.
-    SequenceValues &result = indep_sv;
+    // The index column made for the dependent variables' extra dimension
+    auto_ptr<Array> index_column;
 
     // If there are dependent variables, process them
     if (dep_vars.size() > 0) {
@@ -440,36 +437,28 @@ void TabularFunction::function_dap2_tabular(int argc, BaseType *argv[], DDS &, B
             throw Error("In function tabular(): The 'independent' array shapes must match the right-most dimensions of the 'dependent' variables.");
 
         read_values(dep_vars);
-        unsigned long num_dep_values = number_of_values(dep_shape);
-        SequenceValues dep_sv(num_dep_values);
 
         // Add and extra variable for extra dimension's index
         add_index_column(indep_shape, dep_shape, dep_vars);
-
-        build_sequence_values(dep_vars, dep_sv);
-
-        // Now combine the dependent and independent variables; put the
-        // result in the dependent variable vector and assign the 'result'
-        // reference to it.
-        combine_sequence_values(dep_sv, indep_sv);
-        result = dep_sv;
+        index_column.reset(dep_vars.at(0));
     }
 
     auto_ptr<TabularSequence> response(new TabularSequence("table"));
 
-    if (dep_vars.size() > 0) {
-        // set the columns of the response
-        for (SequenceValues::size_type n = 0; n < dep_vars.size(); ++n) {
-            response->add_var(dep_vars[n]->var());
-        }
+    // Set the columns of the response and load their values. The values
+    // are held in their native types; the independent variables' columns
+    // are shorter than the dependent variables' and their values repeat
+    // for each value of the extra index.
+    for (vector<Array*>::size_type n = 0; n < dep_vars.size(); ++n) {
+        response->add_var(dep_vars[n]->var());
+        response->add_column(dep_vars[n]);
     }
 
-    for (SequenceValues::size_type n = 0; n < indep_vars.size(); ++n) {
+    for (vector<Array*>::size_type n = 0; n < indep_vars.size(); ++n) {
         response->add_var(indep_vars[n]->var());
+        response->add_column(indep_vars[n]);
     }
 
-    // set the values of the response
-    response->set_value(result);
     response->set_read_p(true);
 
     *btpp = response.release();
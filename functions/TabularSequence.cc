@@ -24,6 +24,8 @@
 
 #include "config.h"
 
+#include <cassert>
+
 #include <algorithm>
 #include <string>
 #include <sstream>
@@ -40,6 +42,8 @@
 #include <Float64.h>
 #include <Str.h>
 #include <Url.h>
+#include <Array.h>
+#include <Error.h>
 
 #include <DDS.h>
 #include <ConstraintEvaluator.h>
@@ -72,6 +76,207 @@ write_start_of_instance(Marshaller &m)
     m.put_opaque( (char *)&start_of_instance, 1 ) ;
 }
 
+// Copy an Array's values to a vector of their native type
+template<typename T>
+static void get_values(Array *a, vector<T> &values)
+{
+    values.resize(a->length());
+    if (!values.empty()) a->value(&values[0]);
+}
+
+static void get_values(Array *a, vector<string> &values)
+{
+    a->value(values);
+}
+
+/**
+ * A TabularColumn that holds values of type T. The BaseType loaded by
+ * load_value() must be the scalar type whose val2buf() takes a T*.
+ */
+template<typename T>
+class TypedTabularColumn: public TabularColumn {
+private:
+    vector<T> d_values;
+
+public:
+    TypedTabularColumn(Array *a)
+    {
+        get_values(a, d_values);
+    }
+
+    virtual ~TypedTabularColumn() { }
+
+    virtual TabularColumn *ptr_duplicate() const
+    {
+        return new TypedTabularColumn<T>(*this);
+    }
+
+    virtual unsigned long size() const
+    {
+        return d_values.size();
+    }
+
+    virtual void load_value(BaseType *var, unsigned long row) const
+    {
+        // val2buf() copies the value; it does not modify it
+        var->val2buf(const_cast<T*>(&d_values[row % d_values.size()]));
+    }
+};
+
+/**
+ * Make a column that holds the values of an Array. The Array must have
+ * read its values.
+ *
+ * @param a The Array
+ * @return A new TabularColumn; the caller must delete it
+ */
+TabularColumn *TabularColumn::make_column(Array *a)
+{
+    switch (a->var()->type()) {
+    case dods_byte_c:
+        return new TypedTabularColumn<dods_byte>(a);
+    case dods_int16_c:
+        return new TypedTabularColumn<dods_int16>(a);
+    case dods_int32_c:
+        return new TypedTabularColumn<dods_int32>(a);
+    case dods_uint16_c:
+        return new TypedTabularColumn<dods_uint16>(a);
+    case dods_uint32_c:
+        return new TypedTabularColumn<dods_uint32>(a);
+    case dods_float32_c:
+        return new TypedTabularColumn<dods_float32>(a);
+    case dods_float64_c:
+        return new TypedTabularColumn<dods_float64>(a);
+    case dods_str_c:
+    case dods_url_c:
+        return new TypedTabularColumn<string>(a);
+    default:
+        throw Error("In tabular(): Arrays of type " + a->var()->type_name() + " cannot be made into a table column.");
+    }
+}
+
+void TabularSequence::m_duplicate_columns(const TabularSequence &rhs)
+{
+    d_num_rows = rhs.d_num_rows;
+    for (vector<TabularColumn*>::const_iterator i = rhs.d_columns.begin(), e = rhs.d_columns.end(); i != e; ++i)
+        d_columns.push_back((*i)->ptr_duplicate());
+}
+
+void TabularSequence::delete_columns()
+{
+    for (vector<TabularColumn*>::iterator i = d_columns.begin(), e = d_columns.end(); i != e; ++i)
+        delete *i;
+
+    d_columns.clear();
+    d_num_rows = 0;
+}
+
+/**
+ * @brief Add a column of values
+ *
+ * The columns are added in the same order as the Sequence's variables;
+ * call add_var() with the Array's template variable and this with the
+ * Array itself. The number of rows in the table is the number of values in
+ * its largest column. Columns with fewer values repeat them, so each
+ * column's size must evenly divide the number of rows.
+ *
+ * @param a Copy the values of this Array. It must have read its values.
+ */
+void TabularSequence::add_column(Array *a)
+{
+    TabularColumn *column = TabularColumn::make_column(a);
+    d_columns.push_back(column);
+    d_num_rows = max(d_num_rows, column->size());
+
+    for (vector<TabularColumn*>::iterator i = d_columns.begin(), e = d_columns.end(); i != e; ++i) {
+        if ((*i)->size() == 0 || d_num_rows % (*i)->size() != 0)
+            throw InternalErr(__FILE__, __LINE__, "The size of each column in a table must evenly divide the number of rows.");
+    }
+}
+
+/**
+ * Build the rows of BaseType objects that a Sequence holds from the
+ * columns and then discard the columns. Once this is called, this object
+ * behaves just like a Sequence that was loaded using set_value().
+ */
+void TabularSequence::build_rows()
+{
+    if (d_columns.empty()) return;
+
+    SequenceValues rows;
+    rows.reserve(d_num_rows);
+    for (unsigned long row = 0; row < d_num_rows; ++row) {
+        load_prototypes_with_values(row);
+
+        BaseTypeRow *btr = new BaseTypeRow(d_vars.size());
+        for (BaseTypeRow::size_type j = 0; j < d_vars.size(); ++j) {
+            (*btr)[j] = d_vars[j]->ptr_duplicate();
+            (*btr)[j]->set_send_p(true);
+            (*btr)[j]->set_read_p(true);
+        }
+        rows.push_back(btr);
+    }
+
+    delete_columns();
+    Sequence::set_value(rows);
+}
+
+int TabularSequence::number_of_rows() const
+{
+    return columnar() ? d_num_rows : Sequence::number_of_rows();
+}
+
+void TabularSequence::set_value(SequenceValues &values)
+{
+    delete_columns();
+    Sequence::set_value(values);
+}
+
+SequenceValues TabularSequence::value()
+{
+    build_rows();
+    return Sequence::value();
+}
+
+SequenceValues &TabularSequence::value_ref()
+{
+    build_rows();
+    return Sequence::value_ref();
+}
+
+BaseTypeRow *TabularSequence::row_value(size_t row)
+{
+    build_rows();
+    return Sequence::row_value(row);
+}
+
+BaseType *TabularSequence::var_value(size_t row, const string &name)
+{
+    build_rows();
+    return Sequence::var_value(row, name);
+}
+
+BaseType *TabularSequence::var_value(size_t row, size_t i)
+{
+    build_rows();
+    return Sequence::var_value(row, i);
+}
+
+/**
+ * Load the Sequence's prototype variables with the values of one row of
+ * the columns.
+ *
+ * @param row The row number
+ */
+void TabularSequence::load_prototypes_with_values(unsigned long row)
+{
+    assert(d_columns.size() == d_vars.size());
+
+    vector<TabularColumn*>::iterator ci = d_columns.begin();
+    for (Vars_iter i = d_vars.begin(), e = d_vars.end(); i != e; ++i)
+        (*ci++)->load_value(*i, row);
+}
+
 void TabularSequence::load_prototypes_with_values(BaseTypeRow &btr, bool safe)
 {
     // For each of the prototype variables in the Sequence, load it
@@ -142,6 +347,32 @@ TabularSequence::serialize(ConstraintEvaluator &eval, DDS &dds, Marshaller &m, b
 {
     DBG(cerr << "Entering TabularSequence::serialize for " << name() << endl);
 
+    if (columnar()) {
+        // Serialize the rows straight from the columns using the prototypes;
+        // no per-value objects are made.
+        for (Vars_iter i = d_vars.begin(), e = d_vars.end(); i != e; ++i)
+            (*i)->set_read_p(true);
+
+        for (unsigned long row = 0; row < d_num_rows; ++row) {
+            load_prototypes_with_values(row);
+
+            if (ce_eval && !eval.eval_selection(dds, dataset()))
+                continue;
+
+            write_start_of_instance(m);
+
+            for (Vars_iter i = d_vars.begin(), e = d_vars.end(); i != e; ++i) {
+                if ((*i)->send_p()) {
+                    (*i)->serialize(eval, dds, m, false);
+                }
+            }
+        }
+
+        write_end_of_sequence(m);
+
+        return true;
+    }
+
     SequenceValues &values = value_ref();
     //ce_eval = true; Commented out here and changed in BESDapResponseBuilder. jhrg 3/10/15
 
@@ -201,6 +432,33 @@ void TabularSequence::intern_data(ConstraintEvaluator &eval, DDS &dds)
     // after doing some profiling to see if this code can be meaningfully
     // optimized
     SequenceValues result;      // These values satisfy the CE
+
+    if (columnar()) {
+        // Only make objects for the values that will be sent
+        for (unsigned long row = 0; row < d_num_rows; ++row) {
+            load_prototypes_with_values(row);
+
+            if (!eval.eval_selection(dds, dataset()))
+                continue;
+
+            BaseTypeRow *result_row = new BaseTypeRow();
+            for (Vars_iter i = d_vars.begin(), e = d_vars.end(); i != e; ++i) {
+                if ((*i)->send_p()) {
+                    BaseType *btp = (*i)->ptr_duplicate();
+                    btp->set_read_p(true);
+                    result_row->push_back(btp);
+                }
+            }
+
+            result.push_back(result_row);
+        }
+
+        set_value(result);
+
+        DBG(cerr << "Leaving TabularSequence::intern_data" << endl);
+        return;
+    }
+
     SequenceValues &values = value_ref();
 
     for (SequenceValues::iterator i = values.begin(), e = values.end(); i != e; ++i) {
@@ -251,6 +509,7 @@ TabularSequence::dump(ostream &strm) const
 {
     strm << DapIndent::LMarg << "TabularSequence::dump - (" << (void *)this << ")" << endl ;
     DapIndent::Indent() ;
+    strm << DapIndent::LMarg << "columns: " << d_columns.size() << ", rows: " << d_num_rows << endl ;
     Sequence::dump(strm) ;
     DapIndent::UnIndent() ;
 }
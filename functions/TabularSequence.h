@@ -44,7 +44,10 @@
 
 #include <Sequence.h>
 
+#include <vector>
+
 namespace libdap {
+class Array;
 class ConstraintEvaluator;
 class DDS;
 class Marshaller;
@@ -52,15 +55,49 @@ class Marshaller;
 
 namespace functions {
 
+/** @brief One column of a TabularSequence
+ *
+ * The values are held in a vector of their native type. A column may hold
+ * fewer values than the table has rows, in which case they repeat: the
+ * value for row r is the value r modulo the column's size.
+ */
+class TabularColumn {
+public:
+    virtual ~TabularColumn() { }
+
+    virtual TabularColumn *ptr_duplicate() const = 0;
+
+    /// The number of values in this column
+    virtual unsigned long size() const = 0;
+
+    /// Set the value of the scalar variable 'var' to this column's value for 'row'
+    virtual void load_value(libdap::BaseType *var, unsigned long row) const = 0;
+
+    static TabularColumn *make_column(libdap::Array *a);
+};
+
 /** @brief Specialization of Sequence for tables of data
  *
- * Assumes that the data are loaded into the Sequence using set_value()
+ * The data can be loaded into the Sequence using set_value() or, more
+ * efficiently, as columns of values using add_column(). Each column added
+ * is held as a vector of its native type and rows are built from those
+ * only when serialized (or when code that expects a Sequence with rows of
+ * BaseType objects asks for them).
  */
 class TabularSequence: public libdap::Sequence
 {
 private:
+    std::vector<TabularColumn*> d_columns;
+    unsigned long d_num_rows;
+
+    void m_duplicate_columns(const TabularSequence &rhs);
+    void delete_columns();
+
+    void build_rows();
+
 protected:
     void load_prototypes_with_values(libdap::BaseTypeRow &btr, bool safe = true);
+    void load_prototypes_with_values(unsigned long row);
 
 public:
     /** The Sequence constructor requires only the name of the variable
@@ -71,7 +108,7 @@ public:
         created.
 
         @brief The Sequence constructor. */
-    TabularSequence(const string &n) : Sequence(n) { }
+    TabularSequence(const string &n) : Sequence(n), d_num_rows(0) { }
 
     /** The Sequence server-side constructor requires the name of the variable
         to be created and the dataset name from which this variable is being
@@ -83,12 +120,16 @@ public:
         variable is being created.
 
         @brief The Sequence server-side constructor. */
-    TabularSequence(const string &n, const string &d) : Sequence(n, d) { }
+    TabularSequence(const string &n, const string &d) : Sequence(n, d), d_num_rows(0) { }
 
     /** @brief The Sequence copy constructor. */
-    TabularSequence(const TabularSequence &rhs) : Sequence(rhs) { }
+    TabularSequence(const TabularSequence &rhs) : Sequence(rhs), d_num_rows(0) {
+        m_duplicate_columns(rhs);
+    }
 
-    virtual ~TabularSequence() { }
+    virtual ~TabularSequence() {
+        delete_columns();
+    }
 
     virtual BaseType *ptr_duplicate() { return new TabularSequence(*this); }
 
@@ -98,9 +139,26 @@ public:
 
         static_cast<Sequence &>(*this) = rhs; // run Sequence=
 
+        delete_columns();
+        m_duplicate_columns(rhs);
+
         return *this;
     }
 
+    void add_column(libdap::Array *a);
+
+    /// True if the values are held as columns
+    bool columnar() const { return !d_columns.empty(); }
+
+    virtual int number_of_rows() const;
+
+    virtual void set_value(libdap::SequenceValues &values);
+    virtual libdap::SequenceValues value();
+    virtual libdap::SequenceValues &value_ref();
+    virtual libdap::BaseTypeRow *row_value(size_t row);
+    virtual libdap::BaseType *var_value(size_t row, const string &name);
+    virtual libdap::BaseType *var_value(size_t row, size_t i);
+
     virtual bool serialize(libdap::ConstraintEvaluator &eval, libdap::DDS &dds, libdap::Marshaller &m, bool ce_eval = true);
     virtual void intern_data(libdap::ConstraintEvaluator &eval, libdap::DDS &dds);
 
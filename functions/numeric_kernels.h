@@ -0,0 +1,175 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of bes, A C++ implementation of the OPeNDAP
+// Hyrax data server
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Authors: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef FUNCTIONS_NUMERIC_KERNELS_H_
+#define FUNCTIONS_NUMERIC_KERNELS_H_
+
+#include <cmath>
+#include <limits>
+
+// The loops that do the work of linear_scale(), range() and mask_array().
+// Each one makes a single pass over an array's values in their own type
+// (e.g., an Int16 array is not first copied to a vector of doubles). The
+// loop bodies have no branches (other than the missing value version of
+// min_max_kernel(), which has to track the previous value), so the compiler
+// can vectorize them.
+
+namespace functions {
+
+/// The least value of type T
+template<typename T> inline T lowest_value()
+{
+    return std::numeric_limits<T>::is_integer ? std::numeric_limits<T>::min() : -std::numeric_limits<T>::max();
+}
+
+/**
+ * @brief Convert a missing value to the type of the data.
+ *
+ * @param missing The missing value
+ * @param value Value-result parameter; the missing value as a T
+ * @return False if no value of type T can be the missing value (e.g.,
+ * -9999 for a Byte array or 0.5 for an Int32 array), in which case no
+ * value needs to be treated as missing.
+ */
+template<typename T> bool native_missing_value(double missing, T &value)
+{
+    if (std::numeric_limits<T>::is_integer) {
+        // 2^digits is one more than max() and, unlike max() for the 64-bit
+        // types, is exact as a double
+        if (!(missing >= static_cast<double>(std::numeric_limits<T>::min())
+            && missing < std::ldexp(1.0, std::numeric_limits<T>::digits))) return false;
+
+        value = static_cast<T>(missing);
+        return static_cast<double>(value) == missing;
+    }
+
+    if (std::isnan(missing) || (std::fabs(missing) > std::numeric_limits<T>::max() && !std::isinf(missing)))
+        return false;
+
+    value = static_cast<T>(missing);
+    return true;
+}
+
+/**
+ * @brief dest[i] = src[i] * m + b
+ */
+template<typename T>
+void linear_scale_kernel(const T *src, double *dest, unsigned long length, double m, double b)
+{
+    for (unsigned long i = 0; i < length; ++i)
+        dest[i] = src[i] * m + b;
+}
+
+/**
+ * @brief dest[i] = src[i] * m + b, except that missing values are copied
+ */
+template<typename T>
+void linear_scale_kernel(const T *src, double *dest, unsigned long length, double m, double b, T missing)
+{
+    for (unsigned long i = 0; i < length; ++i)
+        dest[i] = (src[i] == missing) ? static_cast<double>(src[i]) : src[i] * m + b;
+}
+
+/**
+ * @brief Find the smallest and largest values and test for monotonicity.
+ *
+ * The values are monotonic if each one is greater than the one before it,
+ * or if none is. NaNs and missing values are ignored.
+ *
+ * @param data The values
+ * @param length The number of values
+ * @param use_missing If true, skip values equal to 'missing'
+ * @param missing The missing value
+ * @param min_val Value-result parameter; set to the smallest value unless
+ * there are no values
+ * @param max_val Value-result parameter; set to the largest value unless
+ * there are no values
+ * @param monotonic Value-result parameter
+ */
+template<typename T>
+void min_max_kernel(const T *data, unsigned long length, bool use_missing, T missing, double &min_val,
+    double &max_val, bool &monotonic)
+{
+    T lo = std::numeric_limits<T>::max();
+    T hi = lowest_value<T>();
+    bool found = false;
+
+    if (!use_missing) {
+        unsigned long ups = 0;
+        if (length > 0) {
+            lo = (data[0] < lo) ? data[0] : lo;
+            hi = (hi < data[0]) ? data[0] : hi;
+        }
+        for (unsigned long i = 1; i < length; ++i) {
+            T x = data[i];
+            lo = (x < lo) ? x : lo;
+            hi = (hi < x) ? x : hi;
+            ups += (data[i - 1] < x);
+        }
+
+        monotonic = ups == 0 || ups == length - 1;
+        found = !(hi < lo);
+    }
+    else {
+        T previous = T();
+        bool have_previous = false, have_direction = false, previous_up = false;
+        monotonic = true;
+        for (unsigned long i = 0; i < length; ++i) {
+            T x = data[i];
+            if (x == missing) continue;
+
+            if (x < lo) lo = x;
+            if (hi < x) hi = x;
+            found = found || x == x;
+
+            if (have_previous && monotonic) {
+                bool up = previous < x;
+                if (have_direction && up != previous_up) monotonic = false;
+                previous_up = up;
+                have_direction = true;
+            }
+            previous = x;
+            have_previous = true;
+        }
+    }
+
+    if (found) {
+        min_val = static_cast<double>(lo);
+        max_val = static_cast<double>(hi);
+    }
+}
+
+/**
+ * @brief data[i] = no_data wherever mask[i] is zero
+ */
+template<typename T>
+void mask_kernel(T *data, const unsigned char *mask, unsigned long length, T no_data)
+{
+    for (unsigned long i = 0; i < length; ++i)
+        data[i] = mask[i] ? data[i] : no_data;
+}
+
+} // namespace functions
+
+#endif /* FUNCTIONS_NUMERIC_KERNELS_H_ */
@@ -28,11 +28,16 @@
 
 //#include <float.h>
 
+#include <pthread.h>
+#include <signal.h>
+
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <memory>
 #include <limits>
 #include <sstream>
+#include <algorithm>
 #include <cassert>
 
 #include <gdal.h>
@@ -51,12 +56,21 @@
 #include <Error.h>
 #include <BESDebug.h>
 #include <BESError.h>
+#include <BESInternalError.h>
 #include <BESDapError.h>
 
 #include "ScaleGrid.h"
+#include "CoordinateMapIndex.h"
 
 #define DEBUG_KEY "geo"
 
+// For interpolation methods other than nearest neighbor, read about this
+// many source rows and columns for each one in the result
+#define SCALE_SOURCE_OVERSAMPLE 2
+
+// The default number of threads used to scale the bands of a 3D array
+#define SCALE_3D_DEFAULT_THREADS 4
+
 using namespace std;
 using namespace libdap;
 
@@ -91,19 +105,6 @@ SizeBox get_size_box(Array *x, Array *y)
     return SizeBox(src_x_size, src_y_size);
 }
 
-/**
- * @brief simple double equality test
- * @see http://stackoverflow.com/questions/17333/most-effective-way-for-float-and-double-comparison
- * @param a
- * @param b
- * @return True if they are within epsilon
- */
-static bool same_as(const double a, const double b)
-{
-    // use float's epsilon since double's is too small for these tests
-    return fabs(a - b) <= numeric_limits<float>::epsilon();
-}
-
 /**
  * @brief Test an array of doubles to see if its values are monotonic and uniform
  * @param values The array
@@ -112,21 +113,14 @@ static bool same_as(const double a, const double b)
  */
 bool monotonic_and_uniform(const vector<double> &values, double res)
 {
-    vector<double>::size_type end_index = values.size() - 1;
-    for (vector<double>::size_type i = 0; i < end_index; ++i) {
-//        BESDEBUG(DEBUG_KEY, "values[" << i+1 << "]: " << values[i+1] << " - values[" << i << "]: " << values[i] << endl);
-//        BESDEBUG(DEBUG_KEY, values[i+1] - values[i] <<" != res: " << res << endl);
-        if (!same_as((values[i+1] - values[i]), res))
-            return false;
-    }
-
-    return true;
+    return CoordinateMapIndex::is_uniform(values, res);
 }
 
 /**
  * @brief Extract the geo-transform coordinates from a DP2 Grid
  *
- * @note Side effect: Data are read into the x and y Arrays
+ * @note Side effect: Data are read into the x and y Arrays unless their
+ * indexes are cached (see CoordinateMapIndex)
  *
  * @param x
  * @param y
@@ -140,26 +134,26 @@ vector<double> get_geotransform_data(Array *x, Array *y, bool test_maps /* defau
     test_maps = true;
 #endif
 
-    SizeBox size = get_size_box(x, y);
-
-    y->read();
-	vector<double> y_values(size.y_size);
-	extract_double_array(y, y_values);
+    // The map indexes hold the values, direction and spacing of the maps;
+    // a map is read only if its index is not cached.
+    const CoordinateMapIndex &y_index = CoordinateMapIndex::get(y);
+    const vector<double> &y_values = y_index.get_values();
 
     double res_y = (y_values[y_values.size()-1] - y_values[0]) / (y_values.size() -1);
 
-    if (test_maps && !monotonic_and_uniform(y_values, res_y)){
+    if (test_maps && !y_index.is_uniform()){
         string msg = "The grids maps/dimensions must be monotonic and uniform (" + y->name() + ").";
 		BESDEBUG(DEBUG_KEY,"ERROR get_geotransform_data(): " << msg << endl);
         throw BESError(msg,BES_SYNTAX_USER_ERROR,__FILE__,__LINE__);
     }
-    x->read();
-	vector<double> x_values(size.x_size);
-	extract_double_array(x, x_values);
+    double y_origin = y_values[0];
+
+    const CoordinateMapIndex &x_index = CoordinateMapIndex::get(x);
+    const vector<double> &x_values = x_index.get_values();
 
 	double res_x = (x_values[x_values.size()-1] - x_values[0]) / (x_values.size() -1);
 
-	if (test_maps && !monotonic_and_uniform(x_values, res_x)){
+	if (test_maps && !x_index.is_uniform()){
 	    string msg = "The grids maps/dimensions must be monotonic and uniform (" + x->name() + ").";
 		BESDEBUG(DEBUG_KEY,"ERROR get_geotransform_data(): " << msg << endl);
         throw BESError(msg,BES_SYNTAX_USER_ERROR,__FILE__,__LINE__);
@@ -182,7 +176,7 @@ vector<double> get_geotransform_data(Array *x, Array *y, bool test_maps /* defau
     geo_transform[0] = x_values[0];
     geo_transform[1] = res_x;
     geo_transform[2] = 0;           // Assumed because the x/y maps are vectors
-    geo_transform[3] = y_values[0];
+    geo_transform[3] = y_origin;
     geo_transform[4] = 0;
     geo_transform[5] = res_y;
 
@@ -760,26 +754,38 @@ void read_band_data(const Array *src, GDALRasterBand* band)
 /**
  * @brief Share the Array's internal buffer with GDAL
  *
- * This can avoid allocating temporary memory.
+ * This avoids allocating and copying a second copy of the data. The new
+ * band uses the Array's values where they are, so the Array must not be
+ * deleted (or its values changed) until the GDALDataset is closed.
  *
- * @note This does not seem to work.
- *
- * @param src The Array
+ * @param src The Array; must be (effectively) two dimensional
  * @param ds The GDALDataset; modified so that it has a new band
  */
 void add_band_data(const Array *src, GDALDataset* ds)
 {
     Array *a = const_cast<Array*>(src);
 
-    //assert(a->dimensions() == 2);
+    if (!array_is_effectively_2D(src)) {
+        stringstream ss;
+        ss << "Cannot perform geo-spatial operations on an Array (";
+        ss << a->name() << ") with " << a->dimensions() << " dimensions.";
+        ss << "Because the constrained shape of the array: ";
+        a->print_decl(ss,"",false,true,true);
+        ss << " is not a two-dimensional array." << endl;
+        BESDEBUG(DEBUG_KEY, ss.str());
+        throw BESError(ss.str(), BES_SYNTAX_USER_ERROR, __FILE__, __LINE__);
+    }
 
     a->read();
+    a->set_read_p(true);
 
     // The MEMory driver supports the DATAPOINTER option.
+    char pointer[64];
+    int len = CPLPrintPointer(pointer, a->get_buf(), sizeof(pointer) - 1);
+    pointer[len] = '\0';
+
     char **options = NULL;
-    ostringstream oss;
-    oss << reinterpret_cast<unsigned long>(a->get_buf());
-    options = CSLSetNameValue(options, "DATAPOINTER", oss.str().c_str());
+    options = CSLSetNameValue(options, "DATAPOINTER", pointer);
 
     CPLErr error = ds->AddBand(get_array_type(a), options);
 
@@ -792,7 +798,107 @@ void add_band_data(const Array *src, GDALDataset* ds)
     }
 }
 
-#define ADD_BAND 0
+/**
+ * @brief How many source rows or columns to step over for each one read
+ *
+ * Nearest neighbor scaling uses at most one source pixel for each result
+ * pixel, so there is no need to read more rows or columns than there are
+ * in the result. The other methods use a neighborhood of pixels; for them
+ * read about SCALE_SOURCE_OVERSAMPLE times the result's size.
+ *
+ * @param src_size The number of source rows or columns
+ * @param dst_size The number of result rows or columns
+ * @param interp The interpolation method
+ * @return The stride; 1 if every row or column must be read
+ */
+static int source_stride(unsigned long src_size, unsigned long dst_size, const string &interp)
+{
+    if (dst_size == 0 || src_size <= dst_size) return 1;
+
+    unsigned long needed = (interp == "nearest") ? dst_size : dst_size * SCALE_SOURCE_OVERSAMPLE;
+    return max(1UL, src_size / needed);
+}
+
+// Read every stride-th element of the Array's dimension d
+static void stride_dimension(Array *a, Array::Dim_iter d, int stride)
+{
+    a->add_constraint(d, a->dimension_start(d, true), a->dimension_stride(d, true) * stride,
+        a->dimension_stop(d, true));
+}
+
+/**
+ * @brief Constrain copies of the data and map Arrays to the resolution needed
+ *
+ * When the result of scaling is much smaller than the source, reading all of
+ * the source is wasteful. If the data have not been read yet, make copies of
+ * the data and its maps with strided constraints so that the handler reads
+ * only the rows and columns that the interpolation method will use. The
+ * Arrays passed in are not changed.
+ *
+ * @param data The data Array
+ * @param x The x (longitude) map
+ * @param y The y (latitude) map
+ * @param size The size of the result
+ * @param interp The interpolation method
+ * @param s_data Value-result parameter; the constrained copy of 'data'
+ * @param s_x Value-result parameter; the constrained copy of 'x'
+ * @param s_y Value-result parameter; the constrained copy of 'y'
+ * @return True if the copies were made, false if the source should be read
+ * as it is.
+ */
+static bool stride_source(Array *data, Array *x, Array *y, const SizeBox &size, const string &interp,
+    auto_ptr<Array> &s_data, auto_ptr<Array> &s_x, auto_ptr<Array> &s_y)
+{
+    if (data->read_p() || data->dimensions() < 2 || x->dimensions() != 1 || y->dimensions() != 1)
+        return false;
+
+    SizeBox src_size = get_size_box(x, y);
+    int x_stride = source_stride(src_size.x_size, size.x_size, interp);
+    int y_stride = source_stride(src_size.y_size, size.y_size, interp);
+    if (x_stride == 1 && y_stride == 1)
+        return false;
+
+    BESDEBUG(DEBUG_KEY, "stride_source() - reading every " << y_stride << " rows and " << x_stride
+        << " columns of '" << data->name() << "'" << endl);
+
+    s_data.reset(static_cast<Array*>(data->ptr_duplicate()));
+    s_x.reset(static_cast<Array*>(x->ptr_duplicate()));
+    s_y.reset(static_cast<Array*>(y->ptr_duplicate()));
+
+    stride_dimension(s_data.get(), get_x_dim(s_data.get()), x_stride);
+    stride_dimension(s_data.get(), get_y_dim(s_data.get()), y_stride);
+    stride_dimension(s_x.get(), s_x->dim_begin(), x_stride);
+    stride_dimension(s_y.get(), s_y->dim_begin(), y_stride);
+
+    // The maps may have been read already (with the old constraint)
+    s_x->set_read_p(false);
+    s_y->set_read_p(false);
+
+    return true;
+}
+
+/**
+ * @brief Give a result scaled from a strided source the geotransform of the full source
+ *
+ * GDAL sizes the pixels of the result using the extent of its source. When
+ * the source was read with a stride that does not evenly divide its size,
+ * the strided source covers a slightly different extent than the full one,
+ * so reset the result's pixel size to what scaling the full source yields.
+ *
+ * @param dst The scaled dataset; modified
+ * @param x The x (longitude) map of the full source
+ * @param y The y (latitude) map of the full source
+ */
+static void set_full_source_geotransform(GDALDataset *dst, Array *x, Array *y)
+{
+    SizeBox src_size = get_size_box(x, y);
+    vector<double> gt = get_geotransform_data(x, y);
+
+    gt[1] = gt[1] * src_size.x_size / dst->GetRasterXSize();
+    gt[5] = gt[5] * src_size.y_size / dst->GetRasterYSize();
+
+    dst->SetGeoTransform(&gt[0]);
+}
 
 /**
  * @brief Build a GDAL Dataset object for this data/lon/lat combination
@@ -822,13 +928,12 @@ auto_ptr<GDALDataset> build_src_dataset(Array *data, Array *x, Array *y, const s
 
     SizeBox array_size = get_size_box(x, y);
 
-    // The MEM driver takes no creation options jhrg 10/6/16
+    // The MEM driver takes no creation options jhrg 10/6/16. Make the dataset
+    // with no bands; its one band uses the data Array's values where they are.
     auto_ptr<GDALDataset> ds(driver->Create("result", array_size.x_size, array_size.y_size,
-    		1 /* nBands*/, get_array_type(data), NULL /* driver_options */));
+    		0 /* nBands*/, get_array_type(data), NULL /* driver_options */));
 
-#if ADD_BAND
     add_band_data(data, ds.get());
-#endif
 
     // Get the one band for this dataset and load it with data
 	GDALRasterBand *band = ds->GetRasterBand(1);
@@ -842,10 +947,6 @@ auto_ptr<GDALDataset> build_src_dataset(Array *data, Array *x, Array *y, const s
 	double no_data = get_missing_data_value(data);
 	band->SetNoDataValue(no_data);
 
-#if !ADD_BAND
-	read_band_data(data, band);
-#endif
-
 	vector<double> geo_transform = get_geotransform_data(x, y);
     ds->SetGeoTransform(&geo_transform[0]);
 
@@ -1020,11 +1121,22 @@ Grid *scale_dap_array(const Array *data, const Array *x, const Array *y, const S
     // Build GDALDataset for Grid g with lon and lat maps as given
     Array *d = const_cast<Array*>(data);
 
-    auto_ptr<GDALDataset> src = build_src_dataset(d, const_cast<Array*>(x), const_cast<Array*>(y));
+    // If the result is much smaller than the source, read a strided subset
+    // of the source. These must outlive 'src', which uses s_data's values.
+    auto_ptr<Array> s_data, s_x, s_y;
+    auto_ptr<GDALDataset> src;
+    bool strided = stride_source(d, const_cast<Array*>(x), const_cast<Array*>(y), size, interp, s_data, s_x, s_y);
+    if (strided)
+        src = build_src_dataset(s_data.get(), s_x.get(), s_y.get());
+    else
+        src = build_src_dataset(d, const_cast<Array*>(x), const_cast<Array*>(y));
 
     // scale to the new size, using optional CRS and interpolation params
     auto_ptr<GDALDataset> dst = scale_dataset(src, size, crs, interp);
 
+    if (strided)
+        set_full_source_geotransform(dst.get(), const_cast<Array*>(x), const_cast<Array*>(y));
+
     // Build a result Grid: extract the data, build the maps and assemble
     auto_ptr<Array> built_data(build_array_from_gdal_dataset(dst.get(), d));
 
@@ -1157,9 +1269,163 @@ auto_ptr<GDALDataset> build_src_dataset_3D(Array *data, Array *t, Array *x, Arra
     return ds;
 }
 
+// The most threads scale_dap_array_3D() uses; see set_scale_3D_max_threads()
+static unsigned int scale_3D_max_threads = SCALE_3D_DEFAULT_THREADS;
+
+/**
+ * @brief Set the number of threads used to scale the bands of a 3D array
+ *
+ * @param threads The most worker threads to use; 0 or 1 scales the bands
+ * one at a time on the calling thread.
+ */
+void set_scale_3D_max_threads(unsigned int threads)
+{
+    scale_3D_max_threads = threads;
+}
+
+/**
+ * The state shared by the threads that scale the bands of a 3D array.
+ * The data have been read before the work starts and each band is written
+ * to its own part of the result, so only 'next', 'error' and 'first_dst'
+ * need the mutex.
+ */
+struct scale_3D_work {
+    char *src;                  ///< The source values, band after band
+    unsigned long src_band_bytes;
+    SizeBox src_size;
+    vector<double> geo_transform;
+    string wkt;                 ///< The source dataset's SRS
+    double no_data;
+    GDALDataType type;
+
+    char *dst;                  ///< The result's values, band after band
+    unsigned long dst_band_bytes;
+    SizeBox size;
+    string crs;
+    string interp;
+
+    int n_bands;
+
+    pthread_mutex_t mutex;
+    int next;                   ///< The next band to scale
+    string error;               ///< The first error, if any
+    auto_ptr<GDALDataset> first_dst;    ///< Band 0's result; used to build the maps
+
+    scale_3D_work() : src(0), src_band_bytes(0), no_data(0), type(GDT_Unknown), dst(0), dst_band_bytes(0),
+        n_bands(0), next(0) { }
+};
+
+/**
+ * Scale one band. The band's source values are shared with a one-band MEM
+ * dataset (no copy), scaled with scale_dataset() and the result is read
+ * straight into the band's part of the result Array.
+ */
+static void scale_band(scale_3D_work &work, int band)
+{
+    GDALDriver *driver = GetGDALDriverManager()->GetDriverByName("MEM");
+    if (!driver)
+        throw BESError(string("Could not get the Memory driver for GDAL: ") + CPLGetLastErrorMsg(),
+            BES_INTERNAL_ERROR, __FILE__, __LINE__);
+
+    auto_ptr<GDALDataset> src(driver->Create("result", work.src_size.x_size, work.src_size.y_size, 0 /* nBands*/,
+        work.type, NULL /* driver_options */));
+    if (!src.get())
+        throw BESError(string("Could not make a GDAL dataset: ") + CPLGetLastErrorMsg(), BES_INTERNAL_ERROR,
+            __FILE__, __LINE__);
+
+    char pointer[64];
+    int len = CPLPrintPointer(pointer, work.src + work.src_band_bytes * band, sizeof(pointer) - 1);
+    pointer[len] = '\0';
+
+    char **options = CSLSetNameValue(NULL, "DATAPOINTER", pointer);
+    CPLErr error = src->AddBand(work.type, options);
+    CSLDestroy(options);
+    if (error != CPLE_None)
+        throw BESError(string("Could not add data for band ") + long_to_string(band) + ": " + CPLGetLastErrorMsg(),
+            BES_INTERNAL_ERROR, __FILE__, __LINE__);
+
+    src->GetRasterBand(1)->SetNoDataValue(work.no_data);
+    src->SetGeoTransform(&work.geo_transform[0]);
+    src->SetProjection(work.wkt.c_str());
+
+    auto_ptr<GDALDataset> dst = scale_dataset(src, work.size, work.crs, work.interp);
+
+    error = dst->GetRasterBand(1)->RasterIO(GF_Read, 0, 0, work.size.x_size, work.size.y_size,
+        work.dst + work.dst_band_bytes * band, work.size.x_size, work.size.y_size, work.type, 0, 0);
+    if (error != CPLE_None)
+        throw BESError(string("Could not extract data for band ") + long_to_string(band) + ": "
+            + CPLGetLastErrorMsg(), BES_INTERNAL_ERROR, __FILE__, __LINE__);
+
+    if (band == 0) {
+        pthread_mutex_lock(&work.mutex);
+        work.first_dst = dst;
+        pthread_mutex_unlock(&work.mutex);
+    }
+}
+
+/**
+ * Scale bands until there are none left or one fails. Run by each worker
+ * thread and by the calling thread.
+ */
+static void *scale_bands(void *arg)
+{
+    scale_3D_work &work = *static_cast<scale_3D_work*>(arg);
+
+    while (true) {
+        pthread_mutex_lock(&work.mutex);
+        int band = work.next++;
+        bool done = band >= work.n_bands || !work.error.empty();
+        pthread_mutex_unlock(&work.mutex);
+
+        if (done) break;
+
+        string msg;
+        try {
+            scale_band(work, band);
+        }
+        catch (BESError &e) {
+            msg = e.get_message();
+        }
+        catch (Error &e) {
+            msg = e.get_error_message();
+        }
+        catch (std::exception &e) {
+            msg = e.what();
+        }
+        catch (...) {
+            msg = "Unknown error while scaling band " + long_to_string(band);
+        }
+
+        if (!msg.empty()) {
+            pthread_mutex_lock(&work.mutex);
+            if (work.error.empty()) work.error = msg;
+            pthread_mutex_unlock(&work.mutex);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * The worker threads' start routine. The debug stream is not thread safe,
+ * so the debug and error output written by scale_dataset() and the other
+ * code the bands use is turned off for these threads; the calling thread,
+ * which scales bands too, still writes it.
+ */
+static void *scale_bands_worker(void *arg)
+{
+    BESDebug::SetThreadSilent(true);
+
+    return scale_bands(arg);
+}
+
 /**
  * @brief Scale a Grid; this version takes the data, lon and lat Arrays as separate arguments
  *
+ * The data are read once and each band (time step) is then scaled on its
+ * own; up to scale_3D_max_threads bands are scaled at the same time, each
+ * one written directly into the result Array.
+ *
  * @param data
  * @param time
  * @param lon
@@ -1173,26 +1439,105 @@ auto_ptr<GDALDataset> build_src_dataset_3D(Array *data, Array *t, Array *x, Arra
 Grid *scale_dap_array_3D(const Array *data, const Array *time, const Array *lon, const Array *lat, const SizeBox &size,
     const string &crs, const string &interp)
 {
-    // Build GDALDataset for Grid g with lon and lat maps as given
     Array *d = const_cast<Array*>(data);
     Array *t = const_cast<Array*>(time);
     Array *x = const_cast<Array*>(lon);
     Array *y = const_cast<Array*>(lat);
 
-    // get GDALDataset with bands
-    auto_ptr<GDALDataset> src = build_src_dataset_3D(d, const_cast<Array*>(t), const_cast<Array*>(x), const_cast<Array*>(y));
+    scale_3D_work work;
+    work.type = get_array_type(d);
+    work.src_size = get_size_box(x, y);
+    work.n_bands = t->length();
+    work.size = size;
+    work.crs = crs;
+    work.interp = interp;
+    work.no_data = get_missing_data_value(d);
+    work.geo_transform = get_geotransform_data(x, y);
 
-    // scale all bands to the new size, using optional CRS and interpolation params
-    auto_ptr<GDALDataset> dst = scale_dataset_3D(src, size, crs, interp);
+    unsigned long width = d->prototype()->width();
+    work.src_band_bytes = width * work.src_size.x_size * work.src_size.y_size;
+    work.dst_band_bytes = width * size.x_size * size.y_size;
+
+    OGRSpatialReference native_srs;
+    if (CE_None != native_srs.SetWellKnownGeogCS("WGS84")) {
+        string msg = "Could not set 'WGS84' as the dataset native CRS.";
+        BESDEBUG(DEBUG_KEY, "ERROR scale_dap_array_3D(): " << msg << endl);
+        throw BESError(msg, BES_SYNTAX_USER_ERROR, __FILE__, __LINE__);
+    }
+    char *pszSRS_WKT = NULL;
+    native_srs.exportToWkt(&pszSRS_WKT);
+    work.wkt = pszSRS_WKT;
+    CPLFree(pszSRS_WKT);
+
+    d->read();
+    d->set_read_p(true);
+    if ((unsigned long) d->length() < (unsigned long) work.n_bands * work.src_size.x_size * work.src_size.y_size) {
+        string msg = "The size of the array '" + d->name() + "' does not match its time, latitude and longitude maps.";
+        BESDEBUG(DEBUG_KEY, "ERROR scale_dap_array_3D(): " << msg << endl);
+        throw BESError(msg, BES_SYNTAX_USER_ERROR, __FILE__, __LINE__);
+    }
+    work.src = d->get_buf();
+
+    // The result Array; the bands write their values directly into it
+    auto_ptr<Array> built_data(new Array("result", d->var()->ptr_duplicate()));
+    built_data->append_dim(work.n_bands);
+    built_data->append_dim(size.y_size);
+    built_data->append_dim(size.x_size);
+    built_data->reserve_value_capacity(work.n_bands * size.x_size * size.y_size);
+    built_data->set_length(work.n_bands * size.x_size * size.y_size);
+    work.dst = built_data->get_buf();
+
+    if (pthread_mutex_init(&work.mutex, 0) != 0)
+        throw BESInternalError("Could not initialize the scale mutex.", __FILE__, __LINE__);
+
+    // Block all signals while the workers are made so that they inherit a
+    // mask that leaves SIGALRM, SIGPIPE, etc., to the main thread.
+    vector<pthread_t> threads;
+    unsigned int n_threads = min(scale_3D_max_threads, (unsigned int) work.n_bands);
+    if (n_threads > 1) {
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+
+        // This thread is one of the workers
+        for (unsigned int i = 1; i < n_threads; ++i) {
+            pthread_t thread;
+            int status = pthread_create(&thread, 0, scale_bands_worker, &work);
+            if (status != 0) {
+                // Scale with the threads we have
+                BESDEBUG(DEBUG_KEY, "scale_dap_array_3D() - Could not start a worker thread: " << strerror(status) << endl);
+                break;
+            }
+            threads.push_back(thread);
+        }
+
+        pthread_sigmask(SIG_SETMASK, &old, 0);
+    }
+
+    BESDEBUG(DEBUG_KEY, "scale_dap_array_3D() - scaling " << work.n_bands << " bands using " << threads.size() + 1
+        << " threads" << endl);
+
+    scale_bands(&work);
+
+    for (vector<pthread_t>::iterator i = threads.begin(), e = threads.end(); i != e; ++i)
+        pthread_join(*i, 0);
+
+    pthread_mutex_destroy(&work.mutex);
+
+    if (!work.error.empty()) {
+        BESDEBUG(DEBUG_KEY, "ERROR scale_dap_array_3D(): " << work.error << endl);
+        throw BESError(work.error, BES_INTERNAL_ERROR, __FILE__, __LINE__);
+    }
+
+    built_data->set_read_p(true);
 
-    // Build a result Grid: extract the data, build the maps and assemble
-    auto_ptr<Array> built_data(build_array_from_gdal_dataset_3D(dst.get(), d));
     auto_ptr<Array> built_time(new Array(t->name(), new Float32(t->name())));
     auto_ptr<Array> built_lat(new Array(y->name(), new Float32(y->name())));
     auto_ptr<Array> built_lon(new Array(x->name(), new Float32(x->name())));
 
-    // Build maps for grid
-    build_maps_from_gdal_dataset_3D(dst.get(), t, built_time.get(), built_lon.get(), built_lat.get());
+    // Build maps for grid; every band has the same geo-transform
+    if (work.first_dst.get())
+        build_maps_from_gdal_dataset_3D(work.first_dst.get(), t, built_time.get(), built_lon.get(), built_lat.get());
 
     // get result Grid
     auto_ptr<Grid> result(new Grid(d->name()));
@@ -1205,4 +1550,3 @@ Grid *scale_dap_array_3D(const Array *data, const Array *time, const Array *lon,
 }
 
 }
-
@@ -0,0 +1,409 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Tests for the CoordinateMapIndex class.
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <Array.h>
+#include <Float64.h>
+#include <Error.h>
+#include <GetOpt.h>
+#include <debug.h>
+
+#include "CoordinateMapIndex.h"
+#include "test_config.h"
+
+using namespace CppUnit;
+using namespace libdap;
+using namespace std;
+using namespace functions;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+namespace functions {
+
+static const relop ops[] = { dods_greater_op, dods_greater_equal_op, dods_less_op, dods_less_equal_op,
+    dods_equal_op, dods_not_equal_op };
+
+static bool compare(double elem, relop op, double value)
+{
+    switch (op) {
+    case dods_greater_op: return elem > value;
+    case dods_greater_equal_op: return elem >= value;
+    case dods_less_op: return elem < value;
+    case dods_less_equal_op: return elem <= value;
+    case dods_equal_op: return elem == value;
+    case dods_not_equal_op: return elem != value;
+    default: return false;
+    }
+}
+
+// A map in a file: read() sets the 'file' values and counts the reads
+class FileMap: public Array {
+private:
+    vector<dods_float64> d_file_values;
+
+public:
+    int reads;
+
+    FileMap(const string &dataset, const vector<dods_float64> &values) :
+        Array("lat", dataset, new Float64("lat")), d_file_values(values), reads(0)
+    {
+        append_dim(values.size(), "lat");
+    }
+
+    virtual BaseType *ptr_duplicate()
+    {
+        return new FileMap(*this);
+    }
+
+    virtual bool read()
+    {
+        ++reads;
+        set_value(d_file_values, d_file_values.size());
+        set_read_p(true);
+        return true;
+    }
+};
+
+class CoordinateMapIndexTest: public TestFixture {
+private:
+    // The scans GSEClause and GeoConstraint used before the index
+    static int scan_first(const vector<double> &v, relop op, double value, int from, int to)
+    {
+        int i = from;
+        while (i <= to && !compare(v[i], op, value))
+            ++i;
+        return i;
+    }
+
+    static int scan_last(const vector<double> &v, relop op, double value, int from, int to)
+    {
+        int i = to;
+        while (i >= from && !compare(v[i], op, value))
+            --i;
+        return i;
+    }
+
+    // Compare the index with the scans for values inside, outside and on
+    // the map's values, for every operator and several sub-ranges
+    void check(const vector<double> &values)
+    {
+        CoordinateMapIndex index(values);
+        int n = values.size();
+
+        vector<double> probes(values);
+        probes.push_back(-1000.0);
+        probes.push_back(1000.0);
+        for (int i = 0; i + 1 < n; ++i)
+            probes.push_back((values[i] + values[i + 1]) / 2.0);
+
+        for (vector<double>::iterator p = probes.begin(), e = probes.end(); p != e; ++p) {
+            if (std::isnan(*p)) continue;
+            for (unsigned int o = 0; o < sizeof(ops) / sizeof(relop); ++o) {
+                for (int from = 0; from <= n; from += (n > 4) ? n / 4 : 1) {
+                    int to = n - 1 - from / 2;
+                    DBG(cerr << "value: " << *p << ", op: " << ops[o] << ", [" << from << ", " << to << "]" << endl);
+                    CPPUNIT_ASSERT_EQUAL(scan_first(values, ops[o], *p, from, to), index.first(ops[o], *p, from, to));
+                    CPPUNIT_ASSERT_EQUAL(scan_last(values, ops[o], *p, from, to), index.last(ops[o], *p, from, to));
+                    CPPUNIT_ASSERT_EQUAL(scan_last(values, ops[o], *p, 0, to), index.last(ops[o], *p, 0, to));
+                }
+            }
+        }
+    }
+
+public:
+    CoordinateMapIndexTest()
+    {
+    }
+
+    ~CoordinateMapIndexTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+        CoordinateMapIndex::clear_cache();
+    }
+
+    CPPUNIT_TEST_SUITE( CoordinateMapIndexTest );
+
+    CPPUNIT_TEST(increasing_uniform_test);
+    CPPUNIT_TEST(decreasing_uniform_test);
+    CPPUNIT_TEST(monotonic_test);
+    CPPUNIT_TEST(not_monotonic_test);
+    CPPUNIT_TEST(constant_test);
+    CPPUNIT_TEST(small_test);
+    CPPUNIT_TEST(is_uniform_test);
+    CPPUNIT_TEST(nop_test);
+    CPPUNIT_TEST(cached_map_test);
+    CPPUNIT_TEST(in_memory_map_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void increasing_uniform_test()
+    {
+        vector<double> values;
+        for (int i = 0; i < 360; ++i)
+            values.push_back(0.5 + i);
+
+        CoordinateMapIndex index(values);
+        CPPUNIT_ASSERT(index.get_direction() == CoordinateMapIndex::increasing);
+        CPPUNIT_ASSERT(index.is_uniform());
+        CPPUNIT_ASSERT(index.get_resolution() == 1.0);
+        CPPUNIT_ASSERT(index.get_min() == 0.5);
+        CPPUNIT_ASSERT(index.get_max() == 359.5);
+
+        CPPUNIT_ASSERT_EQUAL(40, index.first(dods_greater_equal_op, 40.0, 0, 359));
+        CPPUNIT_ASSERT_EQUAL(199, index.last(dods_less_equal_op, 200.0, 0, 359));
+
+        check(values);
+    }
+
+    void decreasing_uniform_test()
+    {
+        // latitude, north to south
+        vector<double> values;
+        for (int i = 0; i < 180; ++i)
+            values.push_back(89.5 - i);
+
+        CoordinateMapIndex index(values);
+        CPPUNIT_ASSERT(index.get_direction() == CoordinateMapIndex::decreasing);
+        CPPUNIT_ASSERT(index.is_uniform());
+        CPPUNIT_ASSERT(index.get_resolution() == -1.0);
+        CPPUNIT_ASSERT(index.get_min() == -89.5);
+        CPPUNIT_ASSERT(index.get_max() == 89.5);
+
+        check(values);
+    }
+
+    void monotonic_test()
+    {
+        // Gaussian-ish latitudes; monotonic but not uniform
+        double v[] = { -88.5, -80.0, -71.2, -50.0, -10.0, -9.5, 0.0, 0.0, 3.0, 45.0, 46.0, 89.0 };
+        vector<double> values(v, v + sizeof(v) / sizeof(double));
+
+        CoordinateMapIndex index(values);
+        CPPUNIT_ASSERT(index.is_monotonic());
+        CPPUNIT_ASSERT(!index.is_uniform());
+
+        check(values);
+
+        vector<double> reversed(values.rbegin(), values.rend());
+        CoordinateMapIndex r_index(reversed);
+        CPPUNIT_ASSERT(r_index.get_direction() == CoordinateMapIndex::decreasing);
+
+        check(reversed);
+    }
+
+    void not_monotonic_test()
+    {
+        // An offset longitude axis and one with a missing value
+        double v[] = { 200, 240, 280, 320, 0, 40, 80, 120, 160 };
+        vector<double> values(v, v + sizeof(v) / sizeof(double));
+
+        CoordinateMapIndex index(values);
+        CPPUNIT_ASSERT(!index.is_monotonic());
+        CPPUNIT_ASSERT(!index.is_uniform());
+        CPPUNIT_ASSERT(index.get_min() == 0);
+        CPPUNIT_ASSERT(index.get_max() == 320);
+
+        check(values);
+
+        double w[] = { 0, 1, 2, numeric_limits<double>::quiet_NaN(), 4, 5 };
+        vector<double> nan_values(w, w + sizeof(w) / sizeof(double));
+
+        CoordinateMapIndex nan_index(nan_values);
+        CPPUNIT_ASSERT(!nan_index.is_monotonic());
+        CPPUNIT_ASSERT(nan_index.get_max() == 5);
+
+        check(nan_values);
+    }
+
+    void constant_test()
+    {
+        vector<double> values(10, 7.0);
+
+        CoordinateMapIndex index(values);
+        CPPUNIT_ASSERT(index.is_monotonic());
+        CPPUNIT_ASSERT(index.get_resolution() == 0);
+
+        check(values);
+    }
+
+    void small_test()
+    {
+        vector<double> values(1, 3.0);
+        CoordinateMapIndex index(values);
+        CPPUNIT_ASSERT(index.is_monotonic());
+        CPPUNIT_ASSERT(index.is_uniform());
+
+        check(values);
+
+        vector<double> empty;
+        CoordinateMapIndex e_index(empty);
+        CPPUNIT_ASSERT(!e_index.is_monotonic());
+        CPPUNIT_ASSERT_EQUAL(0, e_index.first(dods_equal_op, 1.0, 0, -1));
+        CPPUNIT_ASSERT_EQUAL(-1, e_index.last(dods_equal_op, 1.0, 0, -1));
+    }
+
+    void is_uniform_test()
+    {
+        double v[] = { 1.0, 1.5, 2.0, 2.5 };
+        vector<double> values(v, v + sizeof(v) / sizeof(double));
+        CPPUNIT_ASSERT(CoordinateMapIndex::is_uniform(values, 0.5));
+        CPPUNIT_ASSERT(!CoordinateMapIndex::is_uniform(values, 0.25));
+
+        values[2] = 2.1;
+        CPPUNIT_ASSERT(!CoordinateMapIndex::is_uniform(values, 0.5));
+
+        CPPUNIT_ASSERT(CoordinateMapIndex::is_uniform(vector<double>(), 0.5));
+    }
+
+    void nop_test()
+    {
+        vector<double> values(4, 1.0);
+        CoordinateMapIndex index(values);
+
+        CPPUNIT_ASSERT_THROW(index.first(dods_nop_op, 1.0, 0, 3), Error);
+        CPPUNIT_ASSERT_THROW(index.last(dods_nop_op, 1.0, 0, 3), Error);
+    }
+
+    // An unread map from a file is read once; after that its index is cached
+    void cached_map_test()
+    {
+        vector<dods_float64> values;
+        for (int i = 0; i < 10; ++i)
+            values.push_back(i);
+
+        FileMap map(string(TEST_SRC_DIR) + "/CoordinateMapIndexTest.cc", values);
+        CoordinateMapIndex index = CoordinateMapIndex::get(&map);
+        CPPUNIT_ASSERT(map.reads == 1);
+        CPPUNIT_ASSERT(index.get_values() == vector<double>(values.begin(), values.end()));
+
+        FileMap map2(string(TEST_SRC_DIR) + "/CoordinateMapIndexTest.cc", values);
+        index = CoordinateMapIndex::get(&map2);
+        CPPUNIT_ASSERT(map2.reads == 0);
+        CPPUNIT_ASSERT(index.get_values() == vector<double>(values.begin(), values.end()));
+    }
+
+    // Maps that hold values set in memory (e.g., those of a Grid returned by
+    // geogrid()) share the dataset and name of the file's map, but their
+    // values are their own
+    void in_memory_map_test()
+    {
+        vector<dods_float64> values;
+        for (int i = 0; i < 10; ++i)
+            values.push_back(i);
+
+        FileMap map(string(TEST_SRC_DIR) + "/CoordinateMapIndexTest.cc", values);
+        CoordinateMapIndex index = CoordinateMapIndex::get(&map);
+        CPPUNIT_ASSERT(index.get_direction() == CoordinateMapIndex::increasing);
+
+        // Two calls with different values under the same name
+        vector<dods_float64> first(values.rbegin(), values.rend());
+        FileMap map2(string(TEST_SRC_DIR) + "/CoordinateMapIndexTest.cc", values);
+        map2.set_value(first, first.size());
+        map2.set_read_p(true);
+        CoordinateMapIndex index2 = CoordinateMapIndex::get(&map2);
+        CPPUNIT_ASSERT(map2.reads == 0);
+        CPPUNIT_ASSERT(index2.get_direction() == CoordinateMapIndex::decreasing);
+        CPPUNIT_ASSERT_EQUAL(9, index2.first(dods_less_op, 1.0, 0, 9));
+
+        vector<dods_float64> second(10, 5.0);
+        map2.set_value(second, second.size());
+        CoordinateMapIndex index3 = CoordinateMapIndex::get(&map2);
+        CPPUNIT_ASSERT(index3.get_direction() != CoordinateMapIndex::decreasing);
+        CPPUNIT_ASSERT_EQUAL(0, index3.first(dods_equal_op, 5.0, 0, 9));
+
+        // The first index is unchanged and the in-memory values were not cached
+        CPPUNIT_ASSERT(index.get_values() == vector<double>(values.begin(), values.end()));
+        FileMap map3(string(TEST_SRC_DIR) + "/CoordinateMapIndexTest.cc", values);
+        CoordinateMapIndex index4 = CoordinateMapIndex::get(&map3);
+        CPPUNIT_ASSERT(map3.reads == 0);
+        CPPUNIT_ASSERT(index4.get_direction() == CoordinateMapIndex::increasing);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CoordinateMapIndexTest);
+
+} // namespace functions
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    char option_char;
+    while ((option_char = getopt()) != EOF)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: CoordinateMapIndexTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = CoordinateMapIndexTest::suite()->getTests();
+            unsigned int prefix_len = CoordinateMapIndexTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = CoordinateMapIndexTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+            ++i;
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -24,12 +24,15 @@
 
 // Tests for the AISResources class.
 
+#include <memory>
+
 #include <cppunit/TextTestRunner.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
 #include <cppunit/extensions/HelperMacros.h>
 
 #include <BaseType.h>
 #include <Int32.h>
+#include <UInt16.h>
 #include <Float64.h>
 #include <Str.h>
 #include <Array.h>
@@ -62,6 +65,48 @@ static bool debug2 = false;
 
 namespace functions {
 
+// An Array that holds all of its values and, like a handler, returns the
+// hyperslab selected by its constraint when it is read. The longitude range
+// of each read is recorded. The array is [lat][lon].
+class HyperslabArray: public Array {
+private:
+    vector<dods_uint16> d_values;
+
+public:
+    vector<pair<int, int> > d_lon_reads;
+
+    HyperslabArray(const string &name, const vector<dods_uint16> &values) :
+        Array(name, new UInt16(name)), d_values(values)
+    {
+    }
+
+    virtual BaseType *ptr_duplicate()
+    {
+        return new HyperslabArray(*this);
+    }
+
+    virtual bool read()
+    {
+        if (read_p()) return true;
+
+        Dim_iter lat = dim_begin();
+        Dim_iter lon = dim_begin() + 1;
+        int lon_size = dimension_size(lon, false);
+
+        vector<dods_uint16> slab;
+        for (int r = dimension_start(lat, true); r <= dimension_stop(lat, true); r += dimension_stride(lat, true))
+            for (int c = dimension_start(lon, true); c <= dimension_stop(lon, true); c += dimension_stride(lon, true))
+                slab.push_back(d_values[r * lon_size + c]);
+
+        d_lon_reads.push_back(make_pair(dimension_start(lon, true), dimension_stop(lon, true)));
+
+        set_value(slab, slab.size());
+        set_read_p(true);
+
+        return true;
+    }
+};
+
 class GridGeoConstraintTest: public TestFixture {
 private:
     TestTypeFactory btf;
@@ -71,6 +116,73 @@ private:
     DDS *geo_dds_3d;
     DDS *geo_dds_coads_lon;
 
+    // Build a [lat][lon] Grid whose longitudes start at zero and go up by
+    // lon_step; the value at [r][c] is c + 2000 * r
+    Grid *make_wrap_grid(vector<dods_float64> &lats, int lon_size, double lon_step, HyperslabArray **data)
+    {
+        vector<dods_uint16> values;
+        for (unsigned int r = 0; r < lats.size(); ++r)
+            for (int c = 0; c < lon_size; ++c)
+                values.push_back(c + 2000 * r);
+
+        *data = new HyperslabArray("SST", values);
+        (*data)->append_dim(lats.size(), "lat");
+        (*data)->append_dim(lon_size, "lon");
+
+        Grid *g = new Grid("SST");
+        g->add_var_nocopy(*data, libdap::array);
+
+        Array *lat = new Array("lat", new Float64("lat"));
+        lat->append_dim(lats.size(), "lat");
+        lat->set_value(lats, lats.size());
+        lat->set_read_p(true);
+        g->add_var_nocopy(lat, maps);
+
+        vector<dods_float64> lons;
+        for (int c = 0; c < lon_size; ++c)
+            lons.push_back(c * lon_step);
+        Array *lon = new Array("lon", new Float64("lon"));
+        lon->append_dim(lon_size, "lon");
+        lon->set_value(lons, lons.size());
+        lon->set_read_p(true);
+        g->add_var_nocopy(lon, maps);
+
+        g->set_send_p(true);
+
+        return g;
+    }
+
+    // Apply a bounding box that wraps around the edge of the longitude map
+    // and check that each row of the data holds columns left..lon_size-1
+    // and then 0..right, with the longitude map in the same order
+    void check_wrap_around(Grid *g, HyperslabArray *data, double top, double left, double bottom, double right,
+        int first_row, int rows, int lon_size, double lon_step, int left_index, int right_index)
+    {
+        GridGeoConstraint gc(g);
+        gc.set_bounding_box(top, left, bottom, right);
+        gc.apply_constraint_to_data();
+
+        int columns = lon_size - left_index + right_index + 1;
+        CPPUNIT_ASSERT(gc.d_latitude->length() == rows);
+        CPPUNIT_ASSERT(gc.d_longitude->length() == columns);
+
+        vector<dods_float64> lons(columns);
+        gc.d_longitude->value(&lons[0]);
+
+        vector<dods_uint16> values(rows * columns);
+        CPPUNIT_ASSERT(data->length() == rows * columns);
+        data->value(&values[0]);
+
+        for (int i = 0; i < columns; ++i) {
+            int c = (left_index + i) % lon_size;
+            CPPUNIT_ASSERT(lons[i] == c * lon_step);
+            for (int r = 0; r < rows; ++r) {
+                DBG2(cerr << "[" << r << "][" << i << "]: " << values[r * columns + i] << endl);
+                CPPUNIT_ASSERT(values[r * columns + i] == c + 2000 * (first_row + r));
+            }
+        }
+    }
+
 public:
     GridGeoConstraintTest() :
         geo_dds(0), geo_dds_3d(0), geo_dds_coads_lon(0)
@@ -261,6 +373,10 @@ CPPUNIT_TEST_SUITE( GridGeoConstraintTest );
     CPPUNIT_TEST(apply_constriant_to_data_test3_three_arg);
     CPPUNIT_TEST(apply_constriant_to_data_test4_three_arg);
 
+    CPPUNIT_TEST(wrap_around_small_gap_test);
+    CPPUNIT_TEST(wrap_around_wide_gap_test);
+    CPPUNIT_TEST(wrap_around_large_gap_test);
+
     CPPUNIT_TEST_SUITE_END()
     ;
 
@@ -1242,6 +1358,70 @@ CPPUNIT_TEST_SUITE( GridGeoConstraintTest );
         }
     }
 
+    // One column lies between the halves of the box, so both halves are read
+    // with one hyperslab
+    void wrap_around_small_gap_test()
+    {
+        try {
+            dods_float64 tmp_lats[6] = { 50, 30, 10, -10, -30, -50 };
+            vector<dods_float64> lats(tmp_lats, tmp_lats + 6);
+            HyperslabArray *data;
+            auto_ptr<Grid> g(make_wrap_grid(lats, 12, 30.0, &data));
+
+            // lon: 0, 30, ..., 330; left is index 4, right is index 2
+            check_wrap_around(g.get(), data, 30, 120, 10, 60, 1, 2, 12, 30.0, 4, 2);
+
+            CPPUNIT_ASSERT(data->d_lon_reads.size() == 1);
+            CPPUNIT_ASSERT(data->d_lon_reads[0] == make_pair(0, 11));
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message());
+        }
+    }
+
+    // Most of the row lies between the halves, so they are read separately
+    void wrap_around_wide_gap_test()
+    {
+        try {
+            dods_float64 tmp_lats[6] = { 50, 30, 10, -10, -30, -50 };
+            vector<dods_float64> lats(tmp_lats, tmp_lats + 6);
+            HyperslabArray *data;
+            auto_ptr<Grid> g(make_wrap_grid(lats, 12, 30.0, &data));
+
+            // left is index 10, right is index 1
+            check_wrap_around(g.get(), data, 50, 300, 30, 30, 0, 2, 12, 30.0, 10, 1);
+
+            CPPUNIT_ASSERT(data->d_lon_reads.size() == 2);
+            CPPUNIT_ASSERT(data->d_lon_reads[0] == make_pair(10, 11));
+            CPPUNIT_ASSERT(data->d_lon_reads[1] == make_pair(0, 1));
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message());
+        }
+    }
+
+    // The columns between the halves are fewer than the halves but more
+    // than MAX_LONGITUDE_GAP_BYTES, so they are not read
+    void wrap_around_large_gap_test()
+    {
+        try {
+            dods_float64 tmp_lats[2] = { 10, -10 };
+            vector<dods_float64> lats(tmp_lats, tmp_lats + 2);
+            HyperslabArray *data;
+            auto_ptr<Grid> g(make_wrap_grid(lats, 1440, 0.25, &data));
+
+            // left is index 800, right is index 200; 599 columns of two
+            // bytes lie between them
+            check_wrap_around(g.get(), data, 10, 200, -10, 50, 0, 2, 1440, 0.25, 800, 200);
+
+            CPPUNIT_ASSERT(data->d_lon_reads.size() == 2);
+            CPPUNIT_ASSERT(data->d_lon_reads[0] == make_pair(800, 1439));
+            CPPUNIT_ASSERT(data->d_lon_reads[1] == make_pair(0, 200));
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message());
+        }
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(GridGeoConstraintTest);
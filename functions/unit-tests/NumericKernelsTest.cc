@@ -0,0 +1,244 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Tests for the loops in numeric_kernels.h
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <GetOpt.h>
+
+#include "numeric_kernels.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace functions;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+namespace functions {
+
+class NumericKernelsTest: public TestFixture {
+private:
+    template<typename T>
+    void check_min_max(const vector<T> &data, bool use_missing, T missing, double min_val, double max_val,
+        bool monotonic)
+    {
+        double lo = 0, hi = 0;
+        bool mono = !monotonic;
+        min_max_kernel(&data[0], data.size(), use_missing, missing, lo, hi, mono);
+
+        DBG(cerr << "min: " << lo << ", max: " << hi << ", monotonic: " << mono << endl);
+
+        CPPUNIT_ASSERT(lo == min_val);
+        CPPUNIT_ASSERT(hi == max_val);
+        CPPUNIT_ASSERT(mono == monotonic);
+    }
+
+public:
+    NumericKernelsTest()
+    {
+    }
+
+    ~NumericKernelsTest()
+    {
+    }
+
+    CPPUNIT_TEST_SUITE( NumericKernelsTest );
+
+    CPPUNIT_TEST(native_missing_value_test);
+    CPPUNIT_TEST(linear_scale_test);
+    CPPUNIT_TEST(linear_scale_missing_test);
+    CPPUNIT_TEST(min_max_test);
+    CPPUNIT_TEST(min_max_missing_test);
+    CPPUNIT_TEST(min_max_nan_test);
+    CPPUNIT_TEST(mask_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void native_missing_value_test()
+    {
+        short s;
+        CPPUNIT_ASSERT(native_missing_value(-32767.0, s));
+        CPPUNIT_ASSERT(s == -32767);
+        CPPUNIT_ASSERT(!native_missing_value(40000.0, s));
+        CPPUNIT_ASSERT(!native_missing_value(0.5, s));
+
+        unsigned char b;
+        CPPUNIT_ASSERT(native_missing_value(255.0, b));
+        CPPUNIT_ASSERT(!native_missing_value(-9999.0, b));
+
+        int i;
+        CPPUNIT_ASSERT(native_missing_value(2147483647.0, i));
+        CPPUNIT_ASSERT(i == numeric_limits<int>::max());
+        CPPUNIT_ASSERT(!native_missing_value(2147483648.0, i));
+
+        float f;
+        CPPUNIT_ASSERT(native_missing_value(-9999.0, f));
+        CPPUNIT_ASSERT(f == -9999.0f);
+        CPPUNIT_ASSERT(!native_missing_value(1.0e300, f));
+        CPPUNIT_ASSERT(!native_missing_value(numeric_limits<double>::quiet_NaN(), f));
+    }
+
+    void linear_scale_test()
+    {
+        short src[] = { -2, -1, 0, 1, 2, 32767 };
+        double dest[6];
+        linear_scale_kernel(src, dest, 6, 0.5, 10.0);
+
+        for (int i = 0; i < 6; ++i) {
+            DBG(cerr << "dest[" << i << "]: " << dest[i] << endl);
+            CPPUNIT_ASSERT(dest[i] == src[i] * 0.5 + 10.0);
+        }
+    }
+
+    void linear_scale_missing_test()
+    {
+        float src[] = { 1.0f, -9999.0f, 3.0f, -9999.0f };
+        double dest[4];
+        linear_scale_kernel(src, dest, 4, 2.0, 1.0, -9999.0f);
+
+        CPPUNIT_ASSERT(dest[0] == 3.0);
+        CPPUNIT_ASSERT(dest[1] == -9999.0);
+        CPPUNIT_ASSERT(dest[2] == 7.0);
+        CPPUNIT_ASSERT(dest[3] == -9999.0);
+    }
+
+    void min_max_test()
+    {
+        vector<short> up;
+        for (short i = -100; i < 100; ++i)
+            up.push_back(i);
+        check_min_max(up, false, short(0), -100.0, 99.0, true);
+
+        vector<short> down(up.rbegin(), up.rend());
+        check_min_max(down, false, short(0), -100.0, 99.0, true);
+
+        vector<short> bump(up);
+        bump[50] = 120;
+        check_min_max(bump, false, short(0), -100.0, 120.0, false);
+
+        vector<unsigned char> one(1, 7);
+        check_min_max(one, false, (unsigned char) 0, 7.0, 7.0, true);
+    }
+
+    void min_max_missing_test()
+    {
+        float values[] = { -9999.0f, 1.0f, 2.0f, -9999.0f, 3.0f, 4.0f };
+        vector<float> data(values, values + 6);
+        check_min_max(data, true, -9999.0f, 1.0, 4.0, true);
+        check_min_max(data, false, -9999.0f, -9999.0, 4.0, false);
+
+        data[5] = 0.5f;
+        check_min_max(data, true, -9999.0f, 0.5, 3.0, false);
+
+        // All missing; min and max are not changed
+        vector<float> missing(4, -9999.0f);
+        double lo = 1.0, hi = 2.0;
+        bool mono;
+        min_max_kernel(&missing[0], missing.size(), true, -9999.0f, lo, hi, mono);
+        CPPUNIT_ASSERT(lo == 1.0 && hi == 2.0);
+    }
+
+    void min_max_nan_test()
+    {
+        double values[] = { 5.0, numeric_limits<double>::quiet_NaN(), -5.0, 2.0 };
+        vector<double> data(values, values + 4);
+
+        double lo = 0, hi = 0;
+        bool mono;
+        min_max_kernel(&data[0], data.size(), false, 0.0, lo, hi, mono);
+        CPPUNIT_ASSERT(lo == -5.0);
+        CPPUNIT_ASSERT(hi == 5.0);
+    }
+
+    void mask_test()
+    {
+        int data[] = { 1, 2, 3, 4, 5 };
+        unsigned char mask[] = { 1, 0, 1, 0, 0 };
+        mask_kernel(data, mask, 5, -1);
+
+        CPPUNIT_ASSERT(data[0] == 1);
+        CPPUNIT_ASSERT(data[1] == -1);
+        CPPUNIT_ASSERT(data[2] == 3);
+        CPPUNIT_ASSERT(data[3] == -1);
+        CPPUNIT_ASSERT(data[4] == -1);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(NumericKernelsTest);
+
+} // namespace functions
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    char option_char;
+    while ((option_char = getopt()) != EOF)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: NumericKernelsTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = NumericKernelsTest::suite()->getTests();
+            unsigned int prefix_len = NumericKernelsTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = NumericKernelsTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+            ++i;
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
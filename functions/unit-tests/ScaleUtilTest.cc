@@ -76,6 +76,49 @@ using namespace std;
 
 int test_variable_sleep_interval = 0;
 
+// A one or two dimensional Float32 Array that reads the values selected by
+// its constraint from a copy of all its values, the way a handler would
+class SourceArray: public Array {
+private:
+    vector<dods_float32> d_values;
+
+public:
+    SourceArray(const string &name, const vector<dods_float32> &values) :
+        Array(name, new Float32(name)), d_values(values)
+    {
+    }
+
+    virtual BaseType *ptr_duplicate()
+    {
+        return new SourceArray(*this);
+    }
+
+    virtual bool read()
+    {
+        if (read_p()) return true;
+
+        // For a vector, read the one 'row'
+        Dim_iter x = dim_end() - 1;
+        int x_size = dimension_size(x, false);
+        int first_row = 0, last_row = 0, row_stride = 1;
+        if (dimensions() > 1) {
+            first_row = dimension_start(dim_begin(), true);
+            last_row = dimension_stop(dim_begin(), true);
+            row_stride = dimension_stride(dim_begin(), true);
+        }
+
+        vector<dods_float32> slab;
+        for (int r = first_row; r <= last_row; r += row_stride)
+            for (int c = dimension_start(x, true); c <= dimension_stop(x, true); c += dimension_stride(x, true))
+                slab.push_back(d_values[r * x_size + c]);
+
+        set_value(slab, slab.size());
+        set_read_p(true);
+
+        return true;
+    }
+};
+
 class ScaleUtilTest: public TestFixture {
 private:
     DDS *small_dds;
@@ -633,6 +676,106 @@ public:
         CPPUNIT_ASSERT(buf_lat == orig_lat);
     }
 
+    // Build a [lat][lon] source with uniform maps; if 'read' is true, read
+    // it all before it is scaled so that none of it is read with a stride
+    void make_source(int lon_size, int lat_size, bool read, auto_ptr<Array> &data, auto_ptr<Array> &lon,
+        auto_ptr<Array> &lat)
+    {
+        vector<dods_float32> values;
+        for (int r = 0; r < lat_size; ++r)
+            for (int c = 0; c < lon_size; ++c)
+                values.push_back(r * lon_size + c);
+        data.reset(new SourceArray("data", values));
+        data->append_dim(lat_size, "lat");
+        data->append_dim(lon_size, "lon");
+
+        vector<dods_float32> lons;
+        for (int c = 0; c < lon_size; ++c)
+            lons.push_back(-10.0 + c * 0.5);
+        lon.reset(new SourceArray("lon", lons));
+        lon->append_dim(lon_size, "lon");
+
+        vector<dods_float32> lats;
+        for (int r = 0; r < lat_size; ++r)
+            lats.push_back(16.0 - r);
+        lat.reset(new SourceArray("lat", lats));
+        lat->append_dim(lat_size, "lat");
+
+        if (read) {
+            data->read();
+            lon->read();
+            lat->read();
+        }
+    }
+
+    static vector<dods_float32> map_values(Grid *g, int i)
+    {
+        Array *map = static_cast<Array*>(*(g->map_begin() + i));
+        vector<dods_float32> values(map->length());
+        map->value(&values[0]);
+        return values;
+    }
+
+    // Scaling a source that has not been read uses a strided subset of it.
+    // The maps, and so the geotransform they were built from, must match
+    // those made when all the source was used. The sizes here are not
+    // multiples of the strides.
+    void test_scale_strided_source()
+    {
+        const char *interps[] = { "nearest", "bilinear" };
+
+        for (int i = 0; i < 2; ++i) {
+            try {
+                const int lon_size = 41, lat_size = 33;
+                SizeBox size(10, 8);
+
+                auto_ptr<Array> data, lon, lat;
+                make_source(lon_size, lat_size, true, data, lon, lat);
+                auto_ptr<Grid> full(scale_dap_array(data.get(), lon.get(), lat.get(), size, "WGS84", interps[i]));
+
+                make_source(lon_size, lat_size, false, data, lon, lat);
+                auto_ptr<Grid> strided(scale_dap_array(data.get(), lon.get(), lat.get(), size, "WGS84", interps[i]));
+
+                // Only copies of the source were read
+                CPPUNIT_ASSERT(!data->read_p());
+
+                CPPUNIT_ASSERT(strided->get_array()->length() == size.x_size * size.y_size);
+                CPPUNIT_ASSERT(strided->get_array()->length() == full->get_array()->length());
+
+                // The first map is lat, the second lon
+                vector<dods_float32> full_lat = map_values(full.get(), 0);
+                vector<dods_float32> strided_lat = map_values(strided.get(), 0);
+                vector<dods_float32> full_lon = map_values(full.get(), 1);
+                vector<dods_float32> strided_lon = map_values(strided.get(), 1);
+
+                if (debug) {
+                    cerr << interps[i] << " full lon: ";
+                    copy(full_lon.begin(), full_lon.end(), ostream_iterator<double>(cerr, " "));
+                    cerr << endl << interps[i] << " strided lon: ";
+                    copy(strided_lon.begin(), strided_lon.end(), ostream_iterator<double>(cerr, " "));
+                    cerr << endl;
+                }
+
+                CPPUNIT_ASSERT(full_lat.size() == (unsigned long) size.y_size);
+                CPPUNIT_ASSERT(strided_lat.size() == full_lat.size());
+                CPPUNIT_ASSERT(equal(strided_lat.begin(), strided_lat.end(), full_lat.begin(), same_as));
+
+                CPPUNIT_ASSERT(full_lon.size() == (unsigned long) size.x_size);
+                CPPUNIT_ASSERT(strided_lon.size() == full_lon.size());
+                CPPUNIT_ASSERT(equal(strided_lon.begin(), strided_lon.end(), full_lon.begin(), same_as));
+
+                // The geotransform: same origin and the pixel size of the full source
+                CPPUNIT_ASSERT(same_as(strided_lon[0], -10.0));
+                CPPUNIT_ASSERT(same_as(strided_lon[1] - strided_lon[0], 0.5 * lon_size / size.x_size));
+                CPPUNIT_ASSERT(same_as(strided_lat[0], 16.0));
+                CPPUNIT_ASSERT(same_as(strided_lat[1] - strided_lat[0], -1.0 * lat_size / size.y_size));
+            }
+            catch (Error &e) {
+                CPPUNIT_FAIL(e.get_error_message());
+            }
+        }
+    }
+
     CPPUNIT_TEST_SUITE( ScaleUtilTest );
 
     CPPUNIT_TEST(test_reading_data);
@@ -644,6 +787,7 @@ public:
     CPPUNIT_TEST(test_scaling_with_gdal);
     CPPUNIT_TEST(test_build_array_from_gdal_dataset);
     CPPUNIT_TEST(test_build_maps_from_gdal_dataset);
+    CPPUNIT_TEST(test_scale_strided_source);
 
     CPPUNIT_TEST(test_get_gcp_data);
 
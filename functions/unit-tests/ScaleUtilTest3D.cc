@@ -36,6 +36,8 @@
 #include <vector>
 
 #include <cmath>
+#include <cstring>
+#include <memory>
 
 #include <gdal.h>
 #include <gdal_priv.h>
@@ -673,6 +675,38 @@ public:
         }
     }
 
+    // The bands are scaled by several threads; the result must not depend
+    // on how many there are.
+    void test_scaling_dap_array_3D_threads()
+    {
+        try {
+            Array *data = dynamic_cast<Array*>(test3D_dds->var("data"));
+            Array *t = dynamic_cast<Array*>(test3D_dds->var("time"));
+            Array *lon = dynamic_cast<Array*>(test3D_dds->var("lon"));
+            Array *lat = dynamic_cast<Array*>(test3D_dds->var("lat"));
+
+            SizeBox size(10, 7);
+
+            set_scale_3D_max_threads(1);
+            auto_ptr<Grid> serial(scale_dap_array_3D(data, t, lon, lat, size, "WGS84", "nearest"));
+
+            set_scale_3D_max_threads(4);
+            auto_ptr<Grid> parallel(scale_dap_array_3D(data, t, lon, lat, size, "WGS84", "nearest"));
+
+            Array *s = serial->get_array();
+            Array *p = parallel->get_array();
+            CPPUNIT_ASSERT(s->length() == t->length() * 10 * 7);
+            CPPUNIT_ASSERT(p->length() == s->length());
+            CPPUNIT_ASSERT(memcmp(s->get_buf(), p->get_buf(), s->length() * s->prototype()->width()) == 0);
+
+            Array *s_time = dynamic_cast<Array*>(*serial->map_begin());
+            CPPUNIT_ASSERT(s_time && s_time->length() == t->length());
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message());
+        }
+    }
+
 
 CPPUNIT_TEST_SUITE( ScaleUtilTest3D );
 
@@ -682,6 +716,7 @@ CPPUNIT_TEST_SUITE( ScaleUtilTest3D );
     CPPUNIT_TEST(test_build_array_from_gdal_dataset_3D);
     CPPUNIT_TEST(test_build_maps_from_gdal_dataset_3D);
     CPPUNIT_TEST(test_scaling_dap_array_3D);
+    CPPUNIT_TEST(test_scaling_dap_array_3D_threads);
 
     CPPUNIT_TEST_SUITE_END()
     ;
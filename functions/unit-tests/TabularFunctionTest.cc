@@ -25,6 +25,7 @@
 // Tests for the AISResources class.
 
 #include <iterator>
+#include <memory>
 
 #include <cppunit/TextTestRunner.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
@@ -48,6 +49,7 @@
 #include <test_config.h>
 
 #include "TabularFunction.h"
+#include "TabularSequence.h"
 
 using namespace CppUnit;
 using namespace libdap;
@@ -792,6 +794,44 @@ public:
         }
     }
 
+    // The result holds its values as columns until something asks for rows
+    void columnar_result_test()
+    {
+        vector<BaseType*> arrays;
+        for (DDS::Vars_iter i = four_var_mixed->var_begin(), e = four_var_mixed->var_end(); i != e; ++i) {
+            arrays.push_back(static_cast<Array*>(*i));
+        }
+        arrays.pop_back();
+
+        BaseType *result = 0;
+        try {
+            TabularFunction::function_dap2_tabular(arrays.size(), &arrays[0], *four_var_mixed, &result);
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message());
+        }
+
+        TabularSequence *s = dynamic_cast<TabularSequence*>(result);
+        CPPUNIT_ASSERT(s);
+        CPPUNIT_ASSERT(s->columnar());
+        CPPUNIT_ASSERT(s->number_of_rows() == 8);
+
+        auto_ptr<TabularSequence> copy(static_cast<TabularSequence*>(s->ptr_duplicate()));
+        CPPUNIT_ASSERT(copy->columnar());
+        CPPUNIT_ASSERT(copy->number_of_rows() == 8);
+
+        // The index column; the two independent values repeat for each index value
+        BaseType *btp = s->var_value(5, 0);
+        CPPUNIT_ASSERT(btp->type() == dods_uint32_c);
+        CPPUNIT_ASSERT(static_cast<UInt32*>(btp)->value() == 2);
+        CPPUNIT_ASSERT(!s->columnar());
+        CPPUNIT_ASSERT(s->number_of_rows() == 8);
+
+        CPPUNIT_ASSERT(static_cast<UInt32*>(copy->var_value(3, 0))->value() == 1);
+
+        delete result;
+    }
+
     void one_var_2_print_val_test()
     {
         // we know there's just one variable
@@ -840,6 +880,7 @@ CPPUNIT_TEST_SUITE( TabularFunctionTest );
     CPPUNIT_TEST(four_var_test);
     CPPUNIT_TEST(four_var_2_test);
     CPPUNIT_TEST(four_var_mixed_test_1);
+    CPPUNIT_TEST(columnar_result_test);
 
     CPPUNIT_TEST_SUITE_END()
     ;
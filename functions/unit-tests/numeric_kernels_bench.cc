@@ -0,0 +1,206 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Time linear_scale(), range() and mask_array() style loops over large
+// Int16 and Float32 arrays two ways: by first copying the values to an array
+// of doubles (what the functions used to do) and with the native-type loops
+// in numeric_kernels.h. Usage: numeric_kernels_bench [-n size] [-r repeats]
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+
+#include "numeric_kernels.h"
+
+using namespace std;
+using namespace functions;
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1.0e6;
+}
+
+static void report(const string &what, double copied, double native)
+{
+    cout << setw(28) << left << what << setw(12) << right << fixed << setprecision(4) << copied << setw(12) << native
+        << setw(10) << setprecision(2) << copied / native << "x" << endl;
+}
+
+// The old way: copy to doubles, then loop over them
+template<typename T>
+static double *extract(const vector<T> &src)
+{
+    double *d = new double[src.size()];
+    for (typename vector<T>::size_type i = 0; i < src.size(); ++i)
+        d[i] = src[i];
+    return d;
+}
+
+template<typename T>
+static void bench(const string &type, const vector<T> &src, T missing, int repeats)
+{
+    unsigned long n = src.size();
+    vector<double> dest(n);
+    double sink = 0;
+
+    // linear_scale()
+    double start = now();
+    for (int r = 0; r < repeats; ++r) {
+        double *d = extract(src);
+        for (unsigned long i = 0; i < n; ++i)
+            dest[i] = d[i] * 0.01 + 273.15;
+        delete[] d;
+        sink += dest[n / 2];
+    }
+    double copied = now() - start;
+
+    start = now();
+    for (int r = 0; r < repeats; ++r) {
+        linear_scale_kernel(&src[0], &dest[0], n, 0.01, 273.15);
+        sink += dest[n / 2];
+    }
+    report(type + " linear_scale", copied, now() - start);
+
+    // range(), with a missing value
+    start = now();
+    for (int r = 0; r < repeats; ++r) {
+        double *d = extract(src);
+        double lo = 1e300, hi = -1e300;
+        for (unsigned long i = 0; i < n; ++i) {
+            if (d[i] == missing) continue;
+            if (d[i] < lo) lo = d[i];
+            if (d[i] > hi) hi = d[i];
+        }
+        delete[] d;
+        sink += hi - lo;
+    }
+    copied = now() - start;
+
+    start = now();
+    for (int r = 0; r < repeats; ++r) {
+        double lo = 0, hi = 0;
+        bool monotonic;
+        min_max_kernel(&src[0], n, true, missing, lo, hi, monotonic);
+        sink += hi - lo;
+    }
+    report(type + " range (missing)", copied, now() - start);
+
+    // range(), no missing value
+    start = now();
+    for (int r = 0; r < repeats; ++r) {
+        double *d = extract(src);
+        double lo = 1e300, hi = -1e300;
+        for (unsigned long i = 0; i < n; ++i) {
+            if (d[i] < lo) lo = d[i];
+            if (d[i] > hi) hi = d[i];
+        }
+        delete[] d;
+        sink += hi - lo;
+    }
+    copied = now() - start;
+
+    start = now();
+    for (int r = 0; r < repeats; ++r) {
+        double lo = 0, hi = 0;
+        bool monotonic;
+        min_max_kernel(&src[0], n, false, missing, lo, hi, monotonic);
+        sink += hi - lo;
+    }
+    report(type + " range", copied, now() - start);
+
+    // mask_array()
+    vector<unsigned char> mask(n);
+    for (unsigned long i = 0; i < n; ++i)
+        mask[i] = (i % 7) != 0;
+
+    vector<T> data(src);
+    start = now();
+    for (int r = 0; r < repeats; ++r) {
+        vector<T> copy(data);
+        for (unsigned long i = 0; i < n; ++i)
+            if (!mask[i]) copy[i] = missing;
+        data.swap(copy);
+        sink += data[n / 2];
+    }
+    copied = now() - start;
+
+    start = now();
+    for (int r = 0; r < repeats; ++r) {
+        mask_kernel(&data[0], &mask[0], n, missing);
+        sink += data[n / 2];
+    }
+    report(type + " mask_array", copied, now() - start);
+
+    if (sink == 42) cerr << "";   // keep the loops
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long n = 16 * 1024 * 1024;
+    int repeats = 10;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:r:")) != -1) {
+        switch (c) {
+        case 'n':
+            n = strtoul(optarg, 0, 10);
+            break;
+        case 'r':
+            repeats = atoi(optarg);
+            break;
+        default:
+            cerr << "Usage: numeric_kernels_bench [-n size] [-r repeats]" << endl;
+            return 1;
+        }
+    }
+
+    if (n < 2 || repeats < 1) {
+        cerr << "The size must be at least two and the repeats at least one" << endl;
+        return 1;
+    }
+
+    vector<short> s(n);
+    vector<float> f(n);
+    srand(n);
+    for (unsigned long i = 0; i < n; ++i) {
+        s[i] = (i % 101) ? static_cast<short>(rand() % 20000 - 10000) : -32767;
+        f[i] = (i % 101) ? static_cast<float>(rand()) / RAND_MAX * 400.0f - 100.0f : -9999.0f;
+    }
+
+    cout << n << " values, " << repeats << " repeats (seconds)" << endl;
+    cout << setw(28) << left << "" << setw(12) << right << "to double" << setw(12) << "native" << setw(11) << "speedup"
+        << endl;
+
+    bench<short>("Int16", s, -32767, repeats);
+    bench<float>("Float32", f, -9999.0f, repeats);
+
+    return 0;
+}
@@ -28,6 +28,7 @@
 #include <iomanip>
 #include <set>
 #include <stack>
+#include <algorithm>
 
 #include <cstring>
 #include <cassert>
@@ -48,24 +49,17 @@ using namespace dmrpp;
 using namespace libdap;
 using namespace std;
 
-namespace dmrpp {
+// When a constraint selects part of an unchunked variable, the runs of
+// values it needs are read with byte-range requests. Runs closer together
+// than this are read with one request, along with the bytes in between.
+#define DMRPP_MAX_RANGE_GAP 65536
 
-/**
- * @brief Write an int vector to a string.
- * @note Only used by BESDEBUG calls
- * @param v
- * @return The string
- */
-static string vec2str(vector<unsigned int> v)
-{
-    ostringstream oss;
-    oss << "(";
-    for (unsigned long long i = 0; i < v.size(); i++) {
-        oss << (i ? "," : "") << v[i];
-    }
-    oss << ")";
-    return oss.str();
-}
+// The most range requests run at once, and roughly the most bytes those
+// requests read before their values are copied and the buffers freed.
+#define DMRPP_MAX_RANGE_REQUESTS 32
+#define DMRPP_MAX_RANGE_BATCH_BYTES 67108864
+
+namespace dmrpp {
 
 void DmrppArray::_duplicate(const DmrppArray &)
 {
@@ -209,106 +203,211 @@ DmrppArray::dimension DmrppArray::get_dimension(unsigned int i)
 }
 
 /**
- * @brief This recursive private method collects values from the rbuf and copies
- * them into buf. It supports stop, stride, and start and while correct is not
- * efficient.
+ * @brief Return the total number of elements in this Array
+ * @param constrained If true, use the constrained size of the array,
+ * otherwise use the full size.
+ * @return The number of elements in this Array
  */
-void DmrppArray::insert_constrained_no_chunk(Dim_iter dimIter, unsigned long *target_index,
-    vector<unsigned int> &subsetAddress, const vector<unsigned int> &array_shape, H4ByteStream *h4bytestream)
+unsigned long long DmrppArray::get_size(bool constrained)
 {
-    BESDEBUG("dmrpp", "DmrppArray::"<< __func__ << "() - subsetAddress.size(): " << subsetAddress.size() << endl);
+    // number of array elements in the constrained array
+    unsigned long long constrained_size = 1;
+    for (Dim_iter dim = dim_begin(), end = dim_end(); dim != end; dim++) {
+        constrained_size *= dimension_size(dim, constrained);
+    }
+    return constrained_size;
+}
 
-    unsigned int bytesPerElt = prototype()->width();
-    char *sourceBuf = h4bytestream->get_rbuf();
-    char *targetBuf = get_buf();
+/**
+ * @brief Step through the runs of values a constraint selects from an unchunked array
+ *
+ * A run is a set of selected values that are next to one another both in
+ * the variable's data and in the constrained array. Inner dimensions that
+ * the constraint selects all of are merged with the dimension outside
+ * them, so, e.g., [2:1:5][0:1:179] of a 90 by 180 array is one run. The
+ * runs come in the order their values go in the constrained array, which
+ * is also the order of their offsets.
+ */
+class constrained_runs {
+private:
+    vector<unsigned long long> d_count;     // values selected in each stepped dimension
+    vector<unsigned long long> d_step;      // bytes from one to the next
+    vector<unsigned long long> d_index;
+
+    unsigned long long d_run_bytes;
+    unsigned long long d_offset;            // of the current run
+    bool d_done;
+
+public:
+    constrained_runs(const vector<unsigned int> &shape, const vector<unsigned int> &start,
+        const vector<unsigned int> &stride, const vector<unsigned int> &stop, unsigned int width) :
+        d_run_bytes(0), d_offset(0), d_done(false)
+    {
+        // The bytes from one value to the next in each dimension
+        vector<unsigned long long> bytes(shape.size());
+        unsigned long long b = width;
+        for (vector<unsigned int>::size_type i = shape.size(); i > 0; --i) {
+            bytes[i - 1] = b;
+            b *= shape[i - 1];
+        }
 
-    unsigned int start = this->dimension_start(dimIter);
-    unsigned int stop = this->dimension_stop(dimIter, true);
-    unsigned int stride = this->dimension_stride(dimIter, true);
-    BESDEBUG("dmrpp",
-        "DmrppArray::"<< __func__ << "() - start: " << start << " stride: " << stride << " stop: " << stop << endl);
-
-    dimIter++;
-
-    // This is the end case for the recursion.
-    // TODO stride == 1 belongs inside this or else rewrite this as if else if else
-    // see below.
-    if (dimIter == dim_end() && stride == 1) {
-        BESDEBUG("dmrpp",
-            "DmrppArray::"<< __func__ << "() - stride is 1, copying from all values from start to stop." << endl);
-
-        subsetAddress.push_back(start);
-        unsigned int start_index = get_index(subsetAddress, array_shape);
-        BESDEBUG("dmrpp", "DmrppArray::"<< __func__ << "() - start_index: " << start_index << endl);
-        subsetAddress.pop_back();
-
-        subsetAddress.push_back(stop);
-        unsigned int stop_index = get_index(subsetAddress, array_shape);
-        BESDEBUG("dmrpp", "DmrppArray::"<< __func__ << "() - stop_index: " << start_index << endl);
-        subsetAddress.pop_back();
-
-        // Copy data block from start_index to stop_index
-        // FIXME Replace this loop with a call to std::memcpy()
-        for (unsigned int sourceIndex = start_index; sourceIndex <= stop_index; sourceIndex++, target_index++) {
-            unsigned long target_byte = *target_index * bytesPerElt;
-            unsigned long source_byte = sourceIndex * bytesPerElt;
-            // Copy a single value.
-            for (unsigned int i = 0; i < bytesPerElt; i++) {
-                targetBuf[target_byte++] = sourceBuf[source_byte++];
-            }
-            (*target_index)++;
+        for (vector<unsigned int>::size_type i = 0; i < shape.size(); ++i)
+            d_offset += start[i] * bytes[i];
+
+        // Skip the inner dimensions that are wholly selected
+        vector<unsigned int>::size_type outer = shape.size();
+        while (outer > 0 && start[outer - 1] == 0 && stride[outer - 1] == 1 && stop[outer - 1] == shape[outer - 1] - 1)
+            --outer;
+
+        if (outer == 0) {
+            d_run_bytes = b;
         }
-    }
-    else {
-        for (unsigned int myDimIndex = start; myDimIndex <= stop; myDimIndex += stride) {
-            // Is it the last dimension?
-            if (dimIter != dim_end()) {
-                // Nope!
-                // then we recurse to the last dimension to read stuff
-                subsetAddress.push_back(myDimIndex);
-                insert_constrained_no_chunk(dimIter, target_index, subsetAddress, array_shape, h4bytestream);
-                subsetAddress.pop_back();
+        else {
+            vector<unsigned int>::size_type d = outer - 1;
+            if (stride[d] == 1) {
+                // The run is this dimension's selection of the inner block
+                d_run_bytes = bytes[d] * (stop[d] - start[d] + 1);
+                outer = d;
             }
             else {
-                // We are at the last (inner most) dimension.
-                // So it's time to copy values.
-                subsetAddress.push_back(myDimIndex);
-                unsigned int sourceIndex = get_index(subsetAddress, array_shape);
-                BESDEBUG("dmrpp",
-                    "DmrppArray::"<< __func__ << "() - " "Copying source value at sourceIndex: " << sourceIndex << endl);
-                subsetAddress.pop_back();
-                // Copy a single value.
-                unsigned long target_byte = *target_index * bytesPerElt;
-                unsigned long source_byte = sourceIndex * bytesPerElt;
-
-                // FIXME Replace this loop with a call to std::memcpy()
-                for (unsigned int i = 0; i < bytesPerElt; i++) {
-                    targetBuf[target_byte++] = sourceBuf[source_byte++];
-                }
-                (*target_index)++;
+                d_run_bytes = bytes[d];
+            }
+
+            for (vector<unsigned int>::size_type i = 0; i < outer; ++i) {
+                d_count.push_back((stop[i] - start[i]) / stride[i] + 1);
+                d_step.push_back(stride[i] * bytes[i]);
             }
+            d_index.resize(outer, 0);
         }
     }
-}
+
+    /**
+     * @brief Get the next run
+     * @param offset Value-result parameter; the byte offset of the run in
+     * the variable's data
+     * @param size Value-result parameter; the run's size in bytes
+     * @return False if there are no more runs
+     */
+    bool next(unsigned long long &offset, unsigned long long &size)
+    {
+        if (d_done) return false;
+
+        offset = d_offset;
+        size = d_run_bytes;
+
+        vector<unsigned long long>::size_type i = d_index.size();
+        for (; i > 0; --i) {
+            d_offset += d_step[i - 1];
+            if (++d_index[i - 1] < d_count[i - 1]) break;
+
+            d_offset -= d_count[i - 1] * d_step[i - 1];
+            d_index[i - 1] = 0;
+        }
+        d_done = (i == 0);
+
+        return true;
+    }
+};
 
 /**
- * @brief Return the total number of elements in this Array
- * @param constrained If true, use the constrained size of the array,
- * otherwise use the full size.
- * @return The number of elements in this Array
+ * @brief Read just the values of an unchunked array that a constraint selects
+ *
+ * The runs of selected values are merged into byte ranges (runs less than
+ * DMRPP_MAX_RANGE_GAP bytes apart share a range) and the ranges are read,
+ * several at a time, using a curl multi handle. Each run is copied from
+ * its range into its place in the array's buffer, so only the constrained
+ * array is held in memory, along with the ranges of one batch.
+ *
+ * @param h4bytestream Where the whole variable's data are
  */
-unsigned long long DmrppArray::get_size(bool constrained)
+void DmrppArray::read_constrained_no_chunk(const H4ByteStream &h4bytestream)
 {
-    // number of array elements in the constrained array
-    unsigned long long constrained_size = 1;
-    for (Dim_iter dim = dim_begin(), end = dim_end(); dim != end; dim++) {
-        constrained_size *= dimension_size(dim, constrained);
+    vector<unsigned int> shape, start, stride, stop;
+    for (Dim_iter p = dim_begin(), e = dim_end(); p != e; ++p) {
+        shape.push_back(dimension_size(p, false));
+        start.push_back(dimension_start(p, true));
+        stride.push_back(dimension_stride(p, true));
+        stop.push_back(dimension_stop(p, true));
+    }
+    unsigned int width = prototype()->width();
+
+    // The offset and size of each range, relative to the start of the variable
+    vector<pair<unsigned long long, unsigned long long> > ranges;
+    constrained_runs runs(shape, start, stride, stop, width);
+    unsigned long long run_offset = 0, run_size = 0;
+    while (runs.next(run_offset, run_size)) {
+        // Merged ranges stop growing at the batch size, so each batch stays near its byte limit
+        if (!ranges.empty() && run_offset - (ranges.back().first + ranges.back().second) <= DMRPP_MAX_RANGE_GAP
+            && run_offset + run_size - ranges.back().first <= DMRPP_MAX_RANGE_BATCH_BYTES)
+            ranges.back().second = run_offset + run_size - ranges.back().first;
+        else
+            ranges.push_back(make_pair(run_offset, run_size));
+    }
+
+    if (ranges.empty() || ranges.back().first + ranges.back().second > h4bytestream.get_size()) {
+        ostringstream oss;
+        oss << "DmrppArray::" << __func__ << "() - The constraint on " << name() << " is outside of its data: "
+            << h4bytestream.get_size() << " bytes.";
+        throw BESError(oss.str(), BES_INTERNAL_ERROR, __FILE__, __LINE__);
+    }
+
+    BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - Reading " << ranges.size() << " byte ranges of " << name() << endl);
+
+    reserve_value_capacity(get_size(true));
+    char *target_buffer = get_buf();
+
+    constrained_runs copy_runs(shape, start, stride, stop, width);
+    bool more = copy_runs.next(run_offset, run_size);
+
+    vector<pair<unsigned long long, unsigned long long> >::size_type first = 0;
+    while (first < ranges.size()) {
+        // Take ranges until there are enough requests or bytes, but at least one
+        vector<pair<unsigned long long, unsigned long long> >::size_type last = first;
+        unsigned long long batch_bytes = 0;
+        while (last < ranges.size() && last - first < DMRPP_MAX_RANGE_REQUESTS
+            && (last == first || batch_bytes + ranges[last].second <= DMRPP_MAX_RANGE_BATCH_BYTES)) {
+            batch_bytes += ranges[last++].second;
+        }
+
+        // The batch is not resized once the reads are queued; libcurl holds pointers to its elements
+        vector<H4ByteStream> batch;
+        batch.reserve(last - first);
+        for (vector<pair<unsigned long long, unsigned long long> >::size_type i = first; i < last; ++i) {
+            batch.push_back(H4ByteStream(h4bytestream.get_data_url(), ranges[i].second,
+                h4bytestream.get_offset() + ranges[i].first, "", h4bytestream.get_uuid()));
+        }
+
+        if (batch.size() > 1) {
+            CURLM *curl_multi_handle = curl_multi_init();
+            for (vector<H4ByteStream>::iterator i = batch.begin(), e = batch.end(); i != e; ++i)
+                i->add_to_multi_read_queue(curl_multi_handle);
+            multi_finish(curl_multi_handle, &batch);
+        }
+
+        for (vector<H4ByteStream>::size_type i = 0; i < batch.size(); ++i) {
+            // Reads the range if it was not queued, else checks the byte count
+            batch[i].read();
+
+            char *source_buffer = batch[i].get_rbuf();
+            unsigned long long range_offset = ranges[first + i].first;
+            unsigned long long range_end = range_offset + ranges[first + i].second;
+            while (more && run_offset < range_end) {
+                memcpy(target_buffer, source_buffer + (run_offset - range_offset), run_size);
+                target_buffer += run_size;
+                more = copy_runs.next(run_offset, run_size);
+            }
+        }
+
+        first = last;
     }
-    return constrained_size;
 }
 
 /**
- * @brief Read an array that is stored with using two or more 'chunks.'
+ * @brief Read an array that is stored as a single 'chunk' (i.e., not chunked)
+ *
+ * Without a constraint the whole variable is read; with one, only the byte
+ * ranges that hold the selected values are.
+ *
  * @return Always returns true, matching the libdap::Array::read() behavior.
  */
 bool DmrppArray::read_no_chunks()
@@ -323,24 +422,18 @@ bool DmrppArray::read_no_chunks()
         throw BESError(oss.str(), BES_INTERNAL_ERROR, __FILE__, __LINE__);
     }
 
-    // For now we only handle the one chunk case.
-    H4ByteStream h4_byte_stream = (*chunk_refs)[0];
-    h4_byte_stream.read(); // Use the default values for deflate (false) and chunk size (0)
-
     if (!is_projected()) {      // if there is no projection constraint
+        // For now we only handle the one chunk case.
+        H4ByteStream h4_byte_stream = (*chunk_refs)[0];
+        h4_byte_stream.read(); // Use the default values for deflate (false) and chunk size (0)
+
         BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - No projection, copying all values into array. " << endl);
         val2buf(h4_byte_stream.get_rbuf());    // yes, it's not type-safe
     }
     else {
-        vector<unsigned int> array_shape = get_shape(false);
-        unsigned long long constrained_size = get_size(true);
-
-        BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - constrained_size:  " << constrained_size << endl);
+        BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - constrained_size:  " << get_size(true) << endl);
 
-        reserve_value_capacity(constrained_size);
-        unsigned long target_index = 0;
-        vector<unsigned int> subset;
-        insert_constrained_no_chunk(dim_begin(), &target_index, subset, array_shape, &h4_byte_stream);
+        read_constrained_no_chunk((*chunk_refs)[0]);
     }
 
     set_read_p(true);
@@ -350,6 +443,156 @@ bool DmrppArray::read_no_chunks()
     return true;
 }
 
+/**
+ * @brief Copy 'count' values of W bytes, 'stride' values apart in src, to dest
+ *
+ * With W fixed, each memcpy() is a single load and store.
+ */
+template<unsigned int W>
+static void gather_kernel(char *dest, const char *src, unsigned long long count, unsigned long long stride,
+    unsigned int)
+{
+    const unsigned long long src_step = stride * W;
+    for (unsigned long long i = 0; i < count; ++i, dest += W, src += src_step)
+        memcpy(dest, src, W);
+}
+
+/// gather_kernel() for values of other widths
+static void gather_kernel_any(char *dest, const char *src, unsigned long long count, unsigned long long stride,
+    unsigned int width)
+{
+    const unsigned long long src_step = stride * width;
+    for (unsigned long long i = 0; i < count; ++i, dest += width, src += src_step)
+        memcpy(dest, src, width);
+}
+
+/**
+ * @brief The copies that move a chunk's selected values into the constrained array
+ *
+ * Everything that depends only on the constraint and the chunk shape (the
+ * strides, in values, of the chunk and of the constrained array, and the
+ * gather kernel for the value width) is worked out once per read. For each
+ * chunk, locate() finds the part of the chunk the constraint selects and
+ * copy() moves it with an odometer over the outer dimensions. The innermost
+ * dimension is copied with one memcpy() when its stride is one and with a
+ * gather otherwise. Neither method allocates memory.
+ */
+class chunk_copy_plan {
+private:
+    typedef void (*gather_fn)(char *dest, const char *src, unsigned long long count, unsigned long long stride,
+        unsigned int width);
+
+    vector<unsigned long long> d_chunk_shape;
+    vector<unsigned long long> d_start, d_stride, d_stop;
+    vector<unsigned long long> d_src_step;      // values between selected values in the chunk
+    vector<unsigned long long> d_dest_step;     // ... and in the constrained array
+    unsigned int d_width;
+    gather_fn d_gather;
+
+    // Set by locate() for the current chunk
+    vector<unsigned long long> d_count;
+    unsigned long long d_src_offset;
+    unsigned long long d_dest_offset;
+
+    vector<unsigned long long> d_index;         // copy()'s odometer
+
+public:
+    chunk_copy_plan(const vector<unsigned int> &chunk_shape, const vector<unsigned int> &start,
+        const vector<unsigned int> &stride, const vector<unsigned int> &stop,
+        const vector<unsigned int> &constrained_shape, unsigned int width) :
+        d_chunk_shape(chunk_shape.begin(), chunk_shape.end()), d_start(start.begin(), start.end()),
+        d_stride(stride.begin(), stride.end()), d_stop(stop.begin(), stop.end()), d_src_step(chunk_shape.size()),
+        d_dest_step(chunk_shape.size()), d_width(width), d_count(chunk_shape.size()), d_src_offset(0),
+        d_dest_offset(0), d_index(chunk_shape.size())
+    {
+        unsigned long long src_size = 1, dest_size = 1;
+        for (vector<unsigned int>::size_type i = chunk_shape.size(); i > 0; --i) {
+            d_src_step[i - 1] = src_size * stride[i - 1];
+            d_dest_step[i - 1] = dest_size;
+            src_size *= chunk_shape[i - 1];
+            dest_size *= constrained_shape[i - 1];
+        }
+
+        switch (width) {
+        case 1: d_gather = gather_kernel<1>; break;
+        case 2: d_gather = gather_kernel<2>; break;
+        case 4: d_gather = gather_kernel<4>; break;
+        case 8: d_gather = gather_kernel<8>; break;
+        default: d_gather = gather_kernel_any; break;
+        }
+    }
+
+    /**
+     * @brief Find the values of a chunk that the constraint selects
+     * @param chunk_origin The chunk's position in the array
+     * @return False if the constraint selects none of the chunk's values
+     */
+    bool locate(const vector<unsigned int> &chunk_origin)
+    {
+        if (chunk_origin.size() != d_chunk_shape.size())
+            throw BESError("DmrppArray: A chunk's position does not match the array's rank.", BES_INTERNAL_ERROR,
+                __FILE__, __LINE__);
+
+        unsigned long long src_size = 1;
+        d_src_offset = 0;
+        d_dest_offset = 0;
+        for (vector<unsigned int>::size_type i = d_chunk_shape.size(); i > 0; --i) {
+            const vector<unsigned int>::size_type d = i - 1;
+            const unsigned long long origin = chunk_origin[d];
+
+            // The first selected index at or past the origin and the last one in the chunk
+            unsigned long long first = d_start[d];
+            if (origin > first) first += (origin - first + d_stride[d] - 1) / d_stride[d] * d_stride[d];
+            unsigned long long last = min(d_stop[d], origin + d_chunk_shape[d] - 1);
+            if (first > last) return false;
+
+            d_count[d] = (last - first) / d_stride[d] + 1;
+            d_src_offset += (first - origin) * src_size;
+            d_dest_offset += (first - d_start[d]) / d_stride[d] * d_dest_step[d];
+            src_size *= d_chunk_shape[d];
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Copy the values found by the last call to locate()
+     * @param src The chunk's (decompressed) data
+     * @param dest The constrained array's buffer
+     */
+    void copy(const char *src, char *dest)
+    {
+        const vector<unsigned long long>::size_type last = d_count.size() - 1;
+        const unsigned long long row_count = d_count[last];
+        const unsigned long long row_stride = d_src_step[last];
+        const unsigned long long row_bytes = row_count * d_width;
+
+        unsigned long long src_offset = d_src_offset;
+        unsigned long long dest_offset = d_dest_offset;
+        fill(d_index.begin(), d_index.end(), 0);
+
+        while (true) {
+            if (row_stride == 1)
+                memcpy(dest + dest_offset * d_width, src + src_offset * d_width, row_bytes);
+            else
+                d_gather(dest + dest_offset * d_width, src + src_offset * d_width, row_count, row_stride, d_width);
+
+            // Move to the next row
+            vector<unsigned long long>::size_type i = last;
+            for (; i > 0; --i) {
+                src_offset += d_src_step[i - 1];
+                dest_offset += d_dest_step[i - 1];
+                if (++d_index[i - 1] < d_count[i - 1]) break;
+
+                src_offset -= d_count[i - 1] * d_src_step[i - 1];
+                dest_offset -= d_count[i - 1] * d_dest_step[i - 1];
+                d_index[i - 1] = 0;
+            }
+            if (i == 0) break;
+        }
+    }
+};
+
 /**
  * Reads a the chunks that make up this array's content and copies just the
  * relevant values into the array's memory buffer.
@@ -360,6 +603,9 @@ bool DmrppArray::read_no_chunks()
  * until everything has been completely retrieved or has erred. With the chunks
  * read and in memory the code then initiates a copy of the results into the
  * array variable's internal buffer.
+ *
+ * The copies are planned once, by chunk_copy_plan, and then run for each
+ * chunk the constraint uses.
  */
 bool DmrppArray::read_chunks()
 {
@@ -373,42 +619,38 @@ bool DmrppArray::read_chunks()
         throw BESError(oss.str(), BES_INTERNAL_ERROR, __FILE__, __LINE__);
     }
     // Allocate target memory.
-    // FIXME - I think this needs to be the constrained size!
-    reserve_value_capacity(length());
-    vector<unsigned int> array_shape = get_shape(false);
+    reserve_value_capacity(get_size(true));
+    vector<unsigned int> chunk_shape = get_chunk_dimension_sizes();
     BESDEBUG("dmrpp",
-        "DmrppArray::"<< __func__ <<"() - dimensions(): " << dimensions(false) << " array_shape.size(): " << array_shape.size() << endl);
+        "DmrppArray::"<< __func__ <<"() - dimensions(): " << dimensions(false) << " chunk_shape.size(): " << chunk_shape.size() << endl);
 
-    if (this->dimensions(false) != array_shape.size()) {
+    if (this->dimensions(false) != chunk_shape.size()) {
         ostringstream oss;
-        oss << "DmrppArray::" << __func__ << "() - array_shape does not match the number of array dimensions! " << endl;
+        oss << "DmrppArray::" << __func__ << "() - chunk_shape does not match the number of array dimensions! " << endl;
         throw BESError(oss.str(), BES_INTERNAL_ERROR, __FILE__, __LINE__);
     }
 
     BESDEBUG("dmrpp",
         "DmrppArray::"<< __func__ << "() - "<< dimensions() << "D Array. Processing " << chunk_refs->size() << " chunks" << endl);
 
+    vector<unsigned int> start, stride, stop;
+    for (Dim_iter p = dim_begin(), e = dim_end(); p != e; ++p) {
+        start.push_back(dimension_start(p, true));
+        stride.push_back(dimension_stride(p, true));
+        stop.push_back(dimension_stop(p, true));
+    }
+    chunk_copy_plan plan(chunk_shape, start, stride, stop, get_shape(true), prototype()->width());
+
     /* get a curl_multi handle */
     CURLM *curl_multi_handle = curl_multi_init();
 
-    /*
-     * Find the chunks to be read, make curl_easy handles for them, and
-     * stuff them into our curl_multi handle. This is a recursive activity
-     * which utilizes the same code that copies the data from the chunk to
-     * the variables.
-     */
-    for (unsigned long i = 0; i < chunk_refs->size(); i++) {
-        H4ByteStream *h4bs = &(*chunk_refs)[i];
-        BESDEBUG("dmrpp",
-            "DmrppArray::" << __func__ <<"(): BEGIN Processing chunk[" << i << "]: " << h4bs->to_string() << endl);
-        vector<unsigned int> target_element_address = h4bs->get_position_in_array();
-        vector<unsigned int> chunk_source_address(dimensions(), 0);
-        // Recursive insertion operation.
-        bool flag = insert_constrained_chunk(0, &target_element_address, &chunk_source_address, h4bs, curl_multi_handle);
-        BESDEBUG("dmrpp",
-            "DmrppArray::" << __func__ <<"(): END Processing chunk[" << i << "]  "
-                "(chunk was " << (h4bs->is_started()?"QUEUED":"NOT_QUEUED") <<
-                " and " << (h4bs->is_read()?"READ":"NOT_READ") << ") flag: "<< flag << endl);
+    // Find the chunks to be read, make curl_easy handles for them, and
+    // stuff them into our curl_multi handle.
+    for (vector<H4ByteStream>::iterator i = chunk_refs->begin(), e = chunk_refs->end(); i != e; ++i) {
+        if (plan.locate(i->get_position_in_array())) {
+            BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - Queuing chunk for retrieval: " << i->to_string() << endl);
+            i->add_to_multi_read_queue(curl_multi_handle);
+        }
     }
 
     /*
@@ -418,22 +660,23 @@ bool DmrppArray::read_chunks()
      */
     multi_finish(curl_multi_handle, chunk_refs);
 
-    /*
-     * The chunks are all read, so we jump back into the recursive code to copy the
-     * correct values out of each chunk and into the array memory.
-     */
-    for (unsigned long i = 0; i < chunk_refs->size(); i++) {
-        H4ByteStream *h4bs = &(*chunk_refs)[i];
-        BESDEBUG("dmrpp",
-            "DmrppArray::" << __func__ <<"(): BEGIN Processing chunk[" << i << "]: " << h4bs->to_string() << endl);
-        vector<unsigned int> target_element_address = h4bs->get_position_in_array();
-        vector<unsigned int> chunk_source_address(dimensions(), 0);
-        // Recursive insertion operation.
-        bool flag = insert_constrained_chunk(0, &target_element_address, &chunk_source_address, h4bs, 0);
-        BESDEBUG("dmrpp",
-            "DmrppArray::" << __func__ <<"(): END Processing chunk[" << i << "]  (chunk was " << (h4bs->is_read()?"READ":"SKIPPED") << ") flag: "<< flag << endl);
+    // The chunks are all read; decompress them and copy the selected values
+    // into the array memory.
+    char *target_buffer = get_buf();
+    unsigned int chunk_bytes = get_chunk_size_in_elements() * prototype()->width();
+    for (vector<H4ByteStream>::iterator i = chunk_refs->begin(), e = chunk_refs->end(); i != e; ++i) {
+        if (!plan.locate(i->get_position_in_array())) continue;
+
+        i->read(is_deflate_compression(), chunk_bytes, is_shuffle_compression(), prototype()->width());
+        if (i->get_rbuf_size() < chunk_bytes) {
+            ostringstream oss;
+            oss << "DmrppArray::" << __func__ << "() - The chunk " << i->to_string() << " is smaller than "
+                << chunk_bytes << " bytes.";
+            throw BESError(oss.str(), BES_INTERNAL_ERROR, __FILE__, __LINE__);
+        }
+
+        plan.copy(i->get_rbuf(), target_buffer);
     }
-    //##############################################################################
 
     return true;
 }
@@ -560,240 +803,6 @@ void DmrppArray::multi_finish(CURLM *multi_handle, vector<H4ByteStream> *chunk_r
 }
 
 
-/**
- * @brief This recursive call inserts a (previously read) chunk's data into the
- * appropriate parts of the Array object's internal memory.
- *
- * Successive calls climb into the array to the insertion point for the current
- * chunk's innermost row. Once located, this row is copied into the array at the
- * insertion point. The next row for insertion is located by returning from the
- * insertion call to the next dimension iteration in the call recursive call
- * stack.
- *
- * This starts with dimension 0 and the chunk_row_insertion_point_address set
- * to the chunks origin point
- *
- * @param dim is the dimension on which we are working. We recurse from
- * dimension 0 to the last dimension
- * @param target_element_address - This vector is used to hold the element
- * address in the result array to where this chunk's data will be written.
- * @param chunk_source_address - This vector is used to hold the chunk
- * element address from where data will be read. The values of this are relative to
- * the chunk's origin (position in array).
- * @param chunk The H4ByteStream containing the read data values to insert.
- * @return
- */
-bool DmrppArray::insert_constrained_chunk(unsigned int dim, vector<unsigned int> *target_element_address,
-    vector<unsigned int> *chunk_source_address, H4ByteStream *chunk, CURLM *multi_handle)
-{
-
-    BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - dim: "<< dim << " BEGIN "<< endl);
-
-    // The size, in elements, of each of the chunk's dimensions.
-    // TODO We assume all chunks have the same size for any given array.
-    vector<unsigned int> chunk_shape = get_chunk_dimension_sizes();
-
-    // The array index of the last dimension
-    unsigned int last_dim = chunk_shape.size() - 1;
-
-    // The chunk's origin point a.k.a. its "position in array".
-    vector<unsigned int> chunk_origin = chunk->get_position_in_array();
-
-    BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - Retrieving dimension "<< dim << endl);
-
-    dimension thisDim = this->get_dimension(dim);
-
-    BESDEBUG("dmrpp",
-        "DmrppArray::"<< __func__ <<"() - thisDim: "<< thisDim.name << " start " << thisDim.start << " stride " << thisDim.stride << " stop " << thisDim.stop << endl);
-
-    // What's the first element that we are going to access for this dimension of the chunk?
-    unsigned int first_element_offset = 0; // start with 0
-    if ((unsigned) thisDim.start < chunk_origin[dim]) {
-        // If the start is behind this chunk, then it's special.
-        BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - dim: "<<dim << " thisDim.start: " << thisDim.start << endl);
-        if (thisDim.stride != 1) { // And if the stride isn't 1,
-            // we have to figure our where to begin in this chunk.
-            first_element_offset = (chunk_origin[dim] - thisDim.start) % thisDim.stride;
-            // If it's zero great!
-            if (first_element_offset != 0) {
-                // otherwise we adjustment to get correct first element.
-                first_element_offset = thisDim.stride - first_element_offset;
-            }
-        }
-        BESDEBUG("dmrpp",
-            "DmrppArray::"<< __func__ <<"() - dim: "<< dim << " first_element_offset: " << first_element_offset << endl);
-    }
-    else {
-        first_element_offset = thisDim.start - chunk_origin[dim];
-        BESDEBUG("dmrpp",
-            "DmrppArray::"<< __func__ <<"() - dim: "<< dim << " thisDim.start is beyond the chunk origin at this dim. first_element_offset: " << first_element_offset << endl);
-    }
-
-    // Is the next point to be sent in this chunk at all?
-    if (first_element_offset > chunk_shape[dim]) {
-        // Nope! Time to bail
-        return false;
-    }
-
-    unsigned long long start_element = chunk_origin[dim] + first_element_offset;
-    BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - dim: "<< dim << " start_element: " << start_element << endl);
-
-    // Now we figure out the correct last element, based on the subset expression
-    unsigned long long end_element = chunk_origin[dim] + chunk_shape[dim] - 1;
-    if ((unsigned) thisDim.stop < end_element) {
-        end_element = thisDim.stop;
-        BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - dim: "<< dim << " thisDim.stop is in this chunk. " << endl);
-    }
-    BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - dim: "<< dim << " end_element: " << end_element << endl);
-
-    // Do we even want this chunk?
-    if ((unsigned) thisDim.start > (chunk_origin[dim] + chunk_shape[dim])
-        || (unsigned) thisDim.stop < chunk_origin[dim]) {
-        // No. No, we do not. Skip this.
-        BESDEBUG("dmrpp",
-            "DmrppArray::"<< __func__ <<"() - dim: " << dim << " Chunk not accessed by CE. SKIPPING." << endl);
-        return false ;
-    }
-
-    unsigned long long chunk_start = start_element - chunk_origin[dim];
-    unsigned long long chunk_end = end_element - chunk_origin[dim];
-
-    if (dim == last_dim) {
-        BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - dim: "<< dim << " THIS IS THE INNER-MOST DIM. "<< endl);
-        if(multi_handle){
-            BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - Queuing chunk for retrieval: " << chunk->to_string() << endl);
-             chunk->add_to_multi_read_queue(multi_handle);
-             return true;
-        }
-        else {
-            BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - Reading " << chunk->to_string() << endl);
-
-            // Read and Process chunk
-            chunk->read(is_deflate_compression(), get_chunk_size_in_elements() * var()->width(),
-                is_shuffle_compression(), var()->width());
-            char * source_buffer = chunk->get_rbuf();
-
-            if (thisDim.stride == 1) {
-                //#############################################################################
-                // ND - inner_stride == 1
-
-                BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - dim: " << dim << " The stride is 1." << endl);
-
-                // Compute how much we are going to copy
-                unsigned long long chunk_constrained_inner_dim_elements = end_element - start_element + 1;
-                BESDEBUG("dmrpp",
-                    "DmrppArray::"<< __func__ <<"() - dim: " << dim << " chunk_constrained_inner_dim_elements: " << chunk_constrained_inner_dim_elements << endl);
-
-                unsigned long long chunk_constrained_inner_dim_bytes = chunk_constrained_inner_dim_elements
-                    * prototype()->width();
-                BESDEBUG("dmrpp",
-                    "DmrppArray::"<< __func__ <<"() - dim: " << dim << " chunk_constrained_inner_dim_bytes: " << chunk_constrained_inner_dim_bytes << endl);
-
-                // Compute where we need to put it.
-                (*target_element_address)[dim] = (start_element - thisDim.start) / thisDim.stride;
-                BESDEBUG("dmrpp",
-                    "DmrppArray::"<< __func__ <<"() - dim: " << dim << " target_element_address: " << vec2str(*target_element_address) << endl);
-
-                unsigned int target_start_element_index = get_index(*target_element_address, get_shape(true));
-                BESDEBUG("dmrpp",
-                    "DmrppArray::"<< __func__ <<"() - dim: " << dim << " target_start_element_index: " << target_start_element_index << endl);
-
-                unsigned int target_char_start_index = target_start_element_index * prototype()->width();
-                BESDEBUG("dmrpp",
-                    "DmrppArray::"<< __func__ <<"() - dim: " << dim << " target_char_start_index: " << target_char_start_index << endl);
-
-                // Compute where we are going to read it from
-                (*chunk_source_address)[dim] = first_element_offset;
-                BESDEBUG("dmrpp",
-                    "DmrppArray::"<< __func__ <<"() - dim: " << dim << " chunk_source_address: " << vec2str(*chunk_source_address) << endl);
-
-                unsigned int chunk_start_element_index = get_index(*chunk_source_address, chunk_shape);
-                BESDEBUG("dmrpp",
-                    "DmrppArray::"<< __func__ <<"() - dim: " << dim << " chunk_start_element_index: " << chunk_start_element_index << endl);
-
-                unsigned int chunk_char_start_index = chunk_start_element_index * prototype()->width();
-                BESDEBUG("dmrpp",
-                    "DmrppArray::"<< __func__ <<"() - dim: " << dim << " chunk_char_start_index: " << chunk_char_start_index << endl);
-
-                char *target_buffer = get_buf();
-
-                // Copy the bytes
-                BESDEBUG("dmrpp",
-                    "DmrppArray::"<< __func__ <<"() - dim: " << dim << " Using memcpy to transfer " << chunk_constrained_inner_dim_bytes << " bytes." << endl);
-                memcpy(target_buffer + target_char_start_index, source_buffer + chunk_char_start_index,
-                    chunk_constrained_inner_dim_bytes);
-            }
-            else {
-                //#############################################################################
-                // inner_stride != 1
-                unsigned long long vals_in_chunk = 1 + (end_element - start_element) / thisDim.stride;
-                BESDEBUG("dmrpp",
-                    "DmrppArray::"<< __func__ <<"() - dim: "<<dim<<" InnerMostStride is equal to " << thisDim.stride << ". Copying " << vals_in_chunk << " individual values." << endl);
-
-                unsigned long long chunk_start = start_element - chunk_origin[dim];
-                BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - ichunk_start: " << chunk_start << endl);
-
-                unsigned long long chunk_end = end_element - chunk_origin[dim];
-                BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() - chunk_end: " << chunk_end << endl);
-
-                for (unsigned int chunk_index = chunk_start; chunk_index <= chunk_end; chunk_index += thisDim.stride) {
-                    BESDEBUG("dmrpp", "DmrppArray::"<< __func__ <<"() --------- idim_index: " << chunk_index << endl);
-
-                    // Compute where we need to put it.
-                    (*target_element_address)[dim] = (chunk_index + chunk_origin[dim] - thisDim.start) / thisDim.stride;
-                    BESDEBUG("dmrpp",
-                        "DmrppArray::"<< __func__ <<"() - target_element_address: " << vec2str(*target_element_address) << endl);
-
-                    unsigned int target_start_element_index = get_index(*target_element_address, get_shape(true));
-                    BESDEBUG("dmrpp",
-                        "DmrppArray::"<< __func__ <<"() - target_start_element_index: " << target_start_element_index << endl);
-
-                    unsigned int target_char_start_index = target_start_element_index * prototype()->width();
-                    BESDEBUG("dmrpp",
-                        "DmrppArray::"<< __func__ <<"() - target_char_start_index: " << target_char_start_index << endl);
-
-                    // Compute where we are going to read it from
-                    (*chunk_source_address)[dim] = chunk_index;
-                    BESDEBUG("dmrpp",
-                        "DmrppArray::"<< __func__ <<"() - chunk_source_address: " << vec2str(*chunk_source_address) << endl);
-
-                    unsigned int chunk_start_element_index = get_index(*chunk_source_address, chunk_shape);
-                    BESDEBUG("dmrpp",
-                        "DmrppArray::"<< __func__ <<"() - chunk_start_element_index: " << chunk_start_element_index << endl);
-
-                    unsigned int chunk_char_start_index = chunk_start_element_index * prototype()->width();
-                    BESDEBUG("dmrpp",
-                        "DmrppArray::"<< __func__ <<"() - chunk_char_start_index: " << chunk_char_start_index << endl);
-
-                    char *target_buffer = get_buf();
-
-                    // Copy the bytes
-                    BESDEBUG("dmrpp",
-                        "DmrppArray::"<< __func__ <<"() - Using memcpy to transfer " << prototype()->width() << " bytes." << endl);
-                    memcpy(target_buffer + target_char_start_index, source_buffer + chunk_char_start_index,
-                        prototype()->width());
-                }
-            }
-        }
-    }
-    else {
-        // Not the last dimension, so we continue to proceed down the Recursion Branch.
-        for (unsigned int dim_index = chunk_start; dim_index <= chunk_end; dim_index += thisDim.stride) {
-            (*target_element_address)[dim] = (chunk_origin[dim] + dim_index - thisDim.start) / thisDim.stride;
-            (*chunk_source_address)[dim] = dim_index;
-
-            BESDEBUG("dmrpp",
-                "DmrppArray::" << __func__ << "() - RECURSION STEP - " << "Departing dim: " << dim << " dim_index: " << dim_index << " target_element_address: " << vec2str((*target_element_address)) << " chunk_source_address: " << vec2str((*chunk_source_address)) << endl);
-
-            // Re-entry here:
-            bool flag = insert_constrained_chunk(dim + 1, target_element_address, chunk_source_address, chunk, multi_handle);
-            if(flag)
-                return true;
-        }
-    }
-    return false;
-}
-
 /**
  * Reads chunked array data from the relevant sources (as indicated by each
  * H4ByteStream object) for this array.
@@ -802,6 +811,11 @@ bool DmrppArray::read()
 {
     if (read_p()) return true;
 
+    // If the data are in a compressed local file, all of the array's byte
+    // streams are read using one index of that file
+    vector<H4ByteStream> *chunk_refs = get_chunk_vec();
+    CompressedFileScope compressed_file(chunk_refs->empty() ? "" : (*chunk_refs)[0].get_data_url());
+
     // IF the variable is not chunked then go read it.
     if (get_chunk_dimension_sizes().empty()) {
         if (get_immutable_chunks().size() == 1) {
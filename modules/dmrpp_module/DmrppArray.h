@@ -62,19 +62,7 @@ private:
     virtual bool read_no_chunks();
     virtual bool read_chunks();
 
-    void insert_constrained_no_chunk(
-			Dim_iter p,
-			unsigned long *target_index,
-			std::vector<unsigned int> &subsetAddress,
-			const std::vector<unsigned int> &array_shape,
-			H4ByteStream *h4bytestream);
-
-    virtual bool insert_constrained_chunk(
-    		unsigned int dim,
-    		std::vector<unsigned int> *target_address,
-    		std::vector<unsigned int> *chunk_source_address,
-    		H4ByteStream *chunk,
-    		CURLM *multi_handle);
+    void read_constrained_no_chunk(const H4ByteStream &h4bytestream);
 
     void multi_finish(CURLM *curl_multi_handle, std::vector<H4ByteStream> *chunk_refs);
 
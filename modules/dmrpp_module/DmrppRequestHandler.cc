@@ -111,6 +111,15 @@ DmrppRequestHandler::DmrppRequestHandler(const string &name) :
 #endif
 
     curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    // Each read() uses its own curl handle or file descriptor, so several
+    // variables can be read at once. The prefetch threads are silenced, so
+    // the BESDEBUG and BESStopWatch output in the read() methods only comes
+    // from reads made by the main thread.
+    set_thread_safe_read(true);
+
+    // The data are in the files the DMR++ names, not in the DMR++ itself
+    set_reads_other_files(true);
 }
 
 DmrppRequestHandler::~DmrppRequestHandler()
@@ -23,10 +23,14 @@
 
 #include "config.h"
 
+#include <pthread.h>
+
 #include <sstream>
 #include <string.h>
 
 #include <string>
+#include <map>
+#include <memory>
 #include <cassert>
 
 #include <curl/curl.h>
@@ -35,6 +39,10 @@
 
 #include <BESError.h>
 #include <BESDebug.h>
+#include <BESTracer.h>
+#include <BESUncompressManager3.h>
+#include <BESUncompressIndex.h>
+#include <BESUncompressCache.h>
 
 #include "DmrppCommon.h"
 #include "H4ByteStream.h"
@@ -84,6 +92,7 @@ size_t h4bytestream_write_data(void *buffer, size_t size, size_t nmemb, void *da
     memcpy(h4bs->get_rbuf() + bytes_read, buffer, nbytes);
 
     h4bs->set_bytes_read(bytes_read + nbytes);
+    BESTracer::count_read(nbytes);
 
     BESDEBUG("dmrpp", __func__ << "() - END "
 			<< " bytes_read: " << h4bs->get_bytes_read() << endl);
@@ -91,6 +100,154 @@ size_t h4bytestream_write_data(void *buffer, size_t size, size_t nmemb, void *da
     return nbytes;
 }
 
+// The uncompress cache is not thread safe and DMR++ variables may be read
+// by the prefetch threads, so the indexes are opened, read and closed by one
+// thread at a time. The indexes held open by CompressedFileScope objects are
+// keyed by URL.
+static pthread_mutex_t compressed_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+struct compressed_file {
+    BESUncompressIndex *index;
+    unsigned int users;
+};
+
+static map<string, compressed_file> compressed_files;
+
+// Lock compressed_file_mutex for the life of a block
+class compressed_file_lock {
+public:
+    compressed_file_lock() { pthread_mutex_lock(&compressed_file_mutex); }
+    ~compressed_file_lock() { pthread_mutex_unlock(&compressed_file_mutex); }
+};
+
+// If url names a local file that the BES can read parts of once it is
+// uncompressed (BES.Uncompress.Seekable and a .gz or .bz2 file), return its
+// path. Otherwise return the empty string; the file is read with libcurl.
+// Call with compressed_file_mutex locked.
+static string compressed_file_path(const string &url)
+{
+    string file_url("file://");
+    if (url.compare(0, file_url.size(), file_url)) return "";
+
+    string path = url.substr(file_url.size());
+    string::size_type dot = path.rfind('.');
+    if (dot == string::npos) return "";
+
+    BESUncompressManager3 *manager = BESUncompressManager3::TheManager();
+    if (!manager->is_seekable() || !manager->find_method(path.substr(dot + 1))) return "";
+
+    return path;
+}
+
+// Open the index of a compressed file. The offsets in a DMR++ are those of
+// the uncompressed data, so if there is no index the file cannot be read.
+// Call with compressed_file_mutex locked.
+static BESUncompressIndex *open_index(const string &path)
+{
+    BESFileLockingCache *cache = BESUncompressCache::get_instance();
+    BESUncompressIndex *index = cache ? BESUncompressManager3::TheManager()->get_index(path, cache) : 0;
+    if (!index) {
+        string msg = "DMR++: Could not index the compressed file " + path
+            + (cache ? "." : "; the uncompress cache is not configured.");
+        throw BESError(msg, BES_INTERNAL_ERROR, __FILE__, __LINE__);
+    }
+
+    return index;
+}
+
+/**
+ * @brief Hold the index of a compressed local file open
+ *
+ * While this object exists, the byte streams read from url share one index,
+ * so the index is opened and its access points loaded once, and the piece
+ * of the file last uncompressed is reused by the next read. Does nothing if
+ * url does not name a compressed local file.
+ *
+ * @param url The data URL of the byte streams that will be read
+ * @exception BESError if the file is compressed but cannot be indexed
+ */
+CompressedFileScope::CompressedFileScope(const string &url)
+{
+    compressed_file_lock lock;
+
+    if (compressed_file_path(url).empty()) return;
+
+    map<string, compressed_file>::iterator i = compressed_files.find(url);
+    if (i == compressed_files.end()) {
+        compressed_file file;
+        file.index = open_index(compressed_file_path(url));
+        file.users = 0;
+        i = compressed_files.insert(make_pair(url, file)).first;
+    }
+
+    ++i->second.users;
+    d_url = url;
+}
+
+/// Close the index (releasing its lock on the cache file) if no other scope uses it
+CompressedFileScope::~CompressedFileScope()
+{
+    if (d_url.empty()) return;
+
+    compressed_file_lock lock;
+
+    map<string, compressed_file>::iterator i = compressed_files.find(d_url);
+    if (i != compressed_files.end() && --i->second.users == 0) {
+        delete i->second.index;
+        compressed_files.erase(i);
+    }
+}
+
+/**
+ * @brief Read a byte stream from a local .gz or .bz2 file
+ *
+ * The offsets in a DMR++ are those of the uncompressed data, so libcurl
+ * cannot read a file:// URL that names a compressed file. When the BES can
+ * read parts of compressed files (BES.Uncompress.Seekable), read the range
+ * through the file's index in the uncompress cache instead; only the parts
+ * of the file that hold the range are uncompressed. The index held by a
+ * CompressedFileScope is used if there is one.
+ *
+ * @param url The data URL
+ * @param h4bs Read this H4ByteStream's range into its buffer
+ * @return True if the range was read, false if url does not name a
+ * compressed local file or the BES cannot read parts of those files. In
+ * that case the caller reads url itself.
+ * @exception BESError if the file is compressed but cannot be indexed
+ */
+bool read_compressed_file_range(const string &url, H4ByteStream *h4bs)
+{
+    compressed_file_lock lock;
+
+    string path = compressed_file_path(url);
+    if (path.empty()) return false;
+
+    auto_ptr<BESUncompressIndex> own_index;
+    BESUncompressIndex *index;
+    map<string, compressed_file>::iterator i = compressed_files.find(url);
+    if (i != compressed_files.end()) {
+        index = i->second.index;
+    }
+    else {
+        own_index.reset(open_index(path));
+        index = own_index.get();
+    }
+
+    BESDEBUG("dmrpp", __func__ << "() - Reading " << h4bs->get_size() << " bytes at " << h4bs->get_offset()
+        << " of the uncompressed data of " << url << endl);
+
+    unsigned long long bytes_read = h4bs->get_bytes_read();
+    assert(bytes_read + h4bs->get_size() <= h4bs->get_rbuf_size());
+
+    // A short read (past the end of the data) is found by the caller's byte count check
+    size_t nbytes = index->read(h4bs->get_offset(), h4bs->get_rbuf() + bytes_read, h4bs->get_size());
+
+    h4bs->set_bytes_read(bytes_read + nbytes);
+    BESTracer::count_read(nbytes);
+
+    return true;
+}
+
 /**
  * @brief Read data using HTTP/File Range GET
  *
@@ -107,6 +264,8 @@ void curl_read_byte_stream(const string &url, const string &range, void *user_da
     		<< " range: " << range
 			<< endl);
 
+    if (read_compressed_file_range(url, reinterpret_cast<H4ByteStream*>(user_data))) return;
+
     CURL* curl = curl_easy_init();
     if (curl) {
         CURLcode res = curl_easy_setopt(curl, CURLOPT_URL, url.c_str() /*"http://example.com"*/);
@@ -117,6 +276,10 @@ void curl_read_byte_stream(const string &url, const string &range, void *user_da
         res = curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, buf);
         if (res != CURLE_OK) throw BESError(string(curl_easy_strerror(res)), BES_INTERNAL_ERROR, __FILE__, __LINE__);
 
+        // This may run on a worker thread; curl's DNS timeouts must not use signals
+        if (CURLE_OK != curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L)) throw BESError(
+                string("HTTP Error: ").append(buf), BES_INTERNAL_ERROR, __FILE__, __LINE__);
+
         // get the offset to offset + size bytes
         if (CURLE_OK != curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str() /*"0-199"*/)) throw BESError(
                 string("HTTP Error: ").append(buf), BES_INTERNAL_ERROR, __FILE__, __LINE__);
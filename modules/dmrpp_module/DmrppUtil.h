@@ -29,6 +29,29 @@
 
 namespace dmrpp {
 
+class H4ByteStream;
+
+/**
+ * @brief Share one index among the reads of a compressed local file
+ *
+ * DmrppArray::read() makes one of these so that the byte streams of the
+ * array (which may be many chunks) use the same index of a .gz or .bz2
+ * file.
+ */
+class CompressedFileScope {
+private:
+    std::string d_url;
+
+    CompressedFileScope(const CompressedFileScope &);
+    CompressedFileScope &operator=(const CompressedFileScope &);
+
+public:
+    CompressedFileScope(const std::string &url);
+    virtual ~CompressedFileScope();
+};
+
+bool read_compressed_file_range(const std::string &url, H4ByteStream *h4bs);
+
 size_t h4bytestream_write_data(void *buffer, size_t size, size_t nmemb, void *data);
 
 void curl_read_byte_stream(const std::string &url, const std::string& range, void *user_data);
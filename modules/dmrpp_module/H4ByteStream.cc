@@ -30,6 +30,7 @@
 #include <BESDebug.h>
 #include <BESError.h>
 #include <BESContextManager.h>
+#include <BESStopWatch.h>
 
 #include "H4ByteStream.h"
 #include "DmrppUtil.h"
@@ -198,6 +199,14 @@ void H4ByteStream::add_to_multi_read_queue(CURLM *multi_handle)
     }
     /** - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 #endif
+
+    // A compressed local file is read now, through its index; read() then
+    // finds the bytes already in the buffer.
+    if (read_compressed_file_range(data_access_url, this)) {
+        d_is_in_multi_queue = true;
+        return;
+    }
+
     string range = get_curl_range_arg_string();
 
     BESDEBUG(debug,
@@ -335,6 +344,9 @@ void H4ByteStream::read(bool deflate, unsigned int chunk_size, bool shuffle, uns
         return;
     }
 
+    BESStopWatch sw;
+    if (BESISTIMING) sw.start("H4ByteStream::read", to_string());
+
     if(!d_is_in_multi_queue){
 
         // This call uses the internal size param and allocates the buffer's memory
@@ -355,6 +355,62 @@ public:
         CPPUNIT_ASSERT("Passed");
     }
 
+    /**
+     * Tests the twoD array (four 50x50 chunks) against a CE with strides
+     * that do not divide the chunk size, so the values selected start at
+     * a different place in each chunk and the inner rows are gathered.
+     */
+    void test_chunked_twoD_CE_00()
+    {
+        string filename = string(TEST_DATA_DIR).append("/").append("chunked_twoD.h5.dmrpp");
+        string variable_name = "d_4_chunks";
+        auto_ptr<DMR> dmr(new DMR);
+        DmrppTypeFactory dtf;
+        dmr->set_factory(&dtf);
+
+        BESDEBUG("dmrpp", __func__ << "() - Opening: " << filename << endl);
+
+        ifstream in(filename.c_str());
+        parser.intern(in, dmr.get(), debug);
+        BESDEBUG("dmrpp", __func__ << "() - Parsing complete"<< endl);
+
+        D4Group *root = dmr->root();
+        checkGroupsAndVars(root, "/", 0, 1);
+        D4Group::Vars_iter vIter = root->var_begin();
+        try {
+            DmrppArray *var = dynamic_cast<DmrppArray*>(*vIter);
+
+            unsigned int row_start = 3, row_stride = 7, row_stop = 98;
+            unsigned int col_start = 10, col_stride = 3, col_stop = 80;
+            DmrppArray::Dim_iter dimIter = var->dim_begin();
+            var->add_constraint(dimIter++, row_start, row_stride, row_stop);
+            var->add_constraint(dimIter++, col_start, col_stride, col_stop);
+
+            unsigned int rows = 1 + (row_stop - row_start) / row_stride;
+            unsigned int cols = 1 + (col_stop - col_start) / col_stride;
+            read_var_check_name_and_length(var, variable_name, rows * cols);
+            vector<dods_float32> values(var->length());
+            var->value(&values[0]);
+
+            // Test data set is incrementally valued
+            for (unsigned int r = 0; r < rows; r++) {
+                for (unsigned int c = 0; c < cols; c++) {
+                    dods_float32 test_float32 = (row_start + r * row_stride) * 100 + col_start + c * col_stride;
+                    CPPUNIT_ASSERT(double_eq(values[r * cols + c], test_float32));
+                }
+            }
+        }
+        catch (BESError &e) {
+            CPPUNIT_FAIL(e.get_message());
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message());
+        }
+        catch (std::exception &e) {
+            CPPUNIT_FAIL(e.what());
+        }
+    }
+
     void test_read_oneD_chunked_array()
     {
         string chnkd_oneD = string(TEST_DATA_DIR).append("/").append("chunked_oneD.h5.dmrpp");
@@ -569,6 +625,7 @@ public:
     CPPUNIT_TEST(test_read_fourD_chunked_array);
     CPPUNIT_TEST(test_chunked_oneD_CE_00);
     CPPUNIT_TEST(test_chunked_oneD_CE_01);
+    CPPUNIT_TEST(test_chunked_twoD_CE_00);
     CPPUNIT_TEST(test_read_oneD_uneven_chunked_array);
     CPPUNIT_TEST(test_read_twoD_uneven_chunked_array);
 #if 1
@@ -849,6 +849,73 @@ public:
         CPPUNIT_ASSERT("Passed");
     }
 
+    /**
+     * Read the SST variable of coads_climatology (an unchunked array) with
+     * constraints that select whole rows and single values, and check the
+     * values against those of the unconstrained array.
+     */
+    void test_constrained_coads_ranges() {
+        auto_ptr<DMR> dmr(new DMR);
+        DmrppTypeFactory dtf;
+        dmr->set_factory(&dtf);
+        string coads = string(TEST_DATA_DIR).append("/").append("coads_climatology.dmrpp");
+        BESDEBUG("dmrpp", "Opening: " << coads << endl);
+        ifstream in(coads.c_str());
+        parser.intern(in, dmr.get(), debug);
+        D4Group *root = dmr->root();
+        checkGroupsAndVars(root, "/", 0, 7);
+        D4Group::Vars_iter vIter = root->var_begin();
+        vIter++; // COADSY
+        vIter++; // TIME
+        vIter++; // SST
+        try {
+            DmrppArray *sst = dynamic_cast<DmrppArray*>(*vIter);
+            // Copy SST before read_var_check_name_and_length() changes its data URL
+            DmrppArray *sst_all = dynamic_cast<DmrppArray*>(sst->ptr_duplicate());
+            auto_ptr<DmrppArray> sst_all_ptr(sst_all);
+            DmrppArray *sst_point = dynamic_cast<DmrppArray*>(sst->ptr_duplicate());
+            auto_ptr<DmrppArray> sst_point_ptr(sst_point);
+
+            read_var_check_name_and_length(sst_all,"SST",194400);
+            vector<dods_float32> all_vals(sst_all->length());
+            sst_all->value(&all_vals[0]);
+
+            // Whole rows; each time step is one byte range
+            DmrppArray::Dim_iter dimIter = sst->dim_begin();
+            sst->add_constraint(dimIter++,3,5,8);
+            sst->add_constraint(dimIter++,23,1,25);
+            sst->add_constraint(dimIter++,0,1,179);
+            read_var_check_name_and_length(sst,"SST",2*3*180);
+            vector<dods_float32> sst_vals(sst->length());
+            sst->value(&sst_vals[0]);
+            int index = 0;
+            for (int t = 3; t <= 8; t += 5)
+                for (int y = 23; y <= 25; ++y)
+                    for (int x = 0; x < 180; ++x)
+                        CPPUNIT_ASSERT(double_eq(sst_vals[index++], all_vals[t*90*180 + y*180 + x]));
+
+            // One value from each time step
+            dimIter = sst_point->dim_begin();
+            sst_point->add_constraint(dimIter++,0,1,11);
+            sst_point->add_constraint(dimIter++,40,1,40);
+            sst_point->add_constraint(dimIter++,100,1,100);
+            read_var_check_name_and_length(sst_point,"SST",12);
+            vector<dods_float32> point_vals(sst_point->length());
+            sst_point->value(&point_vals[0]);
+            for (int t = 0; t < 12; ++t)
+                CPPUNIT_ASSERT(double_eq(point_vals[t], all_vals[t*90*180 + 40*180 + 100]));
+        }
+        catch (BESError &e) {
+            CPPUNIT_FAIL(e.get_message());
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message());
+        }
+        catch (std::exception &e) {
+            CPPUNIT_FAIL(e.what());
+        }
+    }
+
     CPPUNIT_TEST_SUITE( DmrppTypeReadTest );
 
     CPPUNIT_TEST(test_integer_scalar);
@@ -857,6 +924,7 @@ public:
     CPPUNIT_TEST(test_constrained_arrays);
     CPPUNIT_TEST(test_read_coads_climatology);
     CPPUNIT_TEST(test_constrained_coads_climatology);
+    CPPUNIT_TEST(test_constrained_coads_ranges);
 
 
     CPPUNIT_TEST_SUITE_END();
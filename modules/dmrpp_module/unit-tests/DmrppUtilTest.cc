@@ -23,6 +23,12 @@
 // You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
 
 #include <memory>
+#include <fstream>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
 
 #include <cppunit/TextTestRunner.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
@@ -30,8 +36,11 @@
 
 #include <BESError.h>
 #include <BESDebug.h>
+#include <TheBESKeys.h>
+#include <BESUncompressCache.h>
 
 #include "DmrppUtil.h"
+#include "H4ByteStream.h"
 
 #include "GetOpt.h"
 #include "test_config.h"
@@ -61,7 +70,10 @@ public:
     // Called before each test
     void setUp()
     {
-        if (bes_debug) BESDebug::SetUp("cerr,dmrpp");
+        // Turns on BES.Uncompress.Seekable
+        TheBESKeys::ConfigFile = string(TEST_SRC_DIR).append("/DmrppUtilTest_bes.keys");
+
+        if (bes_debug) BESDebug::SetUp("cerr,dmrpp,uncompress");
     }
 
     // Called after each test
@@ -237,6 +249,77 @@ public:
         }
     }
 
+    // Write a gzip compressed copy of a file
+    void make_gz(const string &src, const string &dest)
+    {
+        ifstream ifs(src.c_str());
+        string data((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+        CPPUNIT_ASSERT(!data.empty());
+
+        gzFile gz = gzopen(dest.c_str(), "wb");
+        CPPUNIT_ASSERT(gz);
+        CPPUNIT_ASSERT(gzwrite(gz, data.data(), data.size()) == (int) data.size());
+        CPPUNIT_ASSERT(gzclose(gz) == Z_OK);
+    }
+
+    // A chunk of a compressed local file is read through the file's index,
+    // using the offset of the chunk in the uncompressed file
+    void test_read_compressed_file_range()
+    {
+        string cache_dir = string(TEST_SRC_DIR).append("/cache");
+        string gz_file = cache_dir + "/dmrpp_chunked_oneD.h5.gz";
+        mkdir(cache_dir.c_str(), 0755);
+        BESUncompressCache *cache = BESUncompressCache::get_instance(cache_dir, cache_dir, "dmrpp_cache", 100);
+        CPPUNIT_ASSERT(cache);
+        try {
+
+            make_gz(test_data_dir + "/chunked_oneD.h5", gz_file);
+
+            const unsigned int chunk_size = 40000; // bytes
+            H4ByteStream h4bs("file://" + gz_file, chunk_size, 3496, "", "");
+            h4bs.read();
+
+            CPPUNIT_ASSERT(h4bs.get_bytes_read() == chunk_size);
+            for (unsigned int i = 0; i < chunk_size / sizeof(dods_float32); ++i) {
+                dods_float32 value = *(reinterpret_cast<dods_float32*>(h4bs.get_rbuf() + i * sizeof(dods_float32)));
+                CPPUNIT_ASSERT(double_eq(value, i));
+            }
+
+            // The file was not uncompressed into the cache
+            CPPUNIT_ASSERT(access(cache->get_cache_file_name(gz_file).c_str(), F_OK) != 0);
+
+            // Within a scope, byte streams share the file's index
+            {
+                CompressedFileScope scope("file://" + gz_file);
+                for (unsigned int offset = 3496; offset < 3496 + chunk_size; offset += chunk_size / 4) {
+                    H4ByteStream part("file://" + gz_file, chunk_size / 4, offset, "", "");
+                    part.read();
+                    CPPUNIT_ASSERT(part.get_bytes_read() == chunk_size / 4);
+                    CPPUNIT_ASSERT(!memcmp(part.get_rbuf(), h4bs.get_rbuf() + offset - 3496, chunk_size / 4));
+                }
+            }
+
+            // A compressed file that cannot be indexed is an error, not a read of the compressed bytes
+            H4ByteStream missing("file://" + cache_dir + "/dmrpp_missing.h5.gz", chunk_size, 3496, "", "");
+            CPPUNIT_ASSERT_THROW(missing.read(), BESError);
+
+            // Files that are not compressed are left to libcurl
+            H4ByteStream plain("file://" + test_data_dir + "/chunked_oneD.h5", chunk_size, 3496, "", "");
+            plain.set_rbuf_to_size();
+            CPPUNIT_ASSERT(!read_compressed_file_range(plain.get_data_url(), &plain));
+            CPPUNIT_ASSERT(plain.get_bytes_read() == 0);
+        }
+        catch (BESError &e) {
+            CPPUNIT_FAIL(e.get_message());
+        }
+        catch (exception &e) {
+            CPPUNIT_FAIL(e.what());
+        }
+
+        unlink(gz_file.c_str());
+        unlink((cache->get_cache_file_name(gz_file) + ".idx").c_str());
+    }
+
     CPPUNIT_TEST_SUITE( DmrppUtilTest );
 
     CPPUNIT_TEST(test_uncompressed_chunk);
@@ -255,6 +338,7 @@ public:
 #endif
 
     CPPUNIT_TEST(test_unshuffle3);
+    CPPUNIT_TEST(test_read_compressed_file_range);
 
     CPPUNIT_TEST_SUITE_END();
 };
@@ -342,3 +342,9 @@ double *FONgGrid::get_data()
     return extract_double_array(d_grid->get_array());
 }
 
+libdap::Array *FONgGrid::get_array()
+{
+    if (!d_grid->get_array()->read_p()) d_grid->get_array()->read();
+
+    return d_grid->get_array();
+}
@@ -76,6 +76,8 @@ public:
     string get_projection(libdap::DDS *dds);
     ///Get the data values for the band(s). Call must delete.
     virtual double *get_data();
+    ///Get the Grid's Array, reading it if needed. The values keep their type.
+    virtual libdap::Array *get_array();
     virtual libdap::Type type() { return d_type; }
     FONgGrid(): d_name(""), d_type(libdap::dods_null_c) {}
 
@@ -25,6 +25,7 @@
 #include "config.h"
 
 #include <cstdlib>
+#include <algorithm>
 
 #include <gdal.h>
 #include <gdal_priv.h>
@@ -40,6 +41,7 @@
 #include <BESDebug.h>
 #include <BESInternalError.h>
 
+#include "GeoTiffTransmitter.h"
 #include "FONgTransform.h"
 
 // #include "../../old/FONgBaseType.h"
@@ -48,6 +50,9 @@
 using namespace std;
 using namespace libdap;
 
+// Without tiles, build overviews until they are smaller than this
+#define FONG_OVERVIEW_MIN_SIZE 256
+
 /** @brief Constructor that creates transformation object from the specified
  * DataDDS object to the specified file
  *
@@ -303,11 +308,197 @@ static void find_vars(DDS *dds, FONgTransform &t)
     }
 }
 
+/** @brief The GDAL type that holds an Array's values without conversion
+ *
+ * @return The GDAL type or GDT_Unknown if GDAL has no matching type, in
+ * which case the values have to be converted to doubles.
+ */
+static GDALDataType native_type(Array *a)
+{
+    switch (a->var()->type()) {
+    case dods_byte_c:
+    case dods_uint8_c:
+        return GDT_Byte;
+    case dods_int16_c:
+        return GDT_Int16;
+    case dods_uint16_c:
+        return GDT_UInt16;
+    case dods_int32_c:
+        return GDT_Int32;
+    case dods_uint32_c:
+        return GDT_UInt32;
+    case dods_float32_c:
+        return GDT_Float32;
+    case dods_float64_c:
+        return GDT_Float64;
+    default:
+        return GDT_Unknown;
+    }
+}
+
+/** @brief The type of the bands in the response
+ *
+ * All the bands of a GDAL dataset share one type. If every variable has the
+ * same type, and GDAL has that type, use it; otherwise use Float64.
+ */
+static GDALDataType band_type(FONgTransform &t)
+{
+    GDALDataType type = GDT_Unknown;
+    for (int i = 0; i < t.num_bands(); ++i) {
+        GDALDataType var_type = native_type(t.var(i)->get_array());
+        if (var_type == GDT_Unknown || (i > 0 && var_type != type))
+            return GDT_Float64;
+        type = var_type;
+    }
+
+    return type == GDT_Unknown ? GDT_Float64 : type;
+}
+
+/** @brief Are the latitude values of this variable in ascending order?
+ *
+ * If they are, the rows have to be written bottom to top.
+ */
+bool FONgTransform::m_lat_reversed(FONgGrid *fbtp)
+{
+    // If the latitude values are inverted, the 0th value will be less than
+    // the last value.
+    vector<double> local_lat;
+    extract_double_array(fbtp->d_lat, local_lat);
+
+    return local_lat[0] < local_lat[local_lat.size() - 1];
+}
+
+/** @brief Write one variable's values to a band
+ *
+ * The values are written from the Array's own buffer, in their own type
+ * (GDAL converts them to the band's type if needed), one row of blocks at
+ * a time so that the GDAL block cache never holds more than that. If the
+ * latitude values are in ascending order, the rows are written in reverse
+ * order by using a negative line spacing, so no copy is made.
+ *
+ * @param band Write to this band
+ * @param fbtp The variable
+ */
+void FONgTransform::m_write_band(GDALRasterBand *band, FONgGrid *fbtp)
+{
+    Array *a = fbtp->get_array();
+    if (a->length() != width() * height())
+        throw Error("The variable '" + a->name() + "' does not match the size of its latitude and longitude maps.");
+
+    GDALDataType buf_type = native_type(a);
+    vector<double> values;
+    char *buf;
+    if (buf_type == GDT_Unknown) {
+        // GDAL has no type for these values; fall back to doubles
+        extract_double_array(a, values);
+        buf = reinterpret_cast<char*>(&values[0]);
+        buf_type = GDT_Float64;
+    }
+    else {
+        buf = a->get_buf();
+    }
+
+    GSpacing line = static_cast<GSpacing>(width()) * GDALGetDataTypeSize(buf_type) / 8;
+    bool reversed = m_lat_reversed(fbtp);
+    BESDEBUG("fong3", "Writing " << (reversed ? "reversed " : "") << "raster for " << a->name() << endl);
+
+    int block_x, block_y;
+    band->GetBlockSize(&block_x, &block_y);
+
+    for (int row = 0; row < height(); row += block_y) {
+        int rows = min(block_y, height() - row);
+        // Image row 'row' is the data's row 'row' or, when reversed, 'height() - row - 1'
+        char *first = reversed ? buf + (height() - row - 1) * line : buf + row * line;
+
+        CPLErr error = band->RasterIO(GF_Write, 0, row, width(), rows, first, width(), rows, buf_type, 0,
+            reversed ? -line : line);
+        if (error != CPLE_None)
+            throw Error("Could not write data for band: " + long_to_string(band->GetBand()) + ": " + string(CPLGetLastErrorMsg()));
+
+        // Write the finished blocks now, not when the cache fills
+        band->FlushCache();
+    }
+}
+
+/** @brief Build the creation options for a tiled, compressed GeoTiff
+ *
+ * @param type The type of the bands
+ * @param cog True if the options are for the COG driver
+ * @return The options; free with CSLDestroy()
+ */
+static char **geotiff_options(GDALDataType type, bool cog)
+{
+    char **options = NULL;
+
+    string compression = GeoTiffTransmitter::compression;
+    if (compression != "NONE") {
+        options = CSLSetNameValue(options, "COMPRESS", compression.c_str());
+        // A predictor makes DEFLATE, LZW and ZSTD far more effective on gridded data
+        if (compression == "DEFLATE" || compression == "LZW" || compression == "ZSTD") {
+            if (cog)
+                options = CSLSetNameValue(options, "PREDICTOR", "YES");
+            else
+                options = CSLSetNameValue(options, "PREDICTOR",
+                    (type == GDT_Float32 || type == GDT_Float64) ? "3" : "2");
+        }
+    }
+
+    options = CSLSetNameValue(options, "BIGTIFF", "IF_SAFER");
+
+    if (cog) {
+        // The COG driver always tiles
+        if (GeoTiffTransmitter::block_size > 0)
+            options = CSLSetNameValue(options, "BLOCKSIZE", long_to_string(GeoTiffTransmitter::block_size).c_str());
+        options = CSLSetNameValue(options, "OVERVIEWS", GeoTiffTransmitter::overviews ? "AUTO" : "NONE");
+        options = CSLSetNameValue(options, "RESAMPLING", "NEAREST");
+    }
+    else {
+        // NB: Changing PHOTOMETIC to MINISWHITE doesn't seem to have any visible affect,
+        // although the resulting files differ. jhrg 11/21/12
+        options = CSLSetNameValue(options, "PHOTOMETRIC", "MINISBLACK"); // The default for GDAL
+        // One band at a time is written, so keep each band's blocks together
+        options = CSLSetNameValue(options, "INTERLEAVE", "BAND");
+        if (GeoTiffTransmitter::block_size > 0) {
+            options = CSLSetNameValue(options, "TILED", "YES");
+            options = CSLSetNameValue(options, "BLOCKXSIZE", long_to_string(GeoTiffTransmitter::block_size).c_str());
+            options = CSLSetNameValue(options, "BLOCKYSIZE", long_to_string(GeoTiffTransmitter::block_size).c_str());
+        }
+    }
+
+    return options;
+}
+
+/** @brief Add overviews, halving the size until they fit in one block */
+static void build_overviews(GDALDataset *ds)
+{
+    int size = max(ds->GetRasterXSize(), ds->GetRasterYSize());
+    int block = GeoTiffTransmitter::block_size > 0 ? GeoTiffTransmitter::block_size : FONG_OVERVIEW_MIN_SIZE;
+
+    vector<int> levels;
+    for (int level = 2; size / level >= block; level *= 2)
+        levels.push_back(level);
+
+    if (levels.empty()) return;
+
+    BESDEBUG("fong3", "Building " << levels.size() << " overviews" << endl);
+    if (ds->BuildOverviews("NEAREST", levels.size(), &levels[0], 0, 0, NULL, NULL) != CE_None)
+        throw Error("Could not build the overviews: " + string(CPLGetLastErrorMsg()));
+}
+
 /** @brief Transforms the variables of the DataDDS to a GeoTiff file.
  *
  * Scan the DDS of the dataset and find the Grids that have been projected.
  * Try to render their content as a GeoTiff. The result is a N-band GeoTiff
  * file.
+ *
+ * The bands have the type of the variables when they all share one (Byte
+ * stays Byte) and are written tiled and compressed (see fong.conf). Values
+ * are written band by band, one row of tiles at a time, from the variables'
+ * own buffers. Missing values are recorded as the bands' NoData value.
+ *
+ * When the GDAL library has the COG driver, the result is a Cloud Optimized
+ * GeoTiff. Since that driver can only copy a dataset, the bands are first
+ * written to a tiled GeoTiff next to the result, which is then removed.
  */
 void FONgTransform::transform_to_geotiff()
 {
@@ -332,93 +523,82 @@ void FONgTransform::transform_to_geotiff()
     if (!CSLFetchBoolean(Metadata, GDAL_DCAP_CREATE, FALSE))
         throw Error("Could not make output format.");
 
-    BESDEBUG("fong3", "num_bands: " << num_bands() << "." << endl);
+    GDALDriver *cog_driver = 0;
+    if (GeoTiffTransmitter::cloud_optimized) {
+        cog_driver = GetGDALDriverManager()->GetDriverByName("COG");
+        if (!cog_driver)
+            BESDEBUG("fong3", "No COG driver; writing a tiled GeoTiff." << endl);
+    }
 
-    // NB: Changing PHOTOMETIC to MINISWHITE doesn't seem to have any visible affect,
-    // although the resulting files differ. jhrg 11/21/12
-    char **options = NULL;
-    options = CSLSetNameValue(options, "PHOTOMETRIC", "MINISBLACK" ); // The default for GDAL
-    d_dest = Driver->Create(d_localfile.c_str(), width(), height(), num_bands(), GDT_Float64, options);
+    GDALDataType type = band_type(*this);
+    BESDEBUG("fong3", "num_bands: " << num_bands() << ", type: " << GDALGetDataTypeName(type) << "." << endl);
+
+    // With the COG driver, the bands are written to this file and then copied
+    string dest_file = cog_driver ? d_localfile + ".tiled" : d_localfile;
+
+    char **options = geotiff_options(type, false);
+    d_dest = Driver->Create(dest_file.c_str(), width(), height(), num_bands(), type, options);
+    CSLDestroy(options);
     if (!d_dest)
         throw Error("Could not create the geotiff dataset: " + string(CPLGetLastErrorMsg()));
 
-    d_dest->SetGeoTransform(geo_transform());
-    // Take the mapping data from the first variable
-    // var(0)->get_projection(d_dds, d_dest);
+    GDALDataset *cog_dst = 0;
+    try {
+        d_dest->SetGeoTransform(geo_transform());
 
-    BESDEBUG("fong3", "Made new temp file and set georeferencing (" << num_bands() << " vars)." << endl);
+        BESDEBUG("fong3", "Made new temp file and set georeferencing (" << num_bands() << " vars)." << endl);
 
-    bool projection_set = false;
-    string wkt = "";
-    for (int i = 0; i < num_bands(); ++i) {
-        FONgGrid *fbtp = var(i);
+        bool projection_set = false;
+        string wkt = "";
+        for (int i = 0; i < num_bands(); ++i) {
+            FONgGrid *fbtp = var(i);
 
-        if (!projection_set) {
-            wkt = fbtp->get_projection(d_dds);
-            if (d_dest->SetProjection(wkt.c_str()) != CPLE_None)
-                throw Error("Could not set the projection: " + string(CPLGetLastErrorMsg()));
-            projection_set = true;
-        }
-        else {
-            string wkt_i = fbtp->get_projection(d_dds);
-            if (wkt_i != wkt)
-                throw Error("In building a multiband response, different bands had different projection information.");
-        }
-#if 0
-        d_dest->AddBand(GDT_Float64, 0);
-        GDALRasterBand *band = d_dest->GetRasterBand(d_dest->GetRasterCount());
-        if (!band)
-            throw Error("Could not get the " + long_to_string(i) + "th band: " + string(CPLGetLastErrorMsg()));
-#endif
-        GDALRasterBand *band = d_dest->GetRasterBand(i+1);
-        if (!band)
-            throw Error("Could not get the " + long_to_string(i+1) + "th band: " + string(CPLGetLastErrorMsg()));
+            if (!projection_set) {
+                wkt = fbtp->get_projection(d_dds);
+                if (d_dest->SetProjection(wkt.c_str()) != CPLE_None)
+                    throw Error("Could not set the projection: " + string(CPLGetLastErrorMsg()));
+                projection_set = true;
+            }
+            else {
+                string wkt_i = fbtp->get_projection(d_dds);
+                if (wkt_i != wkt)
+                    throw Error("In building a multiband response, different bands had different projection information.");
+            }
 
-        double *data = 0;
-        try {
-            // TODO We can read any of the basic DAP2 types and let RasterIO convert it to any other type.
-            data = fbtp->get_data();
+            GDALRasterBand *band = d_dest->GetRasterBand(i+1);
+            if (!band)
+                throw Error("Could not get the " + long_to_string(i+1) + "th band: " + string(CPLGetLastErrorMsg()));
 
-            // hack the values; because the missing value used with many datasets
-            // is often really small it'll skew the mapping of values to the grayscale
-            // that GDAL performs. Move the no_data values to something closer to the
-            // other values in the dataset.
+            // Readers skip the NoData value when they map the values to a
+            // grayscale, so the values need not be moved as m_scale_data() does.
             BESDEBUG("fong3", "no_data_type(): " << no_data_type() << endl);
             if (no_data_type() != none)
-                m_scale_data(data);
-
-            // If the latitude values are inverted, the 0th value will be less than
-            // the last value.
-            vector<double> local_lat;
-            extract_double_array(fbtp->d_lat, local_lat);
-
-            if (local_lat[0] < local_lat[local_lat.size() - 1]) {
-                BESDEBUG("fong3", "Writing reversed raster. Lat[0] = " << local_lat[0] << endl);
-                //---------- write reverse raster----------
-                for (int row = 0; row <= height()-1; ++row) {
-                    int offsety=height()-row-1;
-                    CPLErr error_write = band->RasterIO(GF_Write, 0, offsety, width(), 1, data+(row*width()), width(), 1, GDT_Float64, 0, 0);
-                    if (error_write != CPLE_None)
-                        throw Error("Could not write data for band: " + long_to_string(i + 1) + ": " + string(CPLGetLastErrorMsg()));
-                }
-            }
-            else {
-                BESDEBUG("fong3", "calling band->RasterIO" << endl);
-                CPLErr error = band->RasterIO(GF_Write, 0, 0, width(), height(), data, width(), height(), GDT_Float64, 0, 0);
-                if (error != CPLE_None)
-                     throw Error("Could not write data for band: " + long_to_string(i+1) + ": " + string(CPLGetLastErrorMsg()));
-            }
+                band->SetNoDataValue(no_data());
 
-            delete[] data;
+            m_write_band(band, fbtp);
+        }
 
+        if (cog_driver) {
+            options = geotiff_options(type, true);
+            cog_dst = cog_driver->CreateCopy(d_localfile.c_str(), d_dest, FALSE /*strict*/, options, NULL, NULL);
+            CSLDestroy(options);
+            if (!cog_dst)
+                throw Error("Could not create the cloud optimized geotiff dataset: " + string(CPLGetLastErrorMsg()));
         }
-        catch (...) {
-            delete[] data;
-            GDALClose(d_dest);
-            throw;
+        else if (GeoTiffTransmitter::overviews) {
+            build_overviews(d_dest);
         }
     }
+    catch (...) {
+        GDALClose(d_dest);
+        GDALClose(cog_dst);
+        if (cog_driver) VSIUnlink(dest_file.c_str());
+        throw;
+    }
+
     GDALClose(d_dest);
+    GDALClose(cog_dst);
+    if (cog_driver) VSIUnlink(dest_file.c_str());
 }
 
 /** @brief Transforms the variables of the DataDDS to a JPEG2000 file.
@@ -453,9 +633,14 @@ void FONgTransform::transform_to_jpeg2000()
     if (!CSLFetchBoolean(Metadata, GDAL_DCAP_CREATE, FALSE))
         throw Error("Driver JP2OpenJPEG does not support dataset creation.");
 
-    // No creation options for a memory dataset
-    // NB: This is where the type of the bands is set. JPEG2000 only supports integer types.
-    d_dest = Driver->Create("in_memory_dataset", width(), height(), num_bands(), GDT_Int32, 0 /*options*/);
+    // NB: This is where the type of the bands is set. JPEG2000 only supports integer types,
+    // so keep the variables' type if it is one of those.
+    GDALDataType type = band_type(*this);
+    if (type == GDT_Float32 || type == GDT_Float64)
+        type = GDT_Int32;
+
+    // No creation options for a memory dataset. The bands are added below.
+    d_dest = Driver->Create("in_memory_dataset", width(), height(), 0 /*bands*/, type, 0 /*options*/);
     if (!d_dest)
         throw Error("Could not create in-memory dataset: " + string(CPLGetLastErrorMsg()));
 
@@ -480,11 +665,35 @@ void FONgTransform::transform_to_jpeg2000()
                 throw Error("In building a multiband response, different bands had different projection information.");
         }
 
+        // When the values need no changes, the band uses the variable's
+        // values in place instead of a copy of them.
+        Array *a = fbtp->get_array();
+        bool shared = no_data_type() == none && native_type(a) == type && a->length() == width() * height()
+            && !m_lat_reversed(fbtp);
+
+        char **band_options = NULL;
+        if (shared) {
+            char pointer[64];
+            int len = CPLPrintPointer(pointer, a->get_buf(), sizeof(pointer) - 1);
+            pointer[len] = '\0';
+            band_options = CSLSetNameValue(band_options, "DATAPOINTER", pointer);
+        }
+
+        CPLErr error = d_dest->AddBand(type, band_options);
+        CSLDestroy(band_options);
+
         GDALRasterBand *band = d_dest->GetRasterBand(i+1);
-        if (!band)
+        if (error != CPLE_None || !band)
             throw Error("Could not get the " + long_to_string(i+1) + "th band: " + string(CPLGetLastErrorMsg()));
 
+        if (shared) continue;
+
         try {
+            if (no_data_type() == none) {
+                m_write_band(band, fbtp);
+                continue;
+            }
+
             // TODO We can read any of the basic DAP2 types and let RasterIO convert it to any other type.
             double *data = fbtp->get_data();
 
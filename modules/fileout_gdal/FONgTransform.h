@@ -28,6 +28,7 @@
 //#include <cstdlib>
 
 class GDALDataset;
+class GDALRasterBand;
 class BESDataHandlerInterface;
 class FONgGrid;
 
@@ -68,6 +69,8 @@ private:
 
     void m_scale_data(double *data);
     bool effectively_two_D(FONgGrid *fbtp);
+    bool m_lat_reversed(FONgGrid *fbtp);
+    void m_write_band(GDALRasterBand *band, FONgGrid *fbtp);
 
 public:
     FONgTransform(libdap::DDS *dds, libdap::ConstraintEvaluator &evaluator, const string &localfile);
@@ -34,6 +34,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 #include <DataDDS.h>
 #include <BaseType.h>
@@ -59,9 +60,27 @@ using namespace libdap;
 
 #define FONG_TEMP_DIR "/tmp"
 #define FONG_GCS "WGS84"
+#define FONG_COMPRESSION "DEFLATE"
+#define FONG_BLOCK_SIZE 256
 
 string GeoTiffTransmitter::temp_dir;
 string GeoTiffTransmitter::default_gcs;
+string GeoTiffTransmitter::compression;
+int GeoTiffTransmitter::block_size = 0;
+bool GeoTiffTransmitter::overviews = false;
+bool GeoTiffTransmitter::cloud_optimized = true;
+
+/// Read a yes/no BES key; 'value' is not changed if the key is not set
+static void get_bool_key(const string &key, bool &value)
+{
+    bool found = false;
+    string v;
+    TheBESKeys::TheKeys()->get_value(key, v, found);
+    if (found && !v.empty()) {
+        v = BESUtil::lowercase(v);
+        value = (v == "yes" || v == "true" || v == "on");
+    }
+}
 
 /** @brief Construct the GeoTiffTransmitter, adding it with name geotiff to be
  * able to transmit a data response
@@ -107,6 +126,30 @@ GeoTiffTransmitter::GeoTiffTransmitter() :  BESTransmitter()
             GeoTiffTransmitter::default_gcs = FONG_GCS;
         }
     }
+
+    if (GeoTiffTransmitter::compression.empty()) {
+        // Compress the tiles using which method? NONE turns compression off.
+        bool found = false;
+        string key = "FONg.GeoTiff.Compression";
+        TheBESKeys::TheKeys()->get_value(key, GeoTiffTransmitter::compression, found);
+        if (!found || GeoTiffTransmitter::compression.empty()) {
+            GeoTiffTransmitter::compression = FONG_COMPRESSION;
+        }
+
+        // The width and height of the tiles; 0 writes strips
+        string value;
+        found = false;
+        TheBESKeys::TheKeys()->get_value("FONg.GeoTiff.BlockSize", value, found);
+        GeoTiffTransmitter::block_size = FONG_BLOCK_SIZE;
+        if (found && !value.empty()) {
+            istringstream iss(value);
+            int size;
+            if (iss >> size && size >= 0) GeoTiffTransmitter::block_size = size;
+        }
+
+        get_bool_key("FONg.GeoTiff.Overviews", GeoTiffTransmitter::overviews);
+        get_bool_key("FONg.GeoTiff.CloudOptimized", GeoTiffTransmitter::cloud_optimized);
+    }
 }
 
 /** @brief The static method registered to transmit OPeNDAP data objects as
@@ -53,6 +53,12 @@ public:
     static void send_data_as_geotiff(BESResponseObject *obj, BESDataHandlerInterface &dhi);
 
     static string default_gcs;
+
+    // How GeoTiff responses are laid out; see fong.conf
+    static string compression;
+    static int block_size;
+    static bool overviews;
+    static bool cloud_optimized;
 };
 
 #endif // A_FONgTransmitter_h
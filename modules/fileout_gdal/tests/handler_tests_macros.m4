@@ -198,6 +198,36 @@ m4_define([_AT_BESCMD_BINARY_FILE_RESPONSE_TEST], [dnl
     AT_CLEANUP
 ])
 
+dnl Use this to test GeoTIFF and JPEG2000 responses by what gdalinfo reports
+dnl about them. The bytes of those files change with the GDAL version (and
+dnl its compression libraries), so instead of the whole file the baseline
+dnl lists lines, one per line, that the output of 'gdalinfo -stats' must
+dnl contain: the driver, size, band types, NoData values, compression and
+dnl the statistics of the values. Building the baselines saves the whole
+dnl gdalinfo output; trim it to the lines that do not depend on GDAL.
+
+m4_define([_AT_BESCMD_GDALINFO_TEST], [dnl
+
+    AT_SETUP([BESCMD $1])
+    AT_KEYWORDS([file gdalinfo])
+
+    input=$1
+    baseline=$2
+
+    AS_IF([test -n "$baselines" -a x$baselines = xyes],
+        [
+        AT_CHECK([besstandalone -c $abs_builddir/bes.conf -i $input > response])
+        AT_CHECK([gdalinfo -stats response > $baseline.tmp], [0], [ignore], [ignore])
+        ],
+        [
+        AT_CHECK([besstandalone -c $abs_builddir/bes.conf -i $input > response])
+        AT_CHECK([gdalinfo -stats response], [0], [stdout], [ignore])
+        AT_CHECK([while read -r line; do grep -F -e "$line" stdout > /dev/null || { echo "Not found: $line"; exit 1; }; done < $baseline], [0], [ignore])
+        AT_XFAIL_IF([test "$3" = "xfail"])
+        ])
+
+    AT_CLEANUP
+])
 
 m4_define([AT_BESCMD_RESPONSE_TEST],
 [_AT_BESCMD_TEST([$abs_srcdir/$1], [$abs_srcdir/$1.baseline], [$2])
@@ -230,3 +260,10 @@ m4_define([AT_BESCMD_BINARY_FILE_RESPONSE_TEST],
     [_AT_BESCMD_BINARY_FILE_RESPONSE_TEST([$abs_srcdir/$1], [$abs_srcdir/$1.$2], [$3])]
 )
 
+dnl This macro is called using:
+dnl AT_BESCMD_GDALINFO_RESPONSE_TEST(bescmd, expected)
+dnl and expects the baseline to be mybescmd.gdalinfo
+
+m4_define([AT_BESCMD_GDALINFO_RESPONSE_TEST],
+    [_AT_BESCMD_GDALINFO_TEST([$abs_srcdir/$1], [$abs_srcdir/$1.gdalinfo], [$2])]
+)
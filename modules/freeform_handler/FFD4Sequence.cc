@@ -36,6 +36,8 @@ using std::ostringstream;
 
 #include "FFStr.h"
 #include "FFD4Sequence.h"
+#include "FFSequenceReader.h"
+#include "FFRequestHandler.h"
 #include "util_ff.h"
 
 extern long BufPtr;
@@ -89,14 +91,37 @@ static long Records(const string &filename)
 }
 #endif
 
+FFD4Sequence::~FFD4Sequence()
+{
+    delete d_reader;
+}
+
+FFD4Sequence &
+FFD4Sequence::operator=(const FFD4Sequence &rhs)
+{
+    if (this == &rhs)
+        return *this;
+
+    D4Sequence::operator=(rhs);
+    d_input_format_file = rhs.d_input_format_file;
+    delete d_reader;
+    d_reader = 0;
+
+    return *this;
+}
+
 /** Read a row from the Sequence.
 
+ The rows are read a batch at a time (see FFSequenceReader); the current
+ batch is held in the global BufVal cache where the variables read their
+ values.
+
  @note Does not use either the \e in_selection or \e send_p properties. If
  this method is called and the \e read_p property is not true, the values
  are read.
 
  @exception Error if the size of the returned data is zero.
- @return Always returns false. */
+ @return True at the end of the sequence, false otherwise. */
 bool FFD4Sequence::read()
 {
 	DBG(cerr << "Entering FFD4Sequence::read..." << endl);
@@ -104,44 +129,32 @@ bool FFD4Sequence::read()
     if (read_p()) // Nothing to do
         return true;
 
-    if ((BufPtr >= BufSiz) && (BufSiz != 0))
-        return true; // End of sequence
-
-    if (!BufVal) { // Make the cache (BufVal is global)
-        // Create the output Sequence format
-        ostringstream o_fmt;
-        int endbyte = 0;
-        int stbyte = 1;
-
-        o_fmt << "binary_output_data \"DODS binary output data\"" << endl;
+    if (!d_reader) {
+        // Describe the rows; this is the output Sequence format
+        d_reader = new FFSequenceReader(dataset(), d_input_format_file,
+                FFRequestHandler::get_sequence_batch_records());
         for (Vars_iter p = var_begin(); p != var_end(); ++p) {
             if ((*p)->synthesized_p())
                 continue;
             if ((*p)->type() == dods_str_c)
-                endbyte += static_cast<FFStr&>(**p).length();
+                d_reader->add_field((*p)->name(), (*p)->type(), static_cast<FFStr&>(**p).length());
             else
-                endbyte += (*p)->width();
-
-            o_fmt << (*p)->name() << " " << stbyte << " " << endbyte << " " << ff_types((*p)->type()) << " "
-                    << ff_prec((*p)->type()) << endl;
-            stbyte = endbyte + 1;
+                d_reader->add_field((*p)->name(), (*p)->type(), (*p)->width());
         }
 
-        DBG(cerr << o_fmt.str());
+        DBG(cerr << d_reader->get_output_format());
 
-        // num_rec could come from DDS if sequence length was known...
-        long num_rec = Records(dataset());
-        if (num_rec == -1) {
-            return true;
-        }
-
-        BufSiz = num_rec * (stbyte - 1);
-        BufVal = new char[BufSiz];
+        BufPtr = 0;
+        BufSiz = 0;
+    }
 
-        long bytes = read_ff(dataset().c_str(), d_input_format_file.c_str(), o_fmt.str().c_str(), BufVal, BufSiz);
+    if (BufPtr >= BufSiz) { // The current batch is used up (BufVal is global)
+        if (!d_reader->next_batch())
+            return true; // End of sequence
 
-        if (bytes == -1)
-            throw Error("Could not read requested data from the dataset.");
+        BufVal = d_reader->get_rows();
+        BufSiz = d_reader->get_size();
+        BufPtr = 0;
     }
 
     for (Vars_iter p = var_begin(); p != var_end(); ++p)
@@ -30,15 +30,24 @@
 
 using namespace libdap ;
 
+class FFSequenceReader;
+
 class FFD4Sequence: public D4Sequence {
 private:
     string d_input_format_file;
+    FFSequenceReader *d_reader;
 
 public:
     FFD4Sequence(const string &name, const string &dataset, const string &iff)
-		: D4Sequence(name, dataset), d_input_format_file(iff) { }
+		: D4Sequence(name, dataset), d_input_format_file(iff), d_reader(0) { }
+
+    // The reader is not copied; a copy reads the data from the start.
+    FFD4Sequence(const FFD4Sequence &rhs)
+		: D4Sequence(rhs), d_input_format_file(rhs.d_input_format_file), d_reader(0) { }
+
+    virtual ~FFD4Sequence();
 
-    virtual ~FFD4Sequence() { }
+    FFD4Sequence &operator=(const FFD4Sequence &rhs);
 
     virtual BaseType *ptr_duplicate() {
     	return new FFD4Sequence(*this);
@@ -26,6 +26,7 @@
 
 #include "config_ff.h"
 
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -69,6 +70,9 @@ using namespace std;
 
 #define FF_NAME "ff"
 
+// Sequences are read and converted this many records at a time
+#define FF_SEQUENCE_BATCH_RECORDS 4096
+
 long BufPtr = 0; // cache pointer
 long BufSiz = 0; // Cache size
 char *BufVal = NULL; // cache buffer
@@ -78,6 +82,7 @@ extern void ff_get_attributes(DAS & das, string filename);
 
 bool FFRequestHandler::d_RSS_format_support = false;
 string FFRequestHandler::d_RSS_format_files = "";
+unsigned long FFRequestHandler::d_sequence_batch_records = FF_SEQUENCE_BATCH_RECORDS;
 
 FFRequestHandler::FFRequestHandler(const string &name) :
         BESRequestHandler(name)
@@ -115,8 +120,17 @@ FFRequestHandler::FFRequestHandler(const string &name) :
     else
         FFRequestHandler::d_RSS_format_files = "";
 
+    key_found = false;
+    string records;
+    TheBESKeys::TheKeys()->get_value("FF.SequenceBatchRecords", records, key_found);
+    if (key_found && atol(records.c_str()) > 0)
+        FFRequestHandler::d_sequence_batch_records = atol(records.c_str());
+    else
+        FFRequestHandler::d_sequence_batch_records = FF_SEQUENCE_BATCH_RECORDS;
+
     BESDEBUG("ff", "d_RSS_format_support: " << d_RSS_format_support << endl);
     BESDEBUG("ff", "d_RSS_format_files: " << d_RSS_format_files << endl);
+    BESDEBUG("ff", "d_sequence_batch_records: " << d_sequence_batch_records << endl);
 }
 
 FFRequestHandler::~FFRequestHandler()
@@ -34,6 +34,7 @@ class FFRequestHandler : public BESRequestHandler {
 private:
     static bool d_RSS_format_support;
     static string d_RSS_format_files;
+    static unsigned long d_sequence_batch_records;
 public:
 	FFRequestHandler( const string &name ) ;
     virtual	~FFRequestHandler( void ) ;
@@ -49,6 +50,7 @@ public:
 
     static bool get_RSS_format_support() { return d_RSS_format_support; }
     static string get_RSS_format_files() { return d_RSS_format_files; }
+    static unsigned long get_sequence_batch_records() { return d_sequence_batch_records; }
 };
 
 #endif
@@ -43,12 +43,16 @@ using std::ostringstream;
 // #define DODS_DEBUG
 
 #include <D4Attributes.h>
+#include <ConstraintEvaluator.h>
+#include <DDS.h>
 #include <Error.h>
 #include <debug.h>
 
 #include "FFStr.h"
 #include "FFSequence.h"
 #include "FFD4Sequence.h"
+#include "FFSequenceReader.h"
+#include "FFRequestHandler.h"
 #include "util_ff.h"
 
 extern long BufPtr;
@@ -66,12 +70,35 @@ FFSequence::ptr_duplicate()
 // public
 
 FFSequence::FFSequence(const string &n, const string &d, const string &iff) :
-        Sequence(n, d), d_input_format_file(iff)
+        Sequence(n, d), d_input_format_file(iff), d_reader(0), d_eval(0), d_dds(0)
+{
+}
+
+// The reader is not copied; a copy reads the data from the start.
+FFSequence::FFSequence(const FFSequence &rhs) :
+        Sequence(rhs), d_input_format_file(rhs.d_input_format_file), d_reader(0), d_eval(0), d_dds(0)
 {
 }
 
 FFSequence::~FFSequence()
 {
+    delete d_reader;
+}
+
+FFSequence &
+FFSequence::operator=(const FFSequence &rhs)
+{
+    if (this == &rhs)
+        return *this;
+
+    Sequence::operator=(rhs);
+    d_input_format_file = rhs.d_input_format_file;
+    delete d_reader;
+    d_reader = 0;
+    d_eval = 0;
+    d_dds = 0;
+
+    return *this;
 }
 
 #if 0
@@ -121,14 +148,44 @@ static long Records(const string &filename)
 }
 #endif
 
+/** Serialize the Sequence. When the selection is to be evaluated, read()
+ evaluates it as each row is converted and skips the rows it rejects, so
+ the Sequence is told not to evaluate it a second time.
+
+ @see Sequence::serialize() */
+bool FFSequence::serialize(ConstraintEvaluator &eval, DDS &dds, Marshaller &m, bool ce_eval)
+{
+    if (!ce_eval || eval.clause_begin() == eval.clause_end())
+        return Sequence::serialize(eval, dds, m, ce_eval);
+
+    d_eval = &eval;
+    d_dds = &dds;
+    try {
+        bool status = Sequence::serialize(eval, dds, m, false);
+        d_eval = 0;
+        d_dds = 0;
+        return status;
+    }
+    catch (...) {
+        d_eval = 0;
+        d_dds = 0;
+        throw;
+    }
+}
+
 /** Read a row from the Sequence.
 
+ The rows are read a batch at a time (see FFSequenceReader); the current
+ batch is held in the global BufVal cache where the variables read their
+ values. While the Sequence is serialized, rows that do not satisfy the
+ selection are skipped here.
+
  @note Does not use either the \e in_selection or \e send_p properties. If
  this method is called and the \e read_p property is not true, the values
  are read.
 
  @exception Error if the size of the returned data is zero.
- @return Always returns false. */
+ @return True at the end of the sequence, false otherwise. */
 bool FFSequence::read()
 {
 	DBG(cerr << "Entering FFSequence::read..." << endl);
@@ -136,51 +193,45 @@ bool FFSequence::read()
     if (read_p()) // Nothing to do
         return true;
 
-    if ((BufPtr >= BufSiz) && (BufSiz != 0))
-        return true; // End of sequence
-
-    if (!BufVal) { // Make the cache (BufVal is global)
-        // Create the output Sequence format
-        ostringstream o_fmt;
-        int endbyte = 0;
-        int stbyte = 1;
-
-        o_fmt << "binary_output_data \"DODS binary output data\"" << endl;
+    if (!d_reader) {
+        // Describe the rows; this is the output Sequence format
+        d_reader = new FFSequenceReader(dataset(), d_input_format_file,
+                FFRequestHandler::get_sequence_batch_records());
         for (Vars_iter p = var_begin(); p != var_end(); ++p) {
             if ((*p)->synthesized_p())
                 continue;
             if ((*p)->type() == dods_str_c)
-                endbyte += static_cast<FFStr&>(**p).length();
+                d_reader->add_field((*p)->name(), (*p)->type(), static_cast<FFStr&>(**p).length());
             else
-                endbyte += (*p)->width();
-
-            o_fmt << (*p)->name() << " " << stbyte << " " << endbyte << " " << ff_types((*p)->type()) << " "
-                    << ff_prec((*p)->type()) << endl;
-            stbyte = endbyte + 1;
+                d_reader->add_field((*p)->name(), (*p)->type(), (*p)->width());
         }
 
-        DBG(cerr << o_fmt.str());
+        DBG(cerr << d_reader->get_output_format());
 
-        // num_rec could come from DDS if sequence length was known...
-        long num_rec = Records(dataset());
-        if (num_rec == -1) {
-            return true;
-        }
+        BufPtr = 0;
+        BufSiz = 0;
+    }
 
-        BufSiz = num_rec * (stbyte - 1);
-        BufVal = new char[BufSiz];
+    while (true) {
+        if (BufPtr >= BufSiz) { // The current batch is used up (BufVal is global)
+            if (!d_reader->next_batch())
+                return true; // End of sequence
 
-        long bytes = read_ff(dataset().c_str(), d_input_format_file.c_str(), o_fmt.str().c_str(), BufVal, BufSiz);
+            BufVal = d_reader->get_rows();
+            BufSiz = d_reader->get_size();
+            BufPtr = 0;
+        }
 
-        if (bytes == -1)
-            throw Error("Could not read requested data from the dataset.");
-    }
+        for (Vars_iter p = var_begin(); p != var_end(); ++p) {
+            (*p)->read();
+        }
 
-    for (Vars_iter p = var_begin(); p != var_end(); ++p) {
-        (*p)->read();
-    }
+        if (!d_eval || d_eval->eval_selection(*d_dds, dataset()))
+            return false;
 
-    return false;
+        // Clear the values of the rejected row so the next one is read
+        set_read_p(false);
+    }
 }
 
 void FFSequence::transfer_attributes(AttrTable *at)
@@ -42,16 +42,29 @@
 
 using namespace libdap ;
 
+class FFSequenceReader;
+
 class FFSequence: public Sequence {
 private:
     string d_input_format_file;
+    FFSequenceReader *d_reader;
+
+    // Set while the Sequence is serialized, so read() can skip the rows
+    // the selection rejects
+    ConstraintEvaluator *d_eval;
+    DDS *d_dds;
 
 public:
     FFSequence(const string &n, const string &d, const string &iff);
+    FFSequence(const FFSequence &rhs);
     virtual ~FFSequence();
 
+    FFSequence &operator=(const FFSequence &rhs);
+
     virtual BaseType *ptr_duplicate();
 
+    virtual bool serialize(ConstraintEvaluator &eval, DDS &dds, Marshaller &m, bool ce_eval = true);
+
     virtual bool read();
 
     virtual void transfer_attributes(AttrTable *at);
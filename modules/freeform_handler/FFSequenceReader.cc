@@ -0,0 +1,352 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of ff_handler a FreeForm API handler for the OPeNDAP
+// DAP2 data server.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config_ff.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <cstring>
+
+#include <Error.h>
+
+#include <BESInternalError.h>
+#include <BESError.h>
+#include <BESDebug.h>
+
+#include "FFSequenceReader.h"
+#include "util_ff.h"
+
+using namespace std;
+using namespace libdap;
+
+// Keep the layouts of at most this many data files
+#define FF_MAX_LAYOUTS 128
+
+map<string, FFSequenceReader::layout> FFSequenceReader::d_layouts;
+deque<string> FFSequenceReader::d_layout_keys;
+
+/**
+ * @brief Make a reader for one Sequence
+ * @param dataset The data file
+ * @param input_format_file The FreeForm format file for \e dataset
+ * @param batch_records Read and convert this many records at a time
+ */
+FFSequenceReader::FFSequenceReader(const string &dataset, const string &input_format_file,
+    unsigned long batch_records) :
+    d_dataset(dataset), d_input_format_file(input_format_file), d_batch_records(batch_records ? batch_records : 1),
+    d_row_size(0), d_layout_p(false), d_next_record(0), d_eof(false), d_fd(-1), d_input(0), d_std_args(0),
+    d_dbin(0), d_bytes(0)
+{
+    d_output_format << "binary_output_data \"DODS binary output data\"" << endl;
+
+    memset(&d_output, 0, sizeof(d_output));
+}
+
+FFSequenceReader::~FFSequenceReader()
+{
+    if (d_dbin) db_destroy(d_dbin);
+    if (d_std_args) ff_destroy_std_args(d_std_args);
+    if (d_input) ff_destroy_bufsize(d_input);
+    if (d_fd >= 0) close(d_fd);
+}
+
+/**
+ * @brief Add the next field of the rows
+ *
+ * Fields are added in the order they appear in the Sequence; synthesized
+ * fields are not part of the rows.
+ *
+ * @param name The field's name
+ * @param type Its DAP type
+ * @param width The number of bytes it uses in a row
+ */
+void FFSequenceReader::add_field(const string &name, Type type, int width)
+{
+    unsigned long start = d_row_size + 1;
+    d_row_size += width;
+
+    d_output_format << name << " " << start << " " << d_row_size << " " << ff_types(type) << " " << ff_prec(type)
+        << endl;
+}
+
+/**
+ * @brief Find the layout of the data file
+ *
+ * The records can be read a batch at a time if the file is one run of
+ * fixed-length records: no file or record headers and no bytes left over.
+ * The layout is cached for each data and format file until the data file
+ * changes; only the FF_MAX_LAYOUTS most recently found layouts are kept.
+ */
+const FFSequenceReader::layout &FFSequenceReader::get_layout()
+{
+    if (d_layout_p) return d_layout;
+
+    d_layout_p = true;
+    d_layout.streamable = false;
+
+    struct stat st;
+    if (stat(d_dataset.c_str(), &st) != 0) return d_layout;
+
+    string key = d_dataset + "#" + d_input_format_file;
+    map<string, layout>::iterator i = d_layouts.find(key);
+    if (i != d_layouts.end() && i->second.mtime == st.st_mtime && i->second.size == st.st_size) {
+        d_layout = i->second;
+        return d_layout;
+    }
+
+    d_layout.mtime = st.st_mtime;
+    d_layout.size = st.st_size;
+    d_layout.records = 0;
+    d_layout.record_bytes = 0;
+
+    FF_STD_ARGS_PTR SetUps = ff_create_std_args();
+    if (!SetUps) throw BESInternalError("FreeForm could not allocate a 'stdargs' object.", __FILE__, __LINE__);
+
+    SetUps->user.is_stdin_redirected = 0;
+    SetUps->input_file = const_cast<char*>(d_dataset.c_str());
+    SetUps->input_format_file = const_cast<char*>(d_input_format_file.c_str());
+    SetUps->output_file = NULL;
+
+    char Msgt[Msgt_size];
+    DATA_BIN_PTR dbin = NULL;
+    int error = SetDodsDB(SetUps, &dbin, Msgt);
+    ff_destroy_std_args(SetUps);
+
+    if (!error || error >= ERR_WARNING_ONLY) {
+        PROCESS_INFO_LIST pinfo_list = NULL;
+        if (!db_ask(dbin, DBASK_PROCESS_INFO, FFF_INPUT | FFF_DATA, &pinfo_list)) {
+            PROCESS_INFO_PTR pinfo = FF_PI(dll_first(pinfo_list));
+            d_layout.records = PINFO_SUPER_ARRAY_ELS(pinfo);
+            d_layout.record_bytes = PINFO_RECL(pinfo);
+            d_layout.streamable = d_layout.records > 0 && d_layout.record_bytes > 0
+                && PINFO_SUPER_ARRAY_BYTES(pinfo) == d_layout.records * d_layout.record_bytes
+                && d_layout.records * d_layout.record_bytes == d_layout.size;
+            ff_destroy_process_info_list(pinfo_list);
+        }
+
+        // The data do not start at the beginning of the file or are
+        // interleaved with headers
+        int headers[] = { FFF_INPUT | FFF_FILE | FFF_HEADER, FFF_INPUT | FFF_REC | FFF_HEADER };
+        for (unsigned int h = 0; h < sizeof(headers) / sizeof(headers[0]); ++h) {
+            pinfo_list = NULL;
+            if (!db_ask(dbin, DBASK_PROCESS_INFO, headers[h], &pinfo_list)) {
+                d_layout.streamable = false;
+                ff_destroy_process_info_list(pinfo_list);
+            }
+        }
+    }
+
+    if (dbin) db_destroy(dbin);
+
+    // Asking about headers that are not there leaves errors behind; they
+    // must not be reported by the conversion.
+    err_clear();
+
+    BESDEBUG("ff", "FFSequenceReader::get_layout() - " << d_dataset << ": " << d_layout.records << " records of "
+        << d_layout.record_bytes << " bytes, streamable: " << d_layout.streamable << endl);
+
+    if (i == d_layouts.end()) {
+        if (d_layout_keys.size() >= FF_MAX_LAYOUTS) {
+            d_layouts.erase(d_layout_keys.front());
+            d_layout_keys.pop_front();
+        }
+        d_layout_keys.push_back(key);
+    }
+    d_layouts[key] = d_layout;
+
+    return d_layout;
+}
+
+// Read the next 'count' records into the input buffer. The file is opened
+// for the first batch and stays open until the reader is deleted.
+void FFSequenceReader::read_records(long count, long record_bytes)
+{
+    if (d_fd < 0) {
+        d_fd = open(d_dataset.c_str(), O_RDONLY);
+        if (d_fd < 0)
+            throw BESInternalError("Could not open " + d_dataset + ": " + strerror(errno), __FILE__, __LINE__);
+    }
+
+    if (!d_input) {
+        d_input = ff_create_bufsize(d_batch_records * record_bytes);
+        if (!d_input) throw BESInternalError("FreeForm could not allocate an input buffer.", __FILE__, __LINE__);
+    }
+
+    size_t size = count * record_bytes;
+    off_t offset = d_next_record * record_bytes;
+    size_t bytes_read = 0;
+    while (bytes_read < size) {
+        ssize_t status = pread(d_fd, d_input->buffer + bytes_read, size - bytes_read, offset + bytes_read);
+        if (status < 0 && errno == EINTR) continue;
+        if (status <= 0)
+            throw BESInternalError("Could not read " + d_dataset + ": " + (status < 0 ? strerror(errno) : "short read"),
+                __FILE__, __LINE__);
+        bytes_read += status;
+    }
+
+    d_input->bytes_used = size;
+}
+
+/**
+ * @brief Convert the records in the input buffer to rows
+ *
+ * The first call sets up the conversion the way newform() does. Later
+ * calls reuse it, so the format files are read and the variables and
+ * conduits are made once per Sequence. Only the number of records in the
+ * input buffer changes from one batch to the next, so the array mappings
+ * of the input and output data are made again for that count and the
+ * output starts over at the beginning of the rows; this is how FreeForm
+ * itself reads data from standard input a buffer at a time.
+ *
+ * @param count The number of records in the input buffer
+ * @return The number of bytes of rows made
+ */
+unsigned long FFSequenceReader::convert(long count)
+{
+    d_output.buffer = &d_rows[0];
+    d_output.total_bytes = (FF_BSS_t) d_rows.size();
+    d_output.bytes_used = 0;
+
+    if (!d_dbin) {
+        d_std_args = ff_create_std_args();
+        if (!d_std_args) throw BESInternalError("FreeForm could not allocate a 'stdargs' object.", __FILE__, __LINE__);
+
+        d_format = get_output_format();
+        d_output.usage = 1;
+
+        d_std_args->error_prompt = FALSE;
+        d_std_args->user.is_stdin_redirected = 0;
+        d_std_args->input_file = NULL;
+        d_std_args->input_bufsize = d_input;
+        d_std_args->input_format_file = const_cast<char*>(d_input_format_file.c_str());
+        d_std_args->output_file = NULL;
+        d_std_args->output_format_buffer = const_cast<char*>(d_format.c_str());
+        d_std_args->output_bufsize = &d_output;
+        d_std_args->log_file = (char *) "/dev/null";
+
+        int error = db_init(d_std_args, &d_dbin, NULL);
+        if (error && error < ERR_WARNING_ONLY) {
+            string message = err_count() ? freeform_error_message() : "Could not read the format of the dataset.";
+            throw BESError(message, BES_SYNTAX_USER_ERROR, __FILE__, __LINE__);
+        }
+    }
+    else {
+        PROCESS_INFO_LIST pinfo_list = NULL;
+        if (db_ask(d_dbin, DBASK_PROCESS_INFO, FFF_INPUT | FFF_DATA, &pinfo_list))
+            throw BESInternalError("FreeForm could not find the input data of " + d_dataset, __FILE__, __LINE__);
+
+        int error = 0;
+        for (pinfo_list = dll_first(pinfo_list); !error && FF_PI(pinfo_list); pinfo_list = dll_next(pinfo_list)) {
+            PROCESS_INFO_PTR pinfo = FF_PI(pinfo_list);
+            error = make_tabular_format_array_mapping(pinfo, count, 1, count);
+            PINFO_CURRENT_ARRAY_OFFSET(pinfo) = 0;
+            if (!error && PINFO_MATE(pinfo)) {
+                error = make_tabular_format_array_mapping(PINFO_MATE(pinfo), count, 1, count);
+                PINFO_CURRENT_ARRAY_OFFSET(PINFO_MATE(pinfo)) = 0;
+            }
+        }
+        ff_destroy_process_info_list(pinfo_list);
+
+        if (error) throw BESInternalError("FreeForm could not map the records of " + d_dataset, __FILE__, __LINE__);
+    }
+
+    int error = 0;
+    bool done = false;
+    while (!error && !done) {
+        error = db_do(d_dbin, DBDO_PROCESS_FORMATS, FFF_INPUT);
+        if (error == EOF) {
+            error = 0;
+            done = true;
+        }
+
+        if (!error) error = db_do(d_dbin, DBDO_WRITE_FORMATS, FFF_OUTPUT);
+    }
+
+    if (err_count()) {
+        string message = freeform_error_message();
+        BESDEBUG("ff", "FreeForm: error message " << message << endl);
+        throw BESError(message, BES_SYNTAX_USER_ERROR, __FILE__, __LINE__);
+    }
+
+    return d_output.bytes_used;
+}
+
+// Read and convert the next batch of records; return the number of bytes
+// of rows made.
+unsigned long FFSequenceReader::read_batch()
+{
+    const layout &l = get_layout();
+
+    if (!l.streamable) {
+        // Convert the whole file at once, the way it was always done
+        d_eof = true;
+
+        // num_rec could come from DDS if sequence length was known...
+        long num_rec = Records(d_dataset);
+        if (num_rec <= 0) return 0;
+
+        d_rows.resize(num_rec * d_row_size);
+        long bytes = read_ff(d_dataset.c_str(), d_input_format_file.c_str(), get_output_format().c_str(), &d_rows[0],
+            d_rows.size());
+        if (bytes == -1) throw Error("Could not read requested data from the dataset.");
+
+        return bytes;
+    }
+
+    long count = l.records - d_next_record;
+    if (count > static_cast<long>(d_batch_records)) count = d_batch_records;
+    if (count <= 0) {
+        d_eof = true;
+        return 0;
+    }
+
+    read_records(count, l.record_bytes);
+
+    d_rows.resize(d_batch_records * d_row_size);
+    unsigned long bytes = convert(count);
+
+    d_next_record += count;
+    if (d_next_record >= l.records) d_eof = true;
+
+    return bytes;
+}
+
+/**
+ * @brief Read the next batch of rows
+ *
+ * @return False if there are no more rows, true otherwise
+ */
+bool FFSequenceReader::next_batch()
+{
+    d_bytes = 0;
+    while (!d_eof) {
+        d_bytes = read_batch();
+        if (d_bytes > 0) return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,123 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of ff_handler a FreeForm API handler for the OPeNDAP
+// DAP2 data server.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _ffsequencereader_h
+#define _ffsequencereader_h 1
+
+#include <sys/types.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <sstream>
+
+#include <Type.h>
+
+#include "FreeFormCPP.h"
+
+/**
+ * @brief Read the records of a FreeForm Sequence in batches
+ *
+ * FFSequence and FFD4Sequence used to convert the whole data file to the
+ * DAP binary row format with one call to FreeForm and then hand out the
+ * rows; the size of that buffer was the number of records times the size
+ * of a row. This class reads and converts a fixed number of records at a
+ * time, so the memory used no longer depends on the size of the file.
+ *
+ * The data file is opened once and each batch of records is read into a
+ * buffer that FreeForm converts. The FreeForm data bin that describes the
+ * conversion is made for the first batch and reused for the rest; only
+ * its record count changes. This works when the data are one run of
+ * fixed-length records. The layout of each file (the record count and
+ * length) is found once and kept in a small cache, keyed by the file, its
+ * format file and its modification time. Files with file or record
+ * headers are converted in one batch, the way they always were.
+ */
+class FFSequenceReader {
+private:
+    struct layout {
+        time_t mtime;
+        off_t size;
+        long records;
+        long record_bytes;
+        bool streamable;
+    };
+
+    // The most recently found layouts, oldest key first
+    static std::map<std::string, layout> d_layouts;
+    static std::deque<std::string> d_layout_keys;
+
+    std::string d_dataset;
+    std::string d_input_format_file;
+    unsigned long d_batch_records;
+
+    std::ostringstream d_output_format;
+    unsigned long d_row_size;
+
+    layout d_layout;
+    bool d_layout_p;
+    long d_next_record;
+    bool d_eof;
+
+    int d_fd;
+    FF_BUFSIZE_PTR d_input;
+    FF_BUFSIZE d_output;
+    std::string d_format;
+    FF_STD_ARGS_PTR d_std_args;
+    DATA_BIN_PTR d_dbin;
+
+    std::vector<char> d_rows;
+    unsigned long d_bytes;
+
+    const layout &get_layout();
+    void read_records(long count, long record_bytes);
+    unsigned long convert(long count);
+    unsigned long read_batch();
+
+    FFSequenceReader(const FFSequenceReader &);
+    FFSequenceReader &operator=(const FFSequenceReader &);
+
+public:
+    FFSequenceReader(const std::string &dataset, const std::string &input_format_file, unsigned long batch_records);
+    virtual ~FFSequenceReader();
+
+    void add_field(const std::string &name, libdap::Type type, int width);
+
+    /// The description of the rows, a FreeForm binary output format
+    std::string get_output_format() const { return d_output_format.str(); }
+    unsigned long get_row_size() const { return d_row_size; }
+
+    bool next_batch();
+
+    /// The rows of the current batch
+    char *get_rows() { return d_rows.empty() ? 0 : &d_rows[0]; }
+    /// The number of bytes in the current batch
+    unsigned long get_size() const { return d_bytes; }
+
+    static void clear_layouts() { d_layouts.clear(); d_layout_keys.clear(); }
+};
+
+#endif // _ffsequencereader_h
@@ -116,7 +116,7 @@ extern "C" BOOLEAN is_a_warning(FF_ERROR_PTR error);
  *
  * @return The error string read from the FreeForm Library.
  */
-static string freeform_error_message()
+string freeform_error_message()
 {
     FF_ERROR_PTR error = pull_error();
     if (!error)
@@ -80,6 +80,7 @@ bool file_exist(const char * filename);
 
 /*extern "C" */long read_ff(const char *dataset, const char *if_file, const char *o_format,
                         char *o_buffer, unsigned long size);
+string freeform_error_message();
 
 bool is_integer_type(BaseType *btp);
 bool is_float_type(BaseType *btp);
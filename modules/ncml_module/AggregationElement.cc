@@ -161,7 +161,7 @@ void AggregationElement::handleBegin()
 {
 #if 0
     BESStopWatch sw;
-    if (BESISDEBUG( TIMING_LOG ))
+    if (BESISTIMING)
     sw.start("AggregationElement::handleBegin", "");
 #endif
 
@@ -203,7 +203,7 @@ void AggregationElement::handleEnd()
 {
 #if 1
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("AggregationElement::handleEnd", "");
+    if (BESISTIMING) sw.start("AggregationElement::handleEnd", "");
 #endif
     // Handle the actual processing!!
     BESDEBUG("ncml", "AggregationElement::handleEnd() - Processing the aggregation!!" << endl);
@@ -379,7 +379,7 @@ void AggregationElement::processUnion()
 void AggregationElement::processJoinNew()
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("AggregationElement::processJoinNew", "");
+    if (BESISTIMING) sw.start("AggregationElement::processJoinNew", "");
 
     // This will run any child <scan> elements to prepare them.
     processAnyScanElements();
@@ -627,7 +627,7 @@ void AggregationElement::fillDimensionCacheForJoinExistingDimension(AMDList& gra
     else // look for cached dimension file or load dimensionalities from granules
     {
     	BESStopWatch sw;
-        if (BESISDEBUG(TIMING_LOG)) sw.start("LOAD_AGGREGATION_DIMENSIONS_CACHE", "");
+        if (BESISTIMING) sw.start("LOAD_AGGREGATION_DIMENSIONS_CACHE", "");
 
     	agg_util::AggMemberDatasetDimensionCache *aggDimCache = agg_util::AggMemberDatasetDimensionCache::get_instance();
 
@@ -788,7 +788,7 @@ void AggregationElement::getParamsForJoinAggOnVariable(JoinAggParams* pOutParams
 void AggregationElement::processJoinNewOnAggVar(DDS* pAggDDS, const std::string& varName, const DDS& templateDDS)
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("AggregationElement::processJoinNewOnAggVar", "");
+    if (BESISTIMING) sw.start("AggregationElement::processJoinNewOnAggVar", "");
 
     // Get the params we need to factory the actual aggregation subclass
     JoinAggParams joinAggParams;
@@ -817,7 +817,7 @@ void AggregationElement::processJoinExistingOnAggVar(DDS* pAggDDS, const std::st
 {
 
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("AggregationElement::processJoinExistingOnAggVar", "");
+    if (BESISTIMING) sw.start("AggregationElement::processJoinExistingOnAggVar", "");
 
     // Get the params we need to factory the actual aggregation subclass
     JoinAggParams joinAggParams;
@@ -846,7 +846,7 @@ void AggregationElement::processAggVarJoinNewForArray(DDS& aggDDS, const libdap:
     const agg_util::Dimension& dim, const AMDList& memberDatasets)
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("AggregationElement::processJoinExistingOnAggVar", "");
+    if (BESISTIMING) sw.start("AggregationElement::processJoinExistingOnAggVar", "");
 
     // Use the basic array getter to read adn get from top level DDS.
     auto_ptr<agg_util::ArrayGetterInterface> arrayGetter(new agg_util::TopLevelArrayGetter());
@@ -871,7 +871,7 @@ void AggregationElement::processAggVarJoinNewForGrid(DDS& aggDDS, const Grid& gr
     const agg_util::Dimension& dim, const AMDList& memberDatasets)
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("AggregationElement::processAggVarJoinNewForGrid", "");
+    if (BESISTIMING) sw.start("AggregationElement::processAggVarJoinNewForGrid", "");
 
     auto_ptr<GridAggregateOnOuterDimension> pAggGrid(
         new GridAggregateOnOuterDimension(gridTemplate, dim, memberDatasets, _parser->getDDSLoader()));
@@ -891,7 +891,7 @@ void AggregationElement::processAggVarJoinExistingForArray(DDS& aggDDS, const li
 {
 
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("AggregationElement::processAggVarJoinExistingForArray", "");
+    if (BESISTIMING) sw.start("AggregationElement::processAggVarJoinExistingForArray", "");
 
     // Use the basic array getter to read adn get from top level DDS.
     auto_ptr<agg_util::ArrayGetterInterface> arrayGetter(new agg_util::TopLevelArrayGetter());
@@ -917,7 +917,7 @@ void AggregationElement::processAggVarJoinExistingForGrid(DDS& aggDDS, const Gri
 {
 
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("AggregationElement::processAggVarJoinExistingForGrid", "");
+    if (BESISTIMING) sw.start("AggregationElement::processAggVarJoinExistingForGrid", "");
 
     auto_ptr<GridJoinExistingAggregation> pAggGrid(
         new GridJoinExistingAggregation(gridTemplate, memberDatasets, _parser->getDDSLoader(), dim));
@@ -930,7 +930,7 @@ void AggregationElement::processAggVarJoinExistingForGrid(DDS& aggDDS, const Gri
 void AggregationElement::processParentDatasetCompleteForJoinNew()
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("AggregationElement::processParentDatasetCompleteForJoinNew", "");
+    if (BESISTIMING) sw.start("AggregationElement::processParentDatasetCompleteForJoinNew", "");
 
     NetcdfElement* pParentDataset = getParentDataset();
     VALID_PTR(pParentDataset);
@@ -998,7 +998,7 @@ void AggregationElement::processParentDatasetCompleteForJoinNew()
 void AggregationElement::processParentDatasetCompleteForJoinExisting()
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("AggregationElement::processParentDatasetCompleteForJoinExisting", "");
+    if (BESISTIMING) sw.start("AggregationElement::processParentDatasetCompleteForJoinExisting", "");
 
     NetcdfElement* pParentDataset = getParentDataset();
     VALID_PTR(pParentDataset);
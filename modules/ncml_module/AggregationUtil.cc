@@ -97,7 +97,7 @@ TopLevelArrayGetter::readAndGetArray(const std::string& name, const libdap::DDS&
 {
 
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("TopLevelArrayGetter::readAndGetArray", "");
+    if (BESISTIMING) sw.start("TopLevelArrayGetter::readAndGetArray", "");
 
     // First, look up the BaseType
     BaseType* pBT = AggregationUtil::getVariableNoRecurse(dds, name);
@@ -162,7 +162,7 @@ TopLevelGridDataArrayGetter::readAndGetArray(const std::string& name, const libd
     const libdap::Array* const pConstraintTemplate, const std::string& debugChannel) const
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("TopLevelGridDataArrayGetter::readAndGetArray", "");
+    if (BESISTIMING) sw.start("TopLevelGridDataArrayGetter::readAndGetArray", "");
 
     // First, look up the BaseType
     BaseType* pBT = AggregationUtil::getVariableNoRecurse(dds, name);
@@ -246,7 +246,7 @@ TopLevelGridMapArrayGetter::readAndGetArray(const std::string& arrayName, const
 {
 
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("TopLevelGridMapArrayGetter::readAndGetArray", "");
+    if (BESISTIMING) sw.start("TopLevelGridMapArrayGetter::readAndGetArray", "");
 
     // First, look up the Grid the map is in
     BaseType* pBT = AggregationUtil::getVariableNoRecurse(dds, _gridName);
@@ -871,7 +871,7 @@ Array* AggregationUtil::readDatasetArrayDataForAggregation(const Array& constrai
     const std::string& debugChannel)
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("AggregationUtil::readDatasetArrayDataForAggregation", "");
+    if (BESISTIMING) sw.start("AggregationUtil::readDatasetArrayDataForAggregation", "");
 
     const libdap::DDS* pDDS = dataset.getDDS();
     NCML_ASSERT_MSG(pDDS, "GridAggregateOnOuterDimension::read(): Got a null DataDDS "
@@ -922,7 +922,7 @@ void AggregationUtil::addDatasetArrayDataToAggregationOutputArray(libdap::Array&
     const ArrayGetterInterface& arrayGetter, const std::string& debugChannel)
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("AggregationUtil::addDatasetArrayDataToAggregationOutputArray", "");
+    if (BESISTIMING) sw.start("AggregationUtil::addDatasetArrayDataToAggregationOutputArray", "");
 
     libdap::Array* pDatasetArray = readDatasetArrayDataForAggregation(constrainedTemplateArray, varName, dataset, arrayGetter,
         debugChannel);
@@ -119,7 +119,7 @@ bool ArrayJoinExistingAggregation::serialize(libdap::ConstraintEvaluator &eval,
     bool ce_eval)
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("ArrayJoinExistingAggregation::serialize", "");
+    if (BESISTIMING) sw.start("ArrayJoinExistingAggregation::serialize", "");
 
     // *** This serialize() implementation was made by starting with a simple version that
     // *** tested read_p(), calling read() if needed and tsting send_p() and is_in_selection(),
@@ -325,7 +325,7 @@ void ArrayJoinExistingAggregation::transferOutputConstraintsIntoGranuleTemplateH
 void ArrayJoinExistingAggregation::readConstrainedGranuleArraysAndAggregateDataHook()
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG))
+    if (BESISTIMING)
         sw.start("ArrayJoinExistingAggregation::readConstrainedGranuleArraysAndAggregateDataHook", "");
 
     // outer one is the first in iteration
@@ -90,6 +90,9 @@ NCMLRequestHandler::NCMLRequestHandler(const string &name) :
     add_handler(VERS_RESPONSE, NCMLRequestHandler::ncml_build_vers);
     add_handler(HELP_RESPONSE, NCMLRequestHandler::ncml_build_help);
 
+    // The data are in the datasets the NcML file wraps or aggregates
+    set_reads_other_files(true);
+
     if (NCMLRequestHandler::_global_attributes_container_name_set == false) {
         bool key_found = false;
         string value;
@@ -161,7 +164,7 @@ bool NCMLRequestHandler::ncml_build_redirect(BESDataHandlerInterface &dhi, const
 bool NCMLRequestHandler::ncml_build_das(BESDataHandlerInterface &dhi)
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("NCMLRequestHandler::ncml_build_das", dhi.data[REQUEST_ID]);
+    if (BESISTIMING) sw.start("NCMLRequestHandler::ncml_build_das", dhi.data[REQUEST_ID]);
 
     string filename = dhi.container->access();
 
@@ -196,7 +199,7 @@ bool NCMLRequestHandler::ncml_build_dds(BESDataHandlerInterface &dhi)
 #if 0
     // original version 8/13/15
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("NCMLRequestHandler::ncml_build_dds", dhi.data[REQUEST_ID]);
+    if (BESISTIMING) sw.start("NCMLRequestHandler::ncml_build_dds", dhi.data[REQUEST_ID]);
 
     string filename = dhi.container->access();
 
@@ -244,7 +247,7 @@ bool NCMLRequestHandler::ncml_build_dds(BESDataHandlerInterface &dhi)
 #endif
 
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("NCMLRequestHandler::ncml_build_dds", dhi.data[REQUEST_ID]);
+    if (BESISTIMING) sw.start("NCMLRequestHandler::ncml_build_dds", dhi.data[REQUEST_ID]);
 
     string filename = dhi.container->access();
 
@@ -281,7 +284,7 @@ bool NCMLRequestHandler::ncml_build_dds(BESDataHandlerInterface &dhi)
 bool NCMLRequestHandler::ncml_build_data(BESDataHandlerInterface &dhi)
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("NCMLRequestHandler::ncml_build_data", dhi.data[REQUEST_ID]);
+    if (BESISTIMING) sw.start("NCMLRequestHandler::ncml_build_data", dhi.data[REQUEST_ID]);
 
     string filename = dhi.container->access();
 
@@ -318,7 +321,7 @@ bool NCMLRequestHandler::ncml_build_data(BESDataHandlerInterface &dhi)
 bool NCMLRequestHandler::ncml_build_dmr(BESDataHandlerInterface &dhi)
 {
     BESStopWatch sw;
-    if (BESISDEBUG(TIMING_LOG)) sw.start("NCMLRequestHandler::ncml_build_dmr", dhi.data[REQUEST_ID]);
+    if (BESISTIMING) sw.start("NCMLRequestHandler::ncml_build_dmr", dhi.data[REQUEST_ID]);
 
     // Because this code does not yet know how to build a DMR directly, use
     // the DMR ctor that builds a DMR using a 'full DDS' (a DDS with attributes).
@@ -53,9 +53,12 @@
 #include <debug.h>
 
 #include <BESDebug.h>
+#include <BESStopWatch.h>
+#include <BESTracer.h>
 
 #include "NCRequestHandler.h"
 #include "NCArray.h"
+#include "NCHandleCache.h"
 #include "NCStructure.h"
 #include "nc_util.h"
 
@@ -143,6 +146,53 @@ NCArray::format_constraint(size_t *cor, ptrdiff_t *step, size_t *edg,
     return nels;
 }
 
+/**
+ * Read a strided hyperslab of a variable with a fixed-size type. When the
+ * stride is small relative to the variable's chunks (or the variable is
+ * not chunked) it is much faster to read the dense block that covers the
+ * hyperslab and pick out the elements in memory than to have nc_get_vars()
+ * fetch them one at a time. The block is read in slabs no larger than
+ * NC.StridedReadBufferSize; if that is zero, or a slab would not fit, use
+ * nc_get_vars().
+ *
+ * The bytes read, including those of a covering block, are counted with
+ * BESTracer::count_read().
+ *
+ * @param size The size of one element in bytes
+ * @param values Storage for the result; must hold edg[0] * ... * edg[n-1]
+ * elements
+ * @return The netCDF library status
+ */
+int NCArray::read_strided(int ncid, int varid, size_t size, size_t cor[], size_t edg[], ptrdiff_t step[],
+        void *values)
+{
+    int ndims;
+    int errstat = nc_inq_varndims(ncid, varid, &ndims);
+    if (errstat != NC_NOERR)
+        return errstat;
+
+    size_t rows_per_slab;
+    if (nc_plan_decimated_read(ncid, varid, ndims, cor, edg, step, size,
+            NCRequestHandler::get_strided_read_buffer_size(), rows_per_slab)) {
+        BESDEBUG("nc", "NCArray::read_strided() - " << name() << ": contiguous read, " << rows_per_slab
+                << " rows per slab" << endl);
+        size_t bytes_read = 0;
+        errstat = nc_get_vars_decimated(ncid, varid, ndims, cor, edg, step, size, rows_per_slab, values,
+                &bytes_read);
+        BESTracer::count_read(bytes_read);
+        return errstat;
+    }
+
+    errstat = nc_get_vars(ncid, varid, cor, edg, step, values);
+    if (errstat == NC_NOERR) {
+        size_t nels = 1;
+        for (int d = 0; d < ndims; ++d)
+            nels *= edg[d];
+        BESTracer::count_read(nels * size);
+    }
+    return errstat;
+}
+
 void NCArray::do_cardinal_array_read(int ncid, int varid, nc_type datatype,
         vector<char> &values, bool has_values, int values_offset,
         int nels, size_t cor[], size_t edg[], ptrdiff_t step[], bool has_stride)
@@ -172,9 +222,9 @@ void NCArray::do_cardinal_array_read(int ncid, int varid, nc_type datatype,
             if (!has_values) {
                 values.resize(nels * size);
                 if (has_stride)
-                    errstat = nc_get_vars(ncid, varid, cor, edg, step, &values[0]);
-                else
-                    errstat = nc_get_vara(ncid, varid, cor, edg, &values[0]);
+                    errstat = read_strided(ncid, varid, size, cor, edg, step, &values[0]);
+                else if ((errstat = nc_get_vara(ncid, varid, cor, edg, &values[0])) == NC_NOERR)
+                    BESTracer::count_read(values.size());
                 if (errstat != NC_NOERR){
                 	ostringstream oss;
                 	oss << "NCArray::do_cardinal_array_read() - Could not get the value for Array variable '" << name() << "'.";
@@ -196,9 +246,9 @@ void NCArray::do_cardinal_array_read(int ncid, int varid, nc_type datatype,
             if (!has_values) {
                 values.resize(nels * size);
                 if (has_stride)
-                    errstat = nc_get_vars(ncid, varid, cor, edg, step, &values[0]);
-                else
-                    errstat = nc_get_vara(ncid, varid, cor, edg, &values[0]);
+                    errstat = read_strided(ncid, varid, size, cor, edg, step, &values[0]);
+                else if ((errstat = nc_get_vara(ncid, varid, cor, edg, &values[0])) == NC_NOERR)
+                    BESTracer::count_read(values.size());
                 if (errstat != NC_NOERR)
                     throw Error(errstat, string("Could not get the value for variable '") + name() + string("' (NCArray::do_cardinal_array_read)"));
             }
@@ -259,6 +309,7 @@ void NCArray::do_cardinal_array_read(int ncid, int varid, nc_type datatype,
                     errstat = nc_get_vara_text(ncid, varid, cor, edg, &values[0]);
                 if (errstat != NC_NOERR)
                     throw Error(errstat, string("Could not read the variable '") + name() + string("'."));
+                BESTracer::count_read(values.size());
             }
 
             // How large is the Nth dimension? Allocate space for the N-1 dims.
@@ -289,11 +340,15 @@ void NCArray::do_cardinal_array_read(int ncid, int varid, nc_type datatype,
 
             // put the char values in the string array
             vector < string > strg(nels);
+            size_t bytes_read = 0;
             for (int i = 0; i < nels; i++) {
                 // values_offset is in bytes; then cast to char** to find the
                 // ith element; then dereference to get the C-style string.
                 strg[i] = *((char**)(&values[0] + values_offset) + i);
+                bytes_read += strg[i].size();
             }
+            if (!has_values)
+                BESTracer::count_read(bytes_read);
 
             nc_free_string(nels, (char**)&values[0]);
             set_read_p(true);
@@ -335,6 +390,7 @@ void NCArray::do_array_read(int ncid, int varid, nc_type datatype,
                         errstat = nc_get_vara(ncid, varid, cor, edg, &values[0]);
                     if (errstat != NC_NOERR)
                         throw Error(errstat, string("Could not get the value for variable '") + name() + string("'"));
+                    BESTracer::count_read(values.size());
                     has_values = true;
                 }
 
@@ -424,6 +480,7 @@ void NCArray::do_array_read(int ncid, int varid, nc_type datatype,
                          errstat = nc_get_vara(ncid, varid, cor, edg, &values[0]);
                      if (errstat != NC_NOERR)
                          throw Error(errstat, string("Could not get the value for variable '") + name() + string("' (NC_OPAQUE)"));
+                     BESTracer::count_read(values.size());
                      has_values = true; // This value may never be used. jhrg 1/9/12
                  }
 
@@ -467,10 +524,12 @@ bool NCArray::read()
     if (read_p())  // Nothing to do
         return true;
 
-    int ncid;
-    int errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
-    if (errstat != NC_NOERR)
-        throw Error(errstat, string("Could not open the dataset's file (") + dataset().c_str() + string(")"));
+    BESStopWatch sw;
+    if (BESISTIMING) sw.start("NCArray::read " + name());
+
+    NCHandle handle(dataset());
+    int ncid = handle.ncid();
+    int errstat;
 
     int varid;                  /* variable Id */
     errstat = nc_inq_varid(ncid, name().c_str(), &varid);
@@ -501,8 +560,5 @@ bool NCArray::read()
             nels, cor, edg, step, has_stride);
     set_read_p(true);
 
-    if (nc_close(ncid) != NC_NOERR)
-        throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
-
     return true;
 }
@@ -53,6 +53,8 @@ class NCArray: public Array {
 private:
     long format_constraint(size_t *cor, ptrdiff_t *step, size_t *edg, bool *has_stride);
 
+    int read_strided(int ncid, int varid, size_t size, size_t cor[], size_t edg[], ptrdiff_t step[], void *values);
+
     void do_cardinal_array_read(int ncid, int varid, nc_type datatype,
             vector<char> &values, bool has_values, int values_offset,
             int nels, size_t cor[], size_t edg[], ptrdiff_t step[], bool has_stride);
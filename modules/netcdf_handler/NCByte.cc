@@ -45,6 +45,7 @@ static char rcsid[] not_used = { "$Id$" };
 #include <util.h>
 
 #include "NCByte.h"
+#include "NCHandleCache.h"
 
 // This `helper function' creates a pointer to the a NCByte and returns
 // that pointer. It takes the same arguments as the class's ctor. If any of
@@ -97,12 +98,9 @@ bool NCByte::read() {
     if (read_p()) // already done
         return true;
 
-    int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
-    if (errstat != NC_NOERR) {
-        string err = "Could not open the dataset's file (" + dataset() + ")";
-        throw Error(errstat, err);
-    }
+    NCHandle handle(dataset());
+    int ncid = handle.ncid();
+    int errstat;
 
     int varid; /* variable Id */
     errstat = nc_inq_varid(ncid, name().c_str(), &varid);
@@ -139,9 +137,6 @@ bool NCByte::read() {
 
     val2buf(&Dbyte);
 
-    if (nc_close(ncid) != NC_NOERR)
-        throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
-
     return true;
 }
 
@@ -47,6 +47,7 @@ static char rcsid[] not_used ={"$Id$"};
 #include <InternalErr.h>
 
 #include "NCFloat32.h"
+#include "NCHandleCache.h"
 
 
 NCFloat32::NCFloat32(const string &n, const string &d) : Float32(n, d)
@@ -92,12 +93,9 @@ bool NCFloat32::read()
     if (read_p()) // nothing to do here
         return true;
 
-    int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
-    if (errstat != NC_NOERR) {
-        string err = "Could not open the dataset's file (" + dataset() + ")";
-        throw Error(errstat, err);
-    }
+    NCHandle handle(dataset());
+    int ncid = handle.ncid();
+    int errstat;
 
     errstat = nc_inq_varid(ncid, name().c_str(), &varid);
     if (errstat != NC_NOERR)
@@ -121,9 +119,6 @@ bool NCFloat32::read()
 
         flt32 = (dods_float32) flt;
         val2buf(&flt32);
-
-        if (nc_close(ncid) != NC_NOERR)
-            throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
     }
     else
         throw InternalErr(__FILE__, __LINE__, "Entered NCFloat32::read() with non-float variable!");
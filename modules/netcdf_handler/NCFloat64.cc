@@ -44,6 +44,7 @@ static char rcsid[] not_used ={"$Id$"};
 #include <InternalErr.h>
 
 #include "NCFloat64.h"
+#include "NCHandleCache.h"
 
 
 NCFloat64::NCFloat64(const string &n, const string &d) : Float64(n, d)
@@ -91,14 +92,9 @@ NCFloat64::read()
     if (read_p()) // nothing to do here
         return true;
 
-    int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
-
-    if (errstat != NC_NOERR)
-    {
-	string err = "Could not open the dataset's file (" + dataset() + ")" ;
-	throw Error(errstat, err);
-    }
+    NCHandle handle(dataset());
+    int ncid = handle.ncid();
+    int errstat;
 
     errstat = nc_inq_varid(ncid, name().c_str(), &varid);
     if (errstat != NC_NOERR)
@@ -127,10 +123,6 @@ NCFloat64::read()
 
 	flt64 = (dods_float64) dbl;
 	val2buf((void *) &flt64 );
-
-	if (nc_close(ncid) != NC_NOERR)
-	  throw InternalErr(__FILE__, __LINE__, 
-			    "Could not close the dataset!");
     }
     else
       throw InternalErr(__FILE__, __LINE__,
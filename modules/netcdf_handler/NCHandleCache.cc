@@ -0,0 +1,191 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of nc_handler, a data handler for the OPeNDAP data
+// server.
+
+// Copyright (c) 2017 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config_nc.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <netcdf.h>
+
+#include <Error.h>
+
+#include <BESDebug.h>
+
+#include "NCHandleCache.h"
+
+#define NC_NAME "nc"
+
+using namespace std;
+using namespace libdap;
+
+map<string, NCHandleCache::entry> NCHandleCache::d_handles;
+unsigned int NCHandleCache::d_max_entries = 0;
+unsigned long long NCHandleCache::d_clock = 0;
+
+/**
+ * @brief Get a ncid for a file, opening the file if needed
+ *
+ * @param path The pathname of the netCDF file
+ * @param ncid Value-result parameter; the ncid
+ * @param cached Value-result parameter; true if the ncid belongs to the
+ * cache, false if the caller's release() should close it.
+ * @return NC_NOERR or the error returned by nc_open()
+ */
+int NCHandleCache::acquire(const string &path, int &ncid, bool &cached)
+{
+    cached = false;
+
+    struct stat buf;
+    bool have_stat = d_max_entries > 0 && stat(path.c_str(), &buf) == 0;
+
+    if (have_stat) {
+        map<string, entry>::iterator i = d_handles.find(path);
+        if (i != d_handles.end()) {
+            entry &e = i->second;
+            if (e.mtime == buf.st_mtime && e.size == buf.st_size && e.ino == buf.st_ino) {
+                BESDEBUG(NC_NAME, "NCHandleCache::acquire() - reusing ncid " << e.ncid << " for " << path << endl);
+                e.users++;
+                e.last_used = ++d_clock;
+                cached = true;
+                ncid = e.ncid;
+                return NC_NOERR;
+            }
+
+            // The file changed since it was opened. If no one is using the
+            // old id, close it; otherwise leave it to the users and open
+            // this one outside the cache.
+            if (e.users > 0) {
+                BESDEBUG(NC_NAME, "NCHandleCache::acquire() - " << path << " changed while in use" << endl);
+                have_stat = false;
+            }
+            else {
+                BESDEBUG(NC_NAME, "NCHandleCache::acquire() - " << path << " changed, reopening" << endl);
+                nc_close(e.ncid);
+                d_handles.erase(i);
+            }
+        }
+    }
+
+    int errstat = nc_open(path.c_str(), NC_NOWRITE, &ncid);
+    if (errstat != NC_NOERR)
+        return errstat;
+
+    if (have_stat) {
+        entry e;
+        e.ncid = ncid;
+        e.mtime = buf.st_mtime;
+        e.size = buf.st_size;
+        e.ino = buf.st_ino;
+        e.users = 1;
+        e.last_used = ++d_clock;
+        d_handles[path] = e;
+        cached = true;
+
+        purge();
+    }
+
+    return NC_NOERR;
+}
+
+/**
+ * @brief Release a ncid returned by acquire()
+ *
+ * @param path The pathname passed to acquire()
+ * @param ncid The ncid returned by acquire()
+ * @param cached The value of acquire()'s 'cached' parameter
+ */
+void NCHandleCache::release(const string &path, int ncid, bool cached)
+{
+    if (cached) {
+        map<string, entry>::iterator i = d_handles.find(path);
+        if (i != d_handles.end() && i->second.ncid == ncid) {
+            if (i->second.users > 0) i->second.users--;
+            purge();
+            return;
+        }
+    }
+
+    if (nc_close(ncid) != NC_NOERR)
+        BESDEBUG(NC_NAME, "NCHandleCache::release() - Could not close " << path << endl);
+}
+
+// Close the least recently used files that are not in use until no more
+// than d_max_entries are open.
+void NCHandleCache::purge()
+{
+    while (d_handles.size() > d_max_entries) {
+        map<string, entry>::iterator victim = d_handles.end();
+        for (map<string, entry>::iterator i = d_handles.begin(); i != d_handles.end(); ++i) {
+            if (i->second.users == 0 && (victim == d_handles.end() || i->second.last_used < victim->second.last_used))
+                victim = i;
+        }
+
+        if (victim == d_handles.end()) return;  // everything is in use
+
+        BESDEBUG(NC_NAME, "NCHandleCache::purge() - closing " << victim->first << endl);
+        nc_close(victim->second.ncid);
+        d_handles.erase(victim);
+    }
+}
+
+void NCHandleCache::set_max_entries(unsigned int max_entries)
+{
+    d_max_entries = max_entries;
+    purge();
+}
+
+/**
+ * @brief Close every cached file that is not in use
+ */
+void NCHandleCache::close_all()
+{
+    map<string, entry>::iterator i = d_handles.begin();
+    while (i != d_handles.end()) {
+        if (i->second.users == 0) {
+            nc_close(i->second.ncid);
+            d_handles.erase(i++);
+        }
+        else {
+            ++i;
+        }
+    }
+}
+
+NCHandle::NCHandle(const string &path, const string &error_msg) :
+    d_path(path), d_ncid(-1), d_cached(false)
+{
+    int errstat = NCHandleCache::acquire(d_path, d_ncid, d_cached);
+    if (errstat != NC_NOERR) {
+        if (error_msg.empty())
+            throw Error(errstat, "Could not open the dataset's file (" + path + ")");
+        else
+            throw Error(errstat, error_msg);
+    }
+}
+
+NCHandle::~NCHandle()
+{
+    NCHandleCache::release(d_path, d_ncid, d_cached);
+}
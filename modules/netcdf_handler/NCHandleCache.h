@@ -0,0 +1,114 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of nc_handler, a data handler for the OPeNDAP data
+// server.
+
+// Copyright (c) 2017 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _nc_handle_cache_h
+#define _nc_handle_cache_h
+
+#include <sys/types.h>
+
+#include <ctime>
+#include <string>
+#include <map>
+
+/**
+ * @brief A per-process cache of open netCDF file ids
+ *
+ * Opening a netCDF file reads its header (and for netCDF-4 files, the
+ * HDF5 group and attribute tree), so opening the file once for every
+ * variable read dominates the cost of requests for many small variables.
+ * This cache keeps recently used files open so that all of the NC types,
+ * and the DAS/DDS/DMR builders, can share one ncid per file.
+ *
+ * An open file is reused only while its modification time, size and
+ * inode match the values recorded when it was opened. Files are closed
+ * in least-recently-used order once more than max_entries are open, but
+ * a file is never closed while a NCHandle is using it.
+ *
+ * Like ObjMemCache, this cache makes no attempt at thread safety; each
+ * BES process has its own copy.
+ *
+ * @see NCHandle
+ */
+class NCHandleCache {
+private:
+    struct entry {
+        int ncid;
+        time_t mtime;
+        off_t size;
+        ino_t ino;
+        unsigned int users;
+        unsigned long long last_used;
+    };
+
+    static std::map<std::string, entry> d_handles;
+    static unsigned int d_max_entries;
+    static unsigned long long d_clock;
+
+    static void purge();
+
+    NCHandleCache();    // only static methods
+
+public:
+    static int acquire(const std::string &path, int &ncid, bool &cached);
+    static void release(const std::string &path, int ncid, bool cached);
+
+    /// Number of files that will be kept open; zero turns the cache off
+    static void set_max_entries(unsigned int max_entries);
+    static unsigned int get_max_entries() { return d_max_entries; }
+    static unsigned int size() { return d_handles.size(); }
+
+    static void close_all();
+};
+
+/**
+ * @brief Open a netCDF file through NCHandleCache for the lifetime of
+ * this object
+ *
+ * Use this in place of nc_open()/nc_close():
+ * @code
+ * NCHandle handle(dataset());
+ * int ncid = handle.ncid();
+ * @endcode
+ * The file is released when the handle goes out of scope, including
+ * when an exception is thrown. If the file cannot be opened the
+ * constructor throws libdap::Error using the given message, or a generic
+ * one if the message is empty.
+ */
+class NCHandle {
+private:
+    std::string d_path;
+    int d_ncid;
+    bool d_cached;
+
+    NCHandle(const NCHandle &);
+    NCHandle &operator=(const NCHandle &);
+
+public:
+    NCHandle(const std::string &path, const std::string &error_msg = "");
+    ~NCHandle();
+
+    int ncid() const { return d_ncid; }
+};
+
+#endif // _nc_handle_cache_h
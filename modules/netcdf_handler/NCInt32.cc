@@ -43,6 +43,7 @@ static char rcsid[] not_used = { "$Id$" };
 #include <InternalErr.h>
 
 #include "NCInt32.h"
+#include "NCHandleCache.h"
 
 NCInt32::NCInt32(const string &n, const string &d) :
     Int32(n, d)
@@ -81,12 +82,9 @@ bool NCInt32::read()
     if (read_p()) // nothing to do
         return true;
 
-    int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
-    if (errstat != NC_NOERR) {
-        string err = "Could not open the dataset's file (" + dataset() + ")";
-        throw Error(errstat, err);
-    }
+    NCHandle handle(dataset());
+    int ncid = handle.ncid();
+    int errstat;
 
     int varid; /* variable Id */
     errstat = nc_inq_varid(ncid, name().c_str(), &varid);
@@ -127,9 +125,6 @@ bool NCInt32::read()
     dods_int32 intg32 = (dods_int32) lht;
     val2buf(&intg32);
 
-    if (nc_close(ncid) != NC_NOERR)
-        throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
-
     return true;
 }
 
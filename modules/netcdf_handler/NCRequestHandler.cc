@@ -60,6 +60,7 @@
 #include <Ancillary.h>
 
 #include "NCRequestHandler.h"
+#include "NCHandleCache.h"
 
 #define NC_NAME "nc"
 
@@ -77,6 +78,8 @@ bool NCRequestHandler::_promote_byte_to_short_set = false;
 unsigned int NCRequestHandler::_cache_entries = 100;
 float NCRequestHandler::_cache_purge_level = 0.2;
 
+unsigned long NCRequestHandler::_strided_read_buffer_size = 16 * 1024 * 1024;
+
 ObjMemCache *NCRequestHandler::das_cache = 0;
 ObjMemCache *NCRequestHandler::dds_cache = 0;
 ObjMemCache *NCRequestHandler::dmr_cache = 0;
@@ -226,6 +229,12 @@ NCRequestHandler::NCRequestHandler(const string &name) :
         dmr_cache = new ObjMemCache(get_cache_entries(), get_cache_purge_level());
     }
 
+    // Zero, the default, means every read opens and closes the file
+    NCHandleCache::set_max_entries(get_uint_key("NC.FileHandleCacheEntries", 0));
+
+    // The key is in MB; zero means strided reads always use nc_get_vars()
+    NCRequestHandler::_strided_read_buffer_size = get_uint_key("NC.StridedReadBufferSize", 16) * 1024UL * 1024UL;
+
     BESDEBUG(NC_NAME, "Exiting NCRequestHandler::NCRequestHandler" << endl);
 }
 
@@ -234,12 +243,14 @@ NCRequestHandler::~NCRequestHandler()
     delete das_cache;
     delete dds_cache;
     delete dmr_cache;
+
+    NCHandleCache::close_all();
 }
 
 bool NCRequestHandler::nc_build_das(BESDataHandlerInterface & dhi)
 {
 	BESStopWatch sw;
-	if (BESISDEBUG( TIMING_LOG ))
+	if (BESISTIMING)
 		sw.start("NCRequestHandler::nc_build_das", dhi.data[REQUEST_ID]);
 
     BESDEBUG(NC_NAME, "In NCRequestHandler::nc_build_das" << endl);
@@ -362,7 +373,7 @@ bool NCRequestHandler::nc_build_dds(BESDataHandlerInterface & dhi)
 {
 
 	BESStopWatch sw;
-	if (BESISDEBUG( TIMING_LOG ))
+	if (BESISTIMING)
 		sw.start("NCRequestHandler::nc_build_dds", dhi.data[REQUEST_ID]);
 
     BESResponseObject *response = dhi.response_handler->get_response_object();
@@ -423,7 +434,7 @@ bool NCRequestHandler::nc_build_dds(BESDataHandlerInterface & dhi)
 bool NCRequestHandler::nc_build_data(BESDataHandlerInterface & dhi)
 {
 	BESStopWatch sw;
-	if (BESISDEBUG( TIMING_LOG ))
+	if (BESISTIMING)
 		sw.start("NCRequestHandler::nc_build_data", dhi.data[REQUEST_ID]);
 
     BESResponseObject *response = dhi.response_handler->get_response_object();
@@ -481,7 +492,7 @@ bool NCRequestHandler::nc_build_data(BESDataHandlerInterface & dhi)
 bool NCRequestHandler::nc_build_dmr(BESDataHandlerInterface &dhi)
 {
 	BESStopWatch sw;
-	if (BESISDEBUG( TIMING_LOG ))
+	if (BESISTIMING)
 		sw.start("NCRequestHandler::nc_build_dmr", dhi.data[REQUEST_ID]);
 
     // Extract the DMR Response object - this holds the DMR used by the
@@ -579,7 +590,7 @@ bool NCRequestHandler::nc_build_dmr(BESDataHandlerInterface &dhi)
 bool NCRequestHandler::nc_build_help(BESDataHandlerInterface & dhi)
 {
 	BESStopWatch sw;
-	if (BESISDEBUG( TIMING_LOG ))
+	if (BESISTIMING)
 		sw.start("NCRequestHandler::nc_build_help", dhi.data[REQUEST_ID]);
 
     BESResponseObject *response = dhi.response_handler->get_response_object();
@@ -609,7 +620,7 @@ bool NCRequestHandler::nc_build_help(BESDataHandlerInterface & dhi)
 bool NCRequestHandler::nc_build_version(BESDataHandlerInterface & dhi)
 {
 	BESStopWatch sw;
-	if (BESISDEBUG( TIMING_LOG ))
+	if (BESISTIMING)
 		sw.start("NCRequestHandler::nc_build_version", dhi.data[REQUEST_ID]);
 
     BESResponseObject *response = dhi.response_handler->get_response_object();
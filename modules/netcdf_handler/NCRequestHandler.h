@@ -49,6 +49,8 @@ private:
 	static unsigned int _cache_entries;
 	static float _cache_purge_level;
 
+	static unsigned long _strided_read_buffer_size;
+
     static ObjMemCache *das_cache;
     static ObjMemCache *dds_cache;
     static ObjMemCache *dmr_cache;
@@ -86,6 +88,10 @@ public:
 	{
 	    return _cache_purge_level;
 	}
+	static unsigned long get_strided_read_buffer_size()
+	{
+	    return _strided_read_buffer_size;
+	}
 };
 
 #endif
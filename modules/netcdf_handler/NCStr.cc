@@ -44,6 +44,7 @@ static char rcsid[] not_used = { "$Id$" };
 
 #include <InternalErr.h>
 #include "NCStr.h"
+#include "NCHandleCache.h"
 
 #include <debug.h>
 
@@ -86,13 +87,9 @@ bool NCStr::read()
     if (read_p()) //has been done
         return true;
 
-    int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
-
-    if (errstat != NC_NOERR) {
-        string err = "Could not open the dataset's file (" + dataset() + ")";
-        throw Error(errstat, err);
-    }
+    NCHandle handle(dataset());
+    int ncid = handle.ncid();
+    int errstat;
 
     int varid; /* variable Id */
     errstat = nc_inq_varid(ncid, name().c_str(), &varid);
@@ -51,6 +51,7 @@ static char rcsid[] not_used ={"$Id$"};
 
 #include "nc_util.h"
 #include "NCStructure.h"
+#include "NCHandleCache.h"
 #include "NCArray.h"
 
 BaseType *
@@ -241,10 +242,9 @@ bool NCStructure::read()
     if (read_p()) // nothing to do
         return true;
 
-    int ncid;
-    int errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
-    if (errstat != NC_NOERR)
-        throw Error(errstat, "Could not open the dataset's file (" + dataset() + ")");
+    NCHandle handle(dataset());
+    int ncid = handle.ncid();
+    int errstat;
 
     int varid; /* variable Id */
     errstat = nc_inq_varid(ncid, name().c_str(), &varid);
@@ -265,9 +265,6 @@ bool NCStructure::read()
 
     set_read_p(true);
 
-    if (nc_close(ncid) != NC_NOERR)
-        throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
-
     return true;
 }
 
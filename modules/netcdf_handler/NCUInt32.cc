@@ -37,6 +37,7 @@ static char rcsid[] not_used = { "$Id$" };
 #include <InternalErr.h>
 
 #include "NCUInt32.h"
+#include "NCHandleCache.h"
 
 NCUInt32::NCUInt32(const string &n, const string &d) :
     UInt32(n, d)
@@ -75,12 +76,9 @@ bool NCUInt32::read()
     if (read_p()) // nothing to do
         return true;
 
-    int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
-    if (errstat != NC_NOERR) {
-        string err = "Could not open the dataset's file (" + dataset() + ")";
-        throw Error(errstat, err);
-    }
+    NCHandle handle(dataset());
+    int ncid = handle.ncid();
+    int errstat;
 
     int varid; /* variable Id */
     errstat = nc_inq_varid(ncid, name().c_str(), &varid);
@@ -121,8 +119,5 @@ bool NCUInt32::read()
     dods_uint32 uintg32 = (dods_uint32) lng;
     val2buf(&uintg32);
 
-    if (nc_close(ncid) != NC_NOERR)
-        throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
-
     return true;
 }
@@ -24,12 +24,27 @@
 
 #include "config_nc.h"
 
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
 #include <netcdf.h>
 
 #include <Error.h>
 
+#include <BESDebug.h>
+
+#include "nc_util.h"
+
+using namespace std;
 using namespace libdap;
 
+// The cost, measured in elements read from a contiguous block, of each
+// element returned by nc_get_vars(). The library walks strided
+// hyperslabs one element (or one short run) at a time, so each value
+// carries the overhead of a separate read.
+#define VARS_ELEMENT_COST 32
+
 bool is_user_defined_type(int ncid, int type)
 {
 #if NETCDF_VERSION >= 4
@@ -52,3 +67,236 @@ bool is_user_defined_type(int ncid, int type)
 #endif
 }
 
+
+// Gather kernel for nc_decimate(); T is a type with the size of one
+// element. The innermost dimension is handled by a tight loop (or a
+// memcpy when its step is one) and the outer dimensions by an odometer
+// that moves a running source offset, so no index arithmetic is done
+// per element.
+template<typename T>
+static void decimate_typed(const char *src, const size_t shape[], char *dst, const size_t edg[],
+    const ptrdiff_t step[], int ndims)
+{
+    vector<size_t> src_stride(ndims);    // elements
+    src_stride[ndims - 1] = 1;
+    for (int d = ndims - 2; d >= 0; --d)
+        src_stride[d] = src_stride[d + 1] * shape[d + 1];
+
+    vector<size_t> outer_step(ndims);
+    size_t outer = 1;
+    for (int d = 0; d < ndims - 1; ++d) {
+        outer_step[d] = step[d] * src_stride[d];
+        outer *= edg[d];
+    }
+
+    const T *s = reinterpret_cast<const T *>(src);
+    T *out = reinterpret_cast<T *>(dst);
+    const size_t inner = edg[ndims - 1];
+    const ptrdiff_t inner_step = step[ndims - 1];
+
+    vector<size_t> index(ndims, 0);
+    size_t offset = 0;
+    for (size_t n = 0; n < outer; ++n) {
+        const T *sp = s + offset;
+        if (inner_step == 1) {
+            memcpy(out, sp, inner * sizeof(T));
+        }
+        else {
+            for (size_t i = 0; i < inner; ++i) {
+                out[i] = *sp;
+                sp += inner_step;
+            }
+        }
+        out += inner;
+
+        for (int d = ndims - 2; d >= 0; --d) {
+            offset += outer_step[d];
+            if (++index[d] < edg[d]) break;
+            offset -= index[d] * outer_step[d];
+            index[d] = 0;
+        }
+    }
+}
+
+template<size_t N>
+struct nc_element {
+    char bytes[N];
+};
+
+/**
+ * @brief Copy every step[d]th element of a dense block to a packed array
+ *
+ * @param src The dense block, with shape[] elements in each dimension
+ * @param shape The size of each of the block's dimensions
+ * @param dst The result, with edg[] elements in each dimension
+ * @param edg The number of elements to copy from each dimension
+ * @param step The stride for each dimension; shape[d] must be at least
+ * (edg[d] - 1) * step[d] + 1
+ * @param ndims The number of dimensions
+ * @param elem_size The size of one element in bytes
+ */
+void nc_decimate(const char *src, const size_t shape[], char *dst, const size_t edg[], const ptrdiff_t step[],
+    int ndims, size_t elem_size)
+{
+    if (ndims == 0) return;
+
+    switch (elem_size) {
+    case 1:
+        decimate_typed<unsigned char>(src, shape, dst, edg, step, ndims);
+        break;
+    case 2:
+        decimate_typed<unsigned short>(src, shape, dst, edg, step, ndims);
+        break;
+    case 4:
+        decimate_typed<unsigned int>(src, shape, dst, edg, step, ndims);
+        break;
+    case 8:
+        decimate_typed<unsigned long long>(src, shape, dst, edg, step, ndims);
+        break;
+    default: {
+        // Odd sizes (compound members, etc.) are not expected here; copy
+        // them a byte at a time by treating the element size as an extra,
+        // unstrided dimension.
+        vector<size_t> b_shape(shape, shape + ndims);
+        vector<size_t> b_edg(edg, edg + ndims);
+        vector<ptrdiff_t> b_step(step, step + ndims);
+        b_shape.push_back(elem_size);
+        b_edg.push_back(elem_size);
+        b_step.push_back(1);
+        decimate_typed<unsigned char>(src, &b_shape[0], dst, &b_edg[0], &b_step[0], ndims + 1);
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Should a strided read use nc_get_vara() and nc_decimate()?
+ *
+ * Estimate the cost of reading a strided hyperslab with nc_get_vars()
+ * and with contiguous reads of the block that covers it followed by an
+ * in-memory gather. For chunked (netCDF-4) variables the estimate counts
+ * the chunks each approach touches, since HDF5 reads whole chunks; for
+ * contiguous variables it counts elements. The contiguous reads are done
+ * a slab of the first dimension at a time so that the scratch space is
+ * never larger than buffer_size; if a single slab would not fit, or the
+ * stride is so large that most of the block would be thrown away, use
+ * nc_get_vars().
+ *
+ * @param rows_per_slab Value-result parameter; the number of elements of
+ * the first dimension of the result to read with each nc_get_vara() call
+ * @return True if nc_get_vars_decimated() should be used
+ */
+bool nc_plan_decimated_read(int ncid, int varid, int ndims, const size_t cor[], const size_t edg[],
+    const ptrdiff_t step[], size_t elem_size, size_t buffer_size, size_t &rows_per_slab)
+{
+    rows_per_slab = 0;
+    if (buffer_size == 0 || ndims == 0) return false;
+
+    double sparse = 1;          // elements returned
+    double plane = 1;           // dense elements in one slab of the first dimension
+    vector<size_t> count(ndims);
+    for (int d = 0; d < ndims; ++d) {
+        if (edg[d] == 0 || step[d] < 1) return false;
+        count[d] = (edg[d] - 1) * step[d] + 1;
+        sparse *= edg[d];
+        if (d > 0) plane *= count[d];
+    }
+
+    // When there is more than one dimension and the first is strided, read
+    // each result row of the first dimension separately so the rows that
+    // are skipped are never read. Otherwise read runs of the first dimension.
+    bool row_at_a_time = ndims > 1 && step[0] > 1;
+    double dense;
+    if (row_at_a_time) {
+        if (plane * elem_size > buffer_size) return false;
+        rows_per_slab = 1;
+        dense = plane * edg[0];
+    }
+    else {
+        size_t dense_rows = buffer_size / (plane * elem_size);
+        if (dense_rows == 0) return false;
+        rows_per_slab = min(edg[0], (dense_rows - 1) / step[0] + 1);
+        dense = plane * count[0];
+    }
+
+    double dense_cost = 2 * dense;      // read, then copy
+    double vars_cost = sparse * VARS_ELEMENT_COST;
+
+#if NETCDF_VERSION >= 4
+    int storage;
+    vector<size_t> chunks(ndims);
+    if (nc_inq_var_chunking(ncid, varid, &storage, &chunks[0]) == NC_NOERR && storage == NC_CHUNKED) {
+        double dense_chunked = 1;
+        double vars_chunked = 1;
+        for (int d = 0; d < ndims; ++d) {
+            size_t first = cor[d] / chunks[d];
+            size_t last = (cor[d] + count[d] - 1) / chunks[d];
+            double dense_chunks = last - first + 1;
+            double vars_chunks = (size_t) step[d] >= chunks[d] ? edg[d] : dense_chunks;
+            if (d == 0 && row_at_a_time) dense_chunks = vars_chunks;
+            dense_chunked *= dense_chunks * chunks[d];
+            vars_chunked *= vars_chunks * chunks[d];
+        }
+        dense_cost = dense_chunked + dense;
+        vars_cost = vars_chunked + sparse * VARS_ELEMENT_COST;
+    }
+#endif
+
+    BESDEBUG("nc", "nc_plan_decimated_read() - varid " << varid << ": dense cost " << dense_cost
+        << ", vars cost " << vars_cost << ", rows per slab " << rows_per_slab << endl);
+
+    return dense_cost < vars_cost;
+}
+
+/**
+ * @brief Read a strided hyperslab with contiguous reads and nc_decimate()
+ *
+ * Equivalent to nc_get_vars(ncid, varid, cor, edg, step, values) for
+ * variables of fixed-size types.
+ *
+ * @param rows_per_slab Set by nc_plan_decimated_read()
+ * @param bytes_read If not null, set to the number of bytes read by the
+ * nc_get_vara() calls, which includes the elements skipped by the stride
+ * @return NC_NOERR or the error returned by nc_get_vara()
+ */
+int nc_get_vars_decimated(int ncid, int varid, int ndims, const size_t cor[], const size_t edg[],
+    const ptrdiff_t step[], size_t elem_size, size_t rows_per_slab, void *values, size_t *bytes_read)
+{
+    if (bytes_read) *bytes_read = 0;
+
+    if (ndims == 0 || rows_per_slab == 0) return NC_EINVAL;
+
+    bool row_at_a_time = ndims > 1 && step[0] > 1;
+
+    vector<size_t> start(cor, cor + ndims);
+    vector<size_t> count(ndims);
+    vector<size_t> out(edg, edg + ndims);
+    vector<ptrdiff_t> slab_step(step, step + ndims);
+    size_t out_row_bytes = elem_size;
+    size_t plane = 1;
+    for (int d = 1; d < ndims; ++d) {
+        count[d] = (edg[d] - 1) * step[d] + 1;
+        plane *= count[d];
+        out_row_bytes *= edg[d];
+    }
+    if (row_at_a_time) slab_step[0] = 1;
+
+    size_t max_rows = row_at_a_time ? 1 : (rows_per_slab - 1) * step[0] + 1;
+    vector<char> scratch(max_rows * plane * elem_size);
+
+    char *dest = static_cast<char *>(values);
+    for (size_t row = 0; row < edg[0]; row += rows_per_slab) {
+        size_t rows = min(rows_per_slab, edg[0] - row);
+        start[0] = cor[0] + row * step[0];
+        count[0] = row_at_a_time ? 1 : (rows - 1) * step[0] + 1;
+        out[0] = rows;
+
+        int errstat = nc_get_vara(ncid, varid, &start[0], &count[0], &scratch[0]);
+        if (errstat != NC_NOERR) return errstat;
+        if (bytes_read) *bytes_read += count[0] * plane * elem_size;
+
+        nc_decimate(&scratch[0], &count[0], dest + row * out_row_bytes, &out[0], &slab_step[0], ndims, elem_size);
+    }
+
+    return NC_NOERR;
+}
@@ -22,4 +22,15 @@
 //
 // You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
 
+#include <cstddef>
+
 bool is_user_defined_type(int ncid, int type);
+
+void nc_decimate(const char *src, const size_t shape[], char *dst, const size_t edg[], const ptrdiff_t step[],
+    int ndims, size_t elem_size);
+
+bool nc_plan_decimated_read(int ncid, int varid, int ndims, const size_t cor[], const size_t edg[],
+    const ptrdiff_t step[], size_t elem_size, size_t buffer_size, size_t &rows_per_slab);
+
+int nc_get_vars_decimated(int ncid, int varid, int ndims, const size_t cor[], const size_t edg[],
+    const ptrdiff_t step[], size_t elem_size, size_t rows_per_slab, void *values, size_t *bytes_read = 0);
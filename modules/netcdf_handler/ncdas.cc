@@ -58,6 +58,7 @@
 
 #include "NCRequestHandler.h"
 #include "nc_util.h"
+#include "NCHandleCache.h"
 
 #define ATTR_STRING_QUOTE_FIX
 
@@ -557,9 +558,9 @@ void nc_read_dataset_attributes(DAS &das, const string &filename)
 {
     BESDEBUG("nc", "In nc_read_dataset_attributes" << endl);
 
-    int ncid, errstat;
-    errstat = nc_open(filename.c_str(), NC_NOWRITE, &ncid);
-    if (errstat != NC_NOERR) throw Error(errstat, "NetCDF handler: Could not open " + path_to_filename(filename) + ".");
+    NCHandle handle(filename, "NetCDF handler: Could not open " + path_to_filename(filename) + ".");
+    int ncid = handle.ncid();
+    int errstat;
 
     // how many variables? how many global attributes?
     int nvars, ngatts;
@@ -695,7 +696,5 @@ void nc_read_dataset_attributes(DAS &das, const string &filename)
         attr_table_ptr->append_attr("Unlimited_Dimension", print_type(datatype), print_rep);
     }
 
-    if (nc_close(ncid) != NC_NOERR) throw InternalErr(__FILE__, __LINE__, "NetCDF handler: Could not close the dataset!");
-
     BESDEBUG("nc", "Exiting nc_read_dataset_attributes" << endl);
 }
@@ -69,6 +69,7 @@
 #include "NCStr.h"
 
 #include "NCStructure.h"
+#include "NCHandleCache.h"
 
 using namespace libdap ;
 
@@ -610,12 +611,11 @@ static void read_variables(DDS &dds_table, const string &filename, int ncid, int
 void nc_read_dataset_variables(DDS &dds_table, const string &filename)
 {
     ncopts = 0;
-    int ncid, errstat;
+    int errstat;
     int nvars;
 
-    errstat = nc_open(filename.c_str(), NC_NOWRITE, &ncid);
-    if (errstat != NC_NOERR)
-        throw Error(errstat, "Could not open " + path_to_filename(filename) + ".");
+    NCHandle handle(filename, "Could not open " + path_to_filename(filename) + ".");
+    int ncid = handle.ncid();
 
     // how many variables?
     errstat = nc_inq_nvars(ncid, &nvars);
@@ -627,8 +627,5 @@ void nc_read_dataset_variables(DDS &dds_table, const string &filename)
 
     // read variables' classes
     read_variables(dds_table, filename, ncid, nvars);
-
-    if (nc_close(ncid) != NC_NOERR)
-        throw InternalErr(__FILE__, __LINE__, "ncdds: Could not close the dataset!");
 }
 
@@ -0,0 +1,327 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of nc_handler, a data handler for the OPeNDAP data
+// server.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config_nc.h"
+
+#include <unistd.h>
+
+#include <vector>
+
+#include <netcdf.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <BESDebug.h>
+
+#include "nc_util.h"
+
+#include "GetOpt.h"
+
+using namespace std;
+
+static bool debug = false;
+static bool bes_debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+class NCDecimateTest: public CppUnit::TestFixture {
+private:
+    string d_file;
+
+    // Write a 3D int variable whose values are their own row-major index
+    void make_file(size_t d0, size_t d1, size_t d2, bool chunked)
+    {
+        int ncid, dims[3], varid;
+        int mode = NC_CLOBBER;
+#if NETCDF_VERSION >= 4
+        if (chunked) mode |= NC_NETCDF4;
+#endif
+        CPPUNIT_ASSERT(nc_create(d_file.c_str(), mode, &ncid) == NC_NOERR);
+        CPPUNIT_ASSERT(nc_def_dim(ncid, "d0", d0, &dims[0]) == NC_NOERR);
+        CPPUNIT_ASSERT(nc_def_dim(ncid, "d1", d1, &dims[1]) == NC_NOERR);
+        CPPUNIT_ASSERT(nc_def_dim(ncid, "d2", d2, &dims[2]) == NC_NOERR);
+        CPPUNIT_ASSERT(nc_def_var(ncid, "v", NC_INT, 3, dims, &varid) == NC_NOERR);
+#if NETCDF_VERSION >= 4
+        if (chunked) {
+            size_t chunks[3] = { 4, 8, 8 };
+            CPPUNIT_ASSERT(nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks) == NC_NOERR);
+        }
+#endif
+        CPPUNIT_ASSERT(nc_enddef(ncid) == NC_NOERR);
+
+        vector<int> data(d0 * d1 * d2);
+        for (size_t i = 0; i < data.size(); ++i)
+            data[i] = i;
+        CPPUNIT_ASSERT(nc_put_var_int(ncid, varid, &data[0]) == NC_NOERR);
+        CPPUNIT_ASSERT(nc_close(ncid) == NC_NOERR);
+    }
+
+    // Read the hyperslab both ways and compare
+    void compare_reads(size_t cor[], size_t edg[], ptrdiff_t step[], size_t buffer_size)
+    {
+        int ncid, varid;
+        CPPUNIT_ASSERT(nc_open(d_file.c_str(), NC_NOWRITE, &ncid) == NC_NOERR);
+        CPPUNIT_ASSERT(nc_inq_varid(ncid, "v", &varid) == NC_NOERR);
+
+        size_t nels = edg[0] * edg[1] * edg[2];
+        vector<int> expected(nels), result(nels, -1);
+        CPPUNIT_ASSERT(nc_get_vars(ncid, varid, cor, edg, step, &expected[0]) == NC_NOERR);
+
+        size_t rows_per_slab;
+        bool planned = nc_plan_decimated_read(ncid, varid, 3, cor, edg, step, sizeof(int), buffer_size,
+            rows_per_slab);
+        DBG(cerr << "planned: " << planned << ", rows per slab: " << rows_per_slab << endl);
+
+        // Use the contiguous read even if the planner would not, so that
+        // the reader is tested for every case with a valid slab size
+        size_t bytes_read = 0;
+        if (rows_per_slab > 0)
+            CPPUNIT_ASSERT(nc_get_vars_decimated(ncid, varid, 3, cor, edg, step, sizeof(int), rows_per_slab,
+                &result[0], &bytes_read) == NC_NOERR);
+        else
+            CPPUNIT_ASSERT(!planned);
+
+        nc_close(ncid);
+
+        if (rows_per_slab > 0) {
+            CPPUNIT_ASSERT(expected == result);
+
+            // Each row of the first dimension that is used is read with the
+            // block that covers the other two, including the skipped elements
+            size_t plane = ((edg[1] - 1) * step[1] + 1) * ((edg[2] - 1) * step[2] + 1);
+            DBG(cerr << "bytes read: " << bytes_read << endl);
+            CPPUNIT_ASSERT(bytes_read == edg[0] * plane * sizeof(int));
+        }
+    }
+
+public:
+    NCDecimateTest() : d_file("NCDecimateTest.nc")
+    {
+    }
+
+    ~NCDecimateTest()
+    {
+    }
+
+    void setUp()
+    {
+        if (bes_debug) BESDebug::SetUp("cerr,nc");
+    }
+
+    void tearDown()
+    {
+        unlink(d_file.c_str());
+    }
+
+    CPPUNIT_TEST_SUITE( NCDecimateTest );
+
+    CPPUNIT_TEST(decimate_1d_test);
+    CPPUNIT_TEST(decimate_3d_test);
+    CPPUNIT_TEST(decimate_odd_size_test);
+    CPPUNIT_TEST(plan_test);
+    CPPUNIT_TEST(read_classic_test);
+    CPPUNIT_TEST(read_chunked_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void decimate_1d_test()
+    {
+        double src[10];
+        for (int i = 0; i < 10; ++i)
+            src[i] = i * 1.5;
+
+        size_t shape[1] = { 10 };
+        size_t edg[1] = { 4 };
+        ptrdiff_t step[1] = { 3 };
+        double dst[4];
+        nc_decimate(reinterpret_cast<char*>(src), shape, reinterpret_cast<char*>(dst), edg, step, 1, sizeof(double));
+
+        CPPUNIT_ASSERT(dst[0] == 0.0);
+        CPPUNIT_ASSERT(dst[1] == 4.5);
+        CPPUNIT_ASSERT(dst[2] == 9.0);
+        CPPUNIT_ASSERT(dst[3] == 13.5);
+    }
+
+    void decimate_3d_test()
+    {
+        // 5 x 7 x 9 block; keep [0:2:4][0:3:6][0:1:8]
+        size_t shape[3] = { 5, 7, 9 };
+        vector<short> src(5 * 7 * 9);
+        for (size_t i = 0; i < src.size(); ++i)
+            src[i] = i;
+
+        size_t edg[3] = { 3, 3, 9 };
+        ptrdiff_t step[3] = { 2, 3, 1 };
+        vector<short> dst(3 * 3 * 9);
+        nc_decimate(reinterpret_cast<char*>(&src[0]), shape, reinterpret_cast<char*>(&dst[0]), edg, step, 3,
+            sizeof(short));
+
+        size_t n = 0;
+        for (size_t i = 0; i < 3; ++i)
+            for (size_t j = 0; j < 3; ++j)
+                for (size_t k = 0; k < 9; ++k)
+                    CPPUNIT_ASSERT(dst[n++] == (short) ((i * 2) * 63 + (j * 3) * 9 + k));
+
+        // Same block with a stride in the last dimension
+        size_t edg2[3] = { 5, 2, 3 };
+        ptrdiff_t step2[3] = { 1, 5, 4 };
+        vector<short> dst2(5 * 2 * 3);
+        nc_decimate(reinterpret_cast<char*>(&src[0]), shape, reinterpret_cast<char*>(&dst2[0]), edg2, step2, 3,
+            sizeof(short));
+
+        n = 0;
+        for (size_t i = 0; i < 5; ++i)
+            for (size_t j = 0; j < 2; ++j)
+                for (size_t k = 0; k < 3; ++k)
+                    CPPUNIT_ASSERT(dst2[n++] == (short) (i * 63 + (j * 5) * 9 + k * 4));
+    }
+
+    void decimate_odd_size_test()
+    {
+        // Three-byte elements take the generic path
+        char src[6 * 3];
+        for (int i = 0; i < 18; ++i)
+            src[i] = i;
+
+        size_t shape[1] = { 6 };
+        size_t edg[1] = { 3 };
+        ptrdiff_t step[1] = { 2 };
+        char dst[3 * 3];
+        nc_decimate(src, shape, dst, edg, step, 1, 3);
+
+        const char expected[9] = { 0, 1, 2, 6, 7, 8, 12, 13, 14 };
+        for (int i = 0; i < 9; ++i)
+            CPPUNIT_ASSERT(dst[i] == expected[i]);
+    }
+
+    void plan_test()
+    {
+        make_file(20, 30, 40, false);
+
+        int ncid, varid;
+        CPPUNIT_ASSERT(nc_open(d_file.c_str(), NC_NOWRITE, &ncid) == NC_NOERR);
+        CPPUNIT_ASSERT(nc_inq_varid(ncid, "v", &varid) == NC_NOERR);
+
+        size_t cor[3] = { 0, 0, 0 };
+        size_t edg[3] = { 10, 15, 20 };
+        ptrdiff_t step[3] = { 2, 2, 2 };
+        size_t rows;
+
+        // Small strides on a contiguous variable favor the dense read
+        CPPUNIT_ASSERT(nc_plan_decimated_read(ncid, varid, 3, cor, edg, step, sizeof(int), 1024 * 1024, rows));
+        CPPUNIT_ASSERT(rows == 1);
+
+        // No buffer, no dense read
+        CPPUNIT_ASSERT(!nc_plan_decimated_read(ncid, varid, 3, cor, edg, step, sizeof(int), 0, rows));
+
+        // One slab (29 x 39 ints) does not fit
+        CPPUNIT_ASSERT(!nc_plan_decimated_read(ncid, varid, 3, cor, edg, step, sizeof(int), 1024, rows));
+
+        // A huge stride in the last dimension reads mostly unused values
+        size_t edg2[3] = { 20, 30, 2 };
+        ptrdiff_t step2[3] = { 1, 1, 39 };
+        CPPUNIT_ASSERT(!nc_plan_decimated_read(ncid, varid, 3, cor, edg2, step2, sizeof(int), 1024 * 1024, rows));
+
+        nc_close(ncid);
+    }
+
+    void read_classic_test()
+    {
+        make_file(20, 30, 40, false);
+
+        size_t cor[3] = { 1, 2, 3 };
+        size_t edg[3] = { 6, 7, 9 };
+        ptrdiff_t step[3] = { 3, 4, 4 };
+        compare_reads(cor, edg, step, 1024 * 1024);
+
+        // First dimension not strided; several rows per slab
+        ptrdiff_t step2[3] = { 1, 2, 3 };
+        size_t edg2[3] = { 19, 14, 12 };
+        compare_reads(cor, edg2, step2, 4 * 27 * 34 * 5);
+
+        // Slabs that just fit one row
+        compare_reads(cor, edg2, step2, 4 * 27 * 34);
+    }
+
+    void read_chunked_test()
+    {
+#if NETCDF_VERSION >= 4
+        make_file(20, 30, 40, true);
+
+        size_t cor[3] = { 0, 5, 1 };
+        size_t edg[3] = { 10, 5, 13 };
+        ptrdiff_t step[3] = { 2, 5, 3 };
+        compare_reads(cor, edg, step, 1024 * 1024);
+
+        ptrdiff_t step2[3] = { 1, 1, 2 };
+        size_t edg2[3] = { 20, 25, 20 };
+        compare_reads(cor, edg2, step2, 4 * 25 * 39 * 3);
+#endif
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(NCDecimateTest);
+
+int main(int argc, char*argv[])
+{
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    GetOpt getopt(argc, argv, "dD");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = true;  // debug is a static global
+            break;
+        case 'D':
+            debug = true;  // debug is a static global
+            bes_debug = true;  // debug is a static global
+            break;
+        default:
+            break;
+        }
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            test = string("NCDecimateTest::") + argv[i++];
+
+            cerr << endl << "Running test " << test << endl << endl;
+
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,289 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of nc_handler, a data handler for the OPeNDAP data
+// server.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config_nc.h"
+
+#include <cstdio>
+#include <unistd.h>
+
+#include <string>
+
+#include <netcdf.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Error.h>
+
+#include <BESDebug.h>
+
+#include "NCHandleCache.h"
+
+#include "GetOpt.h"
+
+using namespace std;
+
+static bool debug = false;
+static bool bes_debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+class NCHandleCacheTest: public CppUnit::TestFixture {
+private:
+    // Write an empty classic netCDF file with one dimension
+    void make_file(const string &name, size_t size)
+    {
+        int ncid, dim;
+        CPPUNIT_ASSERT(nc_create(name.c_str(), NC_CLOBBER, &ncid) == NC_NOERR);
+        CPPUNIT_ASSERT(nc_def_dim(ncid, "d", size, &dim) == NC_NOERR);
+        CPPUNIT_ASSERT(nc_enddef(ncid) == NC_NOERR);
+        CPPUNIT_ASSERT(nc_close(ncid) == NC_NOERR);
+    }
+
+    // Acquire a file, check that it's cached as expected, release it and
+    // return its ncid
+    int use(const string &name, bool expect_cached)
+    {
+        int ncid;
+        bool cached;
+        CPPUNIT_ASSERT(NCHandleCache::acquire(name, ncid, cached) == NC_NOERR);
+        CPPUNIT_ASSERT(cached == expect_cached);
+        NCHandleCache::release(name, ncid, cached);
+        return ncid;
+    }
+
+public:
+    NCHandleCacheTest()
+    {
+    }
+
+    ~NCHandleCacheTest()
+    {
+    }
+
+    void setUp()
+    {
+        if (bes_debug) BESDebug::SetUp("cerr,nc");
+
+        make_file("NCHandleCacheTest_1.nc", 1);
+        make_file("NCHandleCacheTest_2.nc", 2);
+        make_file("NCHandleCacheTest_3.nc", 3);
+    }
+
+    void tearDown()
+    {
+        NCHandleCache::set_max_entries(0);
+        NCHandleCache::close_all();
+
+        unlink("NCHandleCacheTest_1.nc");
+        unlink("NCHandleCacheTest_2.nc");
+        unlink("NCHandleCacheTest_3.nc");
+    }
+
+    CPPUNIT_TEST_SUITE( NCHandleCacheTest );
+
+    CPPUNIT_TEST(default_off_test);
+    CPPUNIT_TEST(hit_test);
+    CPPUNIT_TEST(eviction_test);
+    CPPUNIT_TEST(in_use_test);
+    CPPUNIT_TEST(changed_file_test);
+    CPPUNIT_TEST(handle_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    // NC.FileHandleCacheEntries defaults to zero: files are opened and
+    // closed for every use, as before the cache
+    void default_off_test()
+    {
+        CPPUNIT_ASSERT(NCHandleCache::get_max_entries() == 0);
+
+        int ncid;
+        bool cached;
+        CPPUNIT_ASSERT(NCHandleCache::acquire("NCHandleCacheTest_1.nc", ncid, cached) == NC_NOERR);
+        CPPUNIT_ASSERT(!cached);
+        CPPUNIT_ASSERT(NCHandleCache::size() == 0);
+        NCHandleCache::release("NCHandleCacheTest_1.nc", ncid, cached);
+
+        // release() closed it
+        int ndims;
+        CPPUNIT_ASSERT(nc_inq_ndims(ncid, &ndims) != NC_NOERR);
+    }
+
+    void hit_test()
+    {
+        NCHandleCache::set_max_entries(2);
+
+        int first = use("NCHandleCacheTest_1.nc", true);
+        CPPUNIT_ASSERT(NCHandleCache::size() == 1);
+
+        // Two users at once share the id
+        int ncid, ncid2;
+        bool cached, cached2;
+        CPPUNIT_ASSERT(NCHandleCache::acquire("NCHandleCacheTest_1.nc", ncid, cached) == NC_NOERR);
+        CPPUNIT_ASSERT(NCHandleCache::acquire("NCHandleCacheTest_1.nc", ncid2, cached2) == NC_NOERR);
+        CPPUNIT_ASSERT(cached && cached2);
+        CPPUNIT_ASSERT(ncid == first && ncid2 == first);
+        NCHandleCache::release("NCHandleCacheTest_1.nc", ncid, cached);
+        NCHandleCache::release("NCHandleCacheTest_1.nc", ncid2, cached2);
+
+        // Still open
+        int ndims;
+        CPPUNIT_ASSERT(nc_inq_ndims(first, &ndims) == NC_NOERR);
+        CPPUNIT_ASSERT(NCHandleCache::size() == 1);
+    }
+
+    void eviction_test()
+    {
+        NCHandleCache::set_max_entries(2);
+
+        int id1 = use("NCHandleCacheTest_1.nc", true);
+        int id2 = use("NCHandleCacheTest_2.nc", true);
+        use("NCHandleCacheTest_1.nc", true);                  // 2 is now the least recently used
+        int id3 = use("NCHandleCacheTest_3.nc", true);
+        CPPUNIT_ASSERT(NCHandleCache::size() == 2);
+
+        // 2 was closed; 1 and 3 are still open
+        int ndims;
+        CPPUNIT_ASSERT(nc_inq_ndims(id2, &ndims) != NC_NOERR || id2 == id3);
+        CPPUNIT_ASSERT(use("NCHandleCacheTest_1.nc", true) == id1);
+        CPPUNIT_ASSERT(use("NCHandleCacheTest_3.nc", true) == id3);
+
+        // Shrinking the cache closes the extra files
+        NCHandleCache::set_max_entries(1);
+        CPPUNIT_ASSERT(NCHandleCache::size() == 1);
+        CPPUNIT_ASSERT(use("NCHandleCacheTest_3.nc", true) == id3);
+    }
+
+    // A file in use is never closed, even if the cache is over its size
+    void in_use_test()
+    {
+        NCHandleCache::set_max_entries(1);
+
+        int ncid;
+        bool cached;
+        CPPUNIT_ASSERT(NCHandleCache::acquire("NCHandleCacheTest_1.nc", ncid, cached) == NC_NOERR);
+        CPPUNIT_ASSERT(cached);
+
+        use("NCHandleCacheTest_2.nc", true);
+        int ndims;
+        CPPUNIT_ASSERT(nc_inq_ndims(ncid, &ndims) == NC_NOERR);
+        CPPUNIT_ASSERT(NCHandleCache::size() == 1);
+
+        NCHandleCache::close_all();
+        CPPUNIT_ASSERT(nc_inq_ndims(ncid, &ndims) == NC_NOERR);
+
+        NCHandleCache::release("NCHandleCacheTest_1.nc", ncid, cached);
+        NCHandleCache::close_all();
+        CPPUNIT_ASSERT(NCHandleCache::size() == 0);
+    }
+
+    // A file replaced after it was opened is opened again
+    void changed_file_test()
+    {
+        NCHandleCache::set_max_entries(2);
+
+        int old_id = use("NCHandleCacheTest_1.nc", true);
+
+        // The cache still has the old file open, so the new one is a
+        // different inode
+        make_file("NCHandleCacheTest_tmp.nc", 10);
+        CPPUNIT_ASSERT(rename("NCHandleCacheTest_tmp.nc", "NCHandleCacheTest_1.nc") == 0);
+
+        int new_id = use("NCHandleCacheTest_1.nc", true);
+        CPPUNIT_ASSERT(NCHandleCache::size() == 1);
+
+        size_t len;
+        CPPUNIT_ASSERT(nc_inq_dimlen(new_id, 0, &len) == NC_NOERR);
+        DBG(cerr << "old ncid: " << old_id << ", new ncid: " << new_id << ", len: " << len << endl);
+        CPPUNIT_ASSERT(len == 10);
+    }
+
+    void handle_test()
+    {
+        NCHandleCache::set_max_entries(2);
+
+        int ncid;
+        {
+            NCHandle handle("NCHandleCacheTest_2.nc");
+            ncid = handle.ncid();
+            size_t len;
+            CPPUNIT_ASSERT(nc_inq_dimlen(ncid, 0, &len) == NC_NOERR);
+            CPPUNIT_ASSERT(len == 2);
+        }
+        CPPUNIT_ASSERT(use("NCHandleCacheTest_2.nc", true) == ncid);
+
+        try {
+            NCHandle handle("NCHandleCacheTest_none.nc");
+            CPPUNIT_FAIL("Expected an Error for a missing file");
+        }
+        catch (libdap::Error &e) {
+            DBG(cerr << "Caught the expected error" << endl);
+        }
+        CPPUNIT_ASSERT(NCHandleCache::size() == 1);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(NCHandleCacheTest);
+
+int main(int argc, char*argv[])
+{
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    GetOpt getopt(argc, argv, "dD");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = true;  // debug is a static global
+            break;
+        case 'D':
+            debug = true;  // debug is a static global
+            bes_debug = true;  // debug is a static global
+            break;
+        default:
+            break;
+        }
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            test = string("NCHandleCacheTest::") + argv[i++];
+
+            cerr << endl << "Running test " << test << endl << endl;
+
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of nc_handler, a data handler for the OPeNDAP data
+// server.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Time strided reads of a 2D float variable with nc_get_vars() and with
+// nc_get_vars_decimated(). Usage: decimate_bench [-c] [-n size] [file]
+// -c makes the variable chunked (netCDF-4); -n sets the size of each
+// dimension (default 4096).
+
+#include "config_nc.h"
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include <netcdf.h>
+
+#include "nc_util.h"
+
+using namespace std;
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1.0e6;
+}
+
+static void check(int errstat, const char *what)
+{
+    if (errstat != NC_NOERR) {
+        cerr << what << ": " << nc_strerror(errstat) << endl;
+        exit(1);
+    }
+}
+
+static void make_file(const string &file, size_t n, bool chunked)
+{
+    int ncid, dims[2], varid;
+    int mode = NC_CLOBBER;
+#if NETCDF_VERSION >= 4
+    if (chunked) mode |= NC_NETCDF4;
+#endif
+    check(nc_create(file.c_str(), mode, &ncid), "nc_create");
+    check(nc_def_dim(ncid, "y", n, &dims[0]), "nc_def_dim");
+    check(nc_def_dim(ncid, "x", n, &dims[1]), "nc_def_dim");
+    check(nc_def_var(ncid, "v", NC_FLOAT, 2, dims, &varid), "nc_def_var");
+#if NETCDF_VERSION >= 4
+    if (chunked) {
+        size_t chunks[2] = { 256, 256 };
+        check(nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks), "nc_def_var_chunking");
+    }
+#endif
+    check(nc_enddef(ncid), "nc_enddef");
+
+    vector<float> row(n);
+    for (size_t y = 0; y < n; ++y) {
+        for (size_t x = 0; x < n; ++x)
+            row[x] = y * n + x;
+        size_t start[2] = { y, 0 };
+        size_t count[2] = { 1, n };
+        check(nc_put_vara_float(ncid, varid, start, count, &row[0]), "nc_put_vara_float");
+    }
+    check(nc_close(ncid), "nc_close");
+}
+
+int main(int argc, char *argv[])
+{
+    bool chunked = false;
+    size_t n = 4096;
+    int c;
+    while ((c = getopt(argc, argv, "cn:")) != -1) {
+        switch (c) {
+        case 'c':
+            chunked = true;
+            break;
+        case 'n':
+            n = strtoul(optarg, 0, 10);
+            break;
+        default:
+            cerr << "Usage: decimate_bench [-c] [-n size] [file]" << endl;
+            return 1;
+        }
+    }
+    string file = optind < argc ? argv[optind] : "decimate_bench.nc";
+
+    make_file(file, n, chunked);
+
+    int ncid, varid;
+    check(nc_open(file.c_str(), NC_NOWRITE, &ncid), "nc_open");
+    check(nc_inq_varid(ncid, "v", &varid), "nc_inq_varid");
+
+    const size_t buffer_size = 16 * 1024 * 1024;
+    cout << "stride  nc_get_vars(s)  decimated(s)  speedup  planned" << endl;
+    for (ptrdiff_t stride = 1; stride <= 64; stride *= 2) {
+        size_t cor[2] = { 0, 0 };
+        size_t edg[2] = { (n - 1) / stride + 1, (n - 1) / stride + 1 };
+        ptrdiff_t step[2] = { stride, stride };
+        vector<float> a(edg[0] * edg[1]), b(edg[0] * edg[1]);
+
+        double t0 = now();
+        check(nc_get_vars(ncid, varid, cor, edg, step, &a[0]), "nc_get_vars");
+        double t_vars = now() - t0;
+
+        size_t rows;
+        bool planned = nc_plan_decimated_read(ncid, varid, 2, cor, edg, step, sizeof(float), buffer_size, rows);
+        if (rows == 0) {
+            cout << setw(6) << stride << "  " << setw(14) << t_vars << "  (does not fit)" << endl;
+            continue;
+        }
+        t0 = now();
+        check(nc_get_vars_decimated(ncid, varid, 2, cor, edg, step, sizeof(float), rows, &b[0]),
+            "nc_get_vars_decimated");
+        double t_dec = now() - t0;
+
+        if (a != b) {
+            cerr << "Results differ for stride " << stride << endl;
+            return 1;
+        }
+
+        cout << setw(6) << stride << "  " << setw(14) << t_vars << "  " << setw(12) << t_dec << "  " << setw(7)
+            << t_vars / t_dec << "  " << (planned ? "yes" : "no") << endl;
+    }
+
+    nc_close(ncid);
+    unlink(file.c_str());
+
+    return 0;
+}
@@ -0,0 +1,294 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Authors: Nathan Potter <ndp@opendap.org>
+//          James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+
+#include "MeshSpatialIndex.h"
+
+// The average number of nodes in a bin and the most bins along one side
+#define NODES_PER_BIN 16
+#define MAX_BINS_PER_SIDE 1024
+
+using namespace std;
+
+namespace ugrid {
+
+BoundingBox::BoundingBox() :
+    xmin(-numeric_limits<double>::infinity()), xmax(numeric_limits<double>::infinity()), ymin(
+        -numeric_limits<double>::infinity()), ymax(numeric_limits<double>::infinity())
+{
+}
+
+// GridFields compares the (float) attribute values with the expression's
+// constants using its own conversions; widen the box a little so that the
+// candidates always include the nodes it will keep.
+static double slack(double v)
+{
+    return 1.0e-5 * max(1.0, fabs(v));
+}
+
+static bool inside(double v, double lo, double hi)
+{
+    return v >= lo - slack(lo) && v <= hi + slack(hi);
+}
+
+MeshSpatialIndex::MeshSpatialIndex(const vector<float> &x, const vector<float> &y, const vector<int> &cells,
+    int nodesPerFace) :
+    d_nodeCount(x.size()), d_faceCount(0), d_nodesPerFace(nodesPerFace), d_x(x), d_y(y), d_xmin(0), d_xmax(0), d_ymin(
+        0), d_ymax(0), d_xBins(1), d_yBins(1), d_cells(cells), d_usable(true)
+{
+    if (x.size() != y.size() || nodesPerFace <= 0 || cells.size() % nodesPerFace != 0) {
+        d_usable = false;
+        return;
+    }
+
+    d_faceCount = cells.size() / nodesPerFace;
+
+    // Nodes with a missing coordinate can satisfy an expression on the other
+    // coordinate alone; there's no bin for them, so don't use the index.
+    for (int n = 0; n < d_nodeCount; ++n) {
+        if (std::isnan(d_x[n]) || std::isnan(d_y[n])) {
+            d_usable = false;
+            return;
+        }
+
+        if (n == 0 || d_x[n] < d_xmin) d_xmin = d_x[n];
+        if (n == 0 || d_x[n] > d_xmax) d_xmax = d_x[n];
+        if (n == 0 || d_y[n] < d_ymin) d_ymin = d_y[n];
+        if (n == 0 || d_y[n] > d_ymax) d_ymax = d_y[n];
+    }
+
+    int side = static_cast<int>(sqrt(static_cast<double>(d_nodeCount) / NODES_PER_BIN));
+    d_xBins = d_yBins = max(1, min(side, MAX_BINS_PER_SIDE));
+
+    // Sort the nodes into the bins (a counting sort, so each bin's nodes are
+    // in node order)
+    int bins = d_xBins * d_yBins;
+    vector<int> binOf(d_nodeCount);
+    d_binStart.assign(bins + 1, 0);
+    for (int n = 0; n < d_nodeCount; ++n) {
+        binOf[n] = yBin(d_y[n]) * d_xBins + xBin(d_x[n]);
+        ++d_binStart[binOf[n] + 1];
+    }
+    for (int b = 0; b < bins; ++b)
+        d_binStart[b + 1] += d_binStart[b];
+
+    d_binNodes.resize(d_nodeCount);
+    vector<int> next(d_binStart.begin(), d_binStart.end() - 1);
+    for (int n = 0; n < d_nodeCount; ++n)
+        d_binNodes[next[binOf[n]]++] = n;
+
+    // Record the faces that use each node
+    d_nodeFaceStart.assign(d_nodeCount + 1, 0);
+    for (vector<int>::size_type i = 0; i < d_cells.size(); ++i) {
+        if (d_cells[i] < 0 || d_cells[i] >= d_nodeCount) {
+            d_usable = false;
+            return;
+        }
+        ++d_nodeFaceStart[d_cells[i] + 1];
+    }
+    for (int n = 0; n < d_nodeCount; ++n)
+        d_nodeFaceStart[n + 1] += d_nodeFaceStart[n];
+
+    d_nodeFaces.resize(d_cells.size());
+    next.assign(d_nodeFaceStart.begin(), d_nodeFaceStart.end() - 1);
+    for (vector<int>::size_type i = 0; i < d_cells.size(); ++i)
+        d_nodeFaces[next[d_cells[i]]++] = i / d_nodesPerFace;
+}
+
+int MeshSpatialIndex::xBin(double x) const
+{
+    if (d_xmax == d_xmin) return 0;
+
+    double b = (x - d_xmin) / (d_xmax - d_xmin) * d_xBins;
+    if (!(b > 0)) return 0;
+    if (b >= d_xBins) return d_xBins - 1;
+    return static_cast<int>(b);
+}
+
+int MeshSpatialIndex::yBin(double y) const
+{
+    if (d_ymax == d_ymin) return 0;
+
+    double b = (y - d_ymin) / (d_ymax - d_ymin) * d_yBins;
+    if (!(b > 0)) return 0;
+    if (b >= d_yBins) return d_yBins - 1;
+    return static_cast<int>(b);
+}
+
+/**
+ * @brief Find the part of the mesh that a bounding box can select
+ *
+ * @param box The region
+ * @param nodes Value-result parameter; the sorted numbers of the nodes in
+ * the box and the nodes of the faces in 'faces'
+ * @param faces Value-result parameter; the sorted numbers of the faces that
+ * use a node in the box
+ * @return False if the index cannot be used, in which case nodes and faces
+ * are not changed.
+ */
+bool MeshSpatialIndex::candidates(const BoundingBox &box, vector<int> &nodes, vector<int> &faces) const
+{
+    if (!d_usable) return false;
+
+    nodes.clear();
+    faces.clear();
+
+    if (box.xmin > box.xmax || box.ymin > box.ymax) return true;
+
+    int x0 = xBin(box.xmin - slack(box.xmin));
+    int x1 = xBin(box.xmax + slack(box.xmax));
+    int y0 = yBin(box.ymin - slack(box.ymin));
+    int y1 = yBin(box.ymax + slack(box.ymax));
+
+    for (int yb = y0; yb <= y1; ++yb) {
+        for (int xb = x0; xb <= x1; ++xb) {
+            int b = yb * d_xBins + xb;
+            for (int i = d_binStart[b]; i < d_binStart[b + 1]; ++i) {
+                int n = d_binNodes[i];
+                if (!inside(d_x[n], box.xmin, box.xmax) || !inside(d_y[n], box.ymin, box.ymax)) continue;
+
+                nodes.push_back(n);
+                faces.insert(faces.end(), d_nodeFaces.begin() + d_nodeFaceStart[n],
+                    d_nodeFaces.begin() + d_nodeFaceStart[n + 1]);
+            }
+        }
+    }
+
+    sort(faces.begin(), faces.end());
+    faces.erase(unique(faces.begin(), faces.end()), faces.end());
+
+    for (vector<int>::iterator f = faces.begin(), e = faces.end(); f != e; ++f) {
+        vector<int>::const_iterator corners = d_cells.begin() + (*f * d_nodesPerFace);
+        nodes.insert(nodes.end(), corners, corners + d_nodesPerFace);
+    }
+
+    sort(nodes.begin(), nodes.end());
+    nodes.erase(unique(nodes.begin(), nodes.end()), nodes.end());
+
+    return true;
+}
+
+static string trim(const string &s)
+{
+    string::size_type first = s.find_first_not_of(" \t");
+    if (first == string::npos) return "";
+    return s.substr(first, s.find_last_not_of(" \t") - first + 1);
+}
+
+static bool toNumber(const string &s, double &value)
+{
+    if (s.empty()) return false;
+
+    char *end;
+    value = strtod(s.c_str(), &end);
+    return *end == '\0' && !std::isnan(value);
+}
+
+// Narrow [lo, hi] using 'coordinate op value'
+static void narrow(const string &op, double value, double &lo, double &hi)
+{
+    if (op[0] == '<') {
+        hi = min(hi, value);
+    }
+    else if (op[0] == '>') {
+        lo = max(lo, value);
+    }
+    else {
+        lo = max(lo, value);
+        hi = min(hi, value);
+    }
+}
+
+/**
+ * @brief Find the bounding box that a filter expression selects
+ *
+ * Only an expression that is a conjunction ('&') of clauses can be used.
+ * Clauses of the form 'name op number' or 'number op name', where name is
+ * one of the coordinate names and op is one of <, <=, >, >=, = or ==,
+ * narrow the box; other clauses are ignored since they can only remove more
+ * nodes.
+ *
+ * @param expression The GridFields filter expression
+ * @param xName The name of the first node coordinate
+ * @param yName The name of the second node coordinate
+ * @param box Value-result parameter
+ * @return True if at least one side of the box was bounded.
+ */
+bool MeshSpatialIndex::parseBounds(const string &expression, const string &xName, const string &yName,
+    BoundingBox &box)
+{
+    if (expression.find_first_of("|()!") != string::npos) return false;
+
+    bool bounded = false;
+    string::size_type start = 0;
+    while (start <= expression.size()) {
+        string::size_type end = expression.find('&', start);
+        if (end == string::npos) end = expression.size();
+
+        string clause = expression.substr(start, end - start);
+        start = end + 1;
+
+        string::size_type pos = clause.find_first_of("<>=");
+        if (pos == string::npos) continue;
+
+        string op = clause.substr(pos, 1);
+        string::size_type len = (pos + 1 < clause.size() && clause[pos + 1] == '=') ? 2 : 1;
+        string lhs = trim(clause.substr(0, pos));
+        string rhs = trim(clause.substr(pos + len));
+
+        double value;
+        string name;
+        if (toNumber(rhs, value)) {
+            name = lhs;
+        }
+        else if (toNumber(lhs, value)) {
+            // 'number op name'; turn it around
+            name = rhs;
+            if (op == "<")
+                op = ">";
+            else if (op == ">") op = "<";
+        }
+        else {
+            continue;
+        }
+
+        if (name == xName) {
+            narrow(op, value, box.xmin, box.xmax);
+            bounded = true;
+        }
+        else if (name == yName) {
+            narrow(op, value, box.ymin, box.ymax);
+            bounded = true;
+        }
+    }
+
+    return bounded;
+}
+
+} // namespace ugrid
@@ -0,0 +1,113 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Authors: Nathan Potter <ndp@opendap.org>
+//          James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _MeshSpatialIndex_h
+#define _MeshSpatialIndex_h 1
+
+#include <string>
+#include <vector>
+
+namespace ugrid {
+
+/**
+ * The region selected by the coordinate clauses of a filter expression.
+ * Unbounded sides are +/- infinity.
+ */
+struct BoundingBox {
+    double xmin, xmax, ymin, ymax;
+
+    BoundingBox();
+};
+
+/**
+ * @brief Uniform bins over the nodes of a 2D mesh
+ *
+ * The nodes are sorted into a grid of equal sized bins that covers their
+ * extent, and for each node the faces that use it are recorded. Given a
+ * bounding box, candidates() visits only the bins that overlap the box and
+ * returns the faces that use a node in those bins, along with every node
+ * those faces use (and the nodes in the bins). That sub-mesh holds every
+ * node in the box and every face that has one of those nodes as a corner,
+ * so a node restriction whose expression is bounded by the box has the same
+ * result on it as on the whole mesh.
+ *
+ * Node numbers are zero-based. A face that uses a node number outside the
+ * mesh (e.g., the _FillValue of a flexible mesh) makes the index unusable.
+ */
+class MeshSpatialIndex {
+private:
+    int d_nodeCount;
+    int d_faceCount;
+    int d_nodesPerFace;
+
+    std::vector<float> d_x;
+    std::vector<float> d_y;
+
+    double d_xmin, d_xmax, d_ymin, d_ymax;
+    int d_xBins, d_yBins;
+
+    // The nodes in bin b are d_binNodes[d_binStart[b]] .. d_binNodes[d_binStart[b+1]-1]
+    std::vector<int> d_binStart;
+    std::vector<int> d_binNodes;
+
+    // The faces that use node n, stored the same way
+    std::vector<int> d_nodeFaceStart;
+    std::vector<int> d_nodeFaces;
+
+    // Copy of the face-node connectivity, faceCount x nodesPerFace
+    std::vector<int> d_cells;
+
+    bool d_usable;
+
+    int xBin(double x) const;
+    int yBin(double y) const;
+
+public:
+    MeshSpatialIndex(const std::vector<float> &x, const std::vector<float> &y, const std::vector<int> &cells,
+        int nodesPerFace);
+    virtual ~MeshSpatialIndex()
+    {
+    }
+
+    /// False when a face uses a node that is not in the mesh
+    bool usable() const
+    {
+        return d_usable;
+    }
+
+    int getBinCount() const
+    {
+        return d_xBins * d_yBins;
+    }
+
+    bool candidates(const BoundingBox &box, std::vector<int> &nodes, std::vector<int> &faces) const;
+
+    static bool parseBounds(const std::string &expression, const std::string &xName, const std::string &yName,
+        BoundingBox &box);
+};
+
+} // namespace ugrid
+
+#endif // _MeshSpatialIndex_h
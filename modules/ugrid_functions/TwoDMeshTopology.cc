@@ -27,6 +27,9 @@
 
 #include "config.h"
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include <sstream>
 #include <vector>
 #include <algorithm>
@@ -65,12 +68,19 @@ using namespace std;
 using namespace libdap;
 using namespace ugrid;
 
+// The most meshes whose values are held at one time. When the cache is full
+// it is emptied.
+#define UGRID_MESH_CACHE_ENTRIES 8
+
 namespace ugrid {
 
+std::map<string, TwoDMeshTopology::MeshData *> TwoDMeshTopology::d_meshCache;
+
 /* not used. faceCoordinateNames(0), */
 TwoDMeshTopology::TwoDMeshTopology() :
     d_meshVar(0), nodeCoordinateArrays(0), nodeCount(0), faceNodeConnectivityArray(0), faceCount(0), faceCoordinateArrays(
-        0), gridTopology(0), d_inputGridField(0), resultGridField(0), fncCellArray(0), _initialized(false)
+        0), gridTopology(0), d_inputGridField(0), resultGridField(0), fncCellArray(0), d_meshData(0), d_ownsMeshData(
+        false), d_meshDataCached(false), d_subsetGrid(0), d_subsetGridField(0), d_subsetCells(0), _initialized(false)
 {
     rangeDataArrays = new vector<MeshDataVariable *>();
     sharedIntArrays = new vector<int *>();
@@ -85,6 +95,12 @@ TwoDMeshTopology::~TwoDMeshTopology()
     BESDEBUG("ugrid", "~TwoDMeshTopology() - Deleting GF::GridField 'resultGridField'." << endl);
     delete resultGridField;
 
+    BESDEBUG("ugrid", "~TwoDMeshTopology() - Deleting GF::GridField 'subsetGridField'." << endl);
+    delete d_subsetGridField;
+
+    BESDEBUG("ugrid", "~TwoDMeshTopology() - Deleting GF::Grid 'subsetGrid'." << endl);
+    delete d_subsetGrid;
+
     BESDEBUG("ugrid", "~TwoDMeshTopology() - Deleting GF::GridField 'inputGridField'." << endl);
     delete d_inputGridField;
 
@@ -127,6 +143,9 @@ TwoDMeshTopology::~TwoDMeshTopology()
 
     BESDEBUG("ugrid", "~TwoDMeshTopology() - Deleting face node connectivity cell array (GF::Node's)." << endl);
     delete[] fncCellArray;
+    delete[] d_subsetCells;
+
+    if (d_ownsMeshData) delete d_meshData;
 
     BESDEBUG("ugrid", "~TwoDMeshTopology() - END" << endl);
 }
@@ -665,11 +684,162 @@ void TwoDMeshTopology::ingestNodeCoordinateArrays(libdap::BaseType *meshTopology
 
 }
 
+/**
+ * Are all of the array's values being used? Only whole arrays are cached.
+ */
+static bool isWhole(libdap::Array *a)
+{
+    for (libdap::Array::Dim_iter d = a->dim_begin(), e = a->dim_end(); d != e; ++d) {
+        if (a->dimension_size(d, true) != a->dimension_size(d, false)) return false;
+    }
+    return true;
+}
+
+/**
+ * Get the key used to cache the mesh's values along with the modification time
+ * and size of the dataset. Returns false if the values cannot be cached because
+ * the dataset is not a file or some of the mesh's arrays are constrained.
+ */
+bool TwoDMeshTopology::getMeshCacheKey(string &key, time_t &mtime, off_t &size)
+{
+    string dataset = faceNodeConnectivityArray->dataset();
+
+    struct stat sb;
+    if (dataset.empty() || stat(dataset.c_str(), &sb) != 0) return false;
+
+    if (!isWhole(faceNodeConnectivityArray)) return false;
+
+    vector<libdap::Array *>::iterator it;
+    for (it = nodeCoordinateArrays->begin(); it != nodeCoordinateArrays->end(); ++it)
+        if (!isWhole(*it)) return false;
+    for (it = faceCoordinateArrays->begin(); it != faceCoordinateArrays->end(); ++it)
+        if (!isWhole(*it)) return false;
+
+    ostringstream oss;
+    oss << dataset << '#' << meshVarName() << '#' << nodeCount << '#' << faceCount;
+    key = oss.str();
+    mtime = sb.st_mtime;
+    size = sb.st_size;
+
+    return true;
+}
+
+/**
+ * Find the mesh's values in the cache or make a new (empty) MeshData for
+ * them. Either way, d_meshData is set.
+ */
+void TwoDMeshTopology::getMeshData()
+{
+    time_t mtime = 0;
+    off_t size = 0;
+    if (getMeshCacheKey(d_meshCacheKey, mtime, size)) {
+        std::map<string, MeshData *>::iterator i = d_meshCache.find(d_meshCacheKey);
+        if (i != d_meshCache.end()) {
+            if (i->second->mtime == mtime && i->second->size == size) {
+                BESDEBUG("ugrid", "TwoDMeshTopology::getMeshData() - Found " << d_meshCacheKey << " in the cache." << endl);
+                d_meshData = i->second;
+                d_meshDataCached = true;
+                return;
+            }
+
+            delete i->second;
+            d_meshCache.erase(i);
+        }
+    }
+    else {
+        d_meshCacheKey.clear();
+    }
+
+    d_meshData = new MeshData;
+    d_meshData->mtime = mtime;
+    d_meshData->size = size;
+    d_ownsMeshData = true;
+}
+
+/**
+ * @brief Remove all of the cached mesh values
+ */
+void TwoDMeshTopology::clearMeshCache()
+{
+    for (std::map<string, MeshData *>::iterator i = d_meshCache.begin(), e = d_meshCache.end(); i != e; ++i)
+        delete i->second;
+
+    d_meshCache.clear();
+}
+
+/**
+ * Make the GF::Array for a coordinate variable. If the mesh's values were
+ * cached they are copied from the cache, otherwise the variable is read and,
+ * if the mesh can be cached, its values are saved in 'coordinate'.
+ */
+GF::Array *TwoDMeshTopology::getCoordinateGFArray(libdap::Array *coordinateArray, MeshData::Coordinate &coordinate)
+{
+    if (!d_meshDataCached) {
+        GF::Array *gfa = extractGridFieldArray(coordinateArray, sharedIntArrays, sharedFloatArrays);
+        if (d_meshCacheKey.empty()) return gfa;
+
+        libdap::Type type = coordinateArray->var()->type();
+        coordinate.isFloat = (type == dods_float32_c || type == dods_float64_c);
+        if (coordinate.isFloat)
+            coordinate.floats.assign(sharedFloatArrays->back(), sharedFloatArrays->back() + coordinateArray->length());
+        else
+            coordinate.ints.assign(sharedIntArrays->back(), sharedIntArrays->back() + coordinateArray->length());
+
+        return gfa;
+    }
+
+    vector<int> all;
+    return getSubsetGFArray(coordinateArray->var()->name(), coordinate, all);
+}
+
+/**
+ * Make a GF::Array holding the values of 'coordinate' at the positions listed
+ * in 'subset' or, if 'subset' is empty, all of its values.
+ */
+GF::Array *TwoDMeshTopology::getSubsetGFArray(const string &name, const MeshData::Coordinate &coordinate,
+    const vector<int> &subset)
+{
+    GF::Array *gfa;
+    if (coordinate.isFloat) {
+        long size = subset.empty() ? coordinate.floats.size() : subset.size();
+        float *values = new float[size];
+        if (subset.empty())
+            copy(coordinate.floats.begin(), coordinate.floats.end(), values);
+        else
+            for (long i = 0; i < size; ++i)
+                values[i] = coordinate.floats[subset[i]];
+
+        gfa = new GF::Array(name, GF::FLOAT);
+        gfa->shareFloatData(values, size);
+        sharedFloatArrays->push_back(values);
+    }
+    else {
+        long size = subset.empty() ? coordinate.ints.size() : subset.size();
+        int *values = new int[size];
+        if (subset.empty())
+            copy(coordinate.ints.begin(), coordinate.ints.end(), values);
+        else
+            for (long i = 0; i < size; ++i)
+                values[i] = coordinate.ints[subset[i]];
+
+        gfa = new GF::Array(name, GF::INT);
+        gfa->shareIntData(values, size);
+        sharedIntArrays->push_back(values);
+    }
+
+    return gfa;
+}
+
 void TwoDMeshTopology::buildBasicGfTopology()
 {
 
     BESDEBUG("ugrid",
         "TwoDMeshTopology::buildBasicGfTopology() - Building GridFields objects for mesh_topology variable "<< getMeshVariable()->name() << endl);
+
+    // If this mesh was used before, its values are in the cache and the
+    // DAP variables are not read again.
+    getMeshData();
+
     // Start building the Grid for the GridField operation.
     BESDEBUG("ugrid",
         "TwoDMeshTopology::buildGridFieldsTopology() - Constructing new GF::Grid for "<< meshVarName() << endl);
@@ -687,7 +857,6 @@ void TwoDMeshTopology::buildBasicGfTopology()
 
     // Attach the Mesh to the grid.
     // Get the face node connectivity cells (i think these correspond to the GridFields K cells of Rank 2)
-    // FIXME Read this array once! It is read again below..
     BESDEBUG("ugrid",
         "TwoDMeshTopology::buildGridFieldsTopology() - Building face node connectivity Cell array from the DAP version" << endl);
     GF::CellArray *faceNodeConnectivityCells = getFaceNodeConnectivityCells();
@@ -703,28 +872,40 @@ void TwoDMeshTopology::buildBasicGfTopology()
     d_inputGridField = new GF::GridField(gridTopology);
     // TODO Question for Bill: Can we delete the GF::Grid (tdmt->gridTopology) here?
 
+    if (!d_meshDataCached) {
+        d_meshData->nodeCoordinates.resize(nodeCoordinateArrays->size());
+        d_meshData->faceCoordinates.resize(faceCoordinateArrays->size());
+    }
+
     // We read and add the coordinate data (using GridField->addAttribute()) to the GridField at
     // grid dimension/rank/dimension 0 (a.k.a. node)
-    vector<libdap::Array *>::iterator ncit;
-    for (ncit = nodeCoordinateArrays->begin(); ncit != nodeCoordinateArrays->end(); ++ncit) {
-        libdap::Array *nca = *ncit;
+    for (vector<libdap::Array *>::size_type i = 0; i < nodeCoordinateArrays->size(); ++i) {
+        libdap::Array *nca = (*nodeCoordinateArrays)[i];
         BESDEBUG("ugrid",
             "TwoDMeshTopology::buildGridFieldsTopology() - Adding node coordinate "<< nca->name() << " to GF::GridField at rank 0" << endl);
-        GF::Array *gfa = extractGridFieldArray(nca, sharedIntArrays, sharedFloatArrays);
+        GF::Array *gfa = getCoordinateGFArray(nca, d_meshData->nodeCoordinates[i]);
         gfArrays.push_back(gfa);
         d_inputGridField->AddAttribute(node, gfa);
     }
 
     // We read and add the coordinate data (using GridField->addAttribute() to the GridField at
     // grid dimension/rank/dimension 0 (a.k.a. node)
-    for (ncit = faceCoordinateArrays->begin(); ncit != faceCoordinateArrays->end(); ++ncit) {
-        libdap::Array *fca = *ncit;
+    for (vector<libdap::Array *>::size_type i = 0; i < faceCoordinateArrays->size(); ++i) {
+        libdap::Array *fca = (*faceCoordinateArrays)[i];
         BESDEBUG("ugrid",
             "TwoDMeshTopology::buildGridFieldsTopology() - Adding face coordinate "<< fca->name() << " to GF::GridField at rank " << face << endl);
-        GF::Array *gfa = extractGridFieldArray(fca, sharedIntArrays, sharedFloatArrays);
+        GF::Array *gfa = getCoordinateGFArray(fca, d_meshData->faceCoordinates[i]);
         gfArrays.push_back(gfa);
         d_inputGridField->AddAttribute(face, gfa);
     }
+
+    // All of the values have been read; save them for the next request.
+    if (d_ownsMeshData && !d_meshCacheKey.empty()) {
+        if (d_meshCache.size() >= UGRID_MESH_CACHE_ENTRIES) clearMeshCache();
+
+        d_meshCache[d_meshCacheKey] = d_meshData;
+        d_ownsMeshData = false;
+    }
 }
 
 int TwoDMeshTopology::getResultGridSize(locationType dim)
@@ -836,17 +1017,30 @@ GF::CellArray *TwoDMeshTopology::getFaceNodeConnectivityCells()
     int nodesPerFace = faceNodeConnectivityArray->dimension_size(fncNodesDim);
     int total_size = nodesPerFace * faceCount;
 
-    BESDEBUG("ugrid",
-        "TwoDMeshTopology::getFaceNodeConnectivityCells() - Converting FNCArray to GF::Node array." << endl);
-    fncCellArray = getFncArrayAsGFCells(faceNodeConnectivityArray);
-
-    // adjust for the start_index (cardinal or ordinal array access)
-    int startIndex = getStartIndex(faceNodeConnectivityArray);
-    if (startIndex != 0) {
+    if (d_meshDataCached) {
         BESDEBUG("ugrid",
-            "TwoDMeshTopology::getFaceNodeConnectivityCells() - Applying startIndex to GF::Node array." << endl);
-        for (int j = 0; j < total_size; j++) {
-            fncCellArray[j] -= startIndex;
+            "TwoDMeshTopology::getFaceNodeConnectivityCells() - Copying the cached GF::Node array." << endl);
+        fncCellArray = new GF::Node[total_size];
+        copy(d_meshData->cells.begin(), d_meshData->cells.end(), fncCellArray);
+    }
+    else {
+        BESDEBUG("ugrid",
+            "TwoDMeshTopology::getFaceNodeConnectivityCells() - Converting FNCArray to GF::Node array." << endl);
+        fncCellArray = getFncArrayAsGFCells(faceNodeConnectivityArray);
+
+        // adjust for the start_index (cardinal or ordinal array access)
+        int startIndex = getStartIndex(faceNodeConnectivityArray);
+        if (startIndex != 0) {
+            BESDEBUG("ugrid",
+                "TwoDMeshTopology::getFaceNodeConnectivityCells() - Applying startIndex to GF::Node array." << endl);
+            for (int j = 0; j < total_size; j++) {
+                fncCellArray[j] -= startIndex;
+            }
+        }
+
+        if (!d_meshCacheKey.empty()) {
+            d_meshData->nodesPerFace = nodesPerFace;
+            d_meshData->cells.assign(fncCellArray, fncCellArray + total_size);
         }
     }
     // Create the cell array
@@ -868,7 +1062,18 @@ void TwoDMeshTopology::applyRestrictOperator(locationType loc, string filterExpr
     // Build the restriction operator
     BESDEBUG("ugrid",
         "TwoDMeshTopology::applyRestrictOperator() - Constructing new GF::RestrictOp using user "<< "supplied 'dimension' value and filter expression combined with the GF:GridField " << endl);
-    GF::RestrictOp op = GF::RestrictOp(filterExpression, loc, d_inputGridField);
+    GF::GridField *input = d_inputGridField;
+
+    // A node restriction bounded by the node coordinates can only select nodes
+    // in that box and faces that use them; restrict just that part of the mesh.
+    vector<int> nodes, faces;
+    if (loc == node && getRestrictCandidates(filterExpression, nodes, faces)) {
+        BESDEBUG("ugrid",
+            "TwoDMeshTopology::applyRestrictOperator() - Restricting " << nodes.size() << " of " << nodeCount << " nodes and " << faces.size() << " of " << faceCount << " faces." << endl);
+        input = buildSubsetGridField(nodes, faces);
+    }
+
+    GF::RestrictOp op = GF::RestrictOp(filterExpression, loc, input);
 
     // Apply the operator and get the result;
     BESDEBUG("ugrid", "TwoDMeshTopology::applyRestrictOperator() - Applying GridField operator." << endl);
@@ -881,6 +1086,120 @@ void TwoDMeshTopology::applyRestrictOperator(locationType loc, string filterExpr
     BESDEBUG("ugrid", "TwoDMeshTopology::applyRestrictOperator() - END" << endl);
 }
 
+static string getIndexVariableName(locationType location)
+{
+    switch (location) {
+
+    case node:
+        return "node_index";
+
+    case face:
+        return "face_index";
+
+    case edge:
+    default:
+        break;
+    }
+
+    string msg = "ugr5(): Unknown/Unsupported location value '" + libdap::long_to_string(location) + "'";
+    BESDEBUG("ugrid", "TwoDMeshTopology::getIndexVariableName() - " << msg << endl);
+    throw Error(malformed_expr, msg);
+}
+
+/**
+ * Use the spatial index to find the nodes and faces that a node restriction
+ * can select. Returns false if the index cannot be used (the expression does
+ * not bound the first two node coordinates, the mesh is not cached, ...) or
+ * it would not exclude any nodes.
+ */
+bool TwoDMeshTopology::getRestrictCandidates(const string &filterExpression, vector<int> &nodes, vector<int> &faces)
+{
+    // Only meshes in the mesh cache get an index. It is built by the first
+    // restriction, including the one in the request that cached the mesh,
+    // and is kept with the mesh for the requests that follow.
+    if (d_ownsMeshData || d_meshData->nodeCoordinates.size() < 2) return false;
+
+    BoundingBox box;
+    if (!MeshSpatialIndex::parseBounds(filterExpression, (*nodeCoordinateArrays)[0]->var()->name(),
+        (*nodeCoordinateArrays)[1]->var()->name(), box)) return false;
+
+    if (!d_meshData->index) {
+        vector<float> x, y;
+        for (int i = 0; i < 2; ++i) {
+            const MeshData::Coordinate &c = d_meshData->nodeCoordinates[i];
+            vector<float> &v = (i == 0) ? x : y;
+            if (c.isFloat)
+                v = c.floats;
+            else
+                v.assign(c.ints.begin(), c.ints.end());
+        }
+
+        vector<int> cells(d_meshData->cells.begin(), d_meshData->cells.end());
+        d_meshData->index = new MeshSpatialIndex(x, y, cells, d_meshData->nodesPerFace);
+        BESDEBUG("ugrid",
+            "TwoDMeshTopology::getRestrictCandidates() - Built a spatial index with " << d_meshData->index->getBinCount() << " bins." << endl);
+    }
+
+    if (!d_meshData->index->candidates(box, nodes, faces)) return false;
+
+    // An empty sub-mesh is left to GridFields so the error is the same
+    return !faces.empty() && nodes.size() < (vector<int>::size_type) nodeCount;
+}
+
+/**
+ * Build a GF::GridField for part of the mesh. The nodes are renumbered in
+ * their original order and the node_index and face_index attributes hold the
+ * original node and face numbers, so restricting this GridField gives the
+ * same result as restricting the whole mesh.
+ */
+GF::GridField *TwoDMeshTopology::buildSubsetGridField(const vector<int> &nodes, const vector<int> &faces)
+{
+    int nodesPerFace = d_meshData->nodesPerFace;
+
+    d_subsetGrid = new GF::Grid(meshVarName());
+    d_subsetGrid->setKCells(new GF::Implicit0Cells(nodes.size()), node);
+
+    d_subsetCells = new GF::Node[faces.size() * nodesPerFace];
+    for (vector<int>::size_type f = 0; f < faces.size(); ++f) {
+        for (int n = 0; n < nodesPerFace; ++n) {
+            GF::Node original = d_meshData->cells[faces[f] * nodesPerFace + n];
+            d_subsetCells[f * nodesPerFace + n] = lower_bound(nodes.begin(), nodes.end(), original) - nodes.begin();
+        }
+    }
+    d_subsetGrid->setKCells(new GF::CellArray(d_subsetCells, faces.size(), nodesPerFace), face);
+
+    d_subsetGridField = new GF::GridField(d_subsetGrid);
+
+    for (vector<libdap::Array *>::size_type i = 0; i < nodeCoordinateArrays->size(); ++i) {
+        GF::Array *gfa = getSubsetGFArray((*nodeCoordinateArrays)[i]->var()->name(), d_meshData->nodeCoordinates[i],
+            nodes);
+        gfArrays.push_back(gfa);
+        d_subsetGridField->AddAttribute(node, gfa);
+    }
+
+    for (vector<libdap::Array *>::size_type i = 0; i < faceCoordinateArrays->size(); ++i) {
+        GF::Array *gfa = getSubsetGFArray((*faceCoordinateArrays)[i]->var()->name(), d_meshData->faceCoordinates[i],
+            faces);
+        gfArrays.push_back(gfa);
+        d_subsetGridField->AddAttribute(face, gfa);
+    }
+
+    MeshData::Coordinate index;
+    index.isFloat = false;
+
+    index.ints = nodes;
+    GF::Array *nodeIndex = getSubsetGFArray(getIndexVariableName(node), index, vector<int>());
+    gfArrays.push_back(nodeIndex);
+    d_subsetGridField->AddAttribute(node, nodeIndex);
+
+    index.ints = faces;
+    GF::Array *faceIndex = getSubsetGFArray(getIndexVariableName(face), index, vector<int>());
+    gfArrays.push_back(faceIndex);
+    d_subsetGridField->AddAttribute(face, faceIndex);
+
+    return d_subsetGridField;
+}
+
 void TwoDMeshTopology::convertResultGridFieldStructureToDapObjects(vector<BaseType *> *results)
 {
     BESDEBUG("ugrid", "TwoDMeshTopology::convertResultGridFieldStructureToDapObjects() - BEGIN" << endl);
@@ -1236,26 +1555,6 @@ void TwoDMeshTopology::getResultGFAttributeValues(string attrName, libdap::Type
     BESDEBUG("ugrid", "TwoDMeshTopology::getResultGFAttributeValues() - END" << endl);
 }
 
-static string getIndexVariableName(locationType location)
-{
-    switch (location) {
-
-    case node:
-        return "node_index";
-
-    case face:
-        return "face_index";
-
-    case edge:
-    default:
-        break;
-    }
-
-    string msg = "ugr5(): Unknown/Unsupported location value '" + libdap::long_to_string(location) + "'";
-    BESDEBUG("ugrid", "TwoDMeshTopology::getIndexVariableName() - " << msg << endl);
-    throw Error(malformed_expr, msg);
-}
-
 int TwoDMeshTopology::getInputGridSize(locationType location)
 {
     switch (location) {
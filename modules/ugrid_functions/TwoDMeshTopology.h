@@ -28,11 +28,18 @@
 #ifndef _TwoDMeshTopology_h
 #define _TwoDMeshTopology_h 1
 
+#include <sys/types.h>
+#include <time.h>
+
+#include <map>
+
 #include <gridfields/type.h>
 #include <gridfields/gridfield.h>
 #include <gridfields/grid.h>
 #include <gridfields/cellarray.h>
 
+#include "MeshSpatialIndex.h"
+
 using namespace std;
 using namespace libdap;
 
@@ -52,6 +59,41 @@ namespace ugrid {
 class TwoDMeshTopology {
 
 private:
+    /**
+     * The values read from the dataset for a mesh: the face node connectivity
+     * (as GridFields cells, adjusted for the start_index) and the node and
+     * face coordinates, in the order of nodeCoordinateArrays and
+     * faceCoordinateArrays. These are cached so that repeated requests for
+     * the same mesh don't read and convert them again. The spatial index is
+     * built the first time a cached mesh is restricted.
+     */
+    struct MeshData {
+        struct Coordinate {
+            bool isFloat;
+            vector<int> ints;
+            vector<float> floats;
+        };
+
+        time_t mtime;
+        off_t size;
+        int nodesPerFace;
+        vector<GF::Node> cells;
+        vector<Coordinate> nodeCoordinates;
+        vector<Coordinate> faceCoordinates;
+        MeshSpatialIndex *index;
+
+        MeshData() :
+            mtime(0), size(0), nodesPerFace(0), index(0)
+        {
+        }
+        ~MeshData()
+        {
+            delete index;
+        }
+    };
+
+    static std::map<string, MeshData *> d_meshCache;
+
     /**
      * REQUIRED
      *
@@ -190,6 +232,20 @@ private:
 
     GF::Node *fncCellArray;
 
+    // The mesh's values; either an entry in d_meshCache or owned by this
+    // object. d_meshDataCached is true when they came from the cache and
+    // d_meshCacheKey is empty when they cannot be cached.
+    MeshData *d_meshData;
+    bool d_ownsMeshData;
+    bool d_meshDataCached;
+    string d_meshCacheKey;
+
+    // The part of the mesh a node restriction can select, when the spatial
+    // index can be used.
+    GF::Grid *d_subsetGrid;
+    GF::GridField *d_subsetGridField;
+    GF::Node *d_subsetCells;
+
     bool _initialized;
 
     void ingestFaceNodeConnectivityArray(libdap::BaseType *meshTopology, libdap::DDS *dds);
@@ -200,6 +256,13 @@ private:
     int getStartIndex(libdap::Array *array);
     GF::CellArray *getFaceNodeConnectivityCells();
 
+    bool getMeshCacheKey(string &key, time_t &mtime, off_t &size);
+    void getMeshData();
+    GF::Array *getCoordinateGFArray(libdap::Array *coordinateArray, MeshData::Coordinate &coordinate);
+    GF::Array *getSubsetGFArray(const string &name, const MeshData::Coordinate &coordinate, const vector<int> &subset);
+    bool getRestrictCandidates(const string &filterExpression, vector<int> &nodes, vector<int> &faces);
+    GF::GridField *buildSubsetGridField(const vector<int> &nodes, const vector<int> &faces);
+
     libdap::Array *getGFAttributeAsDapArray(libdap::Array *sourceArray, locationType rank,
         GF::GridField *resultGridField);
     libdap::Array *getGridFieldCellArrayAsDapArray(GF::GridField *resultGridField, libdap::Array *sourceFcnArray);
@@ -238,6 +301,8 @@ public:
     void getResultIndex(locationType location, void *target);
 
     void getResultGFAttributeValues(string attrName, libdap::Type type, locationType rank, void *target);
+
+    static void clearMeshCache();
 };
 
 } // namespace ugrid
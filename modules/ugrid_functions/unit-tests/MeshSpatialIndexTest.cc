@@ -0,0 +1,294 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: Nathan David Potter <ndp@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "MeshSpatialIndex.h"
+
+#include "GetOpt.h"
+
+using namespace std;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+namespace ugrid {
+
+class MeshSpatialIndexTest: public CppUnit::TestFixture {
+private:
+    vector<float> x, y;
+    vector<int> cells;
+
+    // A side x side grid of nodes, jittered a little, with two triangles
+    // per square
+    void makeMesh(int side)
+    {
+        x.clear();
+        y.clear();
+        cells.clear();
+
+        srand(side);
+        for (int j = 0; j < side; ++j) {
+            for (int i = 0; i < side; ++i) {
+                x.push_back(-90.0 + i + 0.25 * rand() / RAND_MAX);
+                y.push_back(20.0 + j + 0.25 * rand() / RAND_MAX);
+            }
+        }
+
+        for (int j = 0; j + 1 < side; ++j) {
+            for (int i = 0; i + 1 < side; ++i) {
+                int n = j * side + i;
+                cells.push_back(n);
+                cells.push_back(n + 1);
+                cells.push_back(n + side);
+
+                cells.push_back(n + 1);
+                cells.push_back(n + side + 1);
+                cells.push_back(n + side);
+            }
+        }
+    }
+
+    bool inBox(int n, const BoundingBox &box)
+    {
+        return x[n] >= box.xmin && x[n] <= box.xmax && y[n] >= box.ymin && y[n] <= box.ymax;
+    }
+
+    // The candidates must hold every node in the box, every face that uses
+    // one of them and every node of those faces.
+    void check(const MeshSpatialIndex &index, const BoundingBox &box)
+    {
+        vector<int> nodes, faces;
+        CPPUNIT_ASSERT(index.candidates(box, nodes, faces));
+
+        CPPUNIT_ASSERT(is_sorted(nodes.begin(), nodes.end()));
+        CPPUNIT_ASSERT(is_sorted(faces.begin(), faces.end()));
+
+        for (int n = 0; n < (int) x.size(); ++n) {
+            if (inBox(n, box)) CPPUNIT_ASSERT(binary_search(nodes.begin(), nodes.end(), n));
+        }
+
+        int faceCount = cells.size() / 3;
+        for (int f = 0; f < faceCount; ++f) {
+            bool uses = false;
+            for (int k = 0; k < 3; ++k)
+                uses = uses || inBox(cells[f * 3 + k], box);
+
+            bool found = binary_search(faces.begin(), faces.end(), f);
+            if (uses) CPPUNIT_ASSERT(found);
+            if (found) {
+                for (int k = 0; k < 3; ++k)
+                    CPPUNIT_ASSERT(binary_search(nodes.begin(), nodes.end(), cells[f * 3 + k]));
+            }
+        }
+
+        DBG(cerr << "candidates: " << nodes.size() << " of " << x.size() << " nodes, " << faces.size() << " of "
+            << faceCount << " faces" << endl);
+    }
+
+    static bool is_sorted(vector<int>::iterator i, vector<int>::iterator e)
+    {
+        return adjacent_find(i, e, greater_equal<int>()) == e;
+    }
+
+public:
+    MeshSpatialIndexTest()
+    {
+    }
+
+    ~MeshSpatialIndexTest()
+    {
+    }
+
+    CPPUNIT_TEST_SUITE( MeshSpatialIndexTest );
+
+    CPPUNIT_TEST(candidates_test);
+    CPPUNIT_TEST(outside_test);
+    CPPUNIT_TEST(unusable_test);
+    CPPUNIT_TEST(parse_bounds_test);
+    CPPUNIT_TEST(parse_bounds_reject_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void candidates_test()
+    {
+        makeMesh(60);
+        MeshSpatialIndex index(x, y, cells, 3);
+        CPPUNIT_ASSERT(index.usable());
+        CPPUNIT_ASSERT(index.getBinCount() > 1);
+
+        BoundingBox box;
+        box.xmin = -89.0;
+        box.xmax = -88.0;
+        box.ymin = 28.0;
+        box.ymax = 29.0;
+        check(index, box);
+
+        vector<int> nodes, faces;
+        index.candidates(box, nodes, faces);
+        CPPUNIT_ASSERT(nodes.size() < x.size() / 10);
+
+        // Bounded on one side only
+        BoundingBox half;
+        half.xmin = -60.0;
+        check(index, half);
+
+        // Everything
+        check(index, BoundingBox());
+    }
+
+    void outside_test()
+    {
+        makeMesh(20);
+        MeshSpatialIndex index(x, y, cells, 3);
+
+        BoundingBox box;
+        box.xmin = 100.0;
+        box.xmax = 110.0;
+
+        vector<int> nodes, faces;
+        CPPUNIT_ASSERT(index.candidates(box, nodes, faces));
+        CPPUNIT_ASSERT(nodes.empty());
+        CPPUNIT_ASSERT(faces.empty());
+
+        // An empty box
+        BoundingBox empty;
+        empty.xmin = 1.0;
+        empty.xmax = 0.0;
+        CPPUNIT_ASSERT(index.candidates(empty, nodes, faces));
+        CPPUNIT_ASSERT(faces.empty());
+    }
+
+    void unusable_test()
+    {
+        makeMesh(10);
+
+        // A fill value in the face node connectivity
+        vector<int> filled(cells);
+        filled[5] = 999999;
+        MeshSpatialIndex fill_index(x, y, filled, 3);
+        CPPUNIT_ASSERT(!fill_index.usable());
+
+        vector<int> nodes, faces;
+        CPPUNIT_ASSERT(!fill_index.candidates(BoundingBox(), nodes, faces));
+
+        // A missing coordinate
+        vector<float> nan_y(y);
+        nan_y[3] = numeric_limits<float>::quiet_NaN();
+        MeshSpatialIndex nan_index(x, nan_y, cells, 3);
+        CPPUNIT_ASSERT(!nan_index.usable());
+    }
+
+    void parse_bounds_test()
+    {
+        BoundingBox box;
+        CPPUNIT_ASSERT(MeshSpatialIndex::parseBounds("28.0<lat & lat<29.0 & -89.0<lon & lon<-88.0", "lon", "lat", box));
+        CPPUNIT_ASSERT(box.xmin == -89.0);
+        CPPUNIT_ASSERT(box.xmax == -88.0);
+        CPPUNIT_ASSERT(box.ymin == 28.0);
+        CPPUNIT_ASSERT(box.ymax == 29.0);
+
+        BoundingBox one;
+        CPPUNIT_ASSERT(MeshSpatialIndex::parseBounds("X >= 0", "X", "Y", one));
+        CPPUNIT_ASSERT(one.xmin == 0.0);
+        CPPUNIT_ASSERT(std::isinf(one.xmax));
+        CPPUNIT_ASSERT(std::isinf(one.ymin));
+
+        // Other clauses are ignored; '=' bounds both sides
+        BoundingBox eq;
+        CPPUNIT_ASSERT(MeshSpatialIndex::parseBounds("depth > 3 & Y = 26", "X", "Y", eq));
+        CPPUNIT_ASSERT(eq.ymin == 26.0);
+        CPPUNIT_ASSERT(eq.ymax == 26.0);
+    }
+
+    void parse_bounds_reject_test()
+    {
+        BoundingBox box;
+        CPPUNIT_ASSERT(!MeshSpatialIndex::parseBounds("X > 0 | Y > 0", "X", "Y", box));
+        CPPUNIT_ASSERT(!MeshSpatialIndex::parseBounds("(X > 0)", "X", "Y", box));
+        CPPUNIT_ASSERT(!MeshSpatialIndex::parseBounds("X != 0", "X", "Y", box));
+        CPPUNIT_ASSERT(!MeshSpatialIndex::parseBounds("depth > 3", "X", "Y", box));
+        CPPUNIT_ASSERT(!MeshSpatialIndex::parseBounds("y > 26 & y < 26.1", "X", "Y", box));
+        CPPUNIT_ASSERT(!MeshSpatialIndex::parseBounds("", "X", "Y", box));
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MeshSpatialIndexTest);
+
+} // namespace ugrid
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    char option_char;
+    while ((option_char = getopt()) != EOF)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: MeshSpatialIndexTest has the following tests:" << endl;
+            const std::vector<CppUnit::Test*> &tests = ugrid::MeshSpatialIndexTest::suite()->getTests();
+            unsigned int prefix_len = ugrid::MeshSpatialIndexTest::suite()->getName().append("::").length();
+            for (std::vector<CppUnit::Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = ugrid::MeshSpatialIndexTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+            ++i;
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
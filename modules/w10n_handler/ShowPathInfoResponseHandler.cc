@@ -67,7 +67,7 @@ ShowPathInfoResponseHandler::~ShowPathInfoResponseHandler( )
 void ShowPathInfoResponseHandler::execute(BESDataHandlerInterface &dhi) {
 
 	BESStopWatch sw;
-	if (BESISDEBUG( TIMING_LOG ))
+	if (BESISTIMING)
 		sw.start("ShowPathInfoResponseHandler::execute", dhi.data[REQUEST_ID]);
 
     BESDEBUG(W10N_DEBUG_KEY, "ShowPathInfoResponseHandler::execute() - BEGIN ############################################################## BEGIN" << endl ) ;
@@ -154,6 +154,12 @@ PPTClient::initConnection()
 	throw BESInternalError( err, __FILE__, __LINE__ ) ;
     }
 
+    if( status == PPTProtocol::PPTSERVER_BUSY )
+    {
+	string err = "The server is busy, try again later" ;
+	throw BESInternalError( err, __FILE__, __LINE__ ) ;
+    }
+
     if( status == PPTProtocol::PPTSERVER_AUTHENTICATE )
     {
 	authenticateWithServer() ;
@@ -41,4 +41,5 @@ string PPTProtocol::PPTCLIENT_REQUEST_AUTHPORT = "PPTCLIENT_REQUEST_AUTHPORT" ;
 
 string PPTProtocol::PPTSERVER_CONNECTION_OK = "PPTSERVER_CONNECTION_OK" ;
 string PPTProtocol::PPTSERVER_AUTHENTICATE = "PPTSERVER_AUTHENTICATE" ;
+string PPTProtocol::PPTSERVER_BUSY = "PPTSERVER_BUSY" ;
 
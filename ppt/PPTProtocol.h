@@ -53,6 +53,7 @@ public:
     // From server to client
     static string PPTSERVER_CONNECTION_OK ;
     static string PPTSERVER_AUTHENTICATE ;
+    static string PPTSERVER_BUSY ;
 } ;
 
 #endif // PPTProtocol_h_
@@ -0,0 +1,53 @@
+// PPTResponseFramer.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <map>
+#include <string>
+
+using std::map;
+using std::string;
+
+#include "PPTResponseFramer.h"
+#include "PPTStreamBuf.h"
+#include "Connection.h"
+
+void PPTResponseFramer::error(int /*status*/)
+{
+    d_strm.flush();
+
+    map<string, string> extensions;
+    extensions["status"] = "error";
+    d_connection->sendExtensions(extensions);
+}
+
+void PPTResponseFramer::end_response()
+{
+    d_strm.flush();
+
+    map<string, string> extensions;
+    extensions["batch"] = "more";
+    d_connection->sendExtensions(extensions);
+
+    d_fds.finish();
+}
@@ -0,0 +1,63 @@
+// PPTResponseFramer.h
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef PPTResponseFramer_h
+#define PPTResponseFramer_h 1
+
+#include <ostream>
+
+#include "BESInterface.h"
+
+class Connection;
+class PPTStreamBuf;
+
+/**
+ * End each response of a batched request the way a whole request is ended:
+ * with the extension status=error before an error response and with the
+ * end chunk after it. The extension batch=more tells the client that
+ * another response follows the end chunk.
+ */
+class PPTResponseFramer: public BESInterface::ResponseFramer {
+private:
+    Connection *d_connection;
+    PPTStreamBuf &d_fds;
+    std::ostream &d_strm;
+
+public:
+    /**
+     * @param c The client's connection
+     * @param fds The chunked stream buffer of d_strm
+     * @param strm The stream the responses are written to
+     */
+    PPTResponseFramer(Connection *c, PPTStreamBuf &fds, std::ostream &strm) :
+        d_connection(c), d_fds(fds), d_strm(strm)
+    {
+    }
+    virtual ~PPTResponseFramer() { }
+
+    virtual void error(int status);
+    virtual void end_response();
+};
+
+#endif // PPTResponseFramer_h
@@ -32,6 +32,9 @@
 
 #include "config.h"
 #include <unistd.h>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/socket.h>
 
 #include <string>
 #include <sstream>
@@ -52,6 +55,8 @@ using std::ostringstream;
 #include "TheBESKeys.h"
 #include "BESLog.h"
 #include "BESDebug.h"
+#include "BESMetrics.h"
+#include "BESListenerLoad.h"
 
 #if defined HAVE_OPENSSL && defined NOTTHERE
 #include "SSLServer.h"
@@ -59,9 +64,13 @@ using std::ostringstream;
 
 #define PPT_SERVER_DEFAULT_TIMEOUT 1
 
+// How long, in seconds, to keep a connection that was told the server is
+// busy open so the client can read the answer
+#define PPT_SERVER_BUSY_LINGER 2
+
 PPTServer::PPTServer(ServerHandler *handler, SocketListener *listener, bool isSecure) :
 		PPTConnection(PPT_SERVER_DEFAULT_TIMEOUT), _handler(handler), _listener(listener), _secure(isSecure),
-		_securePort(0), d_num_children(0)
+		_securePort(0), d_num_children(0), d_max_children(0), d_queue_size(0), d_queue_timeout(0)
 {
 	if (!handler) {
 		string err("Null handler passed to PPTServer");
@@ -126,39 +135,192 @@ void PPTServer::get_secure_files()
 	}
 }
 
+/**
+ * @brief Limit the number of child listeners
+ *
+ * With a limit, a connection that arrives when max_children child
+ * listeners are running waits (the server has accepted it but does not
+ * answer the client's greeting) until one exits. At most queue_size
+ * connections wait, each for at most queue_timeout seconds; the server
+ * answers any other connection, and one that waits too long, with
+ * PPTSERVER_BUSY and closes it. Clients should wait longer than
+ * queue_timeout for the greeting.
+ *
+ * @param max_children The most child listeners; 0 (the default) for no limit
+ * @param queue_size The most connections that wait for a child listener
+ * @param queue_timeout Seconds a connection can wait; 0 for no limit
+ */
+void PPTServer::set_admission(unsigned int max_children, unsigned int queue_size, unsigned int queue_timeout)
+{
+	d_max_children = max_children;
+	d_queue_size = queue_size;
+	d_queue_timeout = queue_timeout;
+
+	BESListenerLoad::initialize(max_children, queue_size, queue_timeout);
+}
+
 /** Using the info passed into the SocketLister, wait for an inbound
- request (see SocketListener::accept()). When one is found, do the
- welcome message stuff (welcomeClient()) and then pass \c this to
- the handler's \c handle method. Note that \c this is a pointer to
- a PPTServer which is a kind of Connection. */
+ request (see SocketListener::accept()). When one is found, and there is
+ room for another child listener (see set_admission()), do the welcome
+ message stuff (welcomeClient()) and then pass \c this to the handler's
+ \c handle method. Note that \c this is a pointer to a PPTServer which is
+ a kind of Connection. Otherwise queue the connection or turn it away.
+
+ Connections that are queued are started here, too, once the caller has
+ reaped the child listeners that have exited. */
 void PPTServer::initConnection()
 {
-	_mySock = _listener->accept();
-
-	if (_mySock) {
-		if (_mySock->allowConnection() == true) {
-			// welcome the client
-			BESDEBUG("ppt2", "PPTServer::initConnection() - Calling welcomeClient()" << endl);
-			if (welcomeClient() != -1) {
-
-				incr_num_children();
-				BESDEBUG("ppt2", "PPTServer; number of children: " << get_num_children() << endl);
-
-				// now hand it off to the handler
-				_handler->handle(this);
-
-				// Added this call to close - when the PPTServer class is used by
-				// a server that gets a number of connections on the same port,
-				// one per command, not closing the sockets after a command results
-				// in lots of sockets in the 'CLOSE_WAIT' status.
-				_mySock->close();
-			}
+	close_rejected();
+	start_queued();
+
+	// Wake up often enough to time out the queued and rejected connections
+	Socket *s = _listener->accept(d_queue.empty() && d_rejected.empty() ? SOCKET_LISTENER_TIMEOUT : 1);
+
+	if (s) {
+		if (s->allowConnection() == false) {
+			BESDEBUG("ppt2", "PPTServer::initConnection() - allowConnection() is FALSE! Closing Socket. " << endl);
+			s->close();
+			delete s;
+		}
+		else if (has_room() && d_queue.empty()) {
+			serve(s);
+		}
+		else if (d_queue.size() < d_queue_size) {
+			BESDEBUG("ppt2", "PPTServer::initConnection() - " << get_num_children() << " children; queueing connection" << endl);
+			d_queue.push_back(std::make_pair(s, time(0)));
 		}
 		else {
-			BESDEBUG("ppt2", "PPTServer::initConnection() - allowConnection() is FALSE! Closing Socket. " << endl);
-			_mySock->close();
+			reject(s, false);
 		}
 	}
+
+	BESListenerLoad::set_children(get_num_children());
+	BESListenerLoad::set_queued(d_queue.size());
+}
+
+/** Start a child listener for a connection */
+void PPTServer::serve(Socket *s)
+{
+	_mySock = s;
+
+	// welcome the client
+	BESDEBUG("ppt2", "PPTServer::initConnection() - Calling welcomeClient()" << endl);
+	if (welcomeClient() != -1) {
+
+		incr_num_children();
+		BESDEBUG("ppt2", "PPTServer; number of children: " << get_num_children() << endl);
+
+		// now hand it off to the handler
+		_handler->handle(this);
+
+		// Added this call to close - when the PPTServer class is used by
+		// a server that gets a number of connections on the same port,
+		// one per command, not closing the sockets after a command results
+		// in lots of sockets in the 'CLOSE_WAIT' status.
+		_mySock->close();
+	}
+
+	_mySock = 0;
+	delete s;
+}
+
+/** Answer a connection with PPTSERVER_BUSY and close it. This runs in the
+ master listener, so it must not wait for the client: the connection is
+ shut down for writing and closed later by close_rejected(). */
+void PPTServer::reject(Socket *s, bool timed_out)
+{
+	int fd = s->getSocketDescriptor();
+
+	// Read the client's greeting if it is already here
+	char greeting[64];
+	while (::recv(fd, greeting, sizeof(greeting), MSG_DONTWAIT) > 0)
+		;
+
+	_mySock = s;
+	try {
+		send(PPTProtocol::PPTSERVER_BUSY);
+	}
+	catch (BESError &e) {
+		// The client is gone; nothing else to do
+		BESDEBUG("ppt2", "PPTServer::reject() - " << e.get_message() << endl);
+	}
+	_mySock = 0;
+
+	// Closing the socket now would reset the connection if the greeting
+	// arrives later, and the client might lose the answer. Send the FIN
+	// and keep the socket until the client closes its end.
+	::shutdown(fd, SHUT_WR);
+	d_rejected.push_back(std::make_pair(s, time(0)));
+
+	BESListenerLoad::rejected(timed_out);
+	BESMetrics::count(timed_out ? "bes_connections_timed_out_total" : "bes_connections_rejected_total");
+	LOG("Master listener turned away a connection; " << get_num_children() << " children, " << d_queue.size()
+		<< " queued" << (timed_out ? " (timed out)" : "") << endl);
+}
+
+/** Close the rejected connections the client has closed, or that have
+ lingered for PPT_SERVER_BUSY_LINGER seconds. Reads (and discards) what
+ the clients sent without waiting. */
+void PPTServer::close_rejected()
+{
+	time_t now = time(0);
+	std::deque<std::pair<Socket *, time_t> >::iterator i = d_rejected.begin();
+	while (i != d_rejected.end()) {
+		char buf[64];
+		ssize_t n;
+		while ((n = ::recv(i->first->getSocketDescriptor(), buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+			;
+		bool open = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+		if (open && now - i->second < PPT_SERVER_BUSY_LINGER) {
+			++i;
+		}
+		else {
+			i->first->close();
+			delete i->first;
+			i = d_rejected.erase(i);
+		}
+	}
+}
+
+/** Start the queued connections there is now room for and turn away the
+ ones that have waited too long. The oldest connections are at the front. */
+void PPTServer::start_queued()
+{
+	time_t now = time(0);
+	while (!d_queue.empty()) {
+		std::pair<Socket *, time_t> next = d_queue.front();
+		if (d_queue_timeout && now - next.second >= (time_t) d_queue_timeout) {
+			d_queue.pop_front();
+			reject(next.first, true);
+		}
+		else if (has_room()) {
+			d_queue.pop_front();
+			serve(next.first);
+		}
+		else {
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Close the queued connections in a child listener
+ *
+ * A child listener inherits the master's queued and rejected sockets; it
+ * must close its copies so that the connections end when the master closes
+ * them.
+ */
+void PPTServer::close_queued_connections()
+{
+	for (std::deque<std::pair<Socket *, time_t> >::iterator i = d_queue.begin(), e = d_queue.end(); i != e; ++i)
+		i->first->close();
+
+	d_queue.clear();
+
+	for (std::deque<std::pair<Socket *, time_t> >::iterator i = d_rejected.begin(), e = d_rejected.end(); i != e; ++i)
+		i->first->close();
+
+	d_rejected.clear();
 }
 
 void PPTServer::closeConnection()
@@ -291,6 +453,11 @@ void PPTServer::dump(ostream &strm) const
 	else {
 		strm << BESIndent::LMarg << "listener: null" << endl;
 	}
+	strm << BESIndent::LMarg << "children: " << d_num_children << endl;
+	strm << BESIndent::LMarg << "max children: " << d_max_children << endl;
+	strm << BESIndent::LMarg << "queued: " << d_queue.size() << " of " << d_queue_size << endl;
+	strm << BESIndent::LMarg << "queue timeout: " << d_queue_timeout << endl;
+	strm << BESIndent::LMarg << "rejected, closing: " << d_rejected.size() << endl;
 	strm << BESIndent::LMarg << "secure? " << _secure << endl;
 	if (_secure) {
 		BESIndent::Indent();
@@ -33,6 +33,9 @@
 #ifndef PPTServer_h
 #define PPTServer_h 1
 
+#include <deque>
+#include <ctime>
+
 #include "PPTConnection.h"
 
 class ServerHandler;
@@ -51,6 +54,20 @@ private:
 
 	volatile int d_num_children;
 
+	// Admission control; see set_admission()
+	unsigned int d_max_children;
+	unsigned int d_queue_size;
+	unsigned int d_queue_timeout;
+	std::deque<std::pair<Socket *, time_t> > d_queue;
+	// Connections told the server is busy, waiting for the client to close
+	std::deque<std::pair<Socket *, time_t> > d_rejected;
+
+	void serve(Socket *s);
+	void reject(Socket *s, bool timed_out);
+	void start_queued();
+	void close_rejected();
+	bool has_room() { return d_max_children == 0 || d_num_children < (int) d_max_children; }
+
 	int welcomeClient();
 	void authenticateClient();
 	void get_secure_files();
@@ -62,6 +79,10 @@ public:
 	void incr_num_children() { ++d_num_children; }
 	void decr_num_children() { --d_num_children; }
 
+	void set_admission(unsigned int max_children, unsigned int queue_size, unsigned int queue_timeout);
+	int get_num_queued() { return d_queue.size(); }
+	void close_queued_connections();
+
 	virtual void initConnection();
 	virtual void closeConnection();
 
@@ -46,6 +46,8 @@ using std::setw;
 using std::setfill;
 
 #include "PPTStreamBuf.h"
+#include "BESTracer.h"
+#include "BESMetrics.h"
 
 const char* eod_marker = "0000000d";
 const size_t eod_marker_len = 8;
@@ -81,7 +83,12 @@ int PPTStreamBuf::sync()
         strm << hex << setw(7) << setfill('0') << (unsigned int) (pptr() - pbase()) << "d";
         write(d_fd, strm.str().c_str(), strm.str().length());
 
-        count += write(d_fd, d_buffer, pptr() - pbase());
+        ssize_t bytes = write(d_fd, d_buffer, pptr() - pbase());
+        count += bytes;
+        if (bytes > 0) {
+            BESTracer::count_written(bytes);
+            BESMetrics::count("bes_bytes_sent_total", bytes);
+        }
         setp(d_buffer, d_buffer + d_bufsize);
     }
 
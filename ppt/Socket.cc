@@ -50,7 +50,7 @@
 #include "BESInternalError.h"
 
 Socket::Socket(int socket, struct sockaddr *addr) :
-		_socket(socket), _connected(true), _listening(false), _addr_set(true)
+		_socket(socket), _connected(true), _listening(false), _addr_set(true), _backlog(SOCKET_DEFAULT_BACKLOG)
 {
 	char ip[46];
 	unsigned int port;
@@ -39,6 +39,9 @@
 
 #include "BESObj.h"
 
+// The length of the queue of pending connections used by listen(); see setBacklog()
+#define SOCKET_DEFAULT_BACKLOG 5
+
 class Socket: public BESObj {
 protected:
 	int _socket;
@@ -47,9 +50,11 @@ protected:
 	std::string _ip;
 	unsigned int _port;
 	bool _addr_set;
+	int _backlog;
 public:
 	Socket() :
-			_socket(0), _connected(false), _listening(false), _ip(""), _port(0), _addr_set(false)
+			_socket(0), _connected(false), _listening(false), _ip(""), _port(0), _addr_set(false),
+			_backlog(SOCKET_DEFAULT_BACKLOG)
 	{
 	}
 
@@ -70,6 +75,15 @@ public:
 	{
 		return _listening;
 	}
+	/// Set the length of the pending connection queue; call before listen()
+	void setBacklog(int backlog)
+	{
+		_backlog = backlog;
+	}
+	int getBacklog()
+	{
+		return _backlog;
+	}
 	virtual void close();
 	virtual void send(const std::string &str, int start, int end);
 	virtual int receive(char *inBuff, const int inSize);
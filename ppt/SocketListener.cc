@@ -83,6 +83,19 @@ void SocketListener::listen(Socket *s)
 /** Use the select() system call to wait for an incoming connection */
 Socket *
 SocketListener::accept()
+{
+	return accept(SOCKET_LISTENER_TIMEOUT);
+}
+
+/**
+ * @brief Wait for an incoming connection
+ *
+ * @param timeout Wait at most this many seconds
+ * @return The new connection or null if none arrived (or a signal
+ * interrupted the wait)
+ */
+Socket *
+SocketListener::accept(int timeout)
 {
 	BESDEBUG("ppt", "SocketListener::accept() - START" << endl);
 
@@ -96,10 +109,10 @@ SocketListener::accept()
 		FD_SET(s_ptr->getSocketDescriptor(), &read_fd);
 	}
 
-	struct timeval timeout;
-	timeout.tv_sec = 120;
-	timeout.tv_usec = 0;
-	int status = select(maxfd + 1, &read_fd, (fd_set*) NULL, (fd_set*) NULL, &timeout);
+	struct timeval tv;
+	tv.tv_sec = timeout;
+	tv.tv_usec = 0;
+	int status = select(maxfd + 1, &read_fd, (fd_set*) NULL, (fd_set*) NULL, &tv);
 	if (status < 0) {
 	    // left over and not needed. jhrg 10/14/15
 	    // while (select(maxfd + 1, &read_fd, (fd_set*) NULL, (fd_set*) NULL, &timeout) < 0) {
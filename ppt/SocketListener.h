@@ -39,6 +39,9 @@
 
 class Socket;
 
+// How long, in seconds, accept() waits for a connection
+#define SOCKET_LISTENER_TIMEOUT 120
+
 class SocketListener: public BESObj {
 private:
 	std::map<int, Socket *> _socket_list;
@@ -50,6 +53,7 @@ public:
 	virtual ~SocketListener();
 	virtual void listen(Socket *s);
 	virtual Socket * accept();
+	virtual Socket * accept(int timeout);
 
 	virtual void dump(ostream &strm) const;
 };
@@ -342,7 +342,7 @@ void TcpSocket::listen()
             setTcpRecvBufferSize();
             setTcpSendBufferSize();
 
-            if (::listen(_socket, 5) == 0) {
+            if (::listen(_socket, _backlog) == 0) {
                 _listening = true;
             }
             else {
@@ -177,7 +177,7 @@ void UnixSocket::listen()
         // Added a +1 to the size computation. jhrg 5/26/05
         if (bind(_socket, (struct sockaddr*) &server_add,
             sizeof(server_add.sun_family) + strlen(server_add.sun_path) + 1) != -1) {
-            if (::listen(_socket, 5) == 0) {
+            if (::listen(_socket, _backlog) == 0) {
                 _listening = true;
             }
             else {
@@ -0,0 +1,205 @@
+// framerT.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace CppUnit;
+using namespace std;
+
+#include "config.h"
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <fcntl.h>
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <map>
+
+#include "PPTResponseFramer.h"
+#include "PPTStreamBuf.h"
+#include "Connection.h"
+#include "TheBESKeys.h"
+#include <GetOpt.h>
+
+#include "test_config.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+/**
+ * A Connection that writes the extensions it is asked to send to the same
+ * descriptor as the PPTStreamBuf, as [name=value], so the test can see
+ * where they fall between the chunks.
+ */
+class FramerConn: public Connection {
+    int d_fd;
+
+protected:
+    virtual void send(const string &) { }
+    virtual void sendChunk(const string &, map<string, string> &) { }
+
+public:
+    FramerConn(int fd) : d_fd(fd) { }
+    virtual ~FramerConn() { }
+
+    virtual void initConnection() { }
+    virtual void closeConnection() { }
+    virtual string exit() { return ""; }
+    virtual void send(const string &, map<string, string> &) { }
+    virtual void sendExit() { }
+    virtual bool receive(map<string, string> &, ostream * = 0) { return false; }
+    virtual unsigned int getRecvChunkSize() { return 0; }
+    virtual unsigned int getSendChunkSize() { return 0; }
+
+    virtual void sendExtensions(map<string, string> &extensions)
+    {
+        for (map<string, string>::iterator i = extensions.begin(), e = extensions.end(); i != e; ++i) {
+            string ext = "[" + i->first + "=" + i->second + "]";
+            write(d_fd, ext.c_str(), ext.length());
+        }
+    }
+};
+
+class framerT: public TestFixture {
+private:
+    string read_file(const string &name)
+    {
+        string str;
+        int fd = open(name.c_str(), O_RDONLY);
+        char buffer[4096];
+        int bytesRead;
+        while ((bytesRead = read(fd, buffer, sizeof(buffer))) > 0)
+            str.append(buffer, bytesRead);
+        close(fd);
+        return str;
+    }
+
+public:
+    framerT()
+    {
+    }
+    ~framerT()
+    {
+    }
+
+    void setUp()
+    {
+        // PPTStreamBuf looks up the metrics and tracing keys
+        TheBESKeys::ConfigFile = string(TEST_SRC_DIR) + "/bes.conf";
+    }
+
+    void tearDown()
+    {
+        unlink("./framerT.out");
+    }
+
+    CPPUNIT_TEST_SUITE( framerT );
+
+    CPPUNIT_TEST( batch_test );
+
+    CPPUNIT_TEST_SUITE_END();
+
+    // A response, an error and then the last response, which is ended as
+    // usual with only the end chunk
+    void batch_test()
+    {
+        int fd = open("./framerT.out", O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        CPPUNIT_ASSERT(fd >= 0);
+        {
+            PPTStreamBuf fds(fd, 500);
+            ostream out(&fds);
+            FramerConn conn(fd);
+            PPTResponseFramer framer(&conn, fds, out);
+
+            out << "DAS";
+            framer.end_response();
+
+            framer.error(1);
+            out << "oops";
+            framer.end_response();
+
+            out << "last";
+            fds.finish();
+        }
+        close(fd);
+
+        string str = read_file("./framerT.out");
+        DBG(cerr << "****" << endl << str << endl << "****" << endl);
+        CPPUNIT_ASSERT(str == (string) "0000003dDAS" + "[batch=more]" + "0000000d"
+            + "[status=error]" + "0000004doops" + "[batch=more]" + "0000000d"
+            + "0000004dlast" + "0000000d");
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( framerT );
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: framerT has the following tests:" << endl;
+            const std::vector<Test*> &tests = framerT::suite()->getTests();
+            unsigned int prefix_len = framerT::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = framerT::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
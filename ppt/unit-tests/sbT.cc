@@ -55,8 +55,11 @@ using std::ostringstream;
 
 #include "PPTStreamBuf.h"
 #include "PPTProtocol.h"
+#include "TheBESKeys.h"
 #include <GetOpt.h>
 
+#include "test_config.h"
+
 static bool debug = false;
 
 #undef DBG
@@ -82,6 +85,8 @@ public:
 
     void setUp()
     {
+        // PPTStreamBuf looks up the metrics and tracing keys
+        TheBESKeys::ConfigFile = string(TEST_SRC_DIR) + "/bes.conf";
     }
 
     void tearDown()
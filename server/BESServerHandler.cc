@@ -49,6 +49,7 @@ using std::flush;
 
 #include "BESServerHandler.h"
 #include "Connection.h"
+#include "PPTServer.h"
 #include "Socket.h"
 #include "BESXMLInterface.h"
 #include "TheBESKeys.h"
@@ -56,6 +57,7 @@ using std::flush;
 #include "ServerExitConditions.h"
 #include "BESUtil.h"
 #include "PPTStreamBuf.h"
+#include "PPTResponseFramer.h"
 #include "PPTProtocol.h"
 #include "BESLog.h"
 #include "BESDebug.h"
@@ -108,6 +110,10 @@ void BESServerHandler::handle(Connection *c)
             throw BESInternalError(error, __FILE__, __LINE__);
         }
         else if (pid == 0) { // child
+            // Connections the master has queued are not this process' to hold open
+            PPTServer *ps = dynamic_cast<PPTServer*>(c);
+            if (ps) ps->close_queued_connections();
+
             execute(c);
         }
     }
@@ -171,7 +177,7 @@ void BESServerHandler::execute(Connection *c)
         BESDEBUG("server", "BESServerHandler::execute - command ... " << cmd_str << endl);
 
         BESStopWatch sw;
-        if (BESISDEBUG(TIMING_LOG)) sw.start("BESServerHandler::execute");
+        if (BESISTIMING) sw.start("BESServerHandler::execute");
 
         // Tie the cout stream to the PPTStreamBuf and save the cout buffer so that
         // it can be reset once the command is complete. jhrg 1/25/17
@@ -183,6 +189,8 @@ void BESServerHandler::execute(Connection *c)
         cout.rdbuf(&fds);
 
         BESXMLInterface cmd(cmd_str, &cout);
+        PPTResponseFramer framer(c, fds, cout);
+        cmd.set_response_framer(&framer);
         int status = cmd.execute_request(from);
 
         if (status == 0) {
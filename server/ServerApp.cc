@@ -49,6 +49,7 @@ using std::cerr;
 using std::endl;
 using std::ios;
 using std::ostringstream;
+using std::istringstream;
 using std::ofstream;
 
 #include "config.h"
@@ -61,7 +62,9 @@ using std::ofstream;
 #include "TcpSocket.h"
 #include "UnixSocket.h"
 #include "BESServerHandler.h"
+#include "BESMetrics.h"
 #include "BESError.h"
+#include "BESInternalError.h"
 #include "PPTServer.h"
 #include "BESMemoryManager.h"
 #include "BESDebug.h"
@@ -256,6 +259,28 @@ static void register_signal_handlers()
     BESDEBUG("beslistener", "beslistener: OK" << endl);
 }
 
+// Defaults for the admission control keys; see bes.conf
+#define BES_DEFAULT_MAX_CHILDREN 0
+#define BES_DEFAULT_QUEUE_SIZE 0
+#define BES_DEFAULT_QUEUE_TIMEOUT 10
+
+/** Read a key whose value is a non-negative integer */
+static unsigned int get_unsigned_key(const string &key, unsigned int default_value)
+{
+    bool found = false;
+    string value;
+    TheBESKeys::TheKeys()->get_value(key, value, found);
+    if (!found || value.empty()) return default_value;
+
+    istringstream iss(value);
+    int n;
+    if (!(iss >> n) || n < 0)
+        throw BESInternalError("The value of " + key + " must be a non-negative integer, not '" + value + "'.",
+            __FILE__, __LINE__);
+
+    return n;
+}
+
 ServerApp::ServerApp() :
     BESModuleApp(), _portVal(0), _gotPort(false), _IPVal(""), _gotIP(false), _unixSocket(""), _secure(false), _mypid(0), _ts(0), _us(0), _ps(0)
 {
@@ -447,6 +472,11 @@ int ServerApp::initialize(int argc, char **argv)
 
     BESDEBUG("beslistener", "beslistener: initialized settings:" << *this);
 
+    // Map the shared metrics file (if metrics are enabled) here so that the
+    // child listeners all use the master's mapping. No requests are running
+    // yet, so clear any gauges left high by listeners that died mid-request.
+    if (BESMetrics::TheMetrics()) BESMetrics::TheMetrics()->reset_gauges();
+
     if (needhelp) {
         BESServerUtils::show_usage(BESApp::TheApplication()->appName());
     }
@@ -470,6 +500,9 @@ int ServerApp::run()
         BESMemoryManager::initialize_memory_pool();
         BESDEBUG("beslistener", "OK" << endl);
 
+        // The kernel queues this many connections before the listener accepts them
+        int backlog = get_unsigned_key("BES.ServerBacklog", SOCKET_DEFAULT_BACKLOG);
+
         SocketListener listener;
         if (_portVal) {
             if (!_IPVal.empty())
@@ -477,6 +510,7 @@ int ServerApp::run()
             else
                 _ts = new TcpSocket(_portVal);
 
+            _ts->setBacklog(backlog);
             listener.listen(_ts);
 
             BESDEBUG("beslistener", "beslistener: listening on port (" << _portVal << ")" << endl);
@@ -496,6 +530,7 @@ int ServerApp::run()
 
         if (!_unixSocket.empty()) {
             _us = new UnixSocket(_unixSocket);
+            _us->setBacklog(backlog);
             listener.listen(_us);
             BESDEBUG("beslistener", "beslistener: listening on unix socket (" << _unixSocket << ")" << endl);
         }
@@ -504,6 +539,12 @@ int ServerApp::run()
 
         _ps = new PPTServer(&handler, &listener, _secure);
 
+        // Limit the number of child listeners; this also makes the shared
+        // values 'show status' reports, so it must happen before any fork.
+        _ps->set_admission(get_unsigned_key("BES.MaxChildren", BES_DEFAULT_MAX_CHILDREN),
+            get_unsigned_key("BES.ConnectionQueue.Size", BES_DEFAULT_QUEUE_SIZE),
+            get_unsigned_key("BES.ConnectionQueue.Timeout", BES_DEFAULT_QUEUE_TIMEOUT));
+
         register_signal_handlers();
 
         // Loop forever, processing signals and running the code in PPTServer::initConnection().
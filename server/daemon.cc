@@ -40,6 +40,7 @@
 #include <sys/stat.h>  // for chmod
 #include <ctype.h> // for isdigit
 #include <signal.h>
+#include <pthread.h>
 
 #include <fstream>
 #include <iostream>
@@ -72,6 +73,8 @@ using std::string;
 #include "TheBESKeys.h"
 #include "BESLog.h"
 #include "BESDaemonConstants.h"
+#include "BESMetrics.h"
+#include "BESUtil.h"
 
 #define BES_SERVER "/beslistener"
 #define BES_SERVER_PID "/bes.pid"
@@ -306,6 +309,15 @@ char **update_beslistener_args()
     return arguments;
 }
 
+/// Free the arguments made by update_beslistener_args()
+static void free_beslistener_args(char **arguments)
+{
+    for (char **a = arguments; *a; ++a)
+        free(*a);
+
+    delete[] arguments;
+}
+
 /** Start the 'master beslistener' and return its PID. This function also
  sets the global 'master_beslistener_pid' so that other code in this file
  (like the signal handlers) can have access to it. It starts the beslistener
@@ -328,9 +340,19 @@ int start_master_beslistener()
         return 0;
     }
 
+    // The besdaemon may run a thread (see start_metrics_writer()), so the
+    // child may only make async-signal-safe calls between fork() and
+    // execvp(). Build the arguments (which allocates memory) here.
+    char **arguments = update_beslistener_args();
+
+    BESDEBUG("besdaemon", "Starting: " << arguments[0] << endl);
+
     int pid;
     if ((pid = fork()) < 0) {
         cerr << errno_str(": fork error ");
+        free_beslistener_args(arguments);
+        close(pipefd[0]);
+        close(pipefd[1]);
         return 0;
     }
     else if (pid == 0) { // child process  (the master beslistener)
@@ -345,16 +367,11 @@ int start_master_beslistener()
         // are available. Using higher numbers can cause problems (see ticket
         // 1783). jhrg 7/15/11
         if (dup2(pipefd[1], BESLISTENER_PIPE_FD) != BESLISTENER_PIPE_FD) {
-            cerr << errno_str(": dup2 error ");
-            return 0;
+            const char msg[] = "besdaemon: dup2 error starting the master beslistener\n";
+            (void) write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            _exit(1);
         }
 
-        // We don't have to free this because this is a different process
-        // than the parent.
-        char **arguments = update_beslistener_args();
-
-        BESDEBUG("besdaemon", "Starting: " << arguments[0] << endl);
-
         // Close the socket for the besdaemon here. This keeps it from being
         // passed into the master beslistener and then entering the state
         // CLOSE_WAIT once the besdaemon's client closes it's end.
@@ -364,10 +381,13 @@ int start_master_beslistener()
         execvp(arguments[0], arguments);
 
         // if we are still here, it's an error...
-        cerr << errno_str(": mounting listener, subprocess failed: ");
-        exit(1); //NB: This exits from the child process.
+        const char msg[] = "besdaemon: mounting listener, subprocess failed\n";
+        (void) write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        _exit(1); //NB: This exits from the child process.
     }
 
+    free_beslistener_args(arguments);
+
     // parent process (the besdaemon)
 
     // The daemon records the pid of the master beslistener, but only does so
@@ -595,6 +615,77 @@ static int start_command_processor(DaemonCommandHandler &handler)
     return 1;
 }
 
+/**
+ * Periodically write the beslisteners' metrics in the Prometheus text format.
+ * The master beslistener creates the shared metrics file; this thread only
+ * maps it to read the values, so if the file does not exist yet it tries
+ * again at the next interval. This runs in a thread and not a child process
+ * so that the daemon's wait() calls only see the master beslistener.
+ */
+static void *write_prometheus_metrics(void *arg)
+{
+    string prom_file = *static_cast<string*>(arg);
+    delete static_cast<string*>(arg);
+
+    bool found = false;
+    string value;
+    unsigned int interval = 15;
+    TheBESKeys::TheKeys()->get_value(BESMetrics::PROMETHEUS_INTERVAL_KEY, value, found);
+    if (found && !value.empty() && atoi(value.c_str()) > 0) interval = atoi(value.c_str());
+
+    string metrics_file = BESMetrics::get_file();
+
+    while (true) {
+        sleep(interval);
+        try {
+            BESMetrics metrics(metrics_file, false);
+            metrics.write_prometheus_file(prom_file);
+        }
+        catch (BESError &e) {
+            BESDEBUG("besdaemon", "besdaemon: could not write the metrics: " << e.get_message() << endl);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * If metrics are enabled and BES.Metrics.Prometheus.File is set, start the
+ * thread that writes them. With this thread running, start_master_beslistener()
+ * must not call anything but async-signal-safe functions in its child before
+ * execvp().
+ */
+static void start_metrics_writer()
+{
+    bool found = false;
+    string value;
+    TheBESKeys::TheKeys()->get_value(BESMetrics::ENABLED_KEY, value, found);
+    if (!found || BESUtil::lowercase(value) != "true") return;
+
+    string prom_file;
+    TheBESKeys::TheKeys()->get_value(BESMetrics::PROMETHEUS_FILE_KEY, prom_file, found);
+    if (!found || prom_file.empty() || BESMetrics::get_file().empty()) return;
+
+    // Leave the signals to the main thread: the new thread inherits this
+    // mask, so no signal can be delivered to it before it starts running.
+    sigset_t signals, old_signals;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, &old_signals);
+
+    pthread_t thread;
+    string *arg = new string(prom_file);
+    int status = pthread_create(&thread, 0, write_prometheus_metrics, arg);
+    pthread_sigmask(SIG_SETMASK, &old_signals, 0);
+    if (status != 0) {
+        delete arg;
+        cerr << daemon_name << ": could not start the metrics writer: " << strerror(status) << endl;
+        return;
+    }
+
+    pthread_detach(thread);
+    BESDEBUG("besdaemon", "besdaemon: writing metrics to " << prom_file << endl);
+}
+
 /** Register the signal handlers. This registers handlers for HUP, TERM and
  *  CHLD. For each, if this OS supports restarting 'slow' system calls, enable
  *  that. For the TERM and HUP handlers, block SIGCHLD for the duration of
@@ -1176,6 +1267,8 @@ int main(int argc, char *argv[])
         }
 
         BESDEBUG("besdaemon", "besdaemon: master_beslistener_pid: " << master_beslistener_pid << endl);
+
+        start_metrics_writer();
     }
     catch (BESError &e) {
         // (*BESLog::TheLog())
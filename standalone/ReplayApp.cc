@@ -0,0 +1,539 @@
+// ReplayApp.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "config.h"
+
+#include <unistd.h>
+#include <getopt.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include <libxml/parser.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <streambuf>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+using std::ostream;
+using std::ofstream;
+using std::map;
+using std::streambuf;
+using std::streamsize;
+
+#include "ReplayApp.h"
+#include "ReplayStats.h"
+#include "BESXMLInterface.h"
+#include "BESError.h"
+#include "BESInternalError.h"
+#include "BESDebug.h"
+#include "BESDefaultModule.h"
+#include "BESXMLDefaultCommands.h"
+#include "BESCatalogUtils.h"
+#include "BESTracer.h"
+#include "TheBESKeys.h"
+#include "PPTClient.h"
+
+// A streambuf that counts the bytes written to it and discards them
+class count_buf: public streambuf {
+    unsigned long long d_count;
+protected:
+    virtual int overflow(int c)
+    {
+        if (c != EOF) ++d_count;
+        return c == EOF ? 0 : c;
+    }
+    virtual streamsize xsputn(const char *, streamsize n)
+    {
+        d_count += n;
+        return n;
+    }
+public:
+    count_buf() : d_count(0) { }
+    unsigned long long count() const { return d_count; }
+};
+
+// Sleep until the monotonic clock reaches 'until' (microseconds)
+static void sleep_until(unsigned long long until)
+{
+    unsigned long long now = BESTracer::wall_time();
+    while (now < until) {
+        struct timespec ts;
+        ts.tv_sec = (until - now) / 1000000;
+        ts.tv_nsec = ((until - now) % 1000000) * 1000;
+        nanosleep(&ts, 0);
+        now = BESTracer::wall_time();
+    }
+}
+
+// Write all of a buffer to a pipe
+static bool write_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Read all of a buffer from a pipe; false at EOF
+static bool read_all(int fd, char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+ReplayApp::ReplayApp() :
+    BESModuleApp(), d_threshold(10.0), d_port(0), d_timeout(5), d_concurrency(1), d_rate(0.0), d_repeat(1), d_warmup(0)
+{
+}
+
+ReplayApp::~ReplayApp()
+{
+    if (standalone()) {
+        delete TheBESKeys::TheKeys();
+
+        BESCatalogUtils::delete_all_catalogs();
+    }
+}
+
+void ReplayApp::showVersion()
+{
+    cout << appName() << ": version 1.0" << endl;
+}
+
+void ReplayApp::showUsage()
+{
+    cout << endl;
+    cout << appName() << ": the following options are available:" << endl;
+    cout << "    -i <file>, --inputfile=<file> - the corpus of requests to replay" << endl;
+    cout << "    -c <file>, --config=<file> - BES configuration file; run the requests in this process" << endl;
+    cout << "    -h <host>, --host=<host> - send the requests to the BES on this host" << endl;
+    cout << "    -p <port>, --port=<port> - ... listening on this port" << endl;
+    cout << "    -u <socket>, --unixsocket=<socket> - send the requests to the BES using this unix socket" << endl;
+    cout << "    -t <secs>, --timeout=<secs> - timeout for reads from the BES" << endl;
+    cout << "    -n <num>, --concurrency=<num> - number of worker processes (default 1)" << endl;
+    cout << "    -r <num>, --rate=<num> - start <num> requests per second (default as fast as possible)" << endl;
+    cout << "    -R <num>, --repeat=<num> - replay the corpus <num> times (default 1)" << endl;
+    cout << "    -w <num>, --warmup=<num> - first replay the corpus <num> times without measuring it" << endl;
+    cout << "    -C <dir>, --root=<dir> - remove this directory from paths in bes.log lines" << endl;
+    cout << "    -o <file>, --outputfile=<file> - write the JSON summary to this file" << endl;
+    cout << "    -s <file>, --samples=<file> - write each request's timing to this CSV file" << endl;
+    cout << "    -b <file>, --baseline=<file> - compare with the JSON summary of an earlier run" << endl;
+    cout << "    -T <num>, --threshold=<num> - percent slower than the baseline that is a regression (default 10)"
+        << endl;
+    cout << "    -d <sink,context>, --debug=<sink,context> - turn on debugging" << endl;
+    cout << "    -v, --version - return version information" << endl;
+    cout << "    -?, --help - display help information" << endl;
+    cout << endl;
+    BESDebug::Help(cout);
+}
+
+int ReplayApp::initialize(int argc, char **argv)
+{
+    bool badUsage = false;
+
+    int c;
+
+    static struct option longopts[] = { { "config", 1, 0, 'c' }, { "debug", 1, 0, 'd' }, { "version", 0, 0, 'v' }, {
+        "inputfile", 1, 0, 'i' }, { "host", 1, 0, 'h' }, { "port", 1, 0, 'p' }, { "unixsocket", 1, 0, 'u' }, {
+        "timeout", 1, 0, 't' }, { "concurrency", 1, 0, 'n' }, { "rate", 1, 0, 'r' }, { "repeat", 1, 0, 'R' }, {
+        "warmup", 1, 0, 'w' }, { "root", 1, 0, 'C' }, { "outputfile", 1, 0, 'o' }, { "samples", 1, 0, 's' }, {
+        "baseline", 1, 0, 'b' }, { "threshold", 1, 0, 'T' }, { "help", 0, 0, '?' }, { 0, 0, 0, 0 } };
+    int option_index = 0;
+
+    while ((c = getopt_long(argc, argv, "?vc:d:i:h:p:u:t:n:r:R:w:C:o:s:b:T:", longopts, &option_index)) != -1) {
+        switch (c) {
+        case 'c':
+            TheBESKeys::ConfigFile = optarg;
+            break;
+        case 'd':
+            BESDebug::SetUp(optarg);
+            break;
+        case 'v':
+            showVersion();
+            exit(0);
+            break;
+        case 'i':
+            d_corpus_file = optarg;
+            break;
+        case 'h':
+            d_host = optarg;
+            break;
+        case 'p':
+            d_port = atoi(optarg);
+            break;
+        case 'u':
+            d_unix_socket = optarg;
+            break;
+        case 't':
+            d_timeout = atoi(optarg);
+            break;
+        case 'n':
+            d_concurrency = atoi(optarg);
+            break;
+        case 'r':
+            d_rate = atof(optarg);
+            break;
+        case 'R':
+            d_repeat = atoi(optarg);
+            break;
+        case 'w':
+            d_warmup = atoi(optarg);
+            break;
+        case 'C':
+            d_root_dir = optarg;
+            break;
+        case 'o':
+            d_output_file = optarg;
+            break;
+        case 's':
+            d_samples_file = optarg;
+            break;
+        case 'b':
+            d_baseline_file = optarg;
+            break;
+        case 'T':
+            d_threshold = atof(optarg);
+            break;
+        case '?':
+            showUsage();
+            exit(0);
+            break;
+        }
+    }
+
+    if (d_corpus_file.empty()) {
+        cerr << "A corpus of requests must be given with -i" << endl;
+        badUsage = true;
+    }
+    if (!d_host.empty() && d_port <= 0) {
+        cerr << "A port must be given with the host" << endl;
+        badUsage = true;
+    }
+    if (!d_host.empty() && !d_unix_socket.empty()) {
+        cerr << "Give either a host and port or a unix socket, not both" << endl;
+        badUsage = true;
+    }
+    if (d_concurrency < 1 || d_repeat < 1 || d_rate < 0) {
+        cerr << "The concurrency and repeat count must be at least one and the rate cannot be negative" << endl;
+        badUsage = true;
+    }
+
+    if (badUsage == true) {
+        showUsage();
+        return 1;
+    }
+
+    try {
+        if (standalone()) {
+            BESDEBUG("replay", "ReplayApp: initializing default module ... " << endl);
+            BESDefaultModule::initialize(argc, argv);
+            BESXMLDefaultCommands::initialize(argc, argv);
+
+            BESDEBUG("replay", "ReplayApp: initializing loaded modules ... " << endl);
+            int retval = BESModuleApp::initialize(argc, argv);
+            if (retval) return retval;
+
+            if (d_root_dir.empty()) {
+                bool found = false;
+                TheBESKeys::TheKeys()->get_value("BES.Catalog.catalog.RootDirectory", d_root_dir, found);
+            }
+        }
+        else {
+            BESApp::initialize(argc, argv);
+        }
+
+        if (!d_root_dir.empty() && *d_root_dir.rbegin() == '/') d_root_dir.erase(d_root_dir.length() - 1);
+        d_corpus = ReplayCorpus(d_root_dir);
+        d_corpus.load(d_corpus_file);
+        if (d_corpus.size() == 0) {
+            cerr << "The corpus " << d_corpus_file << " holds no requests" << endl;
+            return 1;
+        }
+    }
+    catch (BESError &e) {
+        cerr << "Failed to initialize " << appName() << endl;
+        cerr << e.get_message() << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Run a worker's share of the requests, writing the samples to fd
+ *
+ * Request k of the run (the corpus is repeated warmup + repeat times) is
+ * run by worker k % concurrency. Samples for the warmup passes are not
+ * written.
+ *
+ * @param worker This worker's number
+ * @param start When the run starts, from the monotonic clock
+ * @param fd Write the samples to this pipe
+ */
+void ReplayApp::run_worker(unsigned int worker, unsigned long long start, int fd)
+{
+    PPTClient *client = 0;
+    if (!standalone()) {
+        client = d_host.empty() ? new PPTClient(d_unix_socket, d_timeout) : new PPTClient(d_host, d_port, d_timeout);
+        client->initConnection();
+    }
+
+    const std::vector<string> &requests = d_corpus.get_requests();
+    unsigned int warmup = d_warmup * requests.size();
+    unsigned int total = (d_warmup + d_repeat) * requests.size();
+
+    sleep_until(start);
+
+    for (unsigned int k = worker; k < total; k += d_concurrency) {
+        unsigned long long begin = BESTracer::wall_time();
+        if (d_rate > 0) {
+            // If this worker is late because the earlier requests were slow,
+            // measure from when the request should have started, not when
+            // this worker got to it. If it is early, wait.
+            unsigned long long scheduled = start + (unsigned long long) (k * 1.0e6 / d_rate);
+            if (begin < scheduled) {
+                sleep_until(scheduled);
+                begin = BESTracer::wall_time();
+            }
+            else {
+                begin = scheduled;
+            }
+        }
+
+        const string &cmd = requests[k % requests.size()];
+        count_buf buf;
+        ostream strm(&buf);
+        bool ok = true;
+
+        if (client) {
+            map<string, string> extensions;
+            client->send(cmd, extensions);
+            bool done = false;
+            while (!done) {
+                done = client->receive(extensions, &strm);
+                if (extensions["status"] == "error") ok = false;
+                if (done && extensions["batch"] == "more") {
+                    extensions.erase("batch");
+                    done = false;
+                }
+            }
+        }
+        else {
+            BESXMLInterface interface(cmd, &strm);
+            int status = interface.execute_request("besreplay");
+            ok = interface.finish(status) == 0;
+        }
+
+        unsigned long long end = BESTracer::wall_time();
+
+        if (k < warmup) continue;
+
+        ReplaySample sample;
+        memset(&sample, 0, sizeof(sample));
+        sample.request = k % requests.size();
+        sample.sequence = k - warmup;
+        sample.worker = worker;
+        sample.ok = ok;
+        sample.start = begin - start;
+        sample.latency = end - begin;
+        sample.bytes = buf.count();
+
+        if (!write_all(fd, reinterpret_cast<char*>(&sample), sizeof(sample)))
+            throw BESInternalError("Could not return a sample from a worker", __FILE__, __LINE__);
+    }
+
+    if (client) {
+        client->closeConnection();
+        delete client;
+    }
+}
+
+int ReplayApp::run()
+{
+    int fds[2];
+    if (pipe(fds) < 0) {
+        cerr << "Could not make a pipe: " << strerror(errno) << endl;
+        return 1;
+    }
+
+    // Give the workers time to start (and connect) so they begin together
+    unsigned long long start = BESTracer::wall_time() + 100000 + 10000 * d_concurrency;
+
+    cout << std::flush;
+    cerr << std::flush;
+
+    std::vector<pid_t> workers;
+    for (unsigned int w = 0; w < d_concurrency; ++w) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << "Could not start worker " << w << ": " << strerror(errno) << endl;
+            break;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            signal(SIGPIPE, SIG_IGN);
+            int status = 0;
+            try {
+                run_worker(w, start, fds[1]);
+            }
+            catch (BESError &e) {
+                cerr << "Worker " << w << ": " << e.get_message() << endl;
+                status = 1;
+            }
+            close(fds[1]);
+            // Do not run the exit handlers; they belong to the parent
+            _exit(status);
+        }
+        workers.push_back(pid);
+    }
+    close(fds[1]);
+
+    ReplayStats stats;
+    ReplaySample sample;
+    unsigned long long first = ~0ULL, last = 0;
+    while (read_all(fds[0], reinterpret_cast<char*>(&sample), sizeof(sample))) {
+        stats.add(sample);
+        if (sample.start < first) first = sample.start;
+        if (sample.start + sample.latency > last) last = sample.start + sample.latency;
+    }
+    close(fds[0]);
+
+    int retval = 0;
+    for (unsigned int w = 0; w < workers.size(); ++w) {
+        int status;
+        if (waitpid(workers[w], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            cerr << "Worker " << w << " failed" << endl;
+            retval = 1;
+        }
+    }
+    if (workers.size() != d_concurrency) retval = 1;
+
+    if (last > first) stats.set_elapsed(last - first);
+
+    string mode = standalone() ? "standalone" : "daemon";
+    if (d_output_file.empty()) {
+        stats.write_json(cout, mode, d_concurrency, d_rate, d_corpus.size());
+    }
+    else {
+        ofstream out(d_output_file.c_str());
+        if (!out) {
+            cerr << "Could not write the summary to " << d_output_file << endl;
+            return 1;
+        }
+        stats.write_json(out, mode, d_concurrency, d_rate, d_corpus.size());
+    }
+
+    if (!d_samples_file.empty()) {
+        ofstream out(d_samples_file.c_str());
+        if (!out) {
+            cerr << "Could not write the samples to " << d_samples_file << endl;
+            return 1;
+        }
+        stats.write_samples(out);
+    }
+
+    if (!d_baseline_file.empty()) {
+        try {
+            if (stats.compare(d_baseline_file, d_threshold, cerr) > 0) retval = 1;
+        }
+        catch (BESError &e) {
+            cerr << e.get_message() << endl;
+            retval = 1;
+        }
+    }
+
+    return retval;
+}
+
+int ReplayApp::terminate(int sig)
+{
+    if (standalone()) {
+        BESModuleApp::terminate(sig);
+        BESXMLDefaultCommands::terminate();
+        BESDefaultModule::terminate();
+
+        xmlCleanupParser();
+    }
+    else {
+        BESApp::terminate(sig);
+    }
+
+    return sig;
+}
+
+/** @brief dumps information about this object
+ *
+ * @param strm C++ i/o stream to dump the information to
+ */
+void ReplayApp::dump(ostream &strm) const
+{
+    strm << BESIndent::LMarg << "ReplayApp::dump - (" << (void *) this << ")" << endl;
+    BESIndent::Indent();
+    strm << BESIndent::LMarg << "corpus: " << d_corpus_file << " (" << d_corpus.size() << " requests)" << endl;
+    strm << BESIndent::LMarg << "mode: " << (standalone() ? "standalone" : "daemon") << endl;
+    strm << BESIndent::LMarg << "concurrency: " << d_concurrency << endl;
+    strm << BESIndent::LMarg << "rate: " << d_rate << endl;
+    strm << BESIndent::LMarg << "repeat: " << d_repeat << endl;
+    strm << BESIndent::LMarg << "warmup: " << d_warmup << endl;
+    BESApp::dump(strm);
+    BESIndent::UnIndent();
+}
+
+int main(int argc, char **argv)
+{
+    try {
+        ReplayApp app;
+        return app.main(argc, argv);
+    }
+    catch (BESError &e) {
+        cerr << "Caught BES Error: " << e.get_message() << endl;
+        return 1;
+    }
+    catch (std::exception &e) {
+        cerr << "Caught C++ error: " << e.what() << endl;
+        return 2;
+    }
+    catch (...) {
+        cerr << "Caught unknown error." << endl;
+        return 3;
+    }
+}
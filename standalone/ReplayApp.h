@@ -0,0 +1,96 @@
+// ReplayApp.h
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef ReplayApp_h
+#define ReplayApp_h 1
+
+#include <string>
+
+#include "BESModuleApp.h"
+#include "ReplayCorpus.h"
+
+class ReplayStats;
+struct ReplaySample;
+
+/**
+ * @brief besreplay: replay a corpus of BES requests and measure them
+ *
+ * The requests are run either in this process, the way besstandalone runs
+ * them, or sent to a running BES using PPT, the way bescmdln sends them.
+ * A number of worker processes (the concurrency) run the requests; each
+ * worker runs every Nth request of the corpus (repeated as asked). The BES
+ * is not thread safe, so the workers are processes; in standalone mode
+ * they are forked after the modules are loaded.
+ *
+ * If a rate is given, request k is started at k/rate seconds after the
+ * run starts and its latency is measured from that time, so a server that
+ * falls behind is charged for the wait (i.e., the run is 'open loop').
+ * Otherwise each worker sends its next request as soon as the last one
+ * finishes.
+ *
+ * The summary (latency percentiles, throughput and response sizes, also
+ * for each request in the corpus) is written as JSON; the individual
+ * samples can be written as CSV. If a baseline summary is given, the run
+ * is compared to it and besreplay exits with a non-zero status if it is
+ * slower by more than the threshold.
+ */
+class ReplayApp: public BESModuleApp {
+private:
+    std::string d_corpus_file;
+    std::string d_root_dir;
+    std::string d_output_file;
+    std::string d_samples_file;
+    std::string d_baseline_file;
+    double d_threshold;
+
+    // Daemon mode
+    std::string d_host;
+    int d_port;
+    std::string d_unix_socket;
+    int d_timeout;
+
+    unsigned int d_concurrency;
+    double d_rate;
+    unsigned int d_repeat;
+    unsigned int d_warmup;
+
+    ReplayCorpus d_corpus;
+
+    bool standalone() const { return d_host.empty() && d_unix_socket.empty(); }
+
+    void showVersion();
+    void showUsage();
+
+    void run_worker(unsigned int worker, unsigned long long start, int fd);
+
+public:
+    ReplayApp();
+    virtual ~ReplayApp();
+
+    virtual int initialize(int argC, char **argV);
+    virtual int run();
+    virtual int terminate(int sig = 0);
+
+    virtual void dump(std::ostream &strm) const;
+};
+
+#endif // ReplayApp_h
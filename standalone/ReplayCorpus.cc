@@ -0,0 +1,147 @@
+// ReplayCorpus.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "config.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "ReplayCorpus.h"
+#include "BESUtil.h"
+#include "BESLog.h"
+#include "BESSyntaxUserError.h"
+#include "BESDebug.h"
+
+using namespace std;
+
+static const string END_REQUEST = "</request>";
+
+static string trim(const string &s)
+{
+    string::size_type first = s.find_first_not_of(" \t\r\n");
+    if (first == string::npos) return "";
+    string::size_type last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+/**
+ * @brief Read the requests in a corpus file
+ * @param file The corpus file
+ * @exception BESSyntaxUserError if the file cannot be read or it ends
+ * with an incomplete request document
+ */
+void ReplayCorpus::load(const string &file)
+{
+    ifstream in(file.c_str());
+    if (!in) throw BESSyntaxUserError("Could not open the request corpus " + file, __FILE__, __LINE__);
+
+    string doc;
+    string line;
+    while (getline(in, line)) {
+        if (line.find(BESLog::mark) != string::npos) {
+            string request = log_line_to_request(line, d_root_dir, d_requests.size());
+            if (!request.empty()) d_requests.push_back(request);
+            continue;
+        }
+
+        if (trim(doc).empty() && (trim(line).empty() || trim(line)[0] == '#')) continue;
+
+        doc.append(line).append("\n");
+
+        string::size_type end;
+        while ((end = doc.find(END_REQUEST)) != string::npos) {
+            end += END_REQUEST.length();
+            d_requests.push_back(trim(doc.substr(0, end)));
+            doc.erase(0, end);
+        }
+    }
+
+    if (!trim(doc).empty())
+        throw BESSyntaxUserError("The request corpus " + file + " ends with an incomplete request", __FILE__,
+            __LINE__);
+
+    BESDEBUG("replay", "ReplayCorpus::load() - read " << d_requests.size() << " requests from " << file << endl);
+}
+
+/**
+ * @brief Make a request document from a bes.log line
+ *
+ * @param line The log line
+ * @param root_dir The catalog's root directory; removed from the start of
+ * the logged path
+ * @param id Used to make the request id
+ * @return The request document or the empty string if the line is not for
+ * a get command
+ */
+string ReplayCorpus::log_line_to_request(const string &line, const string &root_dir, unsigned int id)
+{
+    string::size_type pos = line.rfind(BESLog::mark);
+    if (pos == string::npos) return "";
+    string info = trim(line.substr(pos + BESLog::mark.length()));
+
+    if (info.compare(0, 4, "get.") != 0) return "";
+
+    // get.<type>[,<returnAs>],<path>[,<constraint>]
+    pos = info.find(',');
+    if (pos == string::npos) return "";
+    string type = info.substr(4, pos - 4);
+    string rest = info.substr(pos + 1);
+
+    string return_as;
+    pos = rest.find(',');
+    if (pos != string::npos && rest.substr(0, pos).find('/') == string::npos) {
+        return_as = rest.substr(0, pos);
+        rest = rest.substr(pos + 1);
+    }
+
+    pos = rest.find(',');
+    string path = rest.substr(0, pos);
+    string constraint = pos == string::npos ? "" : rest.substr(pos + 1);
+
+    if (!root_dir.empty() && path.compare(0, root_dir.length(), root_dir) == 0) path = path.substr(root_dir.length());
+    if (path.empty()) return "";
+
+    bool dap4 = (type == "dmr" || type == "dap");
+
+    ostringstream oss;
+    oss << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << endl;
+    oss << "<request reqID=\"replay_" << id << "\">" << endl;
+    oss << "    <setContext name=\"errors\">xml</setContext>" << endl;
+    if (!dap4) oss << "    <setContext name=\"dap_format\">dap2</setContext>" << endl;
+    oss << "    <setContainer name=\"c\" space=\"catalog\">" << BESUtil::id2xml(path) << "</setContainer>" << endl;
+    oss << "    <define name=\"d\" space=\"default\">" << endl;
+    if (constraint.empty()) {
+        oss << "        <container name=\"c\" />" << endl;
+    }
+    else {
+        string element = dap4 ? "dap4constraint" : "constraint";
+        oss << "        <container name=\"c\"><" << element << ">" << BESUtil::id2xml(constraint) << "</" << element
+            << "></container>" << endl;
+    }
+    oss << "    </define>" << endl;
+    oss << "    <get type=\"" << BESUtil::id2xml(type) << "\" definition=\"d\"";
+    if (!return_as.empty()) oss << " returnAs=\"" << BESUtil::id2xml(return_as) << "\"";
+    oss << " />" << endl;
+    oss << "</request>";
+
+    return oss.str();
+}
@@ -0,0 +1,66 @@
+// ReplayCorpus.h
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef ReplayCorpus_h
+#define ReplayCorpus_h 1
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief The BES requests replayed by besreplay
+ *
+ * A corpus file holds BES XML request documents, one after another, and/or
+ * lines copied from the bes.log. A log line for a get command, e.g.,
+ *
+ * <pre>
+ * 2018-05-01T10:11:12UTC|&|4242|&|get.dods,/usr/share/hyrax/data/fnoc1.nc,u[0:1]
+ * </pre>
+ *
+ * is made into an equivalent request document. Since the log holds the
+ * real path of the dataset, the catalog's root directory is removed from
+ * it. Other log lines and lines starting with '#' are ignored.
+ *
+ * @note The log does not mark where the returnAs value, path and
+ * constraint start and end. A field without a '/' that follows the
+ * action is taken to be the returnAs value, and for DAP4 requests
+ * everything after the path is used as the DAP4 constraint.
+ */
+class ReplayCorpus {
+private:
+    std::vector<std::string> d_requests;
+    std::string d_root_dir;
+
+public:
+    ReplayCorpus(const std::string &root_dir = "") : d_root_dir(root_dir) { }
+    virtual ~ReplayCorpus() { }
+
+    void load(const std::string &file);
+    void add(const std::string &request) { d_requests.push_back(request); }
+
+    const std::vector<std::string> &get_requests() const { return d_requests; }
+    unsigned int size() const { return d_requests.size(); }
+
+    static std::string log_line_to_request(const std::string &line, const std::string &root_dir, unsigned int id);
+};
+
+#endif // ReplayCorpus_h
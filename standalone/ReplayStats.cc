@@ -0,0 +1,228 @@
+// ReplayStats.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "config.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include "ReplayStats.h"
+#include "BESSyntaxUserError.h"
+
+using namespace std;
+
+unsigned int ReplayStats::errors() const
+{
+    unsigned int errors = 0;
+    for (vector<ReplaySample>::const_iterator i = d_samples.begin(), e = d_samples.end(); i != e; ++i)
+        if (!i->ok) ++errors;
+    return errors;
+}
+
+/// @return Requests per second
+double ReplayStats::throughput() const
+{
+    return d_elapsed == 0 ? 0.0 : d_samples.size() / (d_elapsed / 1.0e6);
+}
+
+/**
+ * @brief The nearest-rank percentile of some values
+ * @param values The values; sorted by this method
+ * @param p The percentile, e.g., 99
+ * @return The value or zero if there are none
+ */
+double ReplayStats::percentile(vector<unsigned long long> &values, double p)
+{
+    if (values.empty()) return 0;
+
+    sort(values.begin(), values.end());
+    long rank = static_cast<long>(ceil(p / 100.0 * values.size()));
+    if (rank < 1) rank = 1;
+    if (rank > static_cast<long>(values.size())) rank = values.size();
+
+    return values[rank - 1];
+}
+
+/// @return The latency percentile for the whole run, in microseconds
+double ReplayStats::percentile(double p) const
+{
+    vector<unsigned long long> latencies;
+    for (vector<ReplaySample>::const_iterator i = d_samples.begin(), e = d_samples.end(); i != e; ++i)
+        latencies.push_back(i->latency);
+
+    return percentile(latencies, p);
+}
+
+// Write the summary of some samples' latencies (in ms) and sizes
+static void write_summary(ostream &out, const string &indent, vector<unsigned long long> &latencies,
+    vector<unsigned long long> &bytes)
+{
+    unsigned long long total_latency = 0, total_bytes = 0;
+    for (unsigned int i = 0; i < latencies.size(); ++i) {
+        total_latency += latencies[i];
+        total_bytes += bytes[i];
+    }
+    double n = latencies.empty() ? 1 : latencies.size();
+
+    out << indent << "\"latency_ms\": {";
+    out << "\"min\": " << ReplayStats::percentile(latencies, 0) / 1000.0;
+    out << ", \"mean\": " << total_latency / n / 1000.0;
+    out << ", \"p50\": " << ReplayStats::percentile(latencies, 50) / 1000.0;
+    out << ", \"p95\": " << ReplayStats::percentile(latencies, 95) / 1000.0;
+    out << ", \"p99\": " << ReplayStats::percentile(latencies, 99) / 1000.0;
+    out << ", \"max\": " << ReplayStats::percentile(latencies, 100) / 1000.0 << "}," << endl;
+
+    out << indent << "\"bytes\": {";
+    out << "\"total\": " << total_bytes;
+    out << ", \"mean\": " << total_bytes / n;
+    out << ", \"min\": " << (unsigned long long) ReplayStats::percentile(bytes, 0);
+    out << ", \"max\": " << (unsigned long long) ReplayStats::percentile(bytes, 100) << "}";
+}
+
+/**
+ * @brief Write the summary of the run as JSON
+ *
+ * @param out Write here
+ * @param mode 'standalone' or 'daemon'
+ * @param concurrency The number of worker processes
+ * @param rate The requests per second asked for, zero if the workers did
+ * not wait between requests
+ * @param corpus_size The number of requests in the corpus
+ */
+void ReplayStats::write_json(ostream &out, const string &mode, unsigned int concurrency, double rate,
+    unsigned int corpus_size) const
+{
+    out << fixed << setprecision(3);
+
+    out << "{" << endl;
+    out << "  \"mode\": \"" << mode << "\"," << endl;
+    out << "  \"concurrency\": " << concurrency << "," << endl;
+    out << "  \"rate\": " << rate << "," << endl;
+    out << "  \"requests\": " << d_samples.size() << "," << endl;
+    out << "  \"errors\": " << errors() << "," << endl;
+    out << "  \"elapsed_s\": " << d_elapsed / 1.0e6 << "," << endl;
+    out << "  \"throughput_rps\": " << throughput() << "," << endl;
+
+    vector<unsigned long long> latencies, bytes;
+    vector<vector<unsigned long long> > request_latencies(corpus_size), request_bytes(corpus_size);
+    vector<unsigned int> request_errors(corpus_size, 0);
+    for (vector<ReplaySample>::const_iterator i = d_samples.begin(), e = d_samples.end(); i != e; ++i) {
+        latencies.push_back(i->latency);
+        bytes.push_back(i->bytes);
+        if (i->request < corpus_size) {
+            request_latencies[i->request].push_back(i->latency);
+            request_bytes[i->request].push_back(i->bytes);
+            if (!i->ok) ++request_errors[i->request];
+        }
+    }
+
+    write_summary(out, "  ", latencies, bytes);
+    out << "," << endl;
+
+    out << "  \"per_request\": [";
+    for (unsigned int r = 0; r < corpus_size; ++r) {
+        out << (r == 0 ? "" : ",") << endl;
+        out << "    {\"request\": " << r << ", \"count\": " << request_latencies[r].size() << ", \"errors\": "
+            << request_errors[r] << "," << endl;
+        write_summary(out, "     ", request_latencies[r], request_bytes[r]);
+        out << "}";
+    }
+    out << endl << "  ]" << endl;
+    out << "}" << endl;
+}
+
+/// Write every sample as a line of CSV
+void ReplayStats::write_samples(ostream &out) const
+{
+    out << "sequence,request,worker,ok,start_us,latency_us,bytes" << endl;
+    for (vector<ReplaySample>::const_iterator i = d_samples.begin(), e = d_samples.end(); i != e; ++i)
+        out << i->sequence << "," << i->request << "," << i->worker << "," << i->ok << "," << i->start << ","
+            << i->latency << "," << i->bytes << endl;
+}
+
+// Find the number that follows "key": in doc, starting at pos
+static bool find_number(const string &doc, string::size_type pos, const string &key, double &value)
+{
+    pos = doc.find("\"" + key + "\":", pos);
+    if (pos == string::npos) return false;
+
+    const char *start = doc.c_str() + pos + key.length() + 3;
+    char *end = 0;
+    value = strtod(start, &end);
+    return end != start;
+}
+
+/**
+ * @brief Compare this run with an earlier one
+ *
+ * A latency percentile (p50, p95, p99) that is more than threshold percent
+ * larger, or a throughput that is more than threshold percent smaller, is
+ * a regression.
+ *
+ * @param baseline A JSON summary written by write_json()
+ * @param threshold The change allowed, as a percentage
+ * @param report Write a line for each value compared here
+ * @return The number of regressions
+ * @exception BESSyntaxUserError if the baseline cannot be read
+ */
+unsigned int ReplayStats::compare(const string &baseline, double threshold, ostream &report) const
+{
+    ifstream in(baseline.c_str());
+    if (!in) throw BESSyntaxUserError("Could not open the baseline " + baseline, __FILE__, __LINE__);
+    ostringstream doc;
+    doc << in.rdbuf();
+
+    // The run's latencies come before the per-request ones
+    string::size_type latency_pos = doc.str().find("\"latency_ms\":");
+    if (latency_pos == string::npos)
+        throw BESSyntaxUserError("The baseline " + baseline + " is not a besreplay summary", __FILE__, __LINE__);
+
+    unsigned int regressions = 0;
+    report << fixed << setprecision(3);
+
+    const char *keys[] = { "p50", "p95", "p99" };
+    for (unsigned int k = 0; k < sizeof(keys) / sizeof(keys[0]); ++k) {
+        double before;
+        if (!find_number(doc.str(), latency_pos, keys[k], before))
+            throw BESSyntaxUserError("The baseline " + baseline + " has no " + keys[k] + " latency", __FILE__,
+                __LINE__);
+        double now = percentile(atof(keys[k] + 1)) / 1000.0;
+        bool regressed = now > before * (1 + threshold / 100.0);
+        if (regressed) ++regressions;
+        report << keys[k] << " latency: " << before << " ms -> " << now << " ms" << (regressed ? " REGRESSION" : "")
+            << endl;
+    }
+
+    double before;
+    if (!find_number(doc.str(), 0, "throughput_rps", before))
+        throw BESSyntaxUserError("The baseline " + baseline + " has no throughput", __FILE__, __LINE__);
+    bool regressed = throughput() < before * (1 - threshold / 100.0);
+    if (regressed) ++regressions;
+    report << "throughput: " << before << " req/s -> " << throughput() << " req/s" << (regressed ? " REGRESSION" : "")
+        << endl;
+
+    return regressions;
+}
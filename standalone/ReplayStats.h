@@ -0,0 +1,76 @@
+// ReplayStats.h
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef ReplayStats_h
+#define ReplayStats_h 1
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+/// The result of running one request. This is written to a pipe by the
+/// worker processes, so it must stay a plain struct.
+struct ReplaySample {
+    unsigned int request;       ///< Index of the request in the corpus
+    unsigned int sequence;      ///< Position in the whole run
+    unsigned int worker;
+    int ok;
+    unsigned long long start;   ///< Microseconds since the run started
+    unsigned long long latency; ///< Microseconds
+    unsigned long long bytes;   ///< Size of the response
+};
+
+/**
+ * @brief Summarize the results of a besreplay run
+ *
+ * The summary is written as a JSON document that holds the latency
+ * distribution (in milliseconds), the throughput and the response sizes
+ * for the whole run and for each request in the corpus. A summary can be
+ * compared with one from an earlier run to find regressions.
+ */
+class ReplayStats {
+private:
+    std::vector<ReplaySample> d_samples;
+    unsigned long long d_elapsed;   ///< Microseconds
+
+public:
+    ReplayStats() : d_elapsed(0) { }
+    virtual ~ReplayStats() { }
+
+    void add(const ReplaySample &sample) { d_samples.push_back(sample); }
+    void set_elapsed(unsigned long long elapsed) { d_elapsed = elapsed; }
+
+    const std::vector<ReplaySample> &get_samples() const { return d_samples; }
+    unsigned int errors() const;
+    double throughput() const;
+
+    static double percentile(std::vector<unsigned long long> &values, double p);
+    double percentile(double p) const;
+
+    void write_json(std::ostream &out, const std::string &mode, unsigned int concurrency, double rate,
+        unsigned int corpus_size) const;
+    void write_samples(std::ostream &out) const;
+
+    unsigned int compare(const std::string &baseline, double threshold, std::ostream &report) const;
+};
+
+#endif // ReplayStats_h
@@ -0,0 +1,333 @@
+// replayT.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+
+#include "config.h"
+
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "ReplayCorpus.h"
+#include "ReplayStats.h"
+#include "BESError.h"
+
+#include "GetOpt.h"
+
+using namespace std;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+static const string MARK = "2018-05-01T10:11:12UTC|&|4242|&|";
+
+class replayT: public CppUnit::TestFixture {
+private:
+    static bool has(const string &doc, const string &s)
+    {
+        return doc.find(s) != string::npos;
+    }
+
+    static ReplaySample sample(unsigned int request, unsigned long long latency, int ok = 1)
+    {
+        ReplaySample s = { request, 0, 0, ok, 0, latency, 100 };
+        return s;
+    }
+
+    static void write_file(const string &name, const string &content)
+    {
+        ofstream out(name.c_str());
+        out << content;
+    }
+
+public:
+    replayT()
+    {
+    }
+
+    ~replayT()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+        unlink("replayT_corpus.txt");
+        unlink("replayT_baseline.json");
+    }
+
+    CPPUNIT_TEST_SUITE( replayT );
+
+    CPPUNIT_TEST(dap2_log_line_test);
+    CPPUNIT_TEST(return_as_log_line_test);
+    CPPUNIT_TEST(dap4_log_line_test);
+    CPPUNIT_TEST(other_log_line_test);
+    CPPUNIT_TEST(escape_log_line_test);
+    CPPUNIT_TEST(load_test);
+    CPPUNIT_TEST(incomplete_load_test);
+    CPPUNIT_TEST(percentile_test);
+    CPPUNIT_TEST(stats_test);
+    CPPUNIT_TEST(compare_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void dap2_log_line_test()
+    {
+        string doc = ReplayCorpus::log_line_to_request(MARK + "get.dods,/usr/share/hyrax/data/fnoc1.nc,u[0:1]",
+            "/usr/share/hyrax", 3);
+        DBG(cerr << doc << endl);
+
+        CPPUNIT_ASSERT(has(doc, "reqID=\"replay_3\""));
+        CPPUNIT_ASSERT(has(doc, "<setContext name=\"dap_format\">dap2</setContext>"));
+        CPPUNIT_ASSERT(has(doc, "space=\"catalog\">/data/fnoc1.nc</setContainer>"));
+        CPPUNIT_ASSERT(has(doc, "<constraint>u[0:1]</constraint>"));
+        CPPUNIT_ASSERT(has(doc, "<get type=\"dods\" definition=\"d\" />"));
+    }
+
+    void return_as_log_line_test()
+    {
+        string doc = ReplayCorpus::log_line_to_request(MARK + "get.dods,netcdf,/root/data/fnoc1.nc.gz", "/root", 0);
+        DBG(cerr << doc << endl);
+
+        CPPUNIT_ASSERT(has(doc, ">/data/fnoc1.nc.gz</setContainer>"));
+        CPPUNIT_ASSERT(has(doc, "<container name=\"c\" />"));
+        CPPUNIT_ASSERT(has(doc, "returnAs=\"netcdf\""));
+    }
+
+    // DAP4 requests use dap4constraint and keep everything after the path
+    void dap4_log_line_test()
+    {
+        string doc = ReplayCorpus::log_line_to_request(MARK + "get.dap,/data/coads.h5,/SST;/lat,lon", "", 0);
+        DBG(cerr << doc << endl);
+
+        CPPUNIT_ASSERT(!has(doc, "dap_format"));
+        CPPUNIT_ASSERT(has(doc, ">/data/coads.h5</setContainer>"));
+        CPPUNIT_ASSERT(has(doc, "<dap4constraint>/SST;/lat,lon</dap4constraint>"));
+        CPPUNIT_ASSERT(has(doc, "<get type=\"dap\""));
+    }
+
+    void other_log_line_test()
+    {
+        CPPUNIT_ASSERT(ReplayCorpus::log_line_to_request(MARK + "show.version", "", 0).empty());
+        CPPUNIT_ASSERT(ReplayCorpus::log_line_to_request(MARK + "get.dods", "", 0).empty());
+        CPPUNIT_ASSERT(ReplayCorpus::log_line_to_request("get.dods,/data/fnoc1.nc", "", 0).empty());
+        // Only the root directory was logged
+        CPPUNIT_ASSERT(ReplayCorpus::log_line_to_request(MARK + "get.das,/root", "/root", 0).empty());
+    }
+
+    void escape_log_line_test()
+    {
+        string doc = ReplayCorpus::log_line_to_request(MARK + "get.dods,/data/fnoc1.nc,u&v<3", "", 0);
+        DBG(cerr << doc << endl);
+
+        CPPUNIT_ASSERT(has(doc, "<constraint>u&amp;v&lt;3</constraint>"));
+    }
+
+    // Request documents, comments and log lines can be mixed
+    void load_test()
+    {
+        write_file("replayT_corpus.txt",
+            "# a comment\n"
+                "\n"
+                "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                "<request reqID=\"one\">\n"
+                "    <showVersion />\n"
+                "</request>\n"
+                + MARK + "get.das,/root/data/fnoc1.nc\n"
+                + MARK + "show.version\n"
+                "<request reqID=\"two\"><showVersion /></request><request reqID=\"three\"><showVersion /></request>\n");
+
+        ReplayCorpus corpus("/root");
+        corpus.load("replayT_corpus.txt");
+
+        CPPUNIT_ASSERT(corpus.size() == 4);
+        CPPUNIT_ASSERT(has(corpus.get_requests()[0], "reqID=\"one\""));
+        CPPUNIT_ASSERT(corpus.get_requests()[0].find("<?xml") == 0);
+        CPPUNIT_ASSERT(has(corpus.get_requests()[1], ">/data/fnoc1.nc</setContainer>"));
+        CPPUNIT_ASSERT(has(corpus.get_requests()[1], "reqID=\"replay_1\""));
+        CPPUNIT_ASSERT(corpus.get_requests()[2] == "<request reqID=\"two\"><showVersion /></request>");
+        CPPUNIT_ASSERT(corpus.get_requests()[3] == "<request reqID=\"three\"><showVersion /></request>");
+    }
+
+    void incomplete_load_test()
+    {
+        write_file("replayT_corpus.txt", "<request reqID=\"one\">\n    <showVersion />\n");
+
+        ReplayCorpus corpus;
+        try {
+            corpus.load("replayT_corpus.txt");
+            CPPUNIT_FAIL("Expected an error for an incomplete request");
+        }
+        catch (BESError &e) {
+            DBG(cerr << e.get_message() << endl);
+        }
+
+        try {
+            corpus.load("replayT_no_such_corpus.txt");
+            CPPUNIT_FAIL("Expected an error for a missing corpus");
+        }
+        catch (BESError &e) {
+            DBG(cerr << e.get_message() << endl);
+        }
+    }
+
+    void percentile_test()
+    {
+        vector<unsigned long long> values;
+        CPPUNIT_ASSERT(ReplayStats::percentile(values, 50) == 0);
+
+        values.push_back(7);
+        CPPUNIT_ASSERT(ReplayStats::percentile(values, 0) == 7);
+        CPPUNIT_ASSERT(ReplayStats::percentile(values, 99) == 7);
+
+        // 100 down to 1; percentile() sorts them
+        values.clear();
+        for (unsigned long long v = 100; v > 0; --v)
+            values.push_back(v);
+
+        CPPUNIT_ASSERT(ReplayStats::percentile(values, 0) == 1);
+        CPPUNIT_ASSERT(ReplayStats::percentile(values, 50) == 50);
+        CPPUNIT_ASSERT(ReplayStats::percentile(values, 95) == 95);
+        CPPUNIT_ASSERT(ReplayStats::percentile(values, 99) == 99);
+        CPPUNIT_ASSERT(ReplayStats::percentile(values, 99.5) == 100);
+        CPPUNIT_ASSERT(ReplayStats::percentile(values, 100) == 100);
+
+        // Nearest rank: the p50 of four values is the second
+        values.clear();
+        values.push_back(40);
+        values.push_back(10);
+        values.push_back(30);
+        values.push_back(20);
+        CPPUNIT_ASSERT(ReplayStats::percentile(values, 50) == 20);
+        CPPUNIT_ASSERT(ReplayStats::percentile(values, 51) == 30);
+    }
+
+    void stats_test()
+    {
+        ReplayStats stats;
+        for (unsigned int i = 1; i <= 10; ++i)
+            stats.add(sample(i % 2, i * 1000, i != 4));
+        stats.set_elapsed(2000000);     // two seconds
+
+        CPPUNIT_ASSERT(stats.errors() == 1);
+        CPPUNIT_ASSERT(stats.throughput() == 5.0);
+        CPPUNIT_ASSERT(stats.percentile(50) == 5000);
+        CPPUNIT_ASSERT(stats.percentile(100) == 10000);
+
+        ostringstream json;
+        stats.write_json(json, "standalone", 2, 0, 2);
+        DBG(cerr << json.str() << endl);
+        CPPUNIT_ASSERT(has(json.str(), "\"requests\": 10,"));
+        CPPUNIT_ASSERT(has(json.str(), "\"errors\": 1,"));
+        CPPUNIT_ASSERT(has(json.str(), "\"p50\": 5.000"));
+        CPPUNIT_ASSERT(has(json.str(), "{\"request\": 1, \"count\": 5, \"errors\": 0,"));
+        CPPUNIT_ASSERT(has(json.str(), "{\"request\": 0, \"count\": 5, \"errors\": 1,"));
+    }
+
+    void compare_test()
+    {
+        ReplayStats baseline;
+        for (unsigned int i = 1; i <= 100; ++i)
+            baseline.add(sample(0, i * 1000));
+        baseline.set_elapsed(10000000);
+        ostringstream json;
+        baseline.write_json(json, "standalone", 1, 0, 1);
+        write_file("replayT_baseline.json", json.str());
+
+        ostringstream report;
+        CPPUNIT_ASSERT(baseline.compare("replayT_baseline.json", 10, report) == 0);
+
+        // Twice as slow: three latency regressions and one for throughput
+        ReplayStats slower;
+        for (unsigned int i = 1; i <= 100; ++i)
+            slower.add(sample(0, i * 2000));
+        slower.set_elapsed(20000000);
+        report.str("");
+        CPPUNIT_ASSERT(slower.compare("replayT_baseline.json", 10, report) == 4);
+        DBG(cerr << report.str());
+        CPPUNIT_ASSERT(has(report.str(), "p99 latency: 99.000 ms -> 198.000 ms REGRESSION"));
+
+        // ... but within a 150% threshold
+        CPPUNIT_ASSERT(slower.compare("replayT_baseline.json", 150, report) == 0);
+
+        try {
+            slower.compare("replayT_no_such_baseline.json", 10, report);
+            CPPUNIT_FAIL("Expected an error for a missing baseline");
+        }
+        catch (BESError &e) {
+            DBG(cerr << e.get_message() << endl);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(replayT);
+
+int main(int argc, char*argv[])
+{
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    GetOpt getopt(argc, argv, "d");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = true;  // debug is a static global
+            break;
+        default:
+            break;
+        }
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            test = string("replayT::") + argv[i++];
+
+            cerr << endl << "Running test " << test << endl << endl;
+
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -44,10 +44,16 @@ BESXMLCatalogCommand::BESXMLCatalogCommand(const BESDataHandlerInterface &base_d
 {
 }
 
-/** @brief parse a show command. No properties or children elements
+/** @brief parse a show command. No children elements
  *
  &lt;showCatalog node="containerName" /&gt;
  *
+ * The children of a node can be listed a page at a time using the
+ * optional offset and limit properties, and ordered using sort (name,
+ * size or lastModified) and order (ascending or descending):
+ *
+ &lt;showCatalog node="containerName" offset="1000" limit="100" sort="lastModified" order="descending" /&gt;
+ *
  * @param node xml2 element node pointer
  */
 void BESXMLCatalogCommand::parse_request(xmlNode *node)
@@ -80,6 +86,24 @@ void BESXMLCatalogCommand::parse_request(xmlNode *node)
     if (!d_xmlcmd_dhi.data[CONTAINER].empty()) {
         d_cmd_log_info += " for " + d_xmlcmd_dhi.data[CONTAINER];
     }
+
+    // paging and sorting are optional
+    if (!props["offset"].empty()) {
+        d_xmlcmd_dhi.data[CATALOG_OFFSET] = props["offset"];
+        d_cmd_log_info += " offset " + props["offset"];
+    }
+    if (!props["limit"].empty()) {
+        d_xmlcmd_dhi.data[CATALOG_LIMIT] = props["limit"];
+        d_cmd_log_info += " limit " + props["limit"];
+    }
+    if (!props["sort"].empty()) {
+        d_xmlcmd_dhi.data[CATALOG_SORT] = props["sort"];
+        d_cmd_log_info += " sort " + props["sort"];
+    }
+    if (!props["order"].empty()) {
+        d_xmlcmd_dhi.data[CATALOG_ORDER] = props["order"];
+        d_cmd_log_info += " " + props["order"];
+    }
     d_cmd_log_info += ";";
 
     // now that we've set the action, go get the response handler for the
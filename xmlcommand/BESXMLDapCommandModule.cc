@@ -40,6 +40,7 @@ using std::cout;
 #include "BESNames.h"
 #include "BESDebug.h"
 #include "BESXMLCatalogCommand.h"
+#include "BESXMLShowCommand.h"
 // FIXME Remove #include "BESXMLGetDataDDXCommand.h"
 
 /** @brief Adds the basic DAP XML command objects to the XMLCommand list of
@@ -60,6 +61,9 @@ void BESXMLDapCommandModule::initialize(const string &/*modname*/)
 
     BESXMLCommand::add_command( SHOW_INFO_RESPONSE_STR,
             BESXMLCatalogCommand::CommandBuilder );
+
+    BESXMLCommand::add_command( SHOW_STORED_RESULT_JOBS_STR,
+            BESXMLShowCommand::CommandBuilder );
 #if 0
     BESXMLCommand::add_command( DATADDX_RESPONSE,
             BESXMLGetDataDDXCommand::CommandBuilder );
@@ -81,6 +85,7 @@ void BESXMLDapCommandModule::terminate(const string &/*modname*/)
 
     BESXMLCommand::del_command( CATALOG_RESPONSE_STR );
     BESXMLCommand::del_command( SHOW_INFO_RESPONSE_STR );
+    BESXMLCommand::del_command( SHOW_STORED_RESULT_JOBS_STR );
 #if 0
     BESXMLCommand::del_command( DATADDX_RESPONSE );
 #endif
@@ -68,6 +68,8 @@ int BESXMLDefaultCommands::initialize(int, char**)
 #endif
     BESXMLCommand::add_command( VERS_RESPONSE_STR, BESXMLShowCommand::CommandBuilder);
     BESXMLCommand::add_command( STATUS_RESPONSE_STR, BESXMLShowCommand::CommandBuilder);
+    BESXMLCommand::add_command( SHOW_TRACE_STR, BESXMLShowCommand::CommandBuilder);
+    BESXMLCommand::add_command( SHOW_METRICS_STR, BESXMLShowCommand::CommandBuilder);
     BESXMLCommand::add_command( SERVICE_RESPONSE_STR, BESXMLShowCommand::CommandBuilder);
 
     BESXMLCommand::add_command( SET_CONTEXT_STR, BESXMLSetContextCommand::CommandBuilder);
@@ -107,6 +109,8 @@ int BESXMLDefaultCommands::terminate(void)
 #endif
     BESXMLCommand::del_command( VERS_RESPONSE_STR);
     BESXMLCommand::del_command( STATUS_RESPONSE_STR);
+    BESXMLCommand::del_command( SHOW_TRACE_STR);
+    BESXMLCommand::del_command( SHOW_METRICS_STR);
     BESXMLCommand::del_command( SET_CONTEXT_STR);
     BESXMLCommand::del_command( SETCONTAINER_STR);
     BESXMLCommand::del_command( DEFINE_RESPONSE_STR);
@@ -34,6 +34,9 @@
 
 #include <iostream>
 #include <sstream>
+#include <set>
+#include <new>
+#include <exception>
 
 using namespace std;
 
@@ -46,15 +49,20 @@ using namespace std;
 #include "BESReturnManager.h"
 #include "BESInfo.h"
 #include "BESStopWatch.h"
+#include "BESTracer.h"
+#include "BESMetrics.h"
 
 #include "BESDebug.h"
 #include "BESLog.h"
 #include "BESSyntaxUserError.h"
+#include "BESInternalError.h"
+#include "BESInternalFatalError.h"
+#include "BESContainer.h"
 
 #define LOG_ONLY_GET_COMMANDS
 
 BESXMLInterface::BESXMLInterface(const string &xml_doc, ostream *strm) :
-    BESInterface(strm), d_xml_document(xml_doc)
+    BESInterface(strm), d_xml_document(xml_doc), d_batch(false)
 {
     // This is needed because we want the parent to have access to the information
     // added to the DHI
@@ -133,6 +141,10 @@ void BESXMLInterface::build_data_request_plan()
 
         BESDEBUG("besxml", "request id = " << d_dhi_ptr->data[REQUEST_ID] << endl);
 
+        // A batched request may hold several commands with responses (e.g., the
+        // DAS, DDS and data for one dataset); each is sent as its own response.
+        d_batch = (props[BATCH_REQUEST] == "true");
+
         // iterate through the children of the request element. Each child is an
         // individual command.
         bool has_response = false;  // set to true when a command with a response is found.
@@ -162,9 +174,9 @@ void BESXMLInterface::build_data_request_plan()
                 // push this new command to the back of the list
                 d_xml_cmd_list.push_back(current_cmd);
 
-                // only one of the commands can build a response
+                // only one of the commands can build a response, unless this is a batch
                 bool cmd_has_response = current_cmd->has_response();
-                if (has_response && cmd_has_response)
+                if (has_response && cmd_has_response && !d_batch)
                     throw BESSyntaxUserError("Commands with multiple responses not supported.", __FILE__, __LINE__);
 
                 has_response = cmd_has_response;
@@ -212,69 +224,166 @@ void BESXMLInterface::build_data_request_plan()
 }
 
 /** @brief Execute the data request plan
+ *
+ * In a batched request, every response but the last is ended here (using
+ * the ResponseFramer, if there is one) and an error in one of those is sent
+ * in place of that response; the remaining commands still run. Only a fatal
+ * error or a timeout ends the whole batch. The last response, or its error,
+ * is ended by the caller just as for a request that is not batched.
+ *
+ * @note The commands of a batch share the request's containers and
+ * context. Each command still builds its own response object, but the DDS
+ * or DMR a handler builds for a container is kept with the container, so
+ * the other DAP2 or DAP4 responses for it in the batch are copied from it
+ * rather than built by opening the dataset again. The DAS is built
+ * separately, as in a request that is not batched.
  */
 void BESXMLInterface::execute_data_request_plan()
 {
+    // In a batch, find the last command with a response; it's handled as usual
+    vector<BESXMLCommand *>::iterator last_response = d_xml_cmd_list.end();
+    if (d_batch) {
+        for (vector<BESXMLCommand *>::iterator r = d_xml_cmd_list.begin(); r != d_xml_cmd_list.end(); r++)
+            if ((*r)->has_response()) last_response = r;
+    }
+
     vector<BESXMLCommand *>::iterator i = d_xml_cmd_list.begin();
     vector<BESXMLCommand *>::iterator e = d_xml_cmd_list.end();
     for (; i != e; i++) {
-        (*i)->prep_request();
+        if (d_batch && (*i)->has_response() && i != last_response) {
+            execute_batched_command(*i);
+            continue;
+        }
 
-        d_dhi_ptr = &(*i)->get_xmlcmd_dhi();
+        execute_command(*i);
+    }
+}
+
+/**
+ * @brief Run one command of a batch and end its response
+ *
+ * Errors other than fatal ones and timeouts are sent in place of the
+ * command's response. Other exceptions are treated the way
+ * BESInterface::execute_request() treats them, except that only running
+ * out of memory ends the batch. This library does not use libdap, so a
+ * libdap::Error that a handler failed to convert to a BESDapError is
+ * caught by the last handler.
+ */
+void BESXMLInterface::execute_batched_command(BESXMLCommand *cmd)
+{
+    try {
+        execute_command(cmd);
+    }
+    catch (BESError &e) {
+        if (e.get_error_type() == BES_INTERNAL_FATAL_ERROR || e.get_error_type() == BES_TIMEOUT_ERROR) throw;
+
+        send_batched_error(e);
+    }
+    catch (bad_alloc &e) {
+        throw BESInternalFatalError(string("BES out of memory: ") + e.what(), __FILE__, __LINE__);
+    }
+    catch (std::exception &e) {
+        BESInternalError ex(string("C++ Exception: ") + e.what(), __FILE__, __LINE__);
+        send_batched_error(ex);
+    }
+    catch (...) {
+        BESInternalError ex("An undefined exception has been thrown", __FILE__, __LINE__);
+        send_batched_error(ex);
+    }
+
+    if (d_response_framer) d_response_framer->end_response();
+}
+
+/// Send an error in place of a batched command's response
+void BESXMLInterface::send_batched_error(BESError &e)
+{
+    // Build the error response in d_dhi_ptr->error_info
+    int status = exception_manager(e);
+    if (d_response_framer) d_response_framer->error(status);
+
+    d_dhi_ptr->error_info->print(d_dhi_ptr->get_output_stream());
+    delete d_dhi_ptr->error_info;
+    d_dhi_ptr->error_info = 0;
+}
+
+/** @brief Run one command and transmit its response
+ */
+void BESXMLInterface::execute_command(BESXMLCommand *cmd)
+{
+    cmd->prep_request();
 
-        // In 'verbose' logging mode, log all the commands.
-        VERBOSE(d_dhi_ptr->data[REQUEST_FROM] << " [" << d_dhi_ptr->data[LOG_INFO] << "] executing" << endl);
+    d_dhi_ptr = &cmd->get_xmlcmd_dhi();
 
-        // This is the main log entry when the server is not in 'verbose' mode.
-        // There are two ays we can do this, one writes a log line for only the
-        // get commands, the other write the set container, define and get commands.
-        // TODO Make this configurable? jhrg 11/14/17
+    // Tell the response handlers they may share what they build with the
+    // other commands of the batch (see BESContainer::set_request_object())
+    if (d_batch) d_dhi_ptr->data[BATCH_REQUEST] = "true";
+
+    // In 'verbose' logging mode, log all the commands.
+    VERBOSE(d_dhi_ptr->data[REQUEST_FROM] << " [" << d_dhi_ptr->data[LOG_INFO] << "] executing" << endl);
+
+    // This is the main log entry when the server is not in 'verbose' mode.
+    // There are two ays we can do this, one writes a log line for only the
+    // get commands, the other write the set container, define and get commands.
+    // TODO Make this configurable? jhrg 11/14/17
 #ifdef LOG_ONLY_GET_COMMANDS
-        // Special logging action for the 'get' command. In non-verbose logging mode,
-        // only log the get command.
-        if (d_dhi_ptr->action.find("get.") != string::npos) {
-
-            string new_log_info = d_dhi_ptr->action;
-            if (!d_dhi_ptr->data[RETURN_CMD].empty())
-                new_log_info.append(",").append(d_dhi_ptr->data[RETURN_CMD]);
-
-            // Assume this is DAP and thus there is at most one container. Log a warning if that's
-            // not true. jhrg 11/14/17
-            BESContainer *c = *(d_dhi_ptr->containers.begin());
-            if (c) {
-                if (!c->access().empty()) new_log_info.append(",").append(c->access());
-
-                if (!c->get_constraint().empty()) {
-                    new_log_info.append(",").append(c->get_constraint());
-                }
-                else {
-                    if (!c->get_dap4_constraint().empty()) new_log_info.append(",").append(c->get_dap4_constraint());
-                    if (!c->get_dap4_function().empty()) new_log_info.append(",").append(c->get_dap4_function());
-                }
+    // Special logging action for the 'get' command. In non-verbose logging mode,
+    // only log the get command.
+    if (d_dhi_ptr->action.find("get.") != string::npos) {
+
+        string new_log_info = d_dhi_ptr->action;
+        if (!d_dhi_ptr->data[RETURN_CMD].empty())
+            new_log_info.append(",").append(d_dhi_ptr->data[RETURN_CMD]);
+
+        // Assume this is DAP and thus there is at most one container. Log a warning if that's
+        // not true. jhrg 11/14/17
+        BESContainer *c = *(d_dhi_ptr->containers.begin());
+        if (c) {
+            // Log the catalog's path, not access(), which for a compressed
+            // file is the path of the decompressed copy in the cache.
+            if (!c->get_real_name().empty()) new_log_info.append(",").append(c->get_real_name());
+
+            if (!c->get_constraint().empty()) {
+                new_log_info.append(",").append(c->get_constraint());
             }
+            else {
+                if (!c->get_dap4_constraint().empty()) new_log_info.append(",").append(c->get_dap4_constraint());
+                if (!c->get_dap4_function().empty()) new_log_info.append(",").append(c->get_dap4_function());
+            }
+        }
 
-            LOG(new_log_info << endl);
+        LOG(new_log_info << endl);
 
-            if (d_dhi_ptr->containers.size() > 1)
-                LOG("Warning: The previous command had multiple containers defined, but only the was logged.");
-        }
+        if (d_dhi_ptr->containers.size() > 1)
+            LOG("Warning: The previous command had multiple containers defined, but only the was logged.");
+    }
 #else
-        if (!BESLog::TheLog()->is_verbose()) {
-            if (d_dhi_ptr->action.find("set.context") == string::npos
-                && d_dhi_ptr->action.find("show.catalog") == string::npos) {
-                LOG(d_dhi_ptr->data[LOG_INFO] << endl);
-            }
+    if (!BESLog::TheLog()->is_verbose()) {
+        if (d_dhi_ptr->action.find("set.context") == string::npos
+            && d_dhi_ptr->action.find("show.catalog") == string::npos) {
+            LOG(d_dhi_ptr->data[LOG_INFO] << endl);
         }
+    }
 #endif
 
-        if (!d_dhi_ptr->response_handler)
-            throw BESInternalError(string("The response handler '") + d_dhi_ptr->action + "' does not exist", __FILE__,
-            __LINE__);
+    if (!d_dhi_ptr->response_handler)
+        throw BESInternalError(string("The response handler '") + d_dhi_ptr->action + "' does not exist", __FILE__,
+        __LINE__);
 
-        d_dhi_ptr->response_handler->execute(*d_dhi_ptr);
+    unsigned long long start = BESTracer::wall_time();
 
-        transmit_data();    // TODO move method body in here? jhrg 11/8/17
+    {
+        BESStopWatch sw;
+        if (BESISTIMING) sw.start(d_dhi_ptr->data[LOG_INFO] + " executing", d_dhi_ptr->data[REQUEST_ID]);
+
+        d_dhi_ptr->response_handler->execute(*d_dhi_ptr);
     }
+
+    transmit_data();    // TODO move method body in here? jhrg 11/8/17
+
+    // Commands that fail are counted by exception_manager()
+    string action = "{action=\"" + d_dhi_ptr->action + "\"}";
+    BESMetrics::count("bes_requests_total" + action);
+    BESMetrics::observe("bes_request_duration_seconds" + action, BESTracer::wall_time() - start);
 }
 
 /**
@@ -282,7 +391,8 @@ void BESXMLInterface::execute_data_request_plan()
  * @todo Remove?
  *
  * Only transmit if there is an error or if there is a ResponseHandler. For any
- * XML document with one or more commands, there should only be one ResponseHandler.
+ * XML document with one or more commands, there should only be one ResponseHandler,
+ * unless the request is a batch.
  */
 void BESXMLInterface::transmit_data()
 {
@@ -301,7 +411,7 @@ void BESXMLInterface::transmit_data()
             /*d_dhi_ptr->data[SERVER_PID] << " from " <<*/d_dhi_ptr->data[REQUEST_FROM] << " [" << d_dhi_ptr->data[LOG_INFO] << "] transmitting" << endl);
 
         BESStopWatch sw;
-        if (BESISDEBUG(TIMING_LOG)) sw.start(d_dhi_ptr->data[LOG_INFO] + " transmitting", d_dhi_ptr->data[REQUEST_ID]);
+        if (BESISTIMING) sw.start(d_dhi_ptr->data[LOG_INFO] + " transmitting", d_dhi_ptr->data[REQUEST_ID]);
 
         string return_as = d_dhi_ptr->data[RETURN_CMD];
         if (!return_as.empty()) {
@@ -340,6 +450,31 @@ void BESXMLInterface::log_status()
     }
 }
 
+/** @brief Release the containers used by all of the commands
+ *
+ * The commands of one request may share containers, so each is released once.
+ * The objects the commands kept with a container are deleted here too.
+ */
+void BESXMLInterface::end_request()
+{
+    set<BESContainer *> released;
+
+    vector<BESXMLCommand *>::iterator i = d_xml_cmd_list.begin();
+    vector<BESXMLCommand *>::iterator e = d_xml_cmd_list.end();
+    for (; i != e; i++) {
+        d_dhi_ptr = &(*i)->get_xmlcmd_dhi();
+
+        d_dhi_ptr->first_container();
+        while (d_dhi_ptr->container) {
+            if (released.insert(d_dhi_ptr->container).second) {
+                d_dhi_ptr->container->clear_request_objects();
+                d_dhi_ptr->container->release();
+            }
+            d_dhi_ptr->next_container();
+        }
+    }
+}
+
 /** @brief Clean up after the request is completed
  */
 void BESXMLInterface::clean()
@@ -39,6 +39,7 @@
 #include "BESDataHandlerInterface.h"
 
 class BESXMLCommand;
+class BESError;
 
 /** @brief Entry point into BES using xml document requests
 
@@ -55,6 +56,13 @@ private:
     /// This is the DHI used to hold information parsed from the request.
     BESDataHandlerInterface d_xml_interface_dhi;
 
+    /// True if the request may hold several commands with responses
+    bool d_batch;
+
+    void execute_command(BESXMLCommand *cmd);
+    void execute_batched_command(BESXMLCommand *cmd);
+    void send_batched_error(BESError &e);
+
 protected:
     virtual void build_data_request_plan();
 
@@ -64,6 +72,8 @@ protected:
 
     virtual void log_status();
 
+    virtual void end_request();
+
     virtual void clean();
 
 public:
@@ -0,0 +1,211 @@
+// batchT.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2018 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace CppUnit;
+
+#include <string>
+#include <iostream>
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+#include "BuildTInterface.h"
+#include "BESXMLCommand.h"
+#include "BESSyntaxUserError.h"
+#include "BESError.h"
+#include "TheBESKeys.h"
+
+#include <GetOpt.h>
+
+#include "test_config.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+static int parsed = 0;
+
+/// A command with a response that only counts how often it's parsed
+class BatchTCmd: public BESXMLCommand {
+public:
+    BatchTCmd(const BESDataHandlerInterface &dhi) : BESXMLCommand(dhi) { }
+    virtual ~BatchTCmd() { }
+
+    virtual void parse_request(xmlNode *) { parsed++; }
+    virtual bool has_response() { return true; }
+
+    static BESXMLCommand *CommandBuilder(const BESDataHandlerInterface &dhi) { return new BatchTCmd(dhi); }
+};
+
+/// A command without a response, like setContainer
+class BatchTSetCmd: public BESXMLCommand {
+public:
+    BatchTSetCmd(const BESDataHandlerInterface &dhi) : BESXMLCommand(dhi) { }
+    virtual ~BatchTSetCmd() { }
+
+    virtual void parse_request(xmlNode *) { parsed++; }
+    virtual bool has_response() { return false; }
+
+    static BESXMLCommand *CommandBuilder(const BESDataHandlerInterface &dhi) { return new BatchTSetCmd(dhi); }
+};
+
+class batchT: public TestFixture {
+private:
+    string request(const string &props, const string &cmds)
+    {
+        return "<?xml version=\"1.0\" encoding=\"UTF-8\"?><request reqID=\"batchT\"" + props + ">" + cmds + "</request>";
+    }
+
+    // Parse the request; return true if it was parsed, false if it was
+    // rejected because it holds more than one response
+    bool parse(const string &doc)
+    {
+        try {
+            BuildTInterface bti(doc);
+            bti.run();
+            return true;
+        }
+        catch (BESSyntaxUserError &e) {
+            DBG(cerr << "Caught: " << e.get_message() << endl);
+            return false;
+        }
+    }
+
+public:
+    batchT()
+    {
+    }
+    ~batchT()
+    {
+    }
+
+    void setUp()
+    {
+        TheBESKeys::ConfigFile = string(TEST_SRC_DIR) + "/bes.conf";
+
+        BESXMLCommand::add_command("batchTGet", BatchTCmd::CommandBuilder);
+        BESXMLCommand::add_command("batchTSet", BatchTSetCmd::CommandBuilder);
+        parsed = 0;
+    }
+
+    void tearDown()
+    {
+        BESXMLCommand::del_command("batchTGet");
+        BESXMLCommand::del_command("batchTSet");
+    }
+
+    CPPUNIT_TEST_SUITE( batchT );
+
+    CPPUNIT_TEST( one_response_test );
+    CPPUNIT_TEST( two_responses_test );
+    CPPUNIT_TEST( batch_test );
+    CPPUNIT_TEST( batch_false_test );
+    CPPUNIT_TEST( response_then_set_test );
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void one_response_test()
+    {
+        CPPUNIT_ASSERT(parse(request("", "<batchTSet/><batchTGet/>")));
+        CPPUNIT_ASSERT(parsed == 2);
+    }
+
+    // Without batch="true" only one command may have a response
+    void two_responses_test()
+    {
+        CPPUNIT_ASSERT(!parse(request("", "<batchTGet/><batchTGet/>")));
+        CPPUNIT_ASSERT(parsed == 1);
+    }
+
+    void batch_test()
+    {
+        CPPUNIT_ASSERT(parse(request(" batch=\"true\"", "<batchTSet/><batchTGet/><batchTGet/><batchTGet/>")));
+        CPPUNIT_ASSERT(parsed == 4);
+    }
+
+    void batch_false_test()
+    {
+        CPPUNIT_ASSERT(!parse(request(" batch=\"false\"", "<batchTGet/><batchTGet/>")));
+    }
+
+    // Only the previous command counts: a command without a response
+    // between two with responses hides the first one, as it always has
+    void response_then_set_test()
+    {
+        CPPUNIT_ASSERT(parse(request("", "<batchTGet/><batchTSet/><batchTGet/>")));
+        CPPUNIT_ASSERT(parsed == 3);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( batchT );
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: batchT has the following tests:" << endl;
+            const std::vector<Test*> &tests = batchT::suite()->getTests();
+            unsigned int prefix_len = batchT::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = batchT::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}